@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "CompressedSlices.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+namespace iseg {
+
+namespace {
+enum eStorage : unsigned char {
+	kRaw = 0,
+	kPacked = 1
+};
+
+// run-length codes: 0..127 are followed by 1..128 literal bytes, 128..255 by one byte repeated 3..130 times
+const size_t k_max_literal = 128;
+const size_t k_min_run = 3;
+const size_t k_max_run = 130;
+
+void Shuffle(const float* input, size_t area, std::vector<unsigned char>& planes)
+{
+	planes.resize(area * 4);
+	std::uint32_t previous = 0;
+	for (size_t i = 0; i < area; ++i)
+	{
+		std::uint32_t bits;
+		std::memcpy(&bits, input + i, 4);
+		std::uint32_t const delta = bits - previous;
+		previous = bits;
+		for (size_t b = 0; b < 4; ++b)
+		{
+			planes[b * area + i] = static_cast<unsigned char>(delta >> (8 * b));
+		}
+	}
+}
+
+void Unshuffle(const unsigned char* planes, size_t area, float* output)
+{
+	std::uint32_t previous = 0;
+	for (size_t i = 0; i < area; ++i)
+	{
+		std::uint32_t delta = 0;
+		for (size_t b = 0; b < 4; ++b)
+		{
+			delta |= static_cast<std::uint32_t>(planes[b * area + i]) << (8 * b);
+		}
+		previous += delta;
+		std::memcpy(output + i, &previous, 4);
+	}
+}
+
+/// Appends the encoded bytes to output, stops early and returns false if output would exceed max_size
+bool Pack(const std::vector<unsigned char>& input, size_t max_size, std::vector<unsigned char>& output)
+{
+	size_t const n = input.size();
+	size_t i = 0;
+	size_t literal_start = 0;
+
+	auto flush_literals = [&](size_t end) {
+		while (literal_start < end)
+		{
+			size_t const count = std::min(end - literal_start, k_max_literal);
+			output.push_back(static_cast<unsigned char>(count - 1));
+			output.insert(output.end(), input.begin() + literal_start, input.begin() + literal_start + count);
+			literal_start += count;
+		}
+	};
+
+	while (i < n)
+	{
+		size_t run = 1;
+		while (i + run < n && run < k_max_run && input[i + run] == input[i])
+			++run;
+
+		if (run >= k_min_run)
+		{
+			flush_literals(i);
+			output.push_back(static_cast<unsigned char>(128 + run - k_min_run));
+			output.push_back(input[i]);
+			i += run;
+			literal_start = i;
+		}
+		else
+		{
+			i += run;
+		}
+
+		if (output.size() >= max_size)
+			return false;
+	}
+	flush_literals(n);
+	return output.size() < max_size;
+}
+
+void Unpack(const unsigned char* input, size_t size, unsigned char* output, size_t output_size)
+{
+	const unsigned char* end = input + size;
+	unsigned char* out = output;
+	while (input < end)
+	{
+		unsigned const code = *input++;
+		if (code < 128)
+		{
+			size_t const count = code + 1;
+			std::memcpy(out, input, count);
+			input += count;
+			out += count;
+		}
+		else
+		{
+			size_t const count = code - 128 + k_min_run;
+			std::memset(out, *input++, count);
+			out += count;
+		}
+	}
+	assert(out == output + output_size);
+}
+} // namespace
+
+CompressedSlices::CompressedSlices(const std::vector<const float*>& slices, size_t area)
+{
+	Assign(slices, area);
+}
+
+void CompressedSlices::Assign(const std::vector<const float*>& slices, size_t area)
+{
+	m_Area = area;
+	m_Slices.assign(slices.size(), std::vector<unsigned char>());
+
+	std::int64_t const num_slices = slices.size();
+#pragma omp parallel
+	{
+		std::vector<unsigned char> planes;
+
+#pragma omp for
+		for (std::int64_t z = 0; z < num_slices; ++z)
+		{
+			auto& data = m_Slices[z];
+			size_t const raw_size = area * sizeof(float);
+			Shuffle(slices[z], area, planes);
+
+			data.reserve(raw_size / 4 + 1);
+			data.push_back(kPacked);
+			if (!Pack(planes, raw_size + 1, data))
+			{
+				data.resize(raw_size + 1);
+				data[0] = kRaw;
+				std::memcpy(data.data() + 1, slices[z], raw_size);
+			}
+			data.shrink_to_fit();
+		}
+	}
+}
+
+void CompressedSlices::Clear()
+{
+	m_Slices.clear();
+	m_Area = 0;
+}
+
+size_t CompressedSlices::CompressedSize() const
+{
+	size_t size = 0;
+	for (const auto& data : m_Slices)
+	{
+		size += data.size();
+	}
+	return size;
+}
+
+void CompressedSlices::Decompress(size_t slice, float* output) const
+{
+	const auto& data = m_Slices.at(slice);
+	if (data[0] == kRaw)
+	{
+		std::memcpy(output, data.data() + 1, m_Area * sizeof(float));
+	}
+	else
+	{
+		std::vector<unsigned char> planes(m_Area * 4);
+		Unpack(data.data() + 1, data.size() - 1, planes.data(), planes.size());
+		Unshuffle(planes.data(), m_Area, output);
+	}
+}
+
+void CompressedSlices::Decompress(const std::vector<float*>& output) const
+{
+	std::int64_t const num_slices = std::min(output.size(), m_Slices.size());
+#pragma omp parallel for
+	for (std::int64_t z = 0; z < num_slices; ++z)
+	{
+		Decompress(static_cast<size_t>(z), output[z]);
+	}
+}
+
+} // namespace iseg
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "iSegCore.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace iseg {
+
+/** \brief Lossless compressed copy of a stack of float slices.
+
+	Each slice is compressed independently, so single slices can be restored on demand.
+	The bit patterns are delta coded along the slice, split into byte planes (shuffle)
+	and run-length encoded. Slices which do not compress are stored as they are.
+*/
+class ISEG_CORE_API CompressedSlices
+{
+public:
+	CompressedSlices() = default;
+	CompressedSlices(const std::vector<const float*>& slices, size_t area);
+
+	/// Replace the content by a compressed copy of the slices
+	void Assign(const std::vector<const float*>& slices, size_t area);
+	void Clear();
+
+	bool Empty() const { return m_Slices.empty(); }
+	size_t NumSlices() const { return m_Slices.size(); }
+	size_t Area() const { return m_Area; }
+
+	/// Total size of the compressed data in bytes
+	size_t CompressedSize() const;
+
+	/// Restore one slice into a buffer of Area() floats
+	void Decompress(size_t slice, float* output) const;
+	/// Restore all slices, the output slices may be decompressed in parallel
+	void Decompress(const std::vector<float*>& output) const;
+
+private:
+	std::vector<std::vector<unsigned char>> m_Slices;
+	size_t m_Area = 0;
+};
+
+} // namespace iseg
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace iseg {
+
+/** \brief Connected component labeling of a stack of slices (one buffer per slice).
+
+	The volume is split into blocks of slices (or of rows for a single slice) which are
+	labeled in parallel with a union-find. The trees are merged across the block boundaries
+	and the components are numbered in the order of their first voxel. Labels are stored
+	with 32 bits if the volume has fewer than 2^32 voxels, else with 64 bits.
+
+	Neighboring foreground voxels are connected if they have the same value, or always if
+	values are not compared.
+*/
+template<typename T>
+class ConnectedComponents
+{
+public:
+	enum eConnectivity {
+		kFaces = 6,
+		kEdges = 18,
+		kVertices = 26
+	};
+
+	struct Component
+	{
+		/// value of the first voxel of the component
+		T m_Value;
+		std::uint64_t m_Volume;
+		std::array<unsigned, 3> m_Min;
+		std::array<unsigned, 3> m_Max;
+	};
+
+	/// label of voxels which are not part of any component
+	static const std::uint64_t k_background = std::numeric_limits<std::uint64_t>::max();
+
+	ConnectedComponents(const std::array<unsigned, 3>& dims, eConnectivity connectivity);
+
+	/// Label the regions of equal value, returns the number of components
+	size_t Compute(const std::vector<T*>& slices);
+
+	/// Label the voxels for which foreground(value) is true, returns the number of components
+	template<class TPredicate>
+	size_t Compute(const std::vector<T*>& slices, const TPredicate& foreground, bool compare_values = true);
+
+	size_t NumComponents() const { return m_Components.size(); }
+	const std::vector<Component>& Components() const { return m_Components; }
+
+	/// Component of the voxel x + width * (y + height * z), or k_background
+	std::uint64_t Label(size_t voxel) const;
+
+	/// Free the label image, the component statistics are kept
+	void ReleaseLabels();
+
+private:
+	template<typename TLabel, class TPredicate>
+	void Run(const std::vector<T*>& slices, const TPredicate& foreground, bool compare_values, std::vector<TLabel>& labels);
+
+	std::array<unsigned, 3> m_Dims;
+	eConnectivity m_Connectivity;
+	std::vector<std::uint32_t> m_Labels32;
+	std::vector<std::uint64_t> m_Labels64;
+	std::vector<Component> m_Components;
+};
+
+} // namespace iseg
+
+#include "ConnectedComponents.inl"
@@ -0,0 +1,356 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+
+namespace iseg {
+
+template<typename T>
+const std::uint64_t ConnectedComponents<T>::k_background;
+
+template<typename T>
+ConnectedComponents<T>::ConnectedComponents(const std::array<unsigned, 3>& dims, eConnectivity connectivity)
+		: m_Dims(dims), m_Connectivity(connectivity)
+{
+}
+
+template<typename T>
+size_t ConnectedComponents<T>::Compute(const std::vector<T*>& slices)
+{
+	return Compute(slices, [](T) { return true; }, true);
+}
+
+template<typename T>
+template<class TPredicate>
+size_t ConnectedComponents<T>::Compute(const std::vector<T*>& slices, const TPredicate& foreground, bool compare_values)
+{
+	ReleaseLabels();
+	m_Components.clear();
+
+	size_t const num_voxels = static_cast<size_t>(m_Dims[0]) * m_Dims[1] * m_Dims[2];
+	if (num_voxels == 0)
+		return 0;
+
+	if (num_voxels < std::numeric_limits<std::uint32_t>::max())
+		Run(slices, foreground, compare_values, m_Labels32);
+	else
+		Run(slices, foreground, compare_values, m_Labels64);
+	return m_Components.size();
+}
+
+template<typename T>
+std::uint64_t ConnectedComponents<T>::Label(size_t voxel) const
+{
+	if (!m_Labels32.empty())
+	{
+		auto const label = m_Labels32[voxel];
+		return label == std::numeric_limits<std::uint32_t>::max() ? k_background : label;
+	}
+	return m_Labels64[voxel];
+}
+
+template<typename T>
+void ConnectedComponents<T>::ReleaseLabels()
+{
+	std::vector<std::uint32_t>().swap(m_Labels32);
+	std::vector<std::uint64_t>().swap(m_Labels64);
+}
+
+template<typename T>
+template<typename TLabel, class TPredicate>
+void ConnectedComponents<T>::Run(const std::vector<T*>& slices, const TPredicate& foreground, bool compare_values, std::vector<TLabel>& labels)
+{
+	TLabel const background = std::numeric_limits<TLabel>::max();
+	size_t const width = m_Dims[0];
+	size_t const height = m_Dims[1];
+	size_t const depth = m_Dims[2];
+	size_t const area = width * height;
+	size_t const num_rows = height * depth;
+
+	// neighbors which come before a voxel in memory order
+	struct Neighbor
+	{
+		int dx, dy, dz;
+		std::int64_t offset;
+	};
+	std::vector<Neighbor> neighbors;
+	for (int dz = -1; dz <= 0; ++dz)
+	{
+		for (int dy = -1; dy <= 1; ++dy)
+		{
+			for (int dx = -1; dx <= 1; ++dx)
+			{
+				int const order = std::abs(dx) + std::abs(dy) + std::abs(dz);
+				bool const before = dz < 0 || (dz == 0 && (dy < 0 || (dy == 0 && dx < 0)));
+				bool const connected = (m_Connectivity == kFaces) ? order == 1 : (m_Connectivity == kEdges ? order <= 2 : true);
+				if (before && connected)
+				{
+					std::int64_t const offset = dx + static_cast<std::int64_t>(width) * (dy + static_cast<std::int64_t>(height) * dz);
+					neighbors.push_back(Neighbor{dx, dy, dz, offset});
+				}
+			}
+		}
+	}
+
+	// blocks of whole slices, which are connected through their first slice, or of rows for a single slice
+	size_t const block_rows = (depth > 1) ? height * std::max<size_t>(1, (depth + 63) / 64) : std::max<size_t>(16, (height + 63) / 64);
+	size_t const boundary_rows = (depth > 1) ? height : 1;
+	std::int64_t const num_blocks = (num_rows + block_rows - 1) / block_rows;
+
+	labels.assign(area * depth, background);
+	TLabel* parent = labels.data();
+
+	auto value = [&](size_t voxel) { return slices[voxel / area][voxel % area]; };
+
+	struct RowNeighbor
+	{
+		std::int64_t offset;
+		int dx;
+		const T* values;
+	};
+
+	// neighbors of the voxels in row r which lie in the rows [row_begin, row_end)
+	auto row_neighbors = [&](size_t r, size_t row_begin, size_t row_end, std::vector<RowNeighbor>& list) {
+		list.clear();
+		std::int64_t const y = r % height;
+		std::int64_t const z = r / height;
+		for (const auto& n : neighbors)
+		{
+			std::int64_t const ny = y + n.dy;
+			std::int64_t const nz = z + n.dz;
+			std::int64_t const nr = nz * static_cast<std::int64_t>(height) + ny;
+			if (ny < 0 || ny >= static_cast<std::int64_t>(height) || nz < 0 || nr < static_cast<std::int64_t>(row_begin) || nr >= static_cast<std::int64_t>(row_end))
+				continue;
+			list.push_back(RowNeighbor{n.offset, n.dx, slices[nz] + ny * width});
+		}
+	};
+
+	// the neighbor n of voxel v in column x is inside the image and connected to v
+	auto connected = [&](const RowNeighbor& n, size_t v, size_t x, T val, TLabel& u) {
+		std::int64_t const nx = static_cast<std::int64_t>(x) + n.dx;
+		if (nx < 0 || nx >= static_cast<std::int64_t>(width))
+			return false;
+		u = static_cast<TLabel>(v + n.offset);
+		return parent[u] != background && (!compare_values || n.values[nx] == val);
+	};
+
+	// label each block, the roots are the first voxel of each tree
+#pragma omp parallel for
+	for (std::int64_t b = 0; b < num_blocks; ++b)
+	{
+		size_t const r0 = b * block_rows;
+		size_t const r1 = std::min(r0 + block_rows, num_rows);
+		std::vector<RowNeighbor> list;
+
+		auto find = [parent](TLabel i) {
+			while (parent[i] != i)
+			{
+				parent[i] = parent[parent[i]];
+				i = parent[i];
+			}
+			return i;
+		};
+
+		for (size_t r = r0; r < r1; ++r)
+		{
+			row_neighbors(r, r0, r + 1, list);
+			const T* row = slices[r / height] + (r % height) * width;
+			size_t v = r * width;
+			for (size_t x = 0; x < width; ++x, ++v)
+			{
+				T const val = row[x];
+				if (!foreground(val))
+					continue;
+				// root of the tree containing v
+				TLabel a = static_cast<TLabel>(v);
+				parent[v] = a;
+				for (const auto& n : list)
+				{
+					TLabel u;
+					if (!connected(n, v, x, val, u))
+						continue;
+					TLabel const c = find(u);
+					if (a < c)
+					{
+						parent[c] = a;
+					}
+					else if (c < a)
+					{
+						parent[a] = c;
+						a = c;
+					}
+				}
+			}
+		}
+
+		// parents come before their children
+		for (size_t v = r0 * width; v < r1 * width; ++v)
+		{
+			if (parent[v] != background)
+				parent[v] = parent[parent[v]];
+		}
+	}
+
+	// merge the trees across the block boundaries
+	std::vector<TLabel> linked;
+	std::vector<RowNeighbor> list;
+	for (std::int64_t b = 1; b < num_blocks; ++b)
+	{
+		size_t const r0 = b * block_rows;
+		size_t const r1 = std::min(r0 + boundary_rows, num_rows);
+
+		// only the block roots are modified, the other voxels point directly to their block root
+		auto find = [parent](TLabel i) {
+			i = parent[i];
+			while (parent[i] != i)
+			{
+				parent[i] = parent[parent[i]];
+				i = parent[i];
+			}
+			return i;
+		};
+
+		// the pair of block roots which was merged last
+		TLabel last_v = background, last_u = background;
+		for (size_t r = r0; r < r1; ++r)
+		{
+			row_neighbors(r, 0, r0, list);
+			size_t v = r * width;
+			for (size_t x = 0; x < width; ++x, ++v)
+			{
+				if (parent[v] == background)
+					continue;
+				T const val = value(v);
+				for (const auto& n : list)
+				{
+					TLabel u;
+					if (!connected(n, v, x, val, u) || (parent[v] == last_v && parent[u] == last_u))
+						continue;
+					last_v = parent[v];
+					last_u = parent[u];
+
+					TLabel const a = find(static_cast<TLabel>(v));
+					TLabel const c = find(u);
+					if (a < c)
+					{
+						parent[c] = a;
+						linked.push_back(c);
+					}
+					else if (c < a)
+					{
+						parent[a] = c;
+						linked.push_back(a);
+					}
+				}
+			}
+		}
+	}
+
+	// point the merged block roots to the final roots
+	std::sort(linked.begin(), linked.end());
+	for (auto r : linked)
+	{
+		parent[r] = parent[parent[r]];
+	}
+
+	// point all voxels to the final roots, and collect the roots of each block
+	std::vector<std::vector<TLabel>> roots(num_blocks);
+#pragma omp parallel for
+	for (std::int64_t b = 0; b < num_blocks; ++b)
+	{
+		size_t const first = b * block_rows * width;
+		size_t const last = std::min((b + 1) * block_rows, num_rows) * width;
+		for (size_t v = first; v < last; ++v)
+		{
+			TLabel const p = parent[v];
+			if (p == background)
+				continue;
+			TLabel const q = parent[p];
+			if (q != p)
+				parent[v] = q;
+			else if (p == v)
+				roots[b].push_back(p);
+		}
+	}
+
+	std::vector<size_t> offsets(num_blocks + 1, 0);
+	for (std::int64_t b = 0; b < num_blocks; ++b)
+	{
+		offsets[b + 1] = offsets[b] + roots[b].size();
+	}
+
+	Component const empty = {T(), 0, {{std::numeric_limits<unsigned>::max(), std::numeric_limits<unsigned>::max(), std::numeric_limits<unsigned>::max()}}, {{0, 0, 0}}};
+	auto add = [](Component& c, unsigned x, unsigned y, unsigned z) {
+		c.m_Volume++;
+		c.m_Min[0] = std::min(c.m_Min[0], x);
+		c.m_Min[1] = std::min(c.m_Min[1], y);
+		c.m_Min[2] = std::min(c.m_Min[2], z);
+		c.m_Max[0] = std::max(c.m_Max[0], x);
+		c.m_Max[1] = std::max(c.m_Max[1], y);
+		c.m_Max[2] = std::max(c.m_Max[2], z);
+	};
+	auto merge = [](Component& c, const Component& other) {
+		c.m_Volume += other.m_Volume;
+		for (int k = 0; k < 3; ++k)
+		{
+			c.m_Min[k] = std::min(c.m_Min[k], other.m_Min[k]);
+			c.m_Max[k] = std::max(c.m_Max[k], other.m_Max[k]);
+		}
+	};
+
+	// replace the roots by consecutive labels and collect the statistics
+	m_Components.assign(offsets[num_blocks], empty);
+	std::vector<std::map<TLabel, Component>> foreign(num_blocks);
+#pragma omp parallel for
+	for (std::int64_t b = 0; b < num_blocks; ++b)
+	{
+		size_t const r0 = b * block_rows;
+		size_t const r1 = std::min(r0 + block_rows, num_rows);
+		TLabel const own_first = static_cast<TLabel>(offsets[b]);
+		TLabel const own_last = static_cast<TLabel>(offsets[b + 1]);
+
+		TLabel last_root = background, last_label = background;
+		Component* component = nullptr;
+		for (size_t r = r0; r < r1; ++r)
+		{
+			unsigned const z = static_cast<unsigned>(r / height);
+			unsigned const y = static_cast<unsigned>(r % height);
+			size_t v = r * width;
+			for (unsigned x = 0; x < width; ++x, ++v)
+			{
+				TLabel const root = parent[v];
+				if (root == background)
+					continue;
+				if (root != last_root)
+				{
+					size_t const rb = (root / width) / block_rows;
+					const auto& block_roots = roots[rb];
+					last_label = static_cast<TLabel>(offsets[rb] + (std::lower_bound(block_roots.begin(), block_roots.end(), root) - block_roots.begin()));
+					last_root = root;
+
+					// the statistics of components with the root voxel in another block are merged later
+					if (last_label >= own_first && last_label < own_last)
+						component = &m_Components[last_label];
+					else
+						component = &foreign[b].insert(std::make_pair(last_label, empty)).first->second;
+				}
+				parent[v] = last_label;
+
+				if (root == v)
+					component->m_Value = value(v);
+				add(*component, x, y, z);
+			}
+		}
+	}
+
+	for (const auto& block : foreign)
+	{
+		for (const auto& it : block)
+		{
+			merge(m_Components[it.first], it.second);
+		}
+	}
+}
+
+} // namespace iseg
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "DistanceTransform.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace iseg {
+
+namespace {
+const float k_infinity = std::numeric_limits<float>::infinity();
+
+/// Work arrays for the lower envelope of one line
+struct LineBuffer
+{
+	LineBuffer(unsigned n) : m_F(n), m_Nearest(n), m_Vertex(n), m_Range(n + 1) {}
+
+	std::vector<float> m_F;
+	std::vector<unsigned> m_Nearest;
+	std::vector<unsigned> m_Vertex;
+	std::vector<double> m_Range;
+};
+} // namespace
+
+DistanceTransform::DistanceTransform(const std::array<unsigned, 3>& dims, const std::array<float, 3>& spacing)
+		: m_Dims(dims), m_Spacing(spacing)
+{
+	m_Strides[0] = 1;
+	m_Strides[1] = m_Dims[0];
+	m_Strides[2] = static_cast<size_t>(m_Dims[0]) * m_Dims[1];
+	m_Size = m_Strides[2] * m_Dims[2];
+}
+
+void DistanceTransform::SquaredDistance(const unsigned char* seeds, float* sqdist, unsigned* nearest) const
+{
+	for (size_t i = 0; i < m_Size; ++i)
+	{
+		sqdist[i] = seeds[i] ? 0.f : k_infinity;
+	}
+	if (nearest)
+	{
+		for (size_t i = 0; i < m_Size; ++i)
+		{
+			nearest[i] = seeds[i] ? static_cast<unsigned>(i) : static_cast<unsigned>(m_Size);
+		}
+	}
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		if (m_Dims[axis] > 1)
+		{
+			Pass(axis, sqdist, nearest);
+		}
+	}
+}
+
+void DistanceTransform::Distance(const unsigned char* seeds, float* dist, unsigned* nearest) const
+{
+	SquaredDistance(seeds, dist, nearest);
+
+#pragma omp parallel for
+	for (std::int64_t i = 0; i < static_cast<std::int64_t>(m_Size); ++i)
+	{
+		dist[i] = std::sqrt(dist[i]);
+	}
+}
+
+void DistanceTransform::SignedDistance(const unsigned char* object, float* dist, unsigned* nearest) const
+{
+	std::vector<unsigned char> boundary(m_Size);
+	Boundary(object, boundary.data());
+	Distance(boundary.data(), dist, nearest);
+
+	for (size_t i = 0; i < m_Size; ++i)
+	{
+		if (!object[i])
+			dist[i] = -dist[i];
+	}
+}
+
+void DistanceTransform::Boundary(const unsigned char* object, unsigned char* boundary) const
+{
+#pragma omp parallel for
+	for (std::int64_t z = 0; z < static_cast<std::int64_t>(m_Dims[2]); ++z)
+	{
+		size_t idx = z * m_Strides[2];
+		for (unsigned y = 0; y < m_Dims[1]; ++y)
+		{
+			for (unsigned x = 0; x < m_Dims[0]; ++x, ++idx)
+			{
+				if (!object[idx])
+				{
+					boundary[idx] = 0;
+					continue;
+				}
+
+				// in 2D the slice is not bounded in z
+				bool const at_border = x == 0 || x + 1 == m_Dims[0] || y == 0 || y + 1 == m_Dims[1] ||
+															 (m_Dims[2] > 1 && (z == 0 || z + 1 == m_Dims[2]));
+				boundary[idx] = at_border ||
+												!object[idx - 1] || !object[idx + 1] ||
+												!object[idx - m_Strides[1]] || !object[idx + m_Strides[1]] ||
+												(m_Dims[2] > 1 && (!object[idx - m_Strides[2]] || !object[idx + m_Strides[2]]));
+			}
+		}
+	}
+}
+
+void DistanceTransform::Pass(int axis, float* sqdist, unsigned* nearest) const
+{
+	unsigned const n = m_Dims[axis];
+	size_t const stride = m_Strides[axis];
+	double const h = m_Spacing[axis];
+	std::int64_t const num_lines = static_cast<std::int64_t>(m_Size / n);
+
+#pragma omp parallel
+	{
+		LineBuffer buffer(n);
+		auto& f = buffer.m_F;
+		auto& v = buffer.m_Vertex;
+		auto& z = buffer.m_Range;
+
+#pragma omp for
+		for (std::int64_t line = 0; line < num_lines; ++line)
+		{
+			size_t const start = (line / stride) * stride * n + (line % stride);
+
+			for (unsigned q = 0; q < n; ++q)
+			{
+				f[q] = sqdist[start + q * stride];
+			}
+			if (nearest)
+			{
+				for (unsigned q = 0; q < n; ++q)
+				{
+					buffer.m_Nearest[q] = nearest[start + q * stride];
+				}
+			}
+
+			// lower envelope of the parabolas rooted at the finite samples
+			int k = -1;
+			for (unsigned q = 0; q < n; ++q)
+			{
+				if (f[q] == k_infinity)
+					continue;
+
+				if (k < 0)
+				{
+					k = 0;
+					v[0] = q;
+					z[0] = -std::numeric_limits<double>::infinity();
+					z[1] = std::numeric_limits<double>::infinity();
+					continue;
+				}
+
+				double const xq = q * h;
+				double s;
+				for (;;)
+				{
+					double const xp = v[k] * h;
+					s = ((f[q] + xq * xq) - (f[v[k]] + xp * xp)) / (2.0 * (xq - xp));
+					if (s > z[k])
+						break;
+					--k;
+				}
+				++k;
+				v[k] = q;
+				z[k] = s;
+				z[k + 1] = std::numeric_limits<double>::infinity();
+			}
+
+			// no seed projects onto this line
+			if (k < 0)
+				continue;
+
+			k = 0;
+			for (unsigned q = 0; q < n; ++q)
+			{
+				double const xq = q * h;
+				while (z[k + 1] < xq)
+				{
+					++k;
+				}
+				double const d = xq - v[k] * h;
+				sqdist[start + q * stride] = static_cast<float>(d * d + f[v[k]]);
+				if (nearest)
+				{
+					nearest[start + q * stride] = buffer.m_Nearest[v[k]];
+				}
+			}
+		}
+	}
+}
+
+} // namespace iseg
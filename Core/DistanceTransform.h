@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "iSegCore.h"
+
+#include <array>
+#include <cstddef>
+
+namespace iseg {
+
+/** \brief Exact Euclidean distance transform in 2D (dims[2] == 1) or 3D.
+
+	The squared distance is computed by separable passes along x, y and z, each of which
+	computes the lower envelope of parabolas in linear time (Felzenszwalb & Huttenlocher).
+	The lines of a pass are processed in parallel. The spacing may be anisotropic.
+
+	Optionally the feature transform is computed, i.e. for each voxel the index of the
+	nearest seed. If there are no seeds, the distance is infinity and the index is the
+	number of voxels.
+*/
+class ISEG_CORE_API DistanceTransform
+{
+public:
+	DistanceTransform(const std::array<unsigned, 3>& dims, const std::array<float, 3>& spacing = {1.f, 1.f, 1.f});
+
+	size_t Size() const { return m_Size; }
+
+	/// Squared distance to the nearest voxel where 'seeds' is non-zero
+	void SquaredDistance(const unsigned char* seeds, float* sqdist, unsigned* nearest = nullptr) const;
+
+	/// Distance to the nearest voxel where 'seeds' is non-zero
+	void Distance(const unsigned char* seeds, float* dist, unsigned* nearest = nullptr) const;
+
+	/// Distance to the boundary of the object, positive inside and negative outside
+	void SignedDistance(const unsigned char* object, float* dist, unsigned* nearest = nullptr) const;
+
+	/// Object voxels with a face neighbor outside the object, the image border counts as outside
+	void Boundary(const unsigned char* object, unsigned char* boundary) const;
+
+private:
+	void Pass(int axis, float* sqdist, unsigned* nearest) const;
+
+	std::array<unsigned, 3> m_Dims;
+	std::array<float, 3> m_Spacing;
+	std::array<size_t, 3> m_Strides;
+	size_t m_Size;
+};
+
+} // namespace iseg
@@ -13,6 +13,7 @@
 
 #include <hdf5.h>
 
+#include <algorithm>
 #include <sstream>
 
 namespace iseg {
@@ -75,6 +76,77 @@ bool HDF5IO::Close(handle_id_type file)
 	return true;
 }
 
+size_t HDF5IO::RawChunkCopySize(handle_id_type src_dataset, handle_id_type dst_dataset)
+{
+#if H5_VERSION_GE(1, 10, 3)
+	size_t chunk_size = 0;
+
+	hid_t src_type = H5Dget_type(src_dataset);
+	hid_t dst_type = H5Dget_type(dst_dataset);
+	hid_t src_plist = H5Dget_create_plist(src_dataset);
+	hid_t dst_plist = H5Dget_create_plist(dst_dataset);
+
+	if (H5Tequal(src_type, dst_type) > 0 &&
+			H5Pget_layout(src_plist) == H5D_CHUNKED && H5Pget_layout(dst_plist) == H5D_CHUNKED)
+	{
+		hsize_t src_chunk[1] = {0}, dst_chunk[1] = {0};
+		bool same = H5Pget_chunk(src_plist, 1, src_chunk) == 1 &&
+								H5Pget_chunk(dst_plist, 1, dst_chunk) == 1 &&
+								src_chunk[0] == dst_chunk[0];
+
+		// the filter pipelines, including their parameters, must be identical
+		int const num_filters = H5Pget_nfilters(src_plist);
+		same = same && (num_filters == H5Pget_nfilters(dst_plist));
+		for (int i = 0; same && i < num_filters; ++i)
+		{
+			unsigned int src_flags = 0, dst_flags = 0, config = 0;
+			unsigned int src_cd[16], dst_cd[16];
+			size_t src_n = 16, dst_n = 16;
+			H5Z_filter_t src_id = H5Pget_filter2(src_plist, i, &src_flags, &src_n, src_cd, 0, nullptr, &config);
+			H5Z_filter_t dst_id = H5Pget_filter2(dst_plist, i, &dst_flags, &dst_n, dst_cd, 0, nullptr, &config);
+			same = (src_id == dst_id && src_n == dst_n && std::equal(src_cd, src_cd + std::min<size_t>(src_n, 16), dst_cd));
+		}
+
+		if (same)
+		{
+			chunk_size = static_cast<size_t>(src_chunk[0]);
+		}
+	}
+
+	H5Pclose(src_plist);
+	H5Pclose(dst_plist);
+	H5Tclose(src_type);
+	H5Tclose(dst_type);
+
+	return chunk_size;
+#else
+	return 0;
+#endif
+}
+
+bool HDF5IO::CopyRawChunk(handle_id_type src_dataset, size_t src_offset, handle_id_type dst_dataset, size_t dst_offset, std::vector<char>& buffer)
+{
+#if H5_VERSION_GE(1, 10, 3)
+	hsize_t src_start[1] = {src_offset};
+	hsize_t dst_start[1] = {dst_offset};
+	hsize_t num_bytes = 0;
+	if (H5Dget_chunk_storage_size(src_dataset, src_start, &num_bytes) < 0 || num_bytes == 0)
+	{
+		return false;
+	}
+
+	buffer.resize(num_bytes);
+	uint32_t filter_mask = 0;
+	if (H5Dread_chunk(src_dataset, H5P_DEFAULT, src_start, &filter_mask, buffer.data()) < 0)
+	{
+		return false;
+	}
+	return H5Dwrite_chunk(dst_dataset, H5P_DEFAULT, filter_mask, dst_start, num_bytes, buffer.data()) >= 0;
+#else
+	return false;
+#endif
+}
+
 std::string HDF5IO::DumpErrorStack()
 {
 	std::stringstream ss;
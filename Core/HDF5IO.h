@@ -20,6 +20,7 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 namespace iseg {
 
@@ -49,9 +50,24 @@ public:
 	template<typename T>
 	bool WriteData(handle_id_type file_id, const std::string& name, T** const slice_data, size_t num_slices, size_t slice_size, size_t offset = 0);
 
+	/// Copy 'length' elements of a 1D dataset into an existing 1D dataset (possibly in another file).
+	/// Chunks are copied without decompression if data type, chunk size and filters match,
+	/// the rest is streamed through a buffer of at most 'max_buffer_size' bytes.
+	template<typename T>
+	bool CopyData(handle_id_type src_file, const std::string& src_name, size_t src_offset, size_t length, handle_id_type dst_file, const std::string& dst_name, size_t dst_offset, size_t max_buffer_size = 256 * 1024 * 1024);
+
+	/// Fill 'length' elements of an existing 1D dataset with 'value', using bounded memory.
+	template<typename T>
+	bool FillData(handle_id_type file_id, const std::string& name, size_t offset, size_t length, T value, size_t max_buffer_size = 256 * 1024 * 1024);
+
 	static std::string DumpErrorStack();
 
 protected:
+	/// Returns the chunk size if chunks of the two datasets can be copied as raw bytes, else 0.
+	static size_t RawChunkCopySize(handle_id_type src_dataset, handle_id_type dst_dataset);
+	/// Copy a single compressed chunk. Returns false if the source chunk is not allocated.
+	static bool CopyRawChunk(handle_id_type src_dataset, size_t src_offset, handle_id_type dst_dataset, size_t dst_offset, std::vector<char>& buffer);
+
 	int m_CompressionLevel;
 };
 
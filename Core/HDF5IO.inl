@@ -1,5 +1,7 @@
 #include "HDF5IO.h"
 
+#include <algorithm>
+
 namespace iseg {
 
 template<typename T>
@@ -218,4 +220,110 @@ bool HDF5IO::WriteData(handle_id_type file, const std::string& name, T** const s
 	return (status >= 0);
 }
 
+template<typename T>
+bool HDF5IO::CopyData(handle_id_type src_file, const std::string& src_name, size_t src_offset, size_t length, handle_id_type dst_file, const std::string& dst_name, size_t dst_offset, size_t max_buffer_size)
+{
+	hid_t src_dataset = H5Dopen2(src_file, src_name.c_str(), H5P_DEFAULT);
+	if (src_dataset < 0)
+	{
+		return false;
+	}
+	hid_t dst_dataset = H5Dopen2(dst_file, dst_name.c_str(), H5P_DEFAULT);
+	if (dst_dataset < 0)
+	{
+		H5Dclose(src_dataset);
+		return false;
+	}
+
+	hid_t src_space = H5Dget_space(src_dataset);
+	hid_t dst_space = H5Dget_space(dst_dataset);
+
+	bool ok = (H5Sget_simple_extent_ndims(src_space) == 1 && H5Sget_simple_extent_ndims(dst_space) == 1);
+	hsize_t src_extent[1] = {0}, dst_extent[1] = {0};
+	if (ok)
+	{
+		H5Sget_simple_extent_dims(src_space, src_extent, nullptr);
+		H5Sget_simple_extent_dims(dst_space, dst_extent, nullptr);
+		ok = (src_offset + length <= src_extent[0] && dst_offset + length <= dst_extent[0]);
+	}
+
+	// copy complete chunks as they are stored in the file, i.e. without decompressing them
+	size_t pos = 0;
+	size_t const chunk = ok ? RawChunkCopySize(src_dataset, dst_dataset) : 0;
+	if (chunk > 0 && src_offset % chunk == 0 && dst_offset % chunk == 0)
+	{
+		std::vector<char> raw_buffer;
+		for (; pos + chunk <= length; pos += chunk)
+		{
+			if (!CopyRawChunk(src_dataset, src_offset + pos, dst_dataset, dst_offset + pos, raw_buffer))
+			{
+				break;
+			}
+		}
+	}
+
+	// stream remaining data through a bounded buffer, HDF5 converts the data type if needed
+	if (ok && pos < length)
+	{
+		size_t slab = std::max<size_t>(max_buffer_size / sizeof(T), 1);
+		if (chunk > 0 && slab > chunk)
+		{
+			slab -= slab % chunk;
+		}
+		std::vector<T> buffer(std::min(slab, length - pos));
+
+		for (; ok && pos < length; pos += slab)
+		{
+			hsize_t count[1] = {std::min(slab, length - pos)};
+			hsize_t src_start[1] = {src_offset + pos};
+			hsize_t dst_start[1] = {dst_offset + pos};
+
+			hid_t memspace = H5Screate_simple(1, count, nullptr);
+			ok = H5Sselect_hyperslab(src_space, H5S_SELECT_SET, src_start, nullptr, count, nullptr) >= 0 &&
+					 H5Dread(src_dataset, GetTypeValue<T>(), memspace, src_space, H5P_DEFAULT, buffer.data()) >= 0 &&
+					 H5Sselect_hyperslab(dst_space, H5S_SELECT_SET, dst_start, nullptr, count, nullptr) >= 0 &&
+					 H5Dwrite(dst_dataset, GetTypeValue<T>(), memspace, dst_space, H5P_DEFAULT, buffer.data()) >= 0;
+			H5Sclose(memspace);
+		}
+	}
+
+	H5Sclose(src_space);
+	H5Sclose(dst_space);
+	H5Dclose(src_dataset);
+	H5Dclose(dst_dataset);
+
+	return ok;
+}
+
+template<typename T>
+bool HDF5IO::FillData(handle_id_type file, const std::string& name, size_t offset, size_t length, T value, size_t max_buffer_size)
+{
+	hid_t dataset = H5Dopen2(file, name.c_str(), H5P_DEFAULT);
+	if (dataset < 0)
+	{
+		return false;
+	}
+	hid_t dataspace = H5Dget_space(dataset);
+
+	size_t const slab = std::max<size_t>(max_buffer_size / sizeof(T), 1);
+	std::vector<T> buffer(std::min(slab, length), value);
+
+	bool ok = true;
+	for (size_t pos = 0; ok && pos < length; pos += slab)
+	{
+		hsize_t count[1] = {std::min(slab, length - pos)};
+		hsize_t start[1] = {offset + pos};
+
+		hid_t memspace = H5Screate_simple(1, count, nullptr);
+		ok = H5Sselect_hyperslab(dataspace, H5S_SELECT_SET, start, nullptr, count, nullptr) >= 0 &&
+				 H5Dwrite(dataset, GetTypeValue<T>(), memspace, dataspace, H5P_DEFAULT, buffer.data()) >= 0;
+		H5Sclose(memspace);
+	}
+
+	H5Sclose(dataspace);
+	H5Dclose(dataset);
+
+	return ok;
+}
+
 } // namespace iseg
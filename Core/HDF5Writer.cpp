@@ -129,6 +129,19 @@ int HDF5Writer::Flush()
 	return 1;
 }
 
+int HDF5Writer::Remove(const std::string& name)
+{
+	if (m_File < 0)
+	{
+		return 0;
+	}
+	if (H5Lexists(m_File, name.c_str(), H5P_DEFAULT) <= 0)
+	{
+		return 1;
+	}
+	return H5Ldelete(m_File, name.c_str(), H5P_DEFAULT) < 0 ? 0 : 1;
+}
+
 int HDF5Writer::Close()
 {
 	if (m_File >= 0)
@@ -48,6 +48,8 @@ public:
 	int Write(float** const slices, size_type num_slices, size_type slice_size, const std::string& name, size_t offset = 0);
 	int Write(unsigned short** const slices, size_type num_slices, size_type slice_size, const std::string& name, size_t offset = 0);
 	int Flush();
+	/// Unlink a dataset or group, succeeds if it does not exist
+	int Remove(const std::string&);
 
 	int m_Compression;
 	bool m_Loud;
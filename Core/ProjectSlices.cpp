@@ -0,0 +1,348 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "ProjectSlices.h"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace iseg {
+
+namespace {
+const char magic[4] = {'i', 'S', 'P', 'S'};
+// version 1: initial layout
+const std::int32_t container_version = 1;
+
+struct BlockHeader
+{
+	std::uint16_t width;
+	std::uint16_t height;
+	std::uint8_t mode1;
+	std::uint8_t mode2;
+	std::uint16_t reserved;
+	std::uint32_t num_marks;
+	std::uint32_t num_name_chars;
+	std::uint32_t num_vvm;
+	std::uint32_t num_vvm_points;
+	std::uint32_t num_limits;
+	std::uint32_t num_limit_points;
+};
+
+struct TocEntry
+{
+	std::uint64_t offset;
+	std::uint64_t size;
+};
+
+class BlockWriter
+{
+public:
+	explicit BlockWriter(std::vector<char>& buffer) : m_Buffer(buffer) {}
+
+	template<typename T>
+	void Put(const T& v)
+	{
+		auto pos = m_Buffer.size();
+		m_Buffer.resize(pos + sizeof(T));
+		std::memcpy(&m_Buffer[pos], &v, sizeof(T));
+	}
+
+	void Put(const char* data, size_t n)
+	{
+		m_Buffer.insert(m_Buffer.end(), data, data + n);
+	}
+
+private:
+	std::vector<char>& m_Buffer;
+};
+
+class BlockReader
+{
+public:
+	BlockReader(const std::vector<char>& buffer) : m_Buffer(buffer) {}
+
+	template<typename T>
+	bool Get(T& v)
+	{
+		if (m_Pos + sizeof(T) > m_Buffer.size())
+			return false;
+		std::memcpy(&v, &m_Buffer[m_Pos], sizeof(T));
+		m_Pos += sizeof(T);
+		return true;
+	}
+
+	bool Get(std::string& s, size_t n)
+	{
+		if (m_Pos + n > m_Buffer.size())
+			return false;
+		s.assign(m_Buffer.data() + m_Pos, n);
+		m_Pos += n;
+		return true;
+	}
+
+private:
+	const std::vector<char>& m_Buffer;
+	size_t m_Pos = 0;
+};
+
+void PutPoint(BlockWriter& w, const Point& p)
+{
+	w.Put<std::int16_t>(p.px);
+	w.Put<std::int16_t>(p.py);
+}
+
+bool GetPoint(BlockReader& r, Point& p)
+{
+	std::int16_t px, py;
+	if (!r.Get(px) || !r.Get(py))
+		return false;
+	p.px = px;
+	p.py = py;
+	return true;
+}
+
+// number of bytes between the current position and the end of the file
+bool RemainingSize(FILE* fp, std::uint64_t& remaining)
+{
+	long const pos = ftell(fp);
+	if (pos < 0 || fseek(fp, 0, SEEK_END) != 0)
+		return false;
+	long const end = ftell(fp);
+	if (end < pos || fseek(fp, pos, SEEK_SET) != 0)
+		return false;
+	remaining = static_cast<std::uint64_t>(end - pos);
+	return true;
+}
+} // namespace
+
+void ProjectSlices::Encode(size_t idx, const SliceAnnotations& slice)
+{
+	BlockHeader header;
+	header.width = slice.m_Width;
+	header.height = slice.m_Height;
+	header.mode1 = slice.m_Mode1;
+	header.mode2 = slice.m_Mode2;
+	header.reserved = 0;
+	header.num_marks = static_cast<std::uint32_t>(slice.m_Marks.size());
+	header.num_name_chars = 0;
+	for (const auto& m : slice.m_Marks)
+	{
+		header.num_name_chars += static_cast<std::uint32_t>(m.name.size());
+	}
+	header.num_vvm = static_cast<std::uint32_t>(slice.m_Vvm.size());
+	header.num_vvm_points = 0;
+	for (const auto& v : slice.m_Vvm)
+	{
+		header.num_vvm_points += static_cast<std::uint32_t>(v.size());
+	}
+	header.num_limits = static_cast<std::uint32_t>(slice.m_Limits.size());
+	header.num_limit_points = 0;
+	for (const auto& l : slice.m_Limits)
+	{
+		header.num_limit_points += static_cast<std::uint32_t>(l.size());
+	}
+
+	auto& block = m_Blocks.at(idx);
+	block.clear();
+	block.reserve(sizeof(BlockHeader) +
+								header.num_marks * 12 + header.num_name_chars +
+								header.num_vvm * 4 + header.num_vvm_points * 8 +
+								header.num_limits * 4 + header.num_limit_points * 4);
+	BlockWriter w(block);
+	w.Put(header);
+
+	// marks: points, labels, name lengths, name characters
+	for (const auto& m : slice.m_Marks)
+		PutPoint(w, m.p);
+	for (const auto& m : slice.m_Marks)
+		w.Put<std::uint32_t>(m.mark);
+	for (const auto& m : slice.m_Marks)
+		w.Put<std::uint32_t>(static_cast<std::uint32_t>(m.name.size()));
+	for (const auto& m : slice.m_Marks)
+		w.Put(m.name.data(), m.name.size());
+
+	// vvm: sizes, points, labels
+	for (const auto& v : slice.m_Vvm)
+		w.Put<std::uint32_t>(static_cast<std::uint32_t>(v.size()));
+	for (const auto& v : slice.m_Vvm)
+		for (const auto& m : v)
+			PutPoint(w, m.p);
+	for (const auto& v : slice.m_Vvm)
+		for (const auto& m : v)
+			w.Put<std::uint32_t>(m.mark);
+
+	// limits: sizes, points
+	for (const auto& l : slice.m_Limits)
+		w.Put<std::uint32_t>(static_cast<std::uint32_t>(l.size()));
+	for (const auto& l : slice.m_Limits)
+		for (const auto& p : l)
+			PutPoint(w, p);
+}
+
+bool ProjectSlices::Decode(size_t idx, SliceAnnotations& slice) const
+{
+	if (idx >= m_Blocks.size())
+		return false;
+
+	BlockReader r(m_Blocks[idx]);
+	BlockHeader header;
+	if (!r.Get(header))
+		return false;
+	// reject counts which cannot fit into the block before allocating anything
+	size_t const payload = m_Blocks[idx].size() - sizeof(BlockHeader);
+	if (size_t(header.num_marks) * 12 + header.num_name_chars > payload ||
+			size_t(header.num_vvm) * 4 + size_t(header.num_vvm_points) * 8 > payload ||
+			size_t(header.num_limits) * 4 + size_t(header.num_limit_points) * 4 > payload)
+		return false;
+
+	slice.m_Width = header.width;
+	slice.m_Height = header.height;
+	slice.m_Mode1 = header.mode1;
+	slice.m_Mode2 = header.mode2;
+
+	bool ok = true;
+	slice.m_Marks.resize(header.num_marks);
+	for (auto& m : slice.m_Marks)
+		ok = ok && GetPoint(r, m.p);
+	for (auto& m : slice.m_Marks)
+		ok = ok && r.Get(m.mark);
+	std::vector<std::uint32_t> name_sizes(header.num_marks, 0);
+	for (auto& n : name_sizes)
+		ok = ok && r.Get(n);
+	for (size_t i = 0; ok && i < name_sizes.size(); ++i)
+		ok = r.Get(slice.m_Marks[i].name, name_sizes[i]);
+
+	std::vector<std::uint32_t> sizes(header.num_vvm, 0);
+	for (auto& n : sizes)
+		ok = ok && r.Get(n);
+	slice.m_Vvm.resize(header.num_vvm);
+	std::uint32_t total = 0;
+	for (size_t i = 0; ok && i < sizes.size(); ++i)
+	{
+		total += sizes[i];
+		ok = (total <= header.num_vvm_points);
+		if (ok)
+			slice.m_Vvm[i].resize(sizes[i]);
+	}
+	for (auto& v : slice.m_Vvm)
+		for (auto& m : v)
+			ok = ok && GetPoint(r, m.p);
+	for (auto& v : slice.m_Vvm)
+		for (auto& m : v)
+			ok = ok && r.Get(m.mark);
+
+	sizes.assign(header.num_limits, 0);
+	for (auto& n : sizes)
+		ok = ok && r.Get(n);
+	slice.m_Limits.resize(header.num_limits);
+	total = 0;
+	for (size_t i = 0; ok && i < sizes.size(); ++i)
+	{
+		total += sizes[i];
+		ok = (total <= header.num_limit_points);
+		if (ok)
+			slice.m_Limits[i].resize(sizes[i]);
+	}
+	for (auto& l : slice.m_Limits)
+		for (auto& p : l)
+			ok = ok && GetPoint(r, p);
+
+	return ok;
+}
+
+void ProjectSlices::Append(const ProjectSlices& other, size_t first, size_t count)
+{
+	m_Blocks.insert(m_Blocks.end(), other.m_Blocks.begin() + first, other.m_Blocks.begin() + first + count);
+}
+
+bool ProjectSlices::Write(FILE* fp) const
+{
+	std::vector<TocEntry> toc(m_Blocks.size());
+	std::uint64_t offset = 0;
+	for (size_t i = 0; i < m_Blocks.size(); ++i)
+	{
+		toc[i].offset = offset;
+		toc[i].size = m_Blocks[i].size();
+		offset += toc[i].size;
+	}
+
+	std::uint64_t const num_slices = m_Blocks.size();
+	bool ok = fwrite(magic, sizeof(magic), 1, fp) == 1;
+	ok = ok && fwrite(&container_version, sizeof(container_version), 1, fp) == 1;
+	ok = ok && fwrite(&num_slices, sizeof(num_slices), 1, fp) == 1;
+	ok = ok && fwrite(&offset, sizeof(offset), 1, fp) == 1;
+	if (!toc.empty())
+	{
+		ok = ok && fwrite(toc.data(), sizeof(TocEntry), toc.size(), fp) == toc.size();
+	}
+	for (const auto& block : m_Blocks)
+	{
+		if (!block.empty())
+		{
+			ok = ok && fwrite(block.data(), 1, block.size(), fp) == block.size();
+		}
+	}
+	return ok;
+}
+
+bool ProjectSlices::Read(FILE* fp)
+{
+	m_Blocks.clear();
+
+	char file_magic[4];
+	std::int32_t version = 0;
+	std::uint64_t num_slices = 0, data_size = 0;
+	if (fread(file_magic, sizeof(file_magic), 1, fp) != 1 ||
+			std::memcmp(file_magic, magic, sizeof(magic)) != 0 ||
+			fread(&version, sizeof(version), 1, fp) != 1 ||
+			version > container_version ||
+			fread(&num_slices, sizeof(num_slices), 1, fp) != 1 ||
+			num_slices > std::numeric_limits<unsigned short>::max() ||
+			fread(&data_size, sizeof(data_size), 1, fp) != 1)
+	{
+		return false;
+	}
+
+	std::vector<TocEntry> toc(num_slices);
+	if (!toc.empty() && fread(toc.data(), sizeof(TocEntry), toc.size(), fp) != toc.size())
+	{
+		return false;
+	}
+
+	// the size is stored in the file, do not allocate more than the file can contain
+	std::uint64_t remaining = 0;
+	if (!RemainingSize(fp, remaining) || data_size > remaining)
+	{
+		return false;
+	}
+
+	// read all blocks at once, then split them using the table of contents
+	std::vector<char> data(data_size);
+	if (!data.empty() && fread(data.data(), 1, data.size(), fp) != data.size())
+	{
+		return false;
+	}
+
+	m_Blocks.resize(num_slices);
+	for (size_t i = 0; i < toc.size(); ++i)
+	{
+		if (toc[i].offset > data_size || toc[i].size > data_size - toc[i].offset)
+		{
+			m_Blocks.clear();
+			return false;
+		}
+		m_Blocks[i].assign(data.begin() + toc[i].offset, data.begin() + toc[i].offset + toc[i].size);
+	}
+	return true;
+}
+
+} // namespace iseg
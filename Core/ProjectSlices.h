@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "iSegCore.h"
+
+#include "Data/Mark.h"
+#include "Data/Point.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace iseg {
+
+/// Per-slice data stored in a project file besides the images (marks, vvm, limits, modes)
+struct SliceAnnotations
+{
+	unsigned short m_Width = 0;
+	unsigned short m_Height = 0;
+	std::vector<Mark> m_Marks;
+	std::vector<std::vector<Mark>> m_Vvm;
+	std::vector<std::vector<Point>> m_Limits;
+	unsigned char m_Mode1 = 1;
+	unsigned char m_Mode2 = 2;
+};
+
+/** \brief Versioned container for the slice annotations of a project.
+
+	Each slice is encoded into its own block, in which the marks, vvm and limits are stored
+	as contiguous columns (points, labels, sizes, names). The file layout is
+
+		header:	magic, container version, number of slices, size of the data section
+		toc:		offset and size of each slice block (relative to the data section)
+		data:		the slice blocks
+
+	so the whole container is read/written with a few bulk calls, and single slices can be
+	decoded, replaced or copied into another container without touching the others.
+*/
+class ISEG_CORE_API ProjectSlices
+{
+public:
+	size_t Size() const { return m_Blocks.size(); }
+	void Resize(size_t n) { m_Blocks.resize(n); }
+	void Clear() { m_Blocks.clear(); }
+
+	/// Encode 'slice' into block 'idx'
+	void Encode(size_t idx, const SliceAnnotations& slice);
+	/// Decode block 'idx', returns false if the block is corrupt
+	bool Decode(size_t idx, SliceAnnotations& slice) const;
+
+	/// Append 'count' blocks of 'other' starting at 'first', without decoding them
+	void Append(const ProjectSlices& other, size_t first, size_t count);
+
+	bool Write(FILE* fp) const;
+	bool Read(FILE* fp);
+
+private:
+	std::vector<std::vector<char>> m_Blocks;
+};
+
+} // namespace iseg
@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "RankFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace iseg {
+
+namespace {
+const unsigned k_max_bins = 1u << 16;
+
+inline size_t RankIndex(float percentile, size_t n)
+{
+	double const r = std::floor(percentile / 100.0 * (n - 1) + 0.5);
+	return static_cast<size_t>(std::min(std::max(r, 0.0), static_cast<double>(n - 1)));
+}
+
+inline void Sort2(float& a, float& b)
+{
+	float const t = std::min(a, b);
+	b = std::max(a, b);
+	a = t;
+}
+
+/// Median of nine values with 19 compare-exchange operations, without branches
+inline float Median9(float p0, float p1, float p2, float p3, float p4, float p5, float p6, float p7, float p8)
+{
+	Sort2(p1, p2);
+	Sort2(p4, p5);
+	Sort2(p7, p8);
+	Sort2(p0, p1);
+	Sort2(p3, p4);
+	Sort2(p6, p7);
+	Sort2(p1, p2);
+	Sort2(p4, p5);
+	Sort2(p7, p8);
+	Sort2(p0, p3);
+	Sort2(p5, p8);
+	Sort2(p4, p7);
+	Sort2(p3, p6);
+	Sort2(p1, p4);
+	Sort2(p2, p5);
+	Sort2(p4, p7);
+	Sort2(p4, p2);
+	Sort2(p6, p4);
+	Sort2(p4, p2);
+	return p4;
+}
+
+/// True if all values are integers spanning less than k_max_bins values
+bool IsQuantized(const std::vector<const float*>& input, size_t area, float& offset, unsigned& bins)
+{
+	float lo = input.front()[0];
+	float hi = lo;
+	for (auto slice : input)
+	{
+		for (size_t i = 0; i < area; ++i)
+		{
+			float const v = slice[i];
+			if (!(v == std::floor(v)))
+				return false;
+			lo = std::min(lo, v);
+			hi = std::max(hi, v);
+		}
+	}
+	if (hi - lo >= k_max_bins)
+		return false;
+
+	offset = lo;
+	bins = static_cast<unsigned>(hi - lo) + 1;
+	return true;
+}
+
+struct Range
+{
+	Range(unsigned i, unsigned radius, unsigned n)
+			: m_Lo(i >= radius ? i - radius : 0), m_Hi(std::min(i + radius, n - 1)) {}
+
+	unsigned Size() const { return m_Hi - m_Lo + 1; }
+
+	unsigned m_Lo;
+	unsigned m_Hi;
+};
+
+float SelectRank(const std::vector<const float*>& input, unsigned width, const Range& rx, const Range& ry, const Range& rz, float percentile, std::vector<float>& buffer)
+{
+	buffer.clear();
+	for (unsigned z = rz.m_Lo; z <= rz.m_Hi; ++z)
+	{
+		for (unsigned y = ry.m_Lo; y <= ry.m_Hi; ++y)
+		{
+			const float* row = input[z] + static_cast<size_t>(y) * width;
+			buffer.insert(buffer.end(), row + rx.m_Lo, row + rx.m_Hi + 1);
+		}
+	}
+	auto nth = buffer.begin() + RankIndex(percentile, buffer.size());
+	std::nth_element(buffer.begin(), nth, buffer.end());
+	return *nth;
+}
+} // namespace
+
+RankFilter::RankFilter(const std::array<unsigned, 3>& dims, const std::array<unsigned, 3>& radius)
+		: m_Dims(dims), m_Radius(radius)
+{
+}
+
+void RankFilter::Percentile(const float* input, float* output, float percentile) const
+{
+	Percentile(std::vector<const float*>(1, input), std::vector<float*>(1, output), percentile);
+}
+
+void RankFilter::Percentile(const std::vector<const float*>& input, const std::vector<float*>& output, float percentile) const
+{
+	unsigned const width = m_Dims[0];
+	unsigned const height = m_Dims[1];
+	unsigned const depth = m_Dims[2];
+	if (width == 0 || height == 0 || depth == 0)
+		return;
+
+	if (m_Radius[0] == 1 && m_Radius[1] == 1 && (m_Radius[2] == 0 || depth == 1) && percentile == 50.f)
+	{
+		Median3x3(input, output);
+		return;
+	}
+
+	float offset = 0.f;
+	unsigned bins = 0;
+	bool const quantized = IsQuantized(input, static_cast<size_t>(width) * height, offset, bins);
+	std::int64_t const num_rows = static_cast<std::int64_t>(height) * depth;
+
+#pragma omp parallel
+	{
+		std::vector<float> buffer;
+		std::vector<unsigned> hist(bins, 0);
+		// the tracked bin and the number of window values below it, kept from row to row
+		unsigned m = 0;
+		size_t lt = 0;
+
+#pragma omp for
+		for (std::int64_t row = 0; row < num_rows; ++row)
+		{
+			unsigned const y = static_cast<unsigned>(row % height);
+			unsigned const z = static_cast<unsigned>(row / height);
+			Range const ry(y, m_Radius[1], height);
+			Range const rz(z, m_Radius[2], depth);
+			float* out = output[z] + static_cast<size_t>(y) * width;
+
+			if (!quantized)
+			{
+				for (unsigned x = 0; x < width; ++x)
+				{
+					out[x] = SelectRank(input, width, Range(x, m_Radius[0], width), ry, rz, percentile, buffer);
+				}
+				continue;
+			}
+
+			auto update_column = [&](unsigned x, int count) {
+				for (unsigned zz = rz.m_Lo; zz <= rz.m_Hi; ++zz)
+				{
+					for (unsigned yy = ry.m_Lo; yy <= ry.m_Hi; ++yy)
+					{
+						unsigned const b = static_cast<unsigned>(input[zz][static_cast<size_t>(yy) * width + x] - offset);
+						hist[b] += count;
+						if (b < m)
+							lt += count;
+					}
+				}
+			};
+
+			size_t const column_size = static_cast<size_t>(ry.Size()) * rz.Size();
+			for (unsigned x = 0; x <= m_Radius[0] && x < width; ++x)
+			{
+				update_column(x, 1);
+			}
+			for (unsigned x = 0; x < width; ++x)
+			{
+				size_t const r = RankIndex(percentile, Range(x, m_Radius[0], width).Size() * column_size);
+				while (lt > r)
+				{
+					--m;
+					lt -= hist[m];
+				}
+				while (lt + hist[m] <= r)
+				{
+					lt += hist[m];
+					++m;
+				}
+				out[x] = static_cast<float>(m) + offset;
+
+				// slide the window to x + 1
+				if (x + m_Radius[0] + 1 < width)
+					update_column(x + m_Radius[0] + 1, 1);
+				if (x >= m_Radius[0])
+					update_column(x - m_Radius[0], -1);
+			}
+
+			// empty the histogram for the next row
+			for (unsigned x = width > m_Radius[0] ? width - m_Radius[0] : 0; x < width; ++x)
+			{
+				update_column(x, -1);
+			}
+		}
+	}
+}
+
+void RankFilter::InterquartileRange(const float* input, float* output) const
+{
+	InterquartileRange(std::vector<const float*>(1, input), std::vector<float*>(1, output));
+}
+
+void RankFilter::InterquartileRange(const std::vector<const float*>& input, const std::vector<float*>& output) const
+{
+	size_t const area = static_cast<size_t>(m_Dims[0]) * m_Dims[1];
+	std::vector<float> lower(area * m_Dims[2]);
+	std::vector<float*> lower_slices(m_Dims[2]);
+	for (unsigned z = 0; z < m_Dims[2]; ++z)
+	{
+		lower_slices[z] = lower.data() + z * area;
+	}
+
+	Percentile(input, output, 75.f);
+	Percentile(input, lower_slices, 25.f);
+
+	for (unsigned z = 0; z < m_Dims[2]; ++z)
+	{
+		for (size_t i = 0; i < area; ++i)
+		{
+			output[z][i] -= lower_slices[z][i];
+		}
+	}
+}
+
+void RankFilter::Median3x3(const std::vector<const float*>& input, const std::vector<float*>& output) const
+{
+	unsigned const width = m_Dims[0];
+	unsigned const height = m_Dims[1];
+	std::int64_t const num_rows = static_cast<std::int64_t>(height) * m_Dims[2];
+	Range const rz(0, 0, 1);
+
+#pragma omp parallel
+	{
+		std::vector<float> buffer;
+
+#pragma omp for
+		for (std::int64_t row = 0; row < num_rows; ++row)
+		{
+			unsigned const y = static_cast<unsigned>(row % height);
+			unsigned const z = static_cast<unsigned>(row / height);
+			std::vector<const float*> slice(1, input[z]);
+			float* out = output[z] + static_cast<size_t>(y) * width;
+
+			if (y == 0 || y + 1 == height || width < 3)
+			{
+				for (unsigned x = 0; x < width; ++x)
+				{
+					out[x] = SelectRank(slice, width, Range(x, 1, width), Range(y, 1, height), rz, 50.f, buffer);
+				}
+				continue;
+			}
+
+			const float* r0 = input[z] + static_cast<size_t>(y - 1) * width;
+			const float* r1 = r0 + width;
+			const float* r2 = r1 + width;
+			for (unsigned x = 1; x + 1 < width; ++x)
+			{
+				out[x] = Median9(r0[x - 1], r0[x], r0[x + 1], r1[x - 1], r1[x], r1[x + 1], r2[x - 1], r2[x], r2[x + 1]);
+			}
+			out[0] = SelectRank(slice, width, Range(0, 1, width), Range(y, 1, height), rz, 50.f, buffer);
+			out[width - 1] = SelectRank(slice, width, Range(width - 1, 1, width), Range(y, 1, height), rz, 50.f, buffer);
+		}
+	}
+}
+
+} // namespace iseg
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "iSegCore.h"
+
+#include <array>
+#include <vector>
+
+namespace iseg {
+
+/** \brief Median, percentile and interquartile range filters in 2D (dims[2] == 1) or 3D.
+
+	The window extends 'radius' pixels along each axis and is clipped at the image border.
+	The 3D image is given as one buffer per slice, the output must not overlap the input.
+
+	The 3x3 median uses a sorting network. If the image only contains integers spanning less
+	than 2^16 values, e.g. CT or MR data, the window is slid along the rows and its histogram
+	is updated incrementally (Huang), so the cost per pixel grows with the window height and
+	depth instead of the window size. Otherwise the rank is selected from the window values.
+	The rows are processed in parallel.
+*/
+class ISEG_CORE_API RankFilter
+{
+public:
+	RankFilter(const std::array<unsigned, 3>& dims, const std::array<unsigned, 3>& radius);
+
+	/// Value at 'percentile' (0 to 100) of the sorted window values
+	void Percentile(const std::vector<const float*>& input, const std::vector<float*>& output, float percentile) const;
+	void Percentile(const float* input, float* output, float percentile) const;
+
+	void Median(const std::vector<const float*>& input, const std::vector<float*>& output) const { Percentile(input, output, 50.f); }
+	void Median(const float* input, float* output) const { Percentile(input, output, 50.f); }
+
+	/// 75th minus 25th percentile
+	void InterquartileRange(const std::vector<const float*>& input, const std::vector<float*>& output) const;
+	void InterquartileRange(const float* input, float* output) const;
+
+private:
+	void Median3x3(const std::vector<const float*>& input, const std::vector<float*>& output) const;
+
+	std::array<unsigned, 3> m_Dims;
+	std::array<unsigned, 3> m_Radius;
+};
+
+} // namespace iseg
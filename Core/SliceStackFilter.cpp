@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "SliceStackFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace iseg {
+
+SliceStackFilter::SliceStackFilter(const std::array<unsigned, 3>& dims, const std::vector<float*>& slices)
+		: m_Dims(dims), m_Area(static_cast<size_t>(dims[0]) * dims[1]), m_Slices(slices)
+{
+}
+
+std::vector<float> SliceStackFilter::GaussianKernel(float sigma)
+{
+	if (sigma <= 0.f)
+		return std::vector<float>(1, 1.f);
+
+	int const radius = static_cast<int>(std::ceil(3.f * sigma));
+	std::vector<float> kernel(radius + 1);
+	double sum = 0.0;
+	for (int i = 0; i <= radius; ++i)
+	{
+		kernel[i] = std::exp(-static_cast<float>(i * i) / (2.f * sigma * sigma));
+		sum += (i == 0) ? kernel[i] : 2.0 * kernel[i];
+	}
+	for (auto& w : kernel)
+	{
+		w = static_cast<float>(w / sum);
+	}
+	return kernel;
+}
+
+void SliceStackFilter::Gaussian(const std::array<float, 3>& sigma)
+{
+	Convolve({GaussianKernel(sigma[0]), GaussianKernel(sigma[1]), GaussianKernel(sigma[2])});
+}
+
+void SliceStackFilter::Average(const std::array<unsigned, 3>& n)
+{
+	std::array<std::vector<float>, 3> kernels;
+	for (int k = 0; k < 3; ++k)
+	{
+		unsigned const radius = n[k] / 2;
+		kernels[k].assign(radius + 1, 1.f / (2 * radius + 1));
+	}
+	Convolve(kernels);
+}
+
+void SliceStackFilter::Convolve(const std::array<std::vector<float>, 3>& kernels)
+{
+	if (m_Area == 0 || m_Dims[2] == 0)
+		return;
+
+	std::int64_t const depth = m_Dims[2];
+
+#pragma omp parallel
+	{
+		std::vector<float> row;
+		std::vector<float> tmp(m_Area);
+
+#pragma omp for
+		for (std::int64_t z = 0; z < depth; ++z)
+		{
+			ConvolveXY(m_Slices[z], kernels[0], kernels[1], row, tmp);
+		}
+	}
+
+	if (depth > 1 && kernels[2].size() > 1)
+	{
+		ConvolveZ(kernels[2]);
+	}
+}
+
+void SliceStackFilter::ConvolveXY(float* slice, const std::vector<float>& kx, const std::vector<float>& ky, std::vector<float>& row, std::vector<float>& tmp) const
+{
+	unsigned const width = m_Dims[0];
+	unsigned const height = m_Dims[1];
+	unsigned const rx = static_cast<unsigned>(kx.size()) - 1;
+	int const ry = static_cast<int>(ky.size()) - 1;
+
+	// along x into tmp, with the row padded by its border values
+	row.resize(width + 2 * rx);
+	for (unsigned y = 0; y < height; ++y)
+	{
+		const float* in = slice + static_cast<size_t>(y) * width;
+		float* out = tmp.data() + static_cast<size_t>(y) * width;
+		std::fill(row.begin(), row.begin() + rx, in[0]);
+		std::copy(in, in + width, row.begin() + rx);
+		std::fill(row.begin() + rx + width, row.end(), in[width - 1]);
+
+		const float* r = row.data() + rx;
+		for (unsigned x = 0; x < width; ++x)
+		{
+			out[x] = kx[0] * r[x];
+		}
+		for (int k = 1; k <= static_cast<int>(rx); ++k)
+		{
+			float const w = kx[k];
+			for (int x = 0; x < static_cast<int>(width); ++x)
+			{
+				out[x] += w * (r[x - k] + r[x + k]);
+			}
+		}
+	}
+
+	// along y back into the slice
+	for (int y = 0; y < static_cast<int>(height); ++y)
+	{
+		const float* in = tmp.data() + static_cast<size_t>(y) * width;
+		float* out = slice + static_cast<size_t>(y) * width;
+		for (unsigned x = 0; x < width; ++x)
+		{
+			out[x] = ky[0] * in[x];
+		}
+		for (int k = 1; k <= ry; ++k)
+		{
+			float const w = ky[k];
+			const float* a = tmp.data() + static_cast<size_t>(std::max(y - k, 0)) * width;
+			const float* b = tmp.data() + static_cast<size_t>(std::min(y + k, static_cast<int>(height) - 1)) * width;
+			for (unsigned x = 0; x < width; ++x)
+			{
+				out[x] += w * (a[x] + b[x]);
+			}
+		}
+	}
+}
+
+void SliceStackFilter::ConvolveZ(const std::vector<float>& kz)
+{
+	int const depth = static_cast<int>(m_Dims[2]);
+	int const rz = static_cast<int>(kz.size()) - 1;
+	unsigned const width = m_Dims[0];
+	std::int64_t const height = m_Dims[1];
+
+	// the original values of the slices z - rz, ..., z, the slices above are not modified yet
+	std::vector<std::vector<float>> resident(rz + 1, std::vector<float>(m_Area));
+	auto original = [&](int j, int z) -> const float* {
+		j = std::min(std::max(j, 0), depth - 1);
+		return j <= z ? resident[j % (rz + 1)].data() : m_Slices[j];
+	};
+
+	std::vector<const float*> lower(rz + 1), upper(rz + 1);
+	for (int z = 0; z < depth; ++z)
+	{
+		std::copy(m_Slices[z], m_Slices[z] + m_Area, resident[z % (rz + 1)].begin());
+		for (int k = 0; k <= rz; ++k)
+		{
+			lower[k] = original(z - k, z);
+			upper[k] = original(z + k, z);
+		}
+
+		float* out = m_Slices[z];
+#pragma omp parallel for
+		for (std::int64_t y = 0; y < height; ++y)
+		{
+			size_t const start = static_cast<size_t>(y) * width;
+			size_t const end = start + width;
+			for (size_t i = start; i < end; ++i)
+			{
+				out[i] = kz[0] * lower[0][i];
+			}
+			for (int k = 1; k <= rz; ++k)
+			{
+				float const w = kz[k];
+				const float* a = lower[k];
+				const float* b = upper[k];
+				for (size_t i = start; i < end; ++i)
+				{
+					out[i] += w * (a[i] + b[i]);
+				}
+			}
+		}
+	}
+}
+
+} // namespace iseg
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "iSegCore.h"
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace iseg {
+
+/// Conductance 1 / (1 + (d/k)^2) of the Perona-Malik diffusion
+struct RationalConductance
+{
+	explicit RationalConductance(float k) : m_InvK2(k > 0.f ? 1.f / (k * k) : std::numeric_limits<float>::max()) {}
+	float operator()(float d) const { return 1.f / (1.f + d * d * m_InvK2); }
+
+	float m_InvK2;
+};
+
+/// Conductance exp(-(d/k)^2) of the Perona-Malik diffusion
+struct ExponentialConductance
+{
+	explicit ExponentialConductance(float k) : m_InvK2(k > 0.f ? 1.f / (k * k) : std::numeric_limits<float>::max()) {}
+	float operator()(float d) const { return std::exp(-d * d * m_InvK2); }
+
+	float m_InvK2;
+};
+
+/** \brief Smoothing filters which work in place on a stack of slices (one buffer per slice).
+
+	Convolutions are separable: the x and y passes filter one slice at a time, with the
+	slices distributed over the threads. The z pass streams through the stack and only keeps
+	copies of the slices within the kernel radius, the rows of a slice are distributed over
+	the threads. The image is clamped at the border.
+
+	The anisotropic diffusion splits the stack into slabs which are updated in parallel,
+	each keeping a copy of the previous slice and of the slices at its boundary.
+*/
+class ISEG_CORE_API SliceStackFilter
+{
+public:
+	SliceStackFilter(const std::array<unsigned, 3>& dims, const std::vector<float*>& slices);
+
+	/// Sampled, normalized Gaussian truncated at 3 sigma, weights for the offsets 0, 1, 2, ...
+	static std::vector<float> GaussianKernel(float sigma);
+
+	/// Convolve with symmetric kernels along x, y and z, given as the weights for the offsets 0, 1, 2, ...
+	void Convolve(const std::array<std::vector<float>, 3>& kernels);
+
+	/// Gaussian with the standard deviation in pixels along each axis (0: no smoothing along the axis)
+	void Gaussian(const std::array<float, 3>& sigma);
+
+	/// Mean over n pixels (made odd) along each axis
+	void Average(const std::array<unsigned, 3>& n);
+
+	/** Perona-Malik diffusion with the explicit scheme
+
+			u += dt (sum_neighbors conductance(u_n - u) (u_n - u) + restraint (reference - u))
+
+		The reference may be empty if restraint is 0.
+	*/
+	template<class TConductance>
+	void AnisotropicDiffusion(const std::vector<const float*>& reference, float dt, int iterations, const TConductance& conductance, float restraint);
+
+private:
+	void ConvolveXY(float* slice, const std::vector<float>& kx, const std::vector<float>& ky, std::vector<float>& row, std::vector<float>& tmp) const;
+	void ConvolveZ(const std::vector<float>& kz);
+
+	template<class TConductance>
+	void DiffuseSlice(const float* below, const float* current, const float* above, const float* reference, float* output, float dt, const TConductance& conductance, float restraint) const;
+
+	std::array<unsigned, 3> m_Dims;
+	size_t m_Area;
+	std::vector<float*> m_Slices;
+};
+
+} // namespace iseg
+
+#include "SliceStackFilter.inl"
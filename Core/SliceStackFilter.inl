@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+namespace iseg {
+
+template<class TConductance>
+void SliceStackFilter::AnisotropicDiffusion(const std::vector<const float*>& reference, float dt, int iterations, const TConductance& conductance, float restraint)
+{
+	unsigned const depth = m_Dims[2];
+	if (depth == 0 || m_Area == 0)
+		return;
+
+	unsigned const slab_size = std::max(4u, (depth + 63) / 64);
+	std::int64_t const num_slabs = (depth + slab_size - 1) / slab_size;
+
+	// values of the previous iteration at the slab boundaries
+	std::vector<std::vector<float>> first(num_slabs), last(num_slabs);
+
+	for (int it = 0; it < iterations; ++it)
+	{
+#pragma omp parallel for
+		for (std::int64_t s = 0; s < num_slabs; ++s)
+		{
+			unsigned const z0 = static_cast<unsigned>(s) * slab_size;
+			unsigned const z1 = std::min(z0 + slab_size, depth);
+			first[s].assign(m_Slices[z0], m_Slices[z0] + m_Area);
+			last[s].assign(m_Slices[z1 - 1], m_Slices[z1 - 1] + m_Area);
+		}
+
+#pragma omp parallel for
+		for (std::int64_t s = 0; s < num_slabs; ++s)
+		{
+			unsigned const z0 = static_cast<unsigned>(s) * slab_size;
+			unsigned const z1 = std::min(z0 + slab_size, depth);
+			std::vector<float> previous(m_Area), current(m_Area);
+
+			for (unsigned z = z0; z < z1; ++z)
+			{
+				std::copy(m_Slices[z], m_Slices[z] + m_Area, current.begin());
+
+				const float* below = nullptr;
+				if (z > z0)
+					below = previous.data();
+				else if (s > 0)
+					below = last[s - 1].data();
+
+				const float* above = nullptr;
+				if (z + 1 < z1)
+					above = m_Slices[z + 1];
+				else if (z + 1 < depth)
+					above = first[s + 1].data();
+
+				DiffuseSlice(below, current.data(), above, restraint != 0.f ? reference[z] : nullptr, m_Slices[z], dt, conductance, restraint);
+				previous.swap(current);
+			}
+		}
+	}
+}
+
+template<class TConductance>
+void SliceStackFilter::DiffuseSlice(const float* below, const float* current, const float* above, const float* reference, float* output, float dt, const TConductance& conductance, float restraint) const
+{
+	unsigned const width = m_Dims[0];
+	unsigned const height = m_Dims[1];
+
+	auto flux = [&conductance](float n, float c) {
+		float const d = n - c;
+		return conductance(d) * d;
+	};
+
+	for (unsigned y = 0; y < height; ++y)
+	{
+		size_t const row = static_cast<size_t>(y) * width;
+		for (unsigned x = 0; x < width; ++x)
+		{
+			size_t const i = row + x;
+			float const c = current[i];
+			float sum = 0.f;
+			if (x > 0)
+				sum += flux(current[i - 1], c);
+			if (x + 1 < width)
+				sum += flux(current[i + 1], c);
+			if (y > 0)
+				sum += flux(current[i - width], c);
+			if (y + 1 < height)
+				sum += flux(current[i + width], c);
+			if (below)
+				sum += flux(below[i], c);
+			if (above)
+				sum += flux(above[i], c);
+			if (reference)
+				sum += restraint * (reference[i] - c);
+			output[i] = c + dt * sum;
+		}
+	}
+}
+
+} // namespace iseg
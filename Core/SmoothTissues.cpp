@@ -16,8 +16,16 @@
 #include "../Data/SlicesHandlerITKInterface.h"
 
 #include <itkDiscreteGaussianImageFilter.h>
+#include <itkRegionOfInterestImageFilter.h>
 #include <itkSignedMaurerDistanceMapImageFilter.h>
 
+#include <algorithm>
+#include <limits>
+
+#ifndef NO_OPENMP_SUPPORT
+#	include <omp.h>
+#endif
+
 namespace iseg {
 
 template<class TInput, class TOutput>
@@ -51,67 +59,162 @@ bool _SmoothTissues(TInput* tissues, const std::vector<bool>& locks, double sigm
 {
 	itkStaticConstMacro(ImageDimension, size_t, TInput::ImageDimension);
 	using label_image_type = TInput;
+	using label_type = typename TInput::PixelType;
 	using real_image_type = itk::Image<float, ImageDimension>;
+	using buffer_image_type = itk::Image<label_type, ImageDimension>;
+	using region_type = typename TInput::RegionType;
+	using index_type = typename TInput::IndexType;
 
-	bool ok = false;
-
-	if (progress)
-		progress->SetNumberOfSteps(locks.size() + 1);
+	auto const region = tissues->GetBufferedRegion();
 
-	// compute smooth signed distance function (sdf) for each non-locked tissue
-	std::vector<typename real_image_type::Pointer> sdf_images(locks.size(), nullptr);
+	// bounding box of each non-locked tissue
+	std::vector<index_type> lo(locks.size()), hi(locks.size());
+	std::vector<bool> present(locks.size(), false);
 	{
-		itk::ImageRegionIterator<label_image_type> it(tissues, tissues->GetBufferedRegion());
+		itk::ImageRegionConstIteratorWithIndex<label_image_type> it(tissues, region);
 		for (it.GoToBegin(); !it.IsAtEnd(); ++it)
 		{
-			// if not locked and no sdf computed yet
-			if (!locks.at(it.Get()) && !sdf_images[it.Get()])
+			auto label = it.Get();
+			if (locks.at(label))
+				continue;
+
+			auto idx = it.GetIndex();
+			if (!present[label])
 			{
-				ok = true; // at least one unlocked tissue found
+				present[label] = true;
+				lo[label] = hi[label] = idx;
+			}
+			for (unsigned d = 0; d < ImageDimension; ++d)
+			{
+				lo[label][d] = std::min(lo[label][d], idx[d]);
+				hi[label][d] = std::max(hi[label][d], idx[d]);
+			}
+		}
+	}
+
+	std::vector<label_type> labels;
+	for (size_t i = 0; i < present.size(); ++i)
+	{
+		if (present[i])
+			labels.push_back(static_cast<label_type>(i));
+	}
+	if (labels.empty())
+		return false;
+
+	if (progress)
+		progress->SetNumberOfSteps(labels.size() + 1);
+
+	// a tissue can only win voxels close to its (smoothed) boundary, so its sdf is only computed
+	// in its bounding box dilated by the band width, and only voxels inside the band are compared
+	auto const spacing = tissues->GetSpacing();
+	double const band = 3.0 * sigma + 2.0 * *std::max_element(spacing.Begin(), spacing.End());
+	typename region_type::SizeType margin;
+	for (unsigned d = 0; d < ImageDimension; ++d)
+	{
+		margin[d] = static_cast<typename region_type::SizeValueType>(std::ceil(band / spacing[d])) + 1;
+	}
+
+	// running minimum of the sdf and the tissue it belongs to, instead of one sdf per tissue
+	auto min_sdf = real_image_type::New();
+	min_sdf->CopyInformation(tissues);
+	min_sdf->SetRegions(region);
+	min_sdf->Allocate();
+	min_sdf->FillBuffer(std::numeric_limits<float>::max());
+
+	auto min_label = buffer_image_type::New();
+	min_label->CopyInformation(tissues);
+	min_label->SetRegions(region);
+	min_label->Allocate();
+	{
+		itk::ImageRegionConstIterator<label_image_type> in(tissues, region);
+		itk::ImageRegionIterator<buffer_image_type> out(min_label, region);
+		for (in.GoToBegin(), out.GoToBegin(); !in.IsAtEnd(); ++in, ++out)
+		{
+			out.Set(in.Get());
+		}
+	}
+
+	auto label_roi = [&](label_type label) {
+		region_type roi;
+		roi.SetIndex(lo[label]);
+		roi.SetUpperIndex(hi[label]);
+		roi.PadByRadius(margin);
+		roi.Crop(region);
+		return roi;
+	};
 
-				// compute sdf to tissue @ current location
-				sdf_images[it.Get()] = _ComputeSDF<label_image_type, real_image_type>(tissues, it.Get(), sigma);
+	auto smooth_label = [&](label_type label) {
+		auto const roi = label_roi(label);
 
-				if (progress)
-					progress->Increment();
+		using roi_filter_type = itk::RegionOfInterestImageFilter<label_image_type, buffer_image_type>;
+		auto crop = roi_filter_type::New();
+		crop->SetInput(tissues);
+		crop->SetRegionOfInterest(roi);
+		crop->Update();
+
+		auto sdf = _ComputeSDF<buffer_image_type, real_image_type>(crop->GetOutput(), label, sigma);
+
+#pragma omp critical
+		{
+			itk::ImageRegionConstIterator<real_image_type> sdf_it(sdf, sdf->GetBufferedRegion());
+			itk::ImageRegionIterator<real_image_type> min_it(min_sdf, roi);
+			itk::ImageRegionIterator<buffer_image_type> label_it(min_label, roi);
+			for (; !sdf_it.IsAtEnd(); ++sdf_it, ++min_it, ++label_it)
+			{
+				auto v = sdf_it.Get();
+				if (v < band && v < min_it.Get())
+				{
+					min_it.Set(v);
+					label_it.Set(label);
+				}
 			}
 		}
+
+		if (progress)
+			progress->Increment();
+	};
+
+	// each label needs a crop, its sdf and the smoothed sdf (plus filter internals) of its roi.
+	// Labels are only processed in parallel if their roi is smaller than the volume divided by
+	// the number of threads, so the buffers of all threads together never exceed those of one
+	// label covering the whole volume. The larger labels are processed one after the other.
+	size_t max_parallel_pixels = region.GetNumberOfPixels();
+#ifndef NO_OPENMP_SUPPORT
+	max_parallel_pixels /= std::max(1, omp_get_max_threads());
+#endif
+	std::vector<label_type> small_labels;
+	for (auto label : labels)
+	{
+		if (label_roi(label).GetNumberOfPixels() > max_parallel_pixels)
+			smooth_label(label);
+		else
+			small_labels.push_back(label);
 	}
 
-	// assign non-locked voxels to tissue with most negative sdf
+#pragma omp parallel for schedule(dynamic)
+	for (std::int64_t i = 0; i < static_cast<std::int64_t>(small_labels.size()); ++i)
 	{
-		itk::ImageRegionIteratorWithIndex<label_image_type> it(tissues, tissues->GetBufferedRegion());
-		for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+		smooth_label(small_labels[i]);
+	}
+
+	// assign non-locked voxels to tissue with most negative sdf ("most inside")
+	{
+		itk::ImageRegionIterator<label_image_type> it(tissues, region);
+		itk::ImageRegionConstIterator<buffer_image_type> label_it(min_label, region);
+		for (; !it.IsAtEnd(); ++it, ++label_it)
 		{
 			// don't overwrite locked tissues
 			if (!locks.at(it.Get()))
 			{
-				auto idx = it.GetIndex();
-
-				// find most negative sdf ("most inside")
-				auto min_sdf = std::numeric_limits<float>::max();
-				auto min_label = it.Get();
-				for (tissues_size_t i = 0; i != sdf_images.size(); ++i)
-				{
-					if (sdf_images[i])
-					{
-						auto sdf = sdf_images[i]->GetPixel(idx);
-						if (sdf < min_sdf)
-						{
-							min_sdf = sdf;
-							min_label = i;
-						}
-					}
-				}
-				it.Set(min_label);
+				it.Set(label_it.Get());
 			}
 		}
 	}
 
 	if (progress)
-		progress->SetValue(locks.size() + 1);
+		progress->SetValue(labels.size() + 1);
 
-	return ok;
+	return true;
 }
 
 bool SmoothTissues(SlicesHandlerInterface* handler, size_t start_slice, size_t end_slice, double sigma, bool smooth3d, ProgressInfo* progress)
@@ -131,7 +234,8 @@ bool SmoothTissues(SlicesHandlerInterface* handler, size_t start_slice, size_t e
 	{
 		using label_image_type = itk::Image<unsigned short, 2>;
 
-		progress->SetNumberOfSteps(end_slice - start_slice);
+		if (progress)
+			progress->SetNumberOfSteps(end_slice - start_slice);
 
 #pragma omp parallel for
 		for (std::int64_t slice = start_slice;
@@ -142,7 +246,8 @@ bool SmoothTissues(SlicesHandlerInterface* handler, size_t start_slice, size_t e
 
 			_SmoothTissues<label_image_type>(tissues, locks, sigma, nullptr);
 
-			progress->Increment();
+			if (progress)
+				progress->Increment();
 		}
 	}
 
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "SparseFieldLevelset.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace iseg {
+
+namespace {
+const unsigned char k_outside = std::numeric_limits<unsigned char>::max();
+
+inline void Coordinates(size_t idx, const std::array<unsigned, 3>& dims, unsigned (&coord)[3])
+{
+	coord[0] = static_cast<unsigned>(idx % dims[0]);
+	idx /= dims[0];
+	coord[1] = static_cast<unsigned>(idx % dims[1]);
+	coord[2] = static_cast<unsigned>(idx / dims[1]);
+}
+} // namespace
+
+SparseFieldLevelset::SparseFieldLevelset(const std::array<unsigned, 3>& dims, float* phi, const float* speed, const float* potential, float balloon, float epsilon, float step_size, unsigned band_width)
+		: m_Dims(dims), m_Phi(phi), m_Speed(speed), m_Potential(potential), m_Balloon(balloon), m_Epsilon(epsilon), m_StepSize(step_size)
+{
+	m_Strides[0] = 1;
+	m_Strides[1] = m_Dims[0];
+	m_Strides[2] = static_cast<size_t>(m_Dims[0]) * m_Dims[1];
+	m_Size = m_Strides[2] * m_Dims[2];
+	m_BandWidth = std::min(std::max(band_width, 2u), 16u);
+	m_Layer.assign(m_Size, k_outside);
+
+	Reinitialize();
+}
+
+void SparseFieldLevelset::Iterate(unsigned nrsteps, unsigned reinit_freq)
+{
+	for (unsigned i = 1; i <= nrsteps; ++i)
+	{
+		Step();
+		// the zero level set must not leave the band before it is rebuilt
+		if ((reinit_freq > 0 && i % reinit_freq == 0) || m_Moved >= m_BandWidth - 1.f)
+		{
+			Reinitialize();
+		}
+	}
+}
+
+void SparseFieldLevelset::Step()
+{
+	m_Update.resize(m_Band.size());
+
+#pragma omp parallel for
+	for (std::int64_t i = 0; i < static_cast<std::int64_t>(m_Band.size()); ++i)
+	{
+		size_t const idx = m_Band[i];
+		unsigned coord[3];
+		Coordinates(idx, m_Dims, coord);
+
+		// first and second derivatives, one-sided at the image border
+		float d1[3] = {0.f, 0.f, 0.f}, d2[3] = {0.f, 0.f, 0.f}, p1[3] = {0.f, 0.f, 0.f};
+		bool interior[3] = {false, false, false};
+		for (int a = 0; a < 3; ++a)
+		{
+			if (m_Dims[a] == 1)
+				continue;
+			size_t const lo = coord[a] > 0 ? idx - m_Strides[a] : idx;
+			size_t const hi = coord[a] + 1 < m_Dims[a] ? idx + m_Strides[a] : idx;
+			interior[a] = (lo != idx && hi != idx);
+			float const h = interior[a] ? 2.f : 1.f;
+			d1[a] = (m_Phi[hi] - m_Phi[lo]) / h;
+			if (m_Potential)
+				p1[a] = (m_Potential[hi] - m_Potential[lo]) / h;
+			if (interior[a] && m_Epsilon != 0)
+				d2[a] = m_Phi[hi] - 2.f * m_Phi[idx] + m_Phi[lo];
+		}
+
+		float const grad2 = d1[0] * d1[0] + d1[1] * d1[1] + d1[2] * d1[2];
+		float update = 0.f;
+		if (grad2 != 0)
+		{
+			float curvature = 0.f;
+			if (m_Epsilon != 0)
+			{
+				// |grad phi|^2 times the mean curvature, mixed derivatives are 0 at the border
+				float d11[3] = {0.f, 0.f, 0.f};
+				int const pairs[3][2] = {{0, 1}, {0, 2}, {1, 2}};
+				for (int k = 0; k < 3; ++k)
+				{
+					int const a = pairs[k][0], b = pairs[k][1];
+					if (interior[a] && interior[b])
+					{
+						size_t const sa = m_Strides[a], sb = m_Strides[b];
+						d11[k] = (m_Phi[idx + sa + sb] - m_Phi[idx - sa + sb] - m_Phi[idx + sa - sb] + m_Phi[idx - sa - sb]) / 4.f;
+					}
+				}
+				curvature = d2[0] * (d1[1] * d1[1] + d1[2] * d1[2]) +
+										d2[1] * (d1[0] * d1[0] + d1[2] * d1[2]) +
+										d2[2] * (d1[0] * d1[0] + d1[1] * d1[1]) -
+										2.f * (d1[0] * d1[1] * d11[0] + d1[0] * d1[2] * d11[1] + d1[1] * d1[2] * d11[2]);
+			}
+			update = m_Speed[idx] * (std::sqrt(grad2) * m_Balloon + m_Epsilon * curvature / grad2) -
+							 (p1[0] * d1[0] + p1[1] * d1[1] + p1[2] * d1[2]);
+		}
+		m_Update[i] = m_StepSize * update;
+	}
+
+	float moved = 0.f;
+	for (size_t i = 0; i < m_Band.size(); ++i)
+	{
+		m_Phi[m_Band[i]] += m_Update[i];
+		moved = std::max(moved, std::abs(m_Update[i]));
+	}
+	m_Moved += moved;
+}
+
+float SparseFieldLevelset::SolveEikonal(size_t idx, const unsigned (&coord)[3], unsigned char layer) const
+{
+	// distance from the neighbors in the inner layers, first order upwind
+	float const inf = std::numeric_limits<float>::max();
+	float u[3] = {inf, inf, inf};
+	for (int a = 0; a < 3; ++a)
+	{
+		if (coord[a] > 0 && m_Layer[idx - m_Strides[a]] < layer)
+			u[a] = std::abs(m_Phi[idx - m_Strides[a]]);
+		if (coord[a] + 1 < m_Dims[a] && m_Layer[idx + m_Strides[a]] < layer)
+			u[a] = std::min(u[a], std::abs(m_Phi[idx + m_Strides[a]]));
+	}
+	std::sort(u, u + 3);
+
+	float d = u[0] + 1.f;
+	if (d > u[1])
+	{
+		d = 0.5f * (u[0] + u[1] + std::sqrt(2.f - (u[0] - u[1]) * (u[0] - u[1])));
+		if (d > u[2])
+		{
+			float const s = u[0] + u[1] + u[2];
+			float const q = u[0] * u[0] + u[1] * u[1] + u[2] * u[2];
+			d = (s + std::sqrt(std::max(s * s - 3.f * (q - 1.f), 0.f))) / 3.f;
+		}
+	}
+	return d;
+}
+
+void SparseFieldLevelset::Reinitialize()
+{
+	bool const full = m_Band.empty();
+	std::vector<size_t> old_band;
+	old_band.swap(m_Band);
+
+	// zero crossing: points with a face neighbor on the other side, which can only be in the band
+	std::vector<float> front_value;
+	auto visit = [this, &front_value](size_t idx) {
+		unsigned coord[3];
+		Coordinates(idx, m_Dims, coord);
+		bool const inside = m_Phi[idx] > 0;
+		bool crossing = false;
+		float grad2 = 0.f;
+		for (int a = 0; a < 3; ++a)
+		{
+			if (m_Dims[a] == 1)
+				continue;
+			size_t const lo = coord[a] > 0 ? idx - m_Strides[a] : idx;
+			size_t const hi = coord[a] + 1 < m_Dims[a] ? idx + m_Strides[a] : idx;
+			crossing = crossing || (m_Phi[lo] > 0) != inside || (m_Phi[hi] > 0) != inside;
+			float const d = (m_Phi[hi] - m_Phi[lo]) / ((lo != idx && hi != idx) ? 2.f : 1.f);
+			grad2 += d * d;
+		}
+		if (crossing)
+		{
+			// sub-pixel distance to the zero level set
+			float v = m_Phi[idx] / std::max(std::sqrt(grad2), 1e-3f);
+			m_Band.push_back(idx);
+			front_value.push_back(inside ? std::min(v, 1.f) : std::max(v, -1.f));
+		}
+	};
+	if (full)
+	{
+		for (size_t idx = 0; idx < m_Size; ++idx)
+			visit(idx);
+	}
+	else
+	{
+		for (auto idx : old_band)
+			visit(idx);
+	}
+
+	for (auto idx : old_band)
+	{
+		m_Layer[idx] = k_outside;
+	}
+	for (size_t k = 0; k < m_Band.size(); ++k)
+	{
+		m_Phi[m_Band[k]] = front_value[k];
+		m_Layer[m_Band[k]] = 0;
+	}
+
+	// grow the band layer by layer and compute the distance from the inner layers
+	size_t begin = 0;
+	for (unsigned layer = 1; layer <= m_BandWidth; ++layer)
+	{
+		size_t const end = m_Band.size();
+		for (size_t k = begin; k < end; ++k)
+		{
+			size_t const idx = m_Band[k];
+			unsigned coord[3];
+			Coordinates(idx, m_Dims, coord);
+			for (int a = 0; a < 3; ++a)
+			{
+				if (coord[a] > 0 && m_Layer[idx - m_Strides[a]] == k_outside)
+				{
+					m_Layer[idx - m_Strides[a]] = static_cast<unsigned char>(layer);
+					m_Band.push_back(idx - m_Strides[a]);
+				}
+				if (coord[a] + 1 < m_Dims[a] && m_Layer[idx + m_Strides[a]] == k_outside)
+				{
+					m_Layer[idx + m_Strides[a]] = static_cast<unsigned char>(layer);
+					m_Band.push_back(idx + m_Strides[a]);
+				}
+			}
+		}
+		for (size_t k = end; k < m_Band.size(); ++k)
+		{
+			size_t const idx = m_Band[k];
+			unsigned coord[3];
+			Coordinates(idx, m_Dims, coord);
+			float const d = SolveEikonal(idx, coord, static_cast<unsigned char>(layer));
+			m_Phi[idx] = (m_Phi[idx] > 0) ? d : -d;
+		}
+		begin = end;
+	}
+
+	// points which left the band
+	float const far = m_BandWidth + 1.f;
+	if (full)
+	{
+		for (size_t idx = 0; idx < m_Size; ++idx)
+		{
+			if (m_Layer[idx] == k_outside)
+				m_Phi[idx] = (m_Phi[idx] > 0) ? far : -far;
+		}
+	}
+	else
+	{
+		for (auto idx : old_band)
+		{
+			if (m_Layer[idx] == k_outside)
+				m_Phi[idx] = (m_Phi[idx] > 0) ? far : -far;
+		}
+	}
+	m_Moved = 0.f;
+}
+
+} // namespace iseg
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "iSegCore.h"
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace iseg {
+
+/** \brief Narrow band level set evolution in 2D (dims[2] == 1) or 3D.
+
+	The level set function 'phi' is positive inside and evolves according to
+
+		phi_t = K (balloon |grad phi| + epsilon |grad phi| curvature) - grad P . grad phi
+
+	where K is the speed image and P the potential. Only the points within 'band_width' pixels
+	of the zero level set are updated. The derivatives, curvature and potential gradient are
+	computed in one pass per band point, and the band is rebuilt by a local reinitialization,
+	so the cost of a step scales with the size of the contour instead of the image.
+
+	Points outside the band are set to +/-(band_width + 1). The buffers are not owned.
+*/
+class ISEG_CORE_API SparseFieldLevelset
+{
+public:
+	SparseFieldLevelset(const std::array<unsigned, 3>& dims, float* phi, const float* speed, const float* potential, float balloon, float epsilon, float step_size, unsigned band_width = 3);
+
+	void SetSpeed(const float* speed) { m_Speed = speed; }
+	void SetPotential(const float* potential) { m_Potential = potential; }
+
+	/// Evolve 'nrsteps' steps, reinitialize every 'reinit_freq' steps (0: only when needed)
+	void Iterate(unsigned nrsteps, unsigned reinit_freq);
+	void Step();
+	/// Restore the distance property around the zero level set and rebuild the band
+	void Reinitialize();
+
+	size_t BandSize() const { return m_Band.size(); }
+
+private:
+	float SolveEikonal(size_t idx, const unsigned (&coord)[3], unsigned char layer) const;
+
+	std::array<unsigned, 3> m_Dims;
+	std::array<size_t, 3> m_Strides;
+	size_t m_Size;
+	float* m_Phi;
+	const float* m_Speed;
+	const float* m_Potential;
+	float m_Balloon;
+	float m_Epsilon;
+	float m_StepSize;
+	unsigned m_BandWidth;
+
+	std::vector<size_t> m_Band;
+	std::vector<float> m_Update;
+	std::vector<unsigned char> m_Layer;
+	float m_Moved = 0.f;
+};
+
+} // namespace iseg
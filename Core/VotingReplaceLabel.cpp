@@ -1,9 +1,9 @@
 /*
  * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
- * 
+ *
  * This file is part of iSEG
  * (see https://github.com/ITISFoundation/osparc-iseg).
- * 
+ *
  * This software is released under the MIT License.
  *  https://opensource.org/licenses/MIT
  */
@@ -11,76 +11,225 @@
 
 #include "VotingReplaceLabel.h"
 
-#include "itkLabelVotingBinaryImageFilter.h"
+#include "../Data/SlicesHandlerInterface.h"
 
-#include "../Data/ItkUtils.h"
-#include "../Data/SlicesHandlerITKInterface.h"
-
-#include <itkCastImageFilter.h>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
 
 namespace iseg {
 
-size_t VotingReplaceLabel(SlicesHandlerInterface* handler, tissues_size_t foreground, tissues_size_t background, std::array<unsigned int, 3> iradius, unsigned int majority_threshold, unsigned int max_iterations)
+namespace {
+struct Change
 {
-	using image_type = itk::Image<tissues_size_t, 3>;
-	using voting_filter_type = itk::LabelVotingBinaryImageFilter<image_type, image_type>;
-
-	SlicesHandlerITKInterface itkhandler(handler);
-	auto tissues = itkhandler.GetTissues(true);
+	size_t m_Voxel;
+	tissues_size_t m_Label;
+};
 
-	auto cast = itk::CastImageFilter<SlicesHandlerITKInterface::tissues_ref_type, image_type>::New();
-	cast->SetInput(tissues);
-	cast->Update();
-	auto input = cast->GetOutput();
-
-	voting_filter_type::InputSizeType radius;
-	radius[0] = iradius[0];
-	radius[1] = iradius[1];
-	radius[2] = iradius[2];
+class Voting
+{
+public:
+	Voting(const std::array<unsigned, 3>& dims, const std::vector<tissues_size_t*>& slices, tissues_size_t foreground, tissues_size_t background, const std::array<unsigned int, 3>& radius, unsigned int majority_threshold)
+			: m_Dims(dims), m_Area(static_cast<size_t>(dims[0]) * dims[1]), m_Slices(slices), m_Foreground(foreground), m_Background(background), m_Radius(radius), m_MajorityThreshold(majority_threshold)
+	{
+	}
 
-	auto voting_filter = voting_filter_type::New();
-	voting_filter->SetForegroundValue(foreground);
-	voting_filter->SetBackgroundValue(background);
-	voting_filter->SetMajorityThreshold(majority_threshold);
-	voting_filter->SetRadius(radius);
+	size_t Area() const { return m_Area; }
 
-	image_type::Pointer output;
+	tissues_size_t Value(size_t voxel) const { return m_Slices[voxel / m_Area][voxel % m_Area]; }
 
-	// repeat relabeling
-	unsigned int iter = 0;
-	while (iter < max_iterations)
+	/// Label voted for the foreground voxel, or foreground if there is no clear majority
+	tissues_size_t Vote(size_t voxel, std::vector<std::pair<tissues_size_t, unsigned>>& histogram) const
 	{
-		voting_filter->SetInput(input);
-		voting_filter->Update();
+		int const x = static_cast<int>(voxel % m_Dims[0]);
+		int const y = static_cast<int>((voxel / m_Dims[0]) % m_Dims[1]);
+		int const z = static_cast<int>(voxel / m_Area);
+		int const rx = m_Radius[0], ry = m_Radius[1], rz = m_Radius[2];
+
+		// count the labels in the order of the neighborhood, voxels outside are background
+		histogram.clear();
+		for (int k = std::max(z - rz, 0); k <= std::min(z + rz, static_cast<int>(m_Dims[2]) - 1); ++k)
+		{
+			for (int j = std::max(y - ry, 0); j <= std::min(y + ry, static_cast<int>(m_Dims[1]) - 1); ++j)
+			{
+				const tissues_size_t* row = m_Slices[k] + static_cast<size_t>(j) * m_Dims[0];
+				for (int i = std::max(x - rx, 0); i <= std::min(x + rx, static_cast<int>(m_Dims[0]) - 1); ++i)
+				{
+					tissues_size_t const value = row[i];
+					if (value == m_Background || value == m_Foreground)
+						continue;
+					auto it = std::find_if(histogram.begin(), histogram.end(), [value](const std::pair<tissues_size_t, unsigned>& e) { return e.first == value; });
+					if (it != histogram.end())
+						it->second++;
+					else
+						histogram.push_back(std::make_pair(value, 1u));
+				}
+			}
+		}
 
-		iter++;
+		if (histogram.empty())
+			return m_Foreground;
+		if (histogram.size() == 1)
+			return histogram.front().first;
 
-		const auto num_changed = voting_filter->GetNumberOfPixelsChanged();
+		// the first of the most frequent labels, and the count of the runner-up
+		auto first = histogram.begin();
+		unsigned second = 0;
+		for (auto it = std::next(histogram.begin()); it != histogram.end(); ++it)
+		{
+			if (it->second > first->second)
+			{
+				second = first->second;
+				first = it;
+			}
+			else
+			{
+				second = std::max(second, it->second);
+			}
+		}
+		return (first->second >= second + m_MajorityThreshold) ? first->first : m_Foreground;
+	}
 
-		output = voting_filter->GetOutput();
-		output->DisconnectPipeline();
-		input = output;
-		if (num_changed == 0)
+	void Apply(const std::vector<Change>& changes) const
+	{
+		for (const auto& c : changes)
 		{
-			break;
+			m_Slices[c.m_Voxel / m_Area][c.m_Voxel % m_Area] = c.m_Label;
 		}
 	}
 
-	// count how many were not relabeled
-	size_t number_remaining = 0;
-	itk::ImageRegionConstIterator<image_type> image_it(output, output->GetLargestPossibleRegion());
-	for (image_it.GoToBegin(); !image_it.IsAtEnd(); ++image_it)
+private:
+	std::array<unsigned, 3> m_Dims;
+	size_t m_Area;
+	const std::vector<tissues_size_t*>& m_Slices;
+	tissues_size_t m_Foreground;
+	tissues_size_t m_Background;
+	std::array<unsigned int, 3> m_Radius;
+	unsigned int m_MajorityThreshold;
+};
+} // namespace
+
+size_t VotingReplaceLabel(SlicesHandlerInterface* handler, tissues_size_t foreground, tissues_size_t background, std::array<unsigned int, 3> iradius, unsigned int majority_threshold, unsigned int max_iterations)
+{
+	auto all_slices = handler->TissueSlices(handler->ActiveTissuelayer());
+	std::vector<tissues_size_t*> slices(all_slices.begin() + handler->StartSlice(), all_slices.begin() + handler->EndSlice());
+	std::array<unsigned, 3> const dims = {handler->Width(), handler->Height(), static_cast<unsigned>(slices.size())};
+
+	return VotingReplaceLabel(dims, slices, foreground, background, iradius, majority_threshold, max_iterations);
+}
+
+size_t VotingReplaceLabel(const std::array<unsigned, 3>& dims, const std::vector<tissues_size_t*>& slices, tissues_size_t foreground, tissues_size_t background, std::array<unsigned int, 3> iradius, unsigned int majority_threshold, unsigned int max_iterations)
+{
+	Voting voting(dims, slices, foreground, background, iradius, majority_threshold);
+	size_t const area = voting.Area();
+	unsigned const depth = dims[2];
+	if (area == 0 || depth == 0)
+		return 0;
+
+	unsigned const slab_size = std::max(1u, (depth + 63) / 64);
+	std::int64_t const num_slabs = (depth + slab_size - 1) / slab_size;
+
+	// the changes of the last iteration, sorted by voxel within each slab
+	std::vector<std::vector<Change>> changes(num_slabs);
+
+	for (unsigned int iter = 0; iter < max_iterations; ++iter)
 	{
-		if (image_it.Get() == foreground)
+		std::vector<std::vector<Change>> next(num_slabs);
+
+#pragma omp parallel
 		{
-			number_remaining += 1;
+			std::vector<std::pair<tissues_size_t, unsigned>> histogram;
+			std::vector<size_t> candidates;
+
+#pragma omp for
+			for (std::int64_t s = 0; s < num_slabs; ++s)
+			{
+				unsigned const z0 = static_cast<unsigned>(s) * slab_size;
+				unsigned const z1 = std::min(z0 + slab_size, depth);
+
+				auto vote = [&](size_t voxel) {
+					if (voting.Value(voxel) != foreground)
+						return;
+					tissues_size_t const label = voting.Vote(voxel, histogram);
+					if (label != foreground)
+						next[s].push_back(Change{voxel, label});
+				};
+
+				if (iter == 0)
+				{
+					for (size_t voxel = z0 * area; voxel < z1 * area; ++voxel)
+					{
+						vote(voxel);
+					}
+					continue;
+				}
+
+				// foreground voxels of this slab within the radius of a changed voxel
+				candidates.clear();
+				std::int64_t const first_slab = std::max<std::int64_t>(0, (static_cast<std::int64_t>(z0) - iradius[2]) / slab_size);
+				std::int64_t const last_slab = std::min<std::int64_t>(num_slabs - 1, (z1 - 1 + iradius[2]) / slab_size);
+				for (std::int64_t t = first_slab; t <= last_slab; ++t)
+				{
+					for (const auto& c : changes[t])
+					{
+						int const x = static_cast<int>(c.m_Voxel % dims[0]);
+						int const y = static_cast<int>((c.m_Voxel / dims[0]) % dims[1]);
+						int const z = static_cast<int>(c.m_Voxel / area);
+						int const k0 = std::max(z - static_cast<int>(iradius[2]), static_cast<int>(z0));
+						int const k1 = std::min(z + static_cast<int>(iradius[2]), static_cast<int>(z1) - 1);
+						int const j0 = std::max(y - static_cast<int>(iradius[1]), 0);
+						int const j1 = std::min(y + static_cast<int>(iradius[1]), static_cast<int>(dims[1]) - 1);
+						int const i0 = std::max(x - static_cast<int>(iradius[0]), 0);
+						int const i1 = std::min(x + static_cast<int>(iradius[0]), static_cast<int>(dims[0]) - 1);
+						for (int k = k0; k <= k1; ++k)
+						{
+							for (int j = j0; j <= j1; ++j)
+							{
+								const tissues_size_t* row = slices[k] + static_cast<size_t>(j) * dims[0];
+								size_t const offset = k * area + static_cast<size_t>(j) * dims[0];
+								for (int i = i0; i <= i1; ++i)
+								{
+									if (row[i] == foreground)
+										candidates.push_back(offset + i);
+								}
+							}
+						}
+					}
+				}
+				std::sort(candidates.begin(), candidates.end());
+				candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+				for (auto voxel : candidates)
+				{
+					vote(voxel);
+				}
+			}
 		}
+
+		// all voxels vote on the same state, apply the changes afterwards
+		bool changed = false;
+#pragma omp parallel for reduction(|| : changed)
+		for (std::int64_t s = 0; s < num_slabs; ++s)
+		{
+			voting.Apply(next[s]);
+			changed = changed || !next[s].empty();
+		}
+
+		changes.swap(next);
+		if (!changed)
+			break;
 	}
 
-	// paste into output
-	iseg::Paste<image_type, SlicesHandlerITKInterface::tissues_ref_type>(output, tissues);
+	// count how many were not relabeled
+	std::int64_t number_remaining = 0;
+	std::int64_t const num_slices = depth;
+#pragma omp parallel for reduction(+ : number_remaining)
+	for (std::int64_t z = 0; z < num_slices; ++z)
+	{
+		number_remaining += std::count(slices[z], slices[z] + area, foreground);
+	}
 
-	return number_remaining;
+	return static_cast<size_t>(number_remaining);
 }
 
 } // namespace iseg
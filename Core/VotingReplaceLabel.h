@@ -1,9 +1,9 @@
 /*
  * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
- * 
+ *
  * This file is part of iSEG
  * (see https://github.com/ITISFoundation/osparc-iseg).
- * 
+ *
  * This software is released under the MIT License.
  *  https://opensource.org/licenses/MIT
  */
@@ -14,6 +14,8 @@
 #include "../Data/Types.h"
 
 #include <array>
+#include <cstddef>
+#include <vector>
 
 namespace iseg {
 
@@ -21,4 +23,14 @@ class SlicesHandlerInterface;
 
 ISEG_CORE_API size_t VotingReplaceLabel(SlicesHandlerInterface* handler, tissues_size_t foreground, tissues_size_t background, std::array<unsigned int, 3> iradius, unsigned int majority_threshold, unsigned int max_iterations);
 
+/** \brief Replace the foreground label by the labels voted for in the neighborhood, in place.
+
+	A foreground voxel takes the most frequent label (other than foreground and background) in
+	the box of the given radius, if it occurs at least majority_threshold times more often than
+	the second most frequent label. All voxels are updated at once per iteration. After the
+	first pass over the whole stack, only foreground voxels near a voxel which changed in the
+	previous iteration are visited again. Returns the number of remaining foreground voxels.
+*/
+ISEG_CORE_API size_t VotingReplaceLabel(const std::array<unsigned, 3>& dims, const std::vector<tissues_size_t*>& slices, tissues_size_t foreground, tissues_size_t background, std::array<unsigned int, 3> iradius, unsigned int majority_threshold, unsigned int max_iterations);
+
 } // namespace iseg
@@ -15,26 +15,21 @@
 #include "Data/Transform.h"
 
 #include <vtkBoundingBox.h>
-#include <vtkCutter.h>
-#include <vtkImageData.h>
-#include <vtkImageStencil.h>
-#include <vtkLinearExtrusionFilter.h>
+#include <vtkCellArray.h>
 #include <vtkNew.h>
-#include <vtkPlane.h>
-#include <vtkPointData.h>
 #include <vtkPoints.h>
 #include <vtkPolyData.h>
-#include <vtkPolyDataToImageStencil.h>
-#include <vtkSTLReader.h>
-#include <vtkStripper.h>
 #include <vtkTransform.h>
 #include <vtkTriangle.h>
-#include <vtkUnsignedCharArray.h>
 
 #include <itkImage.h>
 #include <itkPathIterator.h>
 #include <itkPolyLineParametricPath.h>
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
 namespace iseg {
 
 namespace {
@@ -45,22 +40,6 @@ std::vector<double> to_double(const Transform& transform)
 	return std::vector<double>(begin, begin + 16);
 }
 
-float round_me_up(float n, const float to_what)
-{
-	n *= (1 / to_what);
-	n = ceil(n);
-	n /= (1 / to_what);
-	return n;
-}
-
-float round_me_dn(float n, const float to_what)
-{
-	n *= (1 / to_what);
-	n = floor(n);
-	n /= (1 / to_what);
-	return n;
-}
-
 template<typename TImage>
 VoxelSurface::eSurfaceImageOverlap voxelPolyline(const std::vector<itk::Point<double, 3>>& polyline, TImage* label_field, float label, int startslice, int endslice)
 {
@@ -132,6 +111,72 @@ VoxelSurface::eSurfaceImageOverlap voxelPolyline(const std::vector<itk::Point<do
 	return ret;
 }
 
+using point_type = std::array<double, 3>;
+using triangle_type = std::array<vtkIdType, 3>;
+
+/// Intersection of the edge (p, q) with the plane z = z_pos. The vertices are ordered by id,
+/// so both triangles sharing the edge get exactly the same point.
+inline std::array<double, 2> intersectEdge(const std::vector<point_type>& points, vtkIdType p, vtkIdType q, double z_pos)
+{
+	if (q < p)
+		std::swap(p, q);
+	const auto& a = points[p];
+	const auto& b = points[q];
+	double const t = (z_pos - a[2]) / (b[2] - a[2]);
+	return {a[0] + t * (b[0] - a[0]), a[1] + t * (b[1] - a[1])};
+}
+
+/// Index range [lo, hi] of the grid positions i * spacing within [vmin, vmax], widened by one to absorb rounding
+inline void gridRange(double vmin, double vmax, double spacing, int n, int& lo, int& hi)
+{
+	lo = static_cast<int>(std::ceil(std::max(vmin / spacing - 1.0, 0.0)));
+	hi = static_cast<int>(std::floor(std::min(vmax / spacing + 1.0, n - 1.0)));
+}
+
+/** \brief Fills the interior of the closed contours given as unordered segments (x0, y0, x1, y1).
+
+	A pixel center is inside if a ray along +x crosses the segments an odd number of times. End
+	points on a scan line count as below it, which makes shared end points cross exactly once.
+*/
+void fillSegments(const std::vector<std::array<double, 4>>& segments, std::vector<std::pair<int, double>>& crossings, float* slice, const unsigned dims[3], const float spacing[3], float label)
+{
+	int const width = static_cast<int>(dims[0]);
+	int const height = static_cast<int>(dims[1]);
+
+	crossings.clear();
+	for (const auto& s : segments)
+	{
+		int j0, j1;
+		gridRange(std::min(s[1], s[3]), std::max(s[1], s[3]), spacing[1], height, j0, j1);
+		for (int j = j0; j <= j1; ++j)
+		{
+			double const yc = j * spacing[1];
+			if ((s[1] > yc) != (s[3] > yc))
+			{
+				crossings.emplace_back(j, s[0] + (yc - s[1]) / (s[3] - s[1]) * (s[2] - s[0]));
+			}
+		}
+	}
+	std::sort(crossings.begin(), crossings.end());
+
+	for (size_t k = 0; k < crossings.size();)
+	{
+		// crossings of one row, an odd count can only occur for open surfaces
+		size_t end = k;
+		while (end < crossings.size() && crossings[end].first == crossings[k].first)
+			++end;
+
+		float* row = slice + static_cast<size_t>(crossings[k].first) * width;
+		for (size_t m = k; m + 1 < end; m += 2)
+		{
+			int const i0 = static_cast<int>(std::ceil(std::min(std::max(crossings[m].second / spacing[0], 0.0), static_cast<double>(width))));
+			int const i1 = static_cast<int>(std::ceil(std::min(std::max(crossings[m + 1].second / spacing[0], 0.0), static_cast<double>(width))));
+			std::fill(row + i0, row + std::max(i0, i1), label);
+		}
+		k = end;
+	}
+}
+
 VoxelSurface::eSurfaceImageOverlap voxelSurface(vtkPolyData* surface, float** slices, const unsigned dims[3], const float spacing[3], const Transform& transform, float label, unsigned startslice, unsigned endslice)
 {
 	// instead of applying the transform to the image, we inverse transform the surface
@@ -162,131 +207,108 @@ VoxelSurface::eSurfaceImageOverlap voxelSurface(vtkPolyData* surface, float** sl
 		return VoxelSurface::eSurfaceImageOverlap::kNone;
 	}
 
-	vtkNew<vtkPolyData> surface_inverse_transformed;
-	surface_inverse_transformed->CopyStructure(surface);
-	surface_inverse_transformed->SetPoints(points.Get());
-	surface_inverse_transformed->BuildCells();
-
-	// loop through all the slices in the dataset
-	int zbegin = static_cast<int>(startslice);
-	int zend = static_cast<int>(endslice);
-
-	//#pragma omp parallel for -> leads to crashes, because input->GetBounds is called in Cutter
-	for (int z = zbegin; z < zend; z++)
+	// copy the surface into plain arrays, polygons are split into triangle fans and strips into
+	// their triangles (the orientation does not matter for the crossings)
+	std::vector<point_type> vertices(points->GetNumberOfPoints());
+	for (vtkIdType i = 0; i < points->GetNumberOfPoints(); ++i)
 	{
-		// REMEMBER: image is NOT transformed
-		auto z_pos = z * spacing[2];
-
-		// do not even try cutting if we are out of the surface bounding box
-		if (z_pos < surface_bb.GetBound(4) || z_pos > surface_bb.GetBound(5))
-			continue;
-
-		// place the cutter plane
-		vtkNew<vtkPlane> plane;
-		plane->SetNormal(0, 0, 1);
-		plane->SetOrigin(0, 0, z_pos);
+		points->GetPoint(i, vertices[i].data());
+	}
 
-		// cut the surface with the plane
-		vtkNew<vtkCutter> cutter;
-		cutter->SetCutFunction(plane.Get());
-		cutter->SetInputData(surface_inverse_transformed.Get());
+	std::vector<triangle_type> triangles;
+	vtkIdType npts, *pts;
+	vtkCellArray* polys = surface->GetPolys();
+	for (polys->InitTraversal(); polys->GetNextCell(npts, pts);)
+	{
+		for (vtkIdType i = 2; i < npts; ++i)
+		{
+			triangles.push_back({pts[0], pts[i - 1], pts[i]});
+		}
+	}
+	vtkCellArray* strips = surface->GetStrips();
+	for (strips->InitTraversal(); strips->GetNextCell(npts, pts);)
+	{
+		for (vtkIdType i = 2; i < npts; ++i)
+		{
+			triangles.push_back({pts[i - 2], pts[i - 1], pts[i]});
+		}
+	}
 
-		// extract the contour from the plane
-		vtkNew<vtkStripper> stripper;
-		stripper->SetInputConnection(cutter->GetOutputPort()); // valid circle
-		stripper->Update();
+	// index of the triangles which may cross the plane of each slice
+	int const zbegin = static_cast<int>(startslice);
+	int const zend = static_cast<int>(endslice);
+	std::vector<std::pair<int, int>> ranges(triangles.size());
+	std::vector<size_t> offsets(zend - zbegin + 1, 0);
+	for (size_t t = 0; t < triangles.size(); ++t)
+	{
+		const auto& tri = triangles[t];
+		double const zmin = std::min({vertices[tri[0]][2], vertices[tri[1]][2], vertices[tri[2]][2]});
+		double const zmax = std::max({vertices[tri[0]][2], vertices[tri[1]][2], vertices[tri[2]][2]});
+		int lo, hi;
+		gridRange(zmin, zmax, spacing[2], static_cast<int>(dims[2]), lo, hi);
+		ranges[t] = std::make_pair(std::max(lo, zbegin), std::min(hi, zend - 1));
+		for (int z = ranges[t].first; z <= ranges[t].second; ++z)
+		{
+			offsets[z - zbegin + 1]++;
+		}
+	}
+	for (size_t z = 1; z < offsets.size(); ++z)
+	{
+		offsets[z] += offsets[z - 1];
+	}
+	std::vector<size_t> bucket(offsets.back());
+	{
+		std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+		for (size_t t = 0; t < triangles.size(); ++t)
+		{
+			for (int z = ranges[t].first; z <= ranges[t].second; ++z)
+			{
+				bucket[next[z - zbegin]++] = t;
+			}
+		}
+	}
 
-		vtkPolyData* contour = stripper->GetOutput();
+	// cut and fill the slices independently
+#pragma omp parallel
+	{
+		std::vector<std::array<double, 4>> segments;
+		std::vector<std::pair<int, double>> crossings;
 
-		// check whether there is any contour
-		auto c_number_of_lines = contour->GetNumberOfLines();
-		if (c_number_of_lines > 0)
+#pragma omp for schedule(dynamic)
+		for (std::int64_t z = zbegin; z < zend; ++z)
 		{
-			// create a 2D black image of the same size of the contour
-			vtkNew<vtkImageData> image_data;
+			// REMEMBER: image is NOT transformed
+			double const z_pos = z * spacing[2];
 
-			vtkBoundingBox ct_bounds;
-			{
-				// enlarge the bounding box of the contour to fit the indices of the dataset
-				double bb[6];
-				contour->GetBounds(bb);
-				bb[0] = round_me_dn(bb[0], spacing[0]);
-				bb[1] = round_me_up(bb[1], spacing[0]);
-				bb[2] = round_me_dn(bb[2], spacing[1]);
-				bb[3] = round_me_up(bb[3], spacing[1]);
-				ct_bounds.SetBounds(bb);
-			}
-			// crop if surface is partially outside image
-			ct_bounds.IntersectBox(image_bb);
-			int ct_dim[3] = {};
-			for (int d = 0; d < 3; d++)
+			segments.clear();
+			for (size_t k = offsets[z - zbegin]; k < offsets[z - zbegin + 1]; ++k)
 			{
-				ct_dim[d] = static_cast<int>(std::ceil(ct_bounds.GetLength(d) / spacing[d])) + 1;
-			}
-			const double* ct_origin = ct_bounds.GetMinPoint();
-
-			image_data->SetDimensions(ct_dim[0], ct_dim[1], 1);
-			image_data->SetSpacing(spacing[0], spacing[1], spacing[2]);
-			image_data->SetOrigin(ct_origin[0], ct_origin[1], ct_origin[2]);
-			image_data->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
-			vtkUnsignedCharArray* scalars = vtkUnsignedCharArray::SafeDownCast(image_data->GetPointData()->GetScalars());
-
-			// Fill the image with foreground voxel values
-			unsigned char inval = 255;
-			unsigned char outval = 0;
-			scalars->FillComponent(0, inval);
-
-			// Take the Contour PolyData and fill it
-			// Sweep polygonal data (this is the important thing with contours!)
-			vtkNew<vtkLinearExtrusionFilter> extruder;
-			extruder->SetInputData(contour);
-			extruder->SetScaleFactor(1.);
-			extruder->SetExtrusionTypeToNormalExtrusion();
-			extruder->SetVector(0, 0, 1);
-			extruder->Update();
-
-			// polygonal data --> image stencil:
-			vtkNew<vtkPolyDataToImageStencil> pol2stenc;
-			pol2stenc->SetTolerance(0); // important if extruder->SetVector(0, 0, 1) !!!
-			pol2stenc->SetInputConnection(extruder->GetOutputPort());
-			pol2stenc->SetOutputOrigin(image_data->GetOrigin());
-			pol2stenc->SetOutputSpacing(image_data->GetSpacing());
-			pol2stenc->SetOutputWholeExtent(image_data->GetExtent());
-			pol2stenc->Update();
-
-			// Paste the Contour PolyData on the black image
-			// Cut the corresponding white image and set the background:
-			vtkNew<vtkImageStencil> imgstenc;
-			imgstenc->SetInputData(image_data.Get());
-			imgstenc->SetStencilConnection(pol2stenc->GetOutputPort());
-			imgstenc->ReverseStencilOff();
-			imgstenc->SetBackgroundValue(outval);
-			imgstenc->Update();
-
-			// Add or overwrite the white pixels in the working array
-			vtkImageData* out = imgstenc->GetOutput();
-			float* work_bits = slices[z];
-			if (out->GetNumberOfPoints() > 0)
-			{
-				int offset_x = (int)floor(abs(ct_origin[0] / spacing[0]) + 0.5);
-				int offset_y = (int)floor(abs(ct_origin[1] / spacing[1]) + 0.5);
+				const auto& tri = triangles[bucket[k]];
 
-				for (int ct_y = 0; ct_y < ct_dim[1] - 1; ct_y++)
+				// vertices on the plane count as below it, so each crossing is found once
+				bool above[3];
+				int num_above = 0;
+				for (int i = 0; i < 3; ++i)
 				{
-					for (int ct_x = 0; ct_x < ct_dim[0] - 1; ct_x++)
-					{
-						unsigned char* pixel_val = static_cast<unsigned char*>(out->GetScalarPointer(ct_x, ct_y, 0));
-						if (pixel_val[0] == inval)
-						{
-							// Convert the relative x,y from the contour to the x,y of the dataset
-							int ds_x = offset_x + ct_x;
-							int ds_y = offset_y + ct_y;
-
-							int index = ds_x + ds_y * (dims[0]);
-							work_bits[index] = label;
-						}
-					}
+					above[i] = (vertices[tri[i]][2] > z_pos);
+					num_above += above[i] ? 1 : 0;
 				}
+				if (num_above == 0 || num_above == 3)
+					continue;
+
+				// the vertex alone on its side of the plane
+				int lone = 0;
+				while (above[lone] != (num_above == 1))
+					++lone;
+
+				auto p0 = intersectEdge(vertices, tri[lone], tri[(lone + 1) % 3], z_pos);
+				auto p1 = intersectEdge(vertices, tri[lone], tri[(lone + 2) % 3], z_pos);
+				segments.push_back({p0[0], p0[1], p1[0], p1[1]});
+			}
+
+			if (!segments.empty())
+			{
+				fillSegments(segments, crossings, slices[z], dims, spacing, label);
 			}
 		}
 	}
@@ -299,7 +321,7 @@ VoxelSurface::eSurfaceImageOverlap voxelSurface(vtkPolyData* surface, float** sl
 VoxelSurface::eSurfaceImageOverlap VoxelSurface::Voxelize(vtkPolyData* polydata, std::vector<float*>& all_slices, const unsigned dims[3], const Vec3& spacing, const Transform& transform, unsigned startslice, unsigned endslice) const
 {
 	eSurfaceImageOverlap res = kNone;
-	if (polydata->GetNumberOfPolys() != 0)
+	if (polydata->GetNumberOfPolys() != 0 || polydata->GetNumberOfStrips() != 0)
 	{
 		return voxelSurface(polydata, all_slices.data(), dims, spacing.v, transform, m_ForeGroundValue, startslice, endslice);
 	}
@@ -21,7 +21,7 @@ namespace itk {
  * Vanderhyde, James. "Topology control of volumetric data." 
  * PhD diss., Georgia Institute of Technology, 2007..
  */
-template<class TInputImage, class TOutputImage, class TConnectedComponentImage = itk::Image<unsigned short, 3>>
+template<class TInputImage, class TOutputImage>
 class /*ITK_TEMPLATE_EXPORT*/ FixTopologyCarveInside : public ImageToImageFilter<TInputImage, TOutputImage>
 {
 public:
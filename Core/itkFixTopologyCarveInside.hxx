@@ -3,38 +3,41 @@
 
 #include "itkFixTopologyCarveInside.h"
 
+#include "ConnectedComponents.h"
 #include "Graph.h"
 #include "TopologyInvariants.h"
 #include "itkLabelRegionCalculator.h"
 
-#include <itkConnectedComponentImageFilter.h>
+#include <itkExtractImageFilter.h>
 #include <itkImageRegionConstIterator.h>
 #include <itkImageRegionIterator.h>
 #include <itkNeighborhoodAlgorithm.h>
 #include <itkNeighborhoodIterator.h>
 #include <itkSignedMaurerDistanceMapImageFilter.h>
 
+#include <array>
 #include <iostream>
 #include <queue>
+#include <unordered_map>
 #include <vector>
 
 namespace itk {
 
-template<class TInputImage, class TOutputImage, class TConnectedComponentImage>
-FixTopologyCarveInside<TInputImage, TOutputImage, TConnectedComponentImage>::FixTopologyCarveInside()
+template<class TInputImage, class TOutputImage>
+FixTopologyCarveInside<TInputImage, TOutputImage>::FixTopologyCarveInside()
 {
 	this->SetNumberOfRequiredOutputs(1);
 }
 
-template<class TInputImage, class TOutputImage, class TConnectedComponentImage>
-typename FixTopologyCarveInside<TInputImage, TOutputImage, TConnectedComponentImage>::OutputImageType*
-		FixTopologyCarveInside<TInputImage, TOutputImage, TConnectedComponentImage>::GetThinning()
+template<class TInputImage, class TOutputImage>
+typename FixTopologyCarveInside<TInputImage, TOutputImage>::OutputImageType*
+		FixTopologyCarveInside<TInputImage, TOutputImage>::GetThinning()
 {
 	return dynamic_cast<OutputImageType*>(this->ProcessObject::GetOutput(0));
 }
 
-template<class TInputImage, class TOutputImage, class TConnectedComponentImage>
-void FixTopologyCarveInside<TInputImage, TOutputImage, TConnectedComponentImage>::PrepareData()
+template<class TInputImage, class TOutputImage>
+void FixTopologyCarveInside<TInputImage, TOutputImage>::PrepareData()
 {
 	auto thinImage = GetThinning();
 	thinImage->SetBufferedRegion(thinImage->GetRequestedRegion());
@@ -42,8 +45,8 @@ void FixTopologyCarveInside<TInputImage, TOutputImage, TConnectedComponentImage>
 	thinImage->FillBuffer(m_OutsideValue);
 }
 
-template<class TInputImage, class TOutputImage, class TConnectedComponentImage>
-void FixTopologyCarveInside<TInputImage, TOutputImage, TConnectedComponentImage>::ComputeThinImage()
+template<class TInputImage, class TOutputImage>
+void FixTopologyCarveInside<TInputImage, TOutputImage>::ComputeThinImage()
 {
 	using namespace topology;
 
@@ -65,15 +68,25 @@ void FixTopologyCarveInside<TInputImage, TOutputImage, TConnectedComponentImage>
 	NeighborhoodIteratorType ot(radius, thinImage, region);
 	ot.SetBoundaryCondition(boundaryCondition);
 
+	// Work on the bounding box, padded by one voxel so that the distances are the same as for the whole image
+	auto padded = region;
+	padded.PadByRadius(1);
+	padded.Crop(inputImage->GetLargestPossibleRegion());
+
+	auto extract = itk::ExtractImageFilter<InputImageType, InputImageType>::New();
+	extract->SetInput(inputImage);
+	extract->SetExtractionRegion(padded);
+	extract->Update();
+	auto cropped = extract->GetOutput();
+
 	// Compute distance - negative values inside
 	using DistanceImageType = itk::Image<float, InputImageDimension>;
 	auto distance_filter = itk::SignedMaurerDistanceMapImageFilter<TInputImage, DistanceImageType>::New();
-	distance_filter->SetInput(inputImage);
+	distance_filter->SetInput(cropped);
 	distance_filter->UseImageSpacingOn();
 	distance_filter->SquaredDistanceOn();
 	distance_filter->InsideIsPositiveOn(); // inside is positive
 	distance_filter->SetBackgroundValue(m_OutsideValue);
-	distance_filter->GetOutput()->SetRequestedRegion(region);
 	distance_filter->Update();
 	auto distance_map = distance_filter->GetOutput();
 
@@ -95,27 +108,34 @@ void FixTopologyCarveInside<TInputImage, TOutputImage, TConnectedComponentImage>
 
 	// Add seeds
 	{
-		auto ccfilter = itk::ConnectedComponentImageFilter<InputImageType, TConnectedComponentImage>::New();
-		ccfilter->SetInput(inputImage);
-		ccfilter->SetBackgroundValue(m_OutsideValue);
-		ccfilter->FullyConnectedOff(); // face-connected off
-		ccfilter->Update();
-		auto components_image = ccfilter->GetOutput();
+		// face-connected components of the inside, in the padded bounding box
+		using labeling_type = iseg::ConnectedComponents<InputImagePixelType>;
+		std::array<unsigned, 3> const dims = {
+				static_cast<unsigned>(padded.GetSize(0)),
+				static_cast<unsigned>(padded.GetSize(1)),
+				static_cast<unsigned>(padded.GetSize(2))};
+		size_t const area = static_cast<size_t>(dims[0]) * dims[1];
+		std::vector<InputImagePixelType*> slices;
+		for (unsigned z = 0; z < dims[2]; ++z)
+		{
+			slices.push_back(cropped->GetBufferPointer() + z * area);
+		}
+		auto const outside = m_OutsideValue;
+		labeling_type labeling(dims, labeling_type::kFaces);
+		labeling.Compute(slices, [outside](InputImagePixelType v) { return v != outside; }, false);
 
 		// Find most interior (positive) seed point for each component
-		std::vector<node> best_seeds(ccfilter->GetObjectCount(), std::make_pair(-1.f, index_t()));
+		std::vector<node> best_seeds(labeling.NumComponents(), std::make_pair(-1.f, index_t()));
 
-		auto cit = itk::ImageRegionConstIterator<TConnectedComponentImage>(components_image, region);
-		auto dit = itk::ImageRegionConstIterator<DistanceImageType>(distance_map, region);
-		for (cit.GoToBegin(), dit.GoToBegin(); !cit.IsAtEnd(); ++cit, ++dit)
+		auto dit = itk::ImageRegionConstIterator<DistanceImageType>(distance_map, padded);
+		size_t i = 0;
+		for (dit.GoToBegin(); !dit.IsAtEnd(); ++dit, ++i)
 		{
-			if (cit.Get() > 0)
+			auto const c = labeling.Label(i);
+			if (c != labeling_type::k_background)
 			{
-				// map to zero-based index
-				int c = cit.Get() - 1;
-
 				// inside distances are positive
-				if (dit.Get() > best_seeds.at(c).first)
+				if (dit.Get() > best_seeds[c].first)
 				{
 					best_seeds[c].first = dit.Get();
 					best_seeds[c].second = dit.GetIndex();
@@ -160,7 +180,16 @@ void FixTopologyCarveInside<TInputImage, TOutputImage, TConnectedComponentImage>
 	XCore::CUniformGridGraph<index_t, 3> graph(dims, spacing);
 
 	// Carve from outside
-	while (true)
+	// Voxels which could not be carved, with their cost and round. The test only depends on the
+	// 3x3x3 neighborhood, so they are examined again only after a neighbor has been carved.
+	struct parked_node
+	{
+		float cost;
+		int round;
+	};
+	std::unordered_map<OffsetValueType, parked_node> parked;
+
+	for (int round = 0;; ++round)
 	{
 		std::priority_queue<node, std::vector<node>, comp> delayed_queue;
 		int num_carved = 0;
@@ -189,18 +218,34 @@ void FixTopologyCarveInside<TInputImage, TOutputImage, TConnectedComponentImage>
 				}
 			}
 
+			auto neighbors = graph.Neighbors(id);
 			if (can_carve)
 			{
 				thinImage->SetPixel(id, m_InsideValue);
 				num_carved++;
+
+				// the cost of a delayed voxel decreases by 0.5 per round, if it comes after the current
+				// voxel it is examined again in this round, else in the next
+				for (const auto& neighbor : neighbors)
+				{
+					auto it = parked.find(thinImage->ComputeOffset(neighbor));
+					if (it != parked.end())
+					{
+						float const cost = it->second.cost - 0.5f * (round - it->second.round);
+						if (cost < d)
+							queue.push(std::make_pair(cost, neighbor));
+						else
+							delayed_queue.push(std::make_pair(cost - 0.5f, neighbor));
+						parked.erase(it);
+					}
+				}
 			}
 			else
 			{
-				delayed_queue.push(std::make_pair(d - 0.5f, id));
+				parked[thinImage->ComputeOffset(id)] = parked_node{d, round};
 			}
 
 			// update neighboring values
-			auto neighbors = graph.Neighbors(id);
 			for (const auto& neighbor : neighbors)
 			{
 				// skip if neighbor is not inside object
@@ -219,16 +264,16 @@ void FixTopologyCarveInside<TInputImage, TOutputImage, TConnectedComponentImage>
 	}
 }
 
-template<class TInputImage, class TOutputImage, class TConnectedComponentImage>
-void FixTopologyCarveInside<TInputImage, TOutputImage, TConnectedComponentImage>::GenerateData()
+template<class TInputImage, class TOutputImage>
+void FixTopologyCarveInside<TInputImage, TOutputImage>::GenerateData()
 {
 	this->PrepareData();
 
 	this->ComputeThinImage();
 }
 
-template<class TInputImage, class TOutputImage, class TConnectedComponentImage>
-void FixTopologyCarveInside<TInputImage, TOutputImage, TConnectedComponentImage>::PrintSelf(std::ostream& os, Indent indent) const
+template<class TInputImage, class TOutputImage>
+void FixTopologyCarveInside<TInputImage, TOutputImage>::PrintSelf(std::ostream& os, Indent indent) const
 {
 	Superclass::PrintSelf(os, indent);
 }
@@ -7,6 +7,7 @@
 #include "TopologyInvariants.h"
 #include "itkLabelRegionCalculator.h"
 
+#include <itkExtractImageFilter.h>
 #include <itkImageRegionConstIterator.h>
 #include <itkImageRegionIterator.h>
 #include <itkNeighborhoodAlgorithm.h>
@@ -15,6 +16,7 @@
 
 #include <iostream>
 #include <queue>
+#include <unordered_map>
 #include <vector>
 
 namespace itk {
@@ -77,15 +79,25 @@ void FixTopologyCarveOutside<TInputImage, TOutputImage>::ComputeThinImage()
 	NeighborhoodIteratorType ot(radius, thinImage, region);
 	ot.SetBoundaryCondition(boundaryCondition);
 
+	// Work on the bounding box, padded by one voxel so that the distances are the same as for the whole image
+	auto padded = region;
+	padded.PadByRadius(1);
+	padded.Crop(inputImage->GetLargestPossibleRegion());
+
+	auto extract = itk::ExtractImageFilter<InputImageType, InputImageType>::New();
+	extract->SetInput(inputImage);
+	extract->SetExtractionRegion(padded);
+	extract->Update();
+	auto cropped = extract->GetOutput();
+
 	// Compute distance - negative values inside
 	using DistanceImageType = itk::Image<float, InputImageDimension>;
 	auto distance_filter = itk::SignedMaurerDistanceMapImageFilter<TInputImage, DistanceImageType>::New();
-	distance_filter->SetInput(inputImage);
+	distance_filter->SetInput(cropped);
 	distance_filter->UseImageSpacingOn();
 	distance_filter->SquaredDistanceOn();
 	distance_filter->InsideIsPositiveOff();
 	distance_filter->SetBackgroundValue(m_OutsideValue);
-	distance_filter->GetOutput()->SetRequestedRegion(region);
 	distance_filter->Update();
 	auto distance_map = distance_filter->GetOutput();
 
@@ -137,7 +149,16 @@ void FixTopologyCarveOutside<TInputImage, TOutputImage>::ComputeThinImage()
 	XCore::CUniformGridGraph<index_t, 3> graph(dims, spacing);
 
 	// Carve from outside
-	while (true)
+	// Voxels which could not be carved, with their cost and round. The test only depends on the
+	// 3x3x3 neighborhood, so they are examined again only after a neighbor has been carved.
+	struct parked_node
+	{
+		float cost;
+		int round;
+	};
+	std::unordered_map<OffsetValueType, parked_node> parked;
+
+	for (int round = 0;; ++round)
 	{
 		std::priority_queue<node, std::vector<node>, comp> delayed_queue;
 		int num_carved = 0;
@@ -164,18 +185,34 @@ void FixTopologyCarveOutside<TInputImage, TOutputImage>::ComputeThinImage()
 				}
 			}
 
+			auto neighbors = graph.Neighbors(id);
 			if (can_carve)
 			{
 				thinImage->SetPixel(id, m_OutsideValue);
 				num_carved++;
+
+				// the cost of a delayed voxel decreases by 0.5 per round, if it comes after the current
+				// voxel it is examined again in this round, else in the next
+				for (const auto& neighbor : neighbors)
+				{
+					auto it = parked.find(thinImage->ComputeOffset(neighbor));
+					if (it != parked.end())
+					{
+						float const cost = it->second.cost - 0.5f * (round - it->second.round);
+						if (cost < d)
+							queue.push(std::make_pair(cost, neighbor));
+						else
+							delayed_queue.push(std::make_pair(cost - 0.5f, neighbor));
+						parked.erase(it);
+					}
+				}
 			}
 			else
 			{
-				delayed_queue.push(std::make_pair(d - 0.5f, id));
+				parked[thinImage->ComputeOffset(id)] = parked_node{d, round};
 			}
 
 			// update neighboring values
-			auto neighbors = graph.Neighbors(id);
 			for (const auto& neighbor : neighbors)
 			{
 				// skip pixels outside
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../CompressedSlices.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace {
+std::vector<const float*> Slices(const std::vector<float>& data, size_t area)
+{
+	std::vector<const float*> slices;
+	for (size_t i = 0; i < data.size(); i += area)
+		slices.push_back(data.data() + i);
+	return slices;
+}
+
+void CheckRoundTrip(const std::vector<float>& data, size_t area)
+{
+	iseg::CompressedSlices compressed(Slices(data, area), area);
+	BOOST_REQUIRE_EQUAL(compressed.NumSlices(), data.size() / area);
+
+	std::vector<float> restored(data.size(), -1.f);
+	std::vector<float*> output;
+	for (size_t i = 0; i < restored.size(); i += area)
+		output.push_back(restored.data() + i);
+	compressed.Decompress(output);
+
+	// compare the bit patterns, which also covers -0 and NaN
+	BOOST_CHECK(std::memcmp(restored.data(), data.data(), data.size() * sizeof(float)) == 0);
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(CompressedSlices_suite);
+
+BOOST_AUTO_TEST_CASE(Quantized)
+{
+	size_t const area = 64 * 48;
+	std::vector<float> data(area * 5);
+	for (size_t i = 0; i < data.size(); ++i)
+		data[i] = static_cast<float>((i / 7) % 300);
+
+	CheckRoundTrip(data, area);
+
+	iseg::CompressedSlices compressed(Slices(data, area), area);
+	BOOST_CHECK_LT(compressed.CompressedSize(), data.size() * sizeof(float) / 2);
+}
+
+BOOST_AUTO_TEST_CASE(Constant)
+{
+	size_t const area = 1000;
+	std::vector<float> data(area * 3, 0.f);
+	CheckRoundTrip(data, area);
+}
+
+BOOST_AUTO_TEST_CASE(Noise)
+{
+	size_t const area = 37 * 29;
+	std::vector<float> data(area * 4);
+	std::srand(3);
+	for (auto& v : data)
+		v = static_cast<float>(std::rand()) / RAND_MAX - 0.5f;
+	data[5] = -0.f;
+	data[9] = std::numeric_limits<float>::quiet_NaN();
+
+	CheckRoundTrip(data, area);
+
+	// incompressible slices are stored as they are
+	iseg::CompressedSlices compressed(Slices(data, area), area);
+	BOOST_CHECK_LE(compressed.CompressedSize(), data.size() * sizeof(float) + compressed.NumSlices());
+}
+
+BOOST_AUTO_TEST_CASE(SingleSlice)
+{
+	size_t const area = 300;
+	std::vector<float> data(area);
+	for (size_t i = 0; i < area; ++i)
+		data[i] = (i < 150) ? 12.5f : static_cast<float>(i);
+
+	iseg::CompressedSlices compressed(Slices(data, area), area);
+	std::vector<float> restored(area);
+	compressed.Decompress(0, restored.data());
+	BOOST_CHECK(restored == data);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../ConnectedComponents.h"
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+namespace {
+typedef iseg::ConnectedComponents<unsigned char> Labeling;
+
+std::vector<unsigned char*> Slices(std::vector<unsigned char>& data, size_t area)
+{
+	std::vector<unsigned char*> slices;
+	for (size_t i = 0; i < data.size(); i += area)
+		slices.push_back(data.data() + i);
+	return slices;
+}
+
+// reference labeling by flood filling, background is 0 and regions are compared by value
+std::vector<long> FloodFill(const std::vector<unsigned char>& data, const std::array<unsigned, 3>& dims, int connectivity, bool compare_values, size_t& num_components)
+{
+	int const w = dims[0], h = dims[1], d = dims[2];
+	std::vector<long> labels(data.size(), -1);
+	num_components = 0;
+	for (size_t start = 0; start < data.size(); ++start)
+	{
+		if (data[start] == 0 || labels[start] >= 0)
+			continue;
+		std::deque<size_t> queue(1, start);
+		labels[start] = static_cast<long>(num_components);
+		while (!queue.empty())
+		{
+			size_t const v = queue.front();
+			queue.pop_front();
+			int const x = v % w, y = (v / w) % h, z = static_cast<int>(v / (static_cast<size_t>(w) * h));
+			for (int dz = -1; dz <= 1; ++dz)
+				for (int dy = -1; dy <= 1; ++dy)
+					for (int dx = -1; dx <= 1; ++dx)
+					{
+						int const order = std::abs(dx) + std::abs(dy) + std::abs(dz);
+						if (order == 0 || (connectivity == 6 && order > 1) || (connectivity == 18 && order > 2))
+							continue;
+						if (x + dx < 0 || x + dx >= w || y + dy < 0 || y + dy >= h || z + dz < 0 || z + dz >= d)
+							continue;
+						size_t const u = (x + dx) + static_cast<size_t>(w) * ((y + dy) + static_cast<size_t>(h) * (z + dz));
+						if (data[u] == 0 || labels[u] >= 0 || (compare_values && data[u] != data[v]))
+							continue;
+						labels[u] = labels[start];
+						queue.push_back(u);
+					}
+		}
+		num_components++;
+	}
+	return labels;
+}
+
+void Check(std::vector<unsigned char>& data, const std::array<unsigned, 3>& dims, Labeling::eConnectivity connectivity, bool compare_values)
+{
+	size_t expected_num = 0;
+	auto expected = FloodFill(data, dims, connectivity, compare_values, expected_num);
+
+	Labeling labeling(dims, connectivity);
+	size_t const num = labeling.Compute(Slices(data, static_cast<size_t>(dims[0]) * dims[1]), [](unsigned char v) { return v != 0; }, compare_values);
+	BOOST_REQUIRE_EQUAL(num, expected_num);
+
+	// both are numbered in the order of the first voxel
+	std::vector<std::uint64_t> volumes(num, 0);
+	size_t wrong = 0;
+	for (size_t i = 0; i < data.size(); ++i)
+	{
+		auto const label = labeling.Label(i);
+		if (expected[i] < 0)
+		{
+			wrong += (label != Labeling::k_background);
+			continue;
+		}
+		wrong += (label != static_cast<std::uint64_t>(expected[i]));
+		if (label < num)
+		{
+			volumes[label]++;
+			const auto& c = labeling.Components()[label];
+			unsigned const x = i % dims[0], y = (i / dims[0]) % dims[1], z = static_cast<unsigned>(i / (static_cast<size_t>(dims[0]) * dims[1]));
+			wrong += (x < c.m_Min[0] || x > c.m_Max[0] || y < c.m_Min[1] || y > c.m_Max[1] || z < c.m_Min[2] || z > c.m_Max[2]);
+			wrong += (compare_values && c.m_Value != data[i]);
+		}
+	}
+	BOOST_CHECK_EQUAL(wrong, 0);
+	for (size_t i = 0; i < num; ++i)
+	{
+		BOOST_CHECK_EQUAL(labeling.Components()[i].m_Volume, volumes[i]);
+	}
+}
+
+std::vector<unsigned char> Random(size_t size, int num_values, int percent_zero)
+{
+	std::vector<unsigned char> data(size);
+	for (auto& v : data)
+		v = (std::rand() % 100 < percent_zero) ? 0 : static_cast<unsigned char>(1 + std::rand() % num_values);
+	return data;
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(ConnectedComponents_suite);
+
+BOOST_AUTO_TEST_CASE(Volume)
+{
+	std::srand(7);
+	std::array<unsigned, 3> const dims = {23, 17, 131};
+	for (auto connectivity : {Labeling::kFaces, Labeling::kEdges, Labeling::kVertices})
+	{
+		auto data = Random(static_cast<size_t>(dims[0]) * dims[1] * dims[2], 2, 40);
+		Check(data, dims, connectivity, true);
+		Check(data, dims, connectivity, false);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(Slice)
+{
+	std::srand(11);
+	std::array<unsigned, 3> const dims = {41, 1500, 1};
+	for (auto connectivity : {Labeling::kFaces, Labeling::kEdges})
+	{
+		auto data = Random(static_cast<size_t>(dims[0]) * dims[1], 3, 30);
+		Check(data, dims, connectivity, true);
+		Check(data, dims, connectivity, false);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(Spiral)
+{
+	// a single component which winds through all blocks and back
+	std::array<unsigned, 3> const dims = {8, 3, 200};
+	std::vector<unsigned char> data(static_cast<size_t>(dims[0]) * dims[1] * dims[2], 0);
+	for (unsigned z = 0; z < dims[2]; ++z)
+	{
+		data[z * 24] = 1;
+		data[z * 24 + 7] = 1;
+	}
+	for (unsigned x = 0; x < dims[0]; ++x)
+	{
+		data[(dims[2] - 1) * 24 + 16 + x] = 1;
+		data[(dims[2] - 1) * 24 + 8 + x] = (x == 0 || x == 7);
+	}
+	Check(data, dims, Labeling::kFaces, true);
+
+	Labeling labeling(dims, Labeling::kFaces);
+	BOOST_REQUIRE_EQUAL(labeling.Compute(Slices(data, 24)), 2);
+	BOOST_CHECK_EQUAL(labeling.Components()[0].m_Value, 1);
+	BOOST_CHECK_EQUAL(labeling.Components()[0].m_Volume, 2 * dims[2] + 2 + 8);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../DistanceTransform.h"
+
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+namespace {
+float SquaredDistance(size_t i, size_t j, const std::array<unsigned, 3>& dims, const std::array<float, 3>& spacing)
+{
+	float d2 = 0.f;
+	for (int k = 0; k < 3; ++k)
+	{
+		float const d = (static_cast<float>(i % dims[k]) - static_cast<float>(j % dims[k])) * spacing[k];
+		d2 += d * d;
+		i /= dims[k];
+		j /= dims[k];
+	}
+	return d2;
+}
+
+void CheckBruteForce(const std::array<unsigned, 3>& dims, const std::array<float, 3>& spacing)
+{
+	size_t const n = static_cast<size_t>(dims[0]) * dims[1] * dims[2];
+	std::vector<unsigned char> seeds(n, 0);
+	std::srand(42);
+	for (int i = 0; i < 12; ++i)
+	{
+		seeds[std::rand() % n] = 1;
+	}
+
+	std::vector<float> sqdist(n);
+	std::vector<unsigned> nearest(n);
+	iseg::DistanceTransform edt(dims, spacing);
+	edt.SquaredDistance(seeds.data(), sqdist.data(), nearest.data());
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		float expected = std::numeric_limits<float>::max();
+		for (size_t j = 0; j < n; ++j)
+		{
+			if (seeds[j])
+				expected = std::min(expected, SquaredDistance(i, j, dims, spacing));
+		}
+		BOOST_REQUIRE_CLOSE_FRACTION(sqdist[i] + 1.f, expected + 1.f, 1e-4f);
+
+		// ties may be resolved differently
+		BOOST_REQUIRE(nearest[i] < n && seeds[nearest[i]]);
+		BOOST_REQUIRE_CLOSE_FRACTION(SquaredDistance(i, nearest[i], dims, spacing) + 1.f, expected + 1.f, 1e-4f);
+	}
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(DistanceTransform_suite);
+
+BOOST_AUTO_TEST_CASE(BruteForce2D)
+{
+	CheckBruteForce({37, 23, 1}, {1.f, 1.f, 1.f});
+	CheckBruteForce({37, 23, 1}, {0.5f, 1.3f, 1.f});
+}
+
+BOOST_AUTO_TEST_CASE(BruteForce3D)
+{
+	CheckBruteForce({17, 13, 11}, {1.f, 1.f, 1.f});
+	CheckBruteForce({17, 13, 11}, {0.7f, 0.7f, 2.5f});
+}
+
+BOOST_AUTO_TEST_CASE(NoSeeds)
+{
+	std::array<unsigned, 3> dims = {8, 8, 4};
+	std::vector<unsigned char> seeds(256, 0);
+	std::vector<float> dist(256);
+	std::vector<unsigned> nearest(256);
+
+	iseg::DistanceTransform edt(dims);
+	edt.Distance(seeds.data(), dist.data(), nearest.data());
+	for (size_t i = 0; i < dist.size(); ++i)
+	{
+		BOOST_CHECK(std::isinf(dist[i]));
+		BOOST_CHECK_EQUAL(nearest[i], 256);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(SignedDistance)
+{
+	// disk of radius 10 in a 64 x 64 image
+	std::array<unsigned, 3> dims = {64, 64, 1};
+	std::vector<unsigned char> object(64 * 64);
+	for (unsigned y = 0, i = 0; y < 64; ++y)
+	{
+		for (unsigned x = 0; x < 64; ++x, ++i)
+		{
+			object[i] = (x - 32.f) * (x - 32.f) + (y - 32.f) * (y - 32.f) <= 100.f;
+		}
+	}
+
+	std::vector<float> dist(object.size());
+	iseg::DistanceTransform edt(dims);
+	edt.SignedDistance(object.data(), dist.data());
+
+	BOOST_CHECK_EQUAL(dist[32 * 64 + 42], 0.f);
+	BOOST_CHECK_CLOSE(dist[32 * 64 + 32], std::sqrt(82.f), 1e-3); // (41, 33) is on the boundary
+	BOOST_CHECK_CLOSE(dist[32 * 64 + 50], -8.f, 1e-3);
+	BOOST_CHECK_EQUAL(dist[32 * 64 + 22], 0.f);
+	BOOST_CHECK_LT(dist[0], -30.f);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
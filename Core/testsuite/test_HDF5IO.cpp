@@ -81,6 +81,56 @@ BOOST_AUTO_TEST_CASE(WriteRead)
 	}
 }
 
+BOOST_AUTO_TEST_CASE(CopyData)
+{
+	std::string src_fname = (fs::temp_directory_path() / fs::path("foo_src.h5")).string();
+	std::string dst_fname = (fs::temp_directory_path() / fs::path("foo_dst.h5")).string();
+
+	size_t slice_size = 2048;
+	std::vector<unsigned short> data1(slice_size, 3);
+	std::vector<unsigned short> data2(slice_size, 7);
+	std::vector<unsigned short*> slices = {data1.data(), data2.data()};
+
+	iseg::HDF5IO io(1);
+	{
+		auto fid = io.Create(src_fname, false);
+		BOOST_REQUIRE(fid >= 0);
+		BOOST_CHECK(io.WriteData(fid, "Tissue", slices.data(), 2, slice_size));
+		BOOST_CHECK(io.Close(fid));
+	}
+
+	// same compression -> raw chunk copy, different compression -> decompress and recompress
+	for (int compression : {1, 0})
+	{
+		iseg::HDF5IO dst_io(compression);
+		auto dst = dst_io.Create(dst_fname, false);
+		BOOST_REQUIRE(dst >= 0);
+		unsigned short** const null = nullptr;
+		BOOST_CHECK(dst_io.WriteData(dst, "Tissue", null, 3, slice_size));
+
+		auto src = io.Open(src_fname);
+		BOOST_REQUIRE(src >= 0);
+		BOOST_CHECK(dst_io.CopyData<unsigned short>(src, "Tissue", 0, 2 * slice_size, dst, "Tissue", slice_size, 1000));
+		BOOST_CHECK(dst_io.FillData<unsigned short>(dst, "Tissue", 0, slice_size, 1, 1000));
+		BOOST_CHECK(io.Close(src));
+
+		std::vector<unsigned short> data(3 * slice_size);
+		BOOST_CHECK(dst_io.ReadData(dst, "Tissue", 0, data.size(), data.data()));
+		BOOST_CHECK(dst_io.Close(dst));
+
+		BOOST_CHECK_EQUAL(data[0], 1);
+		BOOST_CHECK_EQUAL(data[slice_size - 1], 1);
+		BOOST_CHECK_EQUAL(data[slice_size], 3);
+		BOOST_CHECK_EQUAL(data[2 * slice_size - 1], 3);
+		BOOST_CHECK_EQUAL(data[2 * slice_size], 7);
+		BOOST_CHECK_EQUAL(data[3 * slice_size - 1], 7);
+	}
+
+	boost::system::error_code ec;
+	fs::remove(src_fname, ec);
+	fs::remove(dst_fname, ec);
+}
+
 BOOST_AUTO_TEST_CASE(IO_Performance)
 {
 	std::string dname = "MyArray";
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../ProjectSlices.h"
+
+#include <boost/filesystem.hpp>
+
+#include <cstdint>
+#include <string>
+
+namespace fs = boost::filesystem;
+
+namespace {
+iseg::Mark MakeMark(short x, short y, unsigned label, const std::string& name = "")
+{
+	iseg::Mark m(label);
+	m.p.px = x;
+	m.p.py = y;
+	m.name = name;
+	return m;
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(ProjectSlices_suite);
+
+BOOST_AUTO_TEST_CASE(WriteRead)
+{
+	iseg::SliceAnnotations a;
+	a.m_Width = 12;
+	a.m_Height = 7;
+	a.m_Mode1 = 2;
+	a.m_Mode2 = 1;
+	a.m_Marks.push_back(MakeMark(1, 2, 3, "first"));
+	a.m_Marks.push_back(MakeMark(4, 5, 6));
+	a.m_Vvm.resize(2);
+	a.m_Vvm[0].push_back(MakeMark(0, 1, 7));
+	a.m_Vvm[0].push_back(MakeMark(2, 3, 7));
+	a.m_Vvm[1].push_back(MakeMark(4, 6, 8));
+	a.m_Limits.resize(1);
+	a.m_Limits[0].push_back(iseg::Point{9, 10});
+
+	iseg::SliceAnnotations empty;
+	empty.m_Width = 12;
+	empty.m_Height = 7;
+
+	iseg::ProjectSlices container;
+	container.Resize(2);
+	container.Encode(0, a);
+	container.Encode(1, empty);
+
+	boost::system::error_code ec;
+	std::string fname = (fs::temp_directory_path() / fs::path("slices.bin")).string();
+	{
+		FILE* fp = fopen(fname.c_str(), "wb");
+		BOOST_REQUIRE(fp != nullptr);
+		BOOST_CHECK(container.Write(fp));
+		fclose(fp);
+	}
+
+	iseg::ProjectSlices loaded;
+	{
+		FILE* fp = fopen(fname.c_str(), "rb");
+		BOOST_REQUIRE(fp != nullptr);
+		BOOST_CHECK(loaded.Read(fp));
+		fclose(fp);
+	}
+	fs::remove(fname, ec);
+
+	BOOST_REQUIRE_EQUAL(loaded.Size(), 2);
+
+	iseg::SliceAnnotations b;
+	BOOST_REQUIRE(loaded.Decode(0, b));
+	BOOST_CHECK_EQUAL(b.m_Width, 12);
+	BOOST_CHECK_EQUAL(b.m_Height, 7);
+	BOOST_CHECK_EQUAL(b.m_Mode1, 2);
+	BOOST_CHECK_EQUAL(b.m_Mode2, 1);
+	BOOST_REQUIRE_EQUAL(b.m_Marks.size(), 2);
+	BOOST_CHECK_EQUAL(b.m_Marks[0].name, "first");
+	BOOST_CHECK_EQUAL(b.m_Marks[1].name, "");
+	BOOST_CHECK_EQUAL(b.m_Marks[1].p.px, 4);
+	BOOST_CHECK_EQUAL(b.m_Marks[1].mark, 6);
+	BOOST_REQUIRE_EQUAL(b.m_Vvm.size(), 2);
+	BOOST_REQUIRE_EQUAL(b.m_Vvm[0].size(), 2);
+	BOOST_CHECK_EQUAL(b.m_Vvm[0][1].p.py, 3);
+	BOOST_CHECK_EQUAL(b.m_Vvm[1][0].mark, 8);
+	BOOST_REQUIRE_EQUAL(b.m_Limits.size(), 1);
+	BOOST_CHECK_EQUAL(b.m_Limits[0][0].px, 9);
+	BOOST_CHECK_EQUAL(b.m_Limits[0][0].py, 10);
+
+	BOOST_REQUIRE(loaded.Decode(1, b));
+	BOOST_CHECK(b.m_Marks.empty());
+	BOOST_CHECK(b.m_Vvm.empty());
+	BOOST_CHECK(b.m_Limits.empty());
+
+	// blocks are copied without decoding
+	iseg::ProjectSlices merged;
+	merged.Append(loaded, 0, 2);
+	merged.Append(container, 0, 1);
+	BOOST_REQUIRE_EQUAL(merged.Size(), 3);
+	BOOST_REQUIRE(merged.Decode(2, b));
+	BOOST_CHECK_EQUAL(b.m_Marks[0].name, "first");
+}
+
+BOOST_AUTO_TEST_CASE(CorruptDataSize)
+{
+	iseg::SliceAnnotations a;
+	a.m_Width = 3;
+	a.m_Height = 2;
+	a.m_Marks.push_back(MakeMark(1, 1, 2, "mark"));
+
+	iseg::ProjectSlices container;
+	container.Resize(1);
+	container.Encode(0, a);
+
+	boost::system::error_code ec;
+	std::string fname = (fs::temp_directory_path() / fs::path("slices_corrupt.bin")).string();
+	{
+		FILE* fp = fopen(fname.c_str(), "wb");
+		BOOST_REQUIRE(fp != nullptr);
+		BOOST_CHECK(container.Write(fp));
+		fclose(fp);
+	}
+
+	// the data size follows the magic, version and number of slices
+	{
+		FILE* fp = fopen(fname.c_str(), "r+b");
+		BOOST_REQUIRE(fp != nullptr);
+		std::uint64_t const data_size = std::uint64_t(1) << 60;
+		BOOST_REQUIRE(fseek(fp, 4 + 4 + 8, SEEK_SET) == 0);
+		BOOST_CHECK(fwrite(&data_size, sizeof(data_size), 1, fp) == 1);
+		fclose(fp);
+	}
+
+	iseg::ProjectSlices loaded;
+	{
+		FILE* fp = fopen(fname.c_str(), "rb");
+		BOOST_REQUIRE(fp != nullptr);
+		BOOST_CHECK(!loaded.Read(fp));
+		fclose(fp);
+	}
+	fs::remove(fname, ec);
+
+	BOOST_CHECK_EQUAL(loaded.Size(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
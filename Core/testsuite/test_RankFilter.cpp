@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../RankFilter.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+struct Image
+{
+	Image(const std::array<unsigned, 3>& dims, bool integer) : m_Dims(dims), m_Data(dims[0] * dims[1] * dims[2])
+	{
+		std::srand(7);
+		for (auto& v : m_Data)
+		{
+			v = static_cast<float>(std::rand() % 200) - 50.f;
+			if (!integer)
+				v *= 0.37f;
+		}
+	}
+
+	std::vector<const float*> Input() const
+	{
+		std::vector<const float*> slices;
+		for (unsigned z = 0; z < m_Dims[2]; ++z)
+			slices.push_back(m_Data.data() + z * m_Dims[0] * m_Dims[1]);
+		return slices;
+	}
+
+	float BruteForce(unsigned x, unsigned y, unsigned z, const std::array<unsigned, 3>& radius, float percentile) const
+	{
+		std::vector<float> values;
+		unsigned const c[3] = {x, y, z};
+		unsigned lo[3], hi[3];
+		for (int k = 0; k < 3; ++k)
+		{
+			lo[k] = c[k] >= radius[k] ? c[k] - radius[k] : 0;
+			hi[k] = std::min(c[k] + radius[k], m_Dims[k] - 1);
+		}
+		for (unsigned k = lo[2]; k <= hi[2]; ++k)
+			for (unsigned j = lo[1]; j <= hi[1]; ++j)
+				for (unsigned i = lo[0]; i <= hi[0]; ++i)
+					values.push_back(m_Data[(k * m_Dims[1] + j) * m_Dims[0] + i]);
+		std::sort(values.begin(), values.end());
+		return values[static_cast<size_t>(std::floor(percentile / 100.0 * (values.size() - 1) + 0.5))];
+	}
+
+	std::array<unsigned, 3> m_Dims;
+	std::vector<float> m_Data;
+};
+
+void CheckPercentile(const Image& image, const std::array<unsigned, 3>& radius, float percentile)
+{
+	auto const& dims = image.m_Dims;
+	std::vector<float> result(image.m_Data.size());
+	std::vector<float*> output;
+	for (unsigned z = 0; z < dims[2]; ++z)
+		output.push_back(result.data() + z * dims[0] * dims[1]);
+
+	iseg::RankFilter filter(dims, radius);
+	filter.Percentile(image.Input(), output, percentile);
+
+	size_t i = 0;
+	for (unsigned z = 0; z < dims[2]; ++z)
+		for (unsigned y = 0; y < dims[1]; ++y)
+			for (unsigned x = 0; x < dims[0]; ++x, ++i)
+				BOOST_REQUIRE_EQUAL(result[i], image.BruteForce(x, y, z, radius, percentile));
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(RankFilter_suite);
+
+BOOST_AUTO_TEST_CASE(Median3x3)
+{
+	Image image({31, 17, 1}, false);
+	CheckPercentile(image, {1, 1, 0}, 50.f);
+}
+
+BOOST_AUTO_TEST_CASE(Histogram)
+{
+	Image image({23, 19, 6}, true);
+	CheckPercentile(image, {3, 3, 1}, 50.f);
+	CheckPercentile(image, {2, 1, 0}, 10.f);
+	CheckPercentile(image, {12, 2, 2}, 90.f);
+}
+
+BOOST_AUTO_TEST_CASE(Selection)
+{
+	Image image({23, 19, 6}, false);
+	CheckPercentile(image, {3, 3, 1}, 50.f);
+	CheckPercentile(image, {2, 2, 0}, 25.f);
+}
+
+BOOST_AUTO_TEST_CASE(InterquartileRange)
+{
+	Image image({16, 16, 1}, true);
+	std::vector<float> result(image.m_Data.size());
+
+	iseg::RankFilter filter(image.m_Dims, {2, 2, 0});
+	filter.InterquartileRange(image.m_Data.data(), result.data());
+	for (unsigned y = 0, i = 0; y < 16; ++y)
+		for (unsigned x = 0; x < 16; ++x, ++i)
+			BOOST_REQUIRE_EQUAL(result[i], image.BruteForce(x, y, 0, {2, 2, 0}, 75.f) - image.BruteForce(x, y, 0, {2, 2, 0}, 25.f));
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../SliceStackFilter.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+struct Stack
+{
+	Stack(const std::array<unsigned, 3>& dims) : m_Dims(dims), m_Data(dims[0] * dims[1] * dims[2])
+	{
+		std::srand(3);
+		for (auto& v : m_Data)
+			v = static_cast<float>(std::rand() % 256);
+	}
+
+	std::vector<float*> Slices()
+	{
+		std::vector<float*> slices;
+		for (unsigned z = 0; z < m_Dims[2]; ++z)
+			slices.push_back(m_Data.data() + z * m_Dims[0] * m_Dims[1]);
+		return slices;
+	}
+
+	float At(int x, int y, int z) const
+	{
+		x = std::min(std::max(x, 0), static_cast<int>(m_Dims[0]) - 1);
+		y = std::min(std::max(y, 0), static_cast<int>(m_Dims[1]) - 1);
+		z = std::min(std::max(z, 0), static_cast<int>(m_Dims[2]) - 1);
+		return m_Data[(z * m_Dims[1] + y) * m_Dims[0] + x];
+	}
+
+	std::array<unsigned, 3> m_Dims;
+	std::vector<float> m_Data;
+};
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(SliceStackFilter_suite);
+
+BOOST_AUTO_TEST_CASE(Convolve)
+{
+	Stack stack({13, 11, 9});
+	Stack const original = stack;
+	std::array<std::vector<float>, 3> kernels = {
+			std::vector<float>{0.4f, 0.2f, 0.1f},
+			std::vector<float>{0.5f, 0.25f},
+			iseg::SliceStackFilter::GaussianKernel(1.f)};
+
+	iseg::SliceStackFilter filter(stack.m_Dims, stack.Slices());
+	filter.Convolve(kernels);
+
+	int const r[3] = {2, 1, static_cast<int>(kernels[2].size()) - 1};
+	size_t i = 0;
+	for (int z = 0; z < 9; ++z)
+	{
+		for (int y = 0; y < 11; ++y)
+		{
+			for (int x = 0; x < 13; ++x, ++i)
+			{
+				float expected = 0.f;
+				for (int c = -r[2]; c <= r[2]; ++c)
+					for (int b = -r[1]; b <= r[1]; ++b)
+						for (int a = -r[0]; a <= r[0]; ++a)
+							expected += kernels[0][std::abs(a)] * kernels[1][std::abs(b)] * kernels[2][std::abs(c)] * original.At(x + a, y + b, z + c);
+				BOOST_REQUIRE_CLOSE(stack.m_Data[i], expected, 1e-3);
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(Average)
+{
+	Stack stack({8, 8, 8});
+	std::fill(stack.m_Data.begin(), stack.m_Data.end(), 3.f);
+
+	iseg::SliceStackFilter filter(stack.m_Dims, stack.Slices());
+	filter.Average({3, 5, 3});
+	for (auto v : stack.m_Data)
+		BOOST_REQUIRE_CLOSE(v, 3.f, 1e-3);
+}
+
+BOOST_AUTO_TEST_CASE(AnisotropicDiffusion)
+{
+	// the slabs must give the same result as a Jacobi update of the whole stack
+	Stack stack({9, 7, 21});
+	Stack reference = stack;
+	Stack expected = stack;
+	float const dt = 0.1f, restraint = 0.2f;
+	iseg::RationalConductance conductance(20.f);
+
+	for (int it = 0; it < 3; ++it)
+	{
+		Stack const old = expected;
+		size_t i = 0;
+		for (int z = 0; z < 21; ++z)
+		{
+			for (int y = 0; y < 7; ++y)
+			{
+				for (int x = 0; x < 9; ++x, ++i)
+				{
+					float const c = old.m_Data[i];
+					float sum = restraint * (reference.m_Data[i] - c);
+					int const n[6][3] = {{-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}};
+					for (auto const& o : n)
+					{
+						int const xn = x + o[0], yn = y + o[1], zn = z + o[2];
+						if (xn < 0 || yn < 0 || zn < 0 || xn >= 9 || yn >= 7 || zn >= 21)
+							continue;
+						float const d = old.At(xn, yn, zn) - c;
+						sum += conductance(d) * d;
+					}
+					expected.m_Data[i] = c + dt * sum;
+				}
+			}
+		}
+	}
+
+	auto ref_slices = reference.Slices();
+	iseg::SliceStackFilter filter(stack.m_Dims, stack.Slices());
+	filter.AnisotropicDiffusion(std::vector<const float*>(ref_slices.begin(), ref_slices.end()), dt, 3, conductance, restraint);
+	for (size_t i = 0; i < stack.m_Data.size(); ++i)
+		BOOST_REQUIRE_CLOSE(stack.m_Data[i], expected.m_Data[i], 1e-3);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
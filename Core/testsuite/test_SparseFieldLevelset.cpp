@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../SparseFieldLevelset.h"
+
+#include <cmath>
+#include <vector>
+
+namespace {
+std::vector<float> Sphere(const std::array<unsigned, 3>& dims, float radius)
+{
+	std::vector<float> phi(static_cast<size_t>(dims[0]) * dims[1] * dims[2]);
+	float const c[3] = {dims[0] / 2.f, dims[1] / 2.f, dims[2] / 2.f};
+	size_t n = 0;
+	for (unsigned z = 0; z < dims[2]; ++z)
+	{
+		for (unsigned y = 0; y < dims[1]; ++y)
+		{
+			for (unsigned x = 0; x < dims[0]; ++x, ++n)
+			{
+				float const dz = (dims[2] == 1) ? 0.f : z - c[2];
+				phi[n] = radius - std::sqrt((x - c[0]) * (x - c[0]) + (y - c[1]) * (y - c[1]) + dz * dz);
+			}
+		}
+	}
+	return phi;
+}
+
+size_t Inside(const std::vector<float>& phi)
+{
+	size_t n = 0;
+	for (auto v : phi)
+		n += (v > 0);
+	return n;
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(SparseFieldLevelset_suite);
+
+BOOST_AUTO_TEST_CASE(Expand2D)
+{
+	std::array<unsigned, 3> dims = {64, 64, 1};
+	auto phi = Sphere(dims, 5.f);
+	std::vector<float> speed(phi.size(), 1.f);
+
+	iseg::SparseFieldLevelset levelset(dims, phi.data(), speed.data(), nullptr, 1.f, 0.f, 0.5f);
+	BOOST_CHECK_LT(levelset.BandSize(), phi.size() / 4);
+
+	// the circle grows by 0.5 pixels per step
+	levelset.Iterate(20, 5);
+	double const pi = 3.14159265358979;
+	BOOST_CHECK_GT(Inside(phi), pi * 13 * 13);
+	BOOST_CHECK_LT(Inside(phi), pi * 17 * 17);
+	BOOST_CHECK_LT(levelset.BandSize(), phi.size() / 2);
+}
+
+BOOST_AUTO_TEST_CASE(Shrink3D)
+{
+	std::array<unsigned, 3> dims = {32, 32, 32};
+	auto phi = Sphere(dims, 10.f);
+	std::vector<float> speed(phi.size(), 1.f);
+	size_t const initial = Inside(phi);
+
+	iseg::SparseFieldLevelset levelset(dims, phi.data(), speed.data(), nullptr, -1.f, 0.2f, 0.25f);
+	BOOST_CHECK_LT(levelset.BandSize(), phi.size() / 2);
+
+	// the sphere shrinks by about 4 voxels, without reinitializing at fixed intervals
+	levelset.Iterate(16, 0);
+	double const pi = 3.14159265358979;
+	BOOST_CHECK_LT(Inside(phi), initial);
+	BOOST_CHECK_GT(Inside(phi), 4.0 / 3.0 * pi * 5 * 5 * 5);
+	BOOST_CHECK_LT(Inside(phi), 4.0 / 3.0 * pi * 7.5 * 7.5 * 7.5);
+}
+
+BOOST_AUTO_TEST_CASE(Potential)
+{
+	// without speed the front follows the potential gradient: phi_t = -grad P . grad phi
+	std::array<unsigned, 3> dims = {48, 48, 1};
+	auto phi = Sphere(dims, 6.f);
+	std::vector<float> speed(phi.size(), 0.f);
+	std::vector<float> potential(phi.size());
+	for (size_t i = 0; i < potential.size(); ++i)
+	{
+		potential[i] = static_cast<float>(i % dims[0]);
+	}
+	size_t const initial = Inside(phi);
+
+	iseg::SparseFieldLevelset levelset(dims, phi.data(), speed.data(), potential.data(), 0.f, 0.f, 0.5f);
+	levelset.Iterate(10, 4);
+
+	// the disk is transported along grad P to higher x, its area is preserved
+	size_t left = 0, right = 0;
+	for (size_t i = 0; i < phi.size(); ++i)
+	{
+		if (phi[i] > 0)
+			(i % dims[0] < dims[0] / 2 ? left : right)++;
+	}
+	BOOST_CHECK_GT(right, 3 * left);
+	BOOST_CHECK_CLOSE(static_cast<double>(Inside(phi)), static_cast<double>(initial), 15.0);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../VotingReplaceLabel.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+namespace {
+std::vector<tissues_size_t*> Slices(std::vector<tissues_size_t>& data, size_t area)
+{
+	std::vector<tissues_size_t*> slices;
+	for (size_t i = 0; i < data.size(); i += area)
+		slices.push_back(data.data() + i);
+	return slices;
+}
+
+// votes over the whole volume in every iteration, like the ITK label voting filter
+size_t Reference(std::vector<tissues_size_t>& data, const std::array<unsigned, 3>& dims, tissues_size_t fg, tissues_size_t bg, const std::array<unsigned, 3>& r, unsigned majority, unsigned max_iterations)
+{
+	int const w = dims[0], h = dims[1], d = dims[2];
+	for (unsigned iter = 0; iter < max_iterations; ++iter)
+	{
+		auto output = data;
+		size_t changed = 0;
+		for (int z = 0; z < d; ++z)
+			for (int y = 0; y < h; ++y)
+				for (int x = 0; x < w; ++x)
+				{
+					size_t const idx = x + w * (y + static_cast<size_t>(h) * z);
+					if (data[idx] != fg)
+						continue;
+					std::vector<std::pair<tissues_size_t, unsigned>> histogram;
+					for (int k = z - (int)r[2]; k <= z + (int)r[2]; ++k)
+						for (int j = y - (int)r[1]; j <= y + (int)r[1]; ++j)
+							for (int i = x - (int)r[0]; i <= x + (int)r[0]; ++i)
+							{
+								if (i < 0 || j < 0 || k < 0 || i >= w || j >= h || k >= d)
+									continue;
+								auto v = data[i + w * (j + static_cast<size_t>(h) * k)];
+								if (v == fg || v == bg)
+									continue;
+								auto it = std::find_if(histogram.begin(), histogram.end(), [v](const std::pair<tissues_size_t, unsigned>& e) { return e.first == v; });
+								if (it != histogram.end())
+									it->second++;
+								else
+									histogram.push_back(std::make_pair(v, 1u));
+							}
+					std::stable_sort(histogram.begin(), histogram.end(), [](const std::pair<tissues_size_t, unsigned>& a, const std::pair<tissues_size_t, unsigned>& b) { return a.second > b.second; });
+					if (histogram.size() == 1 || (histogram.size() >= 2 && histogram[0].second >= histogram[1].second + majority))
+					{
+						output[idx] = histogram[0].first;
+						changed++;
+					}
+				}
+		data.swap(output);
+		if (changed == 0)
+			break;
+	}
+	return std::count(data.begin(), data.end(), fg);
+}
+
+void Check(std::vector<tissues_size_t> data, const std::array<unsigned, 3>& dims, const std::array<unsigned, 3>& radius, unsigned majority, unsigned max_iterations)
+{
+	auto expected = data;
+	size_t const expected_remaining = Reference(expected, dims, 5, 0, radius, majority, max_iterations);
+
+	size_t const remaining = iseg::VotingReplaceLabel(dims, Slices(data, static_cast<size_t>(dims[0]) * dims[1]), 5, 0, radius, majority, max_iterations);
+	BOOST_CHECK_EQUAL(remaining, expected_remaining);
+	BOOST_CHECK(data == expected);
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(VotingReplaceLabel_suite);
+
+BOOST_AUTO_TEST_CASE(RandomLabels)
+{
+	std::srand(5);
+	std::array<unsigned, 3> const dims = {19, 13, 150};
+	std::vector<tissues_size_t> data(static_cast<size_t>(dims[0]) * dims[1] * dims[2]);
+	for (auto& v : data)
+	{
+		int const r = std::rand() % 10;
+		v = static_cast<tissues_size_t>(r < 6 ? 5 : (r < 7 ? 0 : r - 6));
+	}
+
+	Check(data, dims, {1, 1, 1}, 1, 10);
+	Check(data, dims, {1, 1, 1}, 0, 3);
+	Check(data, dims, {2, 1, 3}, 2, 20);
+}
+
+BOOST_AUTO_TEST_CASE(ThinLayer)
+{
+	// a foreground layer between two labels is replaced from both sides
+	std::array<unsigned, 3> const dims = {16, 16, 70};
+	std::vector<tissues_size_t> data(static_cast<size_t>(dims[0]) * dims[1] * dims[2]);
+	for (size_t i = 0; i < data.size(); ++i)
+	{
+		unsigned const z = static_cast<unsigned>(i / (dims[0] * dims[1]));
+		data[i] = (z < 30) ? 1 : (z < 40 ? 5 : 2);
+	}
+
+	Check(data, dims, {1, 1, 1}, 1, 10);
+	size_t const remaining = iseg::VotingReplaceLabel(dims, Slices(data, dims[0] * dims[1]), 5, 0, {1, 1, 1}, 1, 10);
+	BOOST_CHECK_EQUAL(remaining, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../VoxelSurface.h"
+
+#include <vtkCubeSource.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkSphereSource.h>
+#include <vtkStripper.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+size_t Voxelize(vtkPolyData* surface, std::vector<float>& data, const unsigned dims[3])
+{
+	size_t const area = static_cast<size_t>(dims[0]) * dims[1];
+	data.assign(area * dims[2], 0.f);
+	std::vector<float*> slices;
+	for (size_t i = 0; i < data.size(); i += area)
+		slices.push_back(data.data() + i);
+
+	iseg::VoxelSurface voxeler(1.f);
+	auto overlap = voxeler.Voxelize(surface, slices, dims, iseg::Vec3(1.f, 1.f, 1.f), iseg::Transform(), 0, dims[2]);
+	BOOST_CHECK_EQUAL(overlap, iseg::VoxelSurface::kContained);
+
+	return std::count(data.begin(), data.end(), 1.f);
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(VoxelSurface_suite);
+
+BOOST_AUTO_TEST_CASE(AlignedCube)
+{
+	// the faces lie on the voxel centers, voxels are inside if their center is in [2, 6)
+	auto cube = vtkSmartPointer<vtkCubeSource>::New();
+	cube->SetBounds(2, 6, 2, 6, 2, 6);
+	cube->Update();
+
+	unsigned const dims[3] = {10, 10, 10};
+	std::vector<float> data;
+	BOOST_CHECK_EQUAL(Voxelize(cube->GetOutput(), data, dims), 4 * 4 * 4);
+
+	for (unsigned z = 0; z < dims[2]; ++z)
+		for (unsigned y = 0; y < dims[1]; ++y)
+			for (unsigned x = 0; x < dims[0]; ++x)
+			{
+				bool const inside = x >= 2 && x < 6 && y >= 2 && y < 6 && z >= 2 && z < 6;
+				BOOST_CHECK_EQUAL(data[x + dims[0] * (y + dims[1] * z)], inside ? 1.f : 0.f);
+			}
+}
+
+BOOST_AUTO_TEST_CASE(Sphere)
+{
+	double const radius = 10.0;
+	auto sphere = vtkSmartPointer<vtkSphereSource>::New();
+	sphere->SetCenter(16.3, 15.8, 16.1);
+	sphere->SetRadius(radius);
+	sphere->SetThetaResolution(64);
+	sphere->SetPhiResolution(64);
+	sphere->Update();
+
+	unsigned const dims[3] = {33, 33, 33};
+	std::vector<float> data;
+	size_t const count = Voxelize(sphere->GetOutput(), data, dims);
+
+	double const volume = 4.0 / 3.0 * std::acos(-1.0) * radius * radius * radius;
+	BOOST_CHECK_CLOSE(static_cast<double>(count), volume, 2.0);
+
+	// the same surface as triangle strips
+	auto stripper = vtkSmartPointer<vtkStripper>::New();
+	stripper->SetInputConnection(sphere->GetOutputPort());
+	stripper->Update();
+	BOOST_REQUIRE(stripper->GetOutput()->GetNumberOfStrips() > 0);
+
+	std::vector<float> strip_data;
+	BOOST_CHECK_EQUAL(Voxelize(stripper->GetOutput(), strip_data, dims), count);
+	BOOST_CHECK(strip_data == data);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "JobScheduler.h"
+
+#include "../Data/Logger.h"
+
+#include <qcoreapplication.h>
+#include <qtimer.h>
+
+#include <algorithm>
+#include <atomic>
+
+namespace iseg {
+
+namespace {
+/// Thread-safe progress of a job, polled by the scheduler
+class JobProgressInfo : public ProgressInfo
+{
+public:
+	JobProgressInfo() : m_Steps(0), m_Count(0), m_Percent(0), m_Canceled(false) {}
+
+	void SetNumberOfSteps(int N) override
+	{
+		m_Steps = N;
+		m_Count = 0;
+	}
+	void Increment() override { m_Count++; }
+	void SetValue(int percent) override { m_Percent = percent; }
+	bool WasCanceled() const override { return m_Canceled; }
+
+	void Cancel() { m_Canceled = true; }
+
+	int Percent() const
+	{
+		int const steps = m_Steps;
+		return steps > 0 ? std::min(100 * m_Count / steps, 100) : m_Percent.load();
+	}
+
+private:
+	std::atomic<int> m_Steps;
+	std::atomic<int> m_Count;
+	std::atomic<int> m_Percent;
+	std::atomic<bool> m_Canceled;
+};
+} // namespace
+
+struct JobScheduler::Entry
+{
+	enum eState {
+		kQueued = 0,
+		kRunning,
+		kFinished,
+		kCommitting
+	};
+
+	bool Conflicts(const Entry& other) const
+	{
+		for (const auto& a : m_Job->Leases())
+		{
+			for (const auto& b : other.m_Job->Leases())
+			{
+				if (a.Conflicts(b))
+					return true;
+			}
+		}
+		return false;
+	}
+
+	bool Conflicts(const SliceLease& lease) const
+	{
+		return std::any_of(m_Job->Leases().begin(), m_Job->Leases().end(), [&lease](const SliceLease& l) { return l.Conflicts(lease); });
+	}
+
+	int m_Id;
+	std::shared_ptr<Job> m_Job;
+	JobProgressInfo m_Progress;
+	eState m_State = kQueued;
+	bool m_Success = false;
+};
+
+JobScheduler* JobScheduler::Instance()
+{
+	// deleted with the application, which waits for the workers
+	static JobScheduler* instance = new JobScheduler(0, QCoreApplication::instance());
+	return instance;
+}
+
+JobScheduler::JobScheduler(unsigned num_workers, QObject* parent)
+		: QObject(parent)
+{
+	if (num_workers == 0)
+	{
+		num_workers = std::max(std::thread::hardware_concurrency(), 2u);
+	}
+
+	m_Timer = new QTimer(this);
+	QObject_connect(m_Timer, SIGNAL(timeout()), this, SLOT(UpdateProgress()));
+
+	for (unsigned i = 0; i < num_workers; ++i)
+	{
+		m_Workers.emplace_back(&JobScheduler::Work, this);
+	}
+}
+
+JobScheduler::~JobScheduler()
+{
+	CancelAll();
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stop = true;
+	}
+	m_Wakeup.notify_all();
+	for (auto& worker : m_Workers)
+	{
+		worker.join();
+	}
+}
+
+int JobScheduler::Submit(std::shared_ptr<Job> job)
+{
+	auto entry = std::make_shared<Entry>();
+	entry->m_Job = job;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		entry->m_Id = m_NextId++;
+		m_Jobs.push_back(entry);
+	}
+	m_Wakeup.notify_all();
+
+	if (!m_Timer->isActive())
+	{
+		m_Timer->start(250);
+	}
+	return entry->m_Id;
+}
+
+void JobScheduler::Cancel(int id)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (auto& e : m_Jobs)
+	{
+		if (e->m_Id == id)
+		{
+			e->m_Progress.Cancel();
+			// a job which is being committed is completed
+			if (e->m_State != Entry::kCommitting)
+			{
+				e->m_Success = false;
+			}
+		}
+	}
+}
+
+void JobScheduler::CancelAll()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (auto& e : m_Jobs)
+	{
+		e->m_Progress.Cancel();
+		if (e->m_State != Entry::kCommitting)
+		{
+			e->m_Success = false;
+		}
+	}
+}
+
+void JobScheduler::CancelConflicting(const SliceLease& lease)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (auto& e : m_Jobs)
+	{
+		// queued jobs have not accessed the data yet
+		if ((e->m_State == Entry::kRunning || e->m_State == Entry::kFinished) && e->Conflicts(lease))
+		{
+			ISEG_WARNING("Canceling '" << e->m_Job->Name() << "' because its data is modified");
+			e->m_Progress.Cancel();
+			e->m_Success = false;
+		}
+	}
+}
+
+bool JobScheduler::IsActive(int id) const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return std::any_of(m_Jobs.begin(), m_Jobs.end(), [id](const std::shared_ptr<Entry>& e) { return e->m_Id == id; });
+}
+
+int JobScheduler::Progress(int id) const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (auto& e : m_Jobs)
+	{
+		if (e->m_Id == id)
+		{
+			return e->m_State == Entry::kQueued ? 0 : e->m_Progress.Percent();
+		}
+	}
+	return 100;
+}
+
+size_t JobScheduler::NumberOfJobs() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Jobs.size();
+}
+
+void JobScheduler::WaitForAll()
+{
+	for (;;)
+	{
+		CommitFinished();
+
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		if (m_Jobs.empty())
+		{
+			return;
+		}
+		m_Finished.wait(lock, [this] {
+			return std::any_of(m_Jobs.begin(), m_Jobs.end(), [](const std::shared_ptr<Entry>& e) { return e->m_State == Entry::kFinished; });
+		});
+	}
+}
+
+std::shared_ptr<JobScheduler::Entry> JobScheduler::NextRunnable() const
+{
+	for (auto it = m_Jobs.begin(); it != m_Jobs.end(); ++it)
+	{
+		if ((*it)->m_State != Entry::kQueued)
+			continue;
+
+		// jobs submitted before hold (or will hold) their leases until they are committed
+		bool blocked = std::any_of(m_Jobs.begin(), it, [&it](const std::shared_ptr<Entry>& e) { return e->Conflicts(**it); });
+		if (!blocked)
+		{
+			return *it;
+		}
+	}
+	return nullptr;
+}
+
+void JobScheduler::Work()
+{
+	for (;;)
+	{
+		std::shared_ptr<Entry> entry;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Wakeup.wait(lock, [this, &entry] {
+				return m_Stop || (entry = NextRunnable()) != nullptr;
+			});
+			if (m_Stop)
+			{
+				return;
+			}
+			entry->m_State = Entry::kRunning;
+		}
+
+		bool success = false;
+		if (!entry->m_Progress.WasCanceled())
+		{
+			try
+			{
+				success = entry->m_Job->Run(&entry->m_Progress);
+			}
+			catch (std::exception& e)
+			{
+				ISEG_ERROR("'" << entry->m_Job->Name() << "' failed: " << e.what());
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			entry->m_State = Entry::kFinished;
+			entry->m_Success = success && !entry->m_Progress.WasCanceled();
+		}
+		m_Finished.notify_all();
+
+		QMetaObject::invokeMethod(this, "CommitFinished", Qt::QueuedConnection);
+	}
+}
+
+void JobScheduler::CommitFinished()
+{
+	for (;;)
+	{
+		std::shared_ptr<Entry> entry;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			auto it = std::find_if(m_Jobs.begin(), m_Jobs.end(), [](const std::shared_ptr<Entry>& e) { return e->m_State == Entry::kFinished; });
+			if (it == m_Jobs.end())
+			{
+				break;
+			}
+			entry = *it;
+			entry->m_State = Entry::kCommitting;
+		}
+
+		bool const committed = entry->m_Success;
+		if (committed)
+		{
+			entry->m_Job->Commit();
+		}
+		else
+		{
+			entry->m_Job->Discard();
+		}
+
+		// release the leases
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Jobs.erase(std::find(m_Jobs.begin(), m_Jobs.end(), entry));
+		}
+		m_Wakeup.notify_all();
+
+		emit JobFinished(entry->m_Id, committed);
+	}
+}
+
+void JobScheduler::UpdateProgress()
+{
+	std::vector<std::pair<QString, int>> running;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_Jobs.empty())
+		{
+			m_Timer->stop();
+		}
+		for (auto& e : m_Jobs)
+		{
+			if (e->m_State == Entry::kRunning)
+			{
+				running.emplace_back(QString::fromStdString(e->m_Job->Name()), e->m_Progress.Percent());
+			}
+		}
+	}
+
+	for (const auto& r : running)
+	{
+		emit JobProgress(r.first, r.second);
+	}
+}
+
+} // namespace iseg
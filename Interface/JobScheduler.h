@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "iSegInterface.h"
+
+#include "../Data/ProgressInfo.h"
+
+#include <qobject.h>
+#include <qstring.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class QTimer;
+
+namespace iseg {
+
+/// Read or write access of a job to a range of slices [start, end) of the source, target and/or tissues
+struct ISEG_INTERFACE_API SliceLease
+{
+	enum eData {
+		kSource = 1,
+		kTarget = 2,
+		kTissues = 4
+	};
+
+	enum eAccess {
+		kRead = 0,
+		kWrite
+	};
+
+	SliceLease(unsigned data, eAccess access, unsigned start_slice, unsigned end_slice)
+			: m_Data(data), m_Access(access), m_StartSlice(start_slice), m_EndSlice(end_slice) {}
+
+	/// Leases conflict if they overlap and at least one of them writes
+	bool Conflicts(const SliceLease& other) const
+	{
+		return (m_Data & other.m_Data) != 0 && (m_Access == kWrite || other.m_Access == kWrite) &&
+					 m_StartSlice < other.m_EndSlice && other.m_StartSlice < m_EndSlice;
+	}
+
+	unsigned m_Data;
+	eAccess m_Access;
+	unsigned m_StartSlice;
+	unsigned m_EndSlice;
+};
+
+/** \brief Long running work submitted to the JobScheduler
+
+	Run is called in a worker thread and must only access the slices covered by the leases
+	of the job. Commit (or Discard, if Run failed or the job was canceled) is called in the
+	GUI thread, e.g. to copy the result into the slices and record the undo step.
+*/
+class ISEG_INTERFACE_API Job
+{
+public:
+	Job(const std::string& name) : m_Name(name) {}
+	virtual ~Job() = default;
+
+	const std::string& Name() const { return m_Name; }
+
+	void AddLease(const SliceLease& lease) { m_Leases.push_back(lease); }
+	const std::vector<SliceLease>& Leases() const { return m_Leases; }
+
+	/// Runs in a worker thread, returns false if the job failed or was canceled
+	virtual bool Run(ProgressInfo* progress) = 0;
+
+	/// Runs in the GUI thread after Run succeeded
+	virtual void Commit() {}
+
+	/// Runs in the GUI thread if Run failed or the job was canceled
+	virtual void Discard() {}
+
+private:
+	std::string m_Name;
+	std::vector<SliceLease> m_Leases;
+};
+
+/// Job defined by functions, e.g. lambdas capturing the parameters and the output
+class ISEG_INTERFACE_API FunctionJob : public Job
+{
+public:
+	FunctionJob(const std::string& name, std::function<bool(ProgressInfo*)> run, std::function<void()> commit = nullptr, std::function<void()> discard = nullptr)
+			: Job(name), m_Run(run), m_Commit(commit), m_Discard(discard) {}
+
+	bool Run(ProgressInfo* progress) override { return m_Run(progress); }
+	void Commit() override
+	{
+		if (m_Commit)
+			m_Commit();
+	}
+	void Discard() override
+	{
+		if (m_Discard)
+			m_Discard();
+	}
+
+private:
+	std::function<bool(ProgressInfo*)> m_Run;
+	std::function<void()> m_Commit;
+	std::function<void()> m_Discard;
+};
+
+/** \brief Runs jobs on a pool of worker threads
+
+	A job is started when a worker is free and its leases do not conflict with the leases of
+	jobs submitted before it. Leases are held until the job is committed, so jobs with
+	conflicting leases run and commit in the order of submission, while e.g. several jobs
+	which only read the source run concurrently.
+
+	Must be used from the GUI thread.
+*/
+class ISEG_INTERFACE_API JobScheduler : public QObject
+{
+	Q_OBJECT
+public:
+	/// Scheduler shared by the application and the plugins
+	static JobScheduler* Instance();
+
+	/// Uses the number of cores (at least two) if num_workers is 0
+	JobScheduler(unsigned num_workers = 0, QObject* parent = nullptr);
+	~JobScheduler() override;
+
+	/// Queue a job, returns its id
+	int Submit(std::shared_ptr<Job> job);
+
+	/// Request a job to stop, Discard is called when it has stopped
+	void Cancel(int id);
+	void CancelAll();
+
+	/// Cancel the running or finished jobs whose leases conflict with 'lease', e.g. because the data is modified
+	void CancelConflicting(const SliceLease& lease);
+
+	/// True until the job has been committed or discarded
+	bool IsActive(int id) const;
+
+	/// Progress of an active job in percent
+	int Progress(int id) const;
+
+	size_t NumberOfJobs() const;
+
+	/// Block until all jobs have run, and commit them
+	void WaitForAll();
+
+signals:
+	void JobProgress(QString name, int percent);
+	void JobFinished(int id, bool committed);
+
+private slots:
+	void CommitFinished();
+	void UpdateProgress();
+
+private:
+	struct Entry;
+
+	void Work();
+	std::shared_ptr<Entry> NextRunnable() const;
+
+	mutable std::mutex m_Mutex;
+	std::condition_variable m_Wakeup;
+	std::condition_variable m_Finished;
+	std::deque<std::shared_ptr<Entry>> m_Jobs; // not yet committed, in order of submission
+	std::vector<std::thread> m_Workers;
+	bool m_Stop = false;
+	int m_NextId = 1;
+	QTimer* m_Timer;
+};
+
+} // namespace iseg
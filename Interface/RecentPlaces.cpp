@@ -111,6 +111,33 @@ QString RecentPlaces::GetOpenFileName(QWidget* parent, const QString& caption, c
 	return _getFileName(parent, caption, dir, filter, QFileDialog::AcceptOpen);
 }
 
+QStringList RecentPlaces::GetOpenFileNames(QWidget* parent, const QString& caption, const QString& dir, const QString& filter)
+{
+	QList<QUrl> urls;
+	for (const auto& d : RecentPlaces::RecentDirectories())
+	{
+		urls << QUrl::fromLocalFile(d);
+	}
+
+	QFileDialog dialog(parent);
+	dialog.setAcceptMode(QFileDialog::AcceptOpen);
+	dialog.setFileMode(QFileDialog::ExistingFiles);
+	dialog.setCaption(caption);
+	dialog.setFilter(filter);
+	dialog.setDirectory(!dir.isEmpty() ? dir : RecentPlaces::LastDirectory());
+	dialog.setSidebarUrls(urls);
+	if (dialog.exec() == QDialog::Accepted)
+	{
+		auto file_paths = dialog.selectedFiles();
+		if (!file_paths.isEmpty())
+		{
+			RecentPlaces::AddRecent(file_paths.front());
+		}
+		return file_paths;
+	}
+	return QStringList();
+}
+
 QString RecentPlaces::GetSaveFileName(QWidget* parent, const QString& caption, const QString& dir, const QString& filter)
 {
 	return _getFileName(parent, caption, dir, filter, QFileDialog::AcceptSave);
@@ -12,6 +12,7 @@
 #include "iSegInterface.h"
 
 #include <QString>
+#include <QStringList>
 
 #include <deque>
 
@@ -24,6 +25,8 @@ class ISEG_INTERFACE_API RecentPlaces
 public:
 	static QString GetOpenFileName(QWidget* parent = nullptr, const QString& caption = QString(), const QString& dir = QString(), const QString& filter = QString());
 
+	static QStringList GetOpenFileNames(QWidget* parent = nullptr, const QString& caption = QString(), const QString& dir = QString(), const QString& filter = QString());
+
 	static QString GetSaveFileName(QWidget* parent = nullptr, const QString& caption = QString(), const QString& dir = QString(), const QString& filter = QString());
 
 	static void AddRecent(const QString& dir_or_file_path);
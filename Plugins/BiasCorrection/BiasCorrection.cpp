@@ -10,101 +10,21 @@
 #include "BiasCorrection.h"
 
 #include "Data/ItkUtils.h"
+#include "Data/Logger.h"
 #include "Data/SlicesHandlerITKInterface.h"
 
-#include <itkBSplineControlPointImageFilter.h>
-#include <itkCommand.h>
-#include <itkDivideImageFilter.h>
-#include <itkExpImageFilter.h>
-#include <itkImage.h>
-#include <itkImageRegionIterator.h>
-#include <itkN4BiasFieldCorrectionImageFilter.h>
-#include <itkShrinkImageFilter.h>
-#include <itkTimeProbe.h>
+#include "Interface/JobScheduler.h"
+
+#include <itkMultiThreaderBase.h>
 
 #include <QFormLayout>
+#include <QTimer>
 #include <qlabel.h>
-#include <qprogressdialog.h>
 
 #include <algorithm>
-#include <functional>
-#include <sstream>
-
-namespace {
-template<class TFilter>
-class CommandIterationUpdate : public itk::Command
-{
-public:
-	using Self = CommandIterationUpdate; // NOLINT
-	using Superclass = itk::Command;		 // NOLINT
-	using Pointer = itk::SmartPointer<Self>;
-	itkNewMacro(Self);
-
-protected:
-	CommandIterationUpdate() = default;
-
-public:
-	void SetProgressObject(QProgressDialog* progress, const std::vector<unsigned int>& num_iterations)
-	{
-		m_NumberOfIterations = num_iterations;
-		m_Progress = progress;
-	}
-
-	void Execute(itk::Object* caller, const itk::EventObject& event) override
-	{
-		Execute((const itk::Object*)caller, event);
-	}
-
-	void Execute(const itk::Object* object, const itk::EventObject& event) override
-	{
-		const TFilter* filter = dynamic_cast<const TFilter*>(object);
-
-		if (typeid(event) != typeid(itk::IterationEvent))
-		{
-			return;
-		}
-
-		double current_level = filter->GetCurrentLevel();
-		double current_iteration = filter->GetElapsedIterations();
-		int percent = static_cast<int>((current_level +
-																			 current_iteration / m_NumberOfIterations.at(current_level)) *
-																	 100.0 / m_NumberOfIterations.size());
-		m_Progress->setValue(std::min(percent, 100));
-
-		if (m_Progress->wasCanceled())
-		{
-			// hack to stop filter from executing
-			throw itk::ProcessAborted();
-		}
-	}
-
-private:
-	std::vector<unsigned int> m_NumberOfIterations;
-	QProgressDialog* m_Progress;
-};
-
-template<typename ImageType>
-typename ImageType::Pointer AllocImage(const typename itk::ImageBase<ImageType::ImageDimension>* exemplar)
-{
-	typename ImageType::Pointer rval = ImageType::New();
-	// it may be the case that the output image might have a different
-	// number of PixelComponents than the exemplar, so only copy this
-	// information.
-	// rval->CopyInformation(exemplar);
-	rval->SetLargestPossibleRegion(exemplar->GetLargestPossibleRegion());
-	rval->SetBufferedRegion(exemplar->GetBufferedRegion());
-	rval->SetRequestedRegion(exemplar->GetRequestedRegion());
-	rval->SetSpacing(exemplar->GetSpacing());
-	rval->SetOrigin(exemplar->GetOrigin());
-	rval->SetDirection(exemplar->GetDirection());
-	rval->Allocate();
-	return rval;
-}
-
-} // namespace
 
 BiasCorrectionWidget::BiasCorrectionWidget(iseg::SlicesHandlerInterface* hand3D)
-		: m_Handler3D(hand3D), m_CurrentFilter(nullptr)
+		: m_Handler3D(hand3D), m_JobId(0), m_PreviewSlice(0), m_ShowPreview(false), m_ShrunkFactor(0)
 {
 	setToolTip(Format("Correct non-uniformity (especially in MRI) using the N4 Bias Correction "
 										"algorithm by "
@@ -125,25 +45,51 @@ BiasCorrectionWidget::BiasCorrectionWidget(iseg::SlicesHandlerInterface* hand3D)
 	m_NumberIterations = new QSpinBox(1, 200, 5, nullptr);
 	m_NumberIterations->setValue(50);
 
+	int const max_threads = std::max<int>(itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads(), 1);
+	m_NumberThreads = new QSpinBox(1, max_threads, 1, nullptr);
+	m_NumberThreads->setValue(max_threads);
+
+	m_Preview = new QCheckBox;
+	m_Preview->setChecked(true);
+	m_Preview->setToolTip(Format("Show the corrected active slice in the target image after each fitting level. "
+			"The target slice is restored when the correction has finished."));
+
+	m_Progress = new QProgressBar;
+	m_Progress->setRange(0, 100);
+	m_Progress->setValue(0);
+
 	m_Execute = new QPushButton("Execute");
 
+	m_Timer = new QTimer(this);
+
 	// layout
 	auto layout = new QFormLayout;
 	layout->addRow(bias_header);
 	layout->addRow("Fitting Levels", m_NumberLevels);
 	layout->addRow("Shrink Factor", m_ShrinkFactor);
 	layout->addRow("Iterations", m_NumberIterations);
+	layout->addRow("Threads", m_NumberThreads);
+	layout->addRow("Preview", m_Preview);
 	layout->addRow(m_Execute);
+	layout->addRow(m_Progress);
 
 	setLayout(layout);
 
 	// connections
 	QObject_connect(m_Execute, SIGNAL(clicked()), this, SLOT(DoWork()));
+	QObject_connect(m_Timer, SIGNAL(timeout()), this, SLOT(CheckJob()));
 }
 
 void BiasCorrectionWidget::DoWork()
 {
-	using input_image_type = itk::Image<float, 3>;
+	// the button cancels the running correction
+	if (m_Job)
+	{
+		Cancel();
+		return;
+	}
+
+	using input_image_type = BiasCorrectionJob::image_type;
 
 	iseg::SlicesHandlerITKInterface wrapper(m_Handler3D);
 	input_image_type::Pointer input = wrapper.GetImageDeprecated(iseg::SlicesHandlerITKInterface::kSource, true);
@@ -151,240 +97,229 @@ void BiasCorrectionWidget::DoWork()
 	//Ensure that it is a 3D image for the 3D image filter ! Else it does nothing
 	if (input->GetLargestPossibleRegion().GetSize(2) > 1)
 	{
-		int num_levels = m_NumberLevels->value();
-		int num_iterations = m_NumberIterations->value();
-		int factor = m_ShrinkFactor->value();
-		double conv_threshold = 0.0;
-
-		try
+		BiasCorrectionJob::Parameters params;
+		params.m_NumberOfIterations.assign(m_NumberLevels->value(), m_NumberIterations->value());
+		params.m_ShrinkFactor = m_ShrinkFactor->value();
+		params.m_ConvergenceThreshold = 0.0;
+		params.m_NumberOfThreads = m_NumberThreads->value();
+
+		if (params.m_ShrinkFactor != m_ShrunkFactor ||
+				input->GetLargestPossibleRegion() != m_ShrunkRegion)
 		{
-			auto output = DoBiasCorrection<input_image_type::Pointer>(input, nullptr, std::vector<unsigned int>(num_levels, num_iterations), factor, conv_threshold);
-
-			if (output)
-			{
-				auto source = wrapper.GetSource(true);
-
-				iseg::DataSelection data_selection;
-				data_selection.allSlices = true;
-				data_selection.bmp = true;
-				emit BeginDatachange(data_selection, this);
-
-				iseg::Paste<input_image_type, iseg::SlicesHandlerITKInterface::image_ref_type>(output, source);
-
-				emit EndDatachange(this);
-			}
+			ClearShrunkImages();
 		}
-		catch (itk::ExceptionObject&)
-		{
-		}
-		catch (...)
+		m_ShrunkFactor = params.m_ShrinkFactor;
+		m_ShrunkRegion = input->GetLargestPossibleRegion();
+
+		m_PreviewSlice = m_Handler3D->ActiveSlice();
+		auto job = std::make_shared<BiasCorrectionJob>(input, params, m_Preview->isChecked() ? m_PreviewSlice : -1);
+		if (m_ShrunkInput)
 		{
-			// itk calls 'throw' with no exception
+			job->SetShrunkImages(m_ShrunkInput, m_ShrunkMask);
 		}
+
+		// the source is pasted in the GUI thread, also if the widget has been switched in the meantime,
+		// into the slices the job was submitted for
+		unsigned const start_slice = m_Handler3D->StartSlice();
+		unsigned const end_slice = m_Handler3D->EndSlice();
+		auto scheduler_job = std::make_shared<iseg::FunctionJob>(
+				"Bias correction",
+				[job](iseg::ProgressInfo* progress) { return job->Run(progress); },
+				[this, job, start_slice, end_slice]() { FinishJob(job.get(), start_slice, end_slice); },
+				[this, job, start_slice, end_slice]() { FinishJob(job.get(), start_slice, end_slice); });
+		// the corrected image replaces the source, so later jobs reading the source wait for it
+		// the preview slice is not leased, since writing it in CheckJob would cancel the job itself
+		scheduler_job->AddLease(iseg::SliceLease(iseg::SliceLease::kSource, iseg::SliceLease::kWrite, start_slice, end_slice));
+		m_ShowPreview = m_Preview->isChecked();
+
+		m_Job = job;
+		m_JobId = iseg::JobScheduler::Instance()->Submit(scheduler_job);
+
+		m_Execute->setText("Cancel");
+		m_Progress->setValue(0);
+		m_Timer->start(200);
 	}
 }
 
 void BiasCorrectionWidget::Cancel()
 {
-	if (m_CurrentFilter)
+	if (m_Job)
 	{
-		m_CurrentFilter->SetAbortGenerateData(true);
-		m_CurrentFilter = nullptr;
+		iseg::JobScheduler::Instance()->Cancel(m_JobId);
 	}
 }
 
-BiasCorrectionWidget::~BiasCorrectionWidget() = default;
-
-void BiasCorrectionWidget::OnSlicenrChanged()
+void BiasCorrectionWidget::CheckJob()
 {
-	m_Activeslice = m_Handler3D->ActiveSlice();
-}
+	if (!m_Job)
+	{
+		m_Timer->stop();
+		return;
+	}
 
-void BiasCorrectionWidget::Init()
-{
-	OnSlicenrChanged();
-	HideParamsChanged();
-}
+	m_Progress->setValue(iseg::JobScheduler::Instance()->Progress(m_JobId));
 
-void BiasCorrectionWidget::NewLoaded()
-{
-	m_Activeslice = m_Handler3D->ActiveSlice();
-}
+	std::vector<float> slice;
+	if (m_Job->TakePreview(slice) >= 0 && m_ShowPreview && m_PreviewSlice < m_Handler3D->NumSlices() &&
+			slice.size() == static_cast<size_t>(m_Handler3D->Width()) * m_Handler3D->Height())
+	{
+		// the first preview starts an undo step and keeps the original slice for RestorePreview
+		bool const first = m_PreviewOriginal.empty();
+		float* target = m_Handler3D->TargetSlices().at(m_PreviewSlice);
+		if (!first && !std::equal(m_PreviewShown.begin(), m_PreviewShown.end(), target))
+		{
+			// the slice has been modified in the meantime, keep the modification
+			m_ShowPreview = false;
+			m_PreviewOriginal.clear();
+			m_PreviewShown.clear();
+			return;
+		}
 
-std::string BiasCorrectionWidget::GetName()
-{
-	return std::string("MRI Bias Correction");
-}
+		iseg::DataSelection data_selection;
+		data_selection.sliceNr = m_PreviewSlice;
+		data_selection.work = true;
+		emit BeginDatachange(data_selection, this, first);
 
-QIcon BiasCorrectionWidget::GetIcon(QDir picdir)
-{
-	return QIcon(picdir.absFilePath(QString("Bias.png")).ascii());
+		if (first)
+		{
+			m_PreviewOriginal.assign(target, target + slice.size());
+		}
+		std::copy(slice.begin(), slice.end(), target);
+
+		emit EndDatachange(this, first ? iseg::EndUndo : iseg::NoUndo);
+
+		m_PreviewShown.swap(slice);
+	}
 }
 
-template<typename ImagePointer>
-ImagePointer BiasCorrectionWidget::DoBiasCorrection(ImagePointer inputImage, ImagePointer maskImage, const std::vector<unsigned int>& numIters, int shrinkFactor, double convergenceThreshold)
+void BiasCorrectionWidget::RestorePreview()
 {
-	bool verbose = false;
+	// the target slice is left alone if it has been modified since the last preview
+	if (!m_PreviewOriginal.empty() && m_PreviewSlice < m_Handler3D->NumSlices() &&
+			m_PreviewOriginal.size() == static_cast<size_t>(m_Handler3D->Width()) * m_Handler3D->Height())
+	{
+		float* target = m_Handler3D->TargetSlices().at(m_PreviewSlice);
+		if (std::equal(m_PreviewShown.begin(), m_PreviewShown.end(), target))
+		{
+			iseg::DataSelection data_selection;
+			data_selection.sliceNr = m_PreviewSlice;
+			data_selection.work = true;
+			emit BeginDatachange(data_selection, this, false);
 
-	using image_type = typename ImagePointer::ObjectType;
-	using mask_image_type = typename ImagePointer::ObjectType;
+			std::copy(m_PreviewOriginal.begin(), m_PreviewOriginal.end(), target);
 
-	using corrector_type = itk::N4BiasFieldCorrectionImageFilter<image_type, mask_image_type, image_type>;
-	auto corrector = corrector_type::New();
-	m_CurrentFilter = corrector;
+			emit EndDatachange(this, iseg::NoUndo);
+		}
+	}
+	m_PreviewOriginal.clear();
+	m_PreviewShown.clear();
+}
 
-	QProgressDialog progress("Performing bias correction...", "Cancel", 0, 101, this);
-	progress.setWindowModality(Qt::WindowModal);
-	progress.setModal(true);
-	progress.show();
-	progress.setValue(1);
+void BiasCorrectionWidget::ResetJob()
+{
+	m_Job.reset();
+	m_JobId = 0;
+	m_PreviewOriginal.clear();
+	m_PreviewShown.clear();
+	m_Timer->stop();
+	m_Execute->setText("Execute");
+	m_Progress->setValue(0);
+}
 
-	QObject_connect(&progress, SIGNAL(clicked()), this, SLOT(Cancel()));
+void BiasCorrectionWidget::FinishJob(BiasCorrectionJob* job, unsigned start_slice, unsigned end_slice)
+{
+	using input_image_type = BiasCorrectionJob::image_type;
 
-	/**
-	* handle the mask image
-	*/
-	bool is_mask_specified = (maskImage.IsNotNull());
-	if (!maskImage)
+	// job of a previously loaded image
+	if (job != m_Job.get())
 	{
-		if (verbose)
-		{
-			std::cout << "Mask not read.  Using the entire image as the mask."
-								<< std::endl
-								<< std::endl;
-		}
-		maskImage = mask_image_type::New();
-		maskImage->CopyInformation(inputImage);
-		maskImage->SetRegions(inputImage->GetRequestedRegion());
-		maskImage->Allocate(false);
-		maskImage->FillBuffer(itk::NumericTraits<typename mask_image_type::PixelType>::OneValue());
+		return;
 	}
+	RestorePreview();
+	ResetJob();
 
-	/**
-	* convergence options
-	*/
-	typename corrector_type::VariableSizeArrayType max_number_iterations(numIters.size());
-	for (unsigned int d = 0; d < numIters.size(); d++)
+	if (job->ShrunkInput())
 	{
-		max_number_iterations[d] = numIters[d];
+		m_ShrunkInput = job->ShrunkInput();
+		m_ShrunkMask = job->ShrunkMask();
 	}
-	corrector->SetMaximumNumberOfIterations(max_number_iterations);
 
-	typename corrector_type::ArrayType number_fitting_levels;
-	number_fitting_levels.Fill(numIters.size());
-	corrector->SetNumberOfFittingLevels(number_fitting_levels);
-	corrector->SetConvergenceThreshold(0.0);
-
-	using shrinker_type = itk::ShrinkImageFilter<image_type, image_type>;
-	auto shrinker = shrinker_type::New();
-	shrinker->SetInput(inputImage);
-	shrinker->SetShrinkFactors(shrinkFactor);
-
-	using mask_shrinker_type = itk::ShrinkImageFilter<mask_image_type, mask_image_type>;
-	auto mask_shrinker = mask_shrinker_type::New();
-	mask_shrinker->SetInput(maskImage);
-	mask_shrinker->SetShrinkFactors(shrinkFactor);
-
-	shrinker->Update();
-	mask_shrinker->Update();
-
-	itk::TimeProbe timer;
-	timer.Start();
-
-	corrector->SetInput(shrinker->GetOutput());
-	corrector->SetMaskImage(mask_shrinker->GetOutput());
-
-	using command_type = CommandIterationUpdate<corrector_type>;
-	auto observer = command_type::New();
-	corrector->AddObserver(itk::IterationEvent(), observer);
-	observer->SetProgressObject(&progress, numIters);
-
-	/**
-	* histogram sharpening options
-	*/
-	//corrector->SetBiasFieldFullWidthAtHalfMaximum(0.15);
-	//corrector->SetWienerFilterNoise(0.01);
-	//corrector->SetNumberOfHistogramBins(200);
-
-	try
+	auto output = job->Output();
+	if (output && end_slice > m_Handler3D->NumSlices())
 	{
-		// corrector->DebugOn();
-		corrector->Update();
+		ISEG_ERROR_MSG("could not set output because the slices have changed.");
 	}
-	catch (itk::ExceptionObject& e)
+	else if (output)
 	{
-		if (verbose)
+		iseg::SlicesHandlerITKInterface wrapper(m_Handler3D);
+		auto source = wrapper.GetSource(start_slice, end_slice);
+
+		iseg::DataSelection data_selection;
+		data_selection.allSlices = true;
+		data_selection.bmp = true;
+		emit BeginDatachange(data_selection, this);
+
+		if (!iseg::Paste<input_image_type, iseg::SlicesHandlerITKInterface::image_ref_type>(output, source))
 		{
-			std::cerr << "Exception caught: " << e << std::endl;
+			ISEG_ERROR_MSG("could not set output because image regions don't match.");
 		}
-		m_CurrentFilter = nullptr;
-		return nullptr;
-	}
 
-	m_CurrentFilter = nullptr;
+		emit EndDatachange(this);
 
-	if (verbose)
-	{
-		corrector->Print(std::cout, 3);
+		// the shrunk images are out of date
+		ClearShrunkImages();
 	}
+}
 
-	timer.Stop();
-	if (verbose)
-	{
-		std::cout << "Elapsed time: " << timer.GetMean() << std::endl;
-	}
+void BiasCorrectionWidget::ClearShrunkImages()
+{
+	m_ShrunkInput = nullptr;
+	m_ShrunkMask = nullptr;
+}
 
-	/**
-	* output
-	*
-	* Reconstruct the bias field at full image resolution.  Divide
-	* the original input image by the bias field to get the final
-	* corrected image.
-	*/
-	using b_spliner_type = itk::BSplineControlPointImageFilter<
-			typename corrector_type::BiasFieldControlPointLatticeType, typename corrector_type::ScalarImageType>;
-	auto bspliner = b_spliner_type::New();
-	bspliner->SetInput(corrector->GetLogBiasFieldControlPointLattice());
-	bspliner->SetSplineOrder(corrector->GetSplineOrder());
-	bspliner->SetSize(inputImage->GetLargestPossibleRegion().GetSize());
-	bspliner->SetOrigin(inputImage->GetOrigin());
-	bspliner->SetDirection(inputImage->GetDirection());
-	bspliner->SetSpacing(inputImage->GetSpacing());
-	bspliner->Update();
-
-	auto log_field = AllocImage<image_type>(inputImage);
-
-	itk::ImageRegionIterator<typename corrector_type::ScalarImageType> it_b(bspliner->GetOutput(), bspliner->GetOutput()->GetLargestPossibleRegion());
-	itk::ImageRegionIterator<image_type> it_f(log_field, log_field->GetLargestPossibleRegion());
-	for (it_b.GoToBegin(), it_f.GoToBegin(); !it_b.IsAtEnd(); ++it_b, ++it_f)
-	{
-		it_f.Set(it_b.Get()[0]);
-	}
+BiasCorrectionWidget::~BiasCorrectionWidget() = default;
 
-	using exp_filter_type = itk::ExpImageFilter<image_type, image_type>;
-	auto exp_filter = exp_filter_type::New();
-	exp_filter->SetInput(log_field);
-	exp_filter->Update();
+void BiasCorrectionWidget::OnSlicenrChanged()
+{
+	m_Activeslice = m_Handler3D->ActiveSlice();
+}
 
-	using divider_type = itk::DivideImageFilter<image_type, image_type, image_type>;
-	auto divider = divider_type::New();
-	divider->SetInput1(inputImage);
-	divider->SetInput2(exp_filter->GetOutput());
-	divider->Update();
+void BiasCorrectionWidget::BmpChanged()
+{
+	ClearShrunkImages();
+}
+
+void BiasCorrectionWidget::Init()
+{
+	// the source may have been modified while the widget was inactive
+	ClearShrunkImages();
+	OnSlicenrChanged();
+	HideParamsChanged();
+}
 
-	if (is_mask_specified)
+void BiasCorrectionWidget::NewLoaded()
+{
+	// stop writing previews into the new image, the original slice is gone with the old image
+	if (m_Job)
 	{
-		itk::ImageRegionIteratorWithIndex<image_type> it_d(divider->GetOutput(), divider->GetOutput()->GetLargestPossibleRegion());
-		itk::ImageRegionIterator<image_type> it_i(inputImage, inputImage->GetLargestPossibleRegion());
-		for (it_d.GoToBegin(), it_i.GoToBegin(); !it_d.IsAtEnd(); ++it_d, ++it_i)
-		{
-			if (maskImage->GetPixel(it_d.GetIndex()) ==
-					itk::NumericTraits<typename mask_image_type::PixelType>::ZeroValue())
-			{
-				it_d.Set(it_i.Get());
-			}
-		}
+		iseg::JobScheduler::Instance()->Cancel(m_JobId);
+		ResetJob();
 	}
+	ClearShrunkImages();
+	m_Activeslice = m_Handler3D->ActiveSlice();
+}
+
+void BiasCorrectionWidget::Cleanup()
+{
+	Cancel();
+}
 
-	return divider->GetOutput();
+std::string BiasCorrectionWidget::GetName()
+{
+	return std::string("MRI Bias Correction");
+}
+
+QIcon BiasCorrectionWidget::GetIcon(QDir picdir)
+{
+	return QIcon(picdir.absFilePath(QString("Bias.png")).ascii());
 }
@@ -9,18 +9,21 @@
  */
 #pragma once
 
+#include "BiasCorrectionJob.h"
+
 #include "Data/SlicesHandlerInterface.h"
 
 #include "Interface/WidgetInterface.h"
 
+#include <qcheckbox.h>
+#include <qprogressbar.h>
 #include <qpushbutton.h>
 #include <qspinbox.h>
 
+#include <memory>
 #include <vector>
 
-namespace itk {
-class ProcessObject;
-}
+class QTimer;
 
 class BiasCorrectionWidget : public iseg::WidgetInterface
 {
@@ -31,14 +34,18 @@ public:
 
 	void Init() override;
 	void NewLoaded() override;
+	void Cleanup() override;
 	std::string GetName() override;
 	QIcon GetIcon(QDir picdir) override;
 
 private:
 	void OnSlicenrChanged() override;
+	void BmpChanged() override;
 
-	template<typename ImagePointer>
-	ImagePointer DoBiasCorrection(ImagePointer inputImage, ImagePointer maskImage, const std::vector<unsigned int>& numIters, int shrinkFactor, double convergenceThreshold);
+	void ClearShrunkImages();
+	void FinishJob(BiasCorrectionJob* job, unsigned start_slice, unsigned end_slice);
+	void ResetJob();
+	void RestorePreview();
 
 	iseg::SlicesHandlerInterface* m_Handler3D;
 	unsigned short m_Activeslice;
@@ -46,11 +53,28 @@ private:
 	QSpinBox* m_NumberLevels;
 	QSpinBox* m_ShrinkFactor;
 	QSpinBox* m_NumberIterations;
+	QSpinBox* m_NumberThreads;
+	QCheckBox* m_Preview;
+	QProgressBar* m_Progress;
 	QPushButton* m_Execute;
+	QTimer* m_Timer;
+
+	std::shared_ptr<BiasCorrectionJob> m_Job;
+	int m_JobId;
+	unsigned short m_PreviewSlice;
+	bool m_ShowPreview;
+	// target slice before the first preview, and the last preview written into it
+	std::vector<float> m_PreviewOriginal;
+	std::vector<float> m_PreviewShown;
 
-	itk::ProcessObject* m_CurrentFilter;
+	// shrunk source of the last job, reused until the source changes
+	BiasCorrectionJob::image_type::Pointer m_ShrunkInput;
+	BiasCorrectionJob::image_type::Pointer m_ShrunkMask;
+	unsigned int m_ShrunkFactor;
+	itk::ImageRegion<3> m_ShrunkRegion;
 
 private slots:
 	void DoWork();
 	void Cancel();
+	void CheckJob();
 };
@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "BiasCorrectionJob.h"
+
+#include <itkBSplineControlPointImageFilter.h>
+#include <itkBSplineControlPointImageFunction.h>
+#include <itkCommand.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIterator.h>
+#include <itkN4BiasFieldCorrectionImageFilter.h>
+#include <itkShrinkImageFilter.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace {
+using image_type = BiasCorrectionJob::image_type;
+using corrector_type = itk::N4BiasFieldCorrectionImageFilter<image_type, image_type, image_type>;
+} // namespace
+
+BiasCorrectionJob::BiasCorrectionJob(image_type* input, const Parameters& params, long preview_slice)
+		: m_Input(input), m_Parameters(params), m_PreviewSlice(preview_slice)
+{
+	m_Parameters.m_NumberOfThreads = std::max(m_Parameters.m_NumberOfThreads, 1u);
+
+	auto const& region = m_Input->GetLargestPossibleRegion();
+	if (m_PreviewSlice < region.GetIndex(2) ||
+			m_PreviewSlice >= region.GetIndex(2) + static_cast<long>(region.GetSize(2)))
+	{
+		m_PreviewSlice = -1;
+	}
+}
+
+void BiasCorrectionJob::SetShrunkImages(image_type* shrunk_input, image_type* shrunk_mask)
+{
+	m_ShrunkInput = shrunk_input;
+	m_ShrunkMask = shrunk_mask;
+}
+
+int BiasCorrectionJob::TakePreview(std::vector<float>& slice)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	int level = m_PreviewLevel;
+	if (level >= 0)
+	{
+		slice.swap(m_Preview);
+		m_Preview.clear();
+		m_PreviewLevel = -1;
+	}
+	return level;
+}
+
+bool BiasCorrectionJob::Run(iseg::ProgressInfo* progress)
+{
+	m_ProgressInfo = progress;
+	m_Output = nullptr;
+
+	unsigned int const num_threads = m_Parameters.m_NumberOfThreads;
+	auto const& num_iterations = m_Parameters.m_NumberOfIterations;
+
+	try
+	{
+		if (!m_ShrunkInput || !m_ShrunkMask)
+		{
+			auto shrinker = itk::ShrinkImageFilter<image_type, image_type>::New();
+			shrinker->SetInput(m_Input);
+			shrinker->SetShrinkFactors(m_Parameters.m_ShrinkFactor);
+			shrinker->SetNumberOfWorkUnits(num_threads);
+			shrinker->GetMultiThreader()->SetMaximumNumberOfThreads(num_threads);
+			shrinker->Update();
+			m_ShrunkInput = shrinker->GetOutput();
+			m_ShrunkInput->DisconnectPipeline();
+
+			// the entire image is used as the mask
+			m_ShrunkMask = image_type::New();
+			m_ShrunkMask->CopyInformation(m_ShrunkInput);
+			m_ShrunkMask->SetRegions(m_ShrunkInput->GetLargestPossibleRegion());
+			m_ShrunkMask->Allocate();
+			m_ShrunkMask->FillBuffer(itk::NumericTraits<image_type::PixelType>::OneValue());
+		}
+
+		auto corrector = corrector_type::New();
+		corrector->SetInput(m_ShrunkInput);
+		corrector->SetMaskImage(m_ShrunkMask);
+		corrector->SetNumberOfWorkUnits(num_threads);
+		corrector->GetMultiThreader()->SetMaximumNumberOfThreads(num_threads);
+
+		corrector_type::VariableSizeArrayType max_number_iterations(num_iterations.size());
+		for (unsigned int d = 0; d < num_iterations.size(); d++)
+		{
+			max_number_iterations[d] = num_iterations[d];
+		}
+		corrector->SetMaximumNumberOfIterations(max_number_iterations);
+
+		corrector_type::ArrayType number_fitting_levels;
+		number_fitting_levels.Fill(num_iterations.size());
+		corrector->SetNumberOfFittingLevels(number_fitting_levels);
+		corrector->SetConvergenceThreshold(m_Parameters.m_ConvergenceThreshold);
+
+		auto observer = itk::MemberCommand<BiasCorrectionJob>::New();
+		observer->SetCallbackFunction(this, &BiasCorrectionJob::OnIteration);
+		corrector->AddObserver(itk::IterationEvent(), observer);
+
+		corrector->Update();
+
+		if (!Canceled())
+		{
+			Reconstruct(corrector->GetLogBiasFieldControlPointLattice(), corrector->GetSplineOrder());
+		}
+	}
+	catch (itk::ProcessAborted&)
+	{
+		m_Output = nullptr;
+	}
+	catch (itk::ExceptionObject& e)
+	{
+		std::cerr << "Bias correction failed: " << e << std::endl;
+		m_Output = nullptr;
+	}
+
+	if (m_ProgressInfo)
+	{
+		m_ProgressInfo->SetValue(100);
+	}
+	m_ProgressInfo = nullptr;
+	return m_Output.IsNotNull();
+}
+
+void BiasCorrectionJob::OnIteration(itk::Object* caller, const itk::EventObject& event)
+{
+	auto filter = dynamic_cast<const corrector_type*>(caller);
+	if (!filter || typeid(event) != typeid(itk::IterationEvent))
+	{
+		return;
+	}
+
+	auto const& num_iterations = m_Parameters.m_NumberOfIterations;
+	int const current_level = static_cast<int>(filter->GetCurrentLevel());
+	double const current_iteration = filter->GetElapsedIterations();
+	int percent = static_cast<int>((current_level +
+																		 current_iteration / num_iterations.at(current_level)) *
+																 100.0 / num_iterations.size());
+	if (m_ProgressInfo)
+	{
+		m_ProgressInfo->SetValue(std::min(percent, 99));
+	}
+
+	if (Canceled())
+	{
+		// hack to stop filter from executing
+		throw itk::ProcessAborted();
+	}
+
+	if (m_PreviewSlice >= 0)
+	{
+		if (current_iteration >= num_iterations.at(current_level))
+		{
+			UpdatePreview(filter->GetLogBiasFieldControlPointLattice(), filter->GetSplineOrder(), current_level);
+		}
+		else if (current_level > m_LastPreviewLevel + 1)
+		{
+			// the previous level converged before the maximum number of iterations
+			UpdatePreview(filter->GetLogBiasFieldControlPointLattice(), filter->GetSplineOrder(), current_level - 1);
+		}
+	}
+}
+
+template<class TLattice>
+void BiasCorrectionJob::UpdatePreview(const TLattice* lattice, unsigned int spline_order, int level)
+{
+	m_LastPreviewLevel = level;
+	if (!lattice)
+	{
+		return;
+	}
+
+	auto const& region = m_Input->GetLargestPossibleRegion();
+	auto const size = region.GetSize();
+	size_t const slice_size = size[0] * size[1];
+
+	// evaluate the field only at the preview slice, with the parameterization used by Reconstruct
+	using function_type = itk::BSplineControlPointImageFunction<TLattice>;
+	auto bspliner = function_type::New();
+	bspliner->SetSplineOrder(spline_order);
+	bspliner->SetOrigin(m_Input->GetOrigin());
+	bspliner->SetSpacing(m_Input->GetSpacing());
+	bspliner->SetSize(size);
+	bspliner->SetInputImage(lattice);
+
+	auto parametric = [](size_t i, size_t n) {
+		return n > 1 ? static_cast<double>(i) / static_cast<double>(n - 1) : 0.0;
+	};
+
+	size_t const z = static_cast<size_t>(m_PreviewSlice - region.GetIndex(2));
+	const float* input = m_Input->GetBufferPointer() + z * slice_size;
+
+	std::vector<float> slice(slice_size);
+	typename function_type::PointType u;
+	u[2] = parametric(z, size[2]);
+	for (size_t y = 0, pos = 0; y < size[1]; ++y)
+	{
+		u[1] = parametric(y, size[1]);
+		for (size_t x = 0; x < size[0]; ++x, ++pos)
+		{
+			u[0] = parametric(x, size[0]);
+			slice[pos] = static_cast<float>(input[pos] / std::exp(bspliner->EvaluateAtParametricPoint(u)[0]));
+		}
+
+		if (Canceled())
+		{
+			return;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Preview.swap(slice);
+	m_PreviewLevel = level;
+}
+
+template<class TLattice>
+void BiasCorrectionJob::Reconstruct(const TLattice* lattice, unsigned int spline_order)
+{
+	unsigned int const num_threads = m_Parameters.m_NumberOfThreads;
+
+	/**
+	* Reconstruct the bias field at full image resolution.  Divide
+	* the original input image by the bias field to get the final
+	* corrected image.
+	*/
+	using b_spliner_type = itk::BSplineControlPointImageFilter<TLattice, corrector_type::ScalarImageType>;
+	auto bspliner = b_spliner_type::New();
+	bspliner->SetInput(lattice);
+	bspliner->SetSplineOrder(spline_order);
+	bspliner->SetSize(m_Input->GetLargestPossibleRegion().GetSize());
+	bspliner->SetOrigin(m_Input->GetOrigin());
+	bspliner->SetDirection(m_Input->GetDirection());
+	bspliner->SetSpacing(m_Input->GetSpacing());
+	bspliner->SetNumberOfWorkUnits(num_threads);
+	bspliner->GetMultiThreader()->SetMaximumNumberOfThreads(num_threads);
+	bspliner->Update();
+
+	if (Canceled())
+	{
+		return;
+	}
+
+	auto output = image_type::New();
+	output->CopyInformation(m_Input);
+	output->SetRegions(m_Input->GetLargestPossibleRegion());
+	output->Allocate();
+
+	itk::ImageRegionConstIterator<typename corrector_type::ScalarImageType> it_b(bspliner->GetOutput(), bspliner->GetOutput()->GetLargestPossibleRegion());
+	itk::ImageRegionConstIterator<image_type> it_i(m_Input, m_Input->GetLargestPossibleRegion());
+	itk::ImageRegionIterator<image_type> it_o(output, output->GetLargestPossibleRegion());
+	for (it_b.GoToBegin(), it_i.GoToBegin(), it_o.GoToBegin(); !it_b.IsAtEnd(); ++it_b, ++it_i, ++it_o)
+	{
+		it_o.Set(static_cast<float>(it_i.Get() / std::exp(it_b.Get()[0])));
+	}
+
+	m_Output = output;
+}
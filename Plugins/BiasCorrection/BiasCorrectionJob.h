@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "Data/ProgressInfo.h"
+
+#include <itkImage.h>
+
+#include <mutex>
+#include <vector>
+
+namespace itk {
+class EventObject;
+class Object;
+} // namespace itk
+
+/** \brief Runs the N4 bias field correction, e.g. as a job of the iseg::JobScheduler
+
+	The bias field is fitted on a shrunk copy of the input. The shrunk images can be
+	taken from a previous job with the same shrink factor, so that changing the fitting
+	parameters does not require shrinking the input again.
+
+	Whenever a fitting level is completed, the current bias field estimate is evaluated
+	on one slice of the input and the corrected slice is made available as a preview.
+	The full resolution bias field is only reconstructed once all levels are done.
+*/
+class BiasCorrectionJob
+{
+public:
+	using image_type = itk::Image<float, 3>;
+
+	struct Parameters
+	{
+		std::vector<unsigned int> m_NumberOfIterations; // per fitting level
+		unsigned int m_ShrinkFactor = 4;
+		double m_ConvergenceThreshold = 0.0;
+		unsigned int m_NumberOfThreads = 1;
+	};
+
+	BiasCorrectionJob(image_type* input, const Parameters& params, long preview_slice = -1);
+
+	/// Use shrunk input and mask of a previous job (with the same input and shrink factor)
+	void SetShrunkImages(image_type* shrunk_input, image_type* shrunk_mask);
+
+	/** Run the correction, reporting the progress of the bias field fitting in percent.
+		\return false if the correction failed or was canceled via the progress
+	*/
+	bool Run(iseg::ProgressInfo* progress);
+
+	/** Get the corrected preview slice if a new one is available since the last call.
+		Can be called from another thread while the job is running.
+		\return fitting level of the preview, or -1 if there is no new preview
+	*/
+	int TakePreview(std::vector<float>& slice);
+
+	/// Corrected image, nullptr if the job failed or was canceled. Only call once Run has returned.
+	image_type::Pointer Output() const { return m_Output; }
+
+	image_type::Pointer ShrunkInput() const { return m_ShrunkInput; }
+	image_type::Pointer ShrunkMask() const { return m_ShrunkMask; }
+
+private:
+	bool Canceled() const { return m_ProgressInfo && m_ProgressInfo->WasCanceled(); }
+
+	void OnIteration(itk::Object* caller, const itk::EventObject& event);
+
+	template<class TLattice>
+	void UpdatePreview(const TLattice* lattice, unsigned int spline_order, int level);
+
+	template<class TLattice>
+	void Reconstruct(const TLattice* lattice, unsigned int spline_order);
+
+	image_type::Pointer m_Input;
+	image_type::Pointer m_ShrunkInput;
+	image_type::Pointer m_ShrunkMask;
+	image_type::Pointer m_Output;
+	Parameters m_Parameters;
+	long m_PreviewSlice;
+
+	std::mutex m_Mutex;
+	std::vector<float> m_Preview;
+	int m_PreviewLevel = -1;
+	int m_LastPreviewLevel = -1; // only used by the worker
+
+	iseg::ProgressInfo* m_ProgressInfo = nullptr;
+};
@@ -9,9 +9,13 @@
  */
 #include "ConfidenceWidget.h"
 
+#include "Data/ItkProgressObserver.h"
 #include "Data/ItkUtils.h"
+#include "Data/Logger.h"
 #include "Data/SlicesHandlerITKInterface.h"
 
+#include "Interface/JobScheduler.h"
+
 #include <itkConfidenceConnectedImageFilter.h>
 #include <itkCurvatureFlowImageFilter.h>
 #include <itkImage.h>
@@ -56,6 +60,7 @@ ConfidenceWidget::ConfidenceWidget(iseg::SlicesHandlerInterface* hand3D)
 
 	QObject_connect(m_ClearSeeds, SIGNAL(clicked()), this, SLOT(Clearmarks()));
 	QObject_connect(m_ExecuteButton, SIGNAL(clicked()), this, SLOT(DoWork()));
+	QObject_connect(iseg::JobScheduler::Instance(), SIGNAL(JobFinished(int,bool)), this, SLOT(JobFinished(int,bool)));
 }
 
 void ConfidenceWidget::OnSlicenrChanged()
@@ -131,25 +136,103 @@ void ConfidenceWidget::GetSeeds(std::vector<itk::Index<3>>& seeds)
 
 void ConfidenceWidget::DoWork()
 {
+	auto scheduler = iseg::JobScheduler::Instance();
+	if (scheduler->IsActive(m_JobId))
+	{
+		scheduler->Cancel(m_JobId);
+		return;
+	}
+
+	Parameters params;
+	params.m_Multiplier = m_Multiplier->text().toDouble();
+	params.m_Iterations = m_Iterations->value();
+	params.m_Radius = m_Radius->value();
+
 	iseg::SlicesHandlerITKInterface itk_handler(m_Handler3D);
 	if (m_AllSlices->isChecked())
 	{
-		using input_type = itk::SliceContiguousImage<float>;
-		auto source = itk_handler.GetSource(true);
-		auto target = itk_handler.GetTarget(true);
-		DoWorkNd<input_type>(source, target);
+		using input_type = itk::Image<float, 3>;
+		using mask_type = itk::Image<unsigned char, 3>;
+
+		// the job works on a copy of the source and pastes the result when it is committed
+		input_type::Pointer source = itk_handler.GetImageDeprecated(iseg::SlicesHandlerITKInterface::kSource, true);
+		std::vector<input_type::IndexType> seeds;
+		GetSeeds(seeds);
+
+		// the result is pasted into the slices the job was submitted for, even if the active range changes
+		unsigned const start_slice = m_Handler3D->StartSlice();
+		unsigned const end_slice = m_Handler3D->EndSlice();
+
+		auto output = std::make_shared<mask_type::Pointer>();
+		auto job = std::make_shared<iseg::FunctionJob>(
+				"Confidence connected",
+				[source, seeds, params, output](iseg::ProgressInfo* progress) {
+					*output = Segment<input_type>(source, seeds, params, progress);
+					return output->IsNotNull();
+				},
+				[this, output, start_slice, end_slice]() {
+					if (end_slice > m_Handler3D->NumSlices())
+					{
+						ISEG_ERROR_MSG("could not set output because the slices have changed.");
+						return;
+					}
+					iseg::SlicesHandlerITKInterface itk_handler(m_Handler3D);
+					auto target = itk_handler.GetTarget(start_slice, end_slice);
+
+					iseg::DataSelection data_selection;
+					data_selection.allSlices = true;
+					data_selection.work = true;
+					emit BeginDatachange(data_selection, this);
+
+					if (!iseg::Paste<mask_type, itk::SliceContiguousImage<float>>(*output, target))
+					{
+						ISEG_ERROR_MSG("could not set output because image regions don't match.");
+					}
+
+					emit EndDatachange(this);
+				});
+		job->AddLease(iseg::SliceLease(iseg::SliceLease::kSource, iseg::SliceLease::kRead, start_slice, end_slice));
+		job->AddLease(iseg::SliceLease(iseg::SliceLease::kTarget, iseg::SliceLease::kWrite, start_slice, end_slice));
+
+		m_JobId = scheduler->Submit(job);
+		m_ExecuteButton->setText("Cancel");
 	}
 	else
 	{
 		using input_type = itk::Image<float, 2>;
+		using mask_type = itk::Image<unsigned char, 2>;
 		auto source = itk_handler.GetSourceSlice();
 		auto target = itk_handler.GetTargetSlice();
-		DoWorkNd<input_type>(source, target);
+
+		std::vector<input_type::IndexType> seeds;
+		GetSeeds(seeds);
+
+		auto output = Segment<input_type>(source, seeds, params, nullptr);
+		if (output)
+		{
+			iseg::DataSelection data_selection;
+			data_selection.sliceNr = m_Activeslice;
+			data_selection.work = true;
+			emit BeginDatachange(data_selection, this);
+
+			iseg::Paste<mask_type, input_type>(output, target);
+
+			emit EndDatachange(this);
+		}
+	}
+}
+
+void ConfidenceWidget::JobFinished(int id, bool committed)
+{
+	if (id == m_JobId)
+	{
+		m_ExecuteButton->setText("Execute");
 	}
 }
 
 template<typename TInput>
-void ConfidenceWidget::DoWorkNd(TInput* source, TInput* target)
+typename itk::Image<unsigned char, TInput::ImageDimension>::Pointer
+		ConfidenceWidget::Segment(TInput* source, const std::vector<typename TInput::IndexType>& seeds, const Parameters& params, iseg::ProgressInfo* progress)
 {
 	itkStaticConstMacro(ImageDimension, unsigned int, TInput::ImageDimension);
 	using input_type = TInput;
@@ -166,34 +249,30 @@ void ConfidenceWidget::DoWorkNd(TInput* source, TInput* target)
 	// set parameters
 	smoothing->SetNumberOfIterations(2);
 	smoothing->SetTimeStep(0.05);
-	confidence_connected->SetMultiplier(m_Multiplier->text().toDouble());
-	confidence_connected->SetNumberOfIterations(m_Iterations->value());
-	confidence_connected->SetInitialNeighborhoodRadius(m_Radius->value());
+	confidence_connected->SetMultiplier(params.m_Multiplier);
+	confidence_connected->SetNumberOfIterations(params.m_Iterations);
+	confidence_connected->SetInitialNeighborhoodRadius(params.m_Radius);
 	confidence_connected->SetReplaceValue(255);
 
-	std::vector<typename input_type::IndexType> seeds;
-	GetSeeds(seeds);
 	for (auto idx : seeds)
 	{
 		confidence_connected->AddSeed(idx);
 	}
 
+	if (progress)
+	{
+		auto observer = iseg::ItkProgressObserver::New();
+		observer->SetProgressInfo(progress);
+		confidence_connected->AddObserver(itk::ProgressEvent(), observer);
+	}
+
 	try
 	{
 		confidence_connected->Update();
 	}
 	catch (itk::ExceptionObject)
 	{
-		return;
+		return nullptr;
 	}
-
-	iseg::DataSelection data_selection;
-	data_selection.allSlices = m_AllSlices->isChecked();
-	data_selection.sliceNr = m_Activeslice;
-	data_selection.work = true;
-	emit BeginDatachange(data_selection, this);
-
-	iseg::Paste<mask_type, input_type>(confidence_connected->GetOutput(), target);
-
-	emit EndDatachange(this);
+	return confidence_connected->GetOutput();
 }
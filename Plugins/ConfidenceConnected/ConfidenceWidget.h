@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include "Data/ProgressInfo.h"
 #include "Data/SlicesHandlerInterface.h"
 #include "Interface/WidgetInterface.h"
 
@@ -18,6 +19,7 @@
 #include <qpushbutton.h>
 #include <qspinbox.h>
 
+#include <itkImage.h>
 #include <itkIndex.h>
 
 #include <map>
@@ -38,8 +40,16 @@ protected:
 	void OnSlicenrChanged() override;
 	void OnMouseClicked(iseg::Point p) override;
 
+	struct Parameters
+	{
+		double m_Multiplier;
+		unsigned int m_Iterations;
+		unsigned int m_Radius;
+	};
+
+	/// Runs the segmentation, does not access the widget (called in a worker thread for all slices)
 	template<typename TInput>
-	void DoWorkNd(TInput* source, TInput* target);
+	static typename itk::Image<unsigned char, TInput::ImageDimension>::Pointer Segment(TInput* source, const std::vector<typename TInput::IndexType>& seeds, const Parameters& params, iseg::ProgressInfo* progress);
 
 	void GetSeeds(std::vector<itk::Index<2>>&);
 	void GetSeeds(std::vector<itk::Index<3>>&);
@@ -57,7 +67,10 @@ private:
 
 	std::map<unsigned, std::vector<iseg::Point>> m_Vpdyn;
 
+	int m_JobId = 0;
+
 private slots:
 	void DoWork();
 	void Clearmarks();
+	void JobFinished(int id, bool committed);
 };
@@ -91,12 +91,16 @@ BoneSegmentationWidget::BoneSegmentationWidget(iseg::SlicesHandlerInterface* han
 	auto pi = group->Add("Iterations", PropertyInt::Create(5));
 	pi->SetDescription("Number of iterations");
 
-	m_MaxFlowAlgorithm = group->Add("MaxFlowAlgorithm", PropertyEnum::Create({"Kohli", "PushLabel-Fifo", "PushLabel-H_PRF"}, 0));
+	m_MaxFlowAlgorithm = group->Add("MaxFlowAlgorithm", PropertyEnum::Create({"Kohli", "PushLabel-Fifo", "PushLabel-H_PRF", "Kohli-Parallel"}, 0));
 	m_MaxFlowAlgorithm->SetDescription("Max-Flow Algorithm");
 	m_MaxFlowAlgorithm->SetToolTip("Choose Max-Flow algorithm used to perform Graph-Cut.");
 
 	m_M6Connectivity = group->Add("6-Connectivity", PropertyBool::Create(false));
 
+	m_MultiResolution = group->Add("MultiResolution", PropertyBool::Create(false));
+	m_MultiResolution->SetDescription("Multi-resolution");
+	m_MultiResolution->SetToolTip("Compute the cut on a coarser grid first and refine it only near the coarse cut. Uses much less memory for large volumes.");
+
 	m_UseSliceRange = group->Add("UseSliceRange", PropertyBool::Create(false));
 	m_UseSliceRange->SetDescription("Use Slice Range");
 
@@ -170,6 +174,7 @@ void BoneSegmentationWidget::DoWork()
 	graph_cut_filter->SetBackgroundPixelValue(0);
 	graph_cut_filter->SetSigma(0.2);
 	graph_cut_filter->SetConnectivity(m_M6Connectivity->Value());
+	graph_cut_filter->SetMultiResolution(m_MultiResolution->Value());
 
 	// assumes input image is 3D
 	if (input->GetLargestPossibleRegion().GetSize(2) > 1)
@@ -39,6 +39,7 @@ private:
 
 	std::shared_ptr<iseg::PropertyEnum> m_MaxFlowAlgorithm;
 	std::shared_ptr<iseg::PropertyBool> m_M6Connectivity;
+	std::shared_ptr<iseg::PropertyBool> m_MultiResolution;
 	std::shared_ptr<iseg::PropertyBool> m_UseSliceRange;
 	std::shared_ptr<iseg::PropertyInt> m_Start;
 	std::shared_ptr<iseg::PropertyInt> m_End;
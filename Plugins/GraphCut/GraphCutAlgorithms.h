@@ -12,6 +12,7 @@
 // ITK
 #include <itkGradientMagnitudeRecursiveGaussianImageFilter.h>
 #include <itkImage.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
 #include <itkMinimumMaximumImageCalculator.h>
 #include <itkProgressReporter.h>
 #include <itkShapedNeighborhoodIterator.h>
@@ -19,11 +20,17 @@
 //#include <itkMultiScaleHessianBasedMeasureImageFilter>
 
 // STL
+#include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "GraphCutBand.h"
+
 // Gc
+#include "Flow/Grid/DualDecomposition.h"
 #include "Flow/Grid/Kohli.h"
 #include "Flow/Grid/PushRelabel/Fifo.h"
 #include "Flow/Grid/PushRelabel/HighestLevel.h"
@@ -34,6 +41,7 @@ enum eGcMaxFlowAlgorithm {
 	kKohli = 0,
 	kPushLabelFifo = 1,
 	kPushLabelHighestLevel = 2,
+	kParallelKohli = 3,
 };
 enum eGcConnectivity {
 	kFaceNeighbors,
@@ -77,6 +85,13 @@ public:
 
 	void SetUseGradientMagnitude(bool b) { m_UseGradientMagnitude = b; }
 
+	/** Compute the cut on a grid shrunk by 2 first (recursively) and build the full resolution
+		graph only in a narrow band of 'band radius' coarse pixels around the coarse cut.
+	*/
+	void SetMultiResolution(bool b) { m_MultiResolution = b; }
+
+	void SetBandRadius(unsigned int r) { m_BandRadius = r; }
+
 	// image setters
 	void SetMaskInput(InputImageType* image)
 	{
@@ -100,6 +115,23 @@ public:
 
 	void SetVerboseOutput(bool b) { m_PrintTimer = b; }
 
+	/** Keep the solved graph after the update (if the max-flow algorithm is dynamic). If the next
+		update only changes which pixels are object 1 or 2, the terminal arcs are modified in the
+		solved graph and the max-flow is recomputed from the previous flow, instead of from scratch.
+	*/
+	void SetReuseGraph(bool b)
+	{
+		m_ReuseGraph = b;
+		if (!b)
+			ReleaseGraph();
+	}
+
+	void ReleaseGraph()
+	{
+		m_Graph.reset();
+		m_NodeState.clear();
+	}
+
 private:
 	GraphCutLabelSeparator();
 	~GraphCutLabelSeparator() override {}
@@ -107,10 +139,56 @@ private:
 
 private:
 	using GraphType = Gc::Flow::IGridMaxFlow<NDimension, Gc::Float32, Gc::Float32, Gc::Float32>;
+	using BandType = GraphCutBand<NDimension>;
+	using RegionType = typename InputImageType::RegionType;
+
+	// smaller graphs are not solved coarse-to-fine
+	static constexpr size_t k_MinimumMultiResolutionPixels = 1 << 18;
+
+	// everything the arcs between nodes depend on
+	struct GraphParameters
+	{
+		typename InputImageType::RegionType largestRegion;
+		typename InputImageType::RegionType region;
+		eGcConnectivity connectivity;
+		eGcMaxFlowAlgorithm algorithm;
+		bool useGradientMagnitude;
+		double sigma;
+		std::uint64_t intensityHash;
+
+		bool operator==(const GraphParameters& rhs) const
+		{
+			return largestRegion == rhs.largestRegion && region == rhs.region && connectivity == rhs.connectivity &&
+						 algorithm == rhs.algorithm && useGradientMagnitude == rhs.useGradientMagnitude && sigma == rhs.sigma && intensityHash == rhs.intensityHash;
+		}
+	};
+
+	enum eNodeState : unsigned char {
+		kNodeBackground = 0,
+		kNodeObject,
+		kNodeObject1,
+		kNodeObject2
+	};
+
+	/// Bounding box of the pixels which are not background in the requested region
+	RegionType ComputeGraphRegion();
+
+	/// Linear index of a pixel in the graph region
+	size_t GraphIndex(const typename InputImageType::IndexType& idx) const;
+
+	std::unique_ptr<BandType> ComputeCoarseCut();
+
+	GraphParameters ComputeGraphParameters();
+
+	void ComputeNodeStates(std::vector<unsigned char>& states);
+
+	bool CanUpdateGraph(const GraphParameters& parameters, const std::vector<unsigned char>& states) const;
+
+	void UpdateTerminalArcs(GraphType*, const std::vector<unsigned char>& states);
 
-	void InitializeGraph(GraphType*, ProgressReporter& progress);
+	void InitializeGraph(GraphType*, const BandType* band, ProgressReporter& progress);
 
-	void CutGraph(GraphType*, ProgressReporter& progress);
+	void CutGraph(GraphType*, const BandType* band, ProgressReporter& progress);
 
 	double m_Sigma = 1.0;
 	bool m_UseGradientMagnitude = false;
@@ -121,6 +199,14 @@ private:
 	typename InputImageType::PixelType m_Object1Value = 127;
 	typename InputImageType::PixelType m_Object2Value = 255;
 	bool m_PrintTimer = false;
+	bool m_ReuseGraph = false;
+	bool m_MultiResolution = false;
+	unsigned int m_BandRadius = 2;
+
+	RegionType m_GraphRegion;
+	std::unique_ptr<GraphType> m_Graph;
+	GraphParameters m_GraphParameters;
+	std::vector<unsigned char> m_NodeState;
 
 private:
 	GraphCutLabelSeparator(const Self&); // intentionally not implemented
@@ -84,68 +84,134 @@ void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::GenerateData
 	itk::TimeProbesCollectorBase timer;
 
 	timer.Start("ITK init");
-	auto input = GetMaskInput();
 	auto output = this->GetOutput();
 	auto output_region = output->GetRequestedRegion();
 
-	// init ITK progress reporter
-	// InitializeGraph() traverses the input image once, but only output requested region
-	// CutGraph() traverses the output image once
-	ProgressReporter progress(this, 0, output_region.GetNumberOfPixels() + output_region.GetNumberOfPixels());
-
 	// allocate output
 	output->SetBufferedRegion(output_region); // \todo Is this correct?
 	output->Allocate();
+	output->FillBuffer(m_BackgroundValue);
 
-	// get the total image size
-	auto size = input->GetLargestPossibleRegion().GetSize();
+	// background pixels are not connected, so the graph only needs to cover the other pixels
+	m_GraphRegion = ComputeGraphRegion();
+	auto size = m_GraphRegion.GetSize();
 	timer.Stop("ITK init");
 
-	// create graph
-	timer.Start("Graph creation");
-	GraphType* graph = nullptr;
-	if (m_MaxFlowAlgorithm == kKohli)
+	if (m_GraphRegion.GetNumberOfPixels() == 0)
 	{
-		graph = new Gc::Flow::Grid::Kohli<NDimension, Gc::Float32, Gc::Float32, Gc::Float32, false>;
+		ReleaseGraph();
+		return;
 	}
-	else if (m_MaxFlowAlgorithm == kPushLabelFifo)
+
+	std::unique_ptr<BandType> band;
+	if (m_MultiResolution && m_GraphRegion.GetNumberOfPixels() > k_MinimumMultiResolutionPixels)
 	{
-		graph = new Gc::Flow::Grid::PushRelabel::Fifo<NDimension, Gc::Float32, Gc::Float32, false>;
+		timer.Start("Coarse cut");
+		band = ComputeCoarseCut();
+		timer.Stop("Coarse cut");
 	}
-	else if (m_MaxFlowAlgorithm == kPushLabelHighestLevel)
+
+	std::vector<unsigned char> states;
+	auto parameters = ComputeGraphParameters();
+	if (m_ReuseGraph && !band)
 	{
-		graph = new Gc::Flow::Grid::PushRelabel::HighestLevel<NDimension, Gc::Float32, Gc::Float32, false>;
+		ComputeNodeStates(states);
 	}
+	bool const update = m_ReuseGraph && !band && CanUpdateGraph(parameters, states);
+
+	// init ITK progress reporter
+	// InitializeGraph() traverses the graph region once
+	// CutGraph() traverses the output image once
+	ProgressReporter progress(this, 0, (update ? 0 : m_GraphRegion.GetNumberOfPixels()) + output_region.GetNumberOfPixels());
 
-	Gc::Math::Algebra::Vector<NDimension, Gc::Size> sizing;
-	for (unsigned int i = 0; i < NDimension; ++i)
+	if (update)
 	{
-		sizing[i] = size[i];
+		timer.Start("Graph update");
+		UpdateTerminalArcs(m_Graph.get(), states);
+		timer.Stop("Graph update");
 	}
-	Gc::Energy::Neighbourhood<NDimension, Gc::Int32> nb;
-	nb.Common(NeighborInfo<NDimension>::numberOfNeighbors(m_Connectivity), false);
-	Gc::System::Algo::Sort::Heap(nb.Begin(), nb.End());
-	graph->Init(sizing, nb);
-	timer.Stop("Graph creation");
+	else
+	{
+		// create graph, the band needs an implementation with mask support
+		timer.Start("Graph creation");
+		m_Graph.reset();
+		if (m_MaxFlowAlgorithm == kKohli)
+		{
+			if (band)
+				m_Graph.reset(new Gc::Flow::Grid::Kohli<NDimension, Gc::Float32, Gc::Float32, Gc::Float32, true>);
+			else
+				m_Graph.reset(new Gc::Flow::Grid::Kohli<NDimension, Gc::Float32, Gc::Float32, Gc::Float32, false>);
+		}
+		else if (m_MaxFlowAlgorithm == kPushLabelFifo)
+		{
+			if (band)
+				m_Graph.reset(new Gc::Flow::Grid::PushRelabel::Fifo<NDimension, Gc::Float32, Gc::Float32, true>);
+			else
+				m_Graph.reset(new Gc::Flow::Grid::PushRelabel::Fifo<NDimension, Gc::Float32, Gc::Float32, false>);
+		}
+		else if (m_MaxFlowAlgorithm == kPushLabelHighestLevel)
+		{
+			if (band)
+				m_Graph.reset(new Gc::Flow::Grid::PushRelabel::HighestLevel<NDimension, Gc::Float32, Gc::Float32, true>);
+			else
+				m_Graph.reset(new Gc::Flow::Grid::PushRelabel::HighestLevel<NDimension, Gc::Float32, Gc::Float32, false>);
+		}
+		else if (m_MaxFlowAlgorithm == kParallelKohli)
+		{
+			if (band)
+				m_Graph.reset(new Gc::Flow::Grid::DualDecomposition<NDimension, Gc::Float32, Gc::Float32, Gc::Float32, true>);
+			else
+				m_Graph.reset(new Gc::Flow::Grid::DualDecomposition<NDimension, Gc::Float32, Gc::Float32, Gc::Float32, false>);
+		}
 
-	timer.Start("Graph init");
-	InitializeGraph(graph, progress);
-	timer.Stop("Graph init");
+		Gc::Math::Algebra::Vector<NDimension, Gc::Size> sizing;
+		for (unsigned int i = 0; i < NDimension; ++i)
+		{
+			sizing[i] = size[i];
+		}
+		Gc::Energy::Neighbourhood<NDimension, Gc::Int32> nb;
+		nb.Common(NeighborInfo<NDimension>::numberOfNeighbors(m_Connectivity), false);
+		Gc::System::Algo::Sort::Heap(nb.Begin(), nb.End());
+		if (band)
+		{
+			band->InitGraph(m_Graph.get(), nb);
+		}
+		else
+		{
+			m_Graph->Init(sizing, nb);
+		}
+		timer.Stop("Graph creation");
 
-	if (this->GetAbortGenerateData())
-	{
-		return;
+		timer.Start("Graph init");
+		InitializeGraph(m_Graph.get(), band.get(), progress);
+		timer.Stop("Graph init");
+
+		if (this->GetAbortGenerateData())
+		{
+			ReleaseGraph();
+			return;
+		}
 	}
 
 	// cut graph
 	timer.Start("Graph cut");
-	graph->FindMaxFlow();
+	m_Graph->FindMaxFlow();
 	timer.Stop("Graph cut");
 
 	timer.Start("Query results");
-	CutGraph(graph, progress); //&
+	CutGraph(m_Graph.get(), band.get(), progress); //&
 	timer.Stop("Query results");
 
+	if (m_ReuseGraph && !band && m_Graph->IsDynamic())
+	{
+		m_GraphParameters = parameters;
+		m_NodeState.swap(states);
+	}
+	else
+	{
+		ReleaseGraph();
+	}
+
 	if (m_PrintTimer)
 	{
 		timer.Report(std::cout);
@@ -153,7 +219,212 @@ void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::GenerateData
 }
 
 template<typename TInput, typename TOutput, typename TInputIntensityImage>
-void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::InitializeGraph(GraphType* graph, ProgressReporter& progress)
+typename GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::RegionType
+		GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::ComputeGraphRegion()
+{
+	auto input = GetMaskInput();
+	auto output_region = this->GetOutput()->GetRequestedRegion();
+
+	typename InputImageType::IndexType lo = output_region.GetUpperIndex(), hi = output_region.GetIndex();
+	bool found = false;
+	itk::ImageRegionConstIteratorWithIndex<InputImageType> it(input, output_region);
+	for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+	{
+		if (it.Get() != m_BackgroundValue)
+		{
+			auto const idx = it.GetIndex();
+			for (unsigned int d = 0; d < NDimension; ++d)
+			{
+				lo[d] = std::min(lo[d], idx[d]);
+				hi[d] = std::max(hi[d], idx[d]);
+			}
+			found = true;
+		}
+	}
+
+	RegionType region;
+	if (found)
+	{
+		region.SetIndex(lo);
+		region.SetUpperIndex(hi);
+	}
+	else
+	{
+		region.SetIndex(output_region.GetIndex());
+		region.GetModifiableSize().Fill(0);
+	}
+	return region;
+}
+
+template<typename TInput, typename TOutput, typename TInputIntensityImage>
+size_t GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::GraphIndex(const typename InputImageType::IndexType& idx) const
+{
+	size_t offset = 0, stride = 1;
+	for (unsigned int d = 0; d < NDimension; ++d)
+	{
+		offset += (idx[d] - m_GraphRegion.GetIndex()[d]) * stride;
+		stride *= m_GraphRegion.GetSize()[d];
+	}
+	return offset;
+}
+
+template<typename TInput, typename TOutput, typename TInputIntensityImage>
+std::unique_ptr<typename GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::BandType>
+		GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::ComputeCoarseCut()
+{
+	using CoarseIntensityImageType = itk::Image<float, NDimension>;
+	using CoarseSeparatorType = GraphCutLabelSeparator<InputImageType, OutputImageType, CoarseIntensityImageType>;
+	using PixelType = typename InputImageType::PixelType;
+	unsigned int const factor = 2;
+
+	auto input = GetMaskInput();
+
+	// a coarse pixel keeps the seeds of its block, object 1 takes precedence
+	auto priority = [this](PixelType v) {
+		return (v == m_Object1Value) ? 3 : (v == m_Object2Value) ? 2 : (v != m_BackgroundValue) ? 1 : 0;
+	};
+	auto coarse_mask = ShrinkImage<InputImageType>(input, m_GraphRegion, factor, m_BackgroundValue, [&priority](PixelType a, PixelType b) {
+		return priority(b) > priority(a) ? b : a;
+	});
+
+	auto coarse = CoarseSeparatorType::New();
+	coarse->SetSigma(m_Sigma);
+	coarse->SetConnectivity(m_Connectivity);
+	coarse->SetMaxFlowAlgorithm(m_MaxFlowAlgorithm);
+	coarse->SetObject1Value(m_Object1Value);
+	coarse->SetObject2Value(m_Object2Value);
+	coarse->SetBackgroundValue(m_BackgroundValue);
+	coarse->SetUseGradientMagnitude(m_UseGradientMagnitude);
+	coarse->SetMultiResolution(m_MultiResolution);
+	coarse->SetBandRadius(m_BandRadius);
+	coarse->SetMaskInput(coarse_mask);
+	if (m_UseGradientMagnitude)
+	{
+		// the spacing is scaled, so sigma is the same in physical units
+		coarse->SetIntensityInput(MeanShrinkImage<CoarseIntensityImageType>(GetIntensityInput(), m_GraphRegion, factor));
+	}
+	coarse->Update();
+
+	std::vector<unsigned char> labels;
+	labels.reserve(coarse_mask->GetLargestPossibleRegion().GetNumberOfPixels());
+	itk::ImageRegionConstIterator<OutputImageType> it(coarse->GetOutput(), coarse->GetOutput()->GetLargestPossibleRegion());
+	for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+	{
+		auto const v = it.Get();
+		labels.push_back((v == m_BackgroundValue) ? BandType::kExcluded : (v == m_Object1Value) ? BandType::kSource : BandType::kSink);
+	}
+
+	std::unique_ptr<BandType> band(new BandType(m_GraphRegion.GetSize(), factor, labels));
+
+	// seeds which disagree with the coarse cut are resolved at full resolution
+	itk::ImageRegionConstIteratorWithIndex<InputImageType> mask_it(input, m_GraphRegion);
+	for (mask_it.GoToBegin(); !mask_it.IsAtEnd(); ++mask_it)
+	{
+		auto const v = mask_it.Get();
+		auto const idx = GraphIndex(mask_it.GetIndex());
+		if ((v == m_Object1Value && band->CoarseLabel(idx) != BandType::kSource) ||
+				(v == m_Object2Value && band->CoarseLabel(idx) != BandType::kSink))
+		{
+			band->AddToBand(idx);
+		}
+	}
+	band->Build(m_BandRadius);
+
+	for (mask_it.GoToBegin(); !mask_it.IsAtEnd(); ++mask_it)
+	{
+		if (mask_it.Get() == m_BackgroundValue)
+		{
+			band->Exclude(GraphIndex(mask_it.GetIndex()));
+		}
+	}
+	return band;
+}
+
+template<typename TInput, typename TOutput, typename TInputIntensityImage>
+typename GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::GraphParameters
+		GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::ComputeGraphParameters()
+{
+	GraphParameters parameters;
+	parameters.largestRegion = GetMaskInput()->GetLargestPossibleRegion();
+	parameters.region = m_GraphRegion;
+	parameters.connectivity = m_Connectivity;
+	parameters.algorithm = m_MaxFlowAlgorithm;
+	parameters.useGradientMagnitude = m_UseGradientMagnitude;
+	parameters.sigma = m_Sigma;
+
+	// the intensity image may be a new wrapper around the same buffer, so the content is compared
+	parameters.intensityHash = 0;
+	if (m_UseGradientMagnitude && m_ReuseGraph && GetIntensityInput())
+	{
+		std::uint64_t hash = 14695981039346656037ull; // FNV-1a
+		itk::ImageRegionConstIterator<IntensityImageType> it(GetIntensityInput(), parameters.region);
+		for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+		{
+			float const v = static_cast<float>(it.Get());
+			std::uint32_t bits;
+			std::memcpy(&bits, &v, sizeof(bits));
+			hash = (hash ^ bits) * 1099511628211ull;
+		}
+		parameters.intensityHash = hash;
+	}
+	return parameters;
+}
+
+template<typename TInput, typename TOutput, typename TInputIntensityImage>
+void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::ComputeNodeStates(std::vector<unsigned char>& states)
+{
+	states.assign(m_GraphRegion.GetNumberOfPixels(), kNodeBackground);
+
+	itk::ImageRegionConstIterator<InputImageType> it(GetMaskInput(), m_GraphRegion);
+	auto state = states.begin();
+	for (it.GoToBegin(); !it.IsAtEnd(); ++it, ++state)
+	{
+		auto v = it.Get();
+		if (v == m_Object1Value)
+			*state = kNodeObject1;
+		else if (v == m_Object2Value)
+			*state = kNodeObject2;
+		else if (v != m_BackgroundValue)
+			*state = kNodeObject;
+	}
+}
+template<typename TInput, typename TOutput, typename TInputIntensityImage>
+bool GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::CanUpdateGraph(const GraphParameters& parameters, const std::vector<unsigned char>& states) const
+{
+	// only the terminal arcs can be modified in a solved graph
+	if (!m_Graph || !m_Graph->IsDynamic() || !(parameters == m_GraphParameters) || states.size() != m_NodeState.size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < states.size(); ++i)
+	{
+		if ((states[i] == kNodeBackground) != (m_NodeState[i] == kNodeBackground))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+template<typename TInput, typename TOutput, typename TInputIntensityImage>
+void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::UpdateTerminalArcs(GraphType* graph, const std::vector<unsigned char>& states)
+{
+	for (size_t i = 0; i < states.size(); ++i)
+	{
+		if (states[i] != m_NodeState[i])
+		{
+			if (states[i] == kNodeObject1)
+				graph->SetTerminalArcCap(i, 100000, 0); // source
+			else if (states[i] == kNodeObject2)
+				graph->SetTerminalArcCap(i, 0, 100000); // sink
+			else
+				graph->SetTerminalArcCap(i, 0, 0);
+		}
+	}
+}
+
+template<typename TInput, typename TOutput, typename TInputIntensityImage>
+void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::InitializeGraph(GraphType* graph, const BandType* band, ProgressReporter& progress)
 {
 	using RealImageType = itk::Image<float, NDimension>;
 	using MaskIteratorType = itk::ShapedNeighborhoodIterator<InputImageType>;
@@ -163,8 +434,6 @@ void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::InitializeGr
 
 	const bool& abort = this->GetAbortGenerateData(); // use reference (alias) to original flag!
 	auto input = GetMaskInput();
-	auto output = this->GetOutput();
-	auto output_region = output->GetRequestedRegion();
 	OffsetType center;
 	center.Fill(0);
 	itk::Size<NDimension> radius;
@@ -175,7 +444,7 @@ void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::InitializeGr
 	NeighborInfo<NDimension>::buildNeighbors(neighbors, m_Connectivity);
 	auto const num_neighbors = neighbors.size();
 
-	MaskIteratorType iterator(radius, input, output_region);
+	MaskIteratorType iterator(radius, input, m_GraphRegion);
 	iterator.ClearActiveList();
 	for (size_t i = 0; i < neighbors.size(); ++i)
 	{
@@ -183,6 +452,25 @@ void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::InitializeGr
 	}
 	iterator.ActivateOffset(center);
 
+	// node of a pixel in the graph region
+	auto node_index = [this, band](const typename InputImageType::IndexType& idx, Gc::Size& node) {
+		auto const n = GraphIndex(idx);
+		if (band && !band->InBand(n))
+		{
+			return false;
+		}
+		node = band ? band->Node(n) : n;
+		return true;
+	};
+
+	// Set source/sink nodes in graph
+	auto set_terminal_arcs = [this, graph](Gc::Size node, typename InputImageType::PixelType v) {
+		if (v == m_Object1Value)
+			graph->SetTerminalArcCap(node, 100000, 0); // source
+		else if (v == m_Object2Value)
+			graph->SetTerminalArcCap(node, 0, 100000); // sink
+	};
+
 	if (m_UseGradientMagnitude)
 	{
 		if (!GetIntensityInput())
@@ -193,12 +481,13 @@ void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::InitializeGr
 		auto magnitude_filter = GradientMagnitudeFilter::New();
 		magnitude_filter->SetInput(GetIntensityInput());
 		magnitude_filter->SetSigma(m_Sigma);
-		magnitude_filter->GetOutput()->SetRequestedRegion(output_region);
+		magnitude_filter->GetOutput()->SetRequestedRegion(m_GraphRegion);
 		magnitude_filter->Update();
 		auto gradient_magnitude = magnitude_filter->GetOutput();
 
 		auto calculator = itk::MinimumMaximumImageCalculator<RealImageType>::New();
 		calculator->SetImage(gradient_magnitude);
+		calculator->SetRegion(m_GraphRegion);
 		calculator->Compute();
 
 		auto min_gm = calculator->GetMinimum();
@@ -225,20 +514,19 @@ void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::InitializeGr
 			return;
 		}
 
-		GradientMagnitudeIteratorType iterator2(radius, gradient_magnitude, output_region);
+		GradientMagnitudeIteratorType iterator2(radius, gradient_magnitude, m_GraphRegion);
 		for (iterator.GoToBegin(), iterator2.GoToBegin(); !iterator.IsAtEnd() && !abort; ++iterator, ++iterator2)
 		{
 			progress.CompletedPixel();
 
 			bool pixelIsValidcenter; // BL TODO, slow
 			auto centerPixel = iterator.GetPixel(center, pixelIsValidcenter);
-			if (!pixelIsValidcenter)
+			Gc::Size nodeIndex1;
+			if (!pixelIsValidcenter || !node_index(iterator.GetIndex(center), nodeIndex1))
 			{
 				continue;
 			}
 
-			unsigned int nodeIndex1 = input->ComputeOffset(iterator.GetIndex(center));
-
 			// Set weights on edges
 			for (size_t i = 0; i < num_neighbors; i++)
 			{
@@ -253,19 +541,15 @@ void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::InitializeGr
 				{
 					// Compute the edge weight GradientMag-Vector also available
 					bool is_valid; // assume is always valid
-					auto gm1 = rescale(iterator.GetPixel(center, is_valid));
-					auto gm2 = rescale(iterator.GetPixel(neighbors[i], is_valid));
+					auto gm1 = rescale(iterator2.GetPixel(center, is_valid));
+					auto gm2 = rescale(iterator2.GetPixel(neighbors[i], is_valid));
 
 					auto invgm = 1.0 / (0.01 + gm1 + gm2); // [0.5, 100.0]
 					graph->SetArcCap(nodeIndex1, i, invgm);
 				}
 			}
 
-			// Set source/sink nodes in graph
-			if (centerPixel == m_Object1Value)
-				graph->SetTerminalArcCap(nodeIndex1, 100000, 0); // source
-			else if (centerPixel == m_Object2Value)
-				graph->SetTerminalArcCap(nodeIndex1, 0, 100000); // sink
+			set_terminal_arcs(nodeIndex1, centerPixel);
 		}
 	}
 	else
@@ -276,13 +560,12 @@ void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::InitializeGr
 
 			bool pixelIsValidcenter; // BL TODO, slow
 			auto centerPixel = iterator.GetPixel(center, pixelIsValidcenter);
-			if (!pixelIsValidcenter)
+			Gc::Size nodeIndex1;
+			if (!pixelIsValidcenter || !node_index(iterator.GetIndex(center), nodeIndex1))
 			{
 				continue;
 			}
 
-			unsigned int nodeIndex1 = input->ComputeOffset(iterator.GetIndex(center));
-
 			// Set weights on edges
 			for (size_t i = 0; i < num_neighbors; i++)
 			{
@@ -299,47 +582,41 @@ void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::InitializeGr
 				}
 			}
 
-			// Set source/sink nodes in graph
-			if (centerPixel == m_Object1Value)
-				graph->SetTerminalArcCap(nodeIndex1, 100000, 0); // source
-			else if (centerPixel == m_Object2Value)
-				graph->SetTerminalArcCap(nodeIndex1, 0, 100000); // sink
+			set_terminal_arcs(nodeIndex1, centerPixel);
 		}
 	}
+
+	if (band && !abort)
+	{
+		band->ConstrainBorder(graph, 100000);
+	}
 }
 
 template<typename TInput, typename TOutput, typename TInputIntensityImage>
-void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::CutGraph(GraphType* graph, ProgressReporter& progress)
+void GraphCutLabelSeparator<TInput, TOutput, TInputIntensityImage>::CutGraph(GraphType* graph, const BandType* band, ProgressReporter& progress)
 {
 	// Iterate over the output image, querying the graph for the association of each pixel
 	auto input = GetMaskInput();
 	auto output = this->GetOutput();
 	auto outputRegion = output->GetRequestedRegion();
-	itk::ImageRegionIterator<InputImageType> input_iterator(input, outputRegion);
+	itk::ImageRegionConstIteratorWithIndex<InputImageType> input_iterator(input, outputRegion);
 	itk::ImageRegionIterator<OutputImageType> output_iterator(output, outputRegion);
 
-	// \todo BL iterate over flat indices to avoid converting ijk to voxelIndex
 	const bool& abort = this->GetAbortGenerateData();
 	output_iterator.GoToBegin();
 	input_iterator.GoToBegin();
 	for (; !output_iterator.IsAtEnd() && !abort; ++input_iterator, ++output_iterator)
 	{
+		// the graph region contains all pixels which are not background
 		if (input_iterator.Get() == m_BackgroundValue)
 		{
 			output_iterator.Set(m_BackgroundValue);
 		}
 		else
 		{
-			// \warning If we update less than LargestPossibleRegion, this may be incorrect
-			unsigned int voxelIndex = input->ComputeOffset(input_iterator.GetIndex());
-			if (graph->NodeOrigin(voxelIndex) == Gc::Flow::Source)
-			{
-				output_iterator.Set(m_Object1Value);
-			}
-			else
-			{
-				output_iterator.Set(m_Object2Value);
-			}
+			auto const voxelIndex = GraphIndex(input_iterator.GetIndex());
+			bool const is_source = band ? (band->Label(graph, voxelIndex) == BandType::kSource) : (graph->NodeOrigin(voxelIndex) == Gc::Flow::Source);
+			output_iterator.Set(is_source ? m_Object1Value : m_Object2Value);
 		}
 		progress.CompletedPixel();
 	}
@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+// ITK
+#include <itkImage.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
+
+// STL
+#include <algorithm>
+#include <vector>
+
+// Gc
+#include "Energy/Neighbourhood.h"
+#include "Flow/IGridMaxFlow.h"
+#include "System/Collection/Array.h"
+#include "System/Collection/BoolArrayMask.h"
+
+namespace itk {
+
+/** \brief Narrow band around a graph cut computed on a coarser grid.
+
+	Coarse-to-fine graph cut: the cut is first computed on a grid which is 'factor' times smaller.
+	The full resolution graph only contains the pixels within 'radius' coarse pixels of the coarse
+	cut, the nodes at the border of the band are fixed to the coarse solution and all other pixels
+	take the label of their coarse pixel. Pixels are indexed linearly in a grid of size 'size'.
+*/
+template<unsigned int NDim>
+class GraphCutBand
+{
+public:
+	using SizeType = itk::Size<NDim>;
+	using GraphType = Gc::Flow::IGridMaxFlow<NDim, Gc::Float32, Gc::Float32, Gc::Float32>;
+
+	enum eLabel : unsigned char {
+		kExcluded = 0, // not part of the graph
+		kSource,
+		kSink
+	};
+
+	static SizeType CoarseSize(const SizeType& size, unsigned int factor)
+	{
+		SizeType coarse_size;
+		for (unsigned int d = 0; d < NDim; ++d)
+		{
+			coarse_size[d] = (size[d] + factor - 1) / factor;
+		}
+		return coarse_size;
+	}
+
+	GraphCutBand(const SizeType& size, unsigned int factor, const std::vector<unsigned char>& coarse_labels)
+			: m_Size(size), m_CoarseSize(CoarseSize(size, factor)), m_Factor(factor), m_CoarseLabels(coarse_labels)
+	{
+		m_CoarseBand.assign(m_CoarseLabels.size(), false);
+
+		// coarse pixels next to a pixel with the other label
+		for (size_t i = 0; i < m_CoarseLabels.size(); ++i)
+		{
+			if (m_CoarseLabels[i] == kExcluded)
+				continue;
+
+			size_t idx = i, stride = 1;
+			for (unsigned int d = 0; d < NDim; stride *= m_CoarseSize[d], ++d)
+			{
+				size_t const c = idx % m_CoarseSize[d];
+				idx /= m_CoarseSize[d];
+				if ((c > 0 && IsOtherLabel(i, i - stride)) || (c + 1 < m_CoarseSize[d] && IsOtherLabel(i, i + stride)))
+				{
+					m_CoarseBand[i] = true;
+					break;
+				}
+			}
+		}
+	}
+
+	/// Add the coarse pixel of 'idx' to the band, e.g. because it contains a seed with the other label
+	void AddToBand(size_t idx) { m_CoarseBand[CoarseIndex(idx)] = true; }
+
+	/// Dilate the band by 'radius' coarse pixels and compute which pixels are part of the graph
+	void Build(unsigned int radius)
+	{
+		size_t stride = 1;
+		for (unsigned int d = 0; d < NDim; stride *= m_CoarseSize[d], ++d)
+		{
+			std::vector<bool> dilated(m_CoarseBand.size(), false);
+			for (size_t i = 0; i < m_CoarseBand.size(); ++i)
+			{
+				if (!m_CoarseBand[i])
+					continue;
+				long const c = static_cast<long>((i / stride) % m_CoarseSize[d]);
+				long const lo = std::max<long>(c - radius, 0);
+				long const hi = std::min<long>(c + radius, m_CoarseSize[d] - 1);
+				for (long k = lo; k <= hi; ++k)
+				{
+					dilated[i + (k - c) * stride] = true;
+				}
+			}
+			m_CoarseBand.swap(dilated);
+		}
+
+		Gc::Math::Algebra::Vector<NDim, Gc::Size> dims;
+		for (unsigned int d = 0; d < NDim; ++d)
+		{
+			dims[d] = m_Size[d];
+		}
+		m_Masked.Resize(dims, true);
+		for (size_t i = 0; i < m_Masked.Elements(); ++i)
+		{
+			auto const c = CoarseIndex(i);
+			m_Masked[i] = !m_CoarseBand[c] || m_CoarseLabels[c] == kExcluded;
+		}
+	}
+
+	/// Remove a pixel from the graph, must be called before InitGraph
+	void Exclude(size_t idx) { m_Masked[idx] = true; }
+
+	/// Initialize a graph which supports masks with the nodes in the band
+	void InitGraph(GraphType* graph, const Gc::Energy::Neighbourhood<NDim, Gc::Int32>& nb)
+	{
+		Gc::System::Collection::BoolArrayMask<NDim> mask(m_Masked, true);
+		graph->InitMask(m_Masked.Dimensions(), nb, mask);
+		m_Nodes = mask.BackwardIndexes();
+	}
+
+	bool InBand(size_t idx) const { return !m_Masked[idx]; }
+
+	/// Bounding box of the band (after Build), in pixels of the grid
+	itk::ImageRegion<NDim> BoundingRegion() const
+	{
+		itk::Index<NDim> lo, hi;
+		lo.Fill(itk::NumericTraits<itk::IndexValueType>::max());
+		hi.Fill(-1);
+		for (size_t i = 0; i < m_CoarseBand.size(); ++i)
+		{
+			if (!m_CoarseBand[i] || m_CoarseLabels[i] == kExcluded)
+				continue;
+			size_t idx = i;
+			for (unsigned int d = 0; d < NDim; ++d)
+			{
+				auto const c = static_cast<itk::IndexValueType>(idx % m_CoarseSize[d]);
+				idx /= m_CoarseSize[d];
+				lo[d] = std::min(lo[d], c * m_Factor);
+				hi[d] = std::max(hi[d], std::min<itk::IndexValueType>((c + 1) * m_Factor, m_Size[d]) - 1);
+			}
+		}
+
+		itk::ImageRegion<NDim> region;
+		if (hi[0] >= lo[0])
+		{
+			region.SetIndex(lo);
+			region.SetUpperIndex(hi);
+		}
+		return region;
+	}
+
+	/// Node index in the graph of a pixel in the band
+	Gc::Size Node(size_t idx) const { return m_Nodes[idx]; }
+
+	unsigned char CoarseLabel(size_t idx) const { return m_CoarseLabels[CoarseIndex(idx)]; }
+
+	/// Fix the nodes next to pixels outside of the band to the coarse solution
+	void ConstrainBorder(GraphType* graph, Gc::Float32 cap) const
+	{
+		for (size_t i = 0; i < m_Masked.Elements(); ++i)
+		{
+			if (!InBand(i))
+				continue;
+
+			size_t idx = i, stride = 1;
+			for (unsigned int d = 0; d < NDim; stride *= m_Size[d], ++d)
+			{
+				size_t const c = idx % m_Size[d];
+				idx /= m_Size[d];
+				size_t const neighbors[2] = {c > 0 ? i - stride : i, c + 1 < m_Size[d] ? i + stride : i};
+				auto it = std::find_if(neighbors, neighbors + 2, [this](size_t j) {
+					return !m_CoarseBand[CoarseIndex(j)] && CoarseLabel(j) != kExcluded;
+				});
+				if (it != neighbors + 2)
+				{
+					auto const label = CoarseLabel(*it);
+					graph->SetTerminalArcCap(Node(i), label == kSource ? cap : 0, label == kSink ? cap : 0);
+					break;
+				}
+			}
+		}
+	}
+
+	/// Label of a pixel after the cut, from the graph in the band and else from the coarse cut
+	unsigned char Label(const GraphType* graph, size_t idx) const
+	{
+		if (InBand(idx))
+		{
+			return graph->NodeOrigin(Node(idx)) == Gc::Flow::Source ? kSource : kSink;
+		}
+		return CoarseLabel(idx);
+	}
+
+private:
+	bool IsOtherLabel(size_t i, size_t j) const
+	{
+		return m_CoarseLabels[j] != kExcluded && m_CoarseLabels[j] != m_CoarseLabels[i];
+	}
+
+	size_t CoarseIndex(size_t idx) const
+	{
+		size_t coarse = 0, stride = 1;
+		for (unsigned int d = 0; d < NDim; ++d)
+		{
+			coarse += ((idx % m_Size[d]) / m_Factor) * stride;
+			idx /= m_Size[d];
+			stride *= m_CoarseSize[d];
+		}
+		return coarse;
+	}
+
+	SizeType m_Size;
+	SizeType m_CoarseSize;
+	unsigned int m_Factor;
+	std::vector<unsigned char> m_CoarseLabels;
+	std::vector<bool> m_CoarseBand;
+	Gc::System::Collection::Array<NDim, bool> m_Masked;
+	Gc::System::Collection::Array<NDim, Gc::Size> m_Nodes;
+};
+
+/** \brief Shrink 'region' of an image by 'factor', combining the pixels of each block with 'reduce'.
+	The spacing is scaled by 'factor'.
+*/
+template<typename TOutputImage, typename TInputImage, typename TReduce>
+typename TOutputImage::Pointer ShrinkImage(const TInputImage* image, const typename TInputImage::RegionType& region, unsigned int factor, typename TOutputImage::PixelType init, TReduce reduce)
+{
+	unsigned int const dim = TInputImage::ImageDimension;
+
+	typename TOutputImage::SpacingType spacing;
+	for (unsigned int d = 0; d < dim; ++d)
+	{
+		spacing[d] = image->GetSpacing()[d] * factor;
+	}
+	typename TInputImage::PointType origin;
+	image->TransformIndexToPhysicalPoint(region.GetIndex(), origin);
+
+	auto output = TOutputImage::New();
+	output->SetRegions(GraphCutBand<dim>::CoarseSize(region.GetSize(), factor));
+	output->SetSpacing(spacing);
+	output->SetOrigin(origin);
+	output->Allocate();
+	output->FillBuffer(init);
+
+	typename TOutputImage::IndexType coarse_idx;
+	itk::ImageRegionConstIteratorWithIndex<TInputImage> it(image, region);
+	for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+	{
+		auto const idx = it.GetIndex();
+		for (unsigned int d = 0; d < dim; ++d)
+		{
+			coarse_idx[d] = (idx[d] - region.GetIndex()[d]) / factor;
+		}
+		auto& v = output->GetPixel(coarse_idx);
+		v = reduce(v, it.Get());
+	}
+	return output;
+}
+
+/// Shrink 'region' of an image by 'factor', averaging the pixels of each block
+template<typename TOutputImage, typename TInputImage>
+typename TOutputImage::Pointer MeanShrinkImage(const TInputImage* image, const typename TInputImage::RegionType& region, unsigned int factor)
+{
+	using pixel_type = typename TOutputImage::PixelType;
+	auto sum = ShrinkImage<TOutputImage>(image, region, factor, pixel_type(0), [](pixel_type a, pixel_type b) { return a + b; });
+	auto count = ShrinkImage<TOutputImage>(image, region, factor, pixel_type(0), [](pixel_type a, pixel_type) { return a + 1; });
+
+	auto sum_buffer = sum->GetBufferPointer();
+	auto count_buffer = count->GetBufferPointer();
+	for (size_t i = 0, n = sum->GetLargestPossibleRegion().GetNumberOfPixels(); i < n; ++i)
+	{
+		sum_buffer[i] /= std::max(count_buffer[i], pixel_type(1));
+	}
+	return sum;
+}
+
+} // namespace itk
@@ -21,6 +21,7 @@
 #include <itkMatrix.h>
 #include <itkProgressReporter.h>
 #include <itkRecursiveGaussianImageFilter.h>
+#include <itkRegionOfInterestImageFilter.h>
 #include <itkShapedNeighborhoodIterator.h>
 #include <itkSymmetricEigenAnalysis.h>
 #include <itkTimeProbesCollectorBase.h>
@@ -28,10 +29,15 @@
 
 // STL
 #include <fstream>
+#include <limits>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "GraphCutBand.h"
+
 // Gc
+#include "Flow/Grid/DualDecomposition.h"
 #include "Flow/Grid/Kohli.h"
 #include "Flow/Grid/PushRelabel/Fifo.h"
 #include "Flow/Grid/PushRelabel/HighestLevel.h"
@@ -71,6 +77,7 @@ public:
 		kKohli = 0,
 		kPushLabelFifo = 1,
 		kPushLabelHighestLevel = 2,
+		kParallelKohli = 3,
 	};
 
 	using ProcessObject::SetNumberOfRequiredInputs;
@@ -92,6 +99,13 @@ public:
 
 	void SetMaxFlowAlgorithm(eMaxFlowAlgorithm alg) { m_MaxFlowAlgorithm = alg; }
 
+	/** Compute the cut on a grid shrunk by 2 first (recursively) and build the full resolution
+		graph only in a narrow band of 'band radius' coarse pixels around the coarse cut.
+	*/
+	void SetMultiResolution(bool b) { m_MultiResolution = b; }
+
+	void SetBandRadius(unsigned int r) { m_BandRadius = r; }
+
 	void SetForegroundPixelValue(typename OutputImageType::PixelType v)
 	{
 		m_ForegroundPixelValue = v;
@@ -137,10 +151,29 @@ private:
 		typename InputImageType::RegionType outputRegion;
 	};
 	using GraphType = Gc::Flow::IGridMaxFlow<3, Gc::Float32, Gc::Float32, Gc::Float32>;
+	using BandType = GraphCutBand<3>;
 
-	void InitializeGraph(GraphType*, ImageContainer, ProgressReporter& progress);
+	// smaller graphs are not solved coarse-to-fine
+	static constexpr size_t k_MinimumMultiResolutionPixels = 1 << 18;
+
+	// padding of the crop in which the features of the band are computed, covers the smoothing filters
+	static constexpr unsigned int k_FeatureSupport = 6;
+
+	enum eTerminal : unsigned char {
+		kNoTerminal = 0,
+		kSourceTerminal,
+		kSinkTerminal
+	};
 
-	void CutGraph(GraphType*, ImageContainer, ProgressReporter& progress);
+	void InitializeGraph(GraphType*, ImageContainer, const BandType* band, ProgressReporter& progress);
+
+	void ComputeSeeds(ImageContainer, std::vector<unsigned char>& seeds);
+
+	std::unique_ptr<BandType> ComputeCoarseCut(ImageContainer, const std::vector<unsigned char>& seeds);
+
+	void SetTerminalArcs(GraphType*, const std::vector<unsigned char>& seeds, const BandType* band);
+
+	void CutGraph(GraphType*, ImageContainer, const BandType* band, ProgressReporter& progress);
 
 	// convert 3d itk indices to a continously numbered indices
 	unsigned int ConvertIndexToVertexDescriptor(const itk::Index<3>, typename InputImageType::RegionType);
@@ -164,6 +197,11 @@ private:
 	typename OutputImageType::PixelType m_ForegroundPixelValue;
 	typename OutputImageType::PixelType m_BackgroundPixelValue;
 	bool m_PrintTimer = true;
+	bool m_MultiResolution = false;
+	unsigned int m_BandRadius = 2;
+
+	// terminal of each node from the intensity term, overridden by the seeds
+	std::vector<unsigned char> m_ImageTerminals;
 
 private:
 	ImageGraphCutFilter(const Self&); // intentionally not implemented
@@ -50,7 +50,18 @@ void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::GenerateDat
 	auto size = images.inputRegion.GetSize();
 	timer.Stop("ITK init");
 
-	// create graph
+	std::vector<unsigned char> seeds;
+	ComputeSeeds(images, seeds);
+
+	std::unique_ptr<BandType> band;
+	if (m_MultiResolution && images.inputRegion.GetNumberOfPixels() > k_MinimumMultiResolutionPixels)
+	{
+		timer.Start("Coarse cut");
+		band = ComputeCoarseCut(images, seeds);
+		timer.Stop("Coarse cut");
+	}
+
+	// create graph, the band needs an implementation with mask support
 	timer.Start("Graph creation");
 	typename InputImageType::SizeType::SizeValueType d[] = {size[0], size[1], size[2]};
 	Gc::Math::Algebra::Vector<3, Gc::Size> sizing;
@@ -65,25 +76,48 @@ void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::GenerateDat
 		nb.Common(6, false);
 	}
 	Gc::System::Algo::Sort::Heap(nb.Begin(), nb.End());
-	GraphType* graph = nullptr;
+	std::unique_ptr<GraphType> graph;
 	if (m_MaxFlowAlgorithm == kKohli)
 	{
-		graph = new Gc::Flow::Grid::Kohli<3, Gc::Float32, Gc::Float32, Gc::Float32, false>;
+		if (band)
+			graph.reset(new Gc::Flow::Grid::Kohli<3, Gc::Float32, Gc::Float32, Gc::Float32, true>);
+		else
+			graph.reset(new Gc::Flow::Grid::Kohli<3, Gc::Float32, Gc::Float32, Gc::Float32, false>);
 	}
 	else if (m_MaxFlowAlgorithm == kPushLabelFifo)
 	{
-		graph = new Gc::Flow::Grid::PushRelabel::Fifo<3, Gc::Float32, Gc::Float32, false>;
+		if (band)
+			graph.reset(new Gc::Flow::Grid::PushRelabel::Fifo<3, Gc::Float32, Gc::Float32, true>);
+		else
+			graph.reset(new Gc::Flow::Grid::PushRelabel::Fifo<3, Gc::Float32, Gc::Float32, false>);
 	}
 	else if (m_MaxFlowAlgorithm == kPushLabelHighestLevel)
 	{
-		graph = new Gc::Flow::Grid::PushRelabel::HighestLevel<3, Gc::Float32, Gc::Float32, false>;
+		if (band)
+			graph.reset(new Gc::Flow::Grid::PushRelabel::HighestLevel<3, Gc::Float32, Gc::Float32, true>);
+		else
+			graph.reset(new Gc::Flow::Grid::PushRelabel::HighestLevel<3, Gc::Float32, Gc::Float32, false>);
+	}
+	else if (m_MaxFlowAlgorithm == kParallelKohli)
+	{
+		if (band)
+			graph.reset(new Gc::Flow::Grid::DualDecomposition<3, Gc::Float32, Gc::Float32, Gc::Float32, true>);
+		else
+			graph.reset(new Gc::Flow::Grid::DualDecomposition<3, Gc::Float32, Gc::Float32, Gc::Float32, false>);
 	}
 
-	graph->Init(sizing, nb);
+	if (band)
+	{
+		band->InitGraph(graph.get(), nb);
+	}
+	else
+	{
+		graph->Init(sizing, nb);
+	}
 	timer.Stop("Graph creation");
 
 	timer.Start("Graph init");
-	InitializeGraph(graph, images, progress);
+	InitializeGraph(graph.get(), images, band.get(), progress);
 	timer.Stop("Graph init");
 
 	if (this->GetAbortGenerateData())
@@ -91,13 +125,19 @@ void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::GenerateDat
 		return;
 	}
 
+	SetTerminalArcs(graph.get(), seeds, band.get());
+	if (band)
+	{
+		band->ConstrainBorder(graph.get(), 100000);
+	}
+
 	// cut graph
 	timer.Start("Graph cut");
 	graph->FindMaxFlow();
 	timer.Stop("Graph cut");
 
 	timer.Start("Query results");
-	CutGraph(graph, images, progress); //&
+	CutGraph(graph.get(), images, band.get(), progress); //&
 	timer.Stop("Query results");
 
 	std::ofstream ofile("C:/Temp/gc_timer.log");
@@ -113,26 +153,14 @@ void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::GenerateDat
 }
 
 template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
-void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::InitializeGraph(GraphType* graph, ImageContainer images, ProgressReporter& progress)
+void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::InitializeGraph(GraphType* graph, ImageContainer images, const BandType* band, ProgressReporter& progress)
 {
-	typename InputImageType::SizeType size = images.inputRegion.GetSize();
-
-	std::vector<double> pixels(size[0] * size[1] * size[2]);
-
-	//compute S field
 	itk::Size<3> radius;
 	radius.Fill(3);
 
 	using IteratorType = itk::ShapedNeighborhoodIterator<InputImageType>;
 	typename IteratorType::OffsetType center = {{0, 0, 0}};
 
-	//Gaussian Filter for Edge enhancement
-	using filterType = itk::DiscreteGaussianImageFilter<InputImageType, InputImageType>;
-	auto gaussianFilter = filterType::New();
-	gaussianFilter->SetInput(images.input);
-	gaussianFilter->SetVariance(1);
-	auto filtered = gaussianFilter->GetOutput();
-
 	Gc::Energy::Neighbourhood<3, Gc::Int32> nb(26);
 	nb.Common(26, false);
 	if (m_6Connected == true)
@@ -142,6 +170,18 @@ void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::InitializeG
 	}
 	Gc::System::Algo::Sort::Heap(nb.Begin(), nb.End());
 
+	// the arcs are only added for the nodes in the graph, the features are only needed for them and
+	// their neighbors. For the band they are computed in a crop padded by the support of the filters.
+	auto node_region = images.inputRegion;
+	if (band)
+	{
+		node_region = band->BoundingRegion();
+		node_region.SetIndex(images.inputRegion.GetIndex() + node_region.GetIndex());
+	}
+	auto crop_region = node_region;
+	crop_region.PadByRadius(1 + k_FeatureSupport);
+	crop_region.Crop(images.inputRegion);
+
 	//using IteratorType = itk::ShapedNeighborhoodIterator<InputImageType>;
 
 	// Traverses the image adding the following bidirectional edges:
@@ -164,8 +204,7 @@ void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::InitializeG
 	typename IteratorType::OffsetType frontright = {{nb.m_data[5][0], nb.m_data[5][1], nb.m_data[5][2]}};
 	neighbors.push_back(frontright);
 
-	IteratorType iterator(radius, images.input, images.input->GetLargestPossibleRegion());
-	IteratorType iterator2(radius, filtered, filtered->GetLargestPossibleRegion());
+	IteratorType iterator(radius, images.input, node_region);
 	iterator.ClearActiveList();
 	iterator.ActivateOffset(frontbottomrightr);
 	iterator.ActivateOffset(graph4r);
@@ -240,251 +279,235 @@ void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::InitializeG
 	//iterator.ActivateOffset(left);
 	//iterator.ActivateOffset(up);
 	//iterator.ActivateOffset(behind);
-	iterator2.ClearActiveList();
-	iterator2.ActivateOffset(center);
 
-	// BL TODO, not needed for all "modes"
-	size_t N = size[0] * size[1] * size[2];
-	std::vector<double> lambda1(N);
-	std::vector<double> lambda2(N);
-	std::vector<double> lambda3(N);
-	std::vector<double> S(N, 0.0);
-	std::vector<double> GradientMag(N, 0.0);
+	// features of the pixels in the crop
+	auto feature_index = [&crop_region](const itk::Index<3>& idx) {
+		auto const& start = crop_region.GetIndex();
+		auto const& size = crop_region.GetSize();
+		return (idx[0] - start[0]) + (idx[1] - start[1]) * size[0] + (idx[2] - start[2]) * size[0] * size[1];
+	};
+	size_t const N = crop_region.GetNumberOfPixels();
+	std::vector<double> S;
+	std::vector<double> GradientMag;
+
+	m_ImageTerminals.assign(images.inputRegion.GetNumberOfPixels(), kNoTerminal);
 
 	if (m_UseIntensity == false)
 	{
-		iterator2.GoToBegin();
-		for (iterator.GoToBegin(); !iterator.IsAtEnd(); ++iterator)
+		using CropFilterType = itk::RegionOfInterestImageFilter<InputImageType, InputImageType>;
+		auto crop_filter = CropFilterType::New();
+		crop_filter->SetInput(images.input);
+		crop_filter->SetRegionOfInterest(crop_region);
+		crop_filter->Update();
+		typename InputImageType::Pointer cropped = crop_filter->GetOutput();
+		cropped->DisconnectPipeline();
+
+		//Gaussian Filter for Edge enhancement, the crop is a copy so it is sharpened in place
+		using filterType = itk::DiscreteGaussianImageFilter<InputImageType, InputImageType>;
+		auto gaussianFilter = filterType::New();
+		gaussianFilter->SetInput(cropped);
+		gaussianFilter->SetVariance(1);
+		gaussianFilter->Update();
+		auto filtered = gaussianFilter->GetOutput();
 		{
-			bool pixelIsValid;
-			auto centerPixel = iterator.GetPixel(center, pixelIsValid);
-			if (!pixelIsValid)
+			itk::ImageRegionIterator<InputImageType> it(cropped, cropped->GetLargestPossibleRegion());
+			itk::ImageRegionConstIterator<InputImageType> it2(filtered, filtered->GetLargestPossibleRegion());
+			for (it.GoToBegin(), it2.GoToBegin(); !it.IsAtEnd(); ++it, ++it2)
 			{
-				continue;
+				it.Set(it.Get() + 10 * (it.Get() - it2.Get()));
 			}
-			auto centerPixelfilter = iterator2.GetPixel(center);
-			iterator.SetCenterPixel(centerPixel + 10 * (centerPixel - centerPixelfilter));
-			++iterator2;
 		}
+		gaussianFilter = nullptr;
 
 		std::cout << "gaussiancomplete";
 
-		//Compute the components of the Hessian Ixx,Iyy,Izz,Ixz,Iyz,Ixy+GM
-		double sigmas[3];
-		sigmas[0] = 1.0;
-		sigmas[1] = 0.75;
-		sigmas[2] = 1.25; // BL TODO?
-
-		for (int i = 0; i < 2; i++)
+		if (m_UseGradientMagnitude == true)
 		{
-			double sigma = sigmas[i];
-			using DuplicatorType = itk::ImageDuplicator<InputImageType>;
-			using FilterType = itk::RecursiveGaussianImageFilter<InputImageType>;
-
-			auto duplicator = DuplicatorType::New();
-			auto duplicator2 = DuplicatorType::New();
-			auto duplicator3 = DuplicatorType::New();
-			auto duplicator4 = DuplicatorType::New();
-			auto duplicator5 = DuplicatorType::New();
-			auto duplicator6 = DuplicatorType::New();
-
-			auto ga = FilterType::New();
-			auto gb = FilterType::New();
-			auto gc = FilterType::New();
-			ga->SetDirection(0);
-			gb->SetDirection(1);
-			gc->SetDirection(2);
-			ga->SetSigma(sigma);
-			gb->SetSigma(sigma);
-			gc->SetSigma(sigma);
-
-			ga->SetZeroOrder();
-			gb->SetZeroOrder();
-			gc->SetSecondOrder();
-			ga->SetInput(images.input);
-			gb->SetInput(ga->GetOutput());
-			gc->SetInput(gb->GetOutput());
-			duplicator->SetInputImage(gc->GetOutput());
-			gc->Update();
-			duplicator->Update();
-			auto Izz = duplicator->GetOutput();
-
-			gc->SetDirection(1);
-			gb->SetDirection(2);
-			gc->Update();
-			duplicator2->SetInputImage(gc->GetOutput());
-			duplicator2->Update();
-			auto Iyy = duplicator2->GetOutput();
-
-			gc->SetDirection(0);
-			ga->SetDirection(1);
-			gc->Update();
-			duplicator3->SetInputImage(gc->GetOutput());
-			duplicator3->Update();
-			auto Ixx = duplicator3->GetOutput();
-
-			ga->SetDirection(0);
-			gb->SetDirection(1);
-			gc->SetDirection(2);
-			ga->SetZeroOrder();
-			gb->SetFirstOrder();
-			gc->SetFirstOrder();
-			gc->Update();
-			duplicator4->SetInputImage(gc->GetOutput());
-			duplicator4->Update();
-			auto Iyz = duplicator4->GetOutput();
-
-			ga->SetDirection(1);
-			gb->SetDirection(0);
-			gc->SetDirection(2);
-			ga->SetZeroOrder();
-			gb->SetFirstOrder();
-			gc->SetFirstOrder();
-			gc->Update();
-			duplicator5->SetInputImage(gc->GetOutput());
-			duplicator5->Update();
-			auto Ixz = duplicator5->GetOutput();
-
-			ga->SetDirection(2);
-			gb->SetDirection(0);
-			gc->SetDirection(1);
-			ga->SetZeroOrder();
-			gb->SetFirstOrder();
-			gc->SetFirstOrder();
-			gc->Update();
-			duplicator6->SetInputImage(gc->GetOutput());
-			duplicator6->Update();
-			auto Ixy = duplicator6->GetOutput();
-
 			using GradFilterType = itk::GradientMagnitudeImageFilter<InputImageType, InputImageType>;
 			auto gradfilter = GradFilterType::New();
-			gradfilter->SetInput(images.input);
-			auto Igrad = gradfilter->GetOutput();
+			gradfilter->SetInput(cropped);
+			gradfilter->Update();
 
-			std::cout << "Hessiancomplete";
-			//Now we have all the components and need to compute the eigenvalues somehow. Store them in lambda1-3. Also compute GM-Vector
+			GradientMag.assign(N, 0.0);
+			itk::ImageRegionConstIterator<InputImageType> it(gradfilter->GetOutput(), gradfilter->GetOutput()->GetLargestPossibleRegion());
+			auto gm = GradientMag.begin();
+			for (it.GoToBegin(); !it.IsAtEnd(); ++it, ++gm)
 			{
-				using MatrixType = itk::Matrix<double, 3, 3>;
-				using VectorType = itk::Vector<double, 3>;
-				using Eigenanalyse = itk::SymmetricEigenAnalysis<MatrixType, VectorType>;
-
-				IteratorType iterator3(radius, Ixx, Ixx->GetLargestPossibleRegion());
-				IteratorType iterator4(radius, Iyy, Iyy->GetLargestPossibleRegion());
-				IteratorType iterator5(radius, Izz, Izz->GetLargestPossibleRegion());
-				IteratorType iterator6(radius, Ixy, Ixy->GetLargestPossibleRegion());
-				IteratorType iterator7(radius, Ixz, Ixz->GetLargestPossibleRegion());
-				IteratorType iterator8(radius, Iyz, Iyz->GetLargestPossibleRegion());
-				IteratorType iterator9(radius, Igrad, Igrad->GetLargestPossibleRegion());
-				iterator3.ClearActiveList();
-				iterator3.ActivateOffset(center);
-				iterator4.ClearActiveList();
-				iterator4.ActivateOffset(center);
-				iterator5.ClearActiveList();
-				iterator5.ActivateOffset(center);
-				iterator6.ClearActiveList();
-				iterator6.ActivateOffset(center);
-				iterator7.ClearActiveList();
-				iterator7.ActivateOffset(center);
-				iterator8.ClearActiveList();
-				iterator8.ActivateOffset(center);
-				iterator9.ClearActiveList();
-				iterator9.ActivateOffset(center);
-
-				iterator4.GoToBegin();
-				iterator5.GoToBegin();
-				iterator6.GoToBegin();
-				iterator7.GoToBegin();
-				iterator8.GoToBegin();
-				iterator9.GoToBegin();
-				for (iterator3.GoToBegin(); !iterator3.IsAtEnd(); ++iterator3)
+				*gm = static_cast<double>(it.Get());
+			}
+		}
+		else
+		{
+			//Compute the components of the Hessian Ixx,Iyy,Izz,Ixz,Iyz,Ixy
+			double sigmas[3];
+			sigmas[0] = 1.0;
+			sigmas[1] = 0.75;
+			sigmas[2] = 1.25; // BL TODO?
+
+			S.assign(N, 0.0);
+			std::vector<double> lambda1(N);
+			std::vector<double> lambda2(N);
+			std::vector<double> lambda3(N);
+
+			for (int i = 0; i < 2; i++)
+			{
+				double sigma = sigmas[i];
+				using DuplicatorType = itk::ImageDuplicator<InputImageType>;
+				using FilterType = itk::RecursiveGaussianImageFilter<InputImageType>;
+
+				auto duplicator = DuplicatorType::New();
+				auto duplicator2 = DuplicatorType::New();
+				auto duplicator3 = DuplicatorType::New();
+				auto duplicator4 = DuplicatorType::New();
+				auto duplicator5 = DuplicatorType::New();
+				auto duplicator6 = DuplicatorType::New();
+
+				auto ga = FilterType::New();
+				auto gb = FilterType::New();
+				auto gc = FilterType::New();
+				ga->SetDirection(0);
+				gb->SetDirection(1);
+				gc->SetDirection(2);
+				ga->SetSigma(sigma);
+				gb->SetSigma(sigma);
+				gc->SetSigma(sigma);
+
+				ga->SetZeroOrder();
+				gb->SetZeroOrder();
+				gc->SetSecondOrder();
+				ga->SetInput(cropped);
+				gb->SetInput(ga->GetOutput());
+				gc->SetInput(gb->GetOutput());
+				duplicator->SetInputImage(gc->GetOutput());
+				gc->Update();
+				duplicator->Update();
+				auto Izz = duplicator->GetOutput();
+
+				gc->SetDirection(1);
+				gb->SetDirection(2);
+				gc->Update();
+				duplicator2->SetInputImage(gc->GetOutput());
+				duplicator2->Update();
+				auto Iyy = duplicator2->GetOutput();
+
+				gc->SetDirection(0);
+				ga->SetDirection(1);
+				gc->Update();
+				duplicator3->SetInputImage(gc->GetOutput());
+				duplicator3->Update();
+				auto Ixx = duplicator3->GetOutput();
+
+				ga->SetDirection(0);
+				gb->SetDirection(1);
+				gc->SetDirection(2);
+				ga->SetZeroOrder();
+				gb->SetFirstOrder();
+				gc->SetFirstOrder();
+				gc->Update();
+				duplicator4->SetInputImage(gc->GetOutput());
+				duplicator4->Update();
+				auto Iyz = duplicator4->GetOutput();
+
+				ga->SetDirection(1);
+				gb->SetDirection(0);
+				gc->SetDirection(2);
+				ga->SetZeroOrder();
+				gb->SetFirstOrder();
+				gc->SetFirstOrder();
+				gc->Update();
+				duplicator5->SetInputImage(gc->GetOutput());
+				duplicator5->Update();
+				auto Ixz = duplicator5->GetOutput();
+
+				ga->SetDirection(2);
+				gb->SetDirection(0);
+				gc->SetDirection(1);
+				ga->SetZeroOrder();
+				gb->SetFirstOrder();
+				gc->SetFirstOrder();
+				gc->Update();
+				duplicator6->SetInputImage(gc->GetOutput());
+				duplicator6->Update();
+				auto Ixy = duplicator6->GetOutput();
+
+				std::cout << "Hessiancomplete";
+				//Now we have all the components and need to compute the eigenvalues somehow. Store them in lambda1-3.
 				{
-					bool pixelIsValid;
-					auto Ixx_value = iterator3.GetPixel(center, pixelIsValid);
-					if (!pixelIsValid)
+					using MatrixType = itk::Matrix<double, 3, 3>;
+					using VectorType = itk::Vector<double, 3>;
+					using Eigenanalyse = itk::SymmetricEigenAnalysis<MatrixType, VectorType>;
+					using ConstIteratorType = itk::ImageRegionConstIterator<InputImageType>;
+
+					ConstIteratorType iterator3(Ixx, Ixx->GetLargestPossibleRegion());
+					ConstIteratorType iterator4(Iyy, Iyy->GetLargestPossibleRegion());
+					ConstIteratorType iterator5(Izz, Izz->GetLargestPossibleRegion());
+					ConstIteratorType iterator6(Ixy, Ixy->GetLargestPossibleRegion());
+					ConstIteratorType iterator7(Ixz, Ixz->GetLargestPossibleRegion());
+					ConstIteratorType iterator8(Iyz, Iyz->GetLargestPossibleRegion());
+
+					iterator4.GoToBegin();
+					iterator5.GoToBegin();
+					iterator6.GoToBegin();
+					iterator7.GoToBegin();
+					iterator8.GoToBegin();
+					size_t nodeIndex = 0;
+					for (iterator3.GoToBegin(); !iterator3.IsAtEnd(); ++iterator3, ++nodeIndex)
 					{
-						continue;
+						MatrixType Hessian;
+						Hessian(0, 0) = iterator3.Get();
+						Hessian(1, 1) = iterator4.Get();
+						Hessian(2, 2) = iterator5.Get();
+						Hessian(0, 1) = iterator6.Get();
+						Hessian(1, 0) = iterator6.Get();
+						Hessian(2, 0) = iterator7.Get();
+						Hessian(0, 2) = iterator7.Get();
+						Hessian(2, 1) = iterator8.Get();
+						Hessian(1, 2) = iterator8.Get();
+
+						VectorType eigenvalues;
+
+						Eigenanalyse eig;
+						eig.SetDimension(3);
+						eig.SetOrderEigenMagnitudes(true);
+						eig.ComputeEigenValues(Hessian, eigenvalues);
+
+						lambda1[nodeIndex] = eigenvalues[0];
+						lambda2[nodeIndex] = eigenvalues[1];
+						lambda3[nodeIndex] = eigenvalues[2];
+						++iterator4;
+						++iterator5;
+						++iterator6;
+						++iterator7;
+						++iterator8;
 					}
-					auto Iyy_value = iterator4.GetPixel(center);
-					auto Izz_value = iterator5.GetPixel(center);
-					auto Ixy_value = iterator6.GetPixel(center);
-					auto Ixz_value = iterator7.GetPixel(center);
-					auto Iyz_value = iterator8.GetPixel(center);
-
-					MatrixType Hessian;
-					Hessian(0, 0) = Ixx_value;
-					Hessian(1, 1) = Iyy_value;
-					Hessian(2, 2) = Izz_value;
-					Hessian(0, 1) = Ixy_value;
-					Hessian(1, 0) = Ixy_value;
-					Hessian(2, 0) = Ixz_value;
-					Hessian(0, 2) = Ixz_value;
-					Hessian(2, 1) = Iyz_value;
-					Hessian(1, 2) = Iyz_value;
-
-					VectorType eigenvalues;
-
-					Eigenanalyse eig;
-					eig.SetDimension(3);
-					eig.SetOrderEigenMagnitudes(true);
-					eig.ComputeEigenValues(Hessian, eigenvalues);
-
-					auto nodeIndex = ConvertIndexToVertexDescriptor(iterator3.GetIndex(center), Ixx->GetLargestPossibleRegion());
-					lambda1[nodeIndex] = eigenvalues[0];
-					lambda2[nodeIndex] = eigenvalues[1];
-					lambda3[nodeIndex] = eigenvalues[2];
-					++iterator4;
-					++iterator5;
-					++iterator6;
-					++iterator7;
-					++iterator8;
-					auto Igrad_value = static_cast<double>(iterator9.GetPixel(center));
-					if (abs(Igrad_value) > abs((double)GradientMag[nodeIndex]))
-					{
-						GradientMag[nodeIndex] = Igrad_value;
-					}
-					++iterator9;
 				}
-			}
-
-			std::cout << "eigenvaluecomplete";
 
-			double T = 0;
-			for (unsigned int i = 0; i < lambda1.size(); i++)
-			{
-				T += (lambda1[i] + lambda2[i] + lambda3[i]) / lambda1.size();
-			}
+				std::cout << "eigenvaluecomplete";
 
-			for (unsigned int i = 0; i < lambda1.size(); i++)
-			{
-				double Rtube = 0.0;
-				double Rsheet = 0.0;
-				double Rnoise = 0.0;
-				double sign = 0.0;
-				Rsheet = abs(lambda2[i]) / abs(lambda3[i]);
-				Rtube = abs(lambda1[i]) / (abs(lambda3[i]) * abs(lambda2[i]));
-				Rnoise = (abs(lambda1[i]) + abs(lambda2[i]) + abs(lambda3[i])) / T;
-				sign = (lambda3[i]) / (abs(lambda3[i]));
-				double tmp = -sign * exp(-(Rsheet * Rsheet) / 0.25) * exp(-(Rtube * Rtube) / 0.25) * (1 - exp(-(Rnoise * Rnoise) / 0.0625));
-				if (abs(tmp) > S[i])
+				// for the band the mean is taken over the crop instead of the whole image
+				double T = 0;
+				for (unsigned int i = 0; i < lambda1.size(); i++)
 				{
-					S[i] = tmp;
+					T += (lambda1[i] + lambda2[i] + lambda3[i]) / lambda1.size();
 				}
-			}
-		}
 
-		//Set input back to initial state:
-		iterator2.GoToBegin();
-		for (iterator.GoToBegin(); !iterator.IsAtEnd(); ++iterator)
-		{
-			bool pixelIsValid;
-			typename InputImageType::PixelType centerPixel = iterator.GetPixel(center, pixelIsValid);
-			if (!pixelIsValid)
-			{
-				continue;
+				for (unsigned int i = 0; i < lambda1.size(); i++)
+				{
+					double Rtube = 0.0;
+					double Rsheet = 0.0;
+					double Rnoise = 0.0;
+					double sign = 0.0;
+					Rsheet = abs(lambda2[i]) / abs(lambda3[i]);
+					Rtube = abs(lambda1[i]) / (abs(lambda3[i]) * abs(lambda2[i]));
+					Rnoise = (abs(lambda1[i]) + abs(lambda2[i]) + abs(lambda3[i])) / T;
+					sign = (lambda3[i]) / (abs(lambda3[i]));
+					double tmp = -sign * exp(-(Rsheet * Rsheet) / 0.25) * exp(-(Rtube * Rtube) / 0.25) * (1 - exp(-(Rnoise * Rnoise) / 0.0625));
+					if (abs(tmp) > S[i])
+					{
+						S[i] = tmp;
+					}
+				}
 			}
-			typename InputImageType::PixelType centerPixelfilter = iterator2.GetPixel(center);
-			iterator.SetCenterPixel((centerPixel + 10 * centerPixelfilter) / 11);
-			++iterator2;
 		}
 	}
 	std::cout << "readyforboundary";
@@ -504,7 +527,14 @@ void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::InitializeG
 		{
 			continue;
 		}
-		unsigned int nodeIndex1 = ConvertIndexToVertexDescriptor(iterator.GetIndex(center), images.inputRegion);
+		auto const centerIndex = iterator.GetIndex(center);
+		unsigned int nodeIndex1 = ConvertIndexToVertexDescriptor(centerIndex, images.inputRegion);
+		if (band && !band->InBand(nodeIndex1))
+		{
+			continue;
+		}
+		Gc::Size const node = band ? band->Node(nodeIndex1) : nodeIndex1;
+		size_t const featureIndex1 = (m_UseIntensity == false) ? feature_index(centerIndex) : 0;
 
 		for (unsigned int i = 0; i < con; i++)
 		{
@@ -519,7 +549,7 @@ void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::InitializeG
 			}
 
 			// BL TODO
-			unsigned int nodeIndex2 = ConvertIndexToVertexDescriptor(iterator.GetIndex(neighbors[i]), images.inputRegion);
+			size_t const featureIndex2 = (m_UseIntensity == false) ? feature_index(iterator.GetIndex(neighbors[i])) : 0;
 
 			// Compute the edge weight GradientMag-Vector also available
 			double weight = 0;
@@ -528,8 +558,8 @@ void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::InitializeG
 				// BL assumes background is ZERO
 				if (centerPixel != 0 && neighborPixel != 0)
 				{
-					double invgm = 1.0 / (abs(GradientMag[nodeIndex1]) + abs(GradientMag[nodeIndex2]));
-					graph->SetArcCap(nodeIndex1, i, 1 + 25 * invgm); //invgm,invgm
+					double invgm = 1.0 / (abs(GradientMag[featureIndex1]) + abs(GradientMag[featureIndex2]));
+					graph->SetArcCap(node, i, 1 + 25 * invgm); //invgm,invgm
 				}
 			}
 			else // gm == false
@@ -541,20 +571,20 @@ void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::InitializeG
 					d = offset[0] * offset[0] * space[0] + offset[1] * offset[1] * space[1] + offset[2] * offset[2] * space[2];
 					weight = (1 / (std::sqrt(d))) * exp(-pow(centerPixel - neighborPixel, 2) / (2.0 * 50.0 * 50.0)); //50 =variance from paper
 					if (centerPixel < neighborPixel)
-						graph->SetArcCap(nodeIndex1, i, 1.0);
+						graph->SetArcCap(node, i, 1.0);
 					else
-						graph->SetArcCap(nodeIndex1, i, weight);
+						graph->SetArcCap(node, i, weight);
 				}
 				else //Sheetness
 				{
-					weight = exp(-abs(S[nodeIndex1] - S[nodeIndex2]) / (m_Sigma));
-					if (S[nodeIndex1] >= S[nodeIndex2]) //>!!
+					weight = exp(-abs(S[featureIndex1] - S[featureIndex2]) / (m_Sigma));
+					if (S[featureIndex1] >= S[featureIndex2]) //>!!
 					{
-						graph->SetArcCap(nodeIndex1, i, 5 * weight); //
+						graph->SetArcCap(node, i, 5 * weight); //
 					}
 					else
 					{
-						graph->SetArcCap(nodeIndex1, i, 5 * 1.0);
+						graph->SetArcCap(node, i, 5 * 1.0);
 					}
 				}
 			}
@@ -562,94 +592,128 @@ void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::InitializeG
 
 		if (m_UseIntensity == false && m_UseGradientMagnitude == false) //Terminal Edges for sheetness
 		{
-			if (S[nodeIndex1] > 0.0 && centerPixel > m_ForegroundValue)
-				graph->SetTerminalArcCap(nodeIndex1, 1.0, 0);
+			if (S[featureIndex1] > 0.0 && centerPixel > m_ForegroundValue)
+				m_ImageTerminals[nodeIndex1] = kSourceTerminal;
 			if (centerPixel < m_BackgroundValue)
-				graph->SetTerminalArcCap(nodeIndex1, 0, 1.0);
+				m_ImageTerminals[nodeIndex1] = kSinkTerminal;
 		}
 		else if (m_UseIntensity == true && m_UseGradientMagnitude == false) //Terminal Edges for intensity
 		{
 			if (centerPixel > m_ForegroundValue)
-				graph->SetTerminalArcCap(nodeIndex1, 1000, 0);
+				m_ImageTerminals[nodeIndex1] = kSourceTerminal;
 			if (centerPixel < m_BackgroundValue)
-				graph->SetTerminalArcCap(nodeIndex1, 0, 1000);
+				m_ImageTerminals[nodeIndex1] = kSinkTerminal;
 		}
 	}
+}
 
-	if (abort)
+template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::ComputeSeeds(ImageContainer images, std::vector<unsigned char>& seeds)
+{
+	seeds.assign(images.inputRegion.GetNumberOfPixels(), kNoTerminal);
+	if (m_UseForegroundBackground == false && m_UseGradientMagnitude == false)
 	{
 		return;
 	}
 
-	if (m_UseForegroundBackground == true) //Foreground&Background_used
+	itk::ImageRegionConstIteratorWithIndex<ForegroundImageType> iteratorfb(images.foreground, images.foreground->GetLargestPossibleRegion());
+	itk::ImageRegionConstIterator<BackgroundImageType> iteratorbg(images.background, images.background->GetLargestPossibleRegion());
+	for (iteratorfb.GoToBegin(), iteratorbg.GoToBegin(); !iteratorfb.IsAtEnd(); ++iteratorfb, ++iteratorbg)
 	{
-		itk::Size<3> rad;
-		rad.Fill(1);
-		using IteratorTypefb = itk::ShapedNeighborhoodIterator<ForegroundImageType>;
-		typename IteratorTypefb::OffsetType centerfb = {{0, 0, 0}};
-
-		IteratorTypefb iteratorfb(rad, images.foreground, images.foreground->GetLargestPossibleRegion());
-		IteratorTypefb iteratorbg(rad, images.background, images.background->GetLargestPossibleRegion());
-		iteratorfb.ClearActiveList();
-		iteratorfb.ActivateOffset(centerfb);
-		iteratorbg.ClearActiveList();
-		iteratorbg.ActivateOffset(centerfb);
-
-		iteratorbg.GoToBegin();
-		for (iteratorfb.GoToBegin(); !iteratorfb.IsAtEnd(); ++iteratorfb)
+		unsigned int nodeIndex = ConvertIndexToVertexDescriptor(iteratorfb.GetIndex(), images.inputRegion);
+		if ((int)iteratorfb.Get() > 4000)
 		{
-			typename ForegroundImageType::PixelType centerPixel = iteratorfb.GetPixel(centerfb);
-			typename ForegroundImageType::PixelType centerPixelbg = iteratorbg.GetPixel(centerfb);
-			if ((int)centerPixelbg < -4000)
-			{
-				unsigned int sinkIndex = ConvertIndexToVertexDescriptor(iteratorbg.GetIndex(center), images.inputRegion);
-				graph->SetTerminalArcCap(sinkIndex, 0, 100000);
-			}
-			if ((int)centerPixel > 4000)
-			{
-				unsigned int sourceIndex = ConvertIndexToVertexDescriptor(iteratorbg.GetIndex(center), images.inputRegion);
-				graph->SetTerminalArcCap(sourceIndex, 100000, 0);
-			}
-			++iteratorbg;
+			seeds[nodeIndex] = kSourceTerminal;
+		}
+		else if ((int)iteratorbg.Get() < -4000)
+		{
+			seeds[nodeIndex] = kSinkTerminal;
+		}
+	}
+}
+
+template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+std::unique_ptr<typename ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::BandType>
+		ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::ComputeCoarseCut(ImageContainer images, const std::vector<unsigned char>& seeds)
+{
+	using ForegroundPixelType = typename ForegroundImageType::PixelType;
+	using BackgroundPixelType = typename BackgroundImageType::PixelType;
+	unsigned int const factor = 2;
+
+	auto coarse = Self::New();
+	coarse->SetSigma(m_Sigma);
+	coarse->SetFB(m_UseForegroundBackground);
+	coarse->SetGM(m_UseGradientMagnitude);
+	coarse->SetIntensity(m_UseIntensity);
+	coarse->SetConnectivity(m_6Connected);
+	coarse->SetForeground(m_ForegroundValue);
+	coarse->SetBackground(m_BackgroundValue);
+	coarse->SetMaxFlowAlgorithm(m_MaxFlowAlgorithm);
+	coarse->SetForegroundPixelValue(m_ForegroundPixelValue);
+	coarse->SetBackgroundPixelValue(m_BackgroundPixelValue);
+	coarse->SetVerboseOutput(false);
+	coarse->SetMultiResolution(m_MultiResolution);
+	coarse->SetBandRadius(m_BandRadius);
+	coarse->SetInputImage(MeanShrinkImage<InputImageType>(images.input.GetPointer(), images.inputRegion, factor));
+	if (m_UseForegroundBackground || m_UseGradientMagnitude)
+	{
+		// a coarse pixel is a seed if its block contains a seed
+		coarse->SetForegroundImage(ShrinkImage<ForegroundImageType>(images.foreground.GetPointer(), images.inputRegion, factor, std::numeric_limits<ForegroundPixelType>::lowest(), [](ForegroundPixelType a, ForegroundPixelType b) { return std::max(a, b); }));
+		coarse->SetBackgroundImage(ShrinkImage<BackgroundImageType>(images.background.GetPointer(), images.inputRegion, factor, std::numeric_limits<BackgroundPixelType>::max(), [](BackgroundPixelType a, BackgroundPixelType b) { return std::min(a, b); }));
+	}
+	else
+	{
+		coarse->SetNumberOfRequiredInputs(1);
+	}
+	coarse->Update();
+
+	std::vector<unsigned char> labels;
+	labels.reserve(coarse->GetOutput()->GetLargestPossibleRegion().GetNumberOfPixels());
+	itk::ImageRegionConstIterator<OutputImageType> it(coarse->GetOutput(), coarse->GetOutput()->GetLargestPossibleRegion());
+	for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+	{
+		labels.push_back((it.Get() == m_ForegroundPixelValue) ? BandType::kSource : BandType::kSink);
+	}
+
+	std::unique_ptr<BandType> band(new BandType(images.inputRegion.GetSize(), factor, labels));
+
+	// seeds which disagree with the coarse cut are resolved at full resolution
+	for (size_t node = 0; node < seeds.size(); ++node)
+	{
+		if ((seeds[node] == kSourceTerminal && band->CoarseLabel(node) != BandType::kSource) ||
+				(seeds[node] == kSinkTerminal && band->CoarseLabel(node) != BandType::kSink))
+		{
+			band->AddToBand(node);
 		}
 	}
+	band->Build(m_BandRadius);
+	return band;
+}
+
+template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::SetTerminalArcs(GraphType* graph, const std::vector<unsigned char>& seeds, const BandType* band)
+{
+	Gc::Float32 const image_cap = m_UseIntensity ? 1000 : 1.0;
+	Gc::Float32 const seed_cap = m_UseGradientMagnitude ? 20.0 : 100000;
 
-	if (m_UseGradientMagnitude == true) //Divide
+	for (size_t node = 0; node < seeds.size(); ++node)
 	{
-		itk::Size<3> rad;
-		rad.Fill(1);
-		using IteratorTypefb = itk::ShapedNeighborhoodIterator<ForegroundImageType>;
-		typename IteratorTypefb::OffsetType centerfb = {{0, 0, 0}};
-
-		IteratorTypefb iteratorfb(rad, images.foreground, images.foreground->GetLargestPossibleRegion());
-		IteratorTypefb iteratorbg(rad, images.background, images.background->GetLargestPossibleRegion());
-		iteratorfb.ClearActiveList();
-		iteratorfb.ActivateOffset(centerfb);
-		iteratorbg.ClearActiveList();
-		iteratorbg.ActivateOffset(centerfb);
-
-		iteratorbg.GoToBegin();
-		for (iteratorfb.GoToBegin(); !iteratorfb.IsAtEnd(); ++iteratorfb)
+		if (band && !band->InBand(node))
 		{
-			auto centerPixel = iteratorfb.GetPixel(centerfb);
-			auto centerPixelbg = iteratorbg.GetPixel(centerfb);
-			if ((int)centerPixelbg < -4000)
-			{
-				unsigned int sinkIndex = ConvertIndexToVertexDescriptor(iteratorbg.GetIndex(center), images.inputRegion);
-				graph->SetTerminalArcCap(sinkIndex, 0, 20.0);
-			}
-			if ((int)centerPixel > 4000)
-			{
-				unsigned int sourceIndex = ConvertIndexToVertexDescriptor(iteratorbg.GetIndex(center), images.inputRegion);
-				graph->SetTerminalArcCap(sourceIndex, 20.0, 0);
-			}
-			++iteratorbg;
+			continue;
+		}
+		// seeds override the terminal arcs from the image
+		auto const terminal = (seeds[node] != kNoTerminal) ? seeds[node] : m_ImageTerminals[node];
+		auto const cap = (seeds[node] != kNoTerminal) ? seed_cap : image_cap;
+		if (terminal != kNoTerminal)
+		{
+			graph->SetTerminalArcCap(band ? band->Node(node) : node, terminal == kSourceTerminal ? cap : 0, terminal == kSinkTerminal ? cap : 0);
 		}
 	}
 }
 
 template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
-void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::CutGraph(GraphType* graph, ImageContainer images, ProgressReporter& progress)
+void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::CutGraph(GraphType* graph, ImageContainer images, const BandType* band, ProgressReporter& progress)
 {
 	// Iterate over the output image, querying the graph for the association of each pixel
 	itk::ImageRegionIterator<OutputImageType> outputImageIterator(images.output, images.outputRegion);
@@ -660,7 +724,8 @@ void ImageGraphCutFilter<TImage, TForeground, TBackground, TOutput>::CutGraph(Gr
 	while (!outputImageIterator.IsAtEnd() && !abort)
 	{
 		unsigned int voxelIndex = ConvertIndexToVertexDescriptor(outputImageIterator.GetIndex(), images.outputRegion);
-		if (graph->NodeOrigin(voxelIndex) == Gc::Flow::Source)
+		bool const is_source = band ? (band->Label(graph, voxelIndex) == BandType::kSource) : (graph->NodeOrigin(voxelIndex) == Gc::Flow::Source);
+		if (is_source)
 		{
 			outputImageIterator.Set(m_ForegroundPixelValue);
 		}
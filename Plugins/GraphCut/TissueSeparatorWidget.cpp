@@ -11,17 +11,17 @@
 
 #include "GraphCutAlgorithms.h"
 
+#include "Data/ItkProgressObserver.h"
 #include "Data/ItkUtils.h"
 #include "Data/LogApi.h"
 #include "Data/SlicesHandlerITKInterface.h"
 #include "Data/addLine.h"
 
+#include "Interface/JobScheduler.h"
+
 #include <itkBinaryThresholdImageFilter.h>
 
-#include <QApplication>
 #include <QFormLayout>
-#include <QProgressDialog>
-#include <QStyleFactory>
 
 #include <algorithm>
 #include <sstream>
@@ -38,6 +38,8 @@ TissueSeparatorWidget::TissueSeparatorWidget(SlicesHandlerInterface* hand3D, QWi
 	m_UseSource = new QCheckBox;
 	m_UseSource->setToolTip(QString("Use information from Source image, or split purely based on minimum cut through segmentation."));
 	m_SigmaEdit = new QLineEdit(QString::number(1.0));
+	m_MultiResolution = new QCheckBox;
+	m_MultiResolution->setToolTip(QString("Compute the cut on a coarser grid first and refine it only near the coarse cut. Uses less memory for large 3D volumes."));
 	m_ClearLines = new QPushButton("Clear lines");
 	m_ExecuteButton = new QPushButton("Execute");
 
@@ -47,6 +49,7 @@ TissueSeparatorWidget::TissueSeparatorWidget(SlicesHandlerInterface* hand3D, QWi
 	top_layout->addRow(QString("Apply to all slices"), m_AllSlices);
 	top_layout->addRow(QString("Use source"), m_UseSource);
 	top_layout->addRow(QString("Sigma"), m_SigmaEdit);
+	top_layout->addRow(QString("Multi-resolution"), m_MultiResolution);
 	top_layout->addRow(m_ClearLines);
 	top_layout->addRow(m_ExecuteButton);
 
@@ -55,6 +58,7 @@ TissueSeparatorWidget::TissueSeparatorWidget(SlicesHandlerInterface* hand3D, QWi
 	// connect signals
 	QObject_connect(m_ClearLines, SIGNAL(clicked()), this, SLOT(Clearmarks()));
 	QObject_connect(m_ExecuteButton, SIGNAL(clicked()), this, SLOT(Execute()));
+	QObject_connect(JobScheduler::Instance(), SIGNAL(JobFinished(int,bool)), this, SLOT(JobFinished(int,bool)));
 }
 
 void TissueSeparatorWidget::Init()
@@ -66,10 +70,16 @@ void TissueSeparatorWidget::Init()
 void TissueSeparatorWidget::NewLoaded()
 {
 	m_CurrentSlice = m_SliceHandler->ActiveSlice();
+	m_Cutter2D = nullptr;
+	m_Cutter3D = nullptr;
 }
 
 void TissueSeparatorWidget::Cleanup()
 {
+	// release the graphs
+	m_Cutter2D = nullptr;
+	m_Cutter3D = nullptr;
+
 	m_Vpdyn.clear();
 	emit VpdynChanged(&m_Vpdyn);
 
@@ -155,6 +165,13 @@ void TissueSeparatorWidget::OnMouseReleased(Point p)
 
 void TissueSeparatorWidget::Execute()
 {
+	auto scheduler = JobScheduler::Instance();
+	if (scheduler->IsActive(m_JobId))
+	{
+		scheduler->Cancel(m_JobId);
+		return;
+	}
+
 	if (m_AllSlices->isChecked())
 	{
 		DoWorkAllSlices();
@@ -165,50 +182,82 @@ void TissueSeparatorWidget::Execute()
 	}
 }
 
-void TissueSeparatorWidget::DoWorkAllSlices()
+void TissueSeparatorWidget::JobFinished(int id, bool committed)
 {
-	QProgressDialog progress("Running Graph Cut...", "Abort", 0, 0, this);
-	progress.setCancelButton(nullptr);
-	progress.setMinimum(0);
-	progress.setMaximum(0);
-	progress.setWindowModality(Qt::WindowModal);
-	//progress.setStyle(QStyleFactory::create("Fusion"));
-	progress.show();
+	if (id == m_JobId)
+	{
+		m_ExecuteButton->setText("Execute");
+	}
+}
 
-	QApplication::processEvents();
+TissueSeparatorWidget::Parameters TissueSeparatorWidget::GetParameters() const
+{
+	Parameters params;
+	params.m_Sigma = m_SigmaEdit->text().toDouble(&params.m_HasSigma);
+	params.m_UseSource = m_UseSource->isChecked();
+	params.m_MultiResolution = m_MultiResolution->isChecked();
+	params.m_CurrentSlice = m_CurrentSlice;
+	params.m_Width = m_SliceHandler->Width();
+	params.m_Height = m_SliceHandler->Height();
+	return params;
+}
 
-	using source_type = itk::SliceContiguousImage<float>;
+void TissueSeparatorWidget::DoWorkAllSlices()
+{
+	using source_type = itk::Image<float, 3>;
 	using mask_type = itk::Image<unsigned char, 3>;
 
+	// the job works on copies and pastes the result when it is committed
 	SlicesHandlerITKInterface wrapper(m_SliceHandler);
-	auto source = wrapper.GetSource(false);
-	auto target = wrapper.GetTarget(false);
+	source_type::Pointer source = wrapper.GetImageDeprecated(SlicesHandlerITKInterface::kSource, false);
+	source_type::Pointer target = wrapper.GetImageDeprecated(SlicesHandlerITKInterface::kTarget, false);
+
+	unsigned const start_slice = m_SliceHandler->StartSlice();
+	unsigned const end_slice = m_SliceHandler->EndSlice();
 
 	auto start = target->GetLargestPossibleRegion().GetIndex();
-	start[2] = m_SliceHandler->StartSlice();
+	start[2] = start_slice;
 
 	auto size = target->GetLargestPossibleRegion().GetSize();
-	size[2] = m_SliceHandler->EndSlice() - start[2];
-
-	auto output = DoWork<3, source_type>(source, target, mask_type::RegionType(start, size));
-	if (output)
-	{
-		iseg::DataSelection data_selection;
-		data_selection.allSlices = true;
-		data_selection.work = true;
-		emit BeginDatachange(data_selection, this);
-
-		iseg::Paste<unsigned char, float>(output, target, m_SliceHandler->StartSlice(), m_SliceHandler->EndSlice());
-
-		emit EndDatachange(this);
-	}
-	else
-	{
-		std::cerr << "No result. GC failed.\n";
-	}
-
-	progress.setMaximum(1);
-	progress.setValue(1);
+	size[2] = end_slice - start[2];
+
+	mask_type::RegionType const region(start, size);
+	auto params = GetParameters();
+	auto marks = m_Vm;
+
+	// the graph is reused by the next run, unless this one fails
+	auto cutter = std::make_shared<itk::ProcessObject::Pointer>(m_Cutter3D);
+	auto output = std::make_shared<mask_type::Pointer>();
+	auto job = std::make_shared<FunctionJob>(
+			"Graph cut",
+			[source, target, region, params, marks, cutter, output](ProgressInfo* progress) {
+				*output = DoWork<3, source_type>(source, target, region, params, marks, *cutter, progress);
+				return output->IsNotNull();
+			},
+			[this, cutter, output, start_slice, end_slice]() {
+				m_Cutter3D = *cutter;
+
+				SlicesHandlerITKInterface wrapper(m_SliceHandler);
+				auto target = wrapper.GetTarget(false);
+
+				iseg::DataSelection data_selection;
+				data_selection.allSlices = true;
+				data_selection.work = true;
+				emit BeginDatachange(data_selection, this);
+
+				iseg::Paste<unsigned char, float>(*output, target, start_slice, end_slice);
+
+				emit EndDatachange(this);
+			},
+			[this]() {
+				std::cerr << "No result. GC failed.\n";
+				m_Cutter3D = nullptr;
+			});
+	job->AddLease(SliceLease(SliceLease::kSource | SliceLease::kTarget, SliceLease::kRead, 0, m_SliceHandler->NumSlices()));
+	job->AddLease(SliceLease(SliceLease::kTarget, SliceLease::kWrite, start_slice, end_slice));
+
+	m_JobId = JobScheduler::Instance()->Submit(job);
+	m_ExecuteButton->setText("Cancel");
 }
 
 void TissueSeparatorWidget::DoWorkCurrentSlice()
@@ -219,7 +268,7 @@ void TissueSeparatorWidget::DoWorkCurrentSlice()
 	auto source = wrapper.GetSourceSlice();
 	auto target = wrapper.GetTargetSlice();
 
-	auto output = DoWork<2, source_type>(source, target, target->GetLargestPossibleRegion());
+	auto output = DoWork<2, source_type>(source, target, target->GetLargestPossibleRegion(), GetParameters(), m_Vm, m_Cutter2D, nullptr);
 	if (output)
 	{
 		auto buffer_size = target->GetPixelContainer()->Size();
@@ -233,14 +282,12 @@ void TissueSeparatorWidget::DoWorkCurrentSlice()
 
 template<unsigned int Dim, typename TInput>
 typename itk::Image<unsigned char, Dim>::Pointer
-		TissueSeparatorWidget::DoWork(TInput* source, TInput* target, const typename itk::Image<unsigned char, Dim>::RegionType& requested_region)
+		TissueSeparatorWidget::DoWork(TInput* source, TInput* target, const typename itk::Image<unsigned char, Dim>::RegionType& requested_region, const Parameters& params, const std::map<unsigned, std::vector<iseg::Mark>>& marks, itk::ProcessObject::Pointer& cached_cutter, ProgressInfo* progress)
 {
 	using tissue_value_type = SlicesHandlerInterface::tissue_type;
 	tissue_value_type const object_1 = 127;
 	tissue_value_type const object_2 = 255;
-	bool has_sigma;
-	auto sigma = m_SigmaEdit->text().toDouble(&has_sigma);
-	bool use_gradient_magnitude = m_UseSource->isChecked();
+	bool use_gradient_magnitude = params.m_UseSource;
 	bool use_full_neighborhood = true;
 
 	using source_type = TInput;
@@ -257,15 +304,15 @@ typename itk::Image<unsigned char, Dim>::Pointer
 
 	auto mask = threshold->GetOutput();
 	auto mask_buffer = mask->GetPixelContainer()->GetImportPointer();
-	size_t const width = m_SliceHandler->Width();
-	size_t const height = m_SliceHandler->Width();
+	size_t const width = params.m_Width;
+	size_t const height = params.m_Height;
 
 	unsigned first_mark = -1;
 	bool found_other_mark = false;
-	for (const auto& slice_marks : m_Vm)
+	for (const auto& slice_marks : marks)
 	{
 		auto slice = slice_marks.first;
-		if (slice == m_CurrentSlice || Dim == 3)
+		if (slice == params.m_CurrentSlice || Dim == 3)
 		{
 			size_t const zoffset = (Dim == 3) ? slice * width * height : 0;
 			for (auto& m : slice_marks.second)
@@ -281,29 +328,43 @@ typename itk::Image<unsigned char, Dim>::Pointer
 	}
 	std::cerr << "Found other mark: " << found_other_mark << "\n";
 
-	auto cutter = gc_filter_type::New();
+	typename gc_filter_type::Pointer cutter = dynamic_cast<gc_filter_type*>(cached_cutter.GetPointer());
+	if (!cutter)
+	{
+		cutter = gc_filter_type::New();
+		cutter->SetReuseGraph(true);
+		cached_cutter = cutter.GetPointer();
+	}
 	cutter->SetBackgroundValue(0);
 	cutter->SetObject1Value(object_1);
 	cutter->SetObject2Value(object_2);
 	cutter->SetVerboseOutput(true);
 	cutter->SetUseGradientMagnitude(use_gradient_magnitude);
-	if (has_sigma)
+	cutter->SetMultiResolution(params.m_MultiResolution);
+	if (params.m_HasSigma)
 	{
-		cutter->SetSigma(sigma);
+		cutter->SetSigma(params.m_Sigma);
 	}
 	cutter->SetConnectivity(use_full_neighborhood ? itk::eGcConnectivity::kNodeNeighbors : itk::eGcConnectivity::kFaceNeighbors);
 	cutter->SetMaskInput(mask);
-	if (use_gradient_magnitude)
+	cutter->SetIntensityInput(use_gradient_magnitude ? source : nullptr);
+
+	// the cutter outlives the job, so the observer is removed again
+	unsigned long observer_tag = 0;
+	if (progress)
 	{
-		cutter->SetIntensityInput(source);
+		auto observer = ItkProgressObserver::New();
+		observer->SetProgressInfo(progress);
+		observer_tag = cutter->AddObserver(itk::ProgressEvent(), observer);
 	}
 
+	typename mask_type::Pointer output;
 	try
 	{
 		cutter->GetOutput()->SetRequestedRegion(requested_region);
 		cutter->Update();
 		std::cerr << "TissueSeparator finished\n";
-		return cutter->GetOutput();
+		output = cutter->GetOutput();
 	}
 	catch (itk::ExceptionObject e)
 	{
@@ -313,7 +374,16 @@ typename itk::Image<unsigned char, Dim>::Pointer
 	{
 		iseg::Log::Error(e.what());
 	}
-	return nullptr;
+
+	if (progress)
+	{
+		cutter->RemoveObserver(observer_tag);
+	}
+	if (!output)
+	{
+		cached_cutter = nullptr;
+	}
+	return output;
 }
 
 } // namespace iseg
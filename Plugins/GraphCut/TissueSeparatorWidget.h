@@ -9,10 +9,12 @@
  */
 #pragma once
 
+#include "Data/ProgressInfo.h"
 #include "Data/SlicesHandlerInterface.h"
 #include "Interface/WidgetInterface.h"
 
 #include <itkImage.h>
+#include <itkProcessObject.h>
 
 #include <QCheckBox>
 #include <QLabel>
@@ -46,13 +48,28 @@ private:
 private slots:
 	void Execute();
 	void Clearmarks();
+	void JobFinished(int id, bool committed);
 
 private:
+	struct Parameters
+	{
+		bool m_HasSigma;
+		double m_Sigma;
+		bool m_UseSource;
+		bool m_MultiResolution;
+		unsigned m_CurrentSlice;
+		size_t m_Width;
+		size_t m_Height;
+	};
+
+	Parameters GetParameters() const;
+
 	void DoWorkAllSlices();
 	void DoWorkCurrentSlice();
 
+	/// Does not access the widget, since it is called in a worker thread for all slices
 	template<unsigned int Dim, typename TInput>
-	typename itk::Image<unsigned char, Dim>::Pointer DoWork(TInput* source, TInput* target, const typename itk::Image<unsigned char, Dim>::RegionType& requested_region);
+	static typename itk::Image<unsigned char, Dim>::Pointer DoWork(TInput* source, TInput* target, const typename itk::Image<unsigned char, Dim>::RegionType& requested_region, const Parameters& params, const std::map<unsigned, std::vector<iseg::Mark>>& marks, itk::ProcessObject::Pointer& cached_cutter, ProgressInfo* progress);
 
 	iseg::SlicesHandlerInterface* m_SliceHandler;
 	unsigned m_CurrentSlice;
@@ -61,9 +78,16 @@ private:
 	std::vector<iseg::Point> m_Vpdyn;
 	std::map<unsigned, std::vector<iseg::Mark>> m_Vm;
 
+	// kept between runs, so that adding lines only updates the solved graph
+	itk::ProcessObject::Pointer m_Cutter2D;
+	itk::ProcessObject::Pointer m_Cutter3D;
+
+	int m_JobId = 0;
+
 	QCheckBox* m_AllSlices;
 	QCheckBox* m_UseSource;
 	QLineEdit* m_SigmaEdit;
+	QCheckBox* m_MultiResolution;
 	QPushButton* m_ClearLines;
 	QPushButton* m_ExecuteButton;
 };
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../ImageGraphCut3DFilter.h"
+
+#include <itkImage.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+using input_type = itk::Image<float, 3>;
+using output_type = itk::Image<unsigned char, 3>;
+using filter_type = itk::ImageGraphCutFilter<input_type, input_type, input_type, output_type>;
+
+/// bright ellipsoid (source), surrounded by a shell of intermediate values which are not seeds, in a dark background (sink)
+input_type::Pointer MakeImage(unsigned n)
+{
+	input_type::SizeType size = {{n, n, n}};
+	auto image = input_type::New();
+	image->SetRegions(input_type::RegionType(size));
+	image->Allocate();
+
+	double const c = 0.5 * (n - 1);
+	itk::ImageRegionIteratorWithIndex<input_type> it(image, image->GetLargestPossibleRegion());
+	for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+	{
+		auto idx = it.GetIndex();
+		double const x = (idx[0] - c) / 24.0, y = (idx[1] - c) / 18.0, z = (idx[2] - c) / 15.0;
+		double const r = std::sqrt(x * x + y * y + z * z);
+		it.Set(r < 1.0 ? 1000.f : (r < 1.6 ? 200.f : -100.f));
+	}
+	return image;
+}
+
+std::vector<unsigned char> Cut(input_type* image, bool multi_resolution)
+{
+	auto filter = filter_type::New();
+	filter->SetNumberOfRequiredInputs(1);
+	filter->SetInputImage(image);
+	filter->SetIntensity(true);
+	filter->SetForegroundPixelValue(255);
+	filter->SetBackgroundPixelValue(0);
+	filter->SetVerboseOutput(false);
+	filter->SetMultiResolution(multi_resolution);
+	filter->Update();
+
+	auto output = filter->GetOutput();
+	auto buffer = output->GetBufferPointer();
+	return std::vector<unsigned char>(buffer, buffer + output->GetBufferedRegion().GetNumberOfPixels());
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(GraphCut_suite);
+
+BOOST_AUTO_TEST_CASE(BandedCutEqualsFullCut)
+{
+	// large enough to be solved coarse-to-fine
+	auto image = MakeImage(72);
+
+	auto full = Cut(image, false);
+	auto banded = Cut(image, true);
+
+	auto const num_source = std::count(full.begin(), full.end(), 255);
+	BOOST_CHECK(num_source > 0 && static_cast<size_t>(num_source) < full.size());
+	BOOST_CHECK(banded == full);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
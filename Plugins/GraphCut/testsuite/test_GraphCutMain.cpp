@@ -0,0 +1,12 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ * 
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ * 
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#define BOOST_TEST_MODULE GraphCut
+#define BOOST_TEST_NO_MAIN
+#include <boost/test/unit_test.hpp>
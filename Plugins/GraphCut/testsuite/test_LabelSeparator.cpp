@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../GraphCutAlgorithms.h"
+
+#include <itkImage.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <random>
+#include <vector>
+
+namespace {
+using mask_type = itk::Image<unsigned char, 3>;
+using intensity_type = itk::Image<float, 3>;
+using separator_type = itk::GraphCutLabelSeparator<mask_type, mask_type, intensity_type>;
+
+unsigned char const object_1 = 127;
+unsigned char const object_2 = 255;
+
+template<class TImage>
+typename TImage::Pointer MakeImage(typename TImage::PixelType value)
+{
+	typename TImage::SizeType size = {{24, 24, 8}};
+	auto image = TImage::New();
+	image->SetRegions(typename TImage::RegionType(size));
+	image->Allocate();
+	image->FillBuffer(value);
+	return image;
+}
+
+/// three regions with different intensities: x < 12 && y < 12, x < 12 && y >= 12 and x >= 12
+intensity_type::Pointer MakeIntensity()
+{
+	auto image = MakeImage<intensity_type>(0.f);
+	std::mt19937 gen(3);
+	std::uniform_real_distribution<float> noise(-1.f, 1.f);
+	itk::ImageRegionIteratorWithIndex<intensity_type> it(image, image->GetLargestPossibleRegion());
+	for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+	{
+		auto idx = it.GetIndex();
+		float const v = (idx[0] >= 12) ? 100.f : (idx[1] >= 12 ? 50.f : 0.f);
+		it.Set(v + noise(gen));
+	}
+	return image;
+}
+
+void AddSeed(mask_type* mask, itk::IndexValueType x, itk::IndexValueType y0, itk::IndexValueType y1, unsigned char value)
+{
+	for (auto y = y0; y <= y1; ++y)
+	{
+		mask_type::IndexType idx = {{x, y, 4}};
+		mask->SetPixel(idx, value);
+	}
+}
+
+unsigned char Label(const std::vector<unsigned char>& labels, size_t x, size_t y)
+{
+	return labels.at(x + 24 * (y + 24 * 4));
+}
+
+std::vector<unsigned char> Cut(separator_type* separator, mask_type* mask, intensity_type* intensity)
+{
+	separator->SetBackgroundValue(0);
+	separator->SetObject1Value(object_1);
+	separator->SetObject2Value(object_2);
+	separator->SetUseGradientMagnitude(true);
+	separator->SetSigma(1.0);
+	separator->SetConnectivity(itk::eGcConnectivity::kNodeNeighbors);
+	separator->SetMaskInput(mask);
+	separator->SetIntensityInput(intensity);
+	separator->Update();
+
+	auto output = separator->GetOutput();
+	auto buffer = output->GetBufferPointer();
+	return std::vector<unsigned char>(buffer, buffer + output->GetBufferedRegion().GetNumberOfPixels());
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(GraphCut_suite);
+
+BOOST_AUTO_TEST_CASE(ReuseGraphAfterSeedChange)
+{
+	auto intensity = MakeIntensity();
+
+	// the whole image is foreground, with one line of seeds on each side of the edge at x = 12
+	auto mask = MakeImage<mask_type>(1);
+	AddSeed(mask, 2, 2, 21, object_1);
+	AddSeed(mask, 21, 2, 21, object_2);
+
+	auto reused = separator_type::New();
+	reused->SetReuseGraph(true);
+	auto first = Cut(reused, mask, intensity);
+	BOOST_CHECK_EQUAL(Label(first, 6, 6), object_1);
+	BOOST_CHECK_EQUAL(Label(first, 6, 18), object_1);
+	BOOST_CHECK_EQUAL(Label(first, 18, 12), object_2);
+
+	// a seed in the upper left region moves it to object 2, the arcs between nodes are unchanged
+	AddSeed(mask, 4, 18, 18, object_2);
+	mask->Modified();
+	auto updated = Cut(reused, mask, intensity);
+
+	auto fresh = separator_type::New();
+	auto expected = Cut(fresh, mask, intensity);
+
+	BOOST_CHECK_EQUAL(Label(expected, 6, 6), object_1);
+	BOOST_CHECK_EQUAL(Label(expected, 6, 18), object_2);
+	BOOST_CHECK_EQUAL(Label(expected, 18, 12), object_2);
+	BOOST_CHECK(updated == expected);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,310 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "Energy/Neighbourhood.h"
+#include "Flow/Grid/DualDecomposition.h"
+#include "Flow/Grid/Kohli.h"
+#include "Flow/Grid/PushRelabel/Fifo.h"
+#include "Flow/Grid/PushRelabel/HighestLevel.h"
+#include "System/Algo/Sort/Heap.h"
+#include "System/Collection/BoolArrayMask.h"
+
+#include <itkImage.h>
+#include <itkImageFileReader.h>
+#include <itkMetaImageIOFactory.h>
+#include <itkNiftiImageIOFactory.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+using graph_type = Gc::Flow::IGridMaxFlow<3, Gc::Float32, Gc::Float32, Gc::Float32>;
+
+/// Two class segmentation of a volume with contrast sensitive arcs
+class Problem
+{
+public:
+	Problem(std::vector<float> image, const std::array<unsigned, 3>& dims, Gc::Size connectivity, double masked_fraction = 0.0)
+			: m_Image(std::move(image)), m_Dims(dims)
+	{
+		for (unsigned d = 0; d < 3; ++d)
+			m_Size[d] = dims[d];
+		m_Neighbourhood.Common(connectivity, false);
+		Gc::System::Algo::Sort::Heap(m_Neighbourhood.Begin(), m_Neighbourhood.End());
+
+		std::mt19937 gen(7);
+		std::uniform_real_distribution<double> uniform(0.0, 1.0);
+		m_Mask.Resize(m_Size);
+		for (size_t i = 0; i < m_Mask.Elements(); ++i)
+			m_Mask[i] = uniform(gen) < masked_fraction;
+		m_Masked = (masked_fraction > 0.0);
+
+		auto range = std::minmax_element(m_Image.begin(), m_Image.end());
+		m_Low = *range.first + 0.25f * (*range.second - *range.first);
+		m_High = *range.first + 0.75f * (*range.second - *range.first);
+		m_Sigma = std::max(0.1f * (*range.second - *range.first), 1e-6f);
+	}
+
+	bool Masked() const { return m_Masked; }
+
+	void Build(graph_type* graph) const
+	{
+		Gc::System::Collection::BoolArrayMask<3> mask(m_Mask, true);
+		if (m_Masked)
+			graph->InitMask(m_Size, m_Neighbourhood, mask);
+		else
+			graph->Init(m_Size, m_Neighbourhood);
+
+		auto const& nodes = mask.BackwardIndexes();
+		for (size_t i = 0; i < m_Image.size(); ++i)
+		{
+			if (m_Mask[i])
+				continue;
+			Gc::Size const node = m_Masked ? nodes[i] : i;
+			for (Gc::Size a = 0; a < m_Neighbourhood.Elements(); ++a)
+			{
+				size_t j;
+				if (Neighbor(i, a, j) && !m_Mask[j])
+					graph->SetArcCap(node, a, ArcCap(i, j));
+			}
+			graph->SetTerminalArcCap(node, SourceCap(i), SinkCap(i));
+		}
+	}
+
+	/// Value of the cut defined by the source set
+	double Energy(const graph_type* graph) const
+	{
+		Gc::System::Collection::BoolArrayMask<3> mask(m_Mask, true);
+		auto const& nodes = mask.BackwardIndexes();
+		auto source = [&](size_t i) {
+			return graph->NodeOrigin(m_Masked ? nodes[i] : i) == Gc::Flow::Source;
+		};
+
+		double energy = 0.0;
+		for (size_t i = 0; i < m_Image.size(); ++i)
+		{
+			if (m_Mask[i])
+				continue;
+			bool const si = source(i);
+			energy += si ? SinkCap(i) : SourceCap(i);
+			for (Gc::Size a = 0; si && a < m_Neighbourhood.Elements(); ++a)
+			{
+				size_t j;
+				if (Neighbor(i, a, j) && !m_Mask[j] && !source(j))
+					energy += ArcCap(i, j);
+			}
+		}
+		return energy;
+	}
+
+private:
+	bool Neighbor(size_t i, Gc::Size arc, size_t& j) const
+	{
+		long c[3] = {long(i % m_Dims[0]), long((i / m_Dims[0]) % m_Dims[1]), long(i / (size_t(m_Dims[0]) * m_Dims[1]))};
+		for (unsigned d = 0; d < 3; ++d)
+		{
+			c[d] += m_Neighbourhood[arc][d];
+			if (c[d] < 0 || c[d] >= long(m_Dims[d]))
+				return false;
+		}
+		j = c[0] + m_Dims[0] * (c[1] + size_t(m_Dims[1]) * c[2]);
+		return true;
+	}
+
+	float ArcCap(size_t i, size_t j) const
+	{
+		float const d = (m_Image[i] - m_Image[j]) / m_Sigma;
+		return std::exp(-0.5f * d * d);
+	}
+	float SourceCap(size_t i) const { return std::max(m_Image[i] - m_Low, 0.f) / m_Sigma; }
+	float SinkCap(size_t i) const { return std::max(m_High - m_Image[i], 0.f) / m_Sigma; }
+
+	std::vector<float> m_Image;
+	std::array<unsigned, 3> m_Dims;
+	Gc::Math::Algebra::Vector<3, Gc::Size> m_Size;
+	Gc::Energy::Neighbourhood<3, Gc::Int32> m_Neighbourhood;
+	Gc::System::Collection::Array<3, bool> m_Mask;
+	bool m_Masked;
+	float m_Low, m_High, m_Sigma;
+};
+
+/// Random spheres with noise
+std::vector<float> Spheres(const std::array<unsigned, 3>& dims, unsigned seed)
+{
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<float> uniform(0.f, 1.f);
+	std::normal_distribution<float> noise(0.f, 30.f);
+
+	std::vector<std::array<float, 4>> spheres(12);
+	for (auto& s : spheres)
+		s = {uniform(gen) * dims[0], uniform(gen) * dims[1], uniform(gen) * dims[2], 3.f + uniform(gen) * dims[0] / 4.f};
+
+	std::vector<float> image(size_t(dims[0]) * dims[1] * dims[2]);
+	size_t n = 0;
+	for (unsigned z = 0; z < dims[2]; ++z)
+	{
+		for (unsigned y = 0; y < dims[1]; ++y)
+		{
+			for (unsigned x = 0; x < dims[0]; ++x, ++n)
+			{
+				bool inside = false;
+				for (auto& s : spheres)
+					inside = inside || (x - s[0]) * (x - s[0]) + (y - s[1]) * (y - s[1]) + (z - s[2]) * (z - s[2]) < s[3] * s[3];
+				image[n] = (inside ? 150.f : 50.f) + noise(gen);
+			}
+		}
+	}
+	return image;
+}
+
+std::unique_ptr<graph_type> Kohli(bool mask)
+{
+	if (mask)
+		return std::unique_ptr<graph_type>(new Gc::Flow::Grid::Kohli<3, Gc::Float32, Gc::Float32, Gc::Float32, true>);
+	return std::unique_ptr<graph_type>(new Gc::Flow::Grid::Kohli<3, Gc::Float32, Gc::Float32, Gc::Float32, false>);
+}
+
+std::unique_ptr<graph_type> Parallel(bool mask, Gc::Size blocks = 0, Gc::Size max_iter = 100)
+{
+	if (mask)
+		return std::unique_ptr<graph_type>(new Gc::Flow::Grid::DualDecomposition<3, Gc::Float32, Gc::Float32, Gc::Float32, true>(blocks, max_iter));
+	return std::unique_ptr<graph_type>(new Gc::Flow::Grid::DualDecomposition<3, Gc::Float32, Gc::Float32, Gc::Float32, false>(blocks, max_iter));
+}
+
+void CheckSameCut(const Problem& problem, graph_type* parallel)
+{
+	auto kohli = Kohli(problem.Masked());
+	problem.Build(kohli.get());
+	double const kohli_flow = kohli->FindMaxFlow();
+	double const kohli_energy = problem.Energy(kohli.get());
+
+	problem.Build(parallel);
+	double const flow = parallel->FindMaxFlow();
+	double const energy = problem.Energy(parallel);
+
+	// the minimum cut may not be unique, but its value is, up to the single precision flow accumulation
+	BOOST_CHECK_CLOSE(energy, kohli_energy, 1e-3);
+	BOOST_CHECK_CLOSE(flow, kohli_flow, 0.05);
+}
+
+double Milliseconds(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void RunSolvers(const std::string& name, const Problem& problem)
+{
+	std::vector<std::pair<std::string, std::unique_ptr<graph_type>>> solvers;
+	solvers.emplace_back("Kohli", Kohli(false));
+	solvers.emplace_back("PushLabel-Fifo", std::unique_ptr<graph_type>(new Gc::Flow::Grid::PushRelabel::Fifo<3, Gc::Float32, Gc::Float32, false>));
+	solvers.emplace_back("PushLabel-H_PRF", std::unique_ptr<graph_type>(new Gc::Flow::Grid::PushRelabel::HighestLevel<3, Gc::Float32, Gc::Float32, false>));
+	solvers.emplace_back("Kohli-Parallel", Parallel(false));
+
+	for (auto& solver : solvers)
+	{
+		auto start = std::chrono::steady_clock::now();
+		problem.Build(solver.second.get());
+		double const build = Milliseconds(start);
+
+		start = std::chrono::steady_clock::now();
+		double const flow = solver.second->FindMaxFlow();
+		double const solve = Milliseconds(start);
+
+		BOOST_TEST_MESSAGE(name << " " << solver.first << ": build " << build << " ms, max-flow " << solve << " ms, flow " << flow);
+		solver.second->Dispose();
+	}
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(GraphCut_suite);
+
+BOOST_AUTO_TEST_CASE(ParallelMaxFlow)
+{
+	std::array<unsigned, 3> dims = {40, 36, 64};
+	for (Gc::Size connectivity : {6, 26})
+	{
+		Problem problem(Spheres(dims, 1), dims, connectivity);
+		for (Gc::Size blocks : {1, 3, 4})
+		{
+			auto parallel = Parallel(false, blocks);
+			CheckSameCut(problem, parallel.get());
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(ParallelMaxFlowMask)
+{
+	std::array<unsigned, 3> dims = {32, 40, 48};
+	Problem problem(Spheres(dims, 2), dims, 18, 0.2);
+	auto parallel = Parallel(true, 4);
+	CheckSameCut(problem, parallel.get());
+}
+
+BOOST_AUTO_TEST_CASE(ParallelMaxFlowMerge)
+{
+	// if the blocks do not agree after one iteration they are merged, the cut is still minimal
+	std::array<unsigned, 3> dims = {30, 30, 64};
+	Problem problem(Spheres(dims, 3), dims, 26);
+	auto parallel = Parallel(false, 8, 1);
+	CheckSameCut(problem, parallel.get());
+
+	// dynamic change of the terminal arcs after the merge
+	for (Gc::Size i = 0; i < 900; ++i)
+		parallel->SetTerminalArcCap(i, 1000.f, 0.f);
+	parallel->FindMaxFlow();
+	BOOST_CHECK_EQUAL(parallel->NodeOrigin(0), Gc::Flow::Source);
+}
+
+// TestRunner --run_test=iSeg_suite/GraphCut_suite/Benchmark --log_level=message
+// A real volume (e.g. .mhd or .nii) can be added with the environment variable ISEG_GRAPHCUT_BENCHMARK_IMAGE
+BOOST_AUTO_TEST_CASE(Benchmark, *boost::unit_test::disabled())
+{
+	for (unsigned size : {64, 128, 256})
+	{
+		std::array<unsigned, 3> dims = {size, size, size};
+		auto image = Spheres(dims, size);
+		for (Gc::Size connectivity : {6, 26})
+		{
+			RunSolvers("spheres " + std::to_string(size) + "^3 N" + std::to_string(connectivity), Problem(image, dims, connectivity));
+		}
+	}
+
+	if (const char* file_name = std::getenv("ISEG_GRAPHCUT_BENCHMARK_IMAGE"))
+	{
+		itk::MetaImageIOFactory::RegisterOneFactory();
+		itk::NiftiImageIOFactory::RegisterOneFactory();
+
+		using image_type = itk::Image<float, 3>;
+		auto reader = itk::ImageFileReader<image_type>::New();
+		reader->SetFileName(file_name);
+		reader->Update();
+
+		auto const size = reader->GetOutput()->GetLargestPossibleRegion().GetSize();
+		std::array<unsigned, 3> dims = {unsigned(size[0]), unsigned(size[1]), unsigned(size[2])};
+		auto buffer = reader->GetOutput()->GetBufferPointer();
+		std::vector<float> image(buffer, buffer + reader->GetOutput()->GetLargestPossibleRegion().GetNumberOfPixels());
+		for (Gc::Size connectivity : {6, 26})
+		{
+			RunSolvers(std::string(file_name) + " N" + std::to_string(connectivity), Problem(image, dims, connectivity));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
@@ -9,10 +9,13 @@
  */
 #include "LevelsetWidget.h"
 
+#include "Data/ItkProgressObserver.h"
 #include "Data/ItkUtils.h"
 #include "Data/Logger.h"
 #include "Data/SlicesHandlerITKInterface.h"
 
+#include "Interface/JobScheduler.h"
+
 #include <itkApproximateSignedDistanceMapImageFilter.h>
 #include <itkBinaryThresholdImageFilter.h>
 #include <itkConstNeighborhoodIterator.h>
@@ -86,6 +89,7 @@ LevelsetWidget::LevelsetWidget(iseg::SlicesHandlerInterface* hand3D)
 	QObject_connect(m_GuessThreshold, SIGNAL(clicked()), this, SLOT(GuessThresholds()));
 	QObject_connect(m_ClearSeeds, SIGNAL(clicked()), this, SLOT(Clearmarks()));
 	QObject_connect(m_ExecuteButton, SIGNAL(clicked()), this, SLOT(DoWork()));
+	QObject_connect(iseg::JobScheduler::Instance(), SIGNAL(JobFinished(int,bool)), this, SLOT(JobFinished(int,bool)));
 }
 
 void LevelsetWidget::Init()
@@ -212,25 +216,113 @@ void LevelsetWidget::GuessThresholdsNd(TInput* source)
 
 void LevelsetWidget::DoWork()
 {
+	auto scheduler = iseg::JobScheduler::Instance();
+	if (scheduler->IsActive(m_JobId))
+	{
+		scheduler->Cancel(m_JobId);
+		return;
+	}
+
+	Parameters params;
+	params.m_InitFromTarget = m_InitFromTarget->isChecked();
+	params.m_CurvatureScaling = m_CurvatureScaling->text().toDouble();
+	params.m_EdgeWeight = m_EdgeWeight->text().toDouble();
+	params.m_LowerThreshold = m_LowerThreshold->text().toDouble();
+	params.m_UpperThreshold = m_UpperThreshold->text().toDouble();
+
 	iseg::SlicesHandlerITKInterface itk_handler(m_Handler3D);
 	if (m_AllSlices->isChecked())
 	{
-		using input_type = itk::SliceContiguousImage<float>;
-		auto source = itk_handler.GetSource(true); // active_slices -> correct seed z-position
-		auto target = itk_handler.GetTarget(true);
-		DoWorkNd<input_type>(source, target);
+		using input_type = itk::Image<float, 3>;
+		using mask_type = itk::Image<unsigned char, 3>;
+
+		// the job works on copies and pastes the result when it is committed
+		input_type::Pointer source = itk_handler.GetImageDeprecated(iseg::SlicesHandlerITKInterface::kSource, true); // active_slices -> correct seed z-position
+		input_type::Pointer target;
+		if (params.m_InitFromTarget)
+		{
+			target = itk_handler.GetImageDeprecated(iseg::SlicesHandlerITKInterface::kTarget, true);
+		}
+		std::vector<input_type::IndexType> seeds;
+		GetSeeds(seeds);
+
+		// the result is pasted into the slices the job was submitted for, even if the active range changes
+		unsigned const start_slice = m_Handler3D->StartSlice();
+		unsigned const end_slice = m_Handler3D->EndSlice();
+
+		auto output = std::make_shared<mask_type::Pointer>();
+		auto job = std::make_shared<iseg::FunctionJob>(
+				"Levelset",
+				[source, target, seeds, params, output](iseg::ProgressInfo* progress) {
+					*output = Segment<input_type>(source, target, seeds, params, progress);
+					return output->IsNotNull();
+				},
+				[this, output, start_slice, end_slice]() {
+					if (end_slice > m_Handler3D->NumSlices())
+					{
+						ISEG_ERROR_MSG("could not set output because the slices have changed.");
+						return;
+					}
+					iseg::SlicesHandlerITKInterface itk_handler(m_Handler3D);
+					auto target = itk_handler.GetTarget(start_slice, end_slice);
+
+					iseg::DataSelection data_selection;
+					data_selection.allSlices = true;
+					data_selection.work = true;
+					emit BeginDatachange(data_selection, this);
+
+					if (!iseg::Paste<mask_type, itk::SliceContiguousImage<float>>(*output, target))
+					{
+						ISEG_ERROR_MSG("could not set output because image regions don't match.");
+					}
+
+					emit EndDatachange(this);
+				});
+		job->AddLease(iseg::SliceLease(iseg::SliceLease::kSource, iseg::SliceLease::kRead, start_slice, end_slice));
+		job->AddLease(iseg::SliceLease(iseg::SliceLease::kTarget, iseg::SliceLease::kWrite, start_slice, end_slice));
+
+		m_JobId = scheduler->Submit(job);
+		m_ExecuteButton->setText("Cancel");
 	}
 	else
 	{
 		using input_type = itk::Image<float, 2>;
+		using mask_type = itk::Image<unsigned char, 2>;
 		auto source = itk_handler.GetSourceSlice();
 		auto target = itk_handler.GetTargetSlice();
-		DoWorkNd<input_type>(source, target);
+
+		std::vector<input_type::IndexType> seeds;
+		GetSeeds(seeds);
+
+		auto output = Segment<input_type>(source, target, seeds, params, nullptr);
+		if (output)
+		{
+			iseg::DataSelection data_selection;
+			data_selection.sliceNr = m_Activeslice;
+			data_selection.work = true;
+			emit BeginDatachange(data_selection, this);
+
+			if (!iseg::Paste<mask_type, input_type>(output, target))
+			{
+				ISEG_ERROR_MSG("could not set output because image regions don't match.");
+			}
+
+			emit EndDatachange(this);
+		}
+	}
+}
+
+void LevelsetWidget::JobFinished(int id, bool committed)
+{
+	if (id == m_JobId)
+	{
+		m_ExecuteButton->setText("Execute");
 	}
 }
 
 template<typename TInput>
-void LevelsetWidget::DoWorkNd(TInput* input, TInput* target)
+typename itk::Image<unsigned char, TInput::ImageDimension>::Pointer
+		LevelsetWidget::Segment(TInput* input, TInput* target, const std::vector<typename TInput::IndexType>& indices, const Parameters& params, iseg::ProgressInfo* progress)
 {
 	itkStaticConstMacro(ImageDimension, size_t, TInput::ImageDimension);
 	using input_type = TInput;
@@ -248,7 +340,7 @@ void LevelsetWidget::DoWorkNd(TInput* input, TInput* target)
 
 	// initialize levelset
 	typename real_type::Pointer initial_levelset;
-	if (m_InitFromTarget->isChecked())
+	if (params.m_InitFromTarget)
 	{
 		// threshold target -> mask
 		auto threshold_target = itk::BinaryThresholdImageFilter<input_type, real_type>::New();
@@ -262,9 +354,6 @@ void LevelsetWidget::DoWorkNd(TInput* input, TInput* target)
 	else
 	{
 		// setup seeds
-		std::vector<typename input_type::IndexType> indices;
-		GetSeeds(indices);
-
 		const double initial_distance = 2.0;				 // \todo BL
 		const double seed_value = -initial_distance; // \todo BL
 		auto seeds = node_container_type::New();
@@ -290,10 +379,10 @@ void LevelsetWidget::DoWorkNd(TInput* input, TInput* target)
 	threshold_levelset->SetInput(initial_levelset);
 	threshold_levelset->SetFeatureImage(input);
 	threshold_levelset->SetPropagationScaling(1.0);
-	threshold_levelset->SetCurvatureScaling(m_CurvatureScaling->text().toDouble());
-	threshold_levelset->SetEdgeWeight(m_EdgeWeight->text().toDouble());
-	threshold_levelset->SetLowerThreshold(m_LowerThreshold->text().toDouble());
-	threshold_levelset->SetUpperThreshold(m_UpperThreshold->text().toDouble());
+	threshold_levelset->SetCurvatureScaling(params.m_CurvatureScaling);
+	threshold_levelset->SetEdgeWeight(params.m_EdgeWeight);
+	threshold_levelset->SetLowerThreshold(params.m_LowerThreshold);
+	threshold_levelset->SetUpperThreshold(params.m_UpperThreshold);
 	threshold_levelset->SetMaximumRMSError(0.02);
 	threshold_levelset->SetNumberOfIterations(1200);
 	threshold_levelset->SetIsoSurfaceValue(0.0);
@@ -304,6 +393,13 @@ void LevelsetWidget::DoWorkNd(TInput* input, TInput* target)
 	threshold->SetOutsideValue(0);
 	threshold->SetInsideValue(255);
 
+	if (progress)
+	{
+		auto observer = iseg::ItkProgressObserver::New();
+		observer->SetProgressInfo(progress);
+		threshold_levelset->AddObserver(itk::ProgressEvent(), observer);
+	}
+
 	try
 	{
 		threshold->Update();
@@ -312,19 +408,7 @@ void LevelsetWidget::DoWorkNd(TInput* input, TInput* target)
 	catch (itk::ExceptionObject e)
 	{
 		ISEG_ERROR_MSG(e.what());
-		return;
-	}
-
-	iseg::DataSelection data_selection;
-	data_selection.allSlices = m_AllSlices->isChecked();
-	data_selection.sliceNr = m_Activeslice;
-	data_selection.work = true;
-	emit BeginDatachange(data_selection, this);
-
-	if (!iseg::Paste<mask_type, input_type>(threshold->GetOutput(), target))
-	{
-		ISEG_ERROR_MSG("could not set output because image regions don't match.");
+		return nullptr;
 	}
-
-	emit EndDatachange(this);
+	return threshold->GetOutput();
 }
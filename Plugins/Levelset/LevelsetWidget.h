@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include "Data/ProgressInfo.h"
 #include "Data/SlicesHandlerInterface.h"
 
 #include "Interface/WidgetInterface.h"
@@ -19,6 +20,7 @@
 #include <qpushbutton.h>
 #include <qspinbox.h>
 
+#include <itkImage.h>
 #include <itkIndex.h>
 
 class LevelsetWidget : public iseg::WidgetInterface
@@ -37,8 +39,18 @@ private:
 	void OnSlicenrChanged() override;
 	void OnMouseClicked(iseg::Point p) override;
 
+	struct Parameters
+	{
+		bool m_InitFromTarget;
+		double m_CurvatureScaling;
+		double m_EdgeWeight;
+		double m_LowerThreshold;
+		double m_UpperThreshold;
+	};
+
+	/// Runs the segmentation, does not access the widget (called in a worker thread for all slices)
 	template<typename TInput>
-	void DoWorkNd(TInput* source, TInput* target);
+	static typename itk::Image<unsigned char, TInput::ImageDimension>::Pointer Segment(TInput* source, TInput* target, const std::vector<typename TInput::IndexType>& seeds, const Parameters& params, iseg::ProgressInfo* progress);
 
 	void GetSeeds(std::vector<itk::Index<2>>&);
 	void GetSeeds(std::vector<itk::Index<3>>&);
@@ -62,8 +74,11 @@ private:
 
 	std::map<unsigned, std::vector<iseg::Point>> m_Vpdyn;
 
+	int m_JobId = 0;
+
 private slots:
 	void DoWork();
 	void Clearmarks();
 	void GuessThresholds();
+	void JobFinished(int id, bool committed);
 };
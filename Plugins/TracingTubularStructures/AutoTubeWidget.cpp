@@ -8,6 +8,7 @@
  *  https://opensource.org/licenses/MIT
  */
 #include "AutoTubeWidget.h"
+#include "HessianEigenCache.h"
 
 #include "Data/ItkUtils.h"
 #include "Data/Logger.h"
@@ -66,6 +67,19 @@ class BinaryThinningImageFilter<TInputImage, TOutputImage, 3> : public itk::Bina
 {
 };
 
+namespace {
+// the cached feature image is only valid as long as the source does not change
+void AddSourceVersion(const itk::SliceContiguousImage<float>* source, std::vector<double>& params)
+{
+	auto const hash = iseg::HessianEigenCache::Hash(source, source->GetLargestPossibleRegion());
+	params.push_back(static_cast<double>(hash >> 32));
+	params.push_back(static_cast<double>(hash & 0xffffffff));
+}
+
+// 2D feature images are not cached
+void AddSourceVersion(const itk::Image<float, 2>* source, std::vector<double>& params) {}
+} // namespace
+
 AutoTubeWidget::AutoTubeWidget(iseg::SlicesHandlerInterface* hand3D)
 		: m_Handler3D(hand3D)
 {
@@ -224,7 +238,7 @@ typename TImage::Pointer AutoTubeWidget::ComputeFeatureImage(TInput* source) con
 	multi_scale_enhancement_filter->SetSigmaStepMethodToEquispaced();
 	multi_scale_enhancement_filter->SetSigmaMinimum(std::min(sigm_min, sigm_max));
 	multi_scale_enhancement_filter->SetSigmaMaximum(std::max(sigm_min, sigm_max));
-	multi_scale_enhancement_filter->SetNumberOfSigmaSteps(std::min(1, num_levels));
+	multi_scale_enhancement_filter->SetNumberOfSigmaSteps(std::max(1, num_levels));
 	multi_scale_enhancement_filter->Update();
 	return multi_scale_enhancement_filter->GetOutput();
 }
@@ -262,7 +276,7 @@ typename TImage::Pointer AutoTubeWidget::ComputeFeatureImage2d(TInput* source) c
 	multi_scale_enhancement_filter->SetSigmaStepMethodToEquispaced();
 	multi_scale_enhancement_filter->SetSigmaMinimum(std::min(sigm_min, sigm_max));
 	multi_scale_enhancement_filter->SetSigmaMaximum(std::max(sigm_min, sigm_max));
-	multi_scale_enhancement_filter->SetNumberOfSigmaSteps(std::min(1, num_levels));
+	multi_scale_enhancement_filter->SetNumberOfSigmaSteps(std::max(1, num_levels));
 
 	auto slice_filter = slice_by_slice_filter_type::New();
 	slice_filter->SetInput(source);
@@ -291,6 +305,7 @@ void AutoTubeWidget::DoWorkNd(TInput* source, TTissue* tissues, TTarget* target)
 	feature_params.push_back(m_SigmaHi->text().toDouble());
 	feature_params.push_back(m_NumberSigmaLevels->text().toInt());
 	feature_params.push_back(m_Metric2d->isChecked());
+	AddSourceVersion(source, feature_params);
 	if (!m_CachedFeatureImage.Get(feature_image, feature_params))
 	{
 		feature_image = m_Metric2d->isChecked()
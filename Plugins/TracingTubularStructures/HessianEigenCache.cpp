@@ -0,0 +1,372 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "HessianEigenCache.h"
+
+#include <itkHessianRecursiveGaussianImageFilter.h>
+#include <itkMath.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifndef NO_OPENMP_SUPPORT
+#	include <omp.h>
+#endif
+
+namespace iseg {
+
+namespace {
+// support of the recursive Gaussian which is taken into account, in pixels
+long Support(double sigma, double spacing)
+{
+	return std::max(3L, static_cast<long>(std::ceil(4.0 * sigma / spacing)) + 1);
+}
+
+template<unsigned int N>
+void SortByMagnitude(double (&eig)[N])
+{
+	std::sort(eig, eig + N, [](double a, double b) { return std::abs(a) < std::abs(b); });
+}
+
+template<unsigned int Dim>
+typename itk::Image<itk::SymmetricSecondRankTensor<double, Dim>, Dim>::Pointer ComputeHessian(typename itk::Image<float, Dim>* image, double sigma, bool normalize)
+{
+	auto hessian = itk::HessianRecursiveGaussianImageFilter<itk::Image<float, Dim>>::New();
+	hessian->SetInput(image);
+	hessian->SetSigma(sigma);
+	hessian->SetNormalizeAcrossScale(normalize);
+	// blocks are already processed in parallel
+	hessian->SetNumberOfWorkUnits(1);
+	hessian->Update();
+	return hessian->GetOutput();
+}
+} // namespace
+
+std::vector<double> HessianEigenCache::Sigmas(double sigma_min, double sigma_max, int num_levels)
+{
+	auto const lo = std::min(sigma_min, sigma_max);
+	auto const hi = std::max(sigma_min, sigma_max);
+	if (num_levels < 2)
+	{
+		return std::vector<double>(1, lo);
+	}
+
+	std::vector<double> sigmas(num_levels);
+	auto const step = std::max(1e-10, hi - lo) / (num_levels - 1);
+	for (int i = 0; i < num_levels; ++i)
+	{
+		sigmas[i] = lo + step * i;
+	}
+	return sigmas;
+}
+
+void HessianEigenCache::SymmetricEigenvalues(const double a[6], double eig[3])
+{
+	// closed form solution for symmetric 3x3 matrices, see O. K. Smith, "Eigenvalues of a symmetric 3x3 matrix", 1961
+	double const p1 = a[1] * a[1] + a[2] * a[2] + a[4] * a[4];
+	double const q = (a[0] + a[3] + a[5]) / 3.0;
+	double const d0 = a[0] - q, d1 = a[3] - q, d2 = a[5] - q;
+	double const p2 = d0 * d0 + d1 * d1 + d2 * d2 + 2.0 * p1;
+	if (p2 <= 0.0)
+	{
+		eig[0] = eig[1] = eig[2] = q;
+		return;
+	}
+
+	double const p = std::sqrt(p2 / 6.0);
+	// determinant of (A - q I) / p
+	double const det = d0 * (d1 * d2 - a[4] * a[4]) - a[1] * (a[1] * d2 - a[4] * a[2]) + a[2] * (a[1] * a[4] - d1 * a[2]);
+	double const r = std::max(-1.0, std::min(1.0, det / (2.0 * p * p * p)));
+	double const phi = std::acos(r) / 3.0;
+
+	double sorted[3];
+	sorted[0] = q + 2.0 * p * std::cos(phi);
+	sorted[2] = q + 2.0 * p * std::cos(phi + (2.0 * itk::Math::pi / 3.0));
+	sorted[1] = 3.0 * q - sorted[0] - sorted[2];
+	SortByMagnitude(sorted);
+	std::copy(sorted, sorted + 3, eig);
+}
+
+void HessianEigenCache::SymmetricEigenvalues2(const double a[3], double eig[2])
+{
+	double const m = 0.5 * (a[0] + a[2]);
+	double const d = std::sqrt(0.25 * (a[0] - a[2]) * (a[0] - a[2]) + a[1] * a[1]);
+	double sorted[2] = {m - d, m + d};
+	SortByMagnitude(sorted);
+	eig[0] = sorted[0];
+	eig[1] = sorted[1];
+}
+
+double HessianEigenCache::ObjectnessMeasure(const float* eig, unsigned int n, const ObjectnessParameters& params)
+{
+	unsigned int const m = params.m_ObjectDimension;
+	for (unsigned int i = m; i < n; ++i)
+	{
+		if ((params.m_BrightObject && eig[i] > 0.f) || (!params.m_BrightObject && eig[i] < 0.f))
+		{
+			return 0.0;
+		}
+	}
+
+	double abs_eig[3];
+	for (unsigned int i = 0; i < n; ++i)
+	{
+		abs_eig[i] = std::abs(eig[i]);
+	}
+
+	double measure = 1.0;
+	if (m + 1 < n)
+	{
+		double denominator = 1.0;
+		for (unsigned int j = m + 1; j < n; ++j)
+		{
+			denominator *= abs_eig[j];
+		}
+		if (denominator > 0.0)
+		{
+			if (std::abs(params.m_Alpha) > 0.0)
+			{
+				double const ra = abs_eig[m] / std::pow(denominator, 1.0 / (n - m - 1));
+				measure *= 1.0 - std::exp(-0.5 * ra * ra / (params.m_Alpha * params.m_Alpha));
+			}
+		}
+		else
+		{
+			measure = 0.0;
+		}
+	}
+
+	if (m > 0)
+	{
+		double denominator = 1.0;
+		for (unsigned int j = m; j < n; ++j)
+		{
+			denominator *= abs_eig[j];
+		}
+		if (denominator > 0.0 && std::abs(params.m_Beta) > 0.0)
+		{
+			double const rb = abs_eig[m - 1] / std::pow(denominator, 1.0 / (n - m));
+			measure *= std::exp(-0.5 * rb * rb / (params.m_Beta * params.m_Beta));
+		}
+		else
+		{
+			measure = 0.0;
+		}
+	}
+
+	if (params.m_Gamma > 0.0)
+	{
+		double frobenius_norm_squared = 0.0;
+		for (unsigned int i = 0; i < n; ++i)
+		{
+			frobenius_norm_squared += abs_eig[i] * abs_eig[i];
+		}
+		measure *= 1.0 - std::exp(-0.5 * frobenius_norm_squared / (params.m_Gamma * params.m_Gamma));
+	}
+
+	if (params.m_ScaleObjectnessMeasure)
+	{
+		measure *= abs_eig[n - 1];
+	}
+	return measure;
+}
+
+HessianEigenCache::region_type HessianEigenCache::PaddedRegion(const region_type& region, const region_type& largest, const image_type::SpacingType& spacing, const std::vector<double>& sigmas, eMode mode) const
+{
+	auto const sigma_max = *std::max_element(sigmas.begin(), sigmas.end());
+
+	region_type::SizeType radius;
+	for (unsigned int d = 0; d < 3; ++d)
+	{
+		radius[d] = (d < 2 || mode == kVolume) ? Support(sigma_max, spacing[d]) : 0;
+	}
+	region_type padded = region;
+	padded.PadByRadius(radius);
+	padded.Crop(largest);
+	return padded;
+}
+
+void HessianEigenCache::Compute(const image_type* source, const region_type& region, Entry& entry) const
+{
+	unsigned int const n = entry.m_Mode == kVolume ? 3 : 2;
+	auto const num_scales = entry.m_Sigmas.size();
+	auto const num_pixels = region.GetNumberOfPixels();
+	entry.m_Eigenvalues.resize(num_scales * n * num_pixels);
+
+	auto const& source_region = source->GetBufferedRegion();
+	long const nx = region.GetSize(0), ny = region.GetSize(1), nz = region.GetSize(2);
+	long const source_nx = source_region.GetSize(0), source_ny = source_region.GetSize(1);
+	long const source_slice = source_nx * source_ny;
+
+	// the region is split into blocks of slices, which are padded by the support of the
+	// largest Gaussian along z in 3D. In 2D each slice is independent.
+	long block_size = 1;
+	if (entry.m_Mode == kVolume)
+	{
+		auto const sigma_max = *std::max_element(entry.m_Sigmas.begin(), entry.m_Sigmas.end());
+		long max_blocks = 1;
+#ifndef NO_OPENMP_SUPPORT
+		max_blocks = omp_get_max_threads();
+#endif
+		// avoid blocks which are much thinner than their padding
+		long const min_block_size = 4 * Support(sigma_max, source->GetSpacing()[2]);
+		long const num_blocks = std::max(1L, std::min(max_blocks, nz / min_block_size));
+		block_size = (nz + num_blocks - 1) / num_blocks;
+	}
+	long const num_blocks = (nz + block_size - 1) / block_size;
+
+	auto store = [&](size_t scale, long z, long y, long x, const double* eig) {
+		size_t const pixel = (z * ny + y) * nx + x;
+		float* dst = entry.m_Eigenvalues.data() + scale * n * num_pixels + pixel;
+		for (unsigned int k = 0; k < n; ++k)
+		{
+			dst[k * num_pixels] = static_cast<float>(eig[k]);
+		}
+	};
+
+#pragma omp parallel for schedule(dynamic)
+	for (long b = 0; b < num_blocks; ++b)
+	{
+		long const z_begin = region.GetIndex(2) + b * block_size;
+		long const z_end = std::min<long>(z_begin + block_size, region.GetIndex(2) + nz);
+
+		if (entry.m_Mode == kVolume)
+		{
+			using block_type = itk::Image<float, 3>;
+
+			auto const pad = Support(*std::max_element(entry.m_Sigmas.begin(), entry.m_Sigmas.end()), source->GetSpacing()[2]);
+			long const in_begin = std::max<long>(z_begin - pad, source_region.GetIndex(2));
+			long const in_end = std::min<long>(z_end + pad, source_region.GetUpperIndex()[2] + 1);
+
+			region_type in_region = source_region;
+			in_region.SetIndex(2, in_begin);
+			in_region.SetSize(2, in_end - in_begin);
+
+			auto block = block_type::New();
+			block->CopyInformation(source);
+			block->SetRegions(in_region);
+			block->Allocate();
+			std::memcpy(block->GetBufferPointer(), source->GetBufferPointer() + (in_begin - source_region.GetIndex(2)) * source_slice, in_region.GetNumberOfPixels() * sizeof(float));
+
+			for (size_t s = 0; s < num_scales; ++s)
+			{
+				auto hessian = ComputeHessian<3>(block, entry.m_Sigmas[s], entry.m_Normalize);
+				auto const* h = hessian->GetBufferPointer();
+
+				double a[6], eig[3];
+				for (long z = z_begin; z < z_end; ++z)
+				{
+					for (long y = 0; y < ny; ++y)
+					{
+						long const row = (z - in_begin) * source_slice + (y + region.GetIndex(1) - source_region.GetIndex(1)) * source_nx + region.GetIndex(0) - source_region.GetIndex(0);
+						for (long x = 0; x < nx; ++x)
+						{
+							auto const& t = h[row + x];
+							std::copy(t.Begin(), t.End(), a);
+							SymmetricEigenvalues(a, eig);
+							store(s, z - region.GetIndex(2), y, x, eig);
+						}
+					}
+				}
+			}
+		}
+		else
+		{
+			using slice_type = itk::Image<float, 2>;
+
+			for (long z = z_begin; z < z_end; ++z)
+			{
+				itk::ImageRegion<2> slice_region;
+				for (unsigned int d = 0; d < 2; ++d)
+				{
+					slice_region.SetIndex(d, source_region.GetIndex(d));
+					slice_region.SetSize(d, source_region.GetSize(d));
+				}
+				slice_type::SpacingType spacing;
+				spacing[0] = source->GetSpacing()[0];
+				spacing[1] = source->GetSpacing()[1];
+
+				auto slice = slice_type::New();
+				slice->SetRegions(slice_region);
+				slice->SetSpacing(spacing);
+				slice->Allocate();
+				std::memcpy(slice->GetBufferPointer(), source->GetBufferPointer() + (z - source_region.GetIndex(2)) * source_slice, source_slice * sizeof(float));
+
+				for (size_t s = 0; s < num_scales; ++s)
+				{
+					auto hessian = ComputeHessian<2>(slice, entry.m_Sigmas[s], entry.m_Normalize);
+					auto const* h = hessian->GetBufferPointer();
+
+					double a[3], eig[2];
+					for (long y = 0; y < ny; ++y)
+					{
+						long const row = (y + region.GetIndex(1) - source_region.GetIndex(1)) * source_nx + region.GetIndex(0) - source_region.GetIndex(0);
+						for (long x = 0; x < nx; ++x)
+						{
+							auto const& t = h[row + x];
+							std::copy(t.Begin(), t.End(), a);
+							SymmetricEigenvalues2(a, eig);
+							store(s, z - region.GetIndex(2), y, x, eig);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+HessianEigenCache::image_type::Pointer HessianEigenCache::Objectness(const region_type& region, const ObjectnessParameters& params) const
+{
+	if (m_Entries.empty() || !m_Entries.front().m_Region.IsInside(region))
+	{
+		return nullptr;
+	}
+	auto const& entry = m_Entries.front();
+
+	unsigned int const n = entry.m_Mode == kVolume ? 3 : 2;
+	auto const num_scales = entry.m_Sigmas.size();
+	auto const num_pixels = entry.m_Region.GetNumberOfPixels();
+	long const entry_nx = entry.m_Region.GetSize(0), entry_ny = entry.m_Region.GetSize(1);
+	long const nx = region.GetSize(0), ny = region.GetSize(1), nz = region.GetSize(2);
+
+	auto output = image_type::New();
+	output->CopyInformation(entry.m_Information);
+	output->SetBufferedRegion(region);
+	output->SetRequestedRegion(region);
+	output->Allocate();
+	auto buffer = output->GetBufferPointer();
+
+	std::int64_t const num_rows = ny * nz;
+#pragma omp parallel for
+	for (std::int64_t row = 0; row < num_rows; ++row)
+	{
+		long const y = row % ny, z = row / ny;
+		size_t const entry_row = ((z + region.GetIndex(2) - entry.m_Region.GetIndex(2)) * entry_ny + y + region.GetIndex(1) - entry.m_Region.GetIndex(1)) * entry_nx + region.GetIndex(0) - entry.m_Region.GetIndex(0);
+
+		float eig[3];
+		for (long x = 0; x < nx; ++x)
+		{
+			double value = 0.0;
+			for (size_t s = 0; s < num_scales; ++s)
+			{
+				const float* src = entry.m_Eigenvalues.data() + s * n * num_pixels + entry_row + x;
+				for (unsigned int k = 0; k < n; ++k)
+				{
+					eig[k] = src[k * num_pixels];
+				}
+				value = std::max(value, ObjectnessMeasure(eig, n, params));
+			}
+			buffer[row * nx + x] = static_cast<float>(value);
+		}
+	}
+	return output;
+}
+
+} // namespace iseg
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include <itkImage.h>
+#include <itkImageRegionConstIterator.h>
+
+#include <cstdint>
+#include <list>
+#include <vector>
+
+namespace iseg {
+
+/** \brief Cache of the Hessian eigenvalues of an image region at several scales
+
+	The Hessian is computed with separable recursive Gaussian derivatives, either in 3D or
+	slice by slice, on blocks of the region in parallel. The eigenvalues are sorted by
+	magnitude and stored per scale, so that objectness measures with different parameters
+	(alpha, beta, gamma, bright/dark objects, object dimension) can be evaluated without
+	recomputing the Hessian.
+
+	Entries are keyed by region, scales, mode and the content of the source pixels they
+	depend on. A request for a region contained in a cached region reuses the cached entry.
+*/
+class HessianEigenCache
+{
+public:
+	using image_type = itk::Image<float, 3>;
+	using region_type = itk::ImageRegion<3>;
+
+	enum eMode {
+		kVolume = 0,	// 3D Hessian
+		kSliceBySlice // 2D Hessian in each slice
+	};
+
+	struct ObjectnessParameters
+	{
+		double m_Alpha = 0.5;
+		double m_Beta = 0.5;
+		double m_Gamma = 5.0;
+		bool m_BrightObject = false;
+		unsigned int m_ObjectDimension = 1;
+		bool m_ScaleObjectnessMeasure = true;
+	};
+
+	/// Equispaced scales as used by itk::MultiScaleHessianBasedMeasureImageFilter
+	static std::vector<double> Sigmas(double sigma_min, double sigma_max, int num_levels);
+
+	HessianEigenCache(size_t max_entries = 4) : m_MaxEntries(max_entries) {}
+
+	/** Compute the eigenvalues in 'region' of 'source' at all 'sigmas', unless a cached entry for
+		the same parameters and unchanged source pixels contains the region.
+		\return true if the eigenvalues were recomputed
+	*/
+	template<class TInput>
+	bool Update(const TInput* source, const region_type& region, const std::vector<double>& sigmas, eMode mode, bool normalize_across_scale = false);
+
+	/// Maximum objectness over the scales of the last update, in 'region' which must be inside the updated region
+	image_type::Pointer Objectness(const region_type& region, const ObjectnessParameters& params) const;
+
+	/// Changes whenever the eigenvalues returned by Objectness are recomputed
+	size_t Version() const { return m_Entries.empty() ? 0 : m_Entries.front().m_Version; }
+
+	void Clear() { m_Entries.clear(); }
+
+	size_t NumberOfEntries() const { return m_Entries.size(); }
+
+	/// Sorted by magnitude (ascending) eigenvalues of the symmetric 3x3 matrix (a00, a01, a02, a11, a12, a22)
+	static void SymmetricEigenvalues(const double a[6], double eig[3]);
+
+	/// Sorted by magnitude (ascending) eigenvalues of the symmetric 2x2 matrix (a00, a01, a11)
+	static void SymmetricEigenvalues2(const double a[3], double eig[2]);
+
+	/// Hash of the spacing and the pixel values of 'source' in 'region', used to detect changes of the source
+	template<class TInput>
+	static std::uint64_t Hash(const TInput* source, const region_type& region);
+
+	/// Frangi objectness measure computed as in itk::HessianToObjectnessMeasureImageFilter
+	static double ObjectnessMeasure(const float* eig, unsigned int n, const ObjectnessParameters& params);
+
+private:
+	struct Entry
+	{
+		region_type m_Region;
+		region_type m_SourceRegion; // padded region the eigenvalues depend on
+		std::uint64_t m_SourceHash;
+		std::vector<double> m_Sigmas;
+		eMode m_Mode;
+		bool m_Normalize;
+		image_type::Pointer m_Information; // geometry of the source, without buffer
+		std::vector<float> m_Eigenvalues;	// [scale][eigenvalue][pixel]
+		size_t m_Version;
+	};
+
+	region_type PaddedRegion(const region_type& region, const region_type& largest, const image_type::SpacingType& spacing, const std::vector<double>& sigmas, eMode mode) const;
+
+	void Compute(const image_type* source, const region_type& region, Entry& entry) const;
+
+	static std::uint64_t Hash(std::uint64_t h, const void* data, size_t size)
+	{
+		// FNV-1a
+		auto bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; ++i)
+		{
+			h = (h ^ bytes[i]) * 1099511628211ULL;
+		}
+		return h;
+	}
+
+	size_t m_MaxEntries;
+	size_t m_NextVersion = 1;
+	std::list<Entry> m_Entries; // most recently used first
+};
+
+template<class TInput>
+std::uint64_t HessianEigenCache::Hash(const TInput* source, const region_type& region)
+{
+	std::uint64_t h = 14695981039346656037ULL;
+	auto const spacing = source->GetSpacing();
+	h = Hash(h, spacing.GetDataPointer(), sizeof(spacing[0]) * 3);
+
+	std::vector<float> line(region.GetSize(0));
+	itk::ImageRegionConstIterator<TInput> it(source, region);
+	for (it.GoToBegin(); !it.IsAtEnd();)
+	{
+		for (auto& v : line)
+		{
+			v = static_cast<float>(it.Get());
+			++it;
+		}
+		h = Hash(h, line.data(), line.size() * sizeof(float));
+	}
+	return h;
+}
+
+template<class TInput>
+bool HessianEigenCache::Update(const TInput* source, const region_type& region, const std::vector<double>& sigmas, eMode mode, bool normalize_across_scale)
+{
+	auto const spacing = source->GetSpacing();
+	for (auto it = m_Entries.begin(); it != m_Entries.end();)
+	{
+		auto& e = *it;
+		if (e.m_Sigmas == sigmas && e.m_Mode == mode && e.m_Normalize == normalize_across_scale && e.m_Region.IsInside(region) &&
+				e.m_Information->GetLargestPossibleRegion() == source->GetLargestPossibleRegion())
+		{
+			if (e.m_SourceHash == Hash(source, e.m_SourceRegion))
+			{
+				m_Entries.splice(m_Entries.begin(), m_Entries, it);
+				return false;
+			}
+			// source has changed
+			it = m_Entries.erase(it);
+			continue;
+		}
+		++it;
+	}
+
+	Entry entry;
+	entry.m_Region = region;
+	entry.m_SourceRegion = PaddedRegion(region, source->GetLargestPossibleRegion(), spacing, sigmas, mode);
+	entry.m_Sigmas = sigmas;
+	entry.m_Mode = mode;
+	entry.m_Normalize = normalize_across_scale;
+	entry.m_Version = m_NextVersion++;
+	entry.m_Information = image_type::New();
+	entry.m_Information->SetLargestPossibleRegion(source->GetLargestPossibleRegion());
+	entry.m_Information->SetSpacing(spacing);
+	entry.m_Information->SetOrigin(source->GetOrigin());
+	entry.m_Information->SetDirection(source->GetDirection());
+
+	// copy the pixels the eigenvalues depend on, hashing them on the way
+	auto copy = image_type::New();
+	copy->CopyInformation(entry.m_Information);
+	copy->SetRegions(entry.m_SourceRegion);
+	copy->Allocate();
+	{
+		auto dst = copy->GetBufferPointer();
+		itk::ImageRegionConstIterator<TInput> it(source, entry.m_SourceRegion);
+		for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+		{
+			*dst++ = static_cast<float>(it.Get());
+		}
+
+		std::uint64_t h = 14695981039346656037ULL;
+		h = Hash(h, spacing.GetDataPointer(), sizeof(spacing[0]) * 3);
+		entry.m_SourceHash = Hash(h, copy->GetBufferPointer(), entry.m_SourceRegion.GetNumberOfPixels() * sizeof(float));
+	}
+
+	Compute(copy, region, entry);
+
+	m_Entries.push_front(std::move(entry));
+	while (m_Entries.size() > m_MaxEntries)
+	{
+		m_Entries.pop_back();
+	}
+	return true;
+}
+
+} // namespace iseg
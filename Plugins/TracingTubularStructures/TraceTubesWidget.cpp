@@ -14,17 +14,18 @@
 #include "Data/BrushInteraction.h"
 #include "Data/ItkUtils.h"
 #include "Data/LogApi.h"
+#include "Data/Logger.h"
+#include "Data/ProgressInfo.h"
 #include "Data/SlicesHandlerITKInterface.h"
 
+#include "Interface/JobScheduler.h"
+
 #include <itkBinaryThresholdImageFilter.h>
 #include <itkDanielssonDistanceMapImageFilter.h>
-#include <itkHessianRecursiveGaussianImageFilter.h>
-#include <itkHessianToObjectnessMeasureImageFilter.h>
 #include <itkMinimumMaximumImageCalculator.h>
 #include <itkRegionOfInterestImageFilter.h>
 #include <itkSignedDanielssonDistanceMapImageFilter.h>
 #include <itkSignedMaurerDistanceMapImageFilter.h>
-#include <itkSliceBySliceImageFilter.h>
 
 #include <QCheckBox>
 #include <QComboBox>
@@ -34,7 +35,6 @@
 #include <QFormLayout>
 #include <QKeyEvent>
 #include <QLineEdit>
-#include <QProgressDialog>
 #include <QPushButton>
 #include <QScrollArea>
 #include <QStackedWidget>
@@ -77,7 +77,7 @@ void add_completer(QLineEdit* file_path, QWidget* parent)
 } // namespace
 
 TraceTubesWidget::TraceTubesWidget(iseg::SlicesHandlerInterface* hand3D)
-	: m_Handler(hand3D)
+	: m_Handler(hand3D), m_HessianCache(std::make_shared<iseg::HessianEigenCache>())
 {
 	setToolTip(Format("Trace elongated structures"));
 
@@ -200,6 +200,7 @@ TraceTubesWidget::TraceTubesWidget(iseg::SlicesHandlerInterface* hand3D)
 	QObject_connect(m_ClearPoints, SIGNAL(clicked()), this, SLOT(ClearPoints()));
 	QObject_connect(m_EstimateIntensity, SIGNAL(clicked()), this, SLOT(EstimateIntensity()));
 	QObject_connect(m_ExecuteButton, SIGNAL(clicked()), this, SLOT(DoWork()));
+	QObject_connect(iseg::JobScheduler::Instance(), SIGNAL(JobFinished(int,bool)), this, SLOT(JobFinished(int,bool)));
 }
 
 void TraceTubesWidget::OnMetricChanged()
@@ -234,12 +235,15 @@ void TraceTubesWidget::Init()
 
 void TraceTubesWidget::NewLoaded()
 {
+	// a running job keeps the previous cache
+	m_HessianCache = std::make_shared<iseg::HessianEigenCache>();
 	OnSlicenrChanged();
 }
 
 void TraceTubesWidget::Cleanup()
 {
 	m_Points.clear();
+	m_HessianCache = std::make_shared<iseg::HessianEigenCache>();
 }
 
 std::string TraceTubesWidget::GetName()
@@ -295,95 +299,69 @@ int TraceTubesWidget::GetPadding() const
 	return pad;
 }
 
-itk::Image<float, 3>::Pointer TraceTubesWidget::ComputeVesselness(const itk::ImageBase<3>::RegionType& requested_region) const
+itk::ImageBase<3>::RegionType TraceTubesWidget::GetRegion(const itk::ImageBase<3>::RegionType& largest) const
 {
-	using input_type = itk::SliceContiguousImage<float>;
-	using hessian_filter_type = itk::HessianRecursiveGaussianImageFilter<input_type>;
-	using hessian_pixel_type = itk::SymmetricSecondRankTensor<double, 3>;
-	using hessian_image_type = itk::Image<hessian_pixel_type, 3>;
-	using image_type = itk::Image<float, 3>;
-	using objectness_filter_type = itk::HessianToObjectnessMeasureImageFilter<hessian_image_type, image_type>;
+	using region_type = itk::ImageBase<3>::RegionType;
 
-	double sigma = m_Sigma->text().toDouble();
-	double alpha = m_Alpha->text().toDouble();
-	double beta = m_Beta->text().toDouble();
-	double gamma = m_Gamma->text().toDouble();
+	region_type::IndexType idx_lo = {m_Points.front().px, m_Points.front().py, m_Points.front().pz};
+	region_type::IndexType idx_hi = idx_lo;
+	for (auto p : m_Points)
+	{
+		idx_lo[0] = std::min<region_type::IndexValueType>(idx_lo[0], p.px);
+		idx_lo[1] = std::min<region_type::IndexValueType>(idx_lo[1], p.py);
+		idx_lo[2] = std::min<region_type::IndexValueType>(idx_lo[2], p.pz);
 
-	iseg::SlicesHandlerITKInterface itk_handler(m_Handler);
-	auto source = itk_handler.GetSource(true);
-
-	auto hessian_filter = hessian_filter_type::New();
-	hessian_filter->SetInput(source);
-	hessian_filter->SetSigma(sigma);
-
-	auto objectness_filter = objectness_filter_type::New();
-	objectness_filter->SetInput(hessian_filter->GetOutput());
-	objectness_filter->SetBrightObject(!m_DarkObjects->isChecked());
-	objectness_filter->SetObjectDimension(1);
-	objectness_filter->SetScaleObjectnessMeasure(true);
-	objectness_filter->SetAlpha(alpha);
-	objectness_filter->SetBeta(beta);
-	objectness_filter->SetGamma(gamma);
-	objectness_filter->GetOutput()->SetRequestedRegion(requested_region);
-	objectness_filter->Update();
-
-	return objectness_filter->GetOutput();
+		idx_hi[0] = std::max<region_type::IndexValueType>(idx_hi[0], p.px);
+		idx_hi[1] = std::max<region_type::IndexValueType>(idx_hi[1], p.py);
+		idx_hi[2] = std::max<region_type::IndexValueType>(idx_hi[2], p.pz);
+	}
+	region_type region;
+	region.SetIndex(idx_lo);
+	region.SetUpperIndex(idx_hi);
+	region.PadByRadius(GetPadding());
+	region.Crop(largest);
+	return region;
 }
 
-itk::Image<float, 3>::Pointer TraceTubesWidget::ComputeBlobiness(const itk::ImageBase<3>::RegionType& requested_region) const
+TraceTubesWidget::Parameters TraceTubesWidget::GetParameters() const
 {
-	using input_type = itk::SliceContiguousImage<float>;
-	using output_type = itk::Image<float, 3>;
-	using image_type = itk::Image<float, 2>;
-
-	using hessian_filter_type = itk::HessianRecursiveGaussianImageFilter<image_type>;
-	using hessian_pixel_type = itk::SymmetricSecondRankTensor<double, 2>;
-	using hessian_image_type = itk::Image<hessian_pixel_type, 2>;
+	Parameters params;
+	params.m_Metric = static_cast<eMetric>(m_Metric->currentIndex());
+	params.m_IntensityWeight = m_IntensityWeight->text().toDouble();
+	params.m_AngleWeight = m_AngleWeight->text().toDouble();
+	params.m_LineRadius = m_LineRadius->text().toDouble();
+	params.m_IntensityValue = m_IntensityValue->text().toDouble(&params.m_HasIntensity);
+	params.m_Padding = GetPadding();
+	params.m_Sigma = m_Sigma->text().toDouble();
+	params.m_Objectness.m_Alpha = m_Alpha->text().toDouble();
+	params.m_Objectness.m_Beta = m_Beta->text().toDouble();
+	params.m_Objectness.m_Gamma = m_Gamma->text().toDouble();
+	params.m_Objectness.m_BrightObject = !m_DarkObjects->isChecked();
+	params.m_Objectness.m_ScaleObjectnessMeasure = true;
+	params.m_DebugMetricFilePath = m_DebugMetricFilePath->text().toStdString();
+	params.m_PathFileName = m_PathFileName->text().toStdString();
+	return params;
+}
 
-	using objectness_filter_type = itk::HessianToObjectnessMeasureImageFilter<hessian_image_type, image_type>;
-	using slice_by_slice_filter_type = itk::SliceBySliceImageFilter<input_type, output_type, hessian_filter_type, objectness_filter_type>;
+template<class TInput>
+TraceTubesWidget::image_type::Pointer TraceTubesWidget::ComputeObjectness(iseg::HessianEigenCache& cache, const TInput* source, const region_type& requested_region, const Parameters& params)
+{
+	bool const vesselness = (params.m_Metric == kHessian3D);
 
-	double sigma = m_Sigma->text().toDouble();
-	double alpha = m_Alpha->text().toDouble();
-	double beta = m_Beta->text().toDouble();
-	double gamma = m_Gamma->text().toDouble();
+	std::vector<double> sigmas(1, params.m_Sigma);
+	cache.Update(source, requested_region, sigmas, vesselness ? iseg::HessianEigenCache::kVolume : iseg::HessianEigenCache::kSliceBySlice);
 
-	iseg::SlicesHandlerITKInterface itk_handler(m_Handler);
-	auto source = itk_handler.GetSource(true);
-
-	auto hessian_filter = hessian_filter_type::New();
-	hessian_filter->SetSigma(sigma);
-
-	auto objectness_filter = objectness_filter_type::New();
-	objectness_filter->SetInput(hessian_filter->GetOutput());
-	objectness_filter->SetBrightObject(!m_DarkObjects->isChecked());
-	objectness_filter->SetObjectDimension(0);
-	objectness_filter->SetScaleObjectnessMeasure(true);
-	objectness_filter->SetAlpha(alpha);
-	objectness_filter->SetBeta(beta);
-	objectness_filter->SetGamma(gamma);
-
-	auto slice_filter = slice_by_slice_filter_type::New();
-	slice_filter->SetInput(source);
-	slice_filter->SetInputFilter(hessian_filter);
-	slice_filter->SetOutputFilter(objectness_filter);
-	slice_filter->GetOutput()->SetRequestedRegion(requested_region);
-	slice_filter->Update();
-
-	return slice_filter->GetOutput();
+	auto objectness = params.m_Objectness;
+	objectness.m_ObjectDimension = vesselness ? 1 : 0;
+	return cache.Objectness(requested_region, objectness);
 }
 
-itk::Image<float, 3>::Pointer TraceTubesWidget::ComputeObjectSdf(const itk::ImageBase<3>::RegionType& requested_region) const
+TraceTubesWidget::image_type::Pointer TraceTubesWidget::ComputeObjectSdf(const image_type* target, const region_type& requested_region)
 {
-	iseg::SlicesHandlerITKInterface itk_handler(m_Handler);
-	auto target = itk_handler.GetTarget(true);
-
-	using input_type = itk::SliceContiguousImage<float>;
 	using mask_type = itk::Image<unsigned char, 3>;
-	using real_type = itk::Image<float, 3>;
-	using roi_filter_type = itk::RegionOfInterestImageFilter<input_type, mask_type>;
+	using roi_filter_type = itk::RegionOfInterestImageFilter<image_type, mask_type>;
 	using threshold_filter_type = itk::BinaryThresholdImageFilter<mask_type, mask_type>;
-	using distance_filter_type = itk::SignedDanielssonDistanceMapImageFilter<mask_type, real_type>;
+	using distance_filter_type = itk::SignedDanielssonDistanceMapImageFilter<mask_type, image_type>;
 
 	// it seems the distance transform always runs on whole image, which is slow
 	// therefore, I extract ROI and afterwards graft the output to fake a bufferedregion
@@ -404,9 +382,10 @@ itk::Image<float, 3>::Pointer TraceTubesWidget::ComputeObjectSdf(const itk::Imag
 	distance->SetSquaredDistance(false);
 	distance->Update();
 
-	auto output = real_type::New();
+	// the origin of the ROI is shifted, the geometry of the target is used instead
+	auto output = image_type::New();
 	output->Graft(distance->GetOutput());
-	output->SetLargestPossibleRegion(target->GetLargestPossibleRegion());
+	output->CopyInformation(target);
 	output->SetBufferedRegion(requested_region);
 	return output;
 }
@@ -420,44 +399,39 @@ void TraceTubesWidget::ClearPoints()
 
 void TraceTubesWidget::EstimateIntensity()
 {
-	if (!m_Points.empty())
+	if (iseg::JobScheduler::Instance()->IsActive(m_JobId))
 	{
-		using image_type = itk::Image<float, 3>;
+		// the eigenvalue cache is in use
+		iseg::Log::Warning("cannot estimate intensity while tracing");
+		return;
+	}
 
+	if (!m_Points.empty())
+	{
 		iseg::SlicesHandlerITKInterface itk_handler(m_Handler);
 		auto source = itk_handler.GetSource(true);
 
+		// compute the metric once in the same region as DoWork, so that the eigenvalues are reused when tracing
+		auto const params = GetParameters();
+		image_type::Pointer speed_image;
+		if (params.m_Metric == kHessian2D || params.m_Metric == kHessian3D)
+		{
+			speed_image = ComputeObjectness(*m_HessianCache, source.GetPointer(), GetRegion(source->GetLargestPossibleRegion()), params);
+		}
+
 		double intensity = 0.0;
 
 		for (auto p : m_Points)
 		{
 			image_type::IndexType idx = {p.px, p.py, p.pz};
 
-			if (m_Metric->currentIndex() == kIntensity)
+			if (params.m_Metric == kIntensity)
 			{
 				intensity += source->GetPixel(idx);
 			}
-			else
+			else if (speed_image)
 			{
-				image_type::SizeType size = {1, 1, 1};
-				image_type::RegionType region(idx, size);
-				region.PadByRadius(1);
-				region.Crop(source->GetLargestPossibleRegion());
-
-				if (m_Metric->currentIndex() == kHessian2D)
-				{
-					auto speed_image = ComputeBlobiness(region);
-					std::cerr << "Value: " << speed_image->GetPixel(idx) << "\n";
-					std::cerr << "Region: " << speed_image->GetBufferedRegion() << "\n";
-					intensity += speed_image->GetPixel(idx);
-				}
-				else if (m_Metric->currentIndex() == kHessian3D)
-				{
-					auto speed_image = ComputeVesselness(region);
-					std::cerr << "Value: " << speed_image->GetPixel(idx) << "\n";
-					std::cerr << "Region: " << speed_image->GetBufferedRegion() << "\n";
-					intensity += speed_image->GetPixel(idx);
-				}
+				intensity += speed_image->GetPixel(idx);
 			}
 		}
 
@@ -468,94 +442,122 @@ void TraceTubesWidget::EstimateIntensity()
 
 void TraceTubesWidget::DoWork()
 {
+	auto scheduler = iseg::JobScheduler::Instance();
+	if (scheduler->IsActive(m_JobId))
+	{
+		scheduler->Cancel(m_JobId);
+		return;
+	}
+
 	if (m_Points.size() < 2)
 	{
 		return;
 	}
 
 	using input_type = itk::SliceContiguousImage<float>;
+	using output_type = itk::Image<unsigned char, 3>;
 
-	int pad = GetPadding();
-	auto export_file_path = m_DebugMetricFilePath->text().toStdString();
+	auto const params = GetParameters();
 
+	// the job works on copies and pastes the result when it is committed
 	iseg::SlicesHandlerITKInterface itk_handler(m_Handler);
-	auto source = itk_handler.GetSource(true);
-
-	input_type::IndexType idx_lo = {m_Points.front().px, m_Points.front().py, m_Points.front().pz};
-	input_type::IndexType idx_hi = idx_lo;
-	for (auto p : m_Points)
+	image_type::Pointer source, target;
+	if (params.m_Metric == kTarget)
 	{
-		idx_lo[0] = std::min<input_type::IndexValueType>(idx_lo[0], p.px);
-		idx_lo[1] = std::min<input_type::IndexValueType>(idx_lo[1], p.py);
-		idx_lo[2] = std::min<input_type::IndexValueType>(idx_lo[2], p.pz);
-
-		idx_hi[0] = std::max<input_type::IndexValueType>(idx_hi[0], p.px);
-		idx_hi[1] = std::max<input_type::IndexValueType>(idx_hi[1], p.py);
-		idx_hi[2] = std::max<input_type::IndexValueType>(idx_hi[2], p.pz);
+		target = itk_handler.GetImageDeprecated(iseg::SlicesHandlerITKInterface::kTarget, true);
 	}
-	input_type::RegionType requested_region;
-	requested_region.SetIndex(idx_lo);
-	requested_region.SetUpperIndex(idx_hi);
-	requested_region.PadByRadius(pad);
-	requested_region.Crop(source->GetLargestPossibleRegion());
-
-	if (m_Metric->currentIndex() == kIntensity)
+	else
 	{
-		auto speed_image = source;
-		DoWorkTemplate<input_type>(speed_image, requested_region);
+		source = itk_handler.GetImageDeprecated(iseg::SlicesHandlerITKInterface::kSource, true);
 	}
-	else if (m_Metric->currentIndex() == kHessian2D)
-	{
-		auto speed_image = ComputeBlobiness(requested_region);
 
-		iseg::dump_image<itk::Image<float, 3>>(speed_image, export_file_path);
+	auto const requested_region = GetRegion((source ? source : target)->GetLargestPossibleRegion());
+	auto const points = m_Points;
+	auto const cache = m_HessianCache;
+
+	// the result is pasted into the slices the job was submitted for, even if the active range changes
+	unsigned const start_slice = m_Handler->StartSlice();
+	unsigned const end_slice = m_Handler->EndSlice();
+	unsigned const first_traced = static_cast<unsigned>(requested_region.GetIndex(2));
+	unsigned const end_traced = first_traced + static_cast<unsigned>(requested_region.GetSize(2));
+
+	auto output = std::make_shared<output_type::Pointer>();
+	auto job = std::make_shared<iseg::FunctionJob>(
+			"Trace tubes",
+			[source, target, requested_region, points, params, cache, output](iseg::ProgressInfo* progress) {
+				image_type::Pointer speed_image;
+				if (params.m_Metric == kIntensity)
+				{
+					speed_image = source;
+				}
+				else
+				{
+					if (params.m_Metric == kTarget)
+					{
+						speed_image = ComputeObjectSdf(target, requested_region);
+					}
+					else
+					{
+						speed_image = ComputeObjectness(*cache, source.GetPointer(), requested_region, params);
+					}
+
+					iseg::dump_image<image_type>(speed_image, params.m_DebugMetricFilePath);
+				}
 
-		DoWorkTemplate<itk::Image<float, 3>>(speed_image, requested_region);
-	}
-	else if (m_Metric->currentIndex() == kHessian3D)
-	{
-		auto speed_image = ComputeVesselness(requested_region);
+				*output = Trace(speed_image, requested_region, points, params, progress);
+				return output->IsNotNull();
+			},
+			[this, output, requested_region, start_slice, end_slice]() {
+				if (end_slice > m_Handler->NumSlices())
+				{
+					ISEG_ERROR_MSG("could not set output because the slices have changed.");
+					return;
+				}
+				iseg::SlicesHandlerITKInterface itk_handler(m_Handler);
+				auto target = itk_handler.GetTarget(start_slice, end_slice);
 
-		iseg::dump_image<itk::Image<float, 3>>(speed_image, export_file_path);
+				iseg::DataSelection data_selection;
+				data_selection.allSlices = true;
+				data_selection.work = true;
+				emit BeginDatachange(data_selection, this);
 
-		DoWorkTemplate<itk::Image<float, 3>>(speed_image, requested_region);
-	}
-	else if (m_Metric->currentIndex() == kTarget)
-	{
-		auto speed_image = ComputeObjectSdf(requested_region);
+				if (!iseg::Paste<output_type, input_type>(*output, target, requested_region))
+				{
+					ISEG_ERROR_MSG("could not set output because image regions don't match.");
+				}
 
-		iseg::dump_image<itk::Image<float, 3>>(speed_image, export_file_path);
+				emit EndDatachange(this);
+			});
+	job->AddLease(iseg::SliceLease(params.m_Metric == kTarget ? iseg::SliceLease::kTarget : iseg::SliceLease::kSource, iseg::SliceLease::kRead, start_slice, end_slice));
+	job->AddLease(iseg::SliceLease(iseg::SliceLease::kTarget, iseg::SliceLease::kWrite, first_traced, end_traced));
 
-		DoWorkTemplate<itk::Image<float, 3>>(speed_image, requested_region);
+	m_JobId = scheduler->Submit(job);
+	m_ExecuteButton->setText("Cancel");
+}
+
+void TraceTubesWidget::JobFinished(int id, bool committed)
+{
+	if (id == m_JobId)
+	{
+		m_ExecuteButton->setText("Execute");
 	}
 }
 
-template<class TSpeedImage>
-void TraceTubesWidget::DoWorkTemplate(TSpeedImage* speed_image, const itk::ImageBase<3>::RegionType& requested_region)
+itk::Image<unsigned char, 3>::Pointer TraceTubesWidget::Trace(image_type* speed_image, const region_type& requested_region, const std::vector<iseg::Point3D>& points, const Parameters& params, iseg::ProgressInfo* progress)
 {
-	using speed_image_type = TSpeedImage;
-	using input_type = itk::SliceContiguousImage<float>;
 	using output_type = itk::Image<unsigned char, 3>;
 
-	using path_filter_type = itk::WeightedDijkstraImageFilter<speed_image_type>;
-	using metric_type = itk::MyMetric<speed_image_type>;
+	using path_filter_type = itk::WeightedDijkstraImageFilter<image_type>;
 
-	iseg::SlicesHandlerITKInterface itk_handler(m_Handler);
-	auto target = itk_handler.GetTarget(true);
-
-	int pad = GetPadding();
-	double intensity_weight = m_IntensityWeight->text().toDouble();
-	double angle_weight = m_AngleWeight->text().toDouble();
 	double length_weight = 1;
 	double bone_length_penalty = 2;		// TODO
 	double artery_length_penalty = 2; // TODO
-	double line_radius = m_LineRadius->text().toDouble();
 
-	bool has_intensity = false;
-	double intensity_value = m_IntensityValue->text().toDouble(&has_intensity);
-	if (m_Metric->currentIndex() == kTarget)
+	bool has_intensity = params.m_HasIntensity;
+	double intensity_value = params.m_IntensityValue;
+	if (params.m_Metric == kTarget)
 	{
-		auto calculator = itk::MinimumMaximumImageCalculator<TSpeedImage>::New();
+		auto calculator = itk::MinimumMaximumImageCalculator<image_type>::New();
 		calculator->SetImage(speed_image);
 		calculator->SetRegion(requested_region);
 		calculator->ComputeMinimum();
@@ -563,22 +565,32 @@ void TraceTubesWidget::DoWorkTemplate(TSpeedImage* speed_image, const itk::Image
 		has_intensity = true;
 	}
 
-	std::vector<typename path_filter_type::PathType::VertexListPointer> paths;
+	if (progress)
+	{
+		progress->SetNumberOfSteps(static_cast<int>(points.size() - 1));
+	}
+
+	std::vector<path_filter_type::PathType::VertexListPointer> paths;
 
-	for (size_t k = 0; k + 1 < m_Points.size(); ++k)
+	for (size_t k = 0; k + 1 < points.size(); ++k)
 	{
-		auto a = m_Points[k];
-		auto b = m_Points[k + 1];
-		input_type::IndexType aidx = {a.px, a.py, a.pz};
-		input_type::IndexType bidx = {b.px, b.py, b.pz};
+		if (progress && progress->WasCanceled())
+		{
+			return nullptr;
+		}
 
-		input_type::RegionType region;
+		auto a = points[k];
+		auto b = points[k + 1];
+		image_type::IndexType aidx = {a.px, a.py, a.pz};
+		image_type::IndexType bidx = {b.px, b.py, b.pz};
+
+		image_type::RegionType region;
 		for (int i = 0; i < 3; i++)
 		{
 			region.SetIndex(i, std::min(aidx[i], bidx[i]));
 			region.SetSize(i, 1 + std::max(aidx[i], bidx[i]) - region.GetIndex(i));
 		}
-		region.PadByRadius(pad);
+		region.PadByRadius(params.m_Padding);
 		region.Crop(speed_image->GetLargestPossibleRegion());
 
 		auto dijkstra = path_filter_type::New();
@@ -586,8 +598,8 @@ void TraceTubesWidget::DoWorkTemplate(TSpeedImage* speed_image, const itk::Image
 		dijkstra->SetStartIndex(aidx);
 		dijkstra->SetEndIndex(bidx);
 		dijkstra->SetRegion(region);
-		dijkstra->Metric().m_IntensityWeight = intensity_weight;
-		dijkstra->Metric().m_AngleWeight = angle_weight;
+		dijkstra->Metric().m_IntensityWeight = params.m_IntensityWeight;
+		dijkstra->Metric().m_AngleWeight = params.m_AngleWeight;
 		dijkstra->Metric().m_LengthWeight = length_weight;
 		if (has_intensity)
 		{
@@ -600,6 +612,11 @@ void TraceTubesWidget::DoWorkTemplate(TSpeedImage* speed_image, const itk::Image
 		auto path = dijkstra->GetOutput(0);
 		auto verts = path->GetVertexList();
 		paths.push_back(verts);
+
+		if (progress)
+		{
+			progress->Increment();
+		}
 	}
 
 	// voxelize line
@@ -622,11 +639,10 @@ void TraceTubesWidget::DoWorkTemplate(TSpeedImage* speed_image, const itk::Image
 		}
 	}
 
-	if (line_radius > 0)
+	if (params.m_LineRadius > 0)
 	{
-		using real_type = itk::Image<float, 3>;
-		using distance_type = itk::DanielssonDistanceMapImageFilter<output_type, real_type>;
-		using threshold_type = itk::BinaryThresholdImageFilter<real_type, output_type>;
+		using distance_type = itk::DanielssonDistanceMapImageFilter<output_type, image_type>;
+		using threshold_type = itk::BinaryThresholdImageFilter<image_type, output_type>;
 
 		auto distance = distance_type::New();
 		distance->SetInput(image_with_path);
@@ -636,7 +652,7 @@ void TraceTubesWidget::DoWorkTemplate(TSpeedImage* speed_image, const itk::Image
 
 		auto threshold = threshold_type::New();
 		threshold->SetInput(distance->GetOutput());
-		threshold->SetUpperThreshold(line_radius * line_radius);
+		threshold->SetUpperThreshold(params.m_LineRadius * params.m_LineRadius);
 		threshold->SetInsideValue(255);
 		threshold->SetOutsideValue(0);
 		threshold->GetOutput()->SetRequestedRegion(requested_region);
@@ -645,10 +661,9 @@ void TraceTubesWidget::DoWorkTemplate(TSpeedImage* speed_image, const itk::Image
 		image_with_path = threshold->GetOutput();
 	}
 
-	if (!m_PathFileName->text().isEmpty() && m_Metric->currentIndex() == kTarget)
+	if (!params.m_PathFileName.empty() && params.m_Metric == kTarget)
 	{
-		auto fname = m_PathFileName->text().toStdString();
-		std::ofstream ofile(fname, std::ofstream::out);
+		std::ofstream ofile(params.m_PathFileName, std::ofstream::out);
 		if (ofile.is_open())
 		{
 			for (const auto& verts : paths)
@@ -656,7 +671,7 @@ void TraceTubesWidget::DoWorkTemplate(TSpeedImage* speed_image, const itk::Image
 				for (auto v : *verts)
 				{
 					itk::Point<double> p;
-					target->TransformContinuousIndexToPhysicalPoint(v, p);
+					speed_image->TransformContinuousIndexToPhysicalPoint(v, p);
 					ofile << p[0] << ", " << p[1] << ", " << p[2] << "\n";
 				}
 			}
@@ -664,12 +679,5 @@ void TraceTubesWidget::DoWorkTemplate(TSpeedImage* speed_image, const itk::Image
 		}
 	}
 
-	iseg::DataSelection data_selection;
-	data_selection.allSlices = true;
-	data_selection.work = true;
-	emit BeginDatachange(data_selection, this);
-
-	iseg::Paste<output_type, input_type>(image_with_path, target, requested_region);
-
-	emit EndDatachange(this);
+	return image_with_path;
 }
@@ -9,12 +9,16 @@
  */
 #pragma once
 
+#include "HessianEigenCache.h"
+
 #include "Data/SlicesHandlerInterface.h"
 
 #include "Interface/WidgetInterface.h"
 
 #include <itkImage.h>
 
+#include <memory>
+#include <string>
 #include <vector>
 
 class QCheckBox;
@@ -28,6 +32,8 @@ class ProcessObject;
 }
 
 namespace iseg {
+class ProgressInfo;
+
 struct Point3D
 {
 	union {
@@ -62,24 +68,52 @@ private:
 
 	int GetPadding() const;
 
+	/// Bounding box of the points, padded and cropped to the active slices
+	itk::ImageBase<3>::RegionType GetRegion(const itk::ImageBase<3>::RegionType& largest) const;
+
 	enum eMetric {
 		kIntensity = 0,
 		kHessian2D,
 		kHessian3D,
 		kTarget
 	};
-	itk::Image<float, 3>::Pointer ComputeVesselness(const itk::ImageBase<3>::RegionType& requested_region) const;
 
-	itk::Image<float, 3>::Pointer ComputeBlobiness(const itk::ImageBase<3>::RegionType& requested_region) const;
+	using image_type = itk::Image<float, 3>;
+	using region_type = itk::ImageBase<3>::RegionType;
+
+	struct Parameters
+	{
+		eMetric m_Metric;
+		double m_IntensityWeight;
+		double m_AngleWeight;
+		double m_LineRadius;
+		bool m_HasIntensity;
+		double m_IntensityValue;
+		int m_Padding;
+		double m_Sigma;
+		iseg::HessianEigenCache::ObjectnessParameters m_Objectness;
+		std::string m_DebugMetricFilePath;
+		std::string m_PathFileName;
+	};
+	Parameters GetParameters() const;
+
+	/// Blobiness (slice by slice) or vesselness (3D) of the source, depending on the metric
+	template<class TInput>
+	static image_type::Pointer ComputeObjectness(iseg::HessianEigenCache& cache, const TInput* source, const region_type& requested_region, const Parameters& params);
 
-	itk::Image<float, 3>::Pointer ComputeObjectSdf(const itk::ImageBase<3>::RegionType& requested_region) const;
+	static image_type::Pointer ComputeObjectSdf(const image_type* target, const region_type& requested_region);
 
-	template<class TSpeedImage>
-	void DoWorkTemplate(TSpeedImage* speed_image, const itk::ImageBase<3>::RegionType& requested_region);
+	/// Shortest paths through the points, voxelized in the requested region. Runs in a worker thread.
+	static itk::Image<unsigned char, 3>::Pointer Trace(image_type* speed_image, const region_type& requested_region, const std::vector<iseg::Point3D>& points, const Parameters& params, iseg::ProgressInfo* progress);
 
 	iseg::SlicesHandlerInterface* m_Handler;
 	std::vector<iseg::Point3D> m_Points;
 
+	// eigenvalues are reused when only the points or the objectness parameters change,
+	// shared with the running job
+	std::shared_ptr<iseg::HessianEigenCache> m_HessianCache;
+	int m_JobId = 0;
+
 	QWidget* m_MainOptions;
 	QComboBox* m_Metric;
 	QLineEdit* m_IntensityValue;
@@ -111,4 +145,5 @@ private slots:
 	void ClearPoints();
 	void EstimateIntensity();
 	void OnMetricChanged();
+	void JobFinished(int id, bool committed);
 };
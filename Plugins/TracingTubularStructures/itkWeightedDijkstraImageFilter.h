@@ -10,11 +10,15 @@
 
 #pragma once
 
-#include <itkConstNeighborhoodIterator.h>
+#include <itkImage.h>
 #include <itkImageToPathFilter.h>
-#include <itkNeighborhoodAlgorithm.h>
 #include <itkPolyLineParametricPath.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <list>
 #include <queue>
 #include <utility>
 #include <vector>
@@ -65,6 +69,19 @@ public:
 		return m_IntensityWeight * (iDifference + sIDifference) + m_LengthWeight * pLength + m_AngleWeight * pSmoothness;
 	}
 
+	/** Lower bound of the cost of any path from i to j, used as A* heuristic.
+		Each edge costs at least its length and, since |v - start| + |v - end| >= |start - end|,
+		the intensity difference between start and end. The angle term is non-negative.
+	*/
+	ValueType GetLowerBound(const typename ImageType::IndexType& i, const typename ImageType::IndexType& j) const
+	{
+		using bit64 = long long;
+		bit64 dir[] = {j[0] - (bit64)i[0], j[1] - (bit64)i[1], j[2] - (bit64)i[2]};
+		bit64 steps = std::max(std::abs(dir[0]), std::max(std::abs(dir[1]), std::abs(dir[2])));
+		auto pLength = ComputeLength(dir[0] * m_Spacing[0], dir[1] * m_Spacing[1], dir[2] * m_Spacing[2]);
+		return m_IntensityWeight * fabs(m_EndValue - m_StartValue) * steps + m_LengthWeight * pLength;
+	}
+
 	inline SpacingValueType ComputeLength(SpacingValueType x, SpacingValueType y, SpacingValueType z) const
 	{
 		return std::sqrt(x * x + y * y + z * z);
@@ -115,6 +132,12 @@ public:
 		return m_Metric;
 	}
 
+	/// Number of vertices expanded by the last search
+	size_t GetNumberOfExpandedVertices() const
+	{
+		return m_NumberOfExpandedVertices;
+	}
+
 protected:
 	WeightedDijkstraImageFilter();
 	~WeightedDijkstraImageFilter() override {}
@@ -127,6 +150,7 @@ private:
 	TMetric m_Metric;
 	IndexType m_StartIndex, m_EndIndex;
 	RegionType m_Region;
+	size_t m_NumberOfExpandedVertices = 0;
 };
 
 } // end of namespace itk
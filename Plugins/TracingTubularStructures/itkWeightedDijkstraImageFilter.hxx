@@ -36,56 +36,68 @@ template<typename TInputImageType, typename TMetric>
 void WeightedDijkstraImageFilter<TInputImageType, TMetric>::
 		GenerateData()
 {
-	using neighborhood_iterator_type = ConstNeighborhoodIterator<ImageType>;
-
 	using vertex_t = IndexType;
+	using id_t = std::uint32_t;
 	using weight_t = float;
-	using weight_vertex_pair_t = std::pair<weight_t, vertex_t>;
+	using weight_vertex_pair_t = std::pair<weight_t, id_t>;
 
 	typename ImageType::ConstPointer image = this->GetInput();
 	m_Metric.Initialize(image, m_StartIndex, m_EndIndex);
 
-	using offset_table_t = typename ImageType::RegionType::OffsetTableType;
-	offset_table_t offset_table;
-	m_Region.ComputeOffsetTable(offset_table);
-
-	auto ijk2index = [&](const typename ImageType::IndexType& ijk) {
-		typename ImageType::OffsetValueType offset = 0;
-		ImageHelper<3, 3>::ComputeOffset(m_Region.GetIndex(), ijk, offset_table, offset);
-		return offset;
-	};
-
-	size_t source = ijk2index(m_StartIndex);
-	size_t target = ijk2index(m_EndIndex);
-	size_t N = m_Region.GetNumberOfPixels();
+	static const id_t kInvalid = std::numeric_limits<id_t>::max();
+	static const weight_t kInfinity = std::numeric_limits<weight_t>::max();
 
-	auto dummy_img = ImageType::New();
-	dummy_img->SetLargestPossibleRegion(image->GetLargestPossibleRegion());
-	dummy_img->SetBufferedRegion(m_Region);
+	auto const region_index = m_Region.GetIndex();
+	std::int64_t const nx = m_Region.GetSize(0), ny = m_Region.GetSize(1), nz = m_Region.GetSize(2);
+	std::int64_t const N = nx * ny * nz;
+	if (N >= kInvalid)
+	{
+		itkExceptionMacro("Region is too large: " << m_Region);
+	}
 
-	typename neighborhood_iterator_type::RadiusType radius;
-	radius.Fill(1);
-	neighborhood_iterator_type nit(radius, dummy_img, m_Region);
+	auto ijk2index = [&](const vertex_t& ijk) {
+		return static_cast<id_t>((ijk[0] - region_index[0]) + nx * ((ijk[1] - region_index[1]) + ny * (ijk[2] - region_index[2])));
+	};
+	auto index2ijk = [&](id_t id) {
+		vertex_t ijk;
+		ijk[0] = region_index[0] + id % nx;
+		ijk[1] = region_index[1] + (id / nx) % ny;
+		ijk[2] = region_index[2] + id / (nx * ny);
+		return ijk;
+	};
 
-	std::vector<bool> is_boundary(N, false);
-	NeighborhoodAlgorithm::ImageBoundaryFacesCalculator<ImageType> face_calculator;
-	auto faces = face_calculator(dummy_img.GetPointer(), m_Region, radius);
-	if (!faces.empty())
-		faces.erase(faces.begin());
-	for (auto face_region : faces)
+	// 26-neighborhood as offsets in the region
+	struct Neighbor
 	{
-		ImageRegionConstIterator<ImageType> it(image, face_region);
-		for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+		int d[3];
+		std::int64_t offset;
+	};
+	std::vector<Neighbor> neighbors;
+	for (int dz = -1; dz <= 1; ++dz)
+	{
+		for (int dy = -1; dy <= 1; ++dy)
 		{
-			is_boundary.at(ijk2index(it.GetIndex())) = true;
+			for (int dx = -1; dx <= 1; ++dx)
+			{
+				if (dx != 0 || dy != 0 || dz != 0)
+				{
+					neighbors.push_back({{dx, dy, dz}, dx + nx * (dy + ny * dz)});
+				}
+			}
 		}
 	}
 
-	std::vector<weight_t> min_distance(N, std::numeric_limits<weight_t>::max());
-	static const vertex_t kInvalidIndex = {-1, -1, -1};
-	std::vector<vertex_t> previous(N, kInvalidIndex);
+	// per-vertex state of the search
+	std::vector<weight_t> min_distance(N, kInfinity);
+	std::vector<id_t> previous(N, kInvalid);
+	std::vector<unsigned char> closed(N, 0);
 
-	min_distance[source] = 0;
+	// A* with the lower bound of the remaining cost as potential. The bound is consistent, so a
+	// vertex has its final distance when it is expanded, as in Dijkstra's algorithm.
+	// A backward search cannot be used, since the cost of an edge depends on the previous vertex.
+	auto potential = [&](const vertex_t& v) -> weight_t {
+		return m_Metric.GetLowerBound(v, m_EndIndex);
+	};
 
 	// we use greater instead of less to turn max-heap into min-heap
 	struct Greater
@@ -98,53 +110,63 @@ void WeightedDijkstraImageFilter<TInputImageType, TMetric>::
 	std::priority_queue<weight_vertex_pair_t,
 			std::vector<weight_vertex_pair_t>, Greater>
 			vertex_queue;
-	vertex_queue.push(std::make_pair(min_distance[source], m_StartIndex));
 
-	while (!vertex_queue.empty())
-	{
-		weight_t dist = vertex_queue.top().first;
-		vertex_t u = vertex_queue.top().second;
-		size_t uid = ijk2index(u);
-		if (uid == target)
-			break;
+	id_t const start = ijk2index(m_StartIndex);
+	id_t const end = ijk2index(m_EndIndex);
+	min_distance[start] = 0;
+	vertex_queue.push(std::make_pair(potential(m_StartIndex), start));
 
-		vertex_t uprev = (uid == source) ? m_StartIndex : previous[uid];
+	m_NumberOfExpandedVertices = 0;
+	while (!vertex_queue.empty() && closed[end] == 0)
+	{
+		id_t uid = vertex_queue.top().second;
 		vertex_queue.pop();
 
 		// Because we leave old copies of the vertex in the priority queue
 		// (with outdated higher distances), we need to ignore it when we come
-		// across it again, by checking its distance against the minimum distance
-		if (dist > min_distance[uid])
+		// across it again
+		if (closed[uid])
 			continue;
+		closed[uid] = 1;
+		++m_NumberOfExpandedVertices;
 
-		// Visit each edge exiting u
-		nit.SetLocation(u);
+		vertex_t u = index2ijk(uid);
+		vertex_t uprev = (previous[uid] == kInvalid) ? u : index2ijk(previous[uid]);
+		weight_t dist = min_distance[uid];
+		std::int64_t const uijk[3] = {u[0] - region_index[0], u[1] - region_index[1], u[2] - region_index[2]};
+		std::int64_t const size[3] = {nx, ny, nz};
 
-		for (unsigned int i = 0; i < nit.Size(); i++)
+		// Visit each edge exiting u
+		for (const auto& n : neighbors)
 		{
-			if (is_boundary[uid] && !nit.IndexInBounds(i))
+			if (uijk[0] + n.d[0] < 0 || uijk[0] + n.d[0] >= size[0] ||
+					uijk[1] + n.d[1] < 0 || uijk[1] + n.d[1] >= size[1] ||
+					uijk[2] + n.d[2] < 0 || uijk[2] + n.d[2] >= size[2])
 				continue;
 
-			vertex_t v = nit.GetIndex(i);
-			size_t vid = ijk2index(v);
+			id_t vid = static_cast<id_t>(uid + n.offset);
+			if (closed[vid])
+				continue;
 
-			weight_t weight = m_Metric.GetEdgeWeight(u, v, uprev);
-			weight_t distance_through_u = dist + weight;
+			vertex_t v = {u[0] + n.d[0], u[1] + n.d[1], u[2] + n.d[2]};
+			weight_t distance_through_u = dist + m_Metric.GetEdgeWeight(u, v, uprev);
 
 			if (distance_through_u < min_distance[vid])
 			{
 				min_distance[vid] = distance_through_u;
-				previous[vid] = u;
-				vertex_queue.push(std::make_pair(min_distance[vid], v));
+				previous[vid] = uid;
+				vertex_queue.push(std::make_pair(distance_through_u + potential(v), vid));
 			}
 		}
 	}
+
 	std::list<vertex_t> path;
-	for (vertex_t vertex = m_EndIndex; vertex != kInvalidIndex;)
+	if (closed[end] != 0)
 	{
-		path.push_front(vertex);
-		auto index = ijk2index(vertex);
-		vertex = previous[index];
+		for (id_t id = end; id != kInvalid; id = previous[id])
+		{
+			path.push_front(index2ijk(id));
+		}
 	}
 
 	PathType::Pointer output = this->GetOutput(0);
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../HessianEigenCache.h"
+
+#include <itkHessianRecursiveGaussianImageFilter.h>
+#include <itkHessianToObjectnessMeasureImageFilter.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkSliceBySliceImageFilter.h>
+
+namespace iseg {
+
+namespace {
+using image_type = itk::Image<float, 3>;
+
+// dark tube along the diagonal of the xz-plane on a bright background
+image_type::Pointer make_tube_image()
+{
+	auto img = image_type::New();
+	itk::Size<3> size = {32, 24, 20};
+	img->SetRegions(size);
+	image_type::SpacingType spacing;
+	spacing[0] = 1.0;
+	spacing[1] = 1.0;
+	spacing[2] = 1.5;
+	img->SetSpacing(spacing);
+	img->Allocate();
+
+	itk::ImageRegionIteratorWithIndex<image_type> it(img, img->GetLargestPossibleRegion());
+	for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+	{
+		auto const idx = it.GetIndex();
+		double const dy = idx[1] - 12.0;
+		double const dxz = (idx[0] - 1.5 * idx[2]) / std::sqrt(2.0);
+		it.Set(static_cast<float>(100.0 - 80.0 * std::exp(-(dy * dy + dxz * dxz) / 8.0)));
+	}
+	return img;
+}
+
+// maximum difference relative to the maximum of the reference image
+double max_difference(const image_type* a, const image_type* reference, const image_type::RegionType& region)
+{
+	double diff = 0.0, max_value = 0.0;
+	itk::ImageRegionConstIterator<image_type> ia(a, region), ib(reference, region);
+	for (ia.GoToBegin(), ib.GoToBegin(); !ia.IsAtEnd(); ++ia, ++ib)
+	{
+		diff = std::max(diff, std::abs(static_cast<double>(ia.Get()) - ib.Get()));
+		max_value = std::max(max_value, std::abs(static_cast<double>(ib.Get())));
+	}
+	return diff / std::max(max_value, 1e-12);
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(TraceTubesWidget_suite);
+
+// TestRunner.exe --run_test=iSeg_suite/TraceTubesWidget_suite/HessianEigenvalues_test --log_level=message
+BOOST_AUTO_TEST_CASE(HessianEigenvalues_test)
+{
+	{
+		double const a[6] = {3.0, 0.0, 0.0, -1.0, 0.0, 2.0};
+		double eig[3];
+		HessianEigenCache::SymmetricEigenvalues(a, eig);
+		BOOST_CHECK_CLOSE(eig[0], -1.0, 1e-6);
+		BOOST_CHECK_CLOSE(eig[1], 2.0, 1e-6);
+		BOOST_CHECK_CLOSE(eig[2], 3.0, 1e-6);
+	}
+	{
+		// eigenvalues 1, 1, 4
+		double const a[6] = {2.0, 1.0, 1.0, 2.0, 1.0, 2.0};
+		double eig[3];
+		HessianEigenCache::SymmetricEigenvalues(a, eig);
+		BOOST_CHECK_CLOSE(eig[0], 1.0, 1e-6);
+		BOOST_CHECK_CLOSE(eig[1], 1.0, 1e-6);
+		BOOST_CHECK_CLOSE(eig[2], 4.0, 1e-6);
+	}
+	{
+		double const a[3] = {1.0, 2.0, -3.0};
+		double eig[2];
+		HessianEigenCache::SymmetricEigenvalues2(a, eig);
+		BOOST_CHECK_CLOSE(eig[0], -1.0 + std::sqrt(8.0), 1e-6);
+		BOOST_CHECK_CLOSE(eig[1], -1.0 - std::sqrt(8.0), 1e-6);
+	}
+}
+
+// TestRunner.exe --run_test=iSeg_suite/TraceTubesWidget_suite/HessianObjectness_test --log_level=message
+BOOST_AUTO_TEST_CASE(HessianObjectness_test)
+{
+	using hessian_image_type = itk::Image<itk::SymmetricSecondRankTensor<double, 3>, 3>;
+	using objectness_filter_type = itk::HessianToObjectnessMeasureImageFilter<hessian_image_type, image_type>;
+
+	auto img = make_tube_image();
+
+	image_type::RegionType region;
+	region.SetIndex({4, 3, 2});
+	region.SetSize({20, 18, 12});
+
+	HessianEigenCache cache;
+	HessianEigenCache::ObjectnessParameters params;
+	params.m_Alpha = 0.5;
+	params.m_Beta = 0.5;
+	params.m_Gamma = 5.0;
+	params.m_ObjectDimension = 1;
+	BOOST_CHECK(cache.Update(img.GetPointer(), region, std::vector<double>(1, 1.5), HessianEigenCache::kVolume));
+	auto objectness = cache.Objectness(region, params);
+	BOOST_REQUIRE(objectness);
+	BOOST_CHECK(objectness->GetBufferedRegion() == region);
+
+	auto hessian = itk::HessianRecursiveGaussianImageFilter<image_type>::New();
+	hessian->SetInput(img);
+	hessian->SetSigma(1.5);
+
+	auto reference = objectness_filter_type::New();
+	reference->SetInput(hessian->GetOutput());
+	reference->SetBrightObject(false);
+	reference->SetObjectDimension(1);
+	reference->SetScaleObjectnessMeasure(true);
+	reference->SetAlpha(0.5);
+	reference->SetBeta(0.5);
+	reference->SetGamma(5.0);
+	reference->Update();
+
+	BOOST_CHECK_SMALL(max_difference(objectness, reference->GetOutput(), region), 1e-2);
+
+	// changing the objectness parameters reuses the eigenvalues
+	params.m_Alpha = 0.2;
+	BOOST_CHECK(!cache.Update(img.GetPointer(), region, std::vector<double>(1, 1.5), HessianEigenCache::kVolume));
+	reference->SetAlpha(0.2);
+	reference->Update();
+	BOOST_CHECK_SMALL(max_difference(cache.Objectness(region, params), reference->GetOutput(), region), 1e-2);
+}
+
+// TestRunner.exe --run_test=iSeg_suite/TraceTubesWidget_suite/HessianBlobiness_test --log_level=message
+BOOST_AUTO_TEST_CASE(HessianBlobiness_test)
+{
+	using slice_type = itk::Image<float, 2>;
+	using hessian_filter_type = itk::HessianRecursiveGaussianImageFilter<slice_type>;
+	using hessian_image_type = itk::Image<itk::SymmetricSecondRankTensor<double, 2>, 2>;
+	using objectness_filter_type = itk::HessianToObjectnessMeasureImageFilter<hessian_image_type, slice_type>;
+	using slice_by_slice_filter_type = itk::SliceBySliceImageFilter<image_type, image_type, hessian_filter_type, objectness_filter_type>;
+
+	auto img = make_tube_image();
+
+	image_type::RegionType region;
+	region.SetIndex({2, 2, 5});
+	region.SetSize({24, 20, 10});
+
+	HessianEigenCache cache;
+	HessianEigenCache::ObjectnessParameters params;
+	params.m_ObjectDimension = 0;
+	cache.Update(img.GetPointer(), region, std::vector<double>(1, 1.0), HessianEigenCache::kSliceBySlice);
+	auto objectness = cache.Objectness(region, params);
+	BOOST_REQUIRE(objectness);
+
+	auto hessian = hessian_filter_type::New();
+	hessian->SetSigma(1.0);
+
+	auto objectness_filter = objectness_filter_type::New();
+	objectness_filter->SetInput(hessian->GetOutput());
+	objectness_filter->SetBrightObject(false);
+	objectness_filter->SetObjectDimension(0);
+	objectness_filter->SetScaleObjectnessMeasure(true);
+	objectness_filter->SetAlpha(params.m_Alpha);
+	objectness_filter->SetBeta(params.m_Beta);
+	objectness_filter->SetGamma(params.m_Gamma);
+
+	auto reference = slice_by_slice_filter_type::New();
+	reference->SetInput(img);
+	reference->SetInputFilter(hessian);
+	reference->SetOutputFilter(objectness_filter);
+	reference->Update();
+
+	BOOST_CHECK_SMALL(max_difference(objectness, reference->GetOutput(), region), 1e-2);
+}
+
+// TestRunner.exe --run_test=iSeg_suite/TraceTubesWidget_suite/HessianCacheReuse_test --log_level=message
+BOOST_AUTO_TEST_CASE(HessianCacheReuse_test)
+{
+	auto img = make_tube_image();
+	auto const sigmas = HessianEigenCache::Sigmas(1.0, 2.0, 3);
+	BOOST_REQUIRE_EQUAL(sigmas.size(), 3);
+	BOOST_CHECK_CLOSE(sigmas[1], 1.5, 1e-6);
+
+	image_type::RegionType region;
+	region.SetIndex({4, 4, 4});
+	region.SetSize({16, 16, 10});
+
+	HessianEigenCache cache(2);
+	BOOST_CHECK(cache.Update(img.GetPointer(), region, sigmas, HessianEigenCache::kVolume));
+	auto const version = cache.Version();
+
+	// sub-region (e.g. new path end-points within the region) is reused
+	image_type::RegionType sub_region;
+	sub_region.SetIndex({6, 5, 6});
+	sub_region.SetSize({8, 8, 4});
+	BOOST_CHECK(!cache.Update(img.GetPointer(), sub_region, sigmas, HessianEigenCache::kVolume));
+	BOOST_CHECK_EQUAL(cache.Version(), version);
+
+	// different scales or mode are separate entries
+	BOOST_CHECK(cache.Update(img.GetPointer(), region, sigmas, HessianEigenCache::kSliceBySlice));
+	BOOST_CHECK_EQUAL(cache.NumberOfEntries(), 2);
+	BOOST_CHECK(!cache.Update(img.GetPointer(), region, sigmas, HessianEigenCache::kVolume));
+	BOOST_CHECK_EQUAL(cache.Version(), version);
+
+	// modified source invalidates the entry
+	img->GetPixel({10, 10, 8}) += 1.f;
+	BOOST_CHECK(cache.Update(img.GetPointer(), region, sigmas, HessianEigenCache::kVolume));
+	BOOST_CHECK_NE(cache.Version(), version);
+	BOOST_CHECK_EQUAL(cache.NumberOfEntries(), 2);
+
+	cache.Clear();
+	BOOST_CHECK_EQUAL(cache.NumberOfEntries(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+
+} // namespace iseg
@@ -11,8 +11,57 @@
 
 #include "../itkWeightedDijkstraImageFilter.h"
 
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <random>
+
 namespace iseg {
 
+namespace {
+/// Metric without lower bound, i.e. the path filter runs plain Dijkstra
+template<typename ImageType>
+class NoLowerBoundMetric : public itk::MyMetric<ImageType>
+{
+public:
+	typename ImageType::PixelType GetLowerBound(const typename ImageType::IndexType&, const typename ImageType::IndexType&) const
+	{
+		return 0;
+	}
+};
+
+template<typename TFilter, typename TImage>
+double PathCost(TFilter* filter, const TImage* img, const typename TImage::IndexType& start, const typename TImage::IndexType& end, size_t& expanded)
+{
+	filter->SetInput(img);
+	filter->SetStartIndex(start);
+	filter->SetEndIndex(end);
+	filter->SetRegion(img->GetLargestPossibleRegion());
+	filter->Metric().m_AngleWeight = 0.5f;
+	filter->Update();
+	expanded = filter->GetNumberOfExpandedVertices();
+
+	// sum of the edge weights, the first edge has no previous vertex
+	auto verts = filter->GetOutput(0)->GetVertexList();
+	std::vector<typename TImage::IndexType> path;
+	for (unsigned int k = 0; k < verts->Size(); ++k)
+	{
+		auto const& p = verts->ElementAt(k);
+		typename TImage::IndexType idx = {{static_cast<itk::IndexValueType>(p[0]), static_cast<itk::IndexValueType>(p[1]), static_cast<itk::IndexValueType>(p[2])}};
+		path.push_back(idx);
+	}
+	BOOST_REQUIRE_GE(path.size(), 2);
+	BOOST_CHECK(path.front() == start);
+	BOOST_CHECK(path.back() == end);
+
+	double cost = 0;
+	for (size_t k = 1; k < path.size(); ++k)
+	{
+		cost += filter->Metric().GetEdgeWeight(path[k - 1], path[k], path[k > 1 ? k - 2 : 0]);
+	}
+	return cost;
+}
+} // namespace
+
 BOOST_AUTO_TEST_SUITE(iSeg_suite);
 BOOST_AUTO_TEST_SUITE(TraceTubesWidget_suite);
 
@@ -80,7 +129,95 @@ BOOST_AUTO_TEST_CASE(DijkstraMetric_test)
 		m.Initialize(img, iprev, j);
 
 		BOOST_CHECK_CLOSE(3 * 0 + 1.0 + 0.0, m.GetEdgeWeight(i, j, iprev), 1e-3);
+		BOOST_CHECK_LE(m.GetLowerBound(i, j), m.GetEdgeWeight(i, j, iprev));
+		BOOST_CHECK_CLOSE(2.0, m.GetLowerBound(iprev, j), 1e-3);
+	}
+}
+
+// TestRunner.exe --run_test=iSeg_suite/TraceTubesWidget_suite/DijkstraPath_test --log_level=message
+BOOST_AUTO_TEST_CASE(DijkstraPath_test)
+{
+	using image_type = itk::Image<float, 3>;
+	using path_filter_type = itk::WeightedDijkstraImageFilter<image_type>;
+
+	// dark tube along a sine curve
+	auto img = image_type::New();
+	itk::Size<3> size = {40, 30, 10};
+	img->SetRegions(size);
+	img->Allocate();
+	itk::ImageRegionIteratorWithIndex<image_type> it(img, img->GetLargestPossibleRegion());
+	for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+	{
+		auto const idx = it.GetIndex();
+		double const dy = idx[1] - 15.0 - 8.0 * std::sin(idx[0] / 6.0);
+		double const dz = idx[2] - 5.0;
+		it.Set(dy * dy + dz * dz < 4.0 ? 10.f : 100.f);
+	}
+
+	image_type::IndexType start = {1, 15 + static_cast<long>(std::round(8.0 * std::sin(1.0 / 6.0))), 5};
+	image_type::IndexType end = {38, 15 + static_cast<long>(std::round(8.0 * std::sin(38.0 / 6.0))), 5};
+
+	{
+		auto dijkstra = path_filter_type::New();
+		dijkstra->SetInput(img);
+		dijkstra->SetStartIndex(start);
+		dijkstra->SetEndIndex(end);
+		dijkstra->SetRegion(img->GetLargestPossibleRegion());
+		dijkstra->Update();
+
+		auto verts = dijkstra->GetOutput(0)->GetVertexList();
+		BOOST_REQUIRE_GE(verts->Size(), 2);
+		BOOST_CHECK_EQUAL(verts->ElementAt(0)[0], start[0]);
+		BOOST_CHECK_EQUAL(verts->ElementAt(verts->Size() - 1)[0], end[0]);
+		BOOST_CHECK_EQUAL(verts->ElementAt(verts->Size() - 1)[1], end[1]);
+
+		// path is connected and stays in the tube
+		for (unsigned int k = 1; k < verts->Size(); ++k)
+		{
+			auto const a = verts->ElementAt(k - 1), b = verts->ElementAt(k);
+			BOOST_CHECK_LE(std::abs(a[0] - b[0]) + std::abs(a[1] - b[1]) + std::abs(a[2] - b[2]), 3.0);
+
+			image_type::IndexType idx = {static_cast<long>(b[0]), static_cast<long>(b[1]), static_cast<long>(b[2])};
+			BOOST_CHECK_EQUAL(img->GetPixel(idx), 10.f);
+		}
+
+		// A* does not need to expand the whole region
+		BOOST_CHECK_LT(dijkstra->GetNumberOfExpandedVertices(), img->GetLargestPossibleRegion().GetNumberOfPixels());
+	}
+}
+
+// TestRunner.exe --run_test=iSeg_suite/TraceTubesWidget_suite/DijkstraCost_test --log_level=message
+BOOST_AUTO_TEST_CASE(DijkstraCost_test)
+{
+	using image_type = itk::Image<float, 3>;
+
+	// noisy image with a bright blob between the end points, so the shortest path is not straight
+	auto img = image_type::New();
+	itk::Size<3> size = {32, 24, 12};
+	img->SetRegions(size);
+	img->Allocate();
+	std::mt19937 gen(11);
+	std::uniform_real_distribution<float> noise(0.f, 20.f);
+	itk::ImageRegionIteratorWithIndex<image_type> it(img, img->GetLargestPossibleRegion());
+	for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+	{
+		auto const idx = it.GetIndex();
+		double const dx = idx[0] - 16.0, dy = idx[1] - 12.0, dz = idx[2] - 6.0;
+		it.Set(noise(gen) + (dx * dx + dy * dy + dz * dz < 36.0 ? 200.f : 0.f));
 	}
+
+	image_type::IndexType start = {2, 12, 6};
+	image_type::IndexType end = {29, 13, 5};
+
+	size_t astar_expanded = 0, dijkstra_expanded = 0;
+	auto astar = itk::WeightedDijkstraImageFilter<image_type>::New();
+	double const astar_cost = PathCost(astar.GetPointer(), img.GetPointer(), start, end, astar_expanded);
+
+	auto dijkstra = itk::WeightedDijkstraImageFilter<image_type, NoLowerBoundMetric<image_type>>::New();
+	double const dijkstra_cost = PathCost(dijkstra.GetPointer(), img.GetPointer(), start, end, dijkstra_expanded);
+
+	BOOST_CHECK_CLOSE(astar_cost, dijkstra_cost, 1e-3);
+	BOOST_CHECK_LE(astar_expanded, dijkstra_expanded);
 }
 
 BOOST_AUTO_TEST_SUITE_END();
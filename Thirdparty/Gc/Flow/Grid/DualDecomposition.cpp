@@ -0,0 +1,652 @@
+/*
+    This file is part of Graph Cut (Gc) combinatorial optimization library.
+    Copyright (C) 2008-2010 Centre for Biomedical Image Analysis (CBIA)
+    Copyright (C) 2008-2010 Ondrej Danek
+
+    This library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Graph Cut library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+    @file
+    Parallel maximum flow algorithm for grid graphs based on dual decomposition.
+*/
+
+#include "../../Math/Basic.h"
+#include "../../System/ArgumentException.h"
+#include "../../System/Collection/BoolArrayMask.h"
+#include "../../System/Format.h"
+#include "../../System/IndexOutOfRangeException.h"
+#include "../../System/InvalidOperationException.h"
+#include "../../System/NotImplementedException.h"
+#include "DualDecomposition.h"
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+
+namespace Gc {
+namespace Flow {
+namespace Grid {
+/***********************************************************************************/
+
+template <Size N, class TFLOW, class TTCAP, class TCAP, bool MASK>
+DualDecomposition<N, TFLOW, TTCAP, TCAP, MASK>::DualDecomposition(Size blocks, Size max_iter)
+    : m_req_blocks(blocks)
+    , m_max_iter(Math::Max(max_iter, Size(1)))
+    , m_slice(0)
+    , m_overlap(0)
+    , m_flow_shift(0)
+    , m_step(0)
+    , m_cap_sum(0)
+    , m_cap_count(0)
+    , m_iter(0)
+    , m_merged_flow(0)
+    , m_merged_correction(0)
+    , m_stage(0)
+{}
+
+/***********************************************************************************/
+
+template <Size N, class TFLOW, class TTCAP, class TCAP, bool MASK>
+void DualDecomposition<N, TFLOW, TTCAP, TCAP, MASK>::Init(const Math::Algebra::Vector<N, Size> & dim,
+                                                          const Energy::Neighbourhood<N, Int32> & nb)
+{
+    InitBlocks(dim, nb, nullptr);
+}
+
+/***********************************************************************************/
+
+template <Size N, class TFLOW, class TTCAP, class TCAP, bool MASK>
+void DualDecomposition<N, TFLOW, TTCAP, TCAP, MASK>::InitMask(const Math::Algebra::Vector<N, Size> & dim,
+                                                              const Energy::Neighbourhood<N, Int32> & nb,
+                                                              const System::Collection::IArrayMask<N> & mask)
+{
+    if (!MASK)
+    {
+        throw System::InvalidOperationException(__FUNCTION__, __LINE__, "This algorithm "
+                                                                        "does not support mask specification.");
+    }
+
+    InitBlocks(dim, nb, &mask);
+}
+
+/***********************************************************************************/
+
+template <Size N, class TFLOW, class TTCAP, class TCAP, bool MASK>
+void DualDecomposition<N, TFLOW, TTCAP, TCAP, MASK>::InitBlocks(const Math::Algebra::Vector<N, Size> & dim,
+                                                                const Energy::Neighbourhood<N, Int32> & nb,
+                                                                const System::Collection::IArrayMask<N> * mask)
+{
+    if (!dim.Product() || nb.IsEmpty())
+    {
+        throw System::ArgumentException(__FUNCTION__, __LINE__, "Empty graph.");
+    }
+
+    Dispose();
+
+    m_dim = dim;
+    m_nb = nb;
+    m_slice = dim.Product() / dim[N - 1];
+
+    Math::Algebra::Vector<N, Size> bleft, bright;
+    nb.Extent(bleft, bright);
+    m_overlap = Math::Max(bleft[N - 1], bright[N - 1]);
+
+    // Blocks must be thicker than the overlap, so that an arc is never shared by more than two
+    // blocks, and thick enough that solving them separately pays off
+    Size blocks = m_req_blocks ? m_req_blocks : Size(std::thread::hardware_concurrency());
+    blocks = Math::Min(blocks, dim[N - 1] / Math::Max(2 * m_overlap, Size(8)));
+    blocks = Math::Max(blocks, Size(1));
+
+    m_first.resize(blocks + 1);
+    for (Size k = 0; k <= blocks; k++)
+    {
+        m_first[k] = k * dim[N - 1] / blocks;
+    }
+
+    m_slice_block.resize(dim[N - 1]);
+    for (Size k = 0; k < blocks; k++)
+    {
+        std::fill(m_slice_block.begin() + m_first[k], m_slice_block.begin() + m_first[k + 1], k);
+    }
+
+    if (mask)
+    {
+        m_mask.Resize(dim);
+        m_fw_idx.reserve(mask->UnmaskedElements());
+        for (Size i = 0; i < mask->Elements(); i++)
+        {
+            m_mask[i] = mask->IsMasked(i);
+            if (!m_mask[i])
+            {
+                m_fw_idx.push_back(i);
+            }
+        }
+    }
+
+    m_blocks.resize(blocks);
+    m_bw_idx.resize(mask ? blocks : 0);
+    for (Size k = 0; k < blocks; k++)
+    {
+        Size last = (k + 1 < blocks) ? m_first[k + 1] + m_overlap : dim[N - 1];
+        Math::Algebra::Vector<N, Size> bdim = dim;
+        bdim[N - 1] = last - m_first[k];
+
+        if (mask)
+        {
+            System::Collection::Array<N, bool> bmask(bdim);
+            const bool * src = m_mask.Begin() + m_first[k] * m_slice;
+            std::copy(src, src + bmask.Elements(), bmask.Begin());
+
+            System::Collection::BoolArrayMask<N> bool_mask(bmask, true);
+            if (!bool_mask.UnmaskedElements())
+            {
+                // No nodes, the block is not needed
+                continue;
+            }
+
+            m_blocks[k].reset(new BlockType);
+            m_blocks[k]->InitMask(bdim, nb, bool_mask);
+            m_bw_idx[k] = bool_mask.BackwardIndexes();
+        }
+        else
+        {
+            m_blocks[k].reset(new BlockType);
+            m_blocks[k]->Init(bdim, nb);
+        }
+    }
+
+    m_dirty.assign(blocks, true);
+    m_flows.assign(blocks, TFLOW(0));
+    m_lambda.assign((blocks - 1) * m_overlap * m_slice, TTCAP(0));
+    m_tr_cap.assign(m_lambda.size(), TTCAP(0));
+    m_snk_cap.assign(m_lambda.size(), TTCAP(0));
+    m_flow_shift = 0;
+    m_cap_sum = 0;
+    m_cap_count = 0;
+    m_iter = 0;
+    m_stage = 1;
+}
+
+/***********************************************************************************/
+
+template <Size N, class TFLOW, class TTCAP, class TCAP, bool MASK>
+Size DualDecomposition<N, TFLOW, TTCAP, TCAP, MASK>::SliceBlocks(Size z, Size (&blocks)[2]) const
+{
+    Size k = m_slice_block[z];
+
+    if (k > 0 && z < m_first[k] + m_overlap)
+    {
+        blocks[0] = k - 1;
+        blocks[1] = k;
+        return 2;
+    }
+
+    blocks[0] = k;
+    return 1;
+}
+
+/***********************************************************************************/
+
+template <Size N, class TFLOW, class TTCAP, class TCAP, bool MASK>
+Size DualDecomposition<N, TFLOW, TTCAP, TCAP, MASK>::BlockNode(Size block, Size grid_idx) const
+{
+    Size local = grid_idx - m_first[block] * m_slice;
+    return MASK ? m_bw_idx[block][local] : local;
+}
+
+/***********************************************************************************/
+
+template <Size N, class TFLOW, class TTCAP, class TCAP, bool MASK>
+void DualDecomposition<N, TFLOW, TTCAP, TCAP, MASK>::SetArcCap(Size node, Size arc, TCAP cap)
+{
+    if (m_stage < 1)
+    {
+        throw System::InvalidOperationException(__FUNCTION__, __LINE__,
+                                                "Call Init method before adding arcs.");
+    }
+
+    if (m_stage > 1)
+    {
+        throw System::NotImplementedException(__FUNCTION__, __LINE__,
+                                              "Arc capacity update support not yet implemented!");
+    }
+
+    if (cap < 0)
+    {
+        throw System::ArgumentException(__FUNCTION__, __LINE__,
+                                        "Arcs with negative capacity are not supported.");
+    }
+
+    Size nodes = MASK ? m_fw_idx.size() : m_dim.Product();
+    if (node >= nodes || arc >= m_nb.Elements())
+    {
+        throw System::IndexOutOfRangeException(__FUNCTION__, __LINE__,
+                                               System::Format("Invalid node or arc index. Nodes={0}, node={1}, arc={2}.")
+                                                   << nodes << node << arc);
+    }
+
+    Size grid_idx = GridIndex(node);
+    Size z = grid_idx / m_slice;
+    Int32 ofs = m_nb[arc][N - 1];
+    if ((ofs < 0 && z < Size(-ofs)) || (ofs > 0 && z + ofs >= m_dim[N - 1]))
+    {
+        // Arc leaving the grid
+        return;
+    }
+
+    // Blocks containing both end points of the arc
+    Size blocks[2], nblocks[2], shared[2], count = 0;
+    Size bc = SliceBlocks(z, blocks);
+    Size nbc = SliceBlocks(Size(Int32(z) + ofs), nblocks);
+    for (Size i = 0; i < bc; i++)
+    {
+        if (std::find(nblocks, nblocks + nbc, blocks[i]) != nblocks + nbc)
+        {
+            shared[count++] = blocks[i];
+        }
+    }
+
+    if (cap > 0)
+    {
+        m_cap_sum += double(cap);
+        m_cap_count++;
+    }
+
+    if (count == 1)
+    {
+        m_blocks[shared[0]]->SetArcCap(BlockNode(shared[0], grid_idx), arc, cap);
+    }
+    else if (count == 2)
+    {
+        TCAP half = cap / 2;
+        m_blocks[shared[0]]->SetArcCap(BlockNode(shared[0], grid_idx), arc, cap - half);
+        m_blocks[shared[1]]->SetArcCap(BlockNode(shared[1], grid_idx), arc, half);
+    }
+}
+
+/***********************************************************************************/
+
+template <Size N, class TFLOW, class TTCAP, class TCAP, bool MASK>
+void DualDecomposition<N, TFLOW, TTCAP, TCAP, MASK>::SetTerminalArcCap(Size node, TTCAP csrc, TTCAP csnk)
+{
+    if (m_stage < 1)
+    {
+        throw System::InvalidOperationException(__FUNCTION__, __LINE__,
+                                                "Call Init method before adding arcs.");
+    }
+
+    if (m_merged)
+    {
+        m_merged->SetTerminalArcCap(node, csrc, csnk);
+        return;
+    }
+
+    Size nodes = MASK ? m_fw_idx.size() : m_dim.Product();
+    if (node >= nodes)
+    {
+        throw System::IndexOutOfRangeException(__FUNCTION__, __LINE__,
+                                               System::Format("Invalid node index. Nodes={0}, node={1}.")
+                                                   << nodes << node);
+    }
+
+    Size grid_idx = GridIndex(node);
+    Size blocks[2];
+    if (SliceBlocks(grid_idx / m_slice, blocks) == 1)
+    {
+        m_blocks[blocks[0]]->SetTerminalArcCap(BlockNode(blocks[0], grid_idx), csrc, csnk);
+        m_dirty[blocks[0]] = true;
+    }
+    else
+    {
+        Size sidx = SharedIndex(blocks[0], grid_idx);
+        TTCAP old_tr0, old_tr1;
+        SharedTerminalCap(sidx, old_tr0, old_tr1);
+        m_tr_cap[sidx] = csrc - csnk;
+        m_snk_cap[sidx] = csnk;
+        SetSharedTerminalArcCap(blocks[0], grid_idx, sidx, old_tr0, old_tr1);
+    }
+}
+
+/***********************************************************************************/
+
+template <Size N, class TFLOW, class TTCAP, class TCAP, bool MASK>
+void DualDecomposition<N, TFLOW, TTCAP, TCAP, MASK>::SetSharedTerminalArcCap(Size block, Size grid_idx, Size sidx,
+                                                                             TTCAP old_tr0, TTCAP old_tr1)
+{
+    TTCAP tr0, tr1;
+    SharedTerminalCap(sidx, tr0, tr1);
+
+    SetCopyTerminalArcCap(block, BlockNode(block, grid_idx), old_tr0, tr0);
+    SetCopyTerminalArcCap(block + 1, BlockNode(block + 1, grid_idx), old_tr1, tr1);
+}
+
+/***********************************************************************************/
+
+template <Size N, class TFLOW, class TTCAP, class TCAP, bool MASK>
+void DualDecomposition<N, TFLOW, TTCAP, TCAP, MASK>::SetCopyTerminalArcCap(Size block, Size bnode, TTCAP old_tr, TTCAP tr)
+{
+    if (m_stage == 1)
+    {
+        m_blocks[block]->SetTerminalArcCap(bnode, Math::Max(tr, TTCAP(0)), Math::Max(-tr, TTCAP(0)));
+    }
+    else
+    {
+        // Kohli does not update the flow value after a dynamic change, so the change of the
+        // minimum cut of the block (up to the current flow) is accumulated here
+        TTCAP old_res = m_blocks[block]->ResidualTerminalCap(bnode);
+        m_blocks[block]->SetTerminalArcCap(bnode, Math::Max(tr, TTCAP(0)), Math::Max(-tr, TTCAP(0)));
+        TTCAP res = m_blocks[block]->ResidualTerminalCap(bnode);
+
+        m_flow_shift += Math::Max(-tr, TTCAP(0)) - Math::Max(-old_tr, TTCAP(0)) +
+                        Math::Max(-old_res, TTCAP(0)) - Math::Max(-res, TTCAP(0));
+    }
+    m_dirty[block] = true;
+}
+
+/***********************************************************************************/
+
+template <Size N, class TFLOW, class TTCAP, class TCAP, bool MASK>
+void DualDecomposition<N, TFLOW, TTCAP, TCAP, MASK>::SolveBlocks()
+{
+    std::vector<Size> dirty;
+    for (Size k = 0; k < m_blocks.size(); k++)
+    {
+        if (m_blocks[k] && m_dirty[k])
+        {
+            dirty.push_back(k);
+        }
+    }
+
+    std::vector<std::exception_ptr> errors(dirty.size());
+    auto solve = [this, &dirty, &errors](Size i) {
+        try
+        {
+            m_flows[dirty[i]] = m_blocks[dirty[i]]->FindMaxFlow();
+        }
+        catch (...)
+        {
+            errors[i] = std::current_exception();
+        }
+    };
+
+    // The first block is computed in the calling thread
+    std::vector<std::thread> threads;
+    for (Size i = 1; i < dirty.size(); i++)
+    {
+        threads.emplace_back(solve, i);
+    }
+    if (!dirty.empty())
+    {
+        solve(0);
+    }
+    for (auto & t : threads)
+    {
+        t.join();
+    }
+
+    for (Size i = 0; i < dirty.size(); i++)
+    {
+        if (errors[i])
+        {
+            std::rethrow_exception(errors[i]);
+        }
+        m_dirty[dirty[i]] = false;
+    }
+}
+
+/***********************************************************************************/
+
+template <Size N, class TFLOW, class TTCAP, class TCAP, bool MASK>
+TFLOW DualDecomposition<N, TFLOW, TTCAP, TCAP, MASK>::FindMaxFlow()
+{
+    if (m_stage < 1)
+    {
+        throw System::InvalidOperationException(__FUNCTION__, __LINE__,
+                                                "Call Init method before computing maximum flow.");
+    }
+
+    if (m_merged)
+    {
+        m_iter = 1;
+        return m_merged->FindMaxFlow();
+    }
+
+    if (m_stage == 1)
+    {
+        // Initial step size is the mean arc capacity
+        m_step = m_cap_count ? TTCAP(m_cap_sum / m_cap_count) : TTCAP(1);
+        if (m_step <= 0)
+        {
+            m_step = TTCAP(1);
+        }
+        m_stage = 2;
+    }
+
+    Size prev_disagree = 0;
+    for (m_iter = 1;; m_iter++)
+    {
+        SolveBlocks();
+
+        // Subgradient step for the shared nodes with different labels in the two blocks
+        Size disagree = 0;
+        for (Size k = 0; k + 1 < m_blocks.size(); k++)
+        {
+            Size first = m_first[k + 1] * m_slice;
+            for (Size grid_idx = first; grid_idx < first + m_overlap * m_slice; grid_idx++)
+            {
+                if (MASK && m_mask[grid_idx])
+                {
+                    continue;
+                }
+
+                bool src0 = m_blocks[k]->NodeOrigin(BlockNode(k, grid_idx)) == Source;
+                bool src1 = m_blocks[k + 1]->NodeOrigin(BlockNode(k + 1, grid_idx)) == Source;
+                if (src0 != src1)
+                {
+                    Size sidx = SharedIndex(k, grid_idx);
+                    TTCAP old_tr0, old_tr1;
+                    SharedTerminalCap(sidx, old_tr0, old_tr1);
+                    m_lambda[sidx] += src0 ? m_step : -m_step;
+                    SetSharedTerminalArcCap(k, grid_idx, sidx, old_tr0, old_tr1);
+                    disagree++;
+                }
+            }
+        }
+
+        if (!disagree)
+        {
+            break;
+        }
+
+        if (m_iter >= m_max_iter)
+        {
+            Merge();
+            break;
+        }
+
+        if (m_iter > 1 && disagree >= prev_disagree && m_step > TTCAP(1))
+        {
+            m_step /= 2;
+        }
+        prev_disagree = disagree;
+    }
+
+    // The copies of the shared nodes agree (or the blocks were merged), so the multipliers cancel
+    // out and the flow is the sum of the flows of the blocks corrected by the different
+    // representation of the terminal arcs of the shared nodes
+    TFLOW flow = m_flow_shift;
+    for (Size k = 0; k < m_flows.size(); k++)
+    {
+        flow += m_flows[k];
+    }
+    if (m_merged)
+    {
+        flow += m_merged_flow;
+    }
+
+    for (Size k = 0; k + 1 < m_blocks.size(); k++)
+    {
+        Size first = m_first[k + 1] * m_slice;
+        for (Size grid_idx = first; grid_idx < first + m_overlap * m_slice; grid_idx++)
+        {
+            if (MASK && m_mask[grid_idx])
+            {
+                continue;
+            }
+
+            Size sidx = SharedIndex(k, grid_idx);
+            TTCAP tr0, tr1;
+            SharedTerminalCap(sidx, tr0, tr1);
+            flow += m_snk_cap[sidx] - Math::Max(-tr0, TTCAP(0)) - Math::Max(-tr1, TTCAP(0));
+        }
+    }
+
+    if (m_merged)
+    {
+        flow += m_merged_correction;
+        m_blocks.clear();
+        m_bw_idx.clear();
+    }
+
+    return flow;
+}
+
+/***********************************************************************************/
+
+template <Size N, class TFLOW, class TTCAP, class TCAP, bool MASK>
+void DualDecomposition<N, TFLOW, TTCAP, TCAP, MASK>::Merge()
+{
+    m_merged.reset(new BlockType);
+    if (MASK)
+    {
+        System::Collection::BoolArrayMask<N> mask(m_mask, true);
+        m_merged->InitMask(m_dim, m_nb, mask);
+    }
+    else
+    {
+        m_merged->Init(m_dim, m_nb);
+    }
+
+    // The residual networks of the blocks sum up to a residual network of the whole graph
+    m_merged_correction = 0;
+    Size nodes = MASK ? m_fw_idx.size() : m_dim.Product();
+    for (Size node = 0; node < nodes; node++)
+    {
+        Size grid_idx = GridIndex(node);
+        Size blocks[2], bnodes[2];
+        Size count = SliceBlocks(grid_idx / m_slice, blocks);
+        for (Size i = 0; i < count; i++)
+        {
+            bnodes[i] = BlockNode(blocks[i], grid_idx);
+        }
+
+        for (Size arc = 0; arc < m_nb.Elements(); arc++)
+        {
+            TCAP cap = 0;
+            for (Size i = 0; i < count; i++)
+            {
+                TCAP res = m_blocks[blocks[i]]->ResidualArcCap(bnodes[i], arc);
+                if (res > 0)
+                {
+                    cap += res;
+                }
+            }
+            m_merged->SetArcCap(node, arc, cap);
+        }
+
+        TTCAP tr = 0;
+        for (Size i = 0; i < count; i++)
+        {
+            TTCAP res = m_blocks[blocks[i]]->ResidualTerminalCap(bnodes[i]);
+            tr += res;
+            m_merged_correction += Math::Max(-res, TTCAP(0));
+        }
+        m_merged->SetTerminalArcCap(node, Math::Max(tr, TTCAP(0)), Math::Max(-tr, TTCAP(0)));
+        m_merged_correction -= Math::Max(-tr, TTCAP(0));
+    }
+
+    m_merged_flow = m_merged->FindMaxFlow();
+}
+
+/***********************************************************************************/
+
+template <Size N, class TFLOW, class TTCAP, class TCAP, bool MASK>
+Origin DualDecomposition<N, TFLOW, TTCAP, TCAP, MASK>::NodeOrigin(Size node) const
+{
+    if (m_stage != 2)
+    {
+        throw System::InvalidOperationException(__FUNCTION__, __LINE__,
+                                                "Compute the maximum flow first before calling this method.");
+    }
+
+    if (m_merged)
+    {
+        return m_merged->NodeOrigin(node);
+    }
+
+    Size nodes = MASK ? m_fw_idx.size() : m_dim.Product();
+    if (node >= nodes)
+    {
+        throw System::IndexOutOfRangeException(__FUNCTION__, __LINE__,
+                                               System::Format("Invalid node index. Nodes={0}, node={1}.")
+                                                   << nodes << node);
+    }
+
+    Size grid_idx = GridIndex(node);
+    Size blocks[2];
+    SliceBlocks(grid_idx / m_slice, blocks);
+    return m_blocks[blocks[0]]->NodeOrigin(BlockNode(blocks[0], grid_idx));
+}
+
+/***********************************************************************************/
+
+template <Size N, class TFLOW, class TTCAP, class TCAP, bool MASK>
+void DualDecomposition<N, TFLOW, TTCAP, TCAP, MASK>::Dispose()
+{
+    m_blocks.clear();
+    m_merged.reset();
+    m_first.clear();
+    m_slice_block.clear();
+    m_dirty.clear();
+    m_flows.clear();
+    m_lambda.clear();
+    m_tr_cap.clear();
+    m_snk_cap.clear();
+    m_fw_idx.clear();
+    m_bw_idx.clear();
+    m_mask.Dispose();
+    m_stage = 0;
+}
+
+/***********************************************************************************/
+// Explicit instantiations
+/** @cond */
+template class GC_DLL_EXPORT DualDecomposition<2, Int32, Int32, Int32, false>;
+template class GC_DLL_EXPORT DualDecomposition<2, Float32, Float32, Float32, false>;
+template class GC_DLL_EXPORT DualDecomposition<2, Float64, Float64, Float64, false>;
+template class GC_DLL_EXPORT DualDecomposition<3, Int32, Int32, Int32, false>;
+template class GC_DLL_EXPORT DualDecomposition<3, Float32, Float32, Float32, false>;
+template class GC_DLL_EXPORT DualDecomposition<3, Float64, Float64, Float64, false>;
+
+template class GC_DLL_EXPORT DualDecomposition<2, Int32, Int32, Int32, true>;
+template class GC_DLL_EXPORT DualDecomposition<2, Float32, Float32, Float32, true>;
+template class GC_DLL_EXPORT DualDecomposition<2, Float64, Float64, Float64, true>;
+template class GC_DLL_EXPORT DualDecomposition<3, Int32, Int32, Int32, true>;
+template class GC_DLL_EXPORT DualDecomposition<3, Float32, Float32, Float32, true>;
+template class GC_DLL_EXPORT DualDecomposition<3, Float64, Float64, Float64, true>;
+/** @endcond */
+}
+}
+} // namespace Gc::Flow::Grid
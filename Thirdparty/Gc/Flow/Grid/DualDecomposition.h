@@ -0,0 +1,251 @@
+/*
+    This file is part of Graph Cut (Gc) combinatorial optimization library.
+    Copyright (C) 2008-2010 Centre for Biomedical Image Analysis (CBIA)
+    Copyright (C) 2008-2010 Ondrej Danek
+
+    This library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Graph Cut library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+    @file
+    Parallel maximum flow algorithm for grid graphs based on dual decomposition.
+*/
+
+#ifndef GC_FLOW_GRID_DUALDECOMPOSITION_H
+#define GC_FLOW_GRID_DUALDECOMPOSITION_H
+
+#include "../../Core.h"
+#include "../IGridMaxFlow.h"
+#include "Kohli.h"
+
+#include <memory>
+#include <vector>
+
+namespace Gc {
+namespace Flow {
+namespace Grid {
+/** Parallel maximum flow algorithm for grid graphs based on dual decomposition.
+
+                The grid is split along its last dimension into blocks which overlap by
+                the extent of the neighbourhood. Arcs and terminal arcs shared by two
+                blocks are split between them and each block is solved by its own
+                instance of Kohli's algorithm in a separate thread. The blocks are then
+                forced to agree on the label of the shared nodes by adjusting the
+                terminal arcs of these nodes (Lagrange multipliers updated by
+                a subgradient method) and recomputing the flow dynamically, see:
+
+                P. Strandmark, F. Kahl: Parallel and Distributed Graph Cuts by Dual
+                Decomposition. CVPR 2010.
+
+                When the blocks agree the cut is a minimum cut of the whole graph. If
+                they do not agree after a maximum number of iterations, the residual
+                graphs of the blocks are merged into a single graph (which requires
+                memory for the whole graph) and the remaining flow is computed
+                sequentially, so the result is always exact.
+
+                @tparam N Number of dimensions of the grid.
+                @tparam TFLOW %Data type used for the flow value.
+                @tparam TTCAP %Data type used for terminal arc capacity values. This type
+                    must be signed (allow negative numbers).
+                @tparam TCAP %Data type used for regular arc capacity values.
+                @tparam MASK If this parameter is \c false then you won't be able to
+                    specify a voxel mask (method InitMask() will throw an exception).
+
+                @remarks As for Kohli, only the capacity of the terminal arcs can be
+                    changed dynamically and the flow value returned after dynamic
+                    changes or after the blocks had to be merged is not the maximum
+                    flow of the graph.
+            */
+template <Size N, class TFLOW, class TTCAP, class TCAP, bool MASK>
+class GC_DLL_EXPORT DualDecomposition
+    : public IGridMaxFlow<N, TFLOW, TTCAP, TCAP>
+{
+  private:
+    using BlockType = Kohli<N, TFLOW, TTCAP, TCAP, MASK>;
+
+    /** Requested number of blocks. */
+    Size m_req_blocks;
+    /** Maximum number of subgradient iterations. */
+    Size m_max_iter;
+
+    /** Grid dimensions. */
+    Math::Algebra::Vector<N, Size> m_dim;
+    /** Neighbourhood. */
+    Energy::Neighbourhood<N, Int32> m_nb;
+    /** Number of grid nodes in one slice (last dimension fixed). */
+    Size m_slice;
+    /** Number of slices shared by neighbouring blocks. */
+    Size m_overlap;
+
+    /** First slice of each block. Slices [m_first[k], m_first[k + 1]) belong
+        only to block k, except for the first m_overlap slices which are shared with
+        block k - 1. The last entry is the number of slices. */
+    std::vector<Size> m_first;
+    /** Last block containing each slice. */
+    std::vector<Size> m_slice_block;
+    /** Flow networks of the blocks. */
+    std::vector<std::unique_ptr<BlockType>> m_blocks;
+    /** Blocks whose terminal arcs changed since the last computation. */
+    std::vector<bool> m_dirty;
+    /** Flow of each block. */
+    std::vector<TFLOW> m_flows;
+
+    /** Lagrange multipliers of the shared nodes. */
+    std::vector<TTCAP> m_lambda;
+    /** Terminal capacity difference (\c csrc - \c csnk) of the shared nodes. */
+    std::vector<TTCAP> m_tr_cap;
+    /** Capacity of the \c node -> \c sink arc of the shared nodes. */
+    std::vector<TTCAP> m_snk_cap;
+    /** Change of the flow of the blocks due to dynamic changes of the shared nodes. */
+    TFLOW m_flow_shift;
+    /** Subgradient step size. */
+    TTCAP m_step;
+    /** Sum and number of the non-zero arc capacities, used for the initial step size. */
+    double m_cap_sum;
+    Size m_cap_count;
+    /** Number of iterations of the last computation. */
+    Size m_iter;
+
+    /** Mask (\c true for masked nodes) if the graph was initialized using InitMask(). */
+    System::Collection::Array<N, bool> m_mask;
+    /** Forward (node -> grid) indexes. */
+    std::vector<Size> m_fw_idx;
+    /** Backward (block grid -> block node) indexes of each block. */
+    std::vector<System::Collection::Array<N, Size>> m_bw_idx;
+
+    /** Network built from the residual networks of the blocks if they did not agree. */
+    std::unique_ptr<BlockType> m_merged;
+    /** Flow of the merged network. */
+    TFLOW m_merged_flow;
+    /** Difference of the flow of the merged network and of the blocks due to the
+        representation of the terminal arcs. */
+    TFLOW m_merged_correction;
+
+    /** Current stage. Used to check correct method calling order. */
+    Uint8 m_stage;
+
+  public:
+    /** Constructor.
+
+                @param[in] blocks Number of blocks. Zero means the number of hardware threads.
+                @param[in] max_iter Maximum number of iterations until the blocks are merged.
+            */
+    explicit DualDecomposition(Size blocks = 0, Size max_iter = 100);
+
+    /** Destructor */
+    ~DualDecomposition() override = default;
+
+    void Init(const Math::Algebra::Vector<N, Size> & dim,
+              const Energy::Neighbourhood<N, Int32> & nb) override;
+
+    void InitMask(const Math::Algebra::Vector<N, Size> & dim,
+                  const Energy::Neighbourhood<N, Int32> & nb,
+                  const System::Collection::IArrayMask<N> & mask) override;
+
+    void SetArcCap(Size node, Size arc, TCAP cap) override;
+
+    void SetTerminalArcCap(Size node, TTCAP csrc, TTCAP csnk) override;
+
+    TFLOW FindMaxFlow() override;
+
+    Origin NodeOrigin(Size node) const override;
+
+    bool IsDynamic() const override
+    {
+        return true;
+    }
+
+    void Dispose() override;
+
+    /** Number of blocks the grid was split into. */
+    Size Blocks() const
+    {
+        return m_first.empty() ? 0 : m_first.size() - 1;
+    }
+
+    /** Number of iterations of the last flow computation. */
+    Size Iterations() const
+    {
+        return m_iter;
+    }
+
+    /** Whether the blocks had to be merged to compute the last flow. */
+    bool Merged() const
+    {
+        return m_merged != nullptr;
+    }
+
+  private:
+    /** Split the grid into blocks and initialize the networks. */
+    void InitBlocks(const Math::Algebra::Vector<N, Size> & dim,
+                    const Energy::Neighbourhood<N, Int32> & nb,
+                    const System::Collection::IArrayMask<N> * mask);
+
+    /** Grid index of a node. */
+    Size GridIndex(Size node) const
+    {
+        return MASK ? m_fw_idx[node] : node;
+    }
+
+    /** Blocks containing a slice.
+
+                @param[in] z Slice index.
+                @param[out] blocks Indexes of the blocks, in increasing order.
+                @return Number of blocks (1 or 2).
+            */
+    Size SliceBlocks(Size z, Size (&blocks)[2]) const;
+
+    /** Index of a grid node in the network of a block. */
+    Size BlockNode(Size block, Size grid_idx) const;
+
+    /** Index of a shared grid node in the multiplier arrays. */
+    Size SharedIndex(Size block, Size grid_idx) const
+    {
+        return (block * m_overlap) * m_slice + grid_idx - m_first[block + 1] * m_slice;
+    }
+
+    /** Terminal capacity difference of the two copies of a shared node. */
+    void SharedTerminalCap(Size sidx, TTCAP & tr0, TTCAP & tr1) const
+    {
+        // The terminal arcs are split between the two copies of the node and the multiplier
+        // penalizes the source label in the first block and the sink label in the second one
+        TTCAP half = m_tr_cap[sidx] / 2;
+        tr0 = m_tr_cap[sidx] - half - m_lambda[sidx];
+        tr1 = half + m_lambda[sidx];
+    }
+
+    /** Set the terminal arcs of the two copies of a shared node.
+
+                @param[in] block Index of the first block containing the node.
+                @param[in] grid_idx Grid index of the node.
+                @param[in] sidx Index of the node in the multiplier arrays.
+                @param[in] old_tr0 Previous terminal capacity difference of the first copy.
+                @param[in] old_tr1 Previous terminal capacity difference of the second copy.
+            */
+    void SetSharedTerminalArcCap(Size block, Size grid_idx, Size sidx, TTCAP old_tr0, TTCAP old_tr1);
+
+    /** Set the terminal arcs of a copy of a shared node. */
+    void SetCopyTerminalArcCap(Size block, Size bnode, TTCAP old_tr, TTCAP tr);
+
+    /** Compute the flow in all dirty blocks in parallel. */
+    void SolveBlocks();
+
+    /** Merge the residual networks of the blocks and compute the remaining flow. */
+    void Merge();
+};
+}
+}
+} // namespace Gc::Flow::Grid
+
+#endif
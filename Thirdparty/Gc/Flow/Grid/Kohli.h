@@ -147,6 +147,25 @@ class GC_DLL_EXPORT Kohli
 
     void Dispose() override;
 
+    /** Residual capacity of an arc after the flow computation.
+
+                Arcs leaving the grid or going to a masked node have negative capacity.
+            */
+    TCAP ResidualArcCap(Size node, Size arc) const
+    {
+        return m_arc_cap[arc + node * m_nb.Elements()];
+    }
+
+    /** Residual capacity of the terminal arcs after the flow computation.
+
+                Positive values are the residual capacity of the \c source -> \c node arc,
+                negative values that of the \c node -> \c sink arc.
+            */
+    TTCAP ResidualTerminalCap(Size node) const
+    {
+        return m_node_list[node].m_tr_cap;
+    }
+
   private:
     /** Init source and sink trees for first use. */
     void InitTrees();
@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "BatchPipeline.h"
+#include "SlicesHandler.h"
+#include "TissueInfos.h"
+#include "vtkCustomOutputWindow.h"
+
+#include "Data/LogApi.h"
+#include "Data/Logger.h"
+
+#include <QCoreApplication>
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef NO_OPENMP_SUPPORT
+#	include <omp.h>
+#endif
+
+namespace {
+
+std::string Quote(const std::string& s)
+{
+	return "\"" + s + "\"";
+}
+
+/// Process a single subject in this process
+int RunSubject(const iseg::BatchPipeline& pipeline, const std::string& input, const std::string& output_dir)
+{
+	using namespace iseg;
+	namespace fs = boost::filesystem;
+
+	std::map<std::string, std::string> variables;
+	variables["input"] = input;
+	variables["name"] = fs::path(input).stem().string();
+	variables["output_dir"] = output_dir;
+
+	TissueInfos::InitTissues();
+
+	SlicesHandler handler;
+
+	std::vector<BatchPipeline::StageTiming> timings;
+	std::string error;
+	bool const ok = pipeline.Run(handler, variables, timings, error);
+
+	double total = 0;
+	std::cout << input << "\n";
+	for (const auto& t : timings)
+	{
+		std::cout << boost::format("  %-24s %10.3f s\n") % t.m_Stage % t.m_Seconds;
+		total += t.m_Seconds;
+	}
+	std::cout << boost::format("  %-24s %10.3f s\n") % "total" % total;
+
+	if (!ok)
+	{
+		ISEG_ERROR(input << ": " << error);
+		std::cerr << input << " failed at " << error << "\n";
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/// Process each subject in a separate process, 'jobs' at a time. The handler and the tissue
+/// list use process-wide state, separate processes also keep a failing subject from stopping the others.
+int RunSubjects(const std::string& executable, const std::vector<std::string>& inputs, const std::string& pipeline_file, const std::string& output_dir, unsigned jobs, bool debug)
+{
+	unsigned const hardware = std::max(1u, std::thread::hardware_concurrency());
+	jobs = std::max(1u, std::min(jobs, static_cast<unsigned>(inputs.size())));
+	unsigned const threads = std::max(1u, hardware / jobs);
+
+	std::atomic<size_t> next(0);
+	std::mutex mutex;
+	std::vector<std::string> failed;
+
+	auto const before = std::chrono::steady_clock::now();
+	std::vector<std::thread> workers;
+	for (unsigned j = 0; j < jobs; ++j)
+	{
+		workers.emplace_back([&]() {
+			for (size_t i = next++; i < inputs.size(); i = next++)
+			{
+				std::string command = Quote(executable) + " --pipeline " + Quote(pipeline_file) +
+															" --output-dir " + Quote(output_dir) +
+															" --threads " + std::to_string(threads) +
+															(debug ? " --debug" : "") + " " + Quote(inputs[i]);
+#ifdef _WIN32
+				// cmd.exe strips the first and last quote
+				command = Quote(command);
+#endif
+				if (std::system(command.c_str()) != 0)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					failed.push_back(inputs[i]);
+				}
+			}
+		});
+	}
+	for (auto& w : workers)
+	{
+		w.join();
+	}
+	auto const after = std::chrono::steady_clock::now();
+
+	std::cout << boost::format("%d of %d subjects done in %.1f s with %d jobs\n") % (inputs.size() - failed.size()) % inputs.size() % std::chrono::duration<double>(after - before).count() % jobs;
+	for (const auto& f : failed)
+	{
+		std::cerr << "failed: " << f << "\n";
+	}
+	return failed.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	using namespace iseg;
+	namespace po = boost::program_options;
+	namespace fs = boost::filesystem;
+
+	po::options_description desc("Usage: iSegBatch --pipeline <file> [options] <input>...\n\nAllowed options");
+	desc.add_options()
+		("help", "produce help message")
+		("pipeline,p", po::value<std::string>(), "pipeline file")
+		("output-dir,o", po::value<std::string>()->default_value("."), "output directory, available as ${output_dir}")
+		("jobs,j", po::value<unsigned>()->default_value(1), "number of subjects processed concurrently")
+		("threads", po::value<unsigned>()->default_value(0), "number of threads per subject, 0 for all")
+		("debug", po::bool_switch()->default_value(false), "show debug log messages")
+		("input", po::value<std::vector<std::string>>(), "input files or DICOM directories, one per subject");
+	po::positional_options_description positional;
+	positional.add("input", -1);
+
+	po::variables_map vm;
+	try
+	{
+		po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+		po::notify(vm);
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << e.what() << "\n";
+		return EXIT_FAILURE;
+	}
+
+	if (vm.count("help") || !vm.count("pipeline") || !vm.count("input"))
+	{
+		std::cout << desc << "\n"
+							<< BatchPipeline::Usage();
+		return vm.count("help") ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	auto const pipeline_file = vm["pipeline"].as<std::string>();
+	auto const output_dir = vm["output-dir"].as<std::string>();
+	auto const inputs = vm["input"].as<std::vector<std::string>>();
+	bool const debug = vm["debug"].as<bool>();
+
+	BatchPipeline pipeline;
+	std::string error;
+	if (!pipeline.Read(pipeline_file, error))
+	{
+		std::cerr << pipeline_file << ": " << error << "\n";
+		return EXIT_FAILURE;
+	}
+
+	boost::system::error_code ec;
+	fs::create_directories(output_dir, ec);
+	if (!fs::is_directory(output_dir))
+	{
+		std::cerr << "could not create output directory " << output_dir << "\n";
+		return EXIT_FAILURE;
+	}
+
+	if (inputs.size() > 1)
+	{
+		return RunSubjects(argv[0], inputs, pipeline_file, output_dir, vm["jobs"].as<unsigned>(), debug);
+	}
+
+#ifndef NO_OPENMP_SUPPORT
+	if (vm["threads"].as<unsigned>() > 0)
+	{
+		omp_set_num_threads(static_cast<int>(vm["threads"].as<unsigned>()));
+	}
+#endif
+
+	// Qt is only used for file and image IO, there are no widgets
+	QCoreApplication app(argc, argv);
+
+	// route vtk errors to the log instead of popup windows
+	auto eow = vtkCustomOutputWindow::New();
+	eow->SetInstance(eow);
+	eow->Delete();
+
+	auto const log_file_name = (fs::path(output_dir) / (fs::path(inputs.front()).stem().string() + ".log")).string();
+	init_logging(log_file_name, debug, debug, false);
+
+	return RunSubject(pipeline, inputs.front(), output_dir);
+}
@@ -0,0 +1,591 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "BatchPipeline.h"
+#include "SlicesHandler.h"
+#include "TissueInfos.h"
+
+#include "Data/SlicesHandlerInterface.h"
+
+#include "Core/Morpho.h"
+#include "Core/SmoothTissues.h"
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <sstream>
+
+namespace iseg {
+
+namespace {
+
+enum eType {
+	kString,
+	kInt,
+	kFloat,
+	kBool,
+	kTissues
+};
+
+struct Argument
+{
+	const char* m_Name;
+	eType m_Type;
+	const char* m_Default; // nullptr if the argument is required
+	const char* m_Help;
+};
+
+class Arguments
+{
+public:
+	Arguments(const std::map<std::string, std::string>& values) : m_Values(values) {}
+
+	const std::string& String(const std::string& name) const { return m_Values.at(name); }
+	int Int(const std::string& name) const { return std::stoi(m_Values.at(name)); }
+	float Float(const std::string& name) const { return std::stof(m_Values.at(name)); }
+	bool Bool(const std::string& name) const { return m_Values.at(name) != "0"; }
+
+	/// tissue indices, 'all' are all tissues
+	std::vector<tissues_size_t> Tissues(const std::string& name) const
+	{
+		std::vector<tissues_size_t> tissues;
+		auto const& value = m_Values.at(name);
+		if (value == "all")
+		{
+			for (tissues_size_t i = 1; i <= TissueInfos::GetTissueCount(); i++)
+				tissues.push_back(i);
+		}
+		else
+		{
+			std::vector<std::string> items;
+			boost::split(items, value, boost::is_any_of(","));
+			for (const auto& item : items)
+				tissues.push_back(static_cast<tissues_size_t>(std::stoi(item)));
+		}
+		return tissues;
+	}
+
+private:
+	const std::map<std::string, std::string>& m_Values;
+};
+
+using run_function = std::function<bool(SlicesHandler&, const Arguments&, std::string&)>;
+
+struct Operation
+{
+	const char* m_Name;
+	const char* m_Help;
+	std::vector<Argument> m_Arguments;
+	run_function m_Run;
+};
+
+bool IsValid(const std::string& value, eType type)
+{
+	// values with variables are only known when the pipeline is run
+	if (value.find("${") != std::string::npos)
+		return type == kString;
+
+	try
+	{
+		size_t pos = 0;
+		switch (type)
+		{
+		case kString: return !value.empty();
+		case kInt: std::stoi(value, &pos); return pos == value.size();
+		case kFloat: std::stof(value, &pos); return pos == value.size();
+		case kBool: return value == "0" || value == "1";
+		case kTissues:
+			if (value == "all")
+				return true;
+			for (const auto& c : value)
+			{
+				if (!std::isdigit(static_cast<unsigned char>(c)) && c != ',')
+					return false;
+			}
+			return !value.empty();
+		}
+	}
+	catch (std::exception&)
+	{
+	}
+	return false;
+}
+
+std::string Extension(const std::string& filename)
+{
+	return boost::algorithm::to_lower_copy(boost::filesystem::path(filename).extension().string());
+}
+
+bool Load(SlicesHandler& handler, const Arguments& args, std::string& error)
+{
+	namespace fs = boost::filesystem;
+	auto const& filename = args.String("file");
+
+	bool ok = false;
+	if (fs::is_directory(filename))
+	{
+		// all files of a DICOM series, sorted by z-position in LoadDICOM
+		std::vector<std::string> files;
+		for (fs::directory_iterator it(filename), end; it != end; ++it)
+		{
+			if (fs::is_regular_file(it->path()))
+				files.push_back(it->path().string());
+		}
+		std::sort(files.begin(), files.end());
+
+		std::vector<const char*> names;
+		for (const auto& f : files)
+			names.push_back(f.c_str());
+		ok = !names.empty() && handler.LoadDICOM(names) != 0;
+	}
+	else if (Extension(filename) == ".h5")
+	{
+		int tissues_version = 0;
+		ok = handler.LoadS4Llink(filename.c_str(), tissues_version);
+		ok = ok && TissueInfos::LoadTissuesHDF(filename.c_str(), tissues_version);
+		if (ok)
+		{
+			tissues_size_t m;
+			handler.GetRangetissue(&m);
+			handler.Buildmissingtissues(m);
+		}
+	}
+	else
+	{
+		ok = handler.ReadImage(filename.c_str()) != 0;
+	}
+
+	if (!ok || !handler.Isloaded())
+	{
+		error = "could not load " + filename;
+		return false;
+	}
+	return true;
+}
+
+bool Save(SlicesHandler& handler, const Arguments& args, std::string& error)
+{
+	auto const& filename = args.String("file");
+	auto const& data = args.String("data");
+
+	bool ok = false;
+	if (Extension(filename) == ".h5")
+	{
+		// same format as the communication file, can be loaded again with 'load'
+		ok = handler.SaveAllXdmf(filename.c_str(), handler.GetCompression(), args.Bool("target"), true) != 0;
+	}
+	else if (data == "tissues")
+	{
+		ok = handler.ExportTissue(filename.c_str(), true);
+	}
+	else if (data == "source")
+	{
+		ok = handler.ExportBmp(filename.c_str(), true);
+	}
+	else if (data == "target")
+	{
+		ok = handler.ExportWork(filename.c_str(), true);
+	}
+	else
+	{
+		error = "unknown data '" + data + "', expected tissues, source or target";
+		return false;
+	}
+
+	if (!ok)
+	{
+		error = "could not save " + filename;
+	}
+	return ok;
+}
+
+bool Slices(SlicesHandler& handler, const Arguments& args, std::string& error)
+{
+	int const start = args.Int("start");
+	int const end = args.Int("end") < 0 ? handler.NumSlices() : args.Int("end");
+	if (start < 0 || start >= end || end > handler.NumSlices())
+	{
+		error = (boost::format("invalid slice range [%d, %d) for %d slices") % start % end % handler.NumSlices()).str();
+		return false;
+	}
+	handler.SetStartslice(static_cast<unsigned short>(start));
+	handler.SetEndslice(static_cast<unsigned short>(end));
+	return true;
+}
+
+bool Threshold(SlicesHandler& handler, const Arguments& args, std::string& error)
+{
+	float const lower = args.Float("lower");
+	float const upper = args.Float("upper");
+	if (lower > upper)
+	{
+		error = "lower threshold is larger than upper threshold";
+		return false;
+	}
+
+	auto source = handler.SourceSlices();
+	auto target = handler.TargetSlices();
+	size_t const area = static_cast<size_t>(handler.Width()) * handler.Height();
+	std::int64_t const start = handler.StartSlice(), end = handler.EndSlice();
+
+#pragma omp parallel for
+	for (std::int64_t z = start; z < end; ++z)
+	{
+		const float* src = source[z];
+		float* tgt = target[z];
+		for (size_t i = 0; i < area; ++i)
+		{
+			tgt[i] = (src[i] >= lower && src[i] <= upper) ? 255.f : 0.f;
+		}
+	}
+	handler.SetTargetFixedRange(true);
+	return true;
+}
+
+bool Morphology(SlicesHandler& handler, const Arguments& args, std::string& error)
+{
+	auto const& name = args.String("operation");
+	eOperation operation;
+	if (name == "erode")
+		operation = kErode;
+	else if (name == "dilate")
+		operation = kDilate;
+	else if (name == "open")
+		operation = kOpen;
+	else if (name == "close")
+		operation = kClose;
+	else
+	{
+		error = "unknown morphological operation '" + name + "'";
+		return false;
+	}
+
+	boost::variant<int, float> radius;
+	if (args.Bool("mm"))
+		radius = args.Float("radius");
+	else
+		radius = static_cast<int>(args.Float("radius"));
+
+	MorphologicalOperation(&handler, radius, operation, args.Bool("3d"), nullptr);
+	return true;
+}
+
+bool AddTissue(SlicesHandler& handler, const Arguments& args, std::string& error)
+{
+	int const tissue = args.Int("tissue");
+	if (tissue <= 0 || tissue > TISSUES_SIZE_MAX)
+	{
+		error = "invalid tissue index";
+		return false;
+	}
+	handler.Buildmissingtissues(static_cast<tissues_size_t>(tissue));
+	handler.Add2tissueall(static_cast<tissues_size_t>(tissue), args.Float("value"), args.Bool("override"));
+	return true;
+}
+
+bool Surfaces(SlicesHandler& handler, const Arguments& args, std::string& error)
+{
+	auto tissues = args.Tissues("tissues");
+	if (tissues.empty())
+	{
+		error = "no tissues to extract";
+		return false;
+	}
+
+	int const errors = handler.ExtractTissueSurfaces(args.String("file"), tissues, args.Bool("marching_cubes"), args.Float("reduce"), static_cast<unsigned>(args.Int("smoothing")));
+	if (errors < 0)
+	{
+		error = "surface extraction failed";
+		return false;
+	}
+	if (errors > 0)
+	{
+		ISEG_WARNING("surface extraction might have failed for " << errors << " tissues");
+	}
+	return true;
+}
+
+const std::vector<Operation>& Operations()
+{
+	static const std::vector<Operation> operations = {
+			{"load", "load an image (e.g. .nii, .mhd, .vtk), a DICOM directory or an .h5 file written by 'save'",
+					{{"file", kString, nullptr, "file or directory"}},
+					Load},
+			{"save", "save the active slices, .h5 files contain source, tissues and tissue names",
+					{{"file", kString, nullptr, "output file"},
+							{"data", kString, "tissues", "tissues, source or target, if the file is not .h5"},
+							{"target", kBool, "0", "also write the target to .h5 files"}},
+					Save},
+			{"slices", "restrict the following steps to the slices [start, end)",
+					{{"start", kInt, "0", "first slice"},
+							{"end", kInt, "-1", "end slice, -1 for all"}},
+					Slices},
+			{"threshold", "set the target to 255 where lower <= source <= upper, else 0",
+					{{"lower", kFloat, nullptr, "lower threshold"},
+							{"upper", kFloat, nullptr, "upper threshold"}},
+					Threshold},
+			{"gaussian", "Gaussian smoothing of the source into the target",
+					{{"sigma", kFloat, nullptr, "sigma in pixels"},
+							{"3d", kBool, "1", "smooth in 3D, else slice by slice"}},
+					[](SlicesHandler& handler, const Arguments& args, std::string&) {
+						if (args.Bool("3d"))
+							handler.Gaussian3D(args.Float("sigma"));
+						else
+							handler.Gaussian(args.Float("sigma"));
+						return true;
+					}},
+			{"average", "mean filter of the source into the target",
+					{{"n", kInt, nullptr, "kernel width in pixels"},
+							{"3d", kBool, "1", "filter in 3D, else slice by slice"}},
+					[](SlicesHandler& handler, const Arguments& args, std::string&) {
+						auto const n = static_cast<unsigned short>(args.Int("n"));
+						if (args.Bool("3d"))
+							handler.Average3D(n);
+						else
+							handler.Average(n);
+						return true;
+					}},
+			{"median", "median filter of the source into the target",
+					{{"n", kInt, "3", "kernel width in pixels"},
+							{"depth", kInt, "1", "kernel depth in slices"}},
+					[](SlicesHandler& handler, const Arguments& args, std::string&) {
+						auto const n = static_cast<unsigned short>(args.Int("n"));
+						handler.PercentileFilter(n, n, static_cast<unsigned short>(args.Int("depth")), 50.f);
+						return true;
+					}},
+			{"diffusion", "anisotropic diffusion of the source into the target, in 3D",
+					{{"iterations", kInt, nullptr, "number of iterations"},
+							{"k", kFloat, nullptr, "edge threshold"},
+							{"restraint", kFloat, "0", "attraction to the original image, 0 to 1"}},
+					[](SlicesHandler& handler, const Arguments& args, std::string&) {
+						handler.AnisoDiff3D(1.0f, args.Int("iterations"), args.Float("k"), args.Float("restraint"));
+						return true;
+					}},
+			{"morphology", "morphological operation on the target",
+					{{"operation", kString, nullptr, "erode, dilate, open or close"},
+							{"radius", kFloat, nullptr, "radius in pixels or mm"},
+							{"mm", kBool, "0", "radius is in mm"},
+							{"3d", kBool, "1", "operate in 3D, else slice by slice"}},
+					Morphology},
+			{"add_tissue", "assign the tissue to the target voxels with the given value",
+					{{"tissue", kInt, nullptr, "tissue index, missing tissues are created"},
+							{"value", kFloat, "255", "target value"},
+							{"override", kBool, "0", "override other (unlocked) tissues"}},
+					AddTissue},
+			{"tissue_to_target", "set the target to 255 inside the tissues, else 0",
+					{{"tissues", kTissues, nullptr, "comma separated tissue indices or 'all'"}},
+					[](SlicesHandler& handler, const Arguments& args, std::string&) {
+						handler.Selectedtissue2work3D(args.Tissues("tissues"));
+						return true;
+					}},
+			{"fill_holes", "fill holes smaller than 'size' pixels in a tissue, slice by slice",
+					{{"tissue", kInt, nullptr, "tissue index"},
+							{"size", kInt, nullptr, "maximum hole size in pixels"}},
+					[](SlicesHandler& handler, const Arguments& args, std::string&) {
+						handler.FillHolestissue(static_cast<tissues_size_t>(args.Int("tissue")), args.Int("size"));
+						return true;
+					}},
+			{"remove_islands", "remove islands smaller than 'size' pixels of a tissue, slice by slice",
+					{{"tissue", kInt, nullptr, "tissue index"},
+							{"size", kInt, nullptr, "maximum island size in pixels"}},
+					[](SlicesHandler& handler, const Arguments& args, std::string&) {
+						handler.RemoveIslandstissue(static_cast<tissues_size_t>(args.Int("tissue")), args.Int("size"));
+						return true;
+					}},
+			{"smooth_tissues", "smooth the boundaries of all unlocked tissues",
+					{{"sigma", kFloat, nullptr, "sigma in mm"},
+							{"3d", kBool, "1", "smooth in 3D, else slice by slice"}},
+					[](SlicesHandler& handler, const Arguments& args, std::string& error) {
+						if (!SmoothTissues(&handler, handler.StartSlice(), handler.EndSlice(), args.Float("sigma"), args.Bool("3d")))
+						{
+							error = "tissue smoothing failed";
+							return false;
+						}
+						return true;
+					}},
+			{"surfaces", "extract, smooth and simplify tissue surfaces (.vtp, .stl or .dat)",
+					{{"file", kString, nullptr, "output file"},
+							{"tissues", kTissues, "all", "comma separated tissue indices or 'all'"},
+							{"reduce", kFloat, "1", "fraction of triangles to keep"},
+							{"smoothing", kInt, "9", "number of smoothing iterations"},
+							{"marching_cubes", kBool, "0", "use discrete marching cubes"}},
+					Surfaces},
+	};
+	return operations;
+}
+
+const Operation* FindOperation(const std::string& name)
+{
+	for (const auto& op : Operations())
+	{
+		if (name == op.m_Name)
+			return &op;
+	}
+	return nullptr;
+}
+
+std::string Substitute(std::string value, const std::map<std::string, std::string>& variables)
+{
+	for (const auto& v : variables)
+	{
+		boost::replace_all(value, "${" + v.first + "}", v.second);
+	}
+	return value;
+}
+
+} // namespace
+
+bool BatchPipeline::Read(const std::string& filename, std::string& error)
+{
+	std::ifstream in(filename);
+	if (!in)
+	{
+		error = "could not open " + filename;
+		return false;
+	}
+	return Parse(in, error);
+}
+
+bool BatchPipeline::Parse(std::istream& in, std::string& error)
+{
+	m_Steps.clear();
+
+	std::string line;
+	for (int line_nr = 1; std::getline(in, line); ++line_nr)
+	{
+		boost::trim(line);
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::vector<std::string> tokens;
+		boost::split(tokens, line, boost::is_space(), boost::token_compress_on);
+
+		auto location = (boost::format("line %d: ") % line_nr).str();
+		auto op = FindOperation(tokens[0]);
+		if (!op)
+		{
+			error = location + "unknown operation '" + tokens[0] + "'";
+			return false;
+		}
+
+		Step step;
+		step.m_Operation = op->m_Name;
+		step.m_Line = line_nr;
+		for (size_t i = 1; i < tokens.size(); ++i)
+		{
+			auto eq = tokens[i].find('=');
+			if (eq == std::string::npos)
+			{
+				error = location + "expected key=value, got '" + tokens[i] + "'";
+				return false;
+			}
+			step.m_Arguments[tokens[i].substr(0, eq)] = tokens[i].substr(eq + 1);
+		}
+
+		for (const auto& arg : step.m_Arguments)
+		{
+			auto known = std::find_if(op->m_Arguments.begin(), op->m_Arguments.end(), [&arg](const Argument& a) { return arg.first == a.m_Name; });
+			if (known == op->m_Arguments.end())
+			{
+				error = location + "unknown argument '" + arg.first + "' for " + op->m_Name;
+				return false;
+			}
+			if (!IsValid(arg.second, known->m_Type))
+			{
+				error = location + "invalid value '" + arg.second + "' for " + arg.first;
+				return false;
+			}
+		}
+		for (const auto& a : op->m_Arguments)
+		{
+			if (step.m_Arguments.count(a.m_Name) == 0)
+			{
+				if (!a.m_Default)
+				{
+					error = location + "missing argument '" + a.m_Name + "' for " + op->m_Name;
+					return false;
+				}
+				step.m_Arguments[a.m_Name] = a.m_Default;
+			}
+		}
+
+		m_Steps.push_back(step);
+	}
+
+	if (m_Steps.empty() || m_Steps.front().m_Operation != "load")
+	{
+		error = "the pipeline must start with 'load'";
+		return false;
+	}
+	return true;
+}
+
+bool BatchPipeline::Run(SlicesHandler& handler, const std::map<std::string, std::string>& variables, std::vector<StageTiming>& timings, std::string& error) const
+{
+	for (size_t i = 0; i < m_Steps.size(); ++i)
+	{
+		const auto& step = m_Steps[i];
+
+		std::map<std::string, std::string> values;
+		for (const auto& arg : step.m_Arguments)
+		{
+			values[arg.first] = Substitute(arg.second, variables);
+		}
+
+		auto stage = (boost::format("%d:%s") % (i + 1) % step.m_Operation).str();
+		ISEG_INFO("running " << stage);
+
+		auto const before = std::chrono::steady_clock::now();
+		bool ok = false;
+		try
+		{
+			ok = FindOperation(step.m_Operation)->m_Run(handler, Arguments(values), error);
+		}
+		catch (std::exception& e)
+		{
+			error = e.what();
+		}
+		auto const after = std::chrono::steady_clock::now();
+		timings.push_back(StageTiming{stage, std::chrono::duration<double>(after - before).count()});
+
+		if (!ok)
+		{
+			error = (boost::format("line %d (%s): %s") % step.m_Line % step.m_Operation % error).str();
+			return false;
+		}
+	}
+	return true;
+}
+
+std::string BatchPipeline::Usage()
+{
+	std::stringstream ss;
+	ss << "Pipeline operations (one per line, 'operation key=value ...'):\n";
+	for (const auto& op : Operations())
+	{
+		ss << "\n  " << op.m_Name << " - " << op.m_Help << "\n";
+		for (const auto& a : op.m_Arguments)
+		{
+			ss << "      " << a.m_Name << (a.m_Default ? std::string("=") + a.m_Default : std::string(" (required)")) << "  " << a.m_Help << "\n";
+		}
+	}
+	ss << "\nValues may use ${input}, ${name} and ${output_dir}.\n";
+	return ss.str();
+}
+
+} // namespace iseg
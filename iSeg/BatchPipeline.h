@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace iseg {
+
+class SlicesHandler;
+
+/** \brief Declarative chain of SlicesHandler operations, run without any widgets.
+
+	A pipeline file has one step per line: the name of the operation followed by key=value
+	arguments, e.g.
+
+		load file=${input}
+		gaussian sigma=1.5 3d=1
+		threshold lower=100 upper=400
+		add_tissue tissue=1
+		save file=${output_dir}/${name}.h5
+
+	Empty lines and lines starting with '#' are ignored. Values may use the variables
+	${input}, ${name} (file name of the input without extension) and ${output_dir}.
+	Unknown operations, unknown arguments and missing required arguments are reported
+	when the file is read, before any subject is processed.
+*/
+class BatchPipeline
+{
+public:
+	struct Step
+	{
+		std::string m_Operation;
+		std::map<std::string, std::string> m_Arguments;
+		int m_Line;
+	};
+
+	struct StageTiming
+	{
+		std::string m_Stage;
+		double m_Seconds;
+	};
+
+	/// Parse a pipeline file, returns false and sets 'error' if it is not valid
+	bool Read(const std::string& filename, std::string& error);
+	bool Parse(std::istream& in, std::string& error);
+
+	const std::vector<Step>& Steps() const { return m_Steps; }
+
+	/// Run all steps on the handler, the timing of each step is appended to 'timings'
+	bool Run(SlicesHandler& handler, const std::map<std::string, std::string>& variables, std::vector<StageTiming>& timings, std::string& error) const;
+
+	/// Description of the operations and their arguments, for the command line help
+	static std::string Usage();
+
+private:
+	std::vector<Step> m_Steps;
+};
+
+} // namespace iseg
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "LazySliceLoader.h"
+
+#include "Data/ScopedTimer.h"
+
+#include "Core/HDF5IO.h"
+
+namespace iseg {
+
+LazySliceLoader::LazySliceLoader(const std::string& h5_filename, const std::string& source_dname, const std::string& target_dname, const std::string& tissue_dname, const std::vector<float*>& image_slices, const std::vector<float*>& work_slices, const std::vector<tissues_size_t*>& tissue_slices, size_t slice_size)
+		: m_FileName(h5_filename), m_SourceName(source_dname), m_TargetName(target_dname), m_TissueName(tissue_dname), m_ImageSlices(image_slices), m_WorkSlices(work_slices), m_TissueSlices(tissue_slices), m_SliceSize(slice_size), m_State(image_slices.size(), kPending)
+{
+}
+
+LazySliceLoader::~LazySliceLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Cancel = true;
+	}
+	if (m_Thread.joinable())
+	{
+		m_Thread.join();
+	}
+}
+
+void LazySliceLoader::Start(unsigned first_slice)
+{
+	if (m_State.empty())
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Done = true;
+		return;
+	}
+	m_Focus = std::min<unsigned>(first_slice, static_cast<unsigned>(m_State.size()) - 1);
+	m_Thread = std::thread(&LazySliceLoader::Run, this);
+}
+
+bool LazySliceLoader::Request(unsigned slice)
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	if (slice >= m_State.size())
+	{
+		return false;
+	}
+	if (m_State[slice] == kPending)
+	{
+		m_Focus = slice;
+		m_Loaded.wait(lock, [this, slice]() { return m_State[slice] != kPending || m_Done; });
+	}
+	return m_State[slice] == kLoaded;
+}
+
+bool LazySliceLoader::WaitForAll()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_Loaded.wait(lock, [this]() { return m_Done; });
+	return !m_Failed;
+}
+
+bool LazySliceLoader::IsLoaded(unsigned slice) const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return slice < m_State.size() && m_State[slice] == kLoaded;
+}
+
+std::vector<unsigned> LazySliceLoader::FailedSlices() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	std::vector<unsigned> failed;
+	for (unsigned i = 0; i < m_State.size(); ++i)
+	{
+		if (m_State[i] != kLoaded)
+			failed.push_back(i);
+	}
+	return failed;
+}
+
+bool LazySliceLoader::Finished() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Done;
+}
+
+bool LazySliceLoader::NextSlice(unsigned& slice)
+{
+	// called with locked mutex
+	unsigned const n = static_cast<unsigned>(m_State.size());
+
+	// first the slices around the most recent request, closest first
+	for (unsigned d = 0; d <= m_PrefetchRadius; ++d)
+	{
+		if (m_Focus + d < n && m_State[m_Focus + d] == kPending)
+		{
+			slice = m_Focus + d;
+			return true;
+		}
+		if (d <= m_Focus && m_State[m_Focus - d] == kPending)
+		{
+			slice = m_Focus - d;
+			return true;
+		}
+	}
+
+	// then fill the rest in file order
+	while (m_Sequential < n && m_State[m_Sequential] != kPending)
+	{
+		++m_Sequential;
+	}
+	slice = m_Sequential;
+	return m_Sequential < n;
+}
+
+bool LazySliceLoader::ReadSlice(long long file, unsigned slice)
+{
+	HDF5IO io;
+	size_t const offset = static_cast<size_t>(slice) * m_SliceSize;
+
+	bool ok = true;
+	if (m_SourceName.empty())
+	{
+		std::fill_n(m_ImageSlices[slice], m_SliceSize, 0.f);
+	}
+	else
+	{
+		ok = ok && io.ReadData(file, m_SourceName, offset, m_SliceSize, m_ImageSlices[slice]);
+	}
+	if (m_TargetName.empty())
+	{
+		std::fill_n(m_WorkSlices[slice], m_SliceSize, 0.f);
+	}
+	else
+	{
+		ok = ok && io.ReadData(file, m_TargetName, offset, m_SliceSize, m_WorkSlices[slice]);
+	}
+	if (m_TissueName.empty())
+	{
+		std::fill_n(m_TissueSlices[slice], m_SliceSize, 0);
+	}
+	else
+	{
+		ok = ok && io.ReadData(file, m_TissueName, offset, m_SliceSize, m_TissueSlices[slice]);
+	}
+	return ok;
+}
+
+void LazySliceLoader::Run()
+{
+	ScopedTimer timer("Lazy loading slices");
+
+	HDF5IO io;
+	auto file = io.Open(m_FileName);
+	bool ok = (file >= 0);
+	if (ok)
+	{
+		// missing arrays are initialized to 0
+		for (auto name : {&m_SourceName, &m_TargetName, &m_TissueName})
+		{
+			if (!name->empty() && H5Lexists(file, name->c_str(), H5P_DEFAULT) <= 0)
+			{
+				ISEG_WARNING("no " << *name << " array, will initialize to 0...");
+				name->clear();
+			}
+		}
+	}
+
+	// a slice which can not be read is left unloaded, the others are still read
+	size_t num_failed = 0;
+	while (ok)
+	{
+		unsigned slice = 0;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (m_Cancel || !NextSlice(slice))
+			{
+				break;
+			}
+		}
+
+		bool const read = ReadSlice(file, slice);
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_State[slice] = read ? kLoaded : kFailed;
+			if (read)
+				++m_NumLoaded;
+			else
+				++num_failed;
+		}
+		m_Loaded.notify_all();
+	}
+
+	if (!ok || num_failed != 0)
+	{
+		ISEG_ERROR("reading slices from " << m_FileName);
+	}
+	if (file >= 0)
+	{
+		io.Close(file);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Failed = !ok || m_NumLoaded < m_State.size();
+		m_Done = true;
+	}
+	m_Loaded.notify_all();
+}
+
+} // namespace iseg
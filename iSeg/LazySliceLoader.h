@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "Data/Types.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace iseg {
+
+/** \brief Reads the source, target and tissue slices of a project on demand from its HDF5 file.
+
+	The slice buffers must already be allocated. A slice which can not be read is not marked as
+	loaded, so callers can tell its buffers are not valid. Requested slices are read first, the slices
+	around the most recently requested slice are prefetched, and the remaining slices are
+	filled in the background. All HDF5 calls are made by the worker thread, so the caller must
+	not access the same file (or any other HDF5 file, unless the library is thread-safe) until
+	WaitForAll() has returned.
+*/
+class LazySliceLoader
+{
+public:
+	LazySliceLoader(const std::string& h5_filename, const std::string& source_dname, const std::string& target_dname, const std::string& tissue_dname, const std::vector<float*>& image_slices, const std::vector<float*>& work_slices, const std::vector<tissues_size_t*>& tissue_slices, size_t slice_size);
+	~LazySliceLoader();
+
+	/// Start reading in the background, beginning with 'first_slice'
+	void Start(unsigned first_slice);
+
+	/// Block until 'slice' has been read, and prefetch around it. Returns false if it could not be read
+	bool Request(unsigned slice);
+
+	/// Block until all slices have been read, returns false if reading failed
+	bool WaitForAll();
+
+	bool IsLoaded(unsigned slice) const;
+	bool Finished() const;
+
+	/// Slices which could not be read, their buffers are not valid
+	std::vector<unsigned> FailedSlices() const;
+
+	unsigned m_PrefetchRadius = 8;
+
+private:
+	void Run();
+	bool NextSlice(unsigned& slice);
+	bool ReadSlice(long long file, unsigned slice);
+
+	std::string m_FileName;
+	std::string m_SourceName;
+	std::string m_TargetName;
+	std::string m_TissueName;
+	std::vector<float*> m_ImageSlices;
+	std::vector<float*> m_WorkSlices;
+	std::vector<tissues_size_t*> m_TissueSlices;
+	size_t m_SliceSize;
+
+	mutable std::mutex m_Mutex;
+	std::condition_variable m_Loaded;
+	enum eSliceState : unsigned char {
+		kPending = 0,
+		kLoaded,
+		kFailed
+	};
+	std::vector<unsigned char> m_State;
+	size_t m_NumLoaded = 0;
+	unsigned m_Focus = 0;
+	unsigned m_Sequential = 0;
+	bool m_Done = false;
+	bool m_Failed = false;
+	bool m_Cancel = false;
+	std::thread m_Thread;
+};
+
+} // namespace iseg
@@ -12,6 +12,8 @@
 #include "Levelset.h"
 #include "bmp_read_1.h"
 
+#include "Core/SparseFieldLevelset.h"
+
 namespace iseg {
 
 Levelset::Levelset()
@@ -29,33 +31,16 @@ void Levelset::Init(unsigned short h, unsigned short w, float* levlset, float* k
 	if (!m_Image->Isloaded())
 		m_Image->Newbmp(w, h);
 
-	m_SliceprovideInstaller = SliceProviderInstaller::Getinst();
-	m_Sliceprovide = m_SliceprovideInstaller->Install(m_Area);
-
 	//	levset=levlset;
 	m_Image->SetWork(levlset, 1);
 	//	image.SaveWorkBitmap("D:\\Development\\segmentation\\sample images\\testdump.bmp");
 
-	m_Devx = m_Sliceprovide->GiveMe();
-	m_Devy = m_Sliceprovide->GiveMe();
-	m_Devxx = m_Sliceprovide->GiveMe();
-	m_Devxy = m_Sliceprovide->GiveMe();
-	m_Devyy = m_Sliceprovide->GiveMe();
-
-	for (unsigned i = 0; i < m_Area; ++i)
-	{
-		//		devxx[i]=devxy[i]=devyy[i]=0;
-		m_Devx[i] = m_Devy[i] = m_Devxx[i] = m_Devxy[i] = m_Devyy[i] = 0;
-	}
-	/*	kbits=sliceprovide->give_me();
-	Pbits=sliceprovide->give_me();*/
-	m_Px = m_Sliceprovide->GiveMe();
-	m_Py = m_Sliceprovide->GiveMe();
-	SetK(kbit);
-	SetP(Pbit);
+	m_Kbits = kbit;
+	m_Pbits = Pbit;
 	m_Epsilon = epsilon1;
 	m_Balloon1 = balloon;
 	m_Stepsize = step_size;
+	m_Engine.reset(new SparseFieldLevelset({m_Width, m_Height, 1}, m_Image->ReturnWork(), m_Kbits, m_Pbits, m_Balloon1, m_Epsilon, m_Stepsize));
 	m_Loaded = true;
 }
 
@@ -100,174 +85,28 @@ void Levelset::Init(unsigned short h, unsigned short w, Point p, float* kbit, fl
 
 void Levelset::Iterate(unsigned nrsteps, unsigned updatefreq)
 {
-	for (unsigned i = 1; i <= nrsteps; ++i)
+	if (m_Engine)
 	{
-		MakeStep();
-		//		cout << i;
-		if (i % updatefreq == 0 && updatefreq > 0)
-			Reinitialize();
-		//		cout << ".";
-	}
-
+		m_Engine->Iterate(nrsteps, updatefreq);
 	}
+}
 
 void Levelset::SetK(float* kbit)
 {
 	m_Kbits = kbit;
-}
-
-void Levelset::SetP(float* Pbit)
-{
-	m_Pbits = Pbit;
-	Diffx(m_Pbits, m_Px);
-	Diffy(m_Pbits, m_Py);
-}
-
-void Levelset::Reinitialize()
-{
-	float thresh[2];
-	thresh[0] = 1;
-	thresh[1] = 0;
-	m_Image->SwapBmpwork();
-	//	image.copy2bmp(levset);
-
-	m_Image->Threshold(thresh);
-	m_Image->SwapBmpwork();
-	m_Image->DeadReckoning(255);
-}
-
-void Levelset::MakeStep()
-{
-	float* levset;
-	levset = m_Image->ReturnWork();
-	Diffx(levset, m_Devx);
-	Diffy(levset, m_Devy);
-	if (m_Epsilon != 0)
-	{
-		Diffxx(levset, m_Devxx);
-		Diffxy(levset, m_Devxy);
-		Diffyy(levset, m_Devyy);
-	}
-
-	float dummy, dummy1;
-
-	for (unsigned i = 0; i < m_Area; i++)
+	if (m_Engine)
 	{
-		dummy = m_Devx[i] * m_Devx[i] + m_Devy[i] * m_Devy[i];
-		if (dummy != 0)
-		{
-			dummy1 = sqrt(dummy);
-			levset[i] +=
-					m_Stepsize * (m_Kbits[i] * (dummy1 * m_Balloon1 +
-																				 m_Epsilon *
-																						 (m_Devyy[i] * m_Devx[i] * m_Devx[i] -
-																								 2 * m_Devx[i] * m_Devy[i] * m_Devxy[i] +
-																								 m_Devxx[i] * m_Devy[i] * m_Devy[i]) /
-																						 dummy) -
-													 m_Px[i] * m_Devx[i] - m_Py[i] * m_Devy[i]);
-		}
+		m_Engine->SetSpeed(m_Kbits);
 	}
-
-	}
-
-void Levelset::Diffx(float* input, float* output) const
-{
-	unsigned k = 1;
-
-	for (unsigned short j = 0; j < m_Height; ++j)
-	{
-		for (unsigned short i = 1; i < m_Width - 1; ++i)
-		{
-			output[k] = (input[k + 1] - input[k - 1]) / 2;
-			++k;
-		}
-		k += 2;
-	}
-
-	for (unsigned k = 0; k < m_Area; k += m_Width)
-		output[k] = input[k + 1] - input[k];
-	for (unsigned k = m_Width - 1; k < m_Area; k += m_Width)
-		output[k] = input[k] - input[k - 1];
-}
-
-void Levelset::Diffy(float* input, float* output) const
-{
-	unsigned k = m_Width;
-	for (unsigned short j = 1; j < m_Height - 1; ++j)
-	{
-		for (unsigned short i = 0; i < m_Width; ++i)
-		{
-			output[k] = (input[k + m_Width] - input[k - m_Width]) / 2;
-			++k;
-		}
-	}
-
-	for (unsigned k = 0; k < m_Width; k++)
-		output[k] = input[k + m_Width] - input[k];
-	for (unsigned k = m_Area - m_Width; k < m_Area; k++)
-		output[k] = input[k] - input[k - m_Width];
 }
 
-void Levelset::Diffxx(float* input, float* output) const
-{
-	unsigned k = 1;
-	for (unsigned short j = 0; j < m_Height; ++j)
-	{
-		for (unsigned short i = 1; i < m_Width - 1; ++i)
-		{
-			output[k] = input[k + 1] - input[k] + input[k - 1];
-			++k;
-		}
-		k += 2;
-	}
-
-	for (unsigned k = 0; k < m_Area; k += m_Width)
-		output[k] = 0;
-	for (unsigned k = m_Width - 1; k < m_Area; k += m_Width)
-		output[k] = 0;
-}
-
-void Levelset::Diffxy(float* input, float* output) const
-{
-	unsigned k = m_Width + 1;
-	for (unsigned short j = 1; j < m_Height - 1; ++j)
-	{
-		for (unsigned short i = 1; i < m_Width - 1; ++i)
-		{
-			output[k] = (input[k + 1 + m_Width] - input[k - 1 + m_Width] -
-											input[k + 1 - m_Width] + input[k - m_Width - 1]) /
-									2;
-			++k;
-		}
-		k += 2;
-	}
-
-	for (unsigned k = 0; k < m_Area; k += m_Width)
-		output[k] = 0;
-	for (unsigned k = m_Width - 1; k < m_Area; k += m_Width)
-		output[k] = 0;
-	for (unsigned k = 1; k < m_Width; k++)
-		output[k] = 0;
-	for (unsigned k = m_Area - m_Width + 1; k < m_Area; k++)
-		output[k] = 0;
-}
-
-void Levelset::Diffyy(float* input, float* output) const
+void Levelset::SetP(float* Pbit)
 {
-	unsigned k = m_Width;
-	for (unsigned short j = 1; j < m_Height - 1; ++j)
+	m_Pbits = Pbit;
+	if (m_Engine)
 	{
-		for (unsigned short i = 0; i < m_Width; ++i)
-		{
-			output[k] = input[k + m_Width] - input[k] + input[k - m_Width];
-			++k;
-		}
+		m_Engine->SetPotential(m_Pbits);
 	}
-
-	for (unsigned k = 0; k < m_Width; k++)
-		output[k] = 0;
-	for (unsigned k = m_Area - m_Width; k < m_Area; k++)
-		output[k] = 0;
 }
 
 void Levelset::ReturnLevelset(float* output)
@@ -331,28 +170,7 @@ void Levelset::ReturnZerolevelset(std::vector<std::vector<Point>>* v1, std::vect
 
 Levelset::~Levelset()
 {
-	if (m_Loaded)
-	{
-		//		sliceprovide->take_back(levset);
-		m_Sliceprovide->TakeBack(m_Devx);
-		m_Sliceprovide->TakeBack(m_Devy);
-		m_Sliceprovide->TakeBack(m_Devxx);
-		m_Sliceprovide->TakeBack(m_Devxy);
-		m_Sliceprovide->TakeBack(m_Devyy);
-		m_Sliceprovide->TakeBack(m_Px);
-		m_Sliceprovide->TakeBack(m_Py);
-		//		if(ownlvlset)
-		//			sliceprovide->take_back(levset);
-
-		//		if(ownsliceprovider)
-		m_SliceprovideInstaller->Uninstall(m_Sliceprovide);
-		//		free(bmpinfo);
-	}
-
-	m_SliceprovideInstaller->ReturnInstance();
-	if (m_SliceprovideInstaller->Unused())
-		delete m_SliceprovideInstaller;
-
+	m_Engine.reset();
 	delete m_Image;
 }
 
@@ -11,13 +11,13 @@
 
 #include "Data/Point.h"
 
-#include "Core/SliceProvider.h"
-
+#include <memory>
 #include <vector>
 
 namespace iseg {
 
 class Bmphandler;
+class SparseFieldLevelset;
 
 class Levelset
 {
@@ -36,31 +36,16 @@ public:
 private:
 	bool m_Loaded;
 	Bmphandler* m_Image;
-	void Reinitialize();
-	void MakeStep();
 	float m_Stepsize;
 	float m_Epsilon;
 	float m_Balloon1;
 	unsigned short m_Width;
 	unsigned short m_Height;
 	unsigned m_Area;
-	//		float *levset;
-	float* m_Devx;
-	float* m_Devy;
-	float* m_Devxx;
-	float* m_Devxy;
-	float* m_Devyy;
 	float* m_Kbits;
 	float* m_Pbits;
-	float* m_Px;
-	float* m_Py;
-	void Diffx(float* input, float* output) const;
-	void Diffy(float* input, float* output) const;
-	void Diffxx(float* input, float* output) const;
-	void Diffxy(float* input, float* output) const;
-	void Diffyy(float* input, float* output) const;
-	SliceProvider* m_Sliceprovide;
-	SliceProviderInstaller* m_SliceprovideInstaller;
+	// only the narrow band around the zero level set is updated
+	std::unique_ptr<SparseFieldLevelset> m_Engine;
 };
 
 } // namespace iseg
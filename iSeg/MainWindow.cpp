@@ -51,6 +51,7 @@
 
 #include "RadiotherapyStructureSetImporter.h"
 
+#include "Interface/JobScheduler.h"
 #include "Interface/Plugin.h"
 #include "Interface/ProgressDialog.h"
 #include "Interface/RecentPlaces.h"
@@ -78,6 +79,7 @@
 #include <QProgressDialog>
 #include <QSettings>
 #include <QTextEdit>
+#include <QTimer>
 #include <QToolTip>
 
 #define str_macro(s) #s
@@ -1506,6 +1508,12 @@ MainWindow::MainWindow(SlicesHandler* hand3D, const QString& locationstring, con
 
 	this->setMinimumHeight(this->minimumHeight() + 50);
 
+	m_AutosaveTimer = new QTimer(this);
+	QObject_connect(m_AutosaveTimer, SIGNAL(timeout()), this, SLOT(AutosaveTimeout()));
+
+	QObject_connect(JobScheduler::Instance(), SIGNAL(JobProgress(QString,int)), this, SLOT(JobProgress(QString,int)));
+	QObject_connect(JobScheduler::Instance(), SIGNAL(JobFinished(int,bool)), this, SLOT(JobFinished(int,bool)));
+
 	m_Modified = false;
 	m_NewDataAfterSwap = false;
 }
@@ -1540,6 +1548,9 @@ void MainWindow::closeEvent(QCloseEvent* qce)
 			delete m_VV3Dbmp;
 		}
 
+		JobScheduler::Instance()->CancelAll();
+		JobScheduler::Instance()->WaitForAll();
+
 		SaveSettings();
 		SaveLoadProj(m_MLoadprojfilename.m_CurrentFilename);
 		QMainWindow::closeEvent(qce);
@@ -1669,6 +1680,7 @@ void MainWindow::ExecuteSwapxy()
 		h = m_Handler3D->Width();
 		nrslices = m_Handler3D->NumSlices();
 		QString str1;
+		std::vector<float> bmp_data;
 		for (int i = 0; i < m_MultidatasetWidget->GetNumberOfDatasets(); i++)
 		{
 			// Swap all but the active one
@@ -1676,7 +1688,7 @@ void MainWindow::ExecuteSwapxy()
 			{
 				std::string temp_file_name = "bmp_float_eds_" + std::to_string(i) + ".raw";
 				str1 = QDir::temp().absoluteFilePath(QString(temp_file_name.c_str()));
-				if (SlicesHandler::SaveRawXySwapped(str1.ascii(), m_MultidatasetWidget->GetBmpData(i), w, h, nrslices) != 0)
+				if (SlicesHandler::SaveRawXySwapped(str1.ascii(), m_MultidatasetWidget->GetBmpData(i, bmp_data), w, h, nrslices) != 0)
 					ok = false;
 
 				if (ok)
@@ -1725,6 +1737,7 @@ void MainWindow::ExecuteSwapxz()
 		h = m_Handler3D->Height();
 		nrslices = m_Handler3D->Width();
 		QString str1;
+		std::vector<float> bmp_data;
 		for (int i = 0; i < m_MultidatasetWidget->GetNumberOfDatasets(); i++)
 		{
 			// Swap all but the active one
@@ -1732,7 +1745,7 @@ void MainWindow::ExecuteSwapxz()
 			{
 				std::string temp_file_name = "bmp_float_" + std::to_string(i) + ".raw";
 				str1 = QDir::temp().absoluteFilePath(QString(temp_file_name.c_str()));
-				if (SlicesHandler::SaveRawXzSwapped(str1.ascii(), m_MultidatasetWidget->GetBmpData(i), w, h, nrslices) != 0)
+				if (SlicesHandler::SaveRawXzSwapped(str1.ascii(), m_MultidatasetWidget->GetBmpData(i, bmp_data), w, h, nrslices) != 0)
 					ok = false;
 
 				if (ok)
@@ -1784,6 +1797,7 @@ void MainWindow::ExecuteSwapyz()
 		h = m_Handler3D->NumSlices();
 		nrslices = m_Handler3D->Height();
 		QString str1;
+		std::vector<float> bmp_data;
 		for (int i = 0; i < m_MultidatasetWidget->GetNumberOfDatasets(); i++)
 		{
 			// Swap all but the active one
@@ -1791,7 +1805,7 @@ void MainWindow::ExecuteSwapyz()
 			{
 				std::string temp_file_name = "bmp_float_" + std::to_string(i) + ".raw";
 				str1 = QDir::temp().absoluteFilePath(QString(temp_file_name.c_str()));
-				if (SlicesHandler::SaveRawYzSwapped(str1.ascii(), m_MultidatasetWidget->GetBmpData(i), w, h, nrslices) != 0)
+				if (SlicesHandler::SaveRawYzSwapped(str1.ascii(), m_MultidatasetWidget->GetBmpData(i, bmp_data), w, h, nrslices) != 0)
 					ok = false;
 
 				if (ok)
@@ -2426,8 +2440,8 @@ void MainWindow::ExecuteLoadsurface()
 	MaybeSafe();
 
 	bool ok = true;
-	QString loadfilename = RecentPlaces::GetOpenFileName(this, "Import Surface/Lines", QString::null, "Surfaces & Polylines (*.stl *.vtk)");
-	if (!loadfilename.isEmpty())
+	QStringList loadfilenames = RecentPlaces::GetOpenFileNames(this, "Import Surfaces/Lines", QString::null, "Surfaces & Polylines (*.stl *.vtk)");
+	if (!loadfilenames.isEmpty())
 	{
 		QCheckBox* cb = new QCheckBox("Intersect Only");
 		cb->setToolTip("If on, the intersection of the surface with the voxels will be computed, not the interior of a closed surface.");
@@ -2447,7 +2461,18 @@ void MainWindow::ExecuteLoadsurface()
 		if (overwrite == 2)
 			return;
 
-		ok = m_Handler3D->LoadSurface(loadfilename.toStdString(), overwrite == 0, intersect);
+		DataSelection data_selection;
+		data_selection.allSlices = true;
+		data_selection.work = true;
+		emit BeginDatachange(data_selection, this);
+
+		// only the first surface may overwrite the target, the others are added
+		for (int i = 0; i < loadfilenames.size(); ++i)
+		{
+			ok = m_Handler3D->LoadSurface(loadfilenames[i].toStdString(), overwrite == 0 && i == 0, intersect) && ok;
+		}
+
+		emit EndDatachange(this);
 	}
 
 	if (ok)
@@ -2652,7 +2677,10 @@ void MainWindow::ExecuteSaveprojas()
 
 		if (QFile::exists(source_file_name_without_extension + ".h5"))
 			QFile::remove(source_file_name_without_extension + ".h5");
-		QFile::rename(temp_file_name_without_extension + ".h5", source_file_name_without_extension + ".h5");
+		if (QFile::rename(temp_file_name_without_extension + ".h5", source_file_name_without_extension + ".h5"))
+		{
+			m_Handler3D->SavedImageFileRenamed((temp_file_name_without_extension + ".h5").toStdString(), (source_file_name_without_extension + ".h5").toStdString());
+		}
 
 		progress.setValue(num_tasks);
 	}
@@ -2768,6 +2796,9 @@ void MainWindow::SaveSettings()
 	settings.setValue("NumberOfUndoArrays", this->m_Handler3D->GetNumberOfUndoArrays());
 	settings.setValue("Compression", this->m_Handler3D->GetCompression());
 	settings.setValue("ContiguousMemory", this->m_Handler3D->GetContiguousMemory());
+	settings.setValue("LazyLoading", this->m_Handler3D->GetLazyLoading());
+	settings.setValue("SaveInBackground", m_SaveInBackground);
+	settings.setValue("AutosaveInterval", m_AutosaveInterval);
 	settings.setValue("BloscEnabled", BloscEnabled());
 	settings.setValue("SaveTarget", this->m_Handler3D->SaveTarget());
 	settings.endGroup();
@@ -2904,6 +2935,9 @@ void MainWindow::LoadSettings(const char* loadfilename)
 		this->m_Handler3D->SetNumberOfUndoArrays(settings.value("NumberOfUndoArrays", 20).toUInt());
 		this->m_Handler3D->SetCompression(settings.value("Compression", 0).toInt());
 		this->m_Handler3D->SetContiguousMemory(settings.value("ContiguousMemory", true).toBool());
+		this->m_Handler3D->SetLazyLoading(settings.value("LazyLoading", false).toBool());
+		SetSaveInBackground(settings.value("SaveInBackground", false).toBool());
+		SetAutosaveInterval(settings.value("AutosaveInterval", 0).toInt());
 		SetBloscEnabled(settings.value("BloscEnabled", false).toBool());
 		this->m_Handler3D->SetSaveTarget(settings.value("SaveTarget", false).toBool());
 		settings.endGroup();
@@ -2972,6 +3006,50 @@ void MainWindow::ExecuteSaveactiveslicesas()
 }
 
 void MainWindow::ExecuteSaveproj()
+{
+	Saveproj(m_SaveInBackground);
+}
+
+void MainWindow::SetAutosaveInterval(int minutes)
+{
+	m_AutosaveInterval = std::max(minutes, 0);
+	if (m_AutosaveInterval > 0)
+	{
+		m_AutosaveTimer->start(m_AutosaveInterval * 60 * 1000);
+	}
+	else
+	{
+		m_AutosaveTimer->stop();
+	}
+}
+
+void MainWindow::JobProgress(QString name, int percent)
+{
+	statusBar()->showMessage(QString("%1: %2%").arg(name).arg(percent));
+}
+
+void MainWindow::JobFinished(int id, bool committed)
+{
+	if (JobScheduler::Instance()->NumberOfJobs() == 0)
+	{
+		statusBar()->showMessage("Ready");
+	}
+}
+
+void MainWindow::AutosaveTimeout()
+{
+	// skip if nothing changed, an operation is ongoing or the last snapshot is still being written
+	if (!m_AutosavePending || m_MEditingmode || m_MSaveprojfilename.isEmpty() ||
+			m_UndoStarted || m_Handler3D->SnapshotInProgress())
+	{
+		return;
+	}
+
+	ISEG_INFO("autosaving " << m_MSaveprojfilename.toStdString() << " to a recovery project");
+	Saveproj(true, true);
+}
+
+void MainWindow::Saveproj(bool background, bool autosave)
 {
 	DataSelection data_selection;
 	data_selection.bmp = true;
@@ -2991,8 +3069,21 @@ void MainWindow::ExecuteSaveproj()
 	{
 		if (!m_MSaveprojfilename.isEmpty())
 		{
+			// a pending snapshot still has to rename its temporary files
+			m_Handler3D->WaitForSnapshot();
+
+			// autosave never overwrites the open project with state the user did not save
+			QString const open_project_file_name = m_MSaveprojfilename;
+			QString project_file_name = m_MSaveprojfilename;
+			if (autosave)
+			{
+				QFileInfo project_info(m_MSaveprojfilename);
+				project_file_name = project_info.dir().absoluteFilePath(project_info.completeBaseName() + "Autosave.prj");
+			}
+
 			//Append "Temp" at the end of the file name and rename it at the end of the successful saving process
-			QString temp_file_name = QString(m_MSaveprojfilename);
+			//In the background mode the files are renamed once the snapshot has been written completely
+			QString temp_file_name = QString(project_file_name);
 			int after_dot = temp_file_name.lastIndexOf('.');
 			if (after_dot != 0)
 				temp_file_name =
@@ -3001,12 +3092,10 @@ void MainWindow::ExecuteSaveproj()
 			else
 				temp_file_name = temp_file_name + "Temp.prj";
 
-			std::string pj_fn = m_MSaveprojfilename.toStdString();
-
 			QString source_file_name_without_extension;
-			after_dot = m_MSaveprojfilename.lastIndexOf('.');
+			after_dot = project_file_name.lastIndexOf('.');
 			if (after_dot != -1)
-				source_file_name_without_extension = m_MSaveprojfilename.mid(0, after_dot);
+				source_file_name_without_extension = project_file_name.mid(0, after_dot);
 
 			QString temp_file_name_without_extension;
 			after_dot = temp_file_name.lastIndexOf('.');
@@ -3015,8 +3104,11 @@ void MainWindow::ExecuteSaveproj()
 
 			int num_tasks = 3;
 			QProgressDialog progress("Save in progress...", "Cancel", 0, num_tasks, this);
-			progress.show();
-			QApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+			if (!background)
+			{
+				progress.show();
+				QApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+			}
 			progress.setWindowModality(Qt::WindowModal);
 			progress.setModal(true);
 			progress.setValue(1);
@@ -3026,8 +3118,20 @@ void MainWindow::ExecuteSaveproj()
 
 			m_MSaveprojfilename = temp_file_name;
 
+			// update the image data of the last save in place, only modified slices are written
+			QString h5_file_name = source_file_name_without_extension + ".h5";
+			QString temp_h5_file_name = temp_file_name_without_extension + ".h5";
+			if (!background && m_Handler3D->IsSavedImageFile(h5_file_name.toStdString()))
+			{
+				QFile::remove(temp_h5_file_name);
+				if (QFile::rename(h5_file_name, temp_h5_file_name))
+				{
+					m_Handler3D->SavedImageFileRenamed(h5_file_name.toStdString(), temp_h5_file_name.toStdString());
+				}
+			}
+
 			//FILE *fp=handler3D->SaveProject(m_saveprojfilename.ascii(),"xmf");
-			FILE* fp = m_Handler3D->SaveProject(temp_file_name.ascii(), "xmf");
+			FILE* fp = m_Handler3D->SaveProject(temp_file_name.ascii(), "xmf", background);
 			fp = m_BitstackWidget->SaveProj(fp);
 			unsigned short save_proj_version = 12;
 			fp = TissueInfos::SaveTissues(fp, save_proj_version);
@@ -3057,9 +3161,28 @@ void MainWindow::ExecuteSaveproj()
 			fp = SaveNotes(fp, save_proj_version);
 
 			fclose(fp);
+			m_AutosavePending = false;
 
 			progress.setValue(2);
 
+			if (background)
+			{
+				// the slices are still being written, the previous files are replaced when they are complete
+				m_MSaveprojfilename = open_project_file_name;
+				std::vector<std::pair<std::string, std::string>> renames;
+				for (auto ext : {".h5", ".xmf", ".prj"})
+				{
+					renames.push_back(std::make_pair((temp_file_name_without_extension + ext).toStdString(), (source_file_name_without_extension + ext).toStdString()));
+				}
+				if (!m_Handler3D->ReplaceOnSnapshotSuccess(renames))
+				{
+					ISEG_ERROR("could not save " << project_file_name.toStdString());
+				}
+				progress.setValue(num_tasks);
+				emit EndDataexport(this);
+				return;
+			}
+
 			QMessageBox m_box;
 			m_box.setWindowTitle("Saving project");
 			m_box.setText("The project you are trying to save is open somewhere else. "
@@ -3113,7 +3236,10 @@ void MainWindow::ExecuteSaveproj()
 					remove_success = QFile::remove(source_file_name_without_extension + ".h5");
 				}
 			}
-			QFile::rename(temp_file_name_without_extension + ".h5", source_file_name_without_extension + ".h5");
+			if (QFile::rename(temp_h5_file_name, h5_file_name))
+			{
+				m_Handler3D->SavedImageFileRenamed(temp_h5_file_name.toStdString(), h5_file_name.toStdString());
+			}
 
 			m_MSaveprojfilename = source_file_name_without_extension + ".prj";
 
@@ -3163,6 +3289,8 @@ void MainWindow::Loadproj(const QString& loadfilename)
 	}
 
 	emit EndDatachange(this, iseg::ClearUndo);
+	// the loaded project is not modified
+	m_AutosavePending = false;
 	TissuenrChanged(m_TissueTreeWidget->GetCurrentType() - 1);
 
 	PixelsizeChanged();
@@ -5624,6 +5752,9 @@ void MainWindow::SliceChanged()
 
 void MainWindow::Slices3dChanged(bool new_bitstack)
 {
+	// the results of background jobs do not fit the new slices
+	JobScheduler::Instance()->CancelAll();
+
 	if (new_bitstack)
 	{
 		m_BitstackWidget->Newloaded();
@@ -6456,36 +6587,32 @@ void MainWindow::ExecuteRemoveUnusedTissues()
 
 void MainWindow::ExecuteCleanup()
 {
-	tissues_size_t** slices = new tissues_size_t*[m_Handler3D->EndSlice() - m_Handler3D->StartSlice()];
+	int rate, minsize;
+	CleanerParams cp(&rate, &minsize);
+	cp.exec();
+	if (rate == 0 && minsize == 0)
+		return;
+
 	tissuelayers_size_t activelayer = m_Handler3D->ActiveTissuelayer();
-	for (unsigned short i = m_Handler3D->StartSlice(); i < m_Handler3D->EndSlice(); i++)
-	{
-		slices[i - m_Handler3D->StartSlice()] = m_Handler3D->ReturnTissues(activelayer, i);
-	}
-	TissueCleaner tc(slices, m_Handler3D->EndSlice() - m_Handler3D->StartSlice(), m_Handler3D->Width(), m_Handler3D->Height());
-	if (!tc.Allocate())
+	auto all_slices = m_Handler3D->TissueSlices(activelayer);
+	std::vector<tissues_size_t*> slices(all_slices.begin() + m_Handler3D->StartSlice(), all_slices.begin() + m_Handler3D->EndSlice());
+
+	DataSelection data_selection;
+	data_selection.allSlices = true;
+	data_selection.tissues = true;
+	emit BeginDatachange(data_selection, this);
+
+	TissueCleaner tc(slices, m_Handler3D->Width(), m_Handler3D->Height());
+	if (!tc.ConnectedComponents())
 	{
+		emit EndDatachange(this, iseg::AbortUndo);
 		QMessageBox::information(this, "iSeg", "Not enough memory.\nThis operation cannot be performed.\n");
+		return;
 	}
-	else
-	{
-		int rate, minsize;
-		CleanerParams cp(&rate, &minsize);
-		cp.exec();
-		if (rate == 0 && minsize == 0)
-			return;
-
-		DataSelection data_selection;
-		data_selection.allSlices = true;
-		data_selection.tissues = true;
-		emit BeginDatachange(data_selection, this);
+	tc.MakeStat();
+	tc.Clean(1.0f / rate, minsize);
 
-		tc.ConnectedComponents();
-		tc.MakeStat();
-		tc.Clean(1.0f / rate, minsize);
-
-		emit EndDatachange(this);
-	}
+	emit EndDatachange(this);
 }
 
 void MainWindow::Wheelrotated(int delta)
@@ -6566,6 +6693,25 @@ void MainWindow::HandleBeginDatachange(DataSelection& dataSelection, QWidget* se
 	m_UndoStarted = beginUndo || m_UndoStarted;
 	m_ChangeData = dataSelection;
 
+	// Lazily opened projects must be complete before the data is modified
+	m_Handler3D->WaitForLazyLoad();
+
+	// Background jobs using the modified slices are out of date
+	unsigned const leased_data = (dataSelection.bmp ? SliceLease::kSource : 0) |
+															 (dataSelection.work ? SliceLease::kTarget : 0) |
+															 (dataSelection.tissues ? SliceLease::kTissues : 0);
+	if (leased_data != 0)
+	{
+		unsigned const start = dataSelection.allSlices ? 0 : dataSelection.sliceNr;
+		unsigned const end = dataSelection.allSlices ? m_Handler3D->NumSlices() : dataSelection.sliceNr + 1;
+		JobScheduler::Instance()->CancelConflicting(SliceLease(leased_data, SliceLease::kWrite, start, end));
+	}
+
+	// Remember which slices need to be written on the next save, this also copies slices
+	// which are still needed by a snapshot written in the background
+	m_Handler3D->SetDirty(dataSelection);
+	m_AutosavePending = true;
+
 	// Handle pending transforms
 	if (m_MethodTab->currentWidget() == m_TransformWidget && sender != m_TransformWidget)
 	{
@@ -6760,6 +6906,11 @@ void MainWindow::CancelTransformHelper()
 
 void MainWindow::HandleBeginDataexport(DataSelection& dataSelection, QWidget* sender)
 {
+	// Lazily opened projects must be complete before the data is exported, and
+	// HDF5 files can only be accessed once the snapshot is written
+	m_Handler3D->WaitForLazyLoad();
+	m_Handler3D->WaitForSnapshot();
+
 	// Handle pending transforms
 	if (m_MethodTab->currentWidget() == m_TransformWidget &&
 			(dataSelection.bmp || dataSelection.work || dataSelection.tissues))
@@ -6788,6 +6939,9 @@ void MainWindow::ExecuteSavecolorlookup()
 	if (!savefilename.endsWith(QString(".lut")))
 		savefilename.append(".lut");
 
+	// the HDF5 library may not be used concurrently with the lazy loader
+	m_Handler3D->WaitForLazyLoad();
+
 	XdmfImageWriter writer(savefilename.toStdString().c_str());
 	writer.SetCompression(m_Handler3D->GetCompression());
 	if (!writer.WriteColorLookup(m_Handler3D->GetColorLookupTable().get(), true))
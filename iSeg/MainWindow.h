@@ -34,6 +34,7 @@ class QSpinBox;
 class QSlider;
 class QTreeWidgetItem;
 class QSignalMapper;
+class QTimer;
 class QVBoxLayout;
 class QWidget;
 
@@ -119,6 +120,7 @@ protected:
 	void ResetBrightnesscontrast();
 	void UpdateBrightnesscontrast(bool bmporwork, bool paint = true);
 	FILE* SaveNotes(FILE* fp, unsigned short version);
+	void Saveproj(bool background, bool autosave = false);
 	FILE* LoadNotes(FILE* fp, unsigned short version);
 
 signals:
@@ -316,7 +318,19 @@ private:
 	DataSelection m_ChangeData;
 	bool m_NewDataAfterSwap;
 
+	bool GetSaveInBackground() const { return m_SaveInBackground; }
+	void SetSaveInBackground(bool v) { m_SaveInBackground = v; }
+	int GetAutosaveInterval() const { return m_AutosaveInterval; }
+	void SetAutosaveInterval(int minutes);
+	bool m_SaveInBackground = false;
+	int m_AutosaveInterval = 0;
+	bool m_AutosavePending = false;
+	QTimer* m_AutosaveTimer;
+
 private slots:
+	void AutosaveTimeout();
+	void JobProgress(QString name, int percent);
+	void JobFinished(int id, bool committed);
 	void UpdateBmp();
 	void UpdateWork();
 	void UpdateTissue();
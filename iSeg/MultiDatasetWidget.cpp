@@ -25,6 +25,8 @@
 #include <QFileDialog>
 #include <QGroupBox>
 
+#include <cstdint>
+
 namespace iseg {
 
 MultiDatasetWidget::MultiDatasetWidget(SlicesHandler* hand3D, QWidget* parent, Qt::WindowFlags wFlags)
@@ -380,21 +382,11 @@ bool MultiDatasetWidget::AddDatasetToList(MultiDatasetWidget::SDatasetInfo& newR
 
 void MultiDatasetWidget::CopyImagesSlices(const std::vector<const float*>& bmp_slices, const std::array<size_t, 3>& dims, MultiDatasetWidget::SDatasetInfo& newRadioButton)
 {
-	const size_t nrslices = dims[2];
-	const size_t width = dims[0];
-	const size_t height = dims[1];
-	const size_t size = width * height;
-
-	newRadioButton.m_Width = width;
-	newRadioButton.m_Height = height;
+	newRadioButton.m_Width = dims[0];
+	newRadioButton.m_Height = dims[1];
 
-	newRadioButton.m_BmpSlices.clear();
-	for (int i = 0; i < nrslices; i++)
-	{
-		float* bmp_data = (float*)malloc(sizeof(float) * size);
-		memcpy(bmp_data, bmp_slices.at(i), sizeof(float) * size);
-		newRadioButton.m_BmpSlices.push_back(bmp_data);
-	}
+	std::vector<const float*> slices(bmp_slices.begin(), bmp_slices.begin() + dims[2]);
+	newRadioButton.m_BmpSlices.Assign(slices, dims[0] * dims[1]);
 }
 
 void MultiDatasetWidget::SwitchDataset()
@@ -416,12 +408,19 @@ void MultiDatasetWidget::SwitchDataset()
 				data_selection.tissues = false;
 				emit BeginDatachange(data_selection, this, false);
 
-				const int n_slices = radio_button.m_BmpSlices.size();
-				assert(radio_button.m_BmpSlices.size() == m_Handler3D->NumSlices());
+				const std::int64_t n_slices = radio_button.m_BmpSlices.NumSlices();
+				assert(radio_button.m_BmpSlices.NumSlices() == m_Handler3D->NumSlices());
 
-				for (int i = 0; i < n_slices; i++)
+#pragma omp parallel
 				{
-					m_Handler3D->Copy2bmp(i, radio_button.m_BmpSlices.at(i), 1);
+					std::vector<float> buffer(radio_button.m_BmpSlices.Area());
+
+#pragma omp for
+					for (std::int64_t i = 0; i < n_slices; i++)
+					{
+						radio_button.m_BmpSlices.Decompress(i, buffer.data());
+						m_Handler3D->Copy2bmp(static_cast<unsigned short>(i), buffer.data(), 1);
+					}
 				}
 
 				m_ItIsBeingLoaded = true;
@@ -473,9 +472,6 @@ void MultiDatasetWidget::RemoveDataset()
 			m_VboxDatasets->removeWidget(radio_button.m_RadioButton);
 			delete radio_button.m_RadioButton;
 
-			std::for_each(radio_button.m_BmpSlices.begin(), radio_button.m_BmpSlices.end(), [](float* element) { free(element); });
-			radio_button.m_BmpSlices.clear();
-
 			m_RadioButtons.erase(m_RadioButtons.begin() + index);
 
 			break;
@@ -537,21 +533,32 @@ bool MultiDatasetWidget::IsActive(const int multiDS_index)
 	return false;
 }
 
-std::vector<float*> MultiDatasetWidget::GetBmpData(const int multiDS_index)
+std::vector<float*> MultiDatasetWidget::GetBmpData(const int multiDS_index, std::vector<float>& buffer)
 {
+	std::vector<float*> slices;
 	if (multiDS_index < m_RadioButtons.size())
 	{
-		return m_RadioButtons.at(multiDS_index).m_BmpSlices;
+		const auto& bmp_slices = m_RadioButtons.at(multiDS_index).m_BmpSlices;
+		const size_t area = bmp_slices.Area();
+		buffer.resize(area * bmp_slices.NumSlices());
+		for (size_t i = 0; i < bmp_slices.NumSlices(); i++)
+		{
+			slices.push_back(buffer.data() + i * area);
+		}
+		bmp_slices.Decompress(slices);
 	}
-	return std::vector<float*>();
+	return slices;
 }
 
 void MultiDatasetWidget::SetBmpData(const int multiDS_index, std::vector<float*> bmp_bits_vc)
 {
 	if (multiDS_index < m_RadioButtons.size())
 	{
-		m_RadioButtons.at(multiDS_index).m_BmpSlices = bmp_bits_vc;
+		auto& info = m_RadioButtons.at(multiDS_index);
+		std::vector<const float*> slices(bmp_bits_vc.begin(), bmp_bits_vc.end());
+		info.m_BmpSlices.Assign(slices, static_cast<size_t>(info.m_Width) * info.m_Height);
 	}
+	std::for_each(bmp_bits_vc.begin(), bmp_bits_vc.end(), [](float* element) { free(element); });
 }
 
 } // namespace iseg
@@ -11,6 +11,8 @@
 
 #include "Data/DataSelection.h"
 
+#include "Core/CompressedSlices.h"
+
 #include <QWidget>
 
 #include <map>
@@ -36,7 +38,8 @@ public:
 		QStringList m_DatasetFilepath;
 		unsigned m_Width;
 		unsigned m_Height;
-		std::vector<float*> m_BmpSlices;
+		/// Image data kept compressed, it is only restored when switching to the dataset
+		CompressedSlices m_BmpSlices;
 		bool m_IsActive;
 	};
 
@@ -47,7 +50,9 @@ public:
 	bool IsActive(const int multiDS_index);
 	bool IsChecked(const int multiDS_index);
 
-	std::vector<float*> GetBmpData(const int multiDS_index);
+	/// Restores the image data into buffer, returns the slice pointers into buffer
+	std::vector<float*> GetBmpData(const int multiDS_index, std::vector<float>& buffer);
+	/// Compresses the image data and frees the slices (allocated with malloc)
 	void SetBmpData(const int multiDS_index, std::vector<float*> bmp_bits_vc);
 
 protected:
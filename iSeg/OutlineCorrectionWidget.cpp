@@ -743,7 +743,10 @@ void OutlineCorrectionWidget::ExecutePushed()
 		auto selected_background_id = m_FillSkinParams->m_BackgroundValue->text().toInt();
 		auto selected_skin_id = m_FillSkinParams->m_SkinValue->text().toInt();
 		if (m_FillSkinParams->m_AllSlices->isChecked())
-			m_Handler3D->FillSkin3d(x_thick, y_thick, z_thick, selected_background_id, selected_skin_id);
+		{
+			ProgressDialog progress("Fill Skin in progress...", this);
+			m_Handler3D->FillSkin3d(x_thick, y_thick, z_thick, selected_background_id, selected_skin_id, &progress);
+		}
 		else
 			m_Bmphand->FillSkin(x_thick, y_thick, selected_background_id, selected_skin_id);
 	}
@@ -30,8 +30,11 @@ Settings::Settings(QWidget* parent)
 
 	this->m_Ui->spinBoxCompression->setValue(m_MainWindow->m_Handler3D->GetCompression());
 	this->m_Ui->checkBoxContiguousMemory->setChecked(m_MainWindow->m_Handler3D->GetContiguousMemory());
+	this->m_Ui->checkBoxLazyLoading->setChecked(m_MainWindow->m_Handler3D->GetLazyLoading());
 	this->m_Ui->checkBoxEnableBlosc->setChecked(BloscEnabled());
 	this->m_Ui->checkBoxSaveTarget->setChecked(m_MainWindow->m_Handler3D->SaveTarget());
+	this->m_Ui->checkBoxSaveInBackground->setChecked(m_MainWindow->GetSaveInBackground());
+	this->m_Ui->spinBoxAutosaveInterval->setValue(m_MainWindow->GetAutosaveInterval());
 }
 
 Settings::~Settings() { delete m_Ui; }
@@ -41,8 +44,11 @@ void Settings::accept()
 	ISEG_INFO("setting compression = " << this->m_Ui->spinBoxCompression->value());
 	m_MainWindow->m_Handler3D->SetCompression(this->m_Ui->spinBoxCompression->value());
 	m_MainWindow->m_Handler3D->SetContiguousMemory(this->m_Ui->checkBoxContiguousMemory->isChecked());
+	m_MainWindow->m_Handler3D->SetLazyLoading(this->m_Ui->checkBoxLazyLoading->isChecked());
 	SetBloscEnabled(this->m_Ui->checkBoxEnableBlosc->isChecked());
 	m_MainWindow->m_Handler3D->SetSaveTarget(this->m_Ui->checkBoxSaveTarget->isChecked());
+	m_MainWindow->SetSaveInBackground(this->m_Ui->checkBoxSaveInBackground->isChecked());
+	m_MainWindow->SetAutosaveInterval(this->m_Ui->spinBoxAutosaveInterval->value());
 
 	m_MainWindow->SaveSettings();
 	this->hide();
@@ -13,20 +13,160 @@
 #include "SlicesHandler.h"
 #include "bmp_read_1.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <vector>
 
 #ifndef M_PI
 #	define M_PI 3.1415926535
 #endif
 
-#ifndef round
-#	define round(x) (x < 0 ? ceil((x)-0.5) : floor((x) + 0.5))
-#endif
-
 namespace iseg {
 
+namespace {
+/** \brief Maps the pixels of one output row to the original slice.
+
+	For affine transforms the original coordinates change by a constant increment along
+	the row, so only the projective case needs a division per pixel.
+*/
+class RowMapping
+{
+public:
+	RowMapping(const double* matrix, unsigned short width, unsigned short height, bool bilinear)
+			: m_Matrix(matrix), m_Width(width), m_Height(height), m_Bilinear(bilinear), m_Index(width), m_X(bilinear ? width : 0), m_Y(bilinear ? width : 0)
+	{
+		m_Affine = (matrix[6] == 0.0 && matrix[7] == 0.0 && matrix[8] != 0.0);
+	}
+
+	void SetRow(unsigned y)
+	{
+		const double* m = m_Matrix;
+		double const a0 = m[1] * y + m[2];
+		double const b0 = m[4] * y + m[5];
+		double const c0 = m[7] * y + m[8];
+		double const w = m_Width - 0.5;
+		double const h = m_Height - 0.5;
+
+		// start and increment of the original coordinates, used in the affine case
+		double const inv_c0 = 1.0 / c0;
+		double const xs0 = a0 * inv_c0, dxs = m[0] * inv_c0;
+		double const ys0 = b0 * inv_c0, dys = m[3] * inv_c0;
+
+		for (int x = 0; x < m_Width; ++x)
+		{
+			double xs, ys;
+			if (m_Affine)
+			{
+				xs = xs0 + dxs * x;
+				ys = ys0 + dys * x;
+			}
+			else
+			{
+				double const c = c0 + m[6] * x;
+				xs = (a0 + m[0] * x) / c;
+				ys = (b0 + m[3] * x) / c;
+			}
+
+			// equivalent to rounding half away from zero and checking the bounds, false for NaN
+			bool const inside = (xs > -0.5 && xs < w && ys > -0.5 && ys < h);
+			m_Index[x] = inside ? static_cast<int>(ys + 0.5) * m_Width + static_cast<int>(xs + 0.5) : -1;
+			if (m_Bilinear)
+			{
+				m_X[x] = static_cast<float>(xs);
+				m_Y[x] = static_cast<float>(ys);
+			}
+		}
+	}
+
+	template<typename T>
+	void Nearest(const T* original, T* output) const
+	{
+		for (int x = 0; x < m_Width; ++x)
+		{
+			int const i = m_Index[x];
+			output[x] = i >= 0 ? original[i] : T(0);
+		}
+	}
+
+	void Bilinear(const float* original, float* output) const
+	{
+		for (int x = 0; x < m_Width; ++x)
+		{
+			if (m_Index[x] < 0)
+			{
+				output[x] = 0.0f;
+				continue;
+			}
+
+			// the neighbors are clamped to the slice, which covers the half pixel at the border
+			float const xs = std::min(std::max(m_X[x], 0.0f), m_Width - 1.0f);
+			float const ys = std::min(std::max(m_Y[x], 0.0f), m_Height - 1.0f);
+			int const x0 = static_cast<int>(xs);
+			int const y0 = static_cast<int>(ys);
+			int const x1 = std::min(x0 + 1, m_Width - 1);
+			int const y1 = std::min(y0 + 1, m_Height - 1);
+			float const fx = xs - x0;
+			float const fy = ys - y0;
+
+			const float* r0 = original + y0 * m_Width;
+			const float* r1 = original + y1 * m_Width;
+			float const top = r0[x0] + fx * (r0[x1] - r0[x0]);
+			float const bottom = r1[x0] + fx * (r1[x1] - r1[x0]);
+			output[x] = top + fy * (bottom - top);
+		}
+	}
+
+private:
+	const double* m_Matrix;
+	int m_Width;
+	int m_Height;
+	bool m_Bilinear;
+	bool m_Affine;
+	std::vector<int> m_Index;
+	std::vector<float> m_X;
+	std::vector<float> m_Y;
+};
+
+/// Resamples the non-null data arrays, the rows are distributed over the threads
+void TransformSlice(const double* matrix, bool bilinear, unsigned short width, unsigned short height, const float* originalSource, float* source, const float* originalTarget, float* target, const tissues_size_t* originalTissues, tissues_size_t* tissues)
+{
+	bilinear = bilinear && (source || target);
+
+#pragma omp parallel
+	{
+		RowMapping mapping(matrix, width, height, bilinear);
+
+#pragma omp for
+		for (std::int64_t y = 0; y < height; ++y)
+		{
+			size_t const row = static_cast<size_t>(y) * width;
+			mapping.SetRow(static_cast<unsigned>(y));
+			if (source)
+			{
+				if (bilinear)
+					mapping.Bilinear(originalSource, source + row);
+				else
+					mapping.Nearest(originalSource, source + row);
+			}
+			if (target)
+			{
+				if (bilinear)
+					mapping.Bilinear(originalTarget, target + row);
+				else
+					mapping.Nearest(originalTarget, target + row);
+			}
+			if (tissues)
+			{
+				mapping.Nearest(originalTissues, tissues + row);
+			}
+		}
+	}
+}
+} // namespace
+
 SliceTransform::SliceTransform(SlicesHandler* hand3D)
-		: m_Handler3D(hand3D), m_OriginalSource(nullptr), m_OriginalTarget(nullptr), m_OriginalTissues(nullptr)
+		: m_Handler3D(hand3D), m_OriginalSource(nullptr), m_OriginalTarget(nullptr), m_OriginalTissues(nullptr), m_Bilinear(false)
 {
 	m_ActiveSlice = m_Handler3D->ActiveSlice();
 	m_Bmphand = m_Handler3D->GetActivebmphandler();
@@ -128,6 +268,17 @@ void SliceTransform::SelectTransformData(bool source, bool target, bool tissues)
 	}
 }
 
+void SliceTransform::SetBilinear(bool on)
+{
+	if (m_Bilinear != on)
+	{
+		m_Bilinear = on;
+
+		// Update the preview of the image data
+		ApplyTransform(m_TransformSource, m_TransformTarget, false);
+	}
+}
+
 void SliceTransform::ActiveSliceChanged()
 {
 	// Undo transform for previously active slice
@@ -159,30 +310,54 @@ void SliceTransform::Execute(bool allSlices)
 {
 	if (allSlices)
 	{
-		for (unsigned short slice = m_Handler3D->StartSlice();
-				 slice < m_Handler3D->EndSlice(); ++slice)
+		unsigned int area = m_Bmphand->ReturnArea();
+		unsigned short width = m_Bmphand->ReturnWidth();
+		unsigned short height = m_Bmphand->ReturnHeight();
+		tissuelayers_size_t layer = m_Handler3D->ActiveTissuelayer();
+		std::vector<float*> source_slices = m_Handler3D->SourceSlices();
+		std::vector<float*> target_slices = m_Handler3D->TargetSlices();
+		std::vector<tissues_size_t*> tissue_slices = m_Handler3D->TissueSlices(layer);
+
+		const std::int64_t start_slice = m_Handler3D->StartSlice();
+		const std::int64_t end_slice = m_Handler3D->EndSlice();
+
+#pragma omp parallel
 		{
-			// Active slice has already been transformed
-			if (slice == m_ActiveSlice)
-			{
-				continue;
-			}
+			// Copy of original slice data
+			std::vector<float> original_source(m_TransformSource ? area : 0);
+			std::vector<float> original_target(m_TransformTarget ? area : 0);
+			std::vector<tissues_size_t> original_tissues(m_TransformTissues ? area : 0);
 
-			// Activate and get current slice
-			m_Handler3D->SetActiveSlice(slice);
-			m_Bmphand = m_Handler3D->GetActivebmphandler();
+#pragma omp for
+			for (std::int64_t slice = start_slice; slice < end_slice; ++slice)
+			{
+				// Active slice has already been transformed
+				if (slice == m_ActiveSlice)
+				{
+					continue;
+				}
 
-			// Get copy of original slice data
-			CopyFromOriginalSlice(m_TransformSource, m_TransformTarget, m_TransformTissues);
+				float* source = m_TransformSource ? source_slices[slice] : nullptr;
+				float* target = m_TransformTarget ? target_slices[slice] : nullptr;
+				tissues_size_t* tissues = m_TransformTissues ? tissue_slices[slice] : nullptr;
+				if (source)
+				{
+					std::copy(source, source + area, original_source.begin());
+				}
+				if (target)
+				{
+					std::copy(target, target + area, original_target.begin());
+				}
+				if (tissues)
+				{
+					std::copy(tissues, tissues + area, original_tissues.begin());
+				}
 
-			// Apply transform
-			ApplyTransform(m_TransformSource, m_TransformTarget, m_TransformTissues);
+				// Apply transform
+				TransformSlice(m_TransformMatrix, m_Bilinear, width, height, original_source.data(), source, original_target.data(), target, original_tissues.data(), tissues);
+			}
 		}
 
-		// Restore previously active slice
-		m_Handler3D->SetActiveSlice(m_ActiveSlice);
-		m_Bmphand = m_Handler3D->GetActivebmphandler();
-
 		// Reset transformation
 		Initialize();
 	}
@@ -486,112 +661,9 @@ void SliceTransform::SwapDataPointers()
 
 void SliceTransform::ApplyTransform(bool source, bool target, bool tissues)
 {
-	if (source && target && tissues)
-	{
-		// Faster version without if-statements in the loop
-		ApplyTransformAll();
-		return;
-	}
-
 	// transformMatrix * original --> preview
-	double a, b, c;
-	int x_tr, y_tr;
-	unsigned short width = m_Bmphand->ReturnWidth();
-	unsigned short height = m_Bmphand->ReturnHeight();
-	float* source_ptr = m_Bmphand->ReturnBmp();
-	float* target_ptr = m_Bmphand->ReturnWork();
-	tissues_size_t* tissues_ptr =
-			m_Bmphand->ReturnTissues(m_Handler3D->ActiveTissuelayer());
-	for (unsigned int y = 0; y < height; ++y)
-	{
-		for (unsigned int x = 0; x < width; ++x)
-		{
-			// Transform in homogeneous coordinates
-			a = m_TransformMatrix[0] * x + m_TransformMatrix[1] * y +
-					m_TransformMatrix[2];
-			b = m_TransformMatrix[3] * x + m_TransformMatrix[4] * y +
-					m_TransformMatrix[5];
-			c = m_TransformMatrix[6] * x + m_TransformMatrix[7] * y +
-					m_TransformMatrix[8];
-
-			x_tr = (int)round(a / c);
-			y_tr = (int)round(b / c);
-			if (x_tr >= 0 && y_tr >= 0 && x_tr < width && y_tr < height)
-			{
-				if (source)
-				{
-					source_ptr[y * width + x] =
-							m_OriginalSource[y_tr * width + x_tr];
-				}
-				if (target)
-				{
-					target_ptr[y * width + x] =
-							m_OriginalTarget[y_tr * width + x_tr];
-				}
-				if (tissues)
-				{
-					tissues_ptr[y * width + x] =
-							m_OriginalTissues[y_tr * width + x_tr];
-				}
-			}
-			else
-			{
-				if (source)
-				{
-					source_ptr[y * width + x] = 0.0f;
-				}
-				if (target)
-				{
-					target_ptr[y * width + x] = 0.0f;
-				}
-				if (tissues)
-				{
-					tissues_ptr[y * width + x] = 0;
-				}
-			}
-		}
-	}
-}
-
-void SliceTransform::ApplyTransformAll()
-{
-	// transformMatrix * original --> preview
-	double a, b, c;
-	int x_tr, y_tr;
-	unsigned short width = m_Bmphand->ReturnWidth();
-	unsigned short height = m_Bmphand->ReturnHeight();
-	float* source_ptr = m_Bmphand->ReturnBmp();
-	float* target_ptr = m_Bmphand->ReturnWork();
-	tissues_size_t* tissues_ptr =
-			m_Bmphand->ReturnTissues(m_Handler3D->ActiveTissuelayer());
-	for (unsigned int y = 0; y < height; ++y)
-	{
-		for (unsigned int x = 0; x < width; ++x)
-		{
-			// Transform in homogeneous coordinates
-			a = m_TransformMatrix[0] * x + m_TransformMatrix[1] * y +
-					m_TransformMatrix[2];
-			b = m_TransformMatrix[3] * x + m_TransformMatrix[4] * y +
-					m_TransformMatrix[5];
-			c = m_TransformMatrix[6] * x + m_TransformMatrix[7] * y +
-					m_TransformMatrix[8];
-
-			x_tr = (int)round(a / c);
-			y_tr = (int)round(b / c);
-			if (x_tr >= 0 && y_tr >= 0 && x_tr < width && y_tr < height)
-			{
-				source_ptr[y * width + x] = m_OriginalSource[y_tr * width + x_tr];
-				target_ptr[y * width + x] = m_OriginalTarget[y_tr * width + x_tr];
-				tissues_ptr[y * width + x] = m_OriginalTissues[y_tr * width + x_tr];
-			}
-			else
-			{
-				source_ptr[y * width + x] = 0.0f;
-				target_ptr[y * width + x] = 0.0f;
-				tissues_ptr[y * width + x] = 0;
-			}
-		}
-	}
+	tissuelayers_size_t layer = m_Handler3D->ActiveTissuelayer();
+	TransformSlice(m_TransformMatrix, m_Bilinear, m_Bmphand->ReturnWidth(), m_Bmphand->ReturnHeight(), source ? m_OriginalSource : nullptr, source ? m_Bmphand->ReturnBmp() : nullptr, target ? m_OriginalTarget : nullptr, target ? m_Bmphand->ReturnWork() : nullptr, tissues ? m_OriginalTissues : nullptr, tissues ? m_Bmphand->ReturnTissues(layer) : nullptr);
 }
 
 } // namespace iseg
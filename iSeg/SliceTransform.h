@@ -23,6 +23,8 @@ public:
 	~SliceTransform();
 
 	void SelectTransformData(bool source, bool target, bool tissues);
+	/// Bilinear interpolation of the source and target, the tissues always use the nearest neighbor
+	void SetBilinear(bool on);
 
 	void ActiveSliceChanged();
 	void NewDataLoaded();
@@ -51,7 +53,6 @@ private:
 	void CopyToOriginalSlice(bool source, bool target, bool tissues);
 
 	void ApplyTransform(bool source, bool target, bool tissues);
-	void ApplyTransformAll();
 
 private:
 	// Image data
@@ -69,6 +70,7 @@ private:
 	bool m_TransformSource;
 	bool m_TransformTarget;
 	bool m_TransformTissues;
+	bool m_Bilinear;
 };
 
 } // namespace iseg
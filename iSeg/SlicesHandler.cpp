@@ -20,6 +20,8 @@
 #include "TestingMacros.h"
 #include "TissueHierarchy.h"
 #include "TissueInfos.h"
+#include "LazySliceLoader.h"
+#include "SnapshotWriter.h"
 #include "XdmfImageMerger.h"
 #include "XdmfImageReader.h"
 #include "XdmfImageWriter.h"
@@ -27,13 +29,15 @@
 #include "vtkGenericDataSetWriter.h"
 #include "vtkImageExtractCompatibleMesher.h"
 
-#include "Data/ItkProgressObserver.h"
 #include "Data/SlicesHandlerITKInterface.h"
 #include "Data/Transform.h"
 
 #include "Core/ColorLookupTable.h"
+#include "Core/ConnectedComponents.h"
 #include "Core/ConnectedShapeBasedInterpolation.h"
+#include "Core/DistanceTransform.h"
 #include "Core/ExpectationMaximization.h"
+#include "Core/HDF5Reader.h"
 #include "Core/HDF5Writer.h"
 #include "Core/ImageForestingTransform.h"
 #include "Core/ImageReader.h"
@@ -42,10 +46,13 @@
 #include "Core/MatlabExport.h"
 #include "Core/MultidimensionalGamma.h"
 #include "Core/Outline.h"
+#include "Core/ProjectSlices.h"
 #include "Core/ProjectVersion.h"
+#include "Core/RankFilter.h"
 #include "Core/RTDoseIODModule.h"
 #include "Core/RTDoseReader.h"
 #include "Core/RTDoseWriter.h"
+#include "Core/SliceStackFilter.h"
 #include "Core/SliceProvider.h"
 #include "Core/SmoothSteps.h"
 #include "Core/Treaps.h"
@@ -69,14 +76,16 @@
 #include <vtkTransformPolyDataFilter.h>
 #include <vtkWindowedSincPolyDataFilter.h>
 
-#include <itkConnectedComponentImageFilter.h>
-
 #include <boost/format.hpp>
 
 #include <QDir>
 #include <QFileInfo>
-#include <QMessageBox>
-#include <QProgressDialog>
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
 
 #ifndef NO_OPENMP_SUPPORT
 #	include <omp.h>
@@ -92,11 +101,29 @@ namespace // PROJECT VERSION NUMBERS
 // version 3: ?
 // version 4: added dc[6], ...?
 // version 5: removed dc[6] and displacement[3], added transform[4][4]
-int const project_version = 5;
+// version 6: slice marks, vvm and limits stored in a ProjectSlices container
+int const project_version = 6;
 
 // version 0: tissues_size_t=unsigned char
 // version 1: tissues_size_t=unsigned short, ...?
 int const tissue_version = 1;
+
+FILE* SaveSliceAnnotations(FILE* fp, const std::vector<Bmphandler>& slices, unsigned short first, unsigned short last)
+{
+	ProjectSlices container;
+	container.Resize(last - first);
+	SliceAnnotations annotations;
+	for (unsigned short j = first; j < last; j++)
+	{
+		slices[j].GetAnnotations(annotations);
+		container.Encode(j - first, annotations);
+	}
+	if (!container.Write(fp))
+	{
+		ISEG_ERROR_MSG("could not write slice annotations");
+	}
+	return fp;
+}
 } // namespace
 
 struct Posit
@@ -136,40 +163,55 @@ SlicesHandler::SlicesHandler()
 	m_Undo3D = true;
 }
 
-SlicesHandler::~SlicesHandler() { delete m_TissueHierachy; }
+SlicesHandler::~SlicesHandler()
+{
+	m_LazyLoader.reset();
+	WaitForSnapshot();
+	delete m_TissueHierachy;
+}
 
 float SlicesHandler::GetWorkPt(Point p, unsigned short slicenr)
 {
+	RequestSlice(slicenr);
 	return m_ImageSlices[slicenr].WorkPt(p);
 }
 
 void SlicesHandler::SetWorkPt(Point p, unsigned short slicenr, float f)
 {
+	RequestSlice(slicenr);
 	m_ImageSlices[slicenr].SetWorkPt(p, f);
 }
 
 float SlicesHandler::GetBmpPt(Point p, unsigned short slicenr)
 {
+	RequestSlice(slicenr);
 	return m_ImageSlices[slicenr].BmpPt(p);
 }
 
 void SlicesHandler::SetBmpPt(Point p, unsigned short slicenr, float f)
 {
+	RequestSlice(slicenr);
 	m_ImageSlices[slicenr].SetBmpPt(p, f);
 }
 
 tissues_size_t SlicesHandler::GetTissuePt(Point p, unsigned short slicenr)
 {
+	RequestSlice(slicenr);
 	return m_ImageSlices[slicenr].TissuesPt(m_ActiveTissuelayer, p);
 }
 
 void SlicesHandler::SetTissuePt(Point p, unsigned short slicenr, tissues_size_t f)
 {
+	RequestSlice(slicenr);
 	m_ImageSlices[slicenr].SetTissuePt(m_ActiveTissuelayer, p, f);
 }
 
 std::vector<const float*> SlicesHandler::SourceSlices() const
 {
+	if (m_LazyLoader)
+	{
+		m_LazyLoader->WaitForAll();
+	}
 	std::vector<const float*> ptrs(m_Nrslices);
 	for (unsigned short i = 0; i < m_Nrslices; i++)
 	{
@@ -180,6 +222,7 @@ std::vector<const float*> SlicesHandler::SourceSlices() const
 
 std::vector<float*> SlicesHandler::SourceSlices()
 {
+	WaitForLazyLoad();
 	std::vector<float*> ptrs(m_Nrslices);
 	for (unsigned short i = 0; i < m_Nrslices; i++)
 	{
@@ -190,6 +233,10 @@ std::vector<float*> SlicesHandler::SourceSlices()
 
 std::vector<const float*> SlicesHandler::TargetSlices() const
 {
+	if (m_LazyLoader)
+	{
+		m_LazyLoader->WaitForAll();
+	}
 	std::vector<const float*> ptrs(m_Nrslices);
 	for (unsigned short i = 0; i < m_Nrslices; i++)
 	{
@@ -200,6 +247,7 @@ std::vector<const float*> SlicesHandler::TargetSlices() const
 
 std::vector<float*> SlicesHandler::TargetSlices()
 {
+	WaitForLazyLoad();
 	std::vector<float*> ptrs(m_Nrslices);
 	for (unsigned short i = 0; i < m_Nrslices; i++)
 	{
@@ -210,6 +258,10 @@ std::vector<float*> SlicesHandler::TargetSlices()
 
 std::vector<const tissues_size_t*> SlicesHandler::TissueSlices(tissuelayers_size_t layeridx) const
 {
+	if (m_LazyLoader)
+	{
+		m_LazyLoader->WaitForAll();
+	}
 	std::vector<const tissues_size_t*> ptrs(m_Nrslices);
 	for (unsigned short i = 0; i < m_Nrslices; i++)
 	{
@@ -220,6 +272,7 @@ std::vector<const tissues_size_t*> SlicesHandler::TissueSlices(tissuelayers_size
 
 std::vector<tissues_size_t*> SlicesHandler::TissueSlices(tissuelayers_size_t layeridx)
 {
+	WaitForLazyLoad();
 	std::vector<tissues_size_t*> ptrs(m_Nrslices);
 	for (unsigned short i = 0; i < m_Nrslices; i++)
 	{
@@ -251,16 +304,19 @@ std::vector<bool> SlicesHandler::TissueLocks() const
 
 float* SlicesHandler::ReturnBmp(unsigned short slicenr1)
 {
+	RequestSlice(slicenr1);
 	return m_ImageSlices[slicenr1].ReturnBmp();
 }
 
 float* SlicesHandler::ReturnWork(unsigned short slicenr1)
 {
+	RequestSlice(slicenr1);
 	return m_ImageSlices[slicenr1].ReturnWork();
 }
 
 tissues_size_t* SlicesHandler::ReturnTissues(tissuelayers_size_t layeridx, unsigned short slicenr1)
 {
+	RequestSlice(slicenr1);
 	return m_ImageSlices[slicenr1].ReturnTissues(layeridx);
 }
 
@@ -816,6 +872,12 @@ int SlicesHandler::ReadRTdose(const char* filename)
 
 bool SlicesHandler::LoadSurface(const std::string& filename_in, bool overwrite_working, bool intersect)
 {
+	// a snapshot written in the background must not see the partially written target
+	DataSelection selection;
+	selection.allSlices = true;
+	selection.work = true;
+	SetDirty(selection);
+
 	unsigned dims[3] = {m_Width, m_Height, m_Nrslices};
 	auto slices = TargetSlices();
 
@@ -859,6 +921,8 @@ bool SlicesHandler::LoadSurface(const std::string& filename_in, bool overwrite_w
 
 int SlicesHandler::LoadAllHDF(const char* filename)
 {
+	WaitForSnapshot();
+
 	unsigned w, h, nrofslices;
 	float* pixsize;
 	float* tr_1d;
@@ -915,6 +979,8 @@ void SlicesHandler::UpdateColorLookupTable(std::shared_ptr<ColorLookupTable> new
 
 int SlicesHandler::LoadAllXdmf(const char* filename)
 {
+	WaitForSnapshot();
+
 	unsigned w, h, nrofslices;
 	QStringList array_names;
 
@@ -950,31 +1016,123 @@ int SlicesHandler::LoadAllXdmf(const char* filename)
 	reader.SetImageSlices(bmpslices.data());
 	reader.SetWorkSlices(workslices.data());
 	reader.SetTissueSlices(tissueslices.data());
-	int code = reader.Read();
 
+	// the slices are read from the .h5 file next to the .xmf
+	QFileInfo file_info(filename);
+	std::string h5_filename = file_info.dir().absoluteFilePath(file_info.completeBaseName() + ".h5").toStdString();
+
+	int code = 0;
+	m_UnreadSlices.clear();
+	if (m_LazyLoading)
+	{
+		m_LazyLoader = reader.ReadLazy(m_Activeslice);
+		code = (m_LazyLoader != nullptr);
+	}
+	else
+	{
+		code = reader.Read();
+	}
+
+	if (code)
+	{
+		SetSavedImageFile(h5_filename);
+	}
+	else
+	{
+		m_SavedImageFile.clear();
+	}
 	return code;
 }
 
-int SlicesHandler::SaveAllXdmf(const char* filename, int compression, bool save_work, bool naked)
+bool SlicesHandler::RequestSlice(unsigned short slice) const
+{
+	if (m_LazyLoader)
+	{
+		return m_LazyLoader->Request(slice);
+	}
+	return std::find(m_UnreadSlices.begin(), m_UnreadSlices.end(), slice) == m_UnreadSlices.end();
+}
+
+void SlicesHandler::WaitForLazyLoad()
 {
+	if (m_LazyLoader)
+	{
+		ISEG_INFO_MSG("waiting for remaining slices to be loaded...");
+		if (!m_LazyLoader->WaitForAll())
+		{
+			// the buffers of these slices are not valid, they must not be saved over the file
+			m_UnreadSlices = m_LazyLoader->FailedSlices();
+			ISEG_ERROR(m_UnreadSlices.size() << " slices could not be loaded, starting with slice " << (m_UnreadSlices.empty() ? 0 : m_UnreadSlices.front() + 1));
+		}
+		m_LazyLoader.reset();
+
+		// ranges could only be estimated from the active slice so far
+		Pair dummy;
+		ComputeRangeMode1(&dummy);
+		ComputeBmprangeMode1(&dummy);
+	}
+}
+
+int SlicesHandler::SaveAllXdmf(const char* filename, int compression, bool save_work, bool naked, bool background)
+{
+	WaitForLazyLoad();
+	WaitForSnapshot();
+
 	float pixsize[3] = {m_Dx, m_Dy, m_Thickness};
 
+	// only the modified slices are written if the file contains the last saved state
+	QFileInfo file_info(filename);
+	std::string const h5_filename = file_info.dir().absoluteFilePath(file_info.completeBaseName() + ".h5").toStdString();
+	std::string const written_filename = naked ? file_info.absoluteFilePath().toStdString() : h5_filename;
+	bool const all_slices = (m_Startslice == 0 && m_Endslice == m_Nrslices);
+	bool const incremental = !naked && all_slices && CanSaveIncrementally(h5_filename, save_work);
+	background = background && !naked && all_slices;
+
+	// slices which could not be read are only kept in the file they were loaded from
+	if (!incremental && std::any_of(m_UnreadSlices.begin(), m_UnreadSlices.end(), [this](unsigned s) { return s >= m_Startslice && s < m_Endslice; }))
+	{
+		ISEG_ERROR("not saving " << written_filename << ", " << m_UnreadSlices.size() << " slices could not be read from the project file. Save the project (not in the background) to keep them.");
+		return 0;
+	}
+
 	std::vector<float*> bmpslices(m_Endslice - m_Startslice);
 	std::vector<float*> workslices(m_Endslice - m_Startslice);
 	std::vector<tissues_size_t*> tissueslices(m_Endslice - m_Startslice);
+	size_t num_written = 0;
 	for (unsigned i = m_Startslice; i < m_Endslice; i++)
 	{
-		bmpslices[i - m_Startslice] = m_ImageSlices[i].ReturnBmp();
-		workslices[i - m_Startslice] = m_ImageSlices[i].ReturnWork();
-		tissueslices[i - m_Startslice] = m_ImageSlices[i].ReturnTissues(0); // TODO
+		unsigned char dirty = incremental ? m_DirtySlices[i] : (kDirtySource | kDirtyTarget | kDirtyTissue);
+		bmpslices[i - m_Startslice] = (dirty & kDirtySource) ? m_ImageSlices[i].ReturnBmp() : nullptr;
+		workslices[i - m_Startslice] = (dirty & kDirtyTarget) ? m_ImageSlices[i].ReturnWork() : nullptr;
+		tissueslices[i - m_Startslice] = (dirty & kDirtyTissue) ? m_ImageSlices[i].ReturnTissues(0) : nullptr; // TODO
+		num_written += (dirty != 0);
+	}
+
+	if (incremental)
+	{
+		ISEG_INFO("Updating " << num_written << " of " << m_Nrslices << " slices in " << h5_filename);
+
+		// the tissues and markers are rewritten below
+		HDF5Writer h5writer;
+		if (h5writer.Open(h5_filename, "append"))
+		{
+			h5writer.Remove("Tissues");
+			h5writer.Remove("Markers");
+			h5writer.Close();
+		}
 	}
 
+	// in the background mode only the datasets are created here, the slices are written by the snapshot
+	std::vector<float*> no_float_slices(background ? bmpslices.size() : 0, nullptr);
+	std::vector<tissues_size_t*> no_tissue_slices(background ? tissueslices.size() : 0, nullptr);
+
 	XdmfImageWriter writer;
-	writer.SetCopyToContiguousMemory(GetContiguousMemory());
+	writer.SetIncremental(incremental);
+	writer.SetCopyToContiguousMemory(GetContiguousMemory() && !background);
 	writer.SetFileName(filename);
-	writer.SetImageSlices(bmpslices.data());
-	writer.SetWorkSlices(save_work ? workslices.data() : nullptr);
-	writer.SetTissueSlices(tissueslices.data());
+	writer.SetImageSlices(background ? no_float_slices.data() : bmpslices.data());
+	writer.SetWorkSlices(save_work ? (background ? no_float_slices.data() : workslices.data()) : nullptr);
+	writer.SetTissueSlices(background ? no_tissue_slices.data() : tissueslices.data());
 	writer.SetNumberOfSlices(m_Endslice - m_Startslice);
 	writer.SetWidth(m_Width);
 	writer.SetHeight(m_Height);
@@ -988,6 +1146,152 @@ int SlicesHandler::SaveAllXdmf(const char* filename, int compression, bool save_
 	ok &= writer.WriteColorLookup(m_ColorLookupTable.get(), naked);
 	ok &= TissueInfos::SaveTissuesHDF(filename, m_TissueHierachy->SelectedHierarchy(), naked, 0);
 	ok &= SaveMarkersHDF(filename, naked, 0);
+
+	if (ok && !naked && all_slices)
+	{
+		SetSavedImageFile(h5_filename);
+	}
+	else if (written_filename == m_SavedImageFile)
+	{
+		m_SavedImageFile.clear();
+	}
+
+	if (ok && background)
+	{
+		if (!save_work)
+		{
+			workslices.clear();
+		}
+		m_Snapshot.reset(new SnapshotWriter(h5_filename, bmpslices, workslices, tissueslices, m_Area));
+		m_Snapshot->Start();
+	}
+	return ok;
+}
+
+void SlicesHandler::WaitForSnapshot()
+{
+	if (m_Snapshot)
+	{
+		if (!m_Snapshot->Finished())
+		{
+			ISEG_INFO_MSG("waiting for snapshot to be written...");
+		}
+		if (!m_Snapshot->Wait())
+		{
+			ISEG_ERROR_MSG("the project image data could not be saved completely");
+			// the saved file (temporary or renamed) can not be updated incrementally
+			m_SavedImageFile.clear();
+		}
+		m_Snapshot.reset();
+	}
+}
+
+bool SlicesHandler::ReplaceOnSnapshotSuccess(const std::vector<std::pair<std::string, std::string>>& renames)
+{
+	if (!m_Snapshot)
+	{
+		return false;
+	}
+	m_Snapshot->ReplaceOnSuccess(renames);
+	for (const auto& r : renames)
+	{
+		SavedImageFileRenamed(r.first, r.second);
+	}
+	return true;
+}
+
+bool SlicesHandler::SnapshotInProgress() const
+{
+	return m_Snapshot && !m_Snapshot->Finished();
+}
+
+void SlicesHandler::SetDirty(const DataSelection& dataSelection)
+{
+	if (dataSelection.allSlices)
+	{
+		// copying all slices would double the memory, instead the snapshot is completed first
+		WaitForSnapshot();
+		for (unsigned short i = 0; i < m_Nrslices; i++)
+		{
+			SetDirty(i, dataSelection);
+		}
+	}
+	else
+	{
+		SetDirty(dataSelection.sliceNr, dataSelection);
+	}
+}
+
+void SlicesHandler::SetDirty(unsigned short slice, const DataSelection& dataSelection)
+{
+	if (m_DirtySlices.size() != m_Nrslices)
+	{
+		// the slices were replaced since the last save
+		m_SavedImageFile.clear();
+		m_DirtySlices.assign(m_Nrslices, kDirtySource | kDirtyTarget | kDirtyTissue);
+	}
+
+	if (m_Snapshot)
+	{
+		m_Snapshot->Unpin(slice, dataSelection.bmp, dataSelection.work, dataSelection.tissues);
+	}
+
+	if (slice < m_DirtySlices.size())
+	{
+		m_DirtySlices[slice] |= (dataSelection.bmp ? kDirtySource : 0) |
+														(dataSelection.work ? kDirtyTarget : 0) |
+														(dataSelection.tissues ? kDirtyTissue : 0);
+	}
+}
+
+bool SlicesHandler::IsSavedImageFile(const std::string& filename) const
+{
+	return !m_SavedImageFile.empty() && m_SavedImageFile == QFileInfo(QString::fromStdString(filename)).absoluteFilePath().toStdString();
+}
+
+void SlicesHandler::SavedImageFileRenamed(const std::string& from, const std::string& to)
+{
+	if (IsSavedImageFile(from))
+	{
+		m_SavedImageFile = QFileInfo(QString::fromStdString(to)).absoluteFilePath().toStdString();
+	}
+}
+
+void SlicesHandler::SetSavedImageFile(const std::string& filename)
+{
+	m_SavedImageFile = filename;
+	m_DirtySlices.assign(m_Nrslices, 0);
+}
+
+bool SlicesHandler::CanSaveIncrementally(const std::string& filename, bool save_work) const
+{
+	if (!IsSavedImageFile(filename) || m_DirtySlices.size() != m_Nrslices)
+	{
+		return false;
+	}
+
+	// make sure the file still has the layout of the current slices
+	HDF5Reader reader;
+	if (!reader.Open(filename))
+	{
+		return false;
+	}
+
+	std::vector<int> dimensions;
+	bool ok = reader.Read(dimensions, "dimensions") && dimensions.size() == 3 &&
+						dimensions[0] == m_Width && dimensions[1] == m_Height && dimensions[2] == m_Nrslices;
+
+	HDF5Reader::size_type const n = static_cast<HDF5Reader::size_type>(m_Area) * m_Nrslices;
+	std::string type;
+	std::vector<HDF5Reader::size_type> extents;
+	for (auto name : {"Source", "Target", "Tissue"})
+	{
+		if (ok && (save_work || std::string(name) != "Target"))
+		{
+			ok = reader.GetDatasetInfo(type, extents, name) && HDF5Reader::TotalSize(extents) == n;
+		}
+	}
+	reader.Close();
 	return ok;
 }
 
@@ -1082,6 +1386,9 @@ bool SlicesHandler::SaveMarkersHDF(const char* filename, bool naked, unsigned sh
 
 int SlicesHandler::SaveMergeAllXdmf(const char* filename, std::vector<QString>& mergeImagefilenames, unsigned short nrslicesTotal, int compression)
 {
+	WaitForLazyLoad();
+	WaitForSnapshot();
+
 	float pixsize[3];
 
 	auto active_slices_transform = GetTransformActiveSlices();
@@ -1749,7 +2056,7 @@ FILE* SlicesHandler::SaveHeader(FILE* fp, short unsigned nr_slices_to_write, Tra
 	return fp;
 }
 
-FILE* SlicesHandler::SaveProject(const char* filename, const char* imageFileExtension)
+FILE* SlicesHandler::SaveProject(const char* filename, const char* imageFileExtension, bool background)
 {
 	FILE* fp;
 
@@ -1758,10 +2065,7 @@ FILE* SlicesHandler::SaveProject(const char* filename, const char* imageFileExte
 
 	fp = SaveHeader(fp, m_Nrslices, m_Transform);
 
-	for (unsigned short j = 0; j < m_Nrslices; j++)
-	{
-		fp = m_ImageSlices[j].SaveProj(fp, false);
-	}
+	fp = SaveSliceAnnotations(fp, m_ImageSlices, 0, m_Nrslices);
 	fp = (m_ImageSlices[0]).SaveStack(fp);
 
 	// SaveAllXdmf uses startslice/endslice to decide what to write - here we want to override that behavior
@@ -1780,7 +2084,7 @@ FILE* SlicesHandler::SaveProject(const char* filename, const char* imageFileExte
 	image_file_name =
 			image_file_name.remove(after_dot, image_file_name.length() - after_dot) +
 			imageFileExtension;
-	SaveAllXdmf(QFileInfo(filename).dir().absoluteFilePath(image_file_name).toAscii().data(), this->m_Hdf5Compression, this->m_SaveTarget, false);
+	SaveAllXdmf(QFileInfo(filename).dir().absoluteFilePath(image_file_name).toAscii().data(), this->m_Hdf5Compression, this->m_SaveTarget, false, background);
 
 	m_Startslice = startslice1;
 	m_Endslice = endslice1;
@@ -1814,10 +2118,7 @@ FILE* SlicesHandler::SaveActiveSlices(const char* filename, const char* imageFil
 	Transform transform_corrected = GetTransformActiveSlices();
 	SaveHeader(fp, slicecount, transform_corrected);
 
-	for (unsigned short j = m_Startslice; j < m_Endslice; j++)
-	{
-		fp = m_ImageSlices[j].SaveProj(fp, false);
-	}
+	fp = SaveSliceAnnotations(fp, m_ImageSlices, m_Startslice, m_Endslice);
 	fp = (m_ImageSlices[0]).SaveStack(fp);
 	unsigned char length1 = 0;
 	while (imageFileExtension[length1] != '\0')
@@ -1837,6 +2138,8 @@ FILE* SlicesHandler::SaveActiveSlices(const char* filename, const char* imageFil
 
 FILE* SlicesHandler::MergeProjects(const char* savefilename, std::vector<QString>& mergeFilenames)
 {
+	WaitForSnapshot();
+
 	// Get number of slices to total
 	unsigned short nrslices_total = m_Nrslices;
 	for (unsigned short i = 0; i < mergeFilenames.size(); i++)
@@ -1864,18 +2167,23 @@ FILE* SlicesHandler::MergeProjects(const char* savefilename, std::vector<QString
 	/// BL TODO what should merged transform be
 	fp = SaveHeader(fp, nrslices_total, m_Transform);
 
-	// Save current project slices
+	// Encode current project slices
+	ProjectSlices container;
+	container.Resize(m_Nrslices);
+	SliceAnnotations annotations;
 	for (unsigned short j = 0; j < m_Nrslices; j++)
 	{
-		fp = m_ImageSlices[j].SaveProj(fp, false);
+		m_ImageSlices[j].GetAnnotations(annotations);
+		container.Encode(j, annotations);
 	}
 
 	FILE* fp_merge;
-	// Save merged project slices
+	// Add merged project slices
 	for (unsigned short i = 0; i < mergeFilenames.size(); i++)
 	{
 		if ((fp_merge = fopen(mergeFilenames[i].toAscii().data(), "rb")) == nullptr)
 		{
+			fclose(fp);
 			return nullptr;
 		}
 
@@ -1888,17 +2196,40 @@ FILE* SlicesHandler::MergeProjects(const char* savefilename, std::vector<QString
 		unsigned short merge_nrslices = dummy_slices_handler.NumSlices();
 		//float mergeThickness = dummy_SlicesHandler.get_slicethickness();
 
-		// Load input slices and save to merged project file
-		Bmphandler tmp_slice;
-		for (unsigned short j = 0; j < merge_nrslices; j++)
+		if (version > 5)
+		{
+			// copy the encoded slices as they are
+			ProjectSlices merge_container;
+			if (!merge_container.Read(fp_merge) || merge_container.Size() != merge_nrslices)
+			{
+				fclose(fp_merge);
+				fclose(fp);
+				return nullptr;
+			}
+			container.Append(merge_container, 0, merge_nrslices);
+		}
+		else
 		{
-			fp_merge = tmp_slice.LoadProj(fp_merge, tissues_version, false);
-			fp = tmp_slice.SaveProj(fp, false);
+			// Load input slices and encode them
+			Bmphandler tmp_slice;
+			size_t offset = container.Size();
+			container.Resize(offset + merge_nrslices);
+			for (unsigned short j = 0; j < merge_nrslices; j++)
+			{
+				fp_merge = tmp_slice.LoadProj(fp_merge, tissues_version, false);
+				tmp_slice.GetAnnotations(annotations);
+				container.Encode(offset + j, annotations);
+			}
 		}
 
 		fclose(fp_merge);
 	}
 
+	if (!container.Write(fp))
+	{
+		ISEG_ERROR_MSG("could not write slice annotations");
+	}
+
 	fp = (m_ImageSlices[0]).SaveStack(fp);
 
 	unsigned short startslice1 = m_Startslice;
@@ -1993,6 +2324,10 @@ FILE* SlicesHandler::LoadProject(const char* filename, int& tissuesVersion)
 	if ((fp = fopen(filename, "rb")) == nullptr)
 		return nullptr;
 
+	m_LazyLoader.reset();
+	m_UnreadSlices.clear();
+	WaitForSnapshot();
+
 	int version = 0;
 	LoadHeader(fp, tissuesVersion, version);
 
@@ -2000,10 +2335,52 @@ FILE* SlicesHandler::LoadProject(const char* filename, int& tissuesVersion)
 
 	m_Os.SetSizenr(m_Nrslices);
 
-	for (unsigned short j = 0; j < m_Nrslices; ++j)
+	// skip initializing because we load real data into the arrays below,
+	// unless the slices are loaded lazily and might be displayed before that
+	if (version > 5)
 	{
-		// skip initializing because we load real data into the arrays below
-		fp = m_ImageSlices[j].LoadProj(fp, tissuesVersion, version <= 1, false);
+		ProjectSlices container;
+		if (!container.Read(fp) || container.Size() != m_Nrslices)
+		{
+			ISEG_ERROR_MSG("could not read slice annotations");
+			container.Resize(m_Nrslices);
+		}
+
+		// all slices have the same size, corrupt slices take it from the first valid one
+		SliceAnnotations annotations;
+		unsigned short w = m_Width, h = m_Height;
+		for (unsigned short j = 0; j < m_Nrslices; ++j)
+		{
+			if (container.Decode(j, annotations))
+			{
+				w = annotations.m_Width;
+				h = annotations.m_Height;
+				break;
+			}
+		}
+		if (w == 0 || h == 0)
+		{
+			ISEG_ERROR_MSG("could not determine the slice size");
+		}
+
+		for (unsigned short j = 0; j < m_Nrslices; ++j)
+		{
+			if (!container.Decode(j, annotations))
+			{
+				ISEG_ERROR("corrupt annotations of slice " << j);
+				annotations = SliceAnnotations();
+				annotations.m_Width = w;
+				annotations.m_Height = h;
+			}
+			m_ImageSlices[j].SetAnnotations(annotations, m_LazyLoading);
+		}
+	}
+	else
+	{
+		for (unsigned short j = 0; j < m_Nrslices; ++j)
+		{
+			fp = m_ImageSlices[j].LoadProj(fp, tissuesVersion, version <= 1, m_LazyLoading);
+		}
 	}
 
 	SetSlicethickness(m_Thickness);
@@ -2054,8 +2431,19 @@ FILE* SlicesHandler::LoadProject(const char* filename, int& tissuesVersion)
 	Pair dummy;
 	m_SliceRanges.resize(m_Nrslices);
 	m_SliceBmpranges.resize(m_Nrslices);
-	ComputeRangeMode1(&dummy);
-	ComputeBmprangeMode1(&dummy);
+	if (m_LazyLoader)
+	{
+		// only the active slice is available, the ranges are updated in WaitForLazyLoad
+		ComputeRangeMode1(&dummy);
+		ComputeBmprangeMode1(&dummy);
+		std::fill(m_SliceRanges.begin(), m_SliceRanges.end(), m_SliceRanges[m_Activeslice]);
+		std::fill(m_SliceBmpranges.begin(), m_SliceBmpranges.end(), m_SliceBmpranges[m_Activeslice]);
+	}
+	else
+	{
+		ComputeRangeMode1(&dummy);
+		ComputeBmprangeMode1(&dummy);
+	}
 
 	m_Loaded = true;
 
@@ -2064,6 +2452,8 @@ FILE* SlicesHandler::LoadProject(const char* filename, int& tissuesVersion)
 
 bool SlicesHandler::LoadS4Llink(const char* filename, int& tissuesVersion)
 {
+	WaitForSnapshot();
+
 	unsigned w, h, nrofslices;
 	float* pixsize;
 	float* tr_1d;
@@ -2080,6 +2470,8 @@ bool SlicesHandler::LoadS4Llink(const char* filename, int& tissuesVersion)
 	tr_1d = reader.GetImageTransform();
 
 	// taken from LoadProject()
+	m_LazyLoader.reset();
+	m_UnreadSlices.clear();
 	m_Activeslice = 0;
 	this->m_Width = w;
 	this->m_Height = h;
@@ -3296,6 +3688,9 @@ bool SlicesHandler::RemoveLimit(Point p, unsigned radius, unsigned short slicenr
 
 void SlicesHandler::Newbmp(unsigned short width1, unsigned short height1, unsigned short nrofslices, const std::function<void(float**)>& init_callback)
 {
+	m_LazyLoader.reset();
+	m_UnreadSlices.clear();
+	WaitForSnapshot();
 	m_Activeslice = 0;
 	m_Startslice = 0;
 	m_Endslice = m_Nrslices = nrofslices;
@@ -3330,6 +3725,9 @@ void SlicesHandler::Newbmp(unsigned short width1, unsigned short height1, unsign
 
 void SlicesHandler::Freebmp()
 {
+	m_LazyLoader.reset();
+	m_UnreadSlices.clear();
+	WaitForSnapshot();
 	for (unsigned short i = 0; i < m_Nrslices; i++)
 		m_ImageSlices[i].Freebmp();
 
@@ -3477,6 +3875,20 @@ void SlicesHandler::Gaussian(float sigma)
 		m_ImageSlices[i].Gaussian(sigma);
 }
 
+void SlicesHandler::Gaussian3D(float sigma)
+{
+	Bmp2workall();
+
+	// sigma is given in pixels along x
+	auto target = TargetSlices();
+	std::vector<float*> slices(target.begin() + m_Startslice, target.begin() + m_Endslice);
+	SliceStackFilter filter({m_Width, m_Height, unsigned(slices.size())}, slices);
+	filter.Gaussian({sigma, sigma * m_Dx / m_Dy, sigma * m_Dx / m_Thickness});
+
+	for (unsigned short i = m_Startslice; i < m_Endslice; i++)
+		m_ImageSlices[i].SetMode(1, false);
+}
+
 void SlicesHandler::FillHoles(float f, int minsize)
 {
 	int const i_n = m_Endslice;
@@ -3900,9 +4312,7 @@ void SlicesHandler::KmeansPng(unsigned short slicenr, short nrtissues, short dim
 			}
 			else
 			{
-				QMessageBox msg_box;
-				msg_box.setText("ERROR: reading centers initialization file.");
-				msg_box.exec();
+				ISEG_ERROR("reading centers initialization file " << initCentersFile);
 				return;
 			}
 		}
@@ -3994,18 +4404,69 @@ void SlicesHandler::ContAnisodiff(float dt, int n, float (*f)(float, float), flo
 		m_ImageSlices[i].ContAnisodiff(dt, n, f, k, restraint);
 }
 
+void SlicesHandler::AnisoDiff3D(float dt, int n, float k, float restraint)
+{
+	Bmp2workall();
+	ContAnisodiff3D(dt, n, k, restraint);
+}
+
+void SlicesHandler::ContAnisodiff3D(float dt, int n, float k, float restraint)
+{
+	auto source = SourceSlices();
+	auto target = TargetSlices();
+	std::vector<const float*> reference(source.begin() + m_Startslice, source.begin() + m_Endslice);
+	std::vector<float*> slices(target.begin() + m_Startslice, target.begin() + m_Endslice);
+
+	// six instead of four neighbors, keep the stability margin of the 2D scheme
+	SliceStackFilter filter({m_Width, m_Height, unsigned(slices.size())}, slices);
+	filter.AnisotropicDiffusion(reference, dt * 4.f / 6.f, n, RationalConductance(k), restraint);
+
+	for (unsigned short i = m_Startslice; i < m_Endslice; i++)
+		m_ImageSlices[i].SetMode(1, false);
+}
+
 void SlicesHandler::MedianInterquartile(bool median)
 {
 	for (unsigned short i = m_Startslice; i < m_Endslice; i++)
 		m_ImageSlices[i].MedianInterquartile(median);
 }
 
+void SlicesHandler::PercentileFilter(unsigned short nx, unsigned short ny, unsigned short nz, float percentile)
+{
+	std::vector<const float*> bmp;
+	std::vector<float*> work;
+	for (unsigned short i = m_Startslice; i < m_Endslice; i++)
+	{
+		bmp.push_back(m_ImageSlices[i].ReturnBmp());
+		work.push_back(m_ImageSlices[i].ReturnWork());
+	}
+
+	RankFilter filter({m_Width, m_Height, unsigned(m_Endslice - m_Startslice)}, {nx / 2u, ny / 2u, nz / 2u});
+	filter.Percentile(bmp, work, percentile);
+
+	for (unsigned short i = m_Startslice; i < m_Endslice; i++)
+		m_ImageSlices[i].SetMode(1, false);
+}
+
 void SlicesHandler::Average(unsigned short n)
 {
 	for (unsigned short i = m_Startslice; i < m_Endslice; i++)
 		m_ImageSlices[i].Average(n);
 }
 
+void SlicesHandler::Average3D(unsigned short n)
+{
+	Bmp2workall();
+
+	auto target = TargetSlices();
+	std::vector<float*> slices(target.begin() + m_Startslice, target.begin() + m_Endslice);
+	SliceStackFilter filter({m_Width, m_Height, unsigned(slices.size())}, slices);
+	filter.Average({n, n, n});
+
+	for (unsigned short i = m_Startslice; i < m_Endslice; i++)
+		m_ImageSlices[i].SetMode(1, false);
+}
+
 void SlicesHandler::Sigmafilter(float sigma, unsigned short nx, unsigned short ny)
 {
 	for (unsigned short i = m_Startslice; i < m_Endslice; i++)
@@ -4025,76 +4486,122 @@ void SlicesHandler::Threshold(float* thresholds)
 
 void SlicesHandler::ExtractinterpolatesaveContours(int minsize, std::vector<tissues_size_t>& tissuevec, unsigned short between, bool dp, float epsilon, const char* filename)
 {
-	/*	os.clear();
-	os.set_sizenr((between+1)*nrslices-between);
-	os.set_thickness(thickness/(between+1));*/
-
-	std::vector<std::vector<Point>> v1, v2;
-	std::vector<point_type> v_p;
+	Pair pair1 = GetPixelsize();
+	InterpolatesaveContours(between, pair1.high, pair1.low, filename, [&](SlicesHandler& interpolated) {
+		interpolated.ExtractContours(minsize, tissuevec);
+		if (dp)
+			interpolated.DougpeuckLine(epsilon);
+	});
+}
 
-	SlicesHandler dummy3_d;
-	dummy3_d.Newbmp((unsigned short)(m_ImageSlices[0].ReturnWidth()), (unsigned short)(m_ImageSlices[0].ReturnHeight()), between + 2);
-	dummy3_d.SetSlicethickness(m_Thickness / (between + 1));
+void SlicesHandler::ExtractinterpolatesaveContours2Xmirrored(int minsize, std::vector<tissues_size_t>& tissuevec, unsigned short between, bool dp, float epsilon, const char* filename)
+{
 	Pair pair1 = GetPixelsize();
-	dummy3_d.SetPixelsize(pair1.high, pair1.low);
+	InterpolatesaveContours(between, pair1.high / 2, pair1.low / 2, filename, [&](SlicesHandler& interpolated) {
+		if (dp)
+		{
+			interpolated.ExtractContours2Xmirrored(minsize, tissuevec, epsilon);
+		}
+		else
+		{
+			interpolated.ExtractContours2Xmirrored(minsize, tissuevec);
+		}
+		interpolated.ShiftContours(-(int)interpolated.Width(), -(int)interpolated.Height());
+	});
+}
 
-	FILE* fp = dummy3_d.SaveContourprologue(filename, (between + 1) * m_Nrslices - between);
+void SlicesHandler::InterpolatesaveContours(unsigned short between, float dx, float dy, const char* filename, const std::function<void(SlicesHandler&)>& extract)
+{
+	// task j interpolates the slice pair (j, j+1), the last task only extracts the last slice
+	unsigned const nr_tasks = m_Nrslices;
+	unsigned const nr_workers = std::max(1u, std::min(std::thread::hardware_concurrency(), nr_tasks));
+	unsigned const max_pending = 2 * nr_workers;
 
-	for (unsigned short j = 0; j + 1 < m_Nrslices; j++)
+	// the scratch handlers are created and destroyed in this thread, since they
+	// share the slice provider and the image stack with the other handlers
+	std::vector<std::unique_ptr<SlicesHandler>> scratch(nr_workers);
+	for (auto& handler : scratch)
 	{
-		dummy3_d.Copy2tissue(0, m_ImageSlices[j].ReturnTissues(m_ActiveTissuelayer));
-		dummy3_d.Copy2tissue(between + 1, m_ImageSlices[j + 1].ReturnTissues(m_ActiveTissuelayer));
-		dummy3_d.Interpolatetissuegrey(0, between + 1); // TODO: Use interpolatetissuegrey_medianset?
-
-		dummy3_d.ExtractContours(minsize, tissuevec);
-		if (dp)
-			dummy3_d.DougpeuckLine(epsilon);
-		fp = dummy3_d.SaveContoursection(fp, 0, between, (between + 1) * j);
+		handler.reset(new SlicesHandler);
+		handler->Newbmp(m_Width, m_Height, between + 2);
+		handler->SetSlicethickness(m_Thickness / (between + 1));
+		handler->SetPixelsize(dx, dy);
 	}
 
-	fp = dummy3_d.SaveContoursection(fp, 0, 0, (between + 1) * (m_Nrslices - 1));
-
-	fp = dummy3_d.SaveTissuenamescolors(fp);
+	FILE* fp = scratch[0]->SaveContourprologue(filename, (between + 1) * m_Nrslices - between);
+	if (fp == nullptr)
+	{
+		ISEG_ERROR("Could not open " << filename);
+		return;
+	}
 
-	fclose(fp);
-}
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::map<unsigned, OutlineSlices> results;
+	unsigned next_task = 0;
+	unsigned nr_written = 0;
 
-void SlicesHandler::ExtractinterpolatesaveContours2Xmirrored(int minsize, std::vector<tissues_size_t>& tissuevec, unsigned short between, bool dp, float epsilon, const char* filename)
-{
-	std::vector<std::vector<Point>> v1, v2;
-	std::vector<point_type> v_p;
+	auto work = [&](SlicesHandler* handler) {
+		for (;;)
+		{
+			unsigned j;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				// don't get too far ahead of the writer
+				changed.wait(lock, [&] { return next_task >= nr_tasks || next_task < nr_written + max_pending; });
+				if (next_task >= nr_tasks)
+				{
+					return;
+				}
+				j = next_task++;
+			}
 
-	SlicesHandler dummy3_d;
-	dummy3_d.Newbmp((unsigned short)(m_ImageSlices[0].ReturnWidth()), (unsigned short)(m_ImageSlices[0].ReturnHeight()), between + 2);
-	dummy3_d.SetSlicethickness(m_Thickness / (between + 1));
-	Pair pair1 = GetPixelsize();
-	dummy3_d.SetPixelsize(pair1.high / 2, pair1.low / 2);
+			unsigned const j2 = std::min(j + 1, nr_tasks - 1);
+			handler->Copy2tissue(0, m_ImageSlices[j].ReturnTissues(m_ActiveTissuelayer));
+			handler->Copy2tissue(between + 1, m_ImageSlices[j2].ReturnTissues(m_ActiveTissuelayer));
+			handler->InterpolatetissuegreyNostack(0, between + 1); // TODO: Use interpolatetissuegrey_medianset?
+			extract(*handler);
 
-	FILE* fp = dummy3_d.SaveContourprologue(filename, (between + 1) * m_Nrslices - between);
+			OutlineSlices outlines = handler->m_Os;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				results[j] = std::move(outlines);
+			}
+			changed.notify_all();
+		}
+	};
 
-	for (unsigned short j = 0; j + 1 < m_Nrslices; j++)
+	std::vector<std::thread> workers;
+	for (auto& handler : scratch)
 	{
-		dummy3_d.Copy2tissue(0, m_ImageSlices[j].ReturnTissues(m_ActiveTissuelayer));
-		dummy3_d.Copy2tissue(between + 1, m_ImageSlices[j + 1].ReturnTissues(m_ActiveTissuelayer));
-		dummy3_d.Interpolatetissuegrey(0, between + 1); // TODO: Use interpolatetissuegrey_medianset?
+		workers.emplace_back(work, handler.get());
+	}
 
-		//		dummy3D.extract_contours2(minsize, tissuevec);
-		if (dp)
-		{
-			//			dummy3D.dougpeuck_line(epsilon*2);
-			dummy3_d.ExtractContours2Xmirrored(minsize, tissuevec, epsilon);
-		}
-		else
+	// write the sections in slice order
+	tissues_size_t const tissue_count = TissueInfos::GetTissueCount();
+	std::set<tissues_size_t> tissue_indices;
+	for (unsigned j = 0; j < nr_tasks; j++)
+	{
+		OutlineSlices outlines;
 		{
-			dummy3_d.ExtractContours2Xmirrored(minsize, tissuevec);
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [&] { return results.count(j) != 0; });
+			outlines = std::move(results[j]);
+			results.erase(j);
+			nr_written++;
 		}
-		dummy3_d.ShiftContours(-(int)dummy3_d.Width(), -(int)dummy3_d.Height());
-		fp = dummy3_d.SaveContoursection(fp, 0, between, (between + 1) * j);
+		changed.notify_all();
+
+		outlines.Printsection(fp, 0, (j + 1 < nr_tasks) ? between : 0, (between + 1) * j, tissue_count);
+		outlines.InsertTissueIndices(tissue_indices);
 	}
 
-	fp = dummy3_d.SaveContoursection(fp, 0, 0, (between + 1) * (m_Nrslices - 1));
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
 
-	fp = dummy3_d.SaveTissuenamescolors(fp);
+	SaveTissuenamescolors(fp, tissue_indices);
 
 	fclose(fp);
 }
@@ -4277,6 +4784,13 @@ void SlicesHandler::GetRange(Pair* pp)
 
 void SlicesHandler::ComputeRangeMode1(Pair* pp)
 {
+	if (m_LazyLoader)
+	{
+		// slices are still being read, only the active slice is guaranteed to be valid
+		ComputeRangeMode1(m_Activeslice, pp);
+		return;
+	}
+
 	// Update ranges for all mode 1 slices and compute total range
 	pp->low = FLT_MAX;
 	pp->high = 0.f;
@@ -4365,6 +4879,13 @@ void SlicesHandler::GetBmprange(Pair* pp)
 
 void SlicesHandler::ComputeBmprangeMode1(Pair* pp)
 {
+	if (m_LazyLoader)
+	{
+		// slices are still being read, only the active slice is guaranteed to be valid
+		ComputeBmprangeMode1(m_Activeslice, pp);
+		return;
+	}
+
 	// Update ranges for all mode 1 slices and compute total range
 	pp->low = FLT_MAX;
 	pp->high = 0.f;
@@ -4499,6 +5020,13 @@ FILE* SlicesHandler::SaveContoursection(FILE* fp, unsigned startslice1, unsigned
 }
 
 FILE* SlicesHandler::SaveTissuenamescolors(FILE* fp)
+{
+	std::set<tissues_size_t> tissue_indices;
+	m_Os.InsertTissueIndices(tissue_indices);
+	return SaveTissuenamescolors(fp, tissue_indices);
+}
+
+FILE* SlicesHandler::SaveTissuenamescolors(FILE* fp, const std::set<tissues_size_t>& tissue_indices)
 {
 	tissues_size_t tissue_count = TissueInfos::GetTissueCount();
 	TissueInfo* tissue_info;
@@ -4507,16 +5035,10 @@ FILE* SlicesHandler::SaveTissuenamescolors(FILE* fp)
 
 	if (tissue_count > 255)
 	{ // Only print tissue indices which contain outlines
-
-		// Collect used tissue indices in ascending order
-		std::set<tissues_size_t> tissue_indices;
-		m_Os.InsertTissueIndices(tissue_indices);
-		std::set<tissues_size_t>::iterator idx_it;
-		for (idx_it = tissue_indices.begin(); idx_it != tissue_indices.end();
-				 ++idx_it)
+		for (auto idx : tissue_indices)
 		{
-			tissue_info = TissueInfos::GetTissueInfo(*idx_it);
-			fprintf(fp, "T%i %f %f %f %s\n", (int)*idx_it, tissue_info->m_Color[0], tissue_info->m_Color[1], tissue_info->m_Color[2], tissue_info->m_Name.c_str());
+			tissue_info = TissueInfos::GetTissueInfo(idx);
+			fprintf(fp, "T%i %f %f %f %s\n", (int)idx, tissue_info->m_Color[0], tissue_info->m_Color[1], tissue_info->m_Color[2], tissue_info->m_Name.c_str());
 		}
 	}
 	else
@@ -5297,15 +5819,28 @@ void SlicesHandler::Interpolatetissuegrey(unsigned short slice1, unsigned short
 		slice2 = dummy;
 	}
 
-	const short n = slice2 - slice1;
-
-	if (n > 0)
+	if (slice2 > slice1)
 	{
 		m_ImageSlices[slice1].PushstackBmp();
 		m_ImageSlices[slice2].PushstackBmp();
 		m_ImageSlices[slice1].PushstackWork();
 		m_ImageSlices[slice2].PushstackWork();
 
+		InterpolatetissuegreyNostack(slice1, slice2);
+
+		m_ImageSlices[slice1].PopstackWork();
+		m_ImageSlices[slice2].PopstackWork();
+		m_ImageSlices[slice2].PopstackBmp();
+		m_ImageSlices[slice1].PopstackBmp();
+	}
+}
+
+void SlicesHandler::InterpolatetissuegreyNostack(unsigned short slice1, unsigned short slice2)
+{
+	const short n = slice2 - slice1;
+
+	if (n > 0)
+	{
 		m_ImageSlices[slice1].Tissue2work(m_ActiveTissuelayer);
 		m_ImageSlices[slice2].Tissue2work(m_ActiveTissuelayer);
 
@@ -5352,11 +5887,6 @@ void SlicesHandler::Interpolatetissuegrey(unsigned short slice1, unsigned short
 		{
 			m_ImageSlices[slice1 + j].SetMode(2, false);
 		}
-
-		m_ImageSlices[slice1].PopstackWork();
-		m_ImageSlices[slice2].PopstackWork();
-		m_ImageSlices[slice2].PopstackBmp();
-		m_ImageSlices[slice1].PopstackBmp();
 	}
 }
 
@@ -6154,6 +6684,8 @@ void SlicesHandler::SetDirectionCosines(const float dc[6])
 
 void SlicesHandler::SlicebmpX(float* return_bits, unsigned short xcoord)
 {
+	WaitForLazyLoad();
+
 	unsigned n = 0;
 	float* dummy;
 
@@ -6170,6 +6702,8 @@ void SlicesHandler::SlicebmpX(float* return_bits, unsigned short xcoord)
 
 void SlicesHandler::SlicebmpY(float* return_bits, unsigned short ycoord)
 {
+	WaitForLazyLoad();
+
 	unsigned n = 0;
 	float* dummy;
 
@@ -6202,6 +6736,8 @@ float* SlicesHandler::SlicebmpY(unsigned short ycoord)
 
 void SlicesHandler::SliceworkX(float* return_bits, unsigned short xcoord)
 {
+	WaitForLazyLoad();
+
 	unsigned n = 0;
 	float* dummy;
 
@@ -6218,6 +6754,8 @@ void SlicesHandler::SliceworkX(float* return_bits, unsigned short xcoord)
 
 void SlicesHandler::SliceworkY(float* return_bits, unsigned short ycoord)
 {
+	WaitForLazyLoad();
+
 	unsigned n = 0;
 	float* dummy;
 
@@ -6250,6 +6788,8 @@ float* SlicesHandler::SliceworkY(unsigned short ycoord)
 
 void SlicesHandler::SlicetissueX(tissues_size_t* return_bits, unsigned short xcoord)
 {
+	WaitForLazyLoad();
+
 	unsigned n = 0;
 	tissues_size_t* dummy;
 
@@ -6266,6 +6806,8 @@ void SlicesHandler::SlicetissueX(tissues_size_t* return_bits, unsigned short xco
 
 void SlicesHandler::SlicetissueY(tissues_size_t* return_bits, unsigned short ycoord)
 {
+	WaitForLazyLoad();
+
 	unsigned n = 0;
 	tissues_size_t* dummy;
 
@@ -6732,6 +7274,7 @@ void SlicesHandler::SetActiveSlice(unsigned short slice, bool signal_change)
 {
 	if (slice < m_Nrslices && slice != m_Activeslice)
 	{
+		RequestSlice(slice);
 		m_Activeslice = slice;
 
 		// notify observers that slice changed
@@ -6744,6 +7287,7 @@ void SlicesHandler::SetActiveSlice(unsigned short slice, bool signal_change)
 
 Bmphandler* SlicesHandler::GetActivebmphandler()
 {
+	RequestSlice(m_Activeslice);
 	return &(m_ImageSlices[m_Activeslice]);
 }
 
@@ -7084,9 +7628,12 @@ DataSelection SlicesHandler::Undo()
 				unsigned short current_slice;
 				DataSelection data_selection = m_Uelem->m_DataSelection;
 
+				// complete the snapshot instead of copying many slices
+				WaitForSnapshot();
 				for (unsigned i = 0; i < uelem1->m_Vslicenr.size(); i++)
 				{
 					current_slice = uelem1->m_Vslicenr[i];
+					SetDirty(current_slice, data_selection);
 					if (data_selection.bmp)
 					{
 						uelem1->m_VbmpNew.push_back(m_ImageSlices[current_slice].CopyBmp());
@@ -7144,6 +7691,7 @@ DataSelection SlicesHandler::Undo()
 			if (m_Uelem != nullptr)
 			{
 				DataSelection data_selection = m_Uelem->m_DataSelection;
+				SetDirty(data_selection.sliceNr, data_selection);
 
 				if (data_selection.bmp)
 				{
@@ -7224,9 +7772,11 @@ DataSelection SlicesHandler::Redo()
 			{
 				unsigned short current_slice;
 				DataSelection data_selection = m_Uelem->m_DataSelection;
+				WaitForSnapshot();
 				for (unsigned i = 0; i < uelem1->m_Vslicenr.size(); i++)
 				{
 					current_slice = uelem1->m_Vslicenr[i];
+					SetDirty(current_slice, data_selection);
 					if (data_selection.bmp)
 					{
 						uelem1->m_VbmpOld.push_back(m_ImageSlices[current_slice].CopyBmp());
@@ -7282,6 +7832,7 @@ DataSelection SlicesHandler::Redo()
 			if (m_Uelem != nullptr)
 			{
 				DataSelection data_selection = m_Uelem->m_DataSelection;
+				SetDirty(data_selection.sliceNr, data_selection);
 
 				if (data_selection.bmp)
 				{
@@ -7860,6 +8411,11 @@ void SlicesHandler::MaskSource(bool all_slices, float maskvalue)
 
 void SlicesHandler::MapTissueIndices(const std::vector<tissues_size_t>& indexMap)
 {
+	DataSelection selection;
+	selection.allSlices = true;
+	selection.tissues = true;
+	SetDirty(selection);
+
 	int const i_n = m_Nrslices;
 
 #pragma omp parallel for
@@ -7905,6 +8461,11 @@ void SlicesHandler::RemoveTissues(const std::set<tissues_size_t>& tissuenrs)
 
 void SlicesHandler::RemoveTissueall()
 {
+	DataSelection selection;
+	selection.allSlices = true;
+	selection.tissues = true;
+	SetDirty(selection);
+
 	for (short unsigned i = 0; i < m_Nrslices; i++)
 	{
 		m_ImageSlices[i].Cleartissuesall();
@@ -7919,6 +8480,11 @@ void SlicesHandler::RemoveTissueall()
 
 void SlicesHandler::CapTissue(tissues_size_t maxval)
 {
+	DataSelection selection;
+	selection.allSlices = true;
+	selection.tissues = true;
+	SetDirty(selection);
+
 	for (short unsigned i = 0; i < m_Nrslices; i++)
 	{
 		m_ImageSlices[i].CapTissue(maxval);
@@ -10341,72 +10907,26 @@ void SlicesHandler::AddSkintissue3DOutside(int ixyz, tissues_size_t f)
 	}
 }
 
-void SlicesHandler::FillSkin3d(int thicknessX, int thicknessY, int thicknessZ, tissues_size_t backgroundID, tissues_size_t skinID)
+void SlicesHandler::FillSkin3d(int thicknessX, int thicknessY, int thicknessZ, tissues_size_t backgroundID, tissues_size_t skinID, ProgressInfo* progress)
 {
-	int num_tasks = m_Nrslices;
-	QProgressDialog progress("Fill Skin in progress...", "Cancel", 0, num_tasks);
-	progress.show();
-	progress.setWindowModality(Qt::WindowModal);
-	progress.setModal(true);
-	progress.setValue(0);
+	if (progress)
+		progress->SetNumberOfSteps(3);
 
 	int skin_thick = thicknessX;
 
-	std::vector<int> dims;
-	dims.push_back(m_Width);
-	dims.push_back(m_Height);
-	dims.push_back(m_Nrslices);
-
 	double max_d = skin_thick == 1 ? 1.75 * skin_thick : 1.2 * skin_thick;
 
-	//Create the relative neighborhood
-	std::vector<std::vector<int>> offsets_slices;
-	for (int z = -skin_thick; z <= skin_thick; z++)
-	{
-		std::vector<int> offsets;
-		for (int y = -skin_thick; y <= skin_thick; y++)
-		{
-			for (int x = -skin_thick; x <= skin_thick; x++)
-			{
-				if (sqrt(x * x + y * y + z * z) < max_d)
-				{
-					int shift = x + y * dims[0];
-					if (shift != 0)
-					{
-						offsets.push_back(shift);
-					}
-				}
-			}
-		}
-		offsets_slices.push_back(offsets);
-	}
-
-	struct ChangesToMakeStruct
-	{
-		size_t m_SliceNumber;
-		int m_PositionConvert;
-
-		bool operator==(const ChangesToMakeStruct& m) const
-		{
-			return ((m.m_SliceNumber == m_SliceNumber) && (m.m_PositionConvert == m_PositionConvert));
-		}
-	};
-
 	bool there_is_bg = false;
 	bool there_is_skin = false;
-	//unsigned long bgPixels=0;
-	//unsigned long skinPixels=0;
-	for (int i = 0; i < dims[2]; i++)
+	for (unsigned short i = 0; i < m_Nrslices; i++)
 	{
 		tissues_size_t* tissues_main = m_ImageSlices[i].ReturnTissues(0);
-		for (int j = 0; j < m_Area && (!there_is_bg || !there_is_skin); j++)
+		for (unsigned j = 0; j < m_Area && (!there_is_bg || !there_is_skin); j++)
 		{
 			tissues_size_t value = tissues_main[j];
 			if (value == backgroundID)
-				//bgPixels++;
 				there_is_bg = true;
 			else if (value == skinID)
-				//skinPixels++;
 				there_is_skin = true;
 		}
 		if (there_is_skin && there_is_bg)
@@ -10415,20 +10935,16 @@ void SlicesHandler::FillSkin3d(int thicknessX, int thicknessY, int thicknessZ, t
 
 	if (!there_is_bg || !there_is_skin)
 	{
-		progress.setValue(num_tasks);
 		return;
 	}
 
-	std::vector<tissues_size_t*> tissues_vector;
-	for (int i = 0; i < m_ImageSlices.size(); i++)
-		tissues_vector.push_back(m_ImageSlices[i].ReturnTissues(0));
-
-	for (int i = 0; i < dims[2]; i++)
+	// the target is the distance to tissue 0, without using the bmp stack which is shared by all slices
+#pragma omp parallel for
+	for (int i = 0; i < m_Nrslices; i++)
 	{
 		float* bmp1 = m_ImageSlices[i].ReturnBmp();
-
 		tissues_size_t* tissue1 = m_ImageSlices[i].ReturnTissues(0);
-		m_ImageSlices[i].PushstackBmp();
+		std::vector<float> bmp_copy(bmp1, bmp1 + m_Area);
 
 		for (unsigned int j = 0; j < m_Area; j++)
 		{
@@ -10436,138 +10952,61 @@ void SlicesHandler::FillSkin3d(int thicknessX, int thicknessY, int thicknessZ, t
 		}
 
 		m_ImageSlices[i].DeadReckoning((float)0);
-		bmp1 = m_ImageSlices[i].ReturnWork();
+		m_ImageSlices[i].SetMode(2, false);
+		std::copy(bmp_copy.begin(), bmp_copy.end(), bmp1);
 	}
-
-#ifdef NO_OPENMP_SUPPORT
-	const int number_threads = 1;
-#else
-	const int number_threads = omp_get_max_threads();
-#endif
-	int slice_counter = 0;
-	std::vector<std::vector<ChangesToMakeStruct>> partial_changes_threads;
-
-	for (int i = 0; i < number_threads; i++)
+	if (progress)
+		progress->Increment();
+
+	// a background voxel is filled if skin and another tissue are within the (ellipsoidal) neighborhood,
+	// distances are in units of the x-thickness
+	int const t = std::max(skin_thick, 1);
+	DistanceTransform edt({m_Width, m_Height, m_Nrslices}, {1.f, float(t) / std::max(thicknessY, 1), float(t) / std::max(thicknessZ, 1)});
+	float const max_d2 = static_cast<float>(max_d * max_d);
+	size_t const n = edt.Size();
+
+	std::vector<unsigned char> seeds(n);
+	std::vector<unsigned char> near_skin(n);
+	std::vector<float> sqdist(n);
+	for (unsigned short i = 0; i < m_Nrslices; i++)
 	{
-		ChangesToMakeStruct sample;
-		sample.m_SliceNumber = -1;
-		sample.m_PositionConvert = -1;
-		std::vector<ChangesToMakeStruct> sample_per_thread;
-		sample_per_thread.push_back(sample);
-		partial_changes_threads.push_back(sample_per_thread);
+		tissues_size_t const* tissue1 = m_ImageSlices[i].ReturnTissues(0);
+		std::transform(tissue1, tissue1 + m_Area, seeds.begin() + size_t(i) * m_Area, [skinID](tissues_size_t v) -> unsigned char {
+			return v == skinID;
+		});
 	}
-
-	//if(skinPixels<bgPixels/neighbors)
+	edt.SquaredDistance(seeds.data(), sqdist.data());
+	for (size_t i = 0; i < n; i++)
 	{
-#pragma omp parallel for
-		for (int k = skin_thick; k < dims[2] - skin_thick; k++)
-		{
-			std::vector<ChangesToMakeStruct> partial_changes;
-
-			Point p;
-			for (int j = skin_thick; j < dims[1] - skin_thick; j++)
-			{
-				for (int i = skin_thick; i < dims[0] - skin_thick; i++)
-				{
-					int pos = i + j * dims[0];
-					if (tissues_vector[k][pos] == skinID)
-					{
-						for (int z = 0; z < offsets_slices.size(); z++)
-						{
-							size_t neighbor_slice = z - ((offsets_slices.size() - 1) / 2);
-
-							//iterate through neighbors of pixel
-							//if any of these are not
-							for (int l = 0; l < offsets_slices[z].size(); l++)
-							{
-								int idx = pos + offsets_slices[z][l];
-								assert(idx >= 0 && idx < m_Area);
-								p.px = i;
-								p.py = j;
-								tissues_size_t value = tissues_vector[k + neighbor_slice][idx];
-								if (value == backgroundID)
-								{
-									for (int y = 0; y < offsets_slices.size(); y++)
-									{
-										size_t neighbor_slice2 = y - ((offsets_slices.size() - 1) / 2);
-
-										//iterate through neighbors of pixel
-										//if any of these are not
-										for (int m = 0; m < offsets_slices[y].size(); m++)
-										{
-											int idx2 = idx + offsets_slices[y][m];
-											assert(idx2 >= 0 && idx2 < m_Area);
-											if (k + neighbor_slice + neighbor_slice2 < dims[2]) // && k + neighborSlice + neighborSlice2 >= 0 (always true)
-											{
-												tissues_size_t value2 = tissues_vector[k + neighbor_slice + neighbor_slice2][idx2];
-												if (value2 != backgroundID && value2 != skinID)
-												{
-													ChangesToMakeStruct changes;
-													changes.m_SliceNumber = k + neighbor_slice;
-													changes.m_PositionConvert = idx;
-													if (std::find(partial_changes.begin(), partial_changes.end(), changes) == partial_changes.end())
-														partial_changes.push_back(changes);
-													//image_slices[k+neighborSlice].return_work()[idx]=255.0f;
-													break;
-												}
-											}
-										}
-									}
-								}
-							}
-						}
-					}
-				}
-			}
-
-#ifdef NO_OPENMP_SUPPORT
-			int thread_id = 0;
-#else
-			int thread_id = omp_get_thread_num();
-#endif
-
-			for (int i = 0; i < partial_changes.size(); i++)
-			{
-				partial_changes_threads[thread_id].push_back(partial_changes[i]);
-			}
-
-			if (0 == thread_id)
-			{
-				slice_counter++;
-				progress.setValue(number_threads * slice_counter);
-			}
-		}
+		near_skin[i] = sqdist[i] < max_d2;
 	}
+	if (progress)
+		progress->Increment();
 
-	for (int i = 0; i < partial_changes_threads.size(); i++)
+	for (unsigned short i = 0; i < m_Nrslices; i++)
 	{
-		for (int j = 0; j < partial_changes_threads[i].size(); j++)
-		{
-			if (partial_changes_threads[i][j].m_SliceNumber != -1)
-			{
-				size_t slice = partial_changes_threads[i][j].m_SliceNumber;
-				int pos = partial_changes_threads[i][j].m_PositionConvert;
-				m_ImageSlices[slice].ReturnWork()[pos] = 255.0f;
-			}
-		}
+		tissues_size_t const* tissue1 = m_ImageSlices[i].ReturnTissues(0);
+		std::transform(tissue1, tissue1 + m_Area, seeds.begin() + size_t(i) * m_Area, [backgroundID, skinID](tissues_size_t v) -> unsigned char {
+			return v != backgroundID && v != skinID;
+		});
 	}
-	for (int i = dims[2] - 1; i >= 0; i--)
-	{
-		float* bmp1 = m_ImageSlices[i].ReturnBmp();
+	edt.SquaredDistance(seeds.data(), sqdist.data());
 
-		for (unsigned k = 0; k < m_Area; k++)
+#pragma omp parallel for
+	for (int i = 0; i < m_Nrslices; i++)
+	{
+		tissues_size_t const* tissue1 = m_ImageSlices[i].ReturnTissues(0);
+		float* work1 = m_ImageSlices[i].ReturnWork();
+		size_t const offset = size_t(i) * m_Area;
+		for (unsigned j = 0; j < m_Area; j++)
 		{
-			if (bmp1[k] < 0)
-				bmp1[k] = 0;
-			else
-				bmp1[k] = 255.0f;
+			if (tissue1[j] == backgroundID && near_skin[offset + j] && sqdist[offset + j] < max_d2)
+				work1[j] = 255.0f;
 		}
-
-		m_ImageSlices[i].SetMode(2, false);
-		m_ImageSlices[i].PopstackBmp();
 	}
 
-	progress.setValue(num_tasks);
+	if (progress)
+		progress->Increment();
 }
 
 float SlicesHandler::CalculateVolume(Point p, unsigned short slicenr)
@@ -10937,127 +11376,128 @@ void SlicesHandler::GetColor(size_t idx, unsigned char& r, unsigned char& g, uns
 
 bool SlicesHandler::ComputeTargetConnectivity(ProgressInfo* progress)
 {
-	using input_type = SlicesHandlerITKInterface::image_ref_type;
-	using image_type = itk::Image<unsigned, 3>;
-
-	SlicesHandlerITKInterface wrapper(this);
-	auto all_slices = wrapper.GetTarget(true);
-
-	auto observer = ItkProgressObserver::New();
+	auto all_slices = TargetSlices();
+	std::vector<float*> slices(all_slices.begin() + StartSlice(), all_slices.begin() + EndSlice());
+	std::array<unsigned, 3> const dims = {Width(), Height(), static_cast<unsigned>(slices.size())};
 
-	auto filter = itk::ConnectedComponentImageFilter<input_type, image_type>::New();
-	filter->SetInput(all_slices);
-	filter->SetFullyConnected(true);
 	if (progress)
-	{
-		observer->SetProgressInfo(progress);
-		filter->AddObserver(itk::ProgressEvent(), observer);
-	}
+		progress->SetNumberOfSteps(2);
 	try
 	{
-		filter->Update();
+		ConnectedComponents<float> labeling(dims, ConnectedComponents<float>::kVertices);
+		labeling.Compute(slices, [](float v) { return v != 0.f; }, false);
 
-		if (!progress || (progress && !progress->WasCanceled()))
+		if (progress)
 		{
-			// copy result back
-			iseg::Paste<image_type, input_type>(filter->GetOutput(), all_slices);
-
-			// auto-scale target rendering
-			SetTargetFixedRange(false);
+			progress->Increment();
+			if (progress->WasCanceled())
+				return false;
+		}
 
-			return true;
+		// copy result back, the components are numbered from 1
+		size_t const area = static_cast<size_t>(Width()) * Height();
+		std::int64_t const nrslices = slices.size();
+#pragma omp parallel for
+		for (std::int64_t z = 0; z < nrslices; ++z)
+		{
+			float* slice = slices[z];
+			for (size_t i = 0; i < area; ++i)
+			{
+				auto const label = labeling.Label(z * area + i);
+				slice[i] = (label == ConnectedComponents<float>::k_background) ? 0.f : static_cast<float>(label + 1);
+			}
 		}
+
+		// auto-scale target rendering
+		SetTargetFixedRange(false);
+
+		if (progress)
+			progress->Increment();
+		return true;
 	}
-	catch (itk::ExceptionObject& e)
+	catch (std::bad_alloc&)
 	{
-		ISEG_ERROR("Exception occurred: " << e.what());
+		ISEG_ERROR_MSG("not enough memory for the connected component analysis");
 	}
 	return false;
 }
 
 bool SlicesHandler::ComputeSplitTissues(tissues_size_t tissue, ProgressInfo* progress)
 {
-	using input_type = SlicesHandlerITKInterface::tissues_ref_type;
-	using internal_type = itk::Image<unsigned char, 3>;
-	using image_type = itk::Image<unsigned, 3>;
+	using labeling_type = ConnectedComponents<tissues_size_t>;
 
-	SlicesHandlerITKInterface wrapper(this);
-	auto all_slices = wrapper.GetTissues(true);
+	auto all_slices = TissueSlices(ActiveTissuelayer());
+	std::vector<tissues_size_t*> slices(all_slices.begin() + StartSlice(), all_slices.begin() + EndSlice());
+	std::array<unsigned, 3> const dims = {Width(), Height(), static_cast<unsigned>(slices.size())};
 
-	auto threshold = itk::BinaryThresholdImageFilter<input_type, internal_type>::New();
-	threshold->SetLowerThreshold(tissue);
-	threshold->SetUpperThreshold(tissue);
-	threshold->SetInput(all_slices);
-
-	auto filter = itk::ConnectedComponentImageFilter<internal_type, image_type>::New();
-	filter->SetInput(threshold->GetOutput());
-	filter->SetFullyConnected(true);
 	if (progress)
-	{
-		auto observer = ItkProgressObserver::New();
-		observer->SetProgressInfo(progress);
-		filter->AddObserver(itk::ProgressEvent(), observer);
-	}
+		progress->SetNumberOfSteps(2);
 	try
 	{
-		filter->Update();
-		auto components = filter->GetOutput();
+		labeling_type labeling(dims, labeling_type::kVertices);
+		size_t const n = labeling.Compute(slices, [tissue](tissues_size_t v) { return v == tissue; });
 
-		if (!progress || !progress->WasCanceled())
+		if (progress)
 		{
-			// add tissue infos
-			auto n = filter->GetObjectCount();
-			if (n > 1)
-			{
-				ISEG_INFO("Tissue has " << n << " regions");
+			progress->Increment();
+			if (progress->WasCanceled())
+				return false;
+		}
 
-				// find which object is largest -> this one will keep its original name & color
-				std::vector<size_t> hist(n + 1, 0);
-				itk::ImageRegionConstIterator<image_type> it(components, components->GetLargestPossibleRegion());
-				for (it.GoToBegin(); !it.IsAtEnd(); ++it)
-				{
-					hist[it.Get()]++;
-				}
-				hist[0] = 0;
-				const size_t max_label = std::distance(hist.begin(), std::max_element(hist.begin(), hist.end()));
-
-				// mapping from object number to new tissue index
-				tissues_size_t ninitial = TissueInfos::GetTissueCount();
-				std::vector<tissues_size_t> object2index(n + 1, 0);
-				object2index[max_label] = tissue;
-				tissues_size_t idx = 1;
-				for (tissues_size_t i = 1; i <= n; ++i)
+		if (n > 1)
+		{
+			ISEG_INFO("Tissue has " << n << " regions");
+
+			// find which object is largest -> this one will keep its original name & color
+			const auto& components = labeling.Components();
+			const size_t max_label = std::distance(components.begin(), std::max_element(components.begin(), components.end(), [](const labeling_type::Component& a, const labeling_type::Component& b) {
+				return a.m_Volume < b.m_Volume;
+			}));
+
+			// mapping from object number to new tissue index
+			tissues_size_t ninitial = TissueInfos::GetTissueCount();
+			std::vector<tissues_size_t> object2index(n, tissue);
+			tissues_size_t idx = 1;
+			for (size_t i = 0; i < n; ++i)
+			{
+				if (i != max_label)
 				{
-					if (i != max_label)
-					{
-						TissueInfo info(*TissueInfos::GetTissueInfo(tissue));
-						info.m_Name += (boost::format("_%d") % static_cast<int>(idx)).str();
-						TissueInfos::AddTissue(info);
-						object2index.at(i) = ninitial + idx++;
-					}
+					TissueInfo info(*TissueInfos::GetTissueInfo(tissue));
+					info.m_Name += (boost::format("_%d") % static_cast<int>(idx)).str();
+					TissueInfos::AddTissue(info);
+					object2index[i] = ninitial + idx++;
 				}
+			}
 
-				// iterate over connected components, add to tissues
-				itk::ImageRegionIterator<input_type> ot(all_slices, all_slices->GetLargestPossibleRegion());
-				for (it.GoToBegin(), ot.GoToBegin(); !it.IsAtEnd(); ++it, ++ot)
+			// iterate over connected components, add to tissues
+			size_t const area = static_cast<size_t>(Width()) * Height();
+			std::int64_t const nrslices = slices.size();
+#pragma omp parallel for
+			for (std::int64_t z = 0; z < nrslices; ++z)
+			{
+				tissues_size_t* slice = slices[z];
+				for (size_t i = 0; i < area; ++i)
 				{
-					if (it.Get() != 0)
+					auto const label = labeling.Label(z * area + i);
+					if (label != labeling_type::k_background)
 					{
-						ot.Set(object2index.at(it.Get()));
+						slice[i] = object2index[label];
 					}
 				}
-
-				return true;
-			}
-			else
-			{
-				ISEG_INFO("Tissue has only one connected region");
 			}
+
+			if (progress)
+				progress->Increment();
+			return true;
+		}
+		else
+		{
+			ISEG_INFO("Tissue has only one connected region");
 		}
 	}
-	catch (itk::ExceptionObject& e)
+	catch (std::bad_alloc&)
 	{
-		ISEG_ERROR("Exception occurred: " << e.what());
+		ISEG_ERROR_MSG("not enough memory for the connected component analysis");
 	}
 	return false;
 }
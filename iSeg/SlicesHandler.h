@@ -27,6 +27,8 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 class QString;
 class vtkImageData;
@@ -37,6 +39,8 @@ class Transform;
 class TissueHiearchy;
 class ColorLookupTable;
 class Bmphandler;
+class LazySliceLoader;
+class SnapshotWriter;
 class ProgressInfo;
 
 class SlicesHandler : public SlicesHandlerInterface
@@ -82,11 +86,30 @@ public:
 	int LoadAllXdmf(const char* filename);
 	int LoadAllHDF(const char* filename);
 
+	// Description: block until all slices of a lazily opened project are read
+	void WaitForLazyLoad();
+
 	void UpdateColorLookupTable(std::shared_ptr<ColorLookupTable> new_lut = nullptr);
 	std::shared_ptr<ColorLookupTable> GetColorLookupTable() { return m_ColorLookupTable; }
 
-	// Description: write project data into an Xdmf file
-	int SaveAllXdmf(const char* filename, int compression, bool save_work, bool naked);
+	// Description: write project data into an Xdmf file. If the .h5 file is the one written
+	// or read last, only the slices modified since then are rewritten. In the background mode
+	// the slices are written by a snapshot thread, while editing can continue
+	int SaveAllXdmf(const char* filename, int compression, bool save_work, bool naked, bool background = false);
+
+	// Description: block until a snapshot written in the background is complete
+	void WaitForSnapshot();
+	// Description: rename the (temporary, target) file pairs once the snapshot started by the
+	// last background save is complete, returns false if there is no such snapshot
+	bool ReplaceOnSnapshotSuccess(const std::vector<std::pair<std::string, std::string>>& renames);
+	bool SnapshotInProgress() const;
+
+	// Description: mark slices as modified since the last save, called before data is changed
+	void SetDirty(const DataSelection& dataSelection);
+	// Description: true if 'filename' is the .h5 file which was written or read last
+	bool IsSavedImageFile(const std::string& filename) const;
+	// Description: notify that the saved .h5 file was renamed
+	void SavedImageFileRenamed(const std::string& from, const std::string& to);
 	bool SaveMarkersHDF(const char* filename, bool naked, unsigned short version);
 	int SaveMergeAllXdmf(const char* filename, std::vector<QString>& mergeImagefilenames, unsigned short nrslicesTotal, int compression);
 	int ReadRaw(const char* filename, short unsigned w, short unsigned h, unsigned bitdepth, unsigned short slicenr, unsigned short nrofslices);
@@ -124,7 +147,7 @@ public:
 	int ReloadRTdose(const char* filename, unsigned short slicenr);
 	int ReloadAVW(const char* filename, unsigned short slicenr);
 	FILE* SaveHeader(FILE* fp, short unsigned nr_slices_to_write, Transform transform_to_write);
-	FILE* SaveProject(const char* filename, const char* imageFileExtension);
+	FILE* SaveProject(const char* filename, const char* imageFileExtension, bool background = false);
 	bool SaveCommunicationFile(const char* filename);
 	FILE* SaveActiveSlices(const char* filename, const char* imageFileExtension);
 	void LoadHeader(FILE* fp, int& tissuesVersion, int& version);
@@ -212,9 +235,17 @@ public:
 	void GetRangetissue(tissues_size_t* pp);
 	void Gaussian(float sigma);
 	void Average(unsigned short n);
+	/// Smooth the active slices in 3D, sigma is given in pixels along x
+	void Gaussian3D(float sigma);
+	void Average3D(unsigned short n);
 	void MedianInterquartile(bool median);
+	/// Percentile (0 to 100) of the bmp in a window of nx x ny x nz voxels (made odd) over the active slices
+	void PercentileFilter(unsigned short nx, unsigned short ny, unsigned short nz, float percentile);
 	void AnisoDiff(float dt, int n, float (*f)(float, float), float k, float restraint);
 	void ContAnisodiff(float dt, int n, float (*f)(float, float), float k, float restraint);
+	/// Perona-Malik diffusion of the active slices in 3D with the conductance 1 / (1 + (d/k)^2)
+	void AnisoDiff3D(float dt, int n, float k, float restraint);
+	void ContAnisodiff3D(float dt, int n, float k, float restraint);
 	void StepsmoothZ(unsigned short n);
 	void SmoothTissues(unsigned short n);
 	void Sigmafilter(float sigma, unsigned short nx, unsigned short ny);
@@ -359,7 +390,7 @@ public:
 	void AddSkintissue3DOutside2(int ix, int iy, int iz, tissues_size_t f);
 	bool ValueAtBoundary3D(float value);
 	bool TissuevalueAtBoundary3D(tissues_size_t value);
-	void FillSkin3d(int thicknessX, int thicknessY, int thicknessZ, tissues_size_t backgroundID, tissues_size_t skinID);
+	void FillSkin3d(int thicknessX, int thicknessY, int thicknessZ, tissues_size_t backgroundID, tissues_size_t skinID, ProgressInfo* progress = nullptr);
 	void GammaMhd(unsigned short slicenr, short nrtissues, short dim, std::vector<std::string> mhdfiles, float* weights, float** centers, float* tol_f, float* tol_d);
 	void FillUnassigned();
 	void FillUnassignedtissue(tissues_size_t f);
@@ -429,6 +460,8 @@ public:
 	void SetCompression(int c) { this->m_Hdf5Compression = c; }
 	bool GetContiguousMemory() const { return m_ContiguousMemoryIo; }
 	void SetContiguousMemory(bool v) { m_ContiguousMemoryIo = v; }
+	bool GetLazyLoading() const { return m_LazyLoading; }
+	void SetLazyLoading(bool v) { m_LazyLoading = v; }
 	bool SaveTarget() const { return m_SaveTarget; }
 	void SetSaveTarget(bool v) { m_SaveTarget = v; }
 
@@ -440,6 +473,9 @@ public:
 	void Mergetissues(tissues_size_t tissuetype);
 
 private:
+	/// waits until a lazily loaded slice is available, returns false if it could not be read
+	bool RequestSlice(unsigned short slice) const;
+
 	unsigned short m_Activeslice;
 	std::vector<Bmphandler> m_ImageSlices;
 	short unsigned m_Width;
@@ -466,7 +502,26 @@ private:
 	bool m_Undo3D;
 	int m_Hdf5Compression = 1;
 	bool m_ContiguousMemoryIo = false; // Default: slice-by-slice
+	bool m_LazyLoading = false;
+	std::unique_ptr<LazySliceLoader> m_LazyLoader;
+	// slices which the lazy loader could not read
+	std::vector<unsigned> m_UnreadSlices;
+	std::unique_ptr<SnapshotWriter> m_Snapshot;
 	bool m_SaveTarget = false;
+
+	/// Interpolates the tissues of consecutive slices in parallel and writes the outlines found by 'extract' in slice order
+	void InterpolatesaveContours(unsigned short between, float dx, float dy, const char* filename, const std::function<void(SlicesHandler&)>& extract);
+	/// Same as Interpolatetissuegrey, but overwrites source and target of slice1 and slice2 instead of using the (shared) image stack
+	void InterpolatetissuegreyNostack(unsigned short slice1, unsigned short slice2);
+	static FILE* SaveTissuenamescolors(FILE* fp, const std::set<tissues_size_t>& tissue_indices);
+
+	// Dirty slice tracking for incremental saves
+	enum eDirtyFlags { kDirtySource = 1, kDirtyTarget = 2, kDirtyTissue = 4 };
+	void SetDirty(unsigned short slice, const DataSelection& dataSelection);
+	void SetSavedImageFile(const std::string& filename);
+	bool CanSaveIncrementally(const std::string& filename, bool save_work) const;
+	std::vector<unsigned char> m_DirtySlices;
+	std::string m_SavedImageFile;
 };
 
 } // namespace iseg
@@ -52,12 +52,19 @@ SmoothingWidget::SmoothingWidget(SlicesHandler* hand3D)
 	m_Allslices = group->Add("AllSlices", PropertyBool::Create(false));
 	m_Allslices->SetDescription("Apply to all slices");
 
+	m_Use3D = group->Add("3D", PropertyBool::Create(false));
+	m_Use3D->SetDescription("Smooth across slices");
+	m_Use3D->SetToolTip("If applied to all slices, filter in 3D instead of each slice separately.");
+
 	m_SlSigma = group->Add("Sigma", PropertySlider::Create(20, 1, 100)); // left=0, right=5
 	m_SlSigma->SetToolTip("Sigma gives the radius of the smoothing filter. Larger values remove more details.");
 
 	m_SbN = group->Add("Width", PropertyInt::Create(5, 1, 11));
 	m_SbN->SetToolTip("The width of the kernel in pixels.");
 
+	m_SbDepth = group->Add("Depth", PropertyInt::Create(1, 1, 11));
+	m_SbDepth->SetToolTip("The number of slices in the kernel, if applied to all slices.");
+
 	m_SbIter = group->Add("Iterations", PropertyInt::Create(20, 1, 100));
 
 	m_SlK = group->Add("Sigma", PropertySlider::Create(50, 0, 100));
@@ -123,20 +130,30 @@ void SmoothingWidget::Execute()
 	{
 		if (m_Modegroup->Value() == kGaussian)
 		{
-			m_Handler3D->Gaussian(m_SlSigma->Value() * 0.05f);
+			if (m_Use3D->Value())
+				m_Handler3D->Gaussian3D(m_SlSigma->Value() * 0.05f);
+			else
+				m_Handler3D->Gaussian(m_SlSigma->Value() * 0.05f);
 		}
 		else if (m_Modegroup->Value() == kAverage)
 		{
-			m_Handler3D->Average((short unsigned)m_SbN->Value());
+			if (m_Use3D->Value())
+				m_Handler3D->Average3D((short unsigned)m_SbN->Value());
+			else
+				m_Handler3D->Average((short unsigned)m_SbN->Value());
 		}
 		else if (m_Modegroup->Value() == kMedian)
 		{
-			m_Handler3D->MedianInterquartile(true);
+			m_Handler3D->PercentileFilter((short unsigned)m_SbN->Value(), (short unsigned)m_SbN->Value(), (short unsigned)m_SbDepth->Value(), 50.f);
 		}
 		else if (m_Modegroup->Value() == kSigmafilter)
 		{
 			m_Handler3D->Sigmafilter((m_SlK->Value() + 1) * 0.01f * m_SbKmax->Value(), (short unsigned)m_SbN->Value(), (short unsigned)m_SbN->Value());
 		}
+		else if (m_Use3D->Value())
+		{
+			m_Handler3D->AnisoDiff3D(1.0f, m_SbIter->Value(), m_SlK->Value() * 0.01f * m_SbKmax->Value(), m_SlRestrain->Value() * 0.01f);
+		}
 		else
 		{
 			m_Handler3D->AnisoDiff(1.0f, m_SbIter->Value(), f2, m_SlK->Value() * 0.01f * m_SbKmax->Value(), m_SlRestrain->Value() * 0.01f);
@@ -154,7 +171,7 @@ void SmoothingWidget::Execute()
 		}
 		else if (m_Modegroup->Value() == kMedian)
 		{
-			m_Bmphand->MedianInterquartile(true);
+			m_Bmphand->PercentileFilter((short unsigned)m_SbN->Value(), (short unsigned)m_SbN->Value(), 50.f);
 		}
 		else if (m_Modegroup->Value() == kSigmafilter)
 		{
@@ -172,7 +189,9 @@ void SmoothingWidget::Execute()
 void SmoothingWidget::MethodChanged()
 {
 	m_SlSigma->SetVisible(m_Modegroup->Value() == kGaussian);
-	m_SbN->SetVisible(m_Modegroup->Value() == kAverage || m_Modegroup->Value() == kSigmafilter);
+	m_SbN->SetVisible(m_Modegroup->Value() == kAverage || m_Modegroup->Value() == kMedian || m_Modegroup->Value() == kSigmafilter);
+	m_SbDepth->SetVisible(m_Modegroup->Value() == kMedian);
+	m_Use3D->SetVisible(m_Modegroup->Value() == kGaussian || m_Modegroup->Value() == kAverage || m_Modegroup->Value() == kAnisodiff);
 	m_SlK->SetVisible(m_Modegroup->Value() == kSigmafilter || m_Modegroup->Value() == kAnisodiff);
 	m_SbKmax->SetVisible(m_Modegroup->Value() == kSigmafilter || m_Modegroup->Value() == kAnisodiff);
 
@@ -197,7 +216,9 @@ void SmoothingWidget::SigmasliderChanged(int v)
 {
 	if (m_Modegroup->Value() == kGaussian)
 	{
-		if (m_Allslices->Value())
+		if (m_Allslices->Value() && m_Use3D->Value())
+			m_Handler3D->Gaussian3D(v * 0.05f);
+		else if (m_Allslices->Value())
 			m_Handler3D->Gaussian(v * 0.05f);
 		else
 			m_Bmphand->Gaussian(v * 0.05f);
@@ -246,7 +267,11 @@ void SmoothingWidget::NChanged()
 	}
 	else if (m_Modegroup->Value() == kAverage)
 	{
-		if (m_Allslices->Value())
+		if (m_Allslices->Value() && m_Use3D->Value())
+		{
+			m_Handler3D->Average3D((short unsigned)m_SbN->Value());
+		}
+		else if (m_Allslices->Value())
 		{
 			m_Handler3D->Average((short unsigned)m_SbN->Value());
 		}
@@ -293,7 +318,11 @@ void SmoothingWidget::ContinueDiff()
 	data_selection.work = true;
 	emit BeginDatachange(data_selection, this);
 
-	if (m_Allslices->Value())
+	if (m_Allslices->Value() && m_Use3D->Value())
+	{
+		m_Handler3D->ContAnisodiff3D(1.0f, m_SbIter->Value(), m_SlK->Value() * 0.01f * m_SbKmax->Value(), m_SlRestrain->Value() * 0.01f);
+	}
+	else if (m_Allslices->Value())
 	{
 		m_Handler3D->ContAnisodiff(1.0f, m_SbIter->Value(), f2, m_SlK->Value() * 0.01f * m_SbKmax->Value(), m_SlRestrain->Value() * 0.01f);
 	}
@@ -56,10 +56,12 @@ private:
 	PropertySlider_ptr m_SlRestrain;
 
 	PropertyInt_ptr m_SbN;
+	PropertyInt_ptr m_SbDepth;
 	PropertyInt_ptr m_SbIter;
 	PropertyInt_ptr m_SbKmax;
 
 	PropertyBool_ptr m_Allslices;
+	PropertyBool_ptr m_Use3D;
 
 	enum eModeTypes {
 		kGaussian,
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "SnapshotWriter.h"
+
+#include "Data/ScopedTimer.h"
+
+#include "Core/HDF5IO.h"
+
+#include <boost/filesystem.hpp>
+
+namespace iseg {
+
+SnapshotWriter::SnapshotWriter(const std::string& h5_filename, const std::vector<float*>& image_slices, const std::vector<float*>& work_slices, const std::vector<tissues_size_t*>& tissue_slices, size_t slice_size)
+		: m_FileName(h5_filename), m_ImageSlices(image_slices), m_WorkSlices(work_slices), m_TissueSlices(tissue_slices), m_SliceSize(slice_size), m_ImageCopies(image_slices.size()), m_WorkCopies(image_slices.size()), m_TissueCopies(image_slices.size()), m_IsWritten(image_slices.size(), 0), m_Writing(static_cast<unsigned>(image_slices.size()))
+{
+	// the target is optional
+	m_WorkSlices.resize(m_ImageSlices.size(), nullptr);
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+	// the snapshot is always completed, so the pending renames are not lost
+	if (m_Thread.joinable())
+	{
+		m_Thread.join();
+	}
+}
+
+void SnapshotWriter::Start()
+{
+	m_Thread = std::thread(&SnapshotWriter::Run, this);
+}
+
+void SnapshotWriter::Unpin(unsigned slice, bool source, bool target, bool tissue)
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	if (slice >= m_IsWritten.size())
+	{
+		return;
+	}
+	m_Written.wait(lock, [this, slice]() { return m_Writing != slice; });
+	if (m_Done || m_IsWritten[slice])
+	{
+		return;
+	}
+
+	// keep the state at the time the snapshot was started
+	if (source && m_ImageSlices[slice] && m_ImageCopies[slice].empty())
+	{
+		m_ImageCopies[slice].assign(m_ImageSlices[slice], m_ImageSlices[slice] + m_SliceSize);
+		m_ImageSlices[slice] = m_ImageCopies[slice].data();
+	}
+	if (target && m_WorkSlices[slice] && m_WorkCopies[slice].empty())
+	{
+		m_WorkCopies[slice].assign(m_WorkSlices[slice], m_WorkSlices[slice] + m_SliceSize);
+		m_WorkSlices[slice] = m_WorkCopies[slice].data();
+	}
+	if (tissue && m_TissueSlices[slice] && m_TissueCopies[slice].empty())
+	{
+		m_TissueCopies[slice].assign(m_TissueSlices[slice], m_TissueSlices[slice] + m_SliceSize);
+		m_TissueSlices[slice] = m_TissueCopies[slice].data();
+	}
+}
+
+bool SnapshotWriter::Wait()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_Written.wait(lock, [this]() { return m_Done; });
+	return !m_Failed;
+}
+
+void SnapshotWriter::ReplaceOnSuccess(const std::vector<std::pair<std::string, std::string>>& renames)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (!m_Done)
+	{
+		// renamed by the worker thread when it is done
+		m_Renames = renames;
+	}
+	else if (!m_Failed)
+	{
+		m_Failed = !Replace(renames);
+	}
+}
+
+bool SnapshotWriter::Replace(const std::vector<std::pair<std::string, std::string>>& renames)
+{
+	// rename replaces an existing target atomically
+	for (const auto& r : renames)
+	{
+		boost::system::error_code ec;
+		boost::filesystem::rename(r.first, r.second, ec);
+		if (ec)
+		{
+			ISEG_ERROR("could not rename " << r.first << " to " << r.second << ": " << ec.message());
+			return false;
+		}
+	}
+	return true;
+}
+
+bool SnapshotWriter::Finished() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Done;
+}
+
+bool SnapshotWriter::WriteSlice(long long file, unsigned slice, float* image, float* work, tissues_size_t* tissue)
+{
+	HDF5IO io;
+	size_t const offset = static_cast<size_t>(slice) * m_SliceSize;
+
+	bool ok = true;
+	if (image)
+	{
+		ok = ok && io.WriteData(file, "Source", &image, 1, m_SliceSize, offset);
+	}
+	if (work)
+	{
+		ok = ok && io.WriteData(file, "Target", &work, 1, m_SliceSize, offset);
+	}
+	if (tissue)
+	{
+		ok = ok && io.WriteData(file, "Tissue", &tissue, 1, m_SliceSize, offset);
+	}
+	return ok;
+}
+
+void SnapshotWriter::Run()
+{
+	ScopedTimer timer("Writing snapshot");
+
+	HDF5IO io;
+	auto file = io.Create(m_FileName, true);
+	bool ok = (file >= 0);
+
+	unsigned const n = static_cast<unsigned>(m_IsWritten.size());
+	for (unsigned slice = 0; ok && slice < n; ++slice)
+	{
+		float* image = nullptr;
+		float* work = nullptr;
+		tissues_size_t* tissue = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Writing = slice;
+			image = m_ImageSlices[slice];
+			work = m_WorkSlices[slice];
+			tissue = m_TissueSlices[slice];
+		}
+
+		ok = WriteSlice(file, slice, image, work, tissue);
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_IsWritten[slice] = 1;
+			m_Writing = n;
+			// release the copies as soon as possible
+			std::vector<float>().swap(m_ImageCopies[slice]);
+			std::vector<float>().swap(m_WorkCopies[slice]);
+			std::vector<tissues_size_t>().swap(m_TissueCopies[slice]);
+		}
+		m_Written.notify_all();
+	}
+
+	if (!ok)
+	{
+		ISEG_ERROR("writing snapshot to " << m_FileName);
+	}
+	ok = io.Close(file) && ok;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		// the targets are only replaced by a complete snapshot
+		m_Failed = !(ok && Replace(m_Renames));
+		m_Writing = n;
+		m_Done = true;
+	}
+	m_Written.notify_all();
+}
+
+} // namespace iseg
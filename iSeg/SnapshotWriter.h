@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "Data/Types.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace iseg {
+
+/** \brief Writes a snapshot of the source, target and tissue slices into an existing HDF5 file.
+
+	The datasets must already exist in the file. The slice buffers are pinned, i.e. the writer
+	reads the live buffers of the slices handler. Before a pinned slice is modified, Unpin()
+	must be called: it copies the slice unless it has already been written, so the snapshot
+	contains the data at the time it was started while editing continues. Slices which should
+	not be written are passed as nullptr.
+
+	All HDF5 calls are made by the worker thread, so the caller must not access any HDF5 file
+	(unless the library is thread-safe) until Wait() has returned.
+
+	The snapshot should be written to a temporary file: the files passed to ReplaceOnSuccess()
+	are renamed over their targets only after all slices were written, so an interrupted
+	snapshot never leaves a truncated project behind.
+*/
+class SnapshotWriter
+{
+public:
+	SnapshotWriter(const std::string& h5_filename, const std::vector<float*>& image_slices, const std::vector<float*>& work_slices, const std::vector<tissues_size_t*>& tissue_slices, size_t slice_size);
+	~SnapshotWriter();
+
+	/// Start writing in the background
+	void Start();
+
+	/// Called before the buffers of 'slice' are modified
+	void Unpin(unsigned slice, bool source, bool target, bool tissue);
+
+	/// Block until all slices have been written, returns false if writing or renaming failed
+	bool Wait();
+
+	/// Rename each (temporary, target) pair once the snapshot has been written successfully
+	void ReplaceOnSuccess(const std::vector<std::pair<std::string, std::string>>& renames);
+
+	bool Finished() const;
+	const std::string& FileName() const { return m_FileName; }
+
+private:
+	void Run();
+	bool WriteSlice(long long file, unsigned slice, float* image, float* work, tissues_size_t* tissue);
+	static bool Replace(const std::vector<std::pair<std::string, std::string>>& renames);
+
+	std::string m_FileName;
+	std::vector<float*> m_ImageSlices;
+	std::vector<float*> m_WorkSlices;
+	std::vector<tissues_size_t*> m_TissueSlices;
+	size_t m_SliceSize;
+
+	// copies of slices which were modified before they were written
+	std::vector<std::vector<float>> m_ImageCopies;
+	std::vector<std::vector<float>> m_WorkCopies;
+	std::vector<std::vector<tissues_size_t>> m_TissueCopies;
+
+	mutable std::mutex m_Mutex;
+	std::condition_variable m_Written;
+	std::vector<unsigned char> m_IsWritten;
+	std::vector<std::pair<std::string, std::string>> m_Renames;
+	unsigned m_Writing;
+	bool m_Done = false;
+	bool m_Failed = false;
+	std::thread m_Thread;
+};
+
+} // namespace iseg
@@ -12,280 +12,78 @@
 #include "TissueCleaner.h"
 #include "TissueInfos.h"
 
-#include <cstdlib>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <new>
 
 namespace iseg {
 
-int TissueCleaner::BaseConnection(int c)
+TissueCleaner::TissueCleaner(const std::vector<tissues_size_t*>& slices, unsigned short width, unsigned short height)
+		: m_Slices(slices), m_Width(width), m_Height(height)
 {
-	if (c == m_Map[c])
-		return c;
-	else
-		return m_Map[c] = BaseConnection(m_Map[c]);
+	std::fill(m_Totvolumes, m_Totvolumes + TISSUES_SIZE_MAX + 1, 0);
 }
 
-TissueCleaner::TissueCleaner(tissues_size_t** slices1, unsigned short n1, unsigned short width1, unsigned short height1)
+bool TissueCleaner::ConnectedComponents()
 {
-	m_Slices = slices1;
-	m_Nrslices = static_cast<size_t>(n1);
-	m_Width = static_cast<size_t>(width1);
-	m_Height = static_cast<size_t>(height1);
-	m_Volume = nullptr;
-	m_Map.clear();
-}
-
-TissueCleaner::~TissueCleaner() { free(m_Volume); }
-
-bool TissueCleaner::Allocate()
-{
-	m_Volume = (int*)malloc(sizeof(int) * m_Width * m_Height * m_Nrslices);
-	if (m_Volume == nullptr)
-		return false;
-	return true;
-}
-
-void TissueCleaner::ConnectedComponents()
-{
-	m_Map.clear();
-	int newest = 0;
-
-	size_t offset[4];
-	offset[0] = 1;
-	offset[1] = m_Width;
-	offset[2] = m_Width * m_Height;
-	offset[3] = offset[2] * m_Nrslices;
-
-	size_t i1 = 0;
-	size_t i2 = 0;
-
-	// init first pixel
-	m_Map.push_back(newest);
-	m_Tissuemap.push_back(m_Slices[0][i1]);
-	m_Volume[i1] = newest;
-	newest++;
-	i1++;
-	// init first row
-	for (unsigned short k = 1; k < m_Width; k++)
-	{
-		if (m_Slices[0][i1] == m_Slices[0][i1 - 1])
-		{
-			m_Volume[i1] = BaseConnection(m_Volume[i1 - 1]);
-		}
-		else
-		{
-			m_Map.push_back(newest);
-			m_Tissuemap.push_back(m_Slices[0][i1]);
-			m_Volume[i1] = newest;
-			newest++;
-		}
-		i1++;
-	}
-	// init first slice
-	for (unsigned short j = 1; j < m_Height; j++)
+	std::array<unsigned, 3> const dims = {static_cast<unsigned>(m_Width), static_cast<unsigned>(m_Height), static_cast<unsigned>(m_Slices.size())};
+	try
 	{
-		if (m_Slices[0][i1] == m_Slices[0][i1 - m_Width])
-		{
-			m_Volume[i1] = BaseConnection(m_Volume[i1 - m_Width]);
-		}
-		else
-		{
-			m_Map.push_back(newest);
-			m_Tissuemap.push_back(m_Slices[0][i1]);
-			m_Volume[i1] = newest;
-			newest++;
-		}
-		i1++;
-		for (unsigned short k = 1; k < m_Width; k++)
-		{
-			if (m_Slices[0][i1] == m_Slices[0][i1 - 1])
-			{
-				m_Volume[i1] = BaseConnection(m_Volume[i1 - 1]);
-				if (m_Slices[0][i1] == m_Slices[0][i1 - m_Width])
-				{
-					m_Map[(int)BaseConnection(m_Volume[i1 - m_Width])] = m_Volume[i1];
-				}
-			}
-			else
-			{
-				if (m_Slices[0][i1] == m_Slices[0][i1 - m_Width])
-				{
-					m_Volume[i1] = BaseConnection(m_Volume[i1 - m_Width]);
-				}
-				else
-				{
-					m_Map.push_back(newest);
-					m_Tissuemap.push_back(m_Slices[0][i1]);
-					m_Volume[i1] = newest;
-					newest++;
-				}
-			}
-			i1++;
-		}
+		m_Labeling.reset(new iseg::ConnectedComponents<tissues_size_t>(dims, iseg::ConnectedComponents<tissues_size_t>::kFaces));
+		m_Labeling->Compute(m_Slices);
 	}
-	// for each slice >= 1
-	for (unsigned short i = 1; i < m_Nrslices; i++)
+	catch (std::bad_alloc&)
 	{
-		i2 = 0;
-		if (m_Slices[i][i2] == m_Slices[i - 1][i2])
-			m_Volume[i1] = BaseConnection(m_Volume[i1 - offset[2]]);
-		else
-		{
-			m_Map.push_back(newest);
-			m_Tissuemap.push_back(m_Slices[i][i2]);
-			m_Volume[i1] = newest;
-			newest++;
-		}
-		i1++;
-		i2++;
-		for (unsigned short k = 1; k < m_Width; k++)
-		{
-			if (m_Slices[i][i2] == m_Slices[i][i2 - 1])
-			{
-				m_Volume[i1] = BaseConnection(m_Volume[i1 - 1]);
-				if (m_Slices[i][i2] == m_Slices[i - 1][i2])
-				{
-					m_Map[(int)BaseConnection(m_Volume[i1 - offset[2]])] =
-							m_Volume[i1];
-				}
-			}
-			else
-			{
-				if (m_Slices[i][i2] == m_Slices[i - 1][i2])
-					m_Volume[i1] = BaseConnection(m_Volume[i1 - offset[2]]);
-				else
-				{
-					m_Map.push_back(newest);
-					m_Tissuemap.push_back(m_Slices[i][i2]);
-					m_Volume[i1] = newest;
-					newest++;
-				}
-			}
-			i1++;
-			i2++;
-		}
-		for (unsigned short j = 1; j < m_Height; j++)
-		{
-			if (m_Slices[i][i2] == m_Slices[i][i2 - m_Width])
-			{
-				m_Volume[i1] = BaseConnection(m_Volume[i1 - m_Width]);
-				if (m_Slices[i][i2] == m_Slices[i - 1][i2])
-				{
-					m_Map[(int)BaseConnection(m_Volume[i1 - offset[2]])] =
-							m_Volume[i1];
-				}
-			}
-			else
-			{
-				if (m_Slices[i][i2] == m_Slices[i - 1][i2])
-					m_Volume[i1] = BaseConnection(m_Volume[i1 - offset[2]]);
-				else
-				{
-					m_Map.push_back(newest);
-					m_Tissuemap.push_back(m_Slices[i][i2]);
-					m_Volume[i1] = newest;
-					newest++;
-				}
-			}
-			i1++;
-			i2++;
-			for (unsigned short k = 1; k < m_Width; k++)
-			{
-				if (m_Slices[i][i2] == m_Slices[i][i2 - 1])
-				{
-					m_Volume[i1] = BaseConnection(m_Volume[i1 - 1]);
-					if (m_Slices[i][i2] == m_Slices[i][i2 - m_Width])
-					{
-						m_Map[(int)BaseConnection(m_Volume[i1 - m_Width])] =
-								m_Volume[i1];
-					}
-					if (m_Slices[i][i2] == m_Slices[i - 1][i2])
-					{
-						m_Map[(int)BaseConnection(m_Volume[i1 - offset[2]])] =
-								m_Volume[i1];
-					}
-				}
-				else
-				{
-					if (m_Slices[i][i2] == m_Slices[i][i2 - m_Width])
-					{
-						m_Volume[i1] = BaseConnection(m_Volume[i1 - m_Width]);
-						if (m_Slices[i][i2] == m_Slices[i - 1][i2])
-						{
-							m_Map[(int)BaseConnection(m_Volume[i1 - offset[2]])] =
-									m_Volume[i1];
-						}
-					}
-					else
-					{
-						if (m_Slices[i][i2] == m_Slices[i - 1][i2])
-							m_Volume[i1] =
-									BaseConnection(m_Volume[i1 - offset[2]]);
-						else
-						{
-							m_Map.push_back(newest);
-							m_Tissuemap.push_back(m_Slices[i][i2]);
-							m_Volume[i1] = newest;
-							newest++;
-						}
-					}
-				}
-				i1++;
-				i2++;
-			}
-		}
+		m_Labeling.reset();
+		return false;
 	}
-
-	// map connected regions to single ID
-	for (size_t i = 0; i < offset[3]; i++)
-		m_Volume[i] = BaseConnection(m_Volume[i]);
+	return true;
 }
 
 void TissueCleaner::MakeStat()
 {
-	for (unsigned i = 0; i < TISSUES_SIZE_MAX + 1; i++)
-		m_Totvolumes[i] = 0;
-	m_Volumes.resize(m_Map.size(), 0);
-	if (m_Volume == nullptr)
+	std::fill(m_Totvolumes, m_Totvolumes + TISSUES_SIZE_MAX + 1, 0);
+	if (!m_Labeling)
 		return;
-	size_t maxi = m_Nrslices * (size_t)m_Width * size_t(m_Height);
-	for (unsigned long long i = 0; i < maxi; i++)
-	{
-		m_Volumes[m_Volume[i]]++;
-	}
-	for (size_t i = 0; i < m_Map.size(); i++)
+	for (const auto& c : m_Labeling->Components())
 	{
-		if (m_Map[i] == i)
-			m_Totvolumes[m_Tissuemap[i]] += m_Volumes[i];
+		m_Totvolumes[c.m_Value] += static_cast<unsigned>(c.m_Volume);
 	}
 }
 
 void TissueCleaner::Clean(float ratio, unsigned minsize)
 {
-	if (m_Volume == nullptr)
+	if (!m_Labeling)
 		return;
-	std::vector<bool> erasemap;
-	erasemap.resize(m_Map.size(), false);
-	for (size_t i = 0; i < m_Map.size(); i++)
+	const auto& components = m_Labeling->Components();
+	std::vector<bool> erasemap(components.size(), false);
+	for (size_t i = 0; i < components.size(); i++)
 	{
-		if (m_Volumes[i] < minsize && m_Volumes[i] < ratio * m_Totvolumes[m_Tissuemap[i]])
+		const auto& c = components[i];
+		if (c.m_Volume < minsize && c.m_Volume < ratio * m_Totvolumes[c.m_Value])
 		{
 			// only remove small components if tissue is NOT locked!
-			if (!TissueInfos::GetTissueLocked(m_Tissuemap[i]))
+			if (!TissueInfos::GetTissueLocked(c.m_Value))
 			{
 				erasemap[i] = true;
 			}
 		}
 	}
 
-	tissues_size_t curchar = 0;
-	size_t postot = 0;
-	for (unsigned short i = 0; i < m_Nrslices; i++)
+	// erased voxels take the tissue on their left
+	size_t const area = m_Width * m_Height;
+	std::int64_t const nrslices = m_Slices.size();
+#pragma omp parallel for
+	for (std::int64_t i = 0; i < nrslices; i++)
 	{
+		tissues_size_t* slice = m_Slices[i];
+		size_t postot = i * area;
 		size_t pos = 0;
-		for (unsigned short j = 0; j < m_Height; j++)
+		for (size_t j = 0; j < m_Height; j++)
 		{
-			unsigned short k = 0;
-			while (k < m_Width && erasemap[m_Volume[postot]])
+			size_t k = 0;
+			while (k < m_Width && erasemap[m_Labeling->Label(postot)])
 			{
 				postot++;
 				k++;
@@ -298,15 +96,15 @@ void TissueCleaner::Clean(float ratio, unsigned minsize)
 			else
 			{
 				size_t pos1 = pos + k;
-				curchar = m_Slices[i][pos1];
+				tissues_size_t curchar = slice[pos1];
 				for (; pos < pos1; pos++)
-					m_Slices[i][pos] = curchar;
+					slice[pos] = curchar;
 				for (; k < m_Width; k++, pos++, postot++)
 				{
-					if (erasemap[m_Volume[postot]])
-						m_Slices[i][pos] = curchar;
+					if (erasemap[m_Labeling->Label(postot)])
+						slice[pos] = curchar;
 					else
-						curchar = m_Slices[i][pos];
+						curchar = slice[pos];
 				}
 			}
 		}
@@ -11,6 +11,9 @@
 
 #include "Data/Types.h"
 
+#include "Core/ConnectedComponents.h"
+
+#include <memory>
 #include <vector>
 
 namespace iseg {
@@ -18,23 +21,17 @@ namespace iseg {
 class TissueCleaner
 {
 public:
-	TissueCleaner(tissues_size_t** slices1, unsigned short n1, unsigned short width1, unsigned short height1);
-	~TissueCleaner();
-	bool Allocate();
-	void ConnectedComponents();
+	TissueCleaner(const std::vector<tissues_size_t*>& slices, unsigned short width, unsigned short height);
+	/// Label the connected regions of each tissue, returns false if there is not enough memory
+	bool ConnectedComponents();
 	void Clean(float ratio, unsigned minsize);
 	void MakeStat();
 
 private:
-	int BaseConnection(int c);
-	std::vector<int> m_Map;
-	std::vector<tissues_size_t> m_Tissuemap;
-	std::vector<unsigned> m_Volumes;
+	std::unique_ptr<iseg::ConnectedComponents<tissues_size_t>> m_Labeling;
 	unsigned m_Totvolumes[TISSUES_SIZE_MAX + 1];
-	int* m_Volume;
-	tissues_size_t** m_Slices;
+	std::vector<tissues_size_t*> m_Slices;
 	size_t m_Width, m_Height;
-	size_t m_Nrslices;
 };
 
 } // namespace iseg
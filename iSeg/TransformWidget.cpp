@@ -73,6 +73,9 @@ TransformWidget::TransformWidget(SlicesHandler* hand3D)
 	m_TransformSourceCheckBox->setChecked(TRUE);
 	m_TransformTargetCheckBox->setChecked(TRUE);
 	m_TransformTissuesCheckBox->setChecked(TRUE);
+	m_BilinearCheckBox = new QCheckBox(QString("Bilinear"), m_HBoxSelectData);
+	m_BilinearCheckBox->setToolTip("Interpolate the source and target linearly instead of using the nearest pixel.");
+	m_BilinearCheckBox->setChecked(FALSE);
 
 	// Axis selection radio buttons
 	m_XAxisRadioButton = new QRadioButton(QString("x axis "), m_HBoxAxisSelection);
@@ -149,6 +152,7 @@ TransformWidget::TransformWidget(SlicesHandler* hand3D)
 	QObject_connect(m_TransformSourceCheckBox, SIGNAL(stateChanged(int)), this, SLOT(SelectSourceChanged(int)));
 	QObject_connect(m_TransformTargetCheckBox, SIGNAL(stateChanged(int)), this, SLOT(SelectTargetChanged(int)));
 	QObject_connect(m_TransformTissuesCheckBox, SIGNAL(stateChanged(int)), this, SLOT(SelectTissuesChanged(int)));
+	QObject_connect(m_BilinearCheckBox, SIGNAL(stateChanged(int)), this, SLOT(BilinearChanged(int)));
 
 	QObject_connect(m_Slider1, SIGNAL(valueChanged(int)), this, SLOT(Slider1Changed(int)));
 	QObject_connect(m_Slider2, SIGNAL(valueChanged(int)), this, SLOT(Slider2Changed(int)));
@@ -467,6 +471,21 @@ void TransformWidget::SelectTissuesChanged(int state)
 	emit EndDatachange(this, iseg::NoUndo);
 }
 
+void TransformWidget::BilinearChanged(int state)
+{
+	DataSelection data_selection;
+	data_selection.sliceNr = m_Handler3D->ActiveSlice();
+	data_selection.bmp = m_TransformSourceCheckBox->isChecked();
+	data_selection.work = m_TransformTargetCheckBox->isChecked();
+	emit BeginDatachange(data_selection, this, false);
+
+	// Set interpolation of image data
+	m_SliceTransform->SetBilinear(m_BilinearCheckBox->isChecked());
+
+	// Signal data change
+	emit EndDatachange(this, iseg::NoUndo);
+}
+
 QSize TransformWidget::sizeHint() const { return m_HBoxOverall->sizeHint(); }
 
 void TransformWidget::OnSlicenrChanged()
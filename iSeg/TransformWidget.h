@@ -92,6 +92,7 @@ private:
 	QCheckBox* m_TransformSourceCheckBox;
 	QCheckBox* m_TransformTargetCheckBox;
 	QCheckBox* m_TransformTissuesCheckBox;
+	QCheckBox* m_BilinearCheckBox;
 
 	QCheckBox* m_AllSlicesCheckBox;
 	QPushButton* m_ExecutePushButton;
@@ -141,6 +142,7 @@ private slots:
 	void SelectSourceChanged(int state);
 	void SelectTargetChanged(int state);
 	void SelectTissuesChanged(int state);
+	void BilinearChanged(int state);
 	void FlipPushButtonClicked();
 };
 
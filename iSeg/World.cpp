@@ -20,7 +20,6 @@ namespace iseg {
 World::World()
 {
 	m_IsValid = false;
-	m_Nodes = nullptr;
 }
 World::~World() { Clear(); }
 
@@ -29,11 +28,14 @@ World::~World() { Clear(); }
 //----------------------------------------------------------------------------------
 void World::Clear()
 {
-	if (m_Nodes)
-	{
-		delete[] m_Nodes;
-		m_Nodes = nullptr;
-	}
+	m_Activelist.reset();
+	m_Activelistlowint.reset();
+	std::vector<float>().swap(m_Intens);
+	std::vector<float>().swap(m_Cost);
+	std::vector<float>().swap(m_Fcost);
+	std::vector<unsigned>().swap(m_Prev);
+	std::vector<bool>().swap(m_Computed);
+	std::vector<bool>().swap(m_First);
 	m_IsValid = false;
 }
 //----------------------------------------------------------------------------------
@@ -76,18 +78,19 @@ bool World::Init(Vec3 bbStart, Vec3 bbEnd, SlicesHandler* handler3D)
 
 	unsigned total = m_Width * m_Height * m_Length;
 
-	Node* nodes2 = nullptr;
 	try
 	{
-		nodes2 = new Node[total];
+		m_Intens.resize(total);
+		m_Cost.assign(total, 0.f);
+		m_Fcost.resize(total);
+		m_Prev.assign(total, total);
+		m_Computed.assign(total, false);
+		m_First.assign(total, false);
+		m_Activelist.reset(new IndexPriorityQueue(total, m_Cost.data()));
 	}
-	catch (std::bad_alloc error)
-	{
-		nodes2 = nullptr;
-	}
-
-	if (nodes2 == nullptr)
+	catch (std::bad_alloc&)
 	{
+		Clear();
 		std::cerr << "Memory allocation error!" << std::endl;
 		//		exit(1); // terminate the program
 		return false;
@@ -129,9 +132,7 @@ bool World::Init(Vec3 bbStart, Vec3 bbEnd, SlicesHandler* handler3D)
 		}
 
 		//initialize nodes
-		Node nt(o, intens);
-		//std::cout << "Node size: " << sizeof(Node) << std::endl;
-		nodes2[o] = nt;
+		m_Intens[o] = intens;
 
 		//gradient
 		if (i > 0 && j > 0 && k > 0)
@@ -140,9 +141,9 @@ bool World::Init(Vec3 bbStart, Vec3 bbEnd, SlicesHandler* handler3D)
 			unsigned o3 = i + (j - 1) * m_Width + k * m_Width * m_Height;
 			unsigned o4 = i + j * m_Width + (k - 1) * m_Width * m_Height;
 
-			px = fabs(nodes2[o].m_Intens - nodes2[o2].m_Intens);
-			py = fabs(nodes2[o].m_Intens - nodes2[o3].m_Intens);
-			pz = fabs(nodes2[o].m_Intens - nodes2[o4].m_Intens);
+			px = fabs(m_Intens[o] - m_Intens[o2]);
+			py = fabs(m_Intens[o] - m_Intens[o3]);
+			pz = fabs(m_Intens[o] - m_Intens[o4]);
 			gradient = sqrt(px * px + py * py + pz * pz);
 
 			if (gradient > 170)
@@ -153,10 +154,9 @@ bool World::Init(Vec3 bbStart, Vec3 bbEnd, SlicesHandler* handler3D)
 		}
 		else
 			fgradient = 1;
-		nodes2[o].m_Fcost = (fgradient * 0.8f + fintens * 0.2f);
+		m_Fcost[o] = (fgradient * 0.8f + fintens * 0.2f);
 	}
 
-	this->m_Nodes = nodes2;
 	//	std::cout << "TIME for initialization: " << time2.getRunningTime() << std::endl;
 
 	m_IsValid = true;
@@ -208,42 +208,27 @@ void World::Dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 	bool ends = false;
 	bool firstfound = false;
 	bool morethanoneseed = true;
-	int min;
 	int counter = 0;
 	bool largearea = false;
 	int largeareatimes = 0;
-	using li = std::list<Node*>::iterator;
 	float tmp;
 	bool alreadyinlist, alreadyinlistlowint;
 	int parentintens;
 	int k, j, i;
+	const unsigned total = m_Width * m_Height * m_Length;
 
 	//Initializing first node to expand (first seed)
 
-	m_Nodes[off].m_Cost = 0;
-	m_Activelist.push_back(&m_Nodes[off]);
+	m_Activelist->Clear();
+	m_Activelist->Insert(off, 0.f);
 	std::cout << "Expanding seed " << 1 << std::endl;
 
 	//----------------------------------------------------------------------------------
 	//@ Main loop
 	//----------------------------------------------------------------------------------
 
-	while ((!m_Activelist.empty() || m_Solvingarea == true) && !endt)
+	while ((!m_Activelist->Empty() || m_Solvingarea == true) && !endt)
 	{
-		if (m_Activelist.empty())
-		{
-			std::cout << "Activelist empty!!" << std::endl;
-			off = Solvelargearea2();
-			m_Activelist.push_back(&m_Nodes[off]);
-		}
-
-		//Reducing activelist if it is too large
-		if (m_Activelist.size() > 3000 && largearea == false)
-		{
-			Reduceactivelist();
-			//std::cout << "Reducing activelist" << std::endl;
-		}
-
 		//Skipping seed if it is lasting too much to find the path
 		if (counter > 150000)
 		{
@@ -253,13 +238,12 @@ void World::Dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 			seedsleft = seedsleft - 1;
 			if (seedsleft > 0)
 			{
-				int total = m_Width * m_Height * m_Length;
 				int pos = seeds.size() - seedsleft;
-				for (int o5 = 0; o5 < total; o5++)
+				for (unsigned o5 = 0; o5 < total; o5++)
 				{
-					if (m_Nodes[o5].m_Computed == true)
+					if (m_Computed[o5] == true)
 					{
-						m_Nodes[o5].m_Computed = false;
+						m_Computed[o5] = false;
 					}
 				}
 				//std::cout << "Counter: " << counter << std::endl;
@@ -270,9 +254,8 @@ void World::Dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 				n_z = (unsigned short)(seeds[pos][2] - m_Offz);
 
 				unsigned off5 = n_x + n_y * m_Width + n_z * m_Width * m_Height;
-				std::list<Node*> activelist2;
-				m_Activelist = activelist2;
-				m_Activelist.push_back(&m_Nodes[off5]);
+				m_Activelist->Clear();
+				m_Activelist->Insert(off5);
 
 				redfound = false;
 				counter = 0;
@@ -287,8 +270,8 @@ void World::Dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 				m_Solvingarea = false;
 				m_Firstseedexpanded = false;
 				m_Times = 0;
-				m_Activelist.clear();
-				m_Activelistlowint.clear();
+				m_Activelist->Clear();
+				m_Activelistlowint.reset();
 				if (firstfound == true)
 					Storingtree(children, root_one);
 				m_Paths.clear();
@@ -341,13 +324,12 @@ void World::Dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 
 			//Set all the nodes to computed=false
 
-			int total = m_Width * m_Height * m_Length;
-			for (int o5 = 0; o5 < total; o5++)
+			for (unsigned o5 = 0; o5 < total; o5++)
 			{
-				if (m_Nodes[o5].m_Computed == true)
+				if (m_Computed[o5] == true)
 				{
-					m_Nodes[o5].m_Computed = false;
-					m_Nodes[o5].m_First = true;
+					m_Computed[o5] = false;
+					m_First[o5] = true;
 				}
 			}
 			std::cout << "Counter: " << counter << std::endl;
@@ -358,10 +340,9 @@ void World::Dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 			n_z = (unsigned short)(seeds[pos][2] - m_Offz);
 
 			unsigned off5 = n_x + n_y * m_Width + n_z * m_Width * m_Height;
-			std::list<Node*> activelist2;
-			m_Activelist = activelist2;
-			m_Activelistlowint = activelist2;
-			m_Activelist.push_back(&m_Nodes[off5]);
+			m_Activelist->Clear();
+			m_Activelistlowint.reset();
+			m_Activelist->Insert(off5);
 
 			redfound = false;
 			counter = 0;
@@ -383,14 +364,12 @@ void World::Dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 			root_one->SetEndVox(end);
 
 			//Set all the nodes to computed=false
-			int total = m_Width * m_Height * m_Length;
-
-			for (int o5 = 0; o5 < total; o5++)
+			for (unsigned o5 = 0; o5 < total; o5++)
 			{
-				if (m_Nodes[o5].m_Computed == true)
+				if (m_Computed[o5] == true)
 				{
-					m_Nodes[o5].m_Computed = false;
-					m_Nodes[o5].m_First = true;
+					m_Computed[o5] = false;
+					m_First[o5] = true;
 				}
 			}
 			std::cout << "Counter: " << counter << std::endl;
@@ -403,9 +382,8 @@ void World::Dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 			n_z = (unsigned short)(seeds[pos][2] - m_Offz);
 
 			unsigned off5 = n_x + n_y * m_Width + n_z * m_Width * m_Height;
-			std::list<Node*> activelist2;
-			m_Activelist = activelist2;
-			m_Activelist.push_back(&m_Nodes[off5]);
+			m_Activelist->Clear();
+			m_Activelist->Insert(off5);
 
 			ends = false;
 			firstfound = true;
@@ -437,27 +415,24 @@ void World::Dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 
 		//std::cout << activelist.size() << std::endl;
 
-		min = -1;
-		li todel;
-
-		//Looking for the node with the mininum cost in activelist
+		//Taking the node with the mininum cost from activelist
 
 		if (m_Solvingarea == false)
 		{
-			for (li ii = m_Activelist.begin(); ii != m_Activelist.end(); ++ii)
+			off = m_Activelist->Pop();
+		}
+		else
+		{
+			off = Solvelargearea2();
+			if (off == total)
 			{
-				Node* e = *ii;
-				if (min == -1 || min > e->m_Cost)
-				{
-					min = (int)e->m_Cost;
-					off = e->m_Offset;
-					todel = ii;
-				}
+				std::cout << "Activelistlowint empty" << std::endl;
+				m_Solvingarea = false;
+				continue;
 			}
-			m_Activelist.erase(todel);
 		}
 
-		if (m_Nodes[off].m_Computed == true)
+		if (m_Computed[off] == true)
 			std::cout << "Node to expand already expanded!!" << std::endl;
 
 		//Dealing with large structures
@@ -492,7 +467,7 @@ void World::Dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 
 		//Expanding the chosen node
 
-		m_Nodes[off].m_Computed = true;
+		m_Computed[off] = true;
 
 		n_z = off / (m_Width * m_Height);
 		n_y = (off - (n_z * m_Width * m_Height)) / m_Width;
@@ -520,12 +495,12 @@ void World::Dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 					//std::cout << "Node to expand: " << "x:" << i << " y:" << j << " z:" << k << " o: " << o << " o2: " << o2 << std::endl;
 
 					if (i > -1 && j > -1 && k > -1 && i < m_Width && j < m_Height &&
-							k < m_Length && !m_Nodes[o].m_Computed)
+							k < m_Length && !m_Computed[o])
 					{
-						if (m_Nodes[o].m_Intens > 3900 && !endt && !redfound)
+						if (m_Intens[o] > 3900 && !endt && !redfound)
 						{ //if the node belongs to a previously painted path
 
-							parentintens = (int)m_Nodes[o].m_Intens;
+							parentintens = (int)m_Intens[o];
 							seedsleft = seedsleft - 1;
 
 							if (seedsleft == 0)
@@ -572,7 +547,7 @@ void World::Dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 
 						//Tmp=cost of the neighbor + cost of the path from the seed to the current node
 
-						tmp = m_Nodes[o].m_Fcost + m_Nodes[o2].m_Cost;
+						tmp = m_Fcost[o] + m_Cost[o2];
 
 						//Restarting variables
 
@@ -605,45 +580,27 @@ void World::Dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 
 						//Checking if it is in activelistlowint
 
-						li p = m_Activelistlowint.begin();
-						if (m_Solvingarea == true)
+						if (m_Solvingarea == true && m_Activelistlowint)
 						{
-							while (!alreadyinlistlowint &&
-										 p != m_Activelistlowint.end())
-							{
-								Node* e = *p;
-								if (e->m_Offset == o)
-								{
-									alreadyinlistlowint = true;
-									//activelistlowint.erase(p);
-								}
-								p++;
-							}
+							alreadyinlistlowint = m_Activelistlowint->InQueue(o);
 						}
 
 						//Checking if the neighbour is already in activelist
 
-						li l = m_Activelist.begin();
-						while (!alreadyinlist && l != m_Activelist.end())
-						{
-							Node* e = *l;
-							if (e->m_Offset == o)
-							{
-								alreadyinlist = true;
-							}
-							l++;
-						}
+						alreadyinlist = m_Activelist->InQueue(o);
 
 						//If it was in one of the activelists and the new cost is lower, update it
 
 						if (alreadyinlist || alreadyinlistlowint)
 						{
-							if (m_Nodes[o].m_Cost > tmp + 10)
+							if (m_Cost[o] > tmp + 10)
 							{
-								//activelist.erase(activelist.begin()+todel);
-								//alreadyinlist=false;
-								m_Nodes[o].m_Cost = tmp + 10;
-								m_Nodes[o].m_Prev = &m_Nodes[o2];
+								// both queues are keyed by m_Cost
+								if (alreadyinlist)
+									m_Activelist->MakeSmaller(o, tmp + 10);
+								if (alreadyinlistlowint)
+									m_Activelistlowint->MakeSmaller(o, tmp + 10);
+								m_Prev[o] = o2;
 							}
 						}
 
@@ -651,11 +608,10 @@ void World::Dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 
 						else
 						{
-							if (m_Nodes[o].m_Intens > 1000)
+							if (m_Intens[o] > 1000)
 							{
-								m_Nodes[o].m_Cost = tmp + 10;
-								m_Nodes[o].m_Prev = &m_Nodes[o2];
-								m_Activelist.push_back(&m_Nodes[o]);
+								m_Prev[o] = o2;
+								m_Activelist->Insert(o, tmp + 10);
 							}
 						}
 					}
@@ -709,8 +665,8 @@ void World::Dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 	m_Solvingarea = false;
 	m_Firstseedexpanded = false;
 	m_Times = 0;
-	m_Activelist.clear();
-	m_Activelistlowint.clear();
+	m_Activelist->Clear();
+	m_Activelistlowint.reset();
 	Storingtree(children, root_one);
 	m_Paths.clear();
 	m_Seedsfailed.clear();
@@ -734,7 +690,7 @@ void World::Paint(std::vector<Vec3> seeds, Vec3 cross, unsigned short int seedsl
 
 	std::cout << "Painting path " << pos + 1 << ": x: " << n_x << " y: " << n_y
 						<< " z: " << n_z << std::endl;
-	std::cout << "Activelistsize: " << m_Activelist.size() << std::endl;
+	std::cout << "Activelistsize: " << m_Activelist->Size() << std::endl;
 	std::cout << "Seedsleft: " << seedsleft << std::endl;
 	int counter = 0;
 	std::vector<PathElement> newpath;
@@ -745,7 +701,7 @@ void World::Paint(std::vector<Vec3> seeds, Vec3 cross, unsigned short int seedsl
 				n_z == seeds[pos][2] - m_Offz)
 		{
 			endp2 = true;
-			m_Nodes[o2].m_Intens = (float)(4000 - pos);
+			m_Intens[o2] = (float)(4000 - pos);
 
 			PathElement pathelement(o2);
 			newpath.push_back(pathelement);
@@ -769,10 +725,10 @@ void World::Paint(std::vector<Vec3> seeds, Vec3 cross, unsigned short int seedsl
 			m_Handler3D->SetWorkPt(p, slicenr, 4000);
 
 			//std::cout << "Path node: " << "x:" << n_x << " y:" << n_y << " z:" << n_z << " Offset:" << o3 << " Intens:" << nodes[o3].intens << " Fcost:" << nodes[o3].fcost << " Cost:" << nodes[o3].cost << " First:" << nodes[o3].first << std::endl;
-			m_Nodes[o3].m_Intens = (float)(4000 - pos);
+			m_Intens[o3] = (float)(4000 - pos);
 			if (!m_Firstseedexpanded)
 				m_RootOneintens = 4000 - pos;
-			o2 = m_Nodes[o3].m_Prev->m_Offset;
+			o2 = m_Prev[o3];
 			counter++;
 
 			n_z = o2 / (m_Width * m_Height);
@@ -1224,40 +1180,6 @@ int World::Whoistheparent(std::vector<Vec3> seeds, int parentintens)
 	return (parent);
 }
 //----------------------------------------------------------------------------------
-//! Reduce size of activelist by removing every second node
-//----------------------------------------------------------------------------------
-void World::Reduceactivelist()
-{
-	using li = std::list<Node*>::iterator;
-	std::list<Node*> activelistempty;
-	Node* e;
-	unsigned off;
-
-	int par = 0;
-	for (li ia = m_Activelist.begin(); ia != m_Activelist.end(); ++ia)
-	{
-		e = *ia;
-		off = e->m_Offset;
-		if (!(par % 2))
-		{
-			if (m_Nodes[off].m_Intens < 3900)
-			{
-				m_Nodes[off].m_Computed = true;
-				//int z = off / (width * height);
-				//int y = (off - (z * width * height)) / width;
-				//int x = off - (y * width) - (z * width * height);
-				//vOutVol->setVoxel(ml::Vector(x+offx, y+offy, z+offz, 0, 0, 0), 4000);
-			}
-		}
-		else
-		{
-			activelistempty.push_back(&m_Nodes[off]);
-		}
-		par++;
-	}
-	m_Activelist = activelistempty;
-}
-//----------------------------------------------------------------------------------
 //! Reassigns costs to intensities
 //----------------------------------------------------------------------------------
 void World::Changeintens(unsigned o)
@@ -1265,21 +1187,21 @@ void World::Changeintens(unsigned o)
 	//int z = o / (width * height);
 	//int y = (o - (z * width * height)) / width;
 	//int x = o - (y * width) - (z * width * height);
-	if (m_Nodes[o].m_Intens > 1000 && m_Nodes[o].m_Intens <= 1150)
+	if (m_Intens[o] > 1000 && m_Intens[o] <= 1150)
 	{
-		m_Nodes[o].m_Fcost = 10;
+		m_Fcost[o] = 10;
 		//if(nodes[o].computed==true) std::cout << "Node already computed!!" << std::endl;
 		//std::cout << "NODE: " << "x:" << x << " y:" << y << " z:" << z << " Computed: " << nodes[off].computed << std::endl;
 	}
-	else if (m_Nodes[o].m_Intens > 1150 && m_Nodes[o].m_Intens <= 1230)
+	else if (m_Intens[o] > 1150 && m_Intens[o] <= 1230)
 	{
-		if (m_Nodes[o].m_Cost == 0 && m_Nodes[o].m_First == false)
-			m_Nodes[o].m_Fcost = m_Nodes[o].m_Fcost + m_Nodes[o].m_Fcost * 10;
+		if (m_Cost[o] == 0 && m_First[o] == false)
+			m_Fcost[o] = m_Fcost[o] + m_Fcost[o] * 10;
 	}
 	else
 	{
-		if (m_Nodes[o].m_Cost == 0 && m_Nodes[o].m_First == false)
-			m_Nodes[o].m_Fcost = 100000;
+		if (m_Cost[o] == 0 && m_First[o] == false)
+			m_Fcost[o] = 100000;
 		//nodes[o].cost=nodes[o].cost+nodes[o].fcost;
 	}
 }
@@ -1383,7 +1305,7 @@ bool World::Checkdiameter(unsigned coff, unsigned poff)
 				nz < m_Length)
 		{
 			//std::cout << "Diameter node: " << "x:" << nx << " y:" << ny << " z:" << nz << " o: " << o << std::endl;
-			if (m_Nodes[o].m_Intens > 1150)
+			if (m_Intens[o] > 1150)
 			{
 				diameter1++;
 				comput = true;
@@ -1411,7 +1333,7 @@ bool World::Checkdiameter(unsigned coff, unsigned poff)
 				nz < m_Length)
 		{
 			//std::cout << "Diameter node: " << "x:" << nx << " y:" << ny << " z:" << nz << " o: " << o << std::endl;
-			if (m_Nodes[o].m_Intens > 1150)
+			if (m_Intens[o] > 1150)
 			{
 				diameter2++;
 				comput = true;
@@ -1455,7 +1377,7 @@ bool World::Checkdiameter(unsigned coff, unsigned poff)
 					nz < m_Length)
 			{
 				//std::cout << "Diameter node: " << "x:" << nx << " y:" << ny << " z:" << nz << " o: " << o << std::endl;
-				if (m_Nodes[o2].m_Intens > 1150)
+				if (m_Intens[o2] > 1150)
 				{
 					diameter3++;
 					comput = true;
@@ -1483,7 +1405,7 @@ bool World::Checkdiameter(unsigned coff, unsigned poff)
 					nz < m_Length)
 			{
 				//std::cout << "Diameter node: " << "x:" << nx << " y:" << ny << " z:" << nz << " o: " << o << std::endl;
-				if (m_Nodes[o2].m_Intens > 1150)
+				if (m_Intens[o2] > 1150)
 				{
 					diameter4++;
 					comput = true;
@@ -1545,142 +1467,52 @@ bool World::Checkdiameter(unsigned coff, unsigned poff)
 //----------------------------------------------------------------------------------
 unsigned World::Solvelargearea2()
 {
-	using li = std::list<Node*>::iterator;
-	unsigned newoff;
-	unsigned off;
-	Node* e;
-	li ie, todel;
-	int min = -1;
-
 	if (m_Solvingarea == false)
 	{
-		m_Activelistlowint.clear();
-		for (ie = m_Activelist.begin(); ie != m_Activelist.end(); ++ie)
+		const unsigned total = m_Width * m_Height * m_Length;
+		m_Activelistlowint.reset(new IndexPriorityQueue(total, m_Cost.data()));
+
+		std::vector<unsigned> lowint;
+		while (!m_Activelist->Empty())
 		{
-			e = *ie;
-			off = e->m_Offset;
-			if (e->m_Intens > 1000 && e->m_Intens <= 1150)
+			unsigned off = m_Activelist->Pop();
+			if (m_Intens[off] > 1000 && m_Intens[off] <= 1150)
 			{
-				m_Nodes[off].m_Cost = m_Nodes[off].m_Cost - m_Nodes[off].m_Fcost + 10;
-				m_Nodes[off].m_Fcost = 10;
-				if (m_Nodes[off].m_Computed == true)
+				m_Cost[off] = m_Cost[off] - m_Fcost[off] + 10;
+				m_Fcost[off] = 10;
+				if (m_Computed[off] == true)
 					std::cout << "Node already computed!!" << std::endl;
-				m_Activelistlowint.push_back(&m_Nodes[off]);
+				lowint.push_back(off);
 			}
 			else
 			{
-				//todel=iu;
-				//nodes[off].cost=nodes[off].cost+10000000;
-				if (m_Nodes[off].m_First == false)
+				if (m_First[off] == false)
 				{
-					m_Nodes[off].m_Computed = true;
-					//vOutVol->setVoxel(ml::Vector(x+offx, y+offy, z+offz, 0, 0, 0), 4000);
+					m_Computed[off] = true;
 				}
 			}
 		}
 		m_Solvingarea = true;
-		m_Activelist.clear();
-
-		//std::cout << "Activelistsizelowint: " << activelistlowint.size() << std::endl;
-
-		/*for(li ia=activelistlowint.begin();ia!=activelistlowint.end();++ia){
-			e=*ia;
-			unsigned o8=e->offset;
-			int z8 = o8 / (width * height);
-			int y8 = (o8 - (z8 * width * height)) / width;
-			int x8 = o8 - (y8 * width) - (z8 * width * height);
-			//std::cout << "NODE: " << "nx:" << x8 << " ny:" << y8 << " nz:" << z8 << " Computed: " << nodes[o8].computed << std::endl;
-			vOutVol->setVoxel(ml::Vector(x8+offx, y8+offy, z8+offz, 0, 0, 0), 4000);
-		}*/
 
-		/*if(activelistlowint.size()>1500){
-			activelist.clear();
-			activelist=activelistlowint;
-			activelistlowint.clear();
-			//std::cout << "Reducing activelistlowint" << std::endl;
-			int par=0;
-			for(li ia=activelist.begin();ia!=activelist.end();++ia){
-				e=*ia;
-				off=e->offset;
-				if(!(par%2)){
-					if(nodes[off].first==false){
-						nodes[off].computed=true;
-						//vOutVol->setVoxel(ml::Vector(x+offx, y+offy, z+offz, 0, 0, 0), 4000);
-					}
-				}else{
-					activelistlowint.push_back(&nodes[off]);
-				}
-				par++;
-			}
-		}*/
-		//std::cout << "Activelistsizelowint: " << activelistlowint.size() << std::endl;
-		m_Activelist.clear();
-		m_Activelistlowintsize = m_Activelistlowint.size();
-
-		for (li ii = m_Activelistlowint.begin(); ii != m_Activelistlowint.end();
-				 ++ii)
+		// activelist and activelistlowint start with the same nodes
+		for (auto off : lowint)
 		{
-			Node* e = *ii;
-			if (min == -1 || min > e->m_Cost)
-			{
-				min = (int)e->m_Cost;
-				newoff = e->m_Offset;
-				todel = ii;
-			}
+			m_Activelistlowint->Insert(off);
+			m_Activelist->Insert(off);
 		}
-
-		m_Activelistlowint.erase(todel);
-		m_Activelist = m_Activelistlowint;
-		return (newoff);
+		m_Activelistlowintsize = m_Activelistlowint->Size();
 	}
-	else
+	else if (m_Activelistlowint == nullptr || m_Activelistlowint->Empty())
 	{
-		//std::cout << "Activelistlowint size: " << activelistlowint.size() << std::endl;
-		if (m_Activelistlowint.empty())
-		{
-			std::cout << "Activelistlowint empty" << std::endl;
-		}
-
-		for (li ii = m_Activelistlowint.begin(); ii != m_Activelistlowint.end();
-				 ++ii)
-		{
-			e = *ii;
-			//unsigned o8=e->offset;
-			//int z8 = o8 / (width * height);
-			//int y8 = (o8 - (z8 * width * height)) / width;
-			//int x8 = o8 - (y8 * width) - (z8 * width * height);
-			//std::cout << "NODE: " << "nx:" << x8 << " ny:" << y8 << " nz:" << z8 << " Computed: " << nodes[o8].computed << std::endl;
-			//vOutVol->setVoxel(ml::Vector(x8+offx, y8+offy, z8+offz, 0, 0, 0), 4000);
-
-			if (min == -1 || min > e->m_Cost)
-			{
-				min = (int)e->m_Cost;
-				newoff = e->m_Offset;
-				todel = ii;
-			}
-		}
-
-		m_Activelistlowint.erase(todel);
-		//std::cout << "Activelistsizelowint: " << activelistlowint.size() << std::endl;
+		std::cout << "Activelistlowint empty" << std::endl;
+		return m_Width * m_Height * m_Length;
+	}
 
-		bool found = false;
-		li p = m_Activelist.begin();
-		while (!found && p != m_Activelist.end())
-		{
-			Node* e = *p;
-			if (e->m_Offset == newoff)
-			{
-				found = true;
-				todel = p;
-			}
-			p++;
-		}
-		m_Activelist.erase(todel);
+	unsigned newoff = m_Activelistlowint->Pop();
+	m_Activelist->Remove(newoff);
 
-		//std::cout << "Newoff: " << newoff << std::endl;
-		//std::cout << "Largeareatimes: " << largeareatimes << std::endl;
-		return (newoff);
-	}
+	//std::cout << "Newoff: " << newoff << std::endl;
+	return (newoff);
 }
 //----------------------------------------------------------------------------------
 //! Diminish cost of dark nodes previously found when a large structure is found
@@ -1692,12 +1524,12 @@ void World::Solvelargearea()
 
 	for (int o = 0; o < total; o++)
 	{
-		if (m_Nodes[o].m_Computed == true)
+		if (m_Computed[o] == true)
 		{
-			if (m_Nodes[o].m_Intens > 1000 && m_Nodes[o].m_Intens < 1150)
+			if (m_Intens[o] > 1000 && m_Intens[o] < 1150)
 			{
-				m_Nodes[o].m_Cost = m_Nodes[o].m_Cost - m_Nodes[o].m_Fcost;
-				m_Nodes[o].m_Fcost = 20;
+				m_Cost[o] = m_Cost[o] - m_Fcost[o];
+				m_Fcost[o] = 20;
 			}
 		}
 	}
@@ -1750,16 +1582,6 @@ void World::Set3dslicehandler(SlicesHandler* handler3D)
 	m_Handler3D = handler3D;
 }
 
-Node::Node(unsigned offset, float intens)
-{
-	this->m_Offset = offset;
-	this->m_Intens = intens;
-
-	m_Computed = false;
-	m_First = false;
-}
-
-
 PathElement::PathElement(unsigned offset)
 {
 	this->m_Offset = offset;
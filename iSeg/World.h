@@ -17,35 +17,20 @@
 #include "Data/Vec3.h"
 
 #include "Core/BranchTree.h"
+#include "Core/IndexPriorityQueue.h"
 
 #include <iostream>
-#include <list>
+#include <memory>
 #include <vector>
 
 namespace iseg {
 
-class Node
-{
-public:
-	unsigned m_Offset;
-	float m_Intens;
-	float m_Cost;
-	float m_Fcost;
-	bool m_Computed;
-	bool m_First;
-	Node* m_Prev;
-	Node(unsigned offset, float intens);
-	Node() = default;
-	~Node() = default;
-};
-
 class PathElement
 {
 public:
 	unsigned m_Offset;
 	bool m_Cross;
 	bool m_Seed;
-	Node* m_Prev;
 	PathElement(unsigned offset);
 	PathElement() = default;
 	~PathElement() = default;
@@ -53,10 +38,16 @@ public:
 
 class World
 {
-	Node* m_Nodes;
-	std::list<Node*>
-			m_Activelist; //list with the active nodes (the ones that have been "touched" but not expanded yet)
-	std::list<Node*> m_Activelistlowint;
+	// node data, one entry per voxel of the bounding box
+	std::vector<float> m_Intens;
+	std::vector<float> m_Cost;	// cost of the path from the seed
+	std::vector<float> m_Fcost; // cost of stepping onto the node
+	std::vector<unsigned> m_Prev;
+	std::vector<bool> m_Computed;
+	std::vector<bool> m_First;
+	std::unique_ptr<IndexPriorityQueue>
+			m_Activelist; //queue with the active nodes (the ones that have been "touched" but not expanded yet), keyed by m_Cost
+	std::unique_ptr<IndexPriorityQueue> m_Activelistlowint;
 	std::vector<std::vector<PathElement>> m_Paths;
 	int m_Width;
 	int m_Height;
@@ -92,7 +83,6 @@ public:
 	void Solvelargearea();
 	unsigned Solvelargearea2();
 	void Changeintens(unsigned o);
-	void Reduceactivelist();
 	int Whoistheparent(std::vector<Vec3> seeds, int parentintens);
 	void OutputBranchTree(BranchItem* branchItem, std::string prefix, FILE*& fp);
 	void Storingtree(std::vector<BranchItem*> children, BranchItem* rootOne);
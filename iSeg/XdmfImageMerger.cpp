@@ -11,7 +11,7 @@
 
 #include "XdmfImageMerger.h"
 
-#include "Core/HDF5Reader.h"
+#include "Core/HDF5IO.h"
 #include "Core/HDF5Writer.h"
 
 #include <QDir>
@@ -25,6 +25,7 @@
 
 #include <vtkSmartPointer.h>
 
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
@@ -53,11 +54,11 @@ int XdmfImageMerger::Write()
 int XdmfImageMerger::InternalWrite(const char* filename, std::vector<QString>& mergefilenames, float** slicesbmp, float** sliceswork, tissues_size_t** slicestissue, unsigned nrslices, unsigned nrslicesTotal, unsigned width, unsigned height, float* pixelsize, const Transform& transform, int compression)
 {
 	// Parse xml files of merged projects
-	std::vector<XdmfImageReader*> image_readers;
+	std::vector<std::unique_ptr<XdmfImageReader>> image_readers;
 	std::vector<QString>::iterator iter_filename;
 	for (iter_filename = mergefilenames.begin(); iter_filename != mergefilenames.end(); ++iter_filename)
 	{
-		XdmfImageReader* reader = new XdmfImageReader();
+		std::unique_ptr<XdmfImageReader> reader(new XdmfImageReader);
 		QString image_filename = QFileInfo(*iter_filename).completeBaseName() + ".xmf";
 		reader->SetFileName(QFileInfo(*iter_filename).dir().absoluteFilePath(image_filename).toAscii().data());
 		if (reader->ParseXML() == 0)
@@ -65,7 +66,7 @@ int XdmfImageMerger::InternalWrite(const char* filename, std::vector<QString>& m
 			ISEG_ERROR_MSG("XdmfImageMerger::InternalWrite while parsing xmls");
 			return 0;
 		}
-		image_readers.push_back(reader);
+		image_readers.push_back(std::move(reader));
 	}
 
 	QString q_file_name(filename);
@@ -141,119 +142,86 @@ int XdmfImageMerger::InternalWrite(const char* filename, std::vector<QString>& m
 	}
 
 	// The slices are not contiguous in memory so we need to copy.
+	// Current project
+	float** const null_float = nullptr;
+	tissues_size_t** const null_tissue = nullptr;
+	ISEG_INFO_MSG("writing Source");
+	if (!writer.Write(null_float, nrslicesTotal, slice_size, "Source") ||
+			!writer.Write(slicesbmp, nrslices, slice_size, "Source", 0))
+	{
+		ISEG_ERROR_MSG("writing Source");
+	}
+	ISEG_INFO_MSG("writing Target");
+	if (!writer.Write(null_float, nrslicesTotal, slice_size, "Target") ||
+			!writer.Write(sliceswork, nrslices, slice_size, "Target", 0))
+	{
+		ISEG_ERROR_MSG("writing Target");
+	}
+	ISEG_INFO_MSG("writing Tissue");
+	if (!writer.Write(null_tissue, nrslicesTotal, slice_size, "Tissue") ||
+			!writer.Write(slicestissue, nrslices, slice_size, "Tissue", 0))
+	{
+		ISEG_ERROR_MSG("writing Tissue");
+	}
+
+	writer.Close();
 
-	// Source
+	// Merged projects are streamed slab by slab from their h5 files. If the compression
+	// settings match, the compressed chunks are copied without decompressing them.
 	{
-		ISEG_INFO_MSG("writing Source");
-		// allocate in file
-		float** const null = nullptr;
-		if (writer.Write(null, nrslicesTotal, slice_size, "Source"))
+		HDF5IO io(compression);
+		auto file = io.Create(fname.toStdString(), true);
+		if (file < 0)
 		{
-			size_t offset = 0;
-
-			// Current project
-			writer.Write(slicesbmp, nrslices, slice_size, "Source", offset);
-			offset += nrslices * slice_size;
-
-			// Merged projects
-			std::vector<float> project_buffer;
-			std::vector<XdmfImageReader*>::iterator iter_reader;
-			for (iter_filename = mergefilenames.begin(), iter_reader = image_readers.begin();
-					 iter_filename != mergefilenames.end();
-					 ++iter_filename, ++iter_reader)
-			{
-				size_t junk = 0;
-				size_t const project_slices =
-						(*iter_reader)->GetNumberOfSlices();
-				project_buffer.resize(slice_size * project_slices);
-				ReadSource(*iter_reader, (*iter_filename).toAscii().data(), project_buffer, junk);
-
-				std::vector<float*> slices(project_slices, nullptr);
-				for (size_t i = 0; i < project_slices; ++i)
-				{
-					slices[i] = &project_buffer[i * slice_size];
-				}
-				writer.Write(slices.data(), project_slices, slice_size, "Source", offset);
-				offset += project_slices * slice_size;
-			}
+			ISEG_ERROR("opening " << fname.toStdString());
+			QDir::setCurrent(oldcwd.absolutePath());
+			return 0;
 		}
-	}
 
-	// Target
-	{
-		ISEG_INFO_MSG("writing Target");
-		// allocate in file
-		float** const null = nullptr;
-		if (writer.Write(null, nrslicesTotal, slice_size, "Target"))
+		size_t offset = static_cast<size_t>(nrslices) * slice_size;
+		for (size_t i = 0; i < mergefilenames.size(); ++i)
 		{
-			size_t offset = 0;
-
-			// Current project
-			writer.Write(sliceswork, nrslices, slice_size, "Target", offset);
-			offset += nrslices * slice_size;
-
-			// Merged projects
-			std::vector<float> project_buffer;
-			std::vector<XdmfImageReader*>::iterator iter_reader;
-			for (iter_filename = mergefilenames.begin(), iter_reader = image_readers.begin();
-					 iter_filename != mergefilenames.end();
-					 ++iter_filename, ++iter_reader)
+			QFileInfo merge_info(mergefilenames[i]);
+			const std::string merge_fname = merge_info.dir().absoluteFilePath(merge_info.completeBaseName() + ".h5").toStdString();
+			size_t const length = static_cast<size_t>(image_readers[i]->GetNumberOfSlices()) * slice_size;
+
+			auto merge_file = io.Open(merge_fname);
+			if (merge_file < 0)
 			{
-				size_t junk = 0;
-				size_t const project_slices =
-						(*iter_reader)->GetNumberOfSlices();
-				project_buffer.resize(slice_size * project_slices);
-				ReadTarget(*iter_reader, (*iter_filename).toAscii().data(), project_buffer, junk);
-
-				std::vector<float*> slices(project_slices, nullptr);
-				for (size_t i = 0; i < project_slices; ++i)
-				{
-					slices[i] = &project_buffer[i * slice_size];
-				}
-				writer.Write(slices.data(), project_slices, slice_size, "Target", offset);
-				offset += project_slices * slice_size;
+				ISEG_ERROR("opening " << merge_fname);
+				io.Close(file);
+				QDir::setCurrent(oldcwd.absolutePath());
+				return 0;
 			}
-		}
-	}
 
-	// Tissue
-	{
-		ISEG_INFO_MSG("writing Tissue");
-		// allocate in file
-		tissues_size_t** const null = nullptr;
-		if (writer.Write(null, nrslicesTotal, slice_size, "Tissue"))
-		{
-			size_t offset = 0;
-
-			// Current project
-			writer.Write(slicestissue, nrslices, slice_size, "Tissue", offset);
-			offset += nrslices * slice_size;
-
-			// Merged projects
-			std::vector<tissues_size_t> project_buffer;
-			std::vector<XdmfImageReader*>::iterator iter_reader;
-			for (iter_filename = mergefilenames.begin(), iter_reader = image_readers.begin();
-					 iter_filename != mergefilenames.end();
-					 ++iter_filename, ++iter_reader)
+			auto array_names = image_readers[i]->GetMapArrayNames();
+			bool ok = !array_names["Source"].isEmpty() && !array_names["Tissue"].isEmpty();
+			ok = ok && io.CopyData<float>(merge_file, array_names["Source"].toStdString(), 0, length, file, "Source", offset);
+			if (array_names["Target"].isEmpty())
+			{
+				ISEG_WARNING_MSG("no Target array, will initialize to 0...");
+				ok = ok && io.FillData<float>(file, "Target", offset, length, 0.f);
+			}
+			else
 			{
-				size_t junk = 0;
-				size_t const project_slices =
-						(*iter_reader)->GetNumberOfSlices();
-				project_buffer.resize(slice_size * project_slices);
-				ReadTissues(*iter_reader, (*iter_filename).toAscii().data(), project_buffer, junk);
-
-				std::vector<tissues_size_t*> slices(project_slices, nullptr);
-				for (size_t i = 0; i < project_slices; ++i)
-				{
-					slices[i] = &project_buffer[i * slice_size];
-				}
-				writer.Write(slices.data(), project_slices, slice_size, "Tissue", offset);
-				offset += project_slices * slice_size;
+				ok = ok && io.CopyData<float>(merge_file, array_names["Target"].toStdString(), 0, length, file, "Target", offset);
 			}
+			ok = ok && io.CopyData<tissues_size_t>(merge_file, array_names["Tissue"].toStdString(), 0, length, file, "Tissue", offset);
+			io.Close(merge_file);
+
+			if (!ok)
+			{
+				ISEG_ERROR("merging " << merge_fname);
+				io.Close(file);
+				QDir::setCurrent(oldcwd.absolutePath());
+				return 0;
+			}
+			offset += length;
 		}
+
+		io.Close(file);
 	}
 
-	writer.Close();
 
 	// Write XML file
 	QDomElement dataitem, attribute;
@@ -382,229 +350,6 @@ int XdmfImageMerger::InternalWrite(const char* filename, std::vector<QString>& m
 	// restore working directory
 	QDir::setCurrent(oldcwd.absolutePath());
 
-	for (XdmfImageReader* r : image_readers)
-	{
-		delete r;
-	}
-
-	return 1;
-}
-
-int XdmfImageMerger::ReadSource(XdmfImageReader* imageReader, const char* filename, std::vector<float>& bufferFloat, size_t& sliceoffset) const
-{
-	QFileInfo file_info(filename);
-	QString basename = file_info.completeBaseName();
-
-	// save working directory
-	QDir oldcwd = QDir::current();
-
-	// enter the xmf file folder so relative names for hdf5 files work
-	QDir::setCurrent(file_info.absolutePath());
-
-	HDF5Reader reader;
-	reader.m_Loud = true;
-	const QString fname = basename + ".h5";
-	if (!reader.Open(fname.toStdString()))
-	{
-		ISEG_ERROR("opening " << fname.toStdString());
-		return 0;
-	}
-
-	// Source
-	QString map_source_name = imageReader->GetMapArrayNames()["Source"];
-	if (map_source_name.isEmpty())
-	{
-		ISEG_ERROR_MSG("no Source array...");
-		return 0;
-	}
-	if (!reader.Read(&bufferFloat[sliceoffset * this->m_Width * this->m_Height], map_source_name.toStdString()))
-	{
-		ISEG_ERROR_MSG("reading Source dataset...");
-		return 0;
-	}
-	sliceoffset += imageReader->GetNumberOfSlices();
-
-	// restore working directory
-	QDir::setCurrent(oldcwd.absolutePath());
-
-	return 1;
-}
-
-int XdmfImageMerger::ReadTarget(XdmfImageReader* imageReader, const char* filename, std::vector<float>& bufferFloat, size_t& sliceoffset) const
-{
-	QFileInfo file_info(filename);
-	QString basename = file_info.completeBaseName();
-
-	// save working directory
-	QDir oldcwd = QDir::current();
-
-	// enter the xmf file folder so relative names for hdf5 files work
-	QDir::setCurrent(file_info.absolutePath());
-
-	HDF5Reader reader;
-	reader.m_Loud = true;
-	const QString fname = basename + ".h5";
-	if (!reader.Open(fname.toStdString()))
-	{
-		ISEG_ERROR("opening " << fname.toStdString());
-		return 0;
-	}
-
-	// Target
-	QString map_target_name = imageReader->GetMapArrayNames()["Target"];
-	if (map_target_name.isEmpty())
-	{
-		ISEG_WARNING_MSG("no Target array, will initialize to 0...");
-		bufferFloat.assign(bufferFloat.size(), 0.0f);
-	}
-	else
-	{
-		if (!reader.Read(&bufferFloat[sliceoffset * this->m_Width * this->m_Height], map_target_name.toAscii().data()))
-		{
-			ISEG_ERROR_MSG("reading Target dataset...");
-			return 0;
-		}
-	}
-	sliceoffset += imageReader->GetNumberOfSlices();
-
-	// restore working directory
-	QDir::setCurrent(oldcwd.absolutePath());
-
-	return 1;
-}
-
-int XdmfImageMerger::ReadTissues(XdmfImageReader* imageReader, const char* filename, std::vector<tissues_size_t>& bufferTissuesSizeT, size_t& sliceoffset) const
-{
-	QFileInfo file_info(filename);
-	QString basename = file_info.completeBaseName();
-
-	// save working directory
-	QDir oldcwd = QDir::current();
-
-	// enter the xmf file folder so relative names for hdf5 files work
-	QDir::setCurrent(file_info.absolutePath());
-
-	HDF5Reader reader;
-	const QString fname = basename + ".h5";
-	if (!reader.Open(fname.toStdString()))
-	{
-		ISEG_ERROR("opening " << fname.toStdString());
-		return 0;
-	}
-
-	// Tissue
-	QString map_tissue_name = imageReader->GetMapArrayNames()["Tissue"];
-	std::string type;
-	std::vector<HDF5Reader::size_type> dims;
-	if (!reader.GetDatasetInfo(type, dims, map_tissue_name.toAscii().data()))
-	{
-		ISEG_ERROR_MSG("reading Tissue data type...");
-		return 0;
-	}
-
-	size_t const curr_nrslices = imageReader->GetNumberOfSlices();
-	size_t const n = (curr_nrslices * this->m_Width) * this->m_Height;
-
-	if (type == "unsigned char")
-	{
-		std::vector<unsigned char> buffer_u_char;
-		try
-		{
-			buffer_u_char.resize(n);
-		}
-		catch (std::length_error& le)
-		{
-			std::cerr << "bufferUChar length error: " << le.what();
-			return 0;
-		}
-		if (map_tissue_name.isEmpty())
-		{
-			ISEG_ERROR_MSG("no Tissue array...");
-			return 0;
-		}
-		if (!reader.Read(&buffer_u_char[0], map_tissue_name.toAscii().data()))
-		{
-			ISEG_ERROR_MSG("reading Tissue dataset...");
-			return 0;
-		}
-		std::vector<unsigned char>::iterator iter_from = buffer_u_char.begin();
-		std::vector<tissues_size_t>::iterator iter_to =
-				bufferTissuesSizeT.begin() +
-				(sliceoffset * this->m_Width) * this->m_Height;
-		for (unsigned int k = 0; k < curr_nrslices; k++)
-		{
-			for (unsigned int j = 0; j < this->m_Height; j++)
-			{
-				for (unsigned int i = 0; i < this->m_Width; i++)
-				{
-					(*iter_to++) = (tissues_size_t)(*iter_from++);
-				}
-			}
-		}
-		buffer_u_char.clear();
-	}
-	else if (type == "unsigned short")
-	{
-		static_assert(std::is_same<unsigned short, tissues_size_t>::value, "Special case we read directly into the buffer.");
-		if (map_tissue_name.isEmpty())
-		{
-			ISEG_ERROR_MSG("no Tissue array...");
-			return 0;
-		}
-		if (!reader.Read(&bufferTissuesSizeT[(sliceoffset * this->m_Width) * this->m_Height], map_tissue_name.toAscii().data()))
-		{
-			ISEG_ERROR_MSG("reading Tissue dataset...");
-			return 0;
-		}
-	}
-	else if (type == "unsigned int")
-	{
-		std::vector<unsigned int> buffer_u_int;
-		try
-		{
-			buffer_u_int.resize(n);
-		}
-		catch (std::length_error& le)
-		{
-			ISEG_ERROR("bufferUInt length error: " << le.what());
-			return 0;
-		}
-		if (map_tissue_name.isEmpty())
-		{
-			ISEG_ERROR_MSG("no Tissue array...");
-			return 0;
-		}
-		if (!reader.Read(&buffer_u_int[0], map_tissue_name.toAscii().data()))
-		{
-			ISEG_ERROR_MSG("reading Tissue dataset...");
-			return 0;
-		}
-		std::vector<unsigned int>::iterator iter_from = buffer_u_int.begin();
-		std::vector<tissues_size_t>::iterator iter_to =
-				bufferTissuesSizeT.begin() +
-				sliceoffset * this->m_Width * this->m_Height;
-		for (unsigned int k = 0; k < curr_nrslices; k++)
-		{
-			for (unsigned int j = 0; j < this->m_Height; j++)
-			{
-				for (unsigned int i = 0; i < this->m_Width; i++)
-				{
-					(*iter_to++) = (tissues_size_t)(*iter_from++);
-				}
-			}
-		}
-		buffer_u_int.clear();
-	}
-	else
-	{
-		ISEG_ERROR_MSG("Tissue data type not supported...");
-		return 0;
-	}
-	sliceoffset += imageReader->GetNumberOfSlices();
-
-	// restore working directory
-	QDir::setCurrent(oldcwd.absolutePath());
-
 	return 1;
 }
 
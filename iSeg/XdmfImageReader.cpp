@@ -9,6 +9,7 @@
  */
 #include "Precompiled.h"
 
+#include "LazySliceLoader.h"
 #include "XdmfImageReader.h"
 
 #include "Data/ScopedTimer.h"
@@ -503,6 +504,27 @@ int XdmfImageReader::Read()
 	return r;
 }
 
+std::unique_ptr<LazySliceLoader> XdmfImageReader::ReadLazy(unsigned first_slice)
+{
+	ISEG_INFO("Opening " << this->m_FileName << ": " << m_Width << " x " << m_Height << " x " << m_NumberOfSlices);
+
+	QFileInfo file_info(this->m_FileName);
+	const std::string fname = file_info.dir().absoluteFilePath(file_info.completeBaseName() + ".h5").toStdString();
+
+	std::vector<float*> image_slices(m_ImageSlices, m_ImageSlices + m_NumberOfSlices);
+	std::vector<float*> work_slices(m_WorkSlices, m_WorkSlices + m_NumberOfSlices);
+	std::vector<tissues_size_t*> tissue_slices(m_TissueSlices, m_TissueSlices + m_NumberOfSlices);
+
+	std::unique_ptr<LazySliceLoader> loader(new LazySliceLoader(fname, this->m_MapArrayNames["Source"].toStdString(), this->m_MapArrayNames["Target"].toStdString(), this->m_MapArrayNames["Tissue"].toStdString(), image_slices, work_slices, tissue_slices, static_cast<size_t>(m_Width) * m_Height));
+	loader->Start(first_slice);
+	loader->Request(first_slice);
+	if (loader->Finished() && !loader->WaitForAll())
+	{
+		return nullptr;
+	}
+	return loader;
+}
+
 std::shared_ptr<ColorLookupTable> XdmfImageReader::ReadColorLookup() const
 {
 	std::string fname(this->m_FileName);
@@ -23,6 +23,7 @@
 namespace iseg {
 
 class ColorLookupTable;
+class LazySliceLoader;
 
 class XdmfImageReader
 {
@@ -51,6 +52,8 @@ public:
 
 	int ParseXML();
 	int Read();
+	/// Read 'first_slice' and return a loader which reads the other slices on demand
+	std::unique_ptr<LazySliceLoader> ReadLazy(unsigned first_slice);
 
 	std::shared_ptr<ColorLookupTable> ReadColorLookup() const;
 
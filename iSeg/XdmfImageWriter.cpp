@@ -46,6 +46,7 @@ XdmfImageWriter::XdmfImageWriter()
 	this->m_TissueSlices = nullptr;
 	this->m_FileName = nullptr;
 	this->m_CopyToContiguousMemory = false;
+	this->m_Incremental = false;
 }
 
 XdmfImageWriter::XdmfImageWriter(const char* filepath) : XdmfImageWriter()
@@ -94,6 +95,10 @@ bool XdmfImageWriter::WriteColorLookup(const ColorLookupTable* lut, bool naked)
 	writer.m_Compression = m_Compression;
 
 	// create top level group
+	if (m_Incremental)
+	{
+		writer.Remove("/Lut");
+	}
 	writer.CreateGroup("/Lut");
 
 	// write size and version
@@ -161,14 +166,23 @@ int XdmfImageWriter::InternalWrite(const char* filename, float** slicesbmp, floa
 		fname = basename + "." + suffix;
 	else
 		fname = basename + ".h5";
-	if (!writer.Open(fname.toAscii().data()))
+	if (!writer.Open(fname.toAscii().data(), m_Incremental ? "append" : "overwrite"))
 	{
 		ISEG_ERROR("opening " << fname.toStdString());
 	}
 	writer.m_Compression = compression;
 
+	if (m_Incremental)
+	{
+		// the meta data is rewritten below
+		for (auto name : {"dimensions", "offset", "pixelsize", "dc", "rotation"})
+		{
+			writer.Remove(name);
+		}
+	}
+
 	// The slices are not contiguous in memory so we need to copy.
-	if (this->m_CopyToContiguousMemory)
+	if (this->m_CopyToContiguousMemory && !m_Incremental)
 	{
 		// Source
 		std::vector<float> buffer_float;
@@ -266,7 +280,7 @@ int XdmfImageWriter::InternalWrite(const char* filename, float** slicesbmp, floa
 			ISEG_ERROR_MSG("writing Source");
 		}
 		timer.NewScope("Write Target");
-		if (!writer.Write(sliceswork, nrslices, dims[0] * dims[1], "Target"))
+		if ((sliceswork || !m_Incremental) && !writer.Write(sliceswork, nrslices, dims[0] * dims[1], "Target"))
 		{
 			ISEG_ERROR_MSG("writing Target");
 		}
@@ -47,6 +47,9 @@ public:
 	GetMacro(TissueSlices, tissues_size_t**);
 	SetMacro(CopyToContiguousMemory, bool);
 	GetMacro(CopyToContiguousMemory, bool);
+	/// Update an existing file in place, slices which are nullptr are not written
+	SetMacro(Incremental, bool);
+	GetMacro(Incremental, bool);
 	bool Write(bool naked = false);
 
 	bool WriteColorLookup(const ColorLookupTable* lut, bool naked = false);
@@ -63,6 +66,7 @@ protected:
 	float** m_WorkSlices;
 	tissues_size_t** m_TissueSlices;
 	bool m_CopyToContiguousMemory;
+	bool m_Incremental;
 
 private:
 	int InternalWrite(const char* filename, float** slicesbmp, float** sliceswork, tissues_size_t** slicestissue, unsigned nrslices, unsigned width, unsigned height, float* pixelsize, Transform& transform, int compression, bool naked);
@@ -14,11 +14,15 @@
 
 #include "Data/addLine.h"
 
+#include "Core/ConnectedComponents.h"
+#include "Core/DistanceTransform.h"
 #include "Core/ExpectationMaximization.h"
 #include "Core/ImageForestingTransform.h"
 #include "Core/ImageReader.h"
 #include "Core/KMeans.h"
 #include "Core/MultidimensionalGamma.h"
+#include "Core/ProjectSlices.h"
+#include "Core/RankFilter.h"
 #include "Core/SliceProvider.h"
 
 #define cimg_display 0
@@ -35,8 +39,8 @@
 
 #include <QColor>
 #include <QImage>
-#include <QMessageBox>
 
+#include <array>
 #include <cassert>
 #include <cerrno>
 #include <cmath>
@@ -105,6 +109,61 @@ struct BITMAPINFO /**** Bitmap information structure ****/
 };
 #endif /* !WIN32 */
 
+namespace {
+/// Distance assigned by DeadReckoning if there is no contour in the slice
+inline float NoContourDistance(unsigned short width, unsigned short height)
+{
+	return float((width + height) * (width + height));
+}
+
+/// Sets the 4-connected regions which are not f, do not touch the border and have fewer than minsize pixels to f
+template<typename T>
+void FillSmallHoles(T* bits, unsigned short width, unsigned short height, T f, int minsize)
+{
+	using labeling_type = ConnectedComponents<T>;
+
+	std::array<unsigned, 3> const dims = {width, height, 1};
+	labeling_type labeling(dims, labeling_type::kFaces);
+	labeling.Compute(std::vector<T*>(1, bits), [f](T v) { return v != f; }, false);
+
+	std::uint64_t const max_volume = std::max(minsize, 0);
+	std::vector<bool> fill(labeling.NumComponents(), false);
+	for (size_t i = 0; i < fill.size(); i++)
+	{
+		const auto& c = labeling.Components()[i];
+		fill[i] = c.m_Volume < max_volume && c.m_Min[0] > 0 && c.m_Min[1] > 0 && c.m_Max[0] + 1 < width && c.m_Max[1] + 1 < height;
+	}
+
+	size_t const area = static_cast<size_t>(width) * height;
+	for (size_t i = 0; i < area; i++)
+	{
+		auto const label = labeling.Label(i);
+		if (label != labeling_type::k_background && fill[label])
+			bits[i] = f;
+	}
+}
+
+/// Sets the 8-connected regions of f with fewer than minsize pixels to 0
+template<typename T>
+void RemoveSmallIslands(T* bits, unsigned short width, unsigned short height, T f, int minsize)
+{
+	using labeling_type = ConnectedComponents<T>;
+
+	std::array<unsigned, 3> const dims = {width, height, 1};
+	labeling_type labeling(dims, labeling_type::kEdges);
+	labeling.Compute(std::vector<T*>(1, bits), [f](T v) { return v == f; });
+
+	std::uint64_t const max_volume = std::max(minsize, 0);
+	size_t const area = static_cast<size_t>(width) * height;
+	for (size_t i = 0; i < area; i++)
+	{
+		auto const label = labeling.Label(i);
+		if (label != labeling_type::k_background && labeling.Components()[label].m_Volume < max_volume)
+			bits[i] = 0;
+	}
+}
+} // namespace
+
 template<typename T>
 inline void swap_maps(T const*& Tp1, T const*& Tp2)
 {
@@ -2535,6 +2594,43 @@ FILE* Bmphandler::LoadProj(FILE* fp, int tissuesVersion, bool inclpics, bool ini
 	return fp;
 }
 
+void Bmphandler::GetAnnotations(SliceAnnotations& slice) const
+{
+	slice.m_Width = m_Width;
+	slice.m_Height = m_Height;
+	slice.m_Marks = m_Marks;
+	slice.m_Vvm = m_Vvm;
+	slice.m_Limits = m_Limits;
+	slice.m_Mode1 = m_Mode1;
+	slice.m_Mode2 = m_Mode2;
+}
+
+void Bmphandler::SetAnnotations(SliceAnnotations& slice, bool init)
+{
+	Newbmp(slice.m_Width, slice.m_Height, init);
+
+	m_Marks.swap(slice.m_Marks);
+	slice.m_Marks.clear();
+
+	ClearVvm();
+	m_Vvm.swap(slice.m_Vvm);
+	slice.m_Vvm.clear();
+	for (const auto& vm : m_Vvm)
+	{
+		if (!vm.empty())
+		{
+			m_MaximStore = std::max(m_MaximStore, vm.begin()->mark);
+		}
+	}
+
+	ClearLimits();
+	m_Limits.swap(slice.m_Limits);
+	slice.m_Limits.clear();
+
+	m_Mode1 = slice.m_Mode1;
+	m_Mode2 = slice.m_Mode2;
+}
+
 FILE* Bmphandler::LoadStack(FILE* fp)
 {
 	fread(&stackcounter, sizeof(unsigned), 1, fp);
@@ -6193,55 +6289,12 @@ void Bmphandler::SobelFiner()
 void Bmphandler::MedianInterquartile(bool median)
 {
 	unsigned char dummymode = m_Mode1;
-	std::vector<float> fvec;
-
-	unsigned k = 0;
-
-	for (unsigned short i = 0; i < m_Height - 2; i++)
-	{
-		for (unsigned short j = 0; j < m_Width - 2; j++)
-		{
-			fvec.clear();
-			for (unsigned short l = 0; l < 3; l++)
-			{
-				for (unsigned short m = 0; m < 3; m++)
-				{
-					fvec.push_back(m_BmpBits[k + l + m * m_Width]);
-				}
-			}
-
-			std::sort(fvec.begin(), fvec.end());
-			if (median)
-				m_WorkBits[k + 1 + m_Width] = fvec[4];
-			else
-				m_WorkBits[k + 1 + m_Width] = fvec[7] - fvec[1];
-			k++;
-		}
-		k += 2;
-	}
 
+	RankFilter filter({m_Width, m_Height, 1}, {1, 1, 0});
 	if (median)
-	{
-		for (unsigned k = 0; k < m_Width; k++)
-			m_WorkBits[k] = m_BmpBits[k];
-		for (unsigned k = m_Area - m_Width; k < m_Area; k++)
-			m_WorkBits[k] = m_BmpBits[k];
-		for (unsigned k = 0; k < m_Area; k += m_Width)
-			m_WorkBits[k] = m_BmpBits[k];
-		for (unsigned k = m_Width - 1; k < m_Area; k += m_Width)
-			m_WorkBits[k] = m_BmpBits[k];
-	}
+		filter.Median(m_BmpBits, m_WorkBits);
 	else
-	{
-		for (unsigned k = 0; k < m_Width; k++)
-			m_WorkBits[k] = 0;
-		for (unsigned k = m_Area - m_Width; k < m_Area; k++)
-			m_WorkBits[k] = 0;
-		for (unsigned k = 0; k < m_Area; k += m_Width)
-			m_WorkBits[k] = 0;
-		for (unsigned k = m_Width - 1; k < m_Area; k += m_Width)
-			m_WorkBits[k] = 0;
-	}
+		filter.InterquartileRange(m_BmpBits, m_WorkBits);
 
 	m_Mode1 = dummymode;
 	m_Mode2 = 1;
@@ -6250,47 +6303,21 @@ void Bmphandler::MedianInterquartile(bool median)
 void Bmphandler::MedianInterquartile(float* median, float* iq)
 {
 	unsigned char dummymode = m_Mode1;
-	std::vector<float> fvec;
 
-	unsigned k = 0;
+	RankFilter filter({m_Width, m_Height, 1}, {1, 1, 0});
+	filter.Median(m_BmpBits, median);
+	filter.InterquartileRange(m_BmpBits, iq);
 
-	for (unsigned short i = 0; i < m_Height - 2; i++)
-	{
-		for (unsigned short j = 0; j < m_Width - 2; j++)
-		{
-			fvec.clear();
-			for (unsigned short l = 0; l < 3; l++)
-			{
-				for (unsigned short m = 0; m < 3; m++)
-				{
-					fvec.push_back(m_BmpBits[k + l + m * m_Width]);
-				}
-			}
+	m_Mode1 = dummymode;
+	m_Mode2 = 1;
+}
 
-			std::sort(fvec.begin(), fvec.end());
-			median[k + 1 + m_Width] = fvec[4];
-			iq[k + 1 + m_Width] = fvec[7] - fvec[1];
-			k++;
-		}
-		k += 2;
-	}
+void Bmphandler::PercentileFilter(unsigned short nx, unsigned short ny, float percentile)
+{
+	unsigned char dummymode = m_Mode1;
 
-	for (unsigned k = 0; k < m_Width; k++)
-		median[k] = m_BmpBits[k];
-	for (unsigned k = m_Area - m_Width; k < m_Area; k++)
-		median[k] = m_BmpBits[k];
-	for (unsigned k = 0; k < m_Area; k += m_Width)
-		median[k] = m_BmpBits[k];
-	for (unsigned k = m_Width - 1; k < m_Area; k += m_Width)
-		median[k] = m_BmpBits[k];
-	for (unsigned k = 0; k < m_Width; k++)
-		iq[k] = 0;
-	for (unsigned k = m_Area - m_Width; k < m_Area; k++)
-		iq[k] = 0;
-	for (unsigned k = 0; k < m_Area; k += m_Width)
-		iq[k] = 0;
-	for (unsigned k = m_Width - 1; k < m_Area; k += m_Width)
-		iq[k] = 0;
+	RankFilter filter({m_Width, m_Height, 1}, {nx / 2u, ny / 2u, 0});
+	filter.Percentile(m_BmpBits, m_WorkBits, percentile);
 
 	m_Mode1 = dummymode;
 	m_Mode2 = 1;
@@ -7533,169 +7560,30 @@ void Bmphandler::PlotLine() // very temporary solution...
 
 void Bmphandler::ConnectedComponents(bool connectivity)
 {
-	unsigned char dummymode = m_Mode1;
-
-	float* temp = (float*)malloc(sizeof(float) * (m_Area + m_Width + m_Height + 1));
-	std::vector<float> maps;
-	float newest = 0.1f;
-
-	for (unsigned i = 0; i < m_Area; i++)
-		temp[i + i / m_Width + m_Width + 2] = m_BmpBits[i];
-	for (unsigned i = m_Width + 1; i <= m_Area + m_Height; i += m_Width + 1)
-		temp[i] = -1e10f;
-	for (unsigned i = 0; i <= m_Width; i++)
-		temp[i] = -2e10f;
-
-	unsigned i1 = m_Width + 2;
-	unsigned i2 = 0;
-
-	for (short j = 0; j < m_Height; j++)
-	{
-		for (short k = 0; k < m_Width; k++)
-		{
-			if (temp[i1] == temp[i1 - 1])
-			{
-				m_WorkBits[i2] = BaseConnection(m_WorkBits[i2 - 1], &maps);
-				if (temp[i1] == temp[i1 - m_Width - 1])
-				{
-					maps[(int)BaseConnection(m_WorkBits[i2 - m_Width], &maps)] =
-							m_WorkBits[i2];
-				}
-			}
-			else
-			{
-				if (temp[i1] == temp[i1 - m_Width - 1])
-					m_WorkBits[i2] =
-							BaseConnection(m_WorkBits[i2 - m_Width], &maps);
-				else if (connectivity && temp[i1] == temp[i1 - m_Width - 2])
-					m_WorkBits[i2] =
-							BaseConnection(m_WorkBits[i2 - m_Width - 1], &maps);
-				else
-				{
-					maps.push_back(newest);
-					m_WorkBits[i2] = newest;
-					newest++;
-				}
-			}
-
-			if (connectivity && temp[i1 - 1] == temp[i1 - m_Width - 1])
-				maps[(int)BaseConnection(m_WorkBits[i2 - 1], &maps)] =
-						BaseConnection(m_WorkBits[i2 - m_Width], &maps);
-
-			i1++;
-			i2++;
-		}
-		i1++;
-	}
-
-	for (unsigned i = 0; i < m_Area; i++)
-		m_WorkBits[i] = BaseConnection(m_WorkBits[i], &maps);
-
-	newest = 0.0f;
-	for (i1 = 0; i1 < (unsigned)maps.size(); i1++)
-		if ((unsigned)maps[i1] == i1)
-		{
-			maps[i1] = newest;
-			newest++;
-		}
-
-	for (unsigned i = 0; i < m_Area; i++)
-		m_WorkBits[i] = maps[(int)m_WorkBits[i]];
-
-	free(temp);
-
-	m_Mode1 = dummymode;
-	m_Mode2 = 2;
+	std::set<float> components;
+	ConnectedComponents(connectivity, components);
 }
 
 void Bmphandler::ConnectedComponents(bool connectivity, std::set<float>& components)
 {
-	unsigned char dummymode = m_Mode1;
-
-	float* temp = (float*)malloc(sizeof(float) * (m_Area + m_Width + m_Height + 1));
-	std::vector<float> maps;
-	float newest = 0.1f;
-
-	for (unsigned i = 0; i < m_Area; i++)
-		temp[i + i / m_Width + m_Width + 2] = m_BmpBits[i];
-	for (unsigned i = m_Width + 1; i <= m_Area + m_Height; i += m_Width + 1)
-		temp[i] = -1e10f;
-	for (unsigned i = 0; i <= m_Width; i++)
-		temp[i] = -2e10f;
-
-	unsigned i1 = m_Width + 2;
-	unsigned i2 = 0;
-
-	for (short j = 0; j < m_Height; j++)
-	{
-		for (short k = 0; k < m_Width; k++)
-		{
-			if (temp[i1] == temp[i1 - 1])
-			{
-				m_WorkBits[i2] = BaseConnection(m_WorkBits[i2 - 1], &maps);
-				if (temp[i1] == temp[i1 - m_Width - 1])
-				{
-					maps[(int)BaseConnection(m_WorkBits[i2 - m_Width], &maps)] =
-							m_WorkBits[i2];
-				}
-			}
-			else
-			{
-				if (temp[i1] == temp[i1 - m_Width - 1])
-					m_WorkBits[i2] =
-							BaseConnection(m_WorkBits[i2 - m_Width], &maps);
-				else if (connectivity && temp[i1] == temp[i1 - m_Width - 2])
-					m_WorkBits[i2] =
-							BaseConnection(m_WorkBits[i2 - m_Width - 1], &maps);
-				else
-				{
-					maps.push_back(newest);
-					m_WorkBits[i2] = newest;
-					newest++;
-				}
-			}
-
-			if (connectivity && temp[i1 - 1] == temp[i1 - m_Width - 1])
-				maps[(int)BaseConnection(m_WorkBits[i2 - 1], &maps)] =
-						BaseConnection(m_WorkBits[i2 - m_Width], &maps);
-
-			i1++;
-			i2++;
-		}
-		i1++;
-	}
+	using labeling_type = iseg::ConnectedComponents<float>;
 
-	for (unsigned i = 0; i < m_Area; i++)
-		m_WorkBits[i] = BaseConnection(m_WorkBits[i], &maps);
+	unsigned char dummymode = m_Mode1;
 
-	newest = 0.0f;
-	for (i1 = 0; i1 < (unsigned)maps.size(); i1++)
-		if ((unsigned)maps[i1] == i1)
-		{
-			maps[i1] = newest;
-			newest++;
-		}
+	// regions of equal value, numbered in the order of their first pixel
+	std::array<unsigned, 3> const dims = {m_Width, m_Height, 1};
+	labeling_type labeling(dims, connectivity ? labeling_type::kEdges : labeling_type::kFaces);
+	size_t const n = labeling.Compute(std::vector<float*>(1, m_BmpBits));
 
 	for (unsigned i = 0; i < m_Area; i++)
-	{
-		m_WorkBits[i] = maps[(int)m_WorkBits[i]];
-		components.insert(m_WorkBits[i]);
-	}
-
-	free(temp);
+		m_WorkBits[i] = static_cast<float>(labeling.Label(i));
+	for (size_t i = 0; i < n; i++)
+		components.insert(components.end(), static_cast<float>(i));
 
 	m_Mode1 = dummymode;
 	m_Mode2 = 2;
 }
 
-float Bmphandler::BaseConnection(float c, std::vector<float>* maps)
-{
-	if (c == (*maps)[(int)c])
-		return c;
-	else
-		return (*maps)[(int)c] = BaseConnection((*maps)[(int)c], maps);
-}
-
 void Bmphandler::FillGaps(short unsigned n, bool connectivity)
 {
 	unsigned char dummymode1 = m_Mode1;
@@ -9594,1125 +9482,743 @@ void Bmphandler::DistanceMap(bool connectivity)
 	m_Mode2 = 1;
 }
 
-void Bmphandler::DistanceMap(bool connectivity, float f, short unsigned levlset)
+void Bmphandler::DistanceMap(float f, short unsigned levlset)
 {
 	unsigned char dummymode = m_Mode1;
-	std::vector<unsigned> v1, v2;
-	std::vector<unsigned>*vp1, *vp2, *vpdummy;
-	const float background = f - m_Width - m_Height;
 
-	std::vector<std::vector<Point>> vo, vi;
-	std::vector<unsigned>::iterator vuit;
-	std::vector<Point>::iterator vpit;
+	DeadReckoning(f);
 
-	SwapBmpwork();
-	GetContours(f, &vo, &vi, 0);
-	SwapBmpwork();
+	for (unsigned i = 0; i < m_Area; i++)
+	{
+		if ((levlset == 0 && m_WorkBits[i] >= 0) || (levlset == 1 && m_WorkBits[i] <= 0))
+			m_WorkBits[i] = f;
+		else
+			m_WorkBits[i] += f;
+	}
+
+	m_Mode1 = dummymode;
+	m_Mode2 = 1;
+}
 
-	for (unsigned i = 0; i < (unsigned)vo.size(); i++)
-		for (vpit = vo[i].begin(); vpit != vo[i].end(); vpit++)
-			v1.push_back(Pt2coord(*vpit));
-	for (unsigned i = 0; i < (unsigned)vi.size(); i++)
-		for (vpit = vi[i].begin(); vpit != vi[i].end(); vpit++)
-			v1.push_back(Pt2coord(*vpit));
+void Bmphandler::DeadReckoning(float f, unsigned* nearest)
+{
+	unsigned char dummymode = m_Mode1;
 
+	std::vector<unsigned char> object(m_Area);
+	unsigned count = 0;
 	for (unsigned i = 0; i < m_Area; i++)
-		m_WorkBits[i] = background;
-	for (vuit = v1.begin(); vuit != v1.end(); vuit++)
-		m_WorkBits[*vuit] = f;
+	{
+		object[i] = (m_BmpBits[i] == f);
+		count += object[i];
+	}
 
-	if (levlset == 0)
-		for (unsigned i = 0; i < m_Area; i++)
-			if (m_BmpBits[i] == f)
-				m_WorkBits[i] = f;
+	DistanceTransform edt({m_Width, m_Height, 1});
+	edt.SignedDistance(object.data(), m_WorkBits, nearest);
 
-	if (levlset == 1)
+	// there is no contour
+	if (count == 0)
+	{
 		for (unsigned i = 0; i < m_Area; i++)
-			if (m_BmpBits[i] != f)
-				m_WorkBits[i] = f;
+			m_WorkBits[i] = -NoContourDistance(m_Width, m_Height);
+	}
 
-	vp1 = &v1;
-	vp2 = &v2;
+	m_Mode1 = dummymode;
+	m_Mode2 = 1;
+}
 
-	float wbp;
-	unsigned p;
+void Bmphandler::DeadReckoning()
+{
+	unsigned char dummymode = m_Mode1;
 
-	while (!(*vp1).empty())
+	// the pixels on both sides of an edge between different values
+	std::vector<unsigned char> seeds(m_Area, 0);
+	bool has_seeds = false;
+	unsigned i1 = 0;
+	for (unsigned short h = 0; h < m_Height; h++)
 	{
-		for (vuit = (*vp1).begin(); vuit != (*vp1).end(); vuit++)
+		for (unsigned short w = 0; w < m_Width; w++, i1++)
 		{
-			p = *vuit;
-			wbp = m_WorkBits[p];
-
-			if (p % m_Width != 0 && m_WorkBits[p - 1] == background)
-			{
-				if (m_BmpBits[p - 1] == f)
-				{
-					m_WorkBits[p - 1] = wbp + 1;
-					(*vp2).push_back(p - 1);
-				}
-				else
-				{
-					m_WorkBits[p - 1] = wbp - 1;
-					(*vp2).push_back(p - 1);
-				}
-			}
-
-			if ((p + 1) % m_Width != 0 && m_WorkBits[p + 1] == background)
-			{
-				if (m_BmpBits[p + 1] == f)
-				{
-					m_WorkBits[p + 1] = wbp + 1;
-					(*vp2).push_back(p + 1);
-				}
-				else
-				{
-					m_WorkBits[p + 1] = wbp - 1;
-					(*vp2).push_back(p + 1);
-				}
-			}
-
-			if (p >= m_Width && m_WorkBits[p - m_Width] == background)
-			{
-				if (m_BmpBits[p - m_Width] == f)
-				{
-					m_WorkBits[p - m_Width] = wbp + 1;
-					(*vp2).push_back(p - m_Width);
-				}
-				else
-				{
-					m_WorkBits[p - m_Width] = wbp - 1;
-					(*vp2).push_back(p - m_Width);
-				}
-			}
-
-			if ((p + m_Width) < m_Area != 0 && m_WorkBits[p + m_Width] == background)
+			if (w + 1 < m_Width && m_BmpBits[i1] != m_BmpBits[i1 + 1])
 			{
-				if (m_BmpBits[p + m_Width] == f)
-				{
-					m_WorkBits[p + m_Width] = wbp + 1;
-					(*vp2).push_back(p + m_Width);
-				}
-				else
-				{
-					m_WorkBits[p + m_Width] = wbp - 1;
-					(*vp2).push_back(p + m_Width);
-				}
+				seeds[i1] = seeds[i1 + 1] = 1;
+				has_seeds = true;
 			}
-
-			if (connectivity)
+			if (h + 1 < m_Height && m_BmpBits[i1] != m_BmpBits[i1 + m_Width])
 			{
-				if (p % m_Width != 0 && p >= m_Width &&
-						m_WorkBits[p - 1 - m_Width] == background)
-				{
-					if (m_BmpBits[p - 1 - m_Width] == f)
-					{
-						m_WorkBits[p - 1 - m_Width] = wbp + 1;
-						(*vp2).push_back(p - 1 - m_Width);
-					}
-					else
-					{
-						m_WorkBits[p - 1 - m_Width] = wbp - 1;
-						(*vp2).push_back(p - 1 - m_Width);
-					}
-				}
-
-				if (p % m_Width != 0 && (p + m_Width) < m_Area &&
-						m_WorkBits[p - 1 + m_Width] == background)
-				{
-					if (m_BmpBits[p - 1 + m_Width] == f)
-					{
-						m_WorkBits[p - 1 + m_Width] = wbp + 1;
-						(*vp2).push_back(p - 1 + m_Width);
-					}
-					else
-					{
-						m_WorkBits[p - 1 + m_Width] = wbp - 1;
-						(*vp2).push_back(p - 1 + m_Width);
-					}
-				}
-
-				if ((p + 1) % m_Width != 0 && p >= m_Width &&
-						m_WorkBits[p - m_Width + 1] == background)
-				{
-					if (m_BmpBits[p - m_Width + 1] == f)
-					{
-						m_WorkBits[p - m_Width + 1] = wbp + 1;
-						(*vp2).push_back(p - m_Width + 1);
-					}
-					else
-					{
-						m_WorkBits[p - m_Width + 1] = wbp - 1;
-						(*vp2).push_back(p - m_Width + 1);
-					}
-				}
-
-				if ((p + 1) % m_Width != 0 && (p + m_Width) < m_Area &&
-						m_WorkBits[p + m_Width + 1] == background)
-				{
-					if (m_BmpBits[p + m_Width + 1] == f)
-					{
-						m_WorkBits[p + m_Width + 1] = wbp + 1;
-						(*vp2).push_back(p + m_Width + 1);
-					}
-					else
-					{
-						m_WorkBits[p + m_Width + 1] = wbp - 1;
-						(*vp2).push_back(p + m_Width + 1);
-					}
-				}
+				seeds[i1] = seeds[i1 + m_Width] = 1;
+				has_seeds = true;
 			}
 		}
+	}
 
-		(*vp1).clear();
-		vpdummy = vp1;
-		vp1 = vp2;
-		vp2 = vpdummy;
+	if (has_seeds)
+	{
+		DistanceTransform edt({m_Width, m_Height, 1});
+		edt.Distance(seeds.data(), m_WorkBits);
+	}
+	else
+	{
+		for (unsigned i = 0; i < m_Area; i++)
+			m_WorkBits[i] = NoContourDistance(m_Width, m_Height);
 	}
 
 	m_Mode1 = dummymode;
 	m_Mode2 = 1;
 }
 
-unsigned* Bmphandler::DeadReckoning(float f)
+void Bmphandler::DeadReckoningSquared(float f, unsigned* nearest)
 {
 	unsigned char dummymode = m_Mode1;
-	unsigned* p = (unsigned*)malloc(m_Area * sizeof(unsigned));
 
+	std::vector<unsigned char> object(m_Area);
+	unsigned count = 0;
 	for (unsigned i = 0; i < m_Area; i++)
 	{
-		m_WorkBits[i] = float((m_Width + m_Height) * (m_Width + m_Height));
-		p[i] = m_Area;
+		object[i] = (m_BmpBits[i] == f);
+		count += object[i];
 	}
 
-	std::vector<std::vector<Point>> vo, vi;
-	std::vector<unsigned>::iterator vuit;
-	std::vector<Point>::iterator vpit;
-
-	SwapBmpwork();
-	GetContours(f, &vo, &vi, 0);
-	SwapBmpwork();
+	DistanceTransform edt({m_Width, m_Height, 1});
+	std::vector<unsigned char> contour(m_Area);
+	edt.Boundary(object.data(), contour.data());
+	edt.SquaredDistance(contour.data(), m_WorkBits, nearest);
 
-	for (unsigned i = 0; i < (unsigned)vo.size(); i++)
+	for (unsigned i = 0; i < m_Area; i++)
 	{
-		for (vpit = vo[i].begin(); vpit != vo[i].end(); vpit++)
-		{
-			m_WorkBits[Pt2coord(*vpit)] = 0;
-			p[Pt2coord(*vpit)] = Pt2coord(*vpit);
-		}
-		//		cout << ";"<<vo[i].size();
+		if (count == 0)
+			m_WorkBits[i] = NoContourDistance(m_Width, m_Height);
+		if (!object[i])
+			m_WorkBits[i] = -m_WorkBits[i];
 	}
-	for (unsigned i = 0; i < (unsigned)vi.size(); i++)
+
+	m_Mode1 = dummymode;
+	m_Mode2 = 1;
+}
+
+void Bmphandler::IftDistance1(float f)
+{
+	unsigned char dummymode = m_Mode1;
+	ImageForestingTransformDistance if_tdist;
+	if_tdist.DistanceInit(m_Width, m_Height, f, m_BmpBits);
+	float* f1 = if_tdist.ReturnPf();
+	for (unsigned i = 0; i < m_Area; i++)
 	{
-		for (vpit = vi[i].begin(); vpit != vi[i].end(); vpit++)
-		{
-			m_WorkBits[Pt2coord(*vpit)] = 0;
-			p[Pt2coord(*vpit)] = Pt2coord(*vpit);
-		}
-		//		cout << "."<<vi[i].size();
+		if (m_BmpBits[i] == f)
+			m_WorkBits[i] = f1[i];
+		else
+			m_WorkBits[i] = -f1[i];
 	}
+	m_Mode1 = dummymode;
+	m_Mode2 = 1;
+}
+
+void Bmphandler::RgIft(float* lb_map, float thresh)
+{
+	unsigned char dummymode = m_Mode1;
+	ImageForestingTransformRegionGrowing if_trg;
+
+	//	sobel();
 
-	unsigned j = 0;
+	//	IFTrg.rg_init(width,height,work_bits,lb_map);
+	if_trg.RgInit(m_Width, m_Height, m_BmpBits, lb_map);
 
-	float d1 = 1;
-	float d2 = sqrt(2.0f);
+	float* f1 = if_trg.ReturnLb();
+	float* f2 = if_trg.ReturnPf();
 
-	for (unsigned short k = 0; k < m_Height; k++)
+	for (unsigned i = 0; i < m_Area; i++)
 	{
-		for (unsigned short l = 0; l < m_Width; l++)
-		{
-			if (k > 0)
-			{
-				if (l > 0 && m_WorkBits[j - 1 - m_Width] + d2 < m_WorkBits[j])
-				{
-					p[j] = p[j - 1 - m_Width];
-					m_WorkBits[j] =
-							sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-												 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-				}
+		if (f2[i] < thresh)
+			m_WorkBits[i] = f1[i];
+		else
+			m_WorkBits[i] = 0;
+	}
 
-				if (m_WorkBits[j - m_Width] + d1 < m_WorkBits[j])
-				{
-					p[j] = p[j - m_Width];
-					m_WorkBits[j] =
-							sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-												 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-				}
+	m_Mode1 = dummymode;
+	m_Mode2 = 2;
+}
 
-				if ((l + 1) != m_Width &&
-						m_WorkBits[j + 1 - m_Width] + d2 < m_WorkBits[j])
-				{
-					p[j] = p[j + 1 - m_Width];
-					m_WorkBits[j] =
-							sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-												 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-				}
-			}
+ImageForestingTransformRegionGrowing* Bmphandler::IfTrgInit(float* lb_map)
+{
+	ImageForestingTransformRegionGrowing* if_trg =
+			new ImageForestingTransformRegionGrowing;
 
-			if (l > 0 && m_WorkBits[j - 1] + d1 < m_WorkBits[j])
-			{
-				p[j] = p[j - 1];
-				m_WorkBits[j] =
-						sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-											 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-			}
+	//	float *tmp=work_bits;
+	//	work_bits=sliceprovide->give_me();
 
-			j++;
-		}
-	}
+	//	sobel();
 
-	j = m_Area - 1;
+	//	IFTrg->rg_init(width,height,work_bits,lb_map);
+	if_trg->RgInit(m_Width, m_Height, m_BmpBits, lb_map);
 
-	for (int k = m_Height - 1; k >= 0; k--)
-	{
-		for (int l = m_Width - 1; l >= 0; l--)
-		{
-			if ((l + 1) != m_Width && m_WorkBits[j + 1] + d1 < m_WorkBits[j])
-			{
-				p[j] = p[j + 1];
-				m_WorkBits[j] =
-						sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-											 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-			}
+	//	sliceprovide->take_back(work_bits);
 
-			if ((k + 1) != m_Height)
-			{
-				if (l > 0 && m_WorkBits[j - 1 + m_Width] + d2 < m_WorkBits[j])
-				{
-					p[j] = p[j - 1 + m_Width];
-					m_WorkBits[j] =
-							sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-												 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-				}
+	//	work_bits=tmp;
 
-				if (m_WorkBits[j + m_Width] + d1 < m_WorkBits[j])
-				{
-					p[j] = p[j + m_Width];
-					m_WorkBits[j] =
-							sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-												 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-				}
+	return if_trg;
+}
 
-				if ((l + 1) != m_Width &&
-						m_WorkBits[j + 1 + m_Width] + d2 < m_WorkBits[j])
-				{
-					p[j] = p[j + 1 + m_Width];
-					m_WorkBits[j] =
-							sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-												 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-				}
-			}
+ImageForestingTransformLivewire* Bmphandler::Livewireinit(Point pt)
+{
+	unsigned char dummymode1 = m_Mode1;
+	unsigned char dummymode2 = m_Mode2;
 
-			j--;
-		}
-	}
+	float* sobelx = m_Sliceprovide->GiveMe();
+	float* sobely = m_Sliceprovide->GiveMe();
+	float* tmp = m_Sliceprovide->GiveMe();
+	float* dummy;
+	float* dummy1;
+	float* grad = m_WorkBits;
+	m_WorkBits = m_Sliceprovide->GiveMe();
 
-	j = 0;
+	Gaussian(1);
+	dummy = m_BmpBits;
+	m_BmpBits = tmp;
+	tmp = dummy;
+	SwapBmpwork();
+	Sobelxy(&sobelx, &sobely);
 
-	for (unsigned short k = 0; k < m_Height; k++)
-	{
-		for (unsigned short l = 0; l < m_Width; l++)
-		{
-			if (k > 0)
-			{
-				if (l > 0 && m_WorkBits[j - 1 - m_Width] + d2 < m_WorkBits[j])
-				{
-					p[j] = p[j - 1 - m_Width];
-					m_WorkBits[j] =
-							sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-												 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-				}
+	dummy = DirectionMap(sobelx, sobely);
 
-				if (m_WorkBits[j - m_Width] + d1 < m_WorkBits[j])
-				{
-					p[j] = p[j - m_Width];
-					m_WorkBits[j] =
-							sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-												 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-				}
+	Pair p;
+	GetRange(&p);
 
-				if ((l + 1) != m_Width &&
-						m_WorkBits[j + 1 - m_Width] + d2 < m_WorkBits[j])
-				{
-					p[j] = p[j + 1 - m_Width];
-					m_WorkBits[j] =
-							sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-												 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-				}
-			}
+	//	sliceprovide->take_back(sobely);
+	//	sobely=grad;
 
-			if (l > 0 && m_WorkBits[j - 1] + d1 < m_WorkBits[j])
-			{
-				p[j] = p[j - 1];
-				m_WorkBits[j] =
-						sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-											 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-			}
+	//	grad=work_bits;
+	//	work_bits=sobelx;
+	dummy1 = sobely;
+	sobely = m_WorkBits;
+	m_WorkBits = dummy1;
 
-			j++;
-		}
-	}
+	LaplacianZero(2.0f, 30, false);
 
-	for (unsigned i = 0; i < m_Area; i++)
-		if (m_BmpBits[i] != f)
-			m_WorkBits[i] = -m_WorkBits[i];
+	if (p.high != 0)
+		for (unsigned i = 0; i < m_Area; i++)
+			sobelx[i] = (0.43f * (1 - sobely[i] / p.high) +
+									 0.43f * ((m_WorkBits[i] + 1) / 256));
+	else
+		for (unsigned i = 0; i < m_Area; i++)
+			sobelx[i] = 0.43f * ((m_WorkBits[i] + 1) / 256);
 
-	/*	for(unsigned i=0;i<(unsigned)vo.size();i++)
-		for(vpit=vo[i].begin();vpit!=vo[i].end();vpit++) {
-			work_bits[pt2coord(*vpit)]=255;
-			P[pt2coord(*vpit)]=pt2coord(*vpit);
-		}
-	for(unsigned i=0;i<(unsigned)vi.size();i++)
-		for(vpit=vi[i].begin();vpit!=vi[i].end();vpit++) {
-			work_bits[pt2coord(*vpit)]=255;
-			P[pt2coord(*vpit)]=pt2coord(*vpit);
-		}*/
+	ImageForestingTransformLivewire* lw = new ImageForestingTransformLivewire;
+	lw->LwInit(m_Width, m_Height, sobelx, dummy, pt);
 
-	m_Mode1 = dummymode;
-	m_Mode2 = 1;
+	m_Sliceprovide->TakeBack(sobelx);
+	m_Sliceprovide->TakeBack(sobely);
+	m_Sliceprovide->TakeBack(m_BmpBits);
+	m_Sliceprovide->TakeBack(m_WorkBits);
+	m_Sliceprovide->TakeBack(dummy);
+	m_BmpBits = tmp;
+	m_WorkBits = grad;
 
-	return p;
+	m_Mode1 = dummymode1;
+	m_Mode2 = dummymode2;
+
+	return lw;
 }
 
-void Bmphandler::DeadReckoning()
+void Bmphandler::FillContour(std::vector<Point>* vp, bool continuous)
 {
 	unsigned char dummymode = m_Mode1;
-	unsigned* p = (unsigned*)malloc(m_Area * sizeof(unsigned));
 
-	for (unsigned i = 0; i < m_Area; i++)
+	if (continuous)
 	{
-		m_WorkBits[i] = float((m_Width + m_Height) * (m_Width + m_Height));
-		p[i] = m_Area;
-	}
+		std::vector<int> s;
+		float* results =
+				(float*)malloc(sizeof(float) * (m_Area + 2 * m_Width + 2 * m_Height + 4));
 
-	unsigned i1 = 0;
-	for (unsigned short h = 0; h < m_Height - 1; h++)
-	{
-		for (unsigned short w = 0; w < m_Width; w++)
+		int i = m_Width + 3;
+		int i1 = 0;
+		for (int j = 0; j < m_Height; j++)
 		{
-			if (m_BmpBits[i1] != m_BmpBits[i1 + m_Width])
+			for (int k = 0; k < m_Width; k++)
 			{
-				m_WorkBits[i1] = m_WorkBits[i1 + m_Width] = 0;
-				p[i1] = i1;
-				p[i1 + m_Width] = i1 + m_Width;
+				results[i] = -1;
+				i++;
+				i1++;
 			}
-			i1++;
+
+			i += 2;
 		}
-	}
 
-	i1 = 0;
-	for (unsigned short h = 0; h < m_Height; h++)
-	{
-		for (unsigned short w = 0; w < m_Width - 1; w++)
+		for (std::vector<Point>::iterator it = vp->begin(); it != vp->end(); it++)
 		{
-			if (m_BmpBits[i1] != m_BmpBits[i1 + 1])
-			{
-				m_WorkBits[i1] = m_WorkBits[i1 + 1] = 0;
-				p[i1] = i1;
-				p[i1 + 1] = i1 + 1;
-			}
-			i1++;
+			results[it->px + 1 + (it->py + 1) * (m_Width + 2)] = 0;
 		}
-		i1++;
-	}
-
-	unsigned j = 0;
 
-	float d1 = 1;
-	float d2 = sqrt(2.0f);
+		for (int j = 0; j < m_Width + 2; j++)
+			results[j] = results[j + ((unsigned)m_Width + 2) * (m_Height + 1)] = 0;
+		for (int j = 0; j <= ((int)m_Width + 2) * (m_Height + 1); j += m_Width + 2)
+			results[j] = results[j + m_Width + 1] = 0;
 
-	for (unsigned short k = 0; k < m_Height; k++)
-	{
-		for (unsigned short l = 0; l < m_Width; l++)
+		for (int j = m_Width + 3; j < 2 * m_Width + 3; j++)
 		{
-			if (k > 0)
+			if (results[j] == -1)
 			{
-				if (l > 0 && m_WorkBits[j - 1 - m_Width] + d2 < m_WorkBits[j])
-				{
-					p[j] = p[j - 1 - m_Width];
-					m_WorkBits[j] =
-							sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-												 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-				}
-
-				if (m_WorkBits[j - m_Width] + d1 < m_WorkBits[j])
-				{
-					p[j] = p[j - m_Width];
-					m_WorkBits[j] =
-							sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-												 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-				}
-
-				if ((l + 1) != m_Width &&
-						m_WorkBits[j + 1 - m_Width] + d2 < m_WorkBits[j])
-				{
-					p[j] = p[j + 1 - m_Width];
-					m_WorkBits[j] =
-							sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-												 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-				}
+				results[j] = 255.0f;
+				s.push_back(j);
 			}
-
-			if (l > 0 && m_WorkBits[j - 1] + d1 < m_WorkBits[j])
+		}
+		for (unsigned int j = m_Area + 2 * m_Height + 1;
+				 j < m_Area + m_Width + 2 * m_Height + 1; j++)
+		{
+			if (results[j] == -1)
 			{
-				p[j] = p[j - 1];
-				m_WorkBits[j] =
-						sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-											 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
+				results[j] = 255.0f;
+				s.push_back(j);
 			}
-
-			j++;
 		}
-	}
-
-	j = m_Area - 1;
-
-	for (int k = m_Height - 1; k >= 0; k--)
-	{
-		for (int l = m_Width - 1; l >= 0; l--)
+		for (unsigned int j = 2 * m_Width + 5; j <= m_Area + 2 * m_Height + 1;
+				 j += m_Width + 2)
 		{
-			if ((l + 1) != m_Width && m_WorkBits[j + 1] + d1 < m_WorkBits[j])
+			if (results[j] == -1)
 			{
-				p[j] = p[j + 1];
-				m_WorkBits[j] =
-						sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-											 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
+				results[j] = 255.0f;
+				s.push_back(j);
 			}
-
-			if ((k + 1) != m_Height)
+		}
+		for (unsigned int j = 3 * m_Width + 4; j <= m_Area + m_Width + 2 * m_Height;
+				 j += m_Width + 2)
+		{
+			if (results[j] == -1)
 			{
-				if (l > 0 && m_WorkBits[j - 1 + m_Width] + d2 < m_WorkBits[j])
-				{
-					p[j] = p[j - 1 + m_Width];
-					m_WorkBits[j] =
-							sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-												 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-				}
-
-				if (m_WorkBits[j + m_Width] + d1 < m_WorkBits[j])
-				{
-					p[j] = p[j + m_Width];
-					m_WorkBits[j] =
-							sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-												 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-				}
-
-				if ((l + 1) != m_Width &&
-						m_WorkBits[j + 1 + m_Width] + d2 < m_WorkBits[j])
-				{
-					p[j] = p[j + 1 + m_Width];
-					m_WorkBits[j] =
-							sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-												 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-				}
+				results[j] = 255.0f;
+				s.push_back(j);
 			}
-
-			j--;
 		}
-	}
 
-	j = 0;
+		HystereticGrowth(results, &s, m_Width + 2, m_Height + 2, false, 255.0f);
 
-	for (unsigned short k = 0; k < m_Height; k++)
-	{
-		for (unsigned short l = 0; l < m_Width; l++)
+		i = m_Width + 3;
+		int i2 = 0;
+		for (int j = 0; j < m_Height; j++)
 		{
-			if (k > 0)
+			for (int k = 0; k < m_Width; k++)
 			{
-				if (l > 0 && m_WorkBits[j - 1 - m_Width] + d2 < m_WorkBits[j])
-				{
-					p[j] = p[j - 1 - m_Width];
-					m_WorkBits[j] =
-							sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-												 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-				}
+				m_WorkBits[i2] = 255.0f - results[i];
+				//				if(results[i]==0) 0;
+				//				work_bits[i2]=results[i];
+				i++;
+				i2++;
+			}
 
-				if (m_WorkBits[j - m_Width] + d1 < m_WorkBits[j])
-				{
-					p[j] = p[j - m_Width];
-					m_WorkBits[j] =
-							sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-												 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-				}
+			i += 2;
+		}
 
-				if ((l + 1) != m_Width &&
-						m_WorkBits[j + 1 - m_Width] + d2 < m_WorkBits[j])
-				{
-					p[j] = p[j + 1 - m_Width];
-					m_WorkBits[j] =
-							sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-												 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-				}
-			}
-
-			if (l > 0 && m_WorkBits[j - 1] + d1 < m_WorkBits[j])
-			{
-				p[j] = p[j - 1];
-				m_WorkBits[j] =
-						sqrt(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-											 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-			}
+		free(results);
+	}
+	else
+	{
+		std::vector<Point> vp1;
+		std::vector<Point>::iterator it = vp->begin();
+		Point p = *it;
+		it++;
 
-			j++;
+		for (; it != vp->end(); it++)
+		{
+			addLine(&vp1, p, *it);
+			p = *it;
 		}
-	}
+		addLine(&vp1, p, *(vp->begin()));
 
-	//	for(unsigned i=0;i<area;i++)
-	//		if(bmp_bits[i]==0) work_bits[i]=-work_bits[i];
+		FillContour(&vp1, true);
+	}
 
 	m_Mode1 = dummymode;
-	m_Mode2 = 1;
-
-	free(p);
+	m_Mode2 = 2;
 }
 
-unsigned* Bmphandler::DeadReckoningSquared(float f)
+void Bmphandler::AddSkin(unsigned i4, float setto)
 {
-	unsigned char dummymode = m_Mode1;
-	unsigned* p = (unsigned*)malloc(m_Area * sizeof(unsigned));
-
-	for (unsigned i = 0; i < m_Area; i++)
-	{
-		m_WorkBits[i] = float((m_Width + m_Height) * (m_Width + m_Height));
-		p[i] = m_Area;
-	}
-
-	std::vector<std::vector<Point>> vo, vi;
-	std::vector<Point>::iterator vpit;
-
-	SwapBmpwork();
-	GetContours(f, &vo, &vi, 0);
-	SwapBmpwork();
+	unsigned i = 0, pos, y, x, j;
 
-	for (unsigned i = 0; i < (unsigned)vo.size(); i++)
-	{
-		for (vpit = vo[i].begin(); vpit != vo[i].end(); vpit++)
-		{
-			m_WorkBits[Pt2coord(*vpit)] = 0;
-			p[Pt2coord(*vpit)] = Pt2coord(*vpit);
-		}
-	}
-	for (unsigned i = 0; i < (unsigned)vi.size(); i++)
+	//Create a binary std::vector noTissue/Tissue
+	std::vector<int> s;
+	for (int j = 0; j < m_Height; j++)
 	{
-		for (vpit = vi[i].begin(); vpit != vi[i].end(); vpit++)
+		for (int k = 0; k < m_Width; k++)
 		{
-			m_WorkBits[Pt2coord(*vpit)] = 0;
-			p[Pt2coord(*vpit)] = Pt2coord(*vpit);
+			if (m_WorkBits[i] == 0)
+				s.push_back(-1);
+			else
+				s.push_back(0);
+			i++;
 		}
 	}
 
-	unsigned j = 0;
-
-	float d1 = 1;
-	float d2 = sqrt(2.0f);
-
-	for (unsigned short k = 0; k < m_Height; k++)
+	// i4 itetations through  y, -y, x, -x converting, each time a tissue beginning is find, one tissue pixel into skin
+	//!! It is assumed that ix and iy are the same
+	bool convert_skin = true;
+	for (i = 1; i < i4 + 1; i++)
 	{
-		for (unsigned short l = 0; l < m_Width; l++)
+		for (y = 0; y < m_Height; y++)
 		{
-			if (k > 0)
+			pos = y * m_Width;
+			while (pos < (y + 1) * m_Width)
 			{
-				if (l > 0 && m_WorkBits[j - 1 - m_Width] + d2 < m_WorkBits[j])
+				if (s[pos] == 0)
 				{
-					p[j] = p[j - 1 - m_Width];
-					m_WorkBits[j] =
-							(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-										 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
+					if (convert_skin)
+						s[pos] = 256;
+					convert_skin = false;
 				}
+				else
+					convert_skin = true;
 
-				if (m_WorkBits[j - m_Width] + d1 < m_WorkBits[j])
-				{
-					p[j] = p[j - m_Width];
-					m_WorkBits[j] =
-							(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-										 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-				}
+				pos++;
+			}
 
-				if ((l + 1) != m_Width &&
-						m_WorkBits[j + 1 - m_Width] + d2 < m_WorkBits[j])
+			pos = (y + 1) * m_Width - 1;
+			while (pos > y * m_Width)
+			{
+				if (s[pos] == 0)
 				{
-					p[j] = p[j + 1 - m_Width];
-					m_WorkBits[j] =
-							(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-										 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
+					if (convert_skin)
+						s[pos] = 256;
+					convert_skin = false;
 				}
-			}
+				else
+					convert_skin = true;
 
-			if (l > 0 && m_WorkBits[j - 1] + d1 < m_WorkBits[j])
-			{
-				p[j] = p[j - 1];
-				m_WorkBits[j] = (float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-															 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
+				pos--;
 			}
-
-			j++;
 		}
-	}
 
-	j = m_Area - 1;
-
-	for (int k = m_Height - 1; k >= 0; k--)
-	{
-		for (int l = m_Width - 1; l >= 0; l--)
+		for (x = 0; x < m_Width; x++)
 		{
-			if ((l + 1) != m_Width && m_WorkBits[j + 1] + d1 < m_WorkBits[j])
-			{
-				p[j] = p[j + 1];
-				m_WorkBits[j] = (float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-															 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-			}
-
-			if ((k + 1) != m_Height)
+			pos = x;
+			while (pos < m_Height * m_Width)
 			{
-				if (l > 0 && m_WorkBits[j - 1 + m_Width] + d2 < m_WorkBits[j])
+				if (s[pos] == 0)
 				{
-					p[j] = p[j - 1 + m_Width];
-					m_WorkBits[j] =
-							(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-										 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
+					if (convert_skin)
+						s[pos] = 256;
+					convert_skin = false;
 				}
+				else
+					convert_skin = true;
 
-				if (m_WorkBits[j + m_Width] + d1 < m_WorkBits[j])
-				{
-					p[j] = p[j + m_Width];
-					m_WorkBits[j] =
-							(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-										 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-				}
+				pos += m_Width;
+			}
 
-				if ((l + 1) != m_Width &&
-						m_WorkBits[j + 1 + m_Width] + d2 < m_WorkBits[j])
+			pos = m_Width * (m_Height - 1) + x;
+			while (pos > m_Width)
+			{
+				if (s[pos] == 0)
 				{
-					p[j] = p[j + 1 + m_Width];
-					m_WorkBits[j] =
-							(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-										 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
+					if (convert_skin)
+						s[pos] = 256;
+					convert_skin = false;
 				}
-			}
+				else
+					convert_skin = true;
 
-			j--;
+				pos -= m_Width;
+			}
 		}
 	}
 
-	j = 0;
-
-	for (unsigned short k = 0; k < m_Height; k++)
+	//go over the std::vector and set the skin pixel at the source pointer
+	i = 0;
+	for (j = 0; j < m_Height; j++)
 	{
-		for (unsigned short l = 0; l < m_Width; l++)
+		for (int k = 0; k < m_Width; k++)
 		{
-			if (k > 0)
-			{
-				if (l > 0 && m_WorkBits[j - 1 - m_Width] + d2 < m_WorkBits[j])
-				{
-					p[j] = p[j - 1 - m_Width];
-					m_WorkBits[j] =
-							(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-										 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-				}
-
-				if (m_WorkBits[j - m_Width] + d1 < m_WorkBits[j])
-				{
-					p[j] = p[j - m_Width];
-					m_WorkBits[j] =
-							(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-										 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-				}
+			if (s[i] == 256)
+				m_WorkBits[i] = setto;
+			i++;
+		}
+	}
+}
 
-				if ((l + 1) != m_Width &&
-						m_WorkBits[j + 1 - m_Width] + d2 < m_WorkBits[j])
-				{
-					p[j] = p[j + 1 - m_Width];
-					m_WorkBits[j] =
-							(float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-										 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
-				}
-			}
+void Bmphandler::AddSkinOutside(unsigned i4, float setto)
+{
+	unsigned char dummymode1 = m_Mode1;
+	unsigned char dummymode2 = m_Mode2;
+	std::vector<int> s;
+	std::vector<int> s1;
+	float* results =
+			(float*)malloc(sizeof(float) * (m_Area + 2 * m_Width + 2 * m_Height + 4));
 
-			if (l > 0 && m_WorkBits[j - 1] + d1 < m_WorkBits[j])
+	int i = m_Width + 3;
+	int i3 = 0;
+	for (int j = 0; j < m_Height; j++)
+	{
+		for (int k = 0; k < m_Width; k++)
+		{
+			if (m_WorkBits[i3] == 0)
+				results[i] = -1;
+			else
 			{
-				p[j] = p[j - 1];
-				m_WorkBits[j] = (float((l - p[j] % m_Width) * (l - p[j] % m_Width) +
-															 (k - p[j] / m_Width) * (k - p[j] / m_Width)));
+				results[i] = 0;
+				s1.push_back(i);
 			}
-
-			j++;
+			i++;
+			i3++;
 		}
+
+		i += 2;
 	}
 
-	for (unsigned i = 0; i < m_Area; i++)
-		if (m_BmpBits[i] != f)
-			m_WorkBits[i] = -m_WorkBits[i];
+	for (int j = 0; j < m_Width + 2; j++)
+		results[j] = results[j + ((unsigned)m_Width + 2) * (m_Height + 1)] = 0;
+	for (int j = 0; j <= ((int)m_Width + 2) * (m_Height + 1); j += m_Width + 2)
+		results[j] = results[j + m_Width + 1] = 0;
 
-	/*	for(unsigned i=0;i<(unsigned)vo.size();i++)
-		for(vpit=vo[i].begin();vpit!=vo[i].end();vpit++) {
-			work_bits[pt2coord(*vpit)]=255;
-			P[pt2coord(*vpit)]=pt2coord(*vpit);
+	for (int j = m_Width + 3; j < 2 * m_Width + 3; j++)
+	{
+		if (results[j] == -1)
+		{
+			results[j] = 255.0f;
+			s.push_back(j);
 		}
-	for(unsigned i=0;i<(unsigned)vi.size();i++)
-		for(vpit=vi[i].begin();vpit!=vi[i].end();vpit++) {
-			work_bits[pt2coord(*vpit)]=255;
-			P[pt2coord(*vpit)]=pt2coord(*vpit);
-		}*/
-
-	m_Mode1 = dummymode;
-	m_Mode2 = 1;
-
-	return p;
-}
-
-void Bmphandler::IftDistance1(float f)
-{
-	unsigned char dummymode = m_Mode1;
-	ImageForestingTransformDistance if_tdist;
-	if_tdist.DistanceInit(m_Width, m_Height, f, m_BmpBits);
-	float* f1 = if_tdist.ReturnPf();
-	for (unsigned i = 0; i < m_Area; i++)
+	}
+	for (unsigned int j = m_Area + 2 * m_Height + 1;
+			 j < m_Area + m_Width + 2 * m_Height + 1; j++)
 	{
-		if (m_BmpBits[i] == f)
-			m_WorkBits[i] = f1[i];
-		else
-			m_WorkBits[i] = -f1[i];
+		if (results[j] == -1)
+		{
+			results[j] = 255.0f;
+			s.push_back(j);
+		}
+	}
+	for (unsigned int j = 2 * m_Width + 5; j <= m_Area + 2 * m_Height + 1;
+			 j += m_Width + 2)
+	{
+		if (results[j] == -1)
+		{
+			results[j] = 255.0f;
+			s.push_back(j);
+		}
+	}
+	for (unsigned int j = 3 * m_Width + 4; j <= m_Area + m_Width + 2 * m_Height;
+			 j += m_Width + 2)
+	{
+		if (results[j] == -1)
+		{
+			results[j] = 255.0f;
+			s.push_back(j);
+		}
 	}
-	m_Mode1 = dummymode;
-	m_Mode2 = 1;
-}
-
-void Bmphandler::RgIft(float* lb_map, float thresh)
-{
-	unsigned char dummymode = m_Mode1;
-	ImageForestingTransformRegionGrowing if_trg;
 
-	//	sobel();
+	//hysteretic_growth(results,&s,width+2,height+2,false,255.0f);
+	HystereticGrowth(results, &s, m_Width + 2, m_Height + 2, true, 255.0f);
 
-	//	IFTrg.rg_init(width,height,work_bits,lb_map);
-	if_trg.RgInit(m_Width, m_Height, m_BmpBits, lb_map);
+	for (int j = 0; j <= ((int)m_Width + 2) * (m_Height + 2); j++)
+		if (results[j] == 255.0f)
+			results[j] = -1;
 
-	float* f1 = if_trg.ReturnLb();
-	float* f2 = if_trg.ReturnPf();
+	//hysteretic_growth(results,&s1,width+2,height+2,false,255.0f,i4);
+	HystereticGrowth(results, &s1, m_Width + 2, m_Height + 2, true, 255.0f, i4);
 
-	for (unsigned i = 0; i < m_Area; i++)
+	i = m_Width + 3;
+	int i2 = 0;
+	for (int j = 0; j < m_Height; j++)
 	{
-		if (f2[i] < thresh)
-			m_WorkBits[i] = f1[i];
-		else
-			m_WorkBits[i] = 0;
+		for (int k = 0; k < m_Width; k++)
+		{
+			if (results[i] == 255.0f)
+				m_WorkBits[i2] = setto;
+			//			work_bits[i2]=results[i];
+			i++;
+			i2++;
+		}
+
+		i += 2;
 	}
 
-	m_Mode1 = dummymode;
-	m_Mode2 = 2;
-}
-
-ImageForestingTransformRegionGrowing* Bmphandler::IfTrgInit(float* lb_map)
-{
-	ImageForestingTransformRegionGrowing* if_trg =
-			new ImageForestingTransformRegionGrowing;
-
-	//	float *tmp=work_bits;
-	//	work_bits=sliceprovide->give_me();
-
-	//	sobel();
-
-	//	IFTrg->rg_init(width,height,work_bits,lb_map);
-	if_trg->RgInit(m_Width, m_Height, m_BmpBits, lb_map);
-
-	//	sliceprovide->take_back(work_bits);
-
-	//	work_bits=tmp;
-
-	return if_trg;
-}
-
-ImageForestingTransformLivewire* Bmphandler::Livewireinit(Point pt)
-{
-	unsigned char dummymode1 = m_Mode1;
-	unsigned char dummymode2 = m_Mode2;
-
-	float* sobelx = m_Sliceprovide->GiveMe();
-	float* sobely = m_Sliceprovide->GiveMe();
-	float* tmp = m_Sliceprovide->GiveMe();
-	float* dummy;
-	float* dummy1;
-	float* grad = m_WorkBits;
-	m_WorkBits = m_Sliceprovide->GiveMe();
-
-	Gaussian(1);
-	dummy = m_BmpBits;
-	m_BmpBits = tmp;
-	tmp = dummy;
-	SwapBmpwork();
-	Sobelxy(&sobelx, &sobely);
-
-	dummy = DirectionMap(sobelx, sobely);
-
-	Pair p;
-	GetRange(&p);
-
-	//	sliceprovide->take_back(sobely);
-	//	sobely=grad;
-
-	//	grad=work_bits;
-	//	work_bits=sobelx;
-	dummy1 = sobely;
-	sobely = m_WorkBits;
-	m_WorkBits = dummy1;
-
-	LaplacianZero(2.0f, 30, false);
-
-	if (p.high != 0)
-		for (unsigned i = 0; i < m_Area; i++)
-			sobelx[i] = (0.43f * (1 - sobely[i] / p.high) +
-									 0.43f * ((m_WorkBits[i] + 1) / 256));
-	else
-		for (unsigned i = 0; i < m_Area; i++)
-			sobelx[i] = 0.43f * ((m_WorkBits[i] + 1) / 256);
-
-	ImageForestingTransformLivewire* lw = new ImageForestingTransformLivewire;
-	lw->LwInit(m_Width, m_Height, sobelx, dummy, pt);
-
-	m_Sliceprovide->TakeBack(sobelx);
-	m_Sliceprovide->TakeBack(sobely);
-	m_Sliceprovide->TakeBack(m_BmpBits);
-	m_Sliceprovide->TakeBack(m_WorkBits);
-	m_Sliceprovide->TakeBack(dummy);
-	m_BmpBits = tmp;
-	m_WorkBits = grad;
-
 	m_Mode1 = dummymode1;
 	m_Mode2 = dummymode2;
 
-	return lw;
+	free(results);
 }
 
-void Bmphandler::FillContour(std::vector<Point>* vp, bool continuous)
+void Bmphandler::AddSkintissue(tissuelayers_size_t idx, unsigned i4, tissues_size_t setto)
 {
-	unsigned char dummymode = m_Mode1;
+	std::vector<int> s;
+	float* results = (float*)malloc(sizeof(float) * (m_Area + 2 * m_Width + 2 * m_Height + 4));
 
-	if (continuous)
+	int i = m_Width + 3;
+	int i3 = 0;
+	tissues_size_t* tissues = m_Tissuelayers[idx];
+	for (int j = 0; j < m_Height; j++)
 	{
-		std::vector<int> s;
-		float* results =
-				(float*)malloc(sizeof(float) * (m_Area + 2 * m_Width + 2 * m_Height + 4));
-
-		int i = m_Width + 3;
-		int i1 = 0;
-		for (int j = 0; j < m_Height; j++)
+		for (int k = 0; k < m_Width; k++)
 		{
-			for (int k = 0; k < m_Width; k++)
-			{
+			if (tissues[i3] == 0)
 				results[i] = -1;
-				i++;
-				i1++;
-			}
-
-			i += 2;
+			else
+				results[i] = 0;
+			i++;
+			i3++;
 		}
 
-		for (std::vector<Point>::iterator it = vp->begin(); it != vp->end(); it++)
-		{
-			results[it->px + 1 + (it->py + 1) * (m_Width + 2)] = 0;
-		}
+		i += 2;
+	}
 
-		for (int j = 0; j < m_Width + 2; j++)
-			results[j] = results[j + ((unsigned)m_Width + 2) * (m_Height + 1)] = 0;
-		for (int j = 0; j <= ((int)m_Width + 2) * (m_Height + 1); j += m_Width + 2)
-			results[j] = results[j + m_Width + 1] = 0;
+	for (int j = 0; j < m_Width + 2; j++)
+		results[j] = results[j + ((unsigned)m_Width + 2) * (m_Height + 1)] = 0;
+	for (int j = 0; j <= ((int)m_Width + 2) * (m_Height + 1); j += m_Width + 2)
+		results[j] = results[j + m_Width + 1] = 0;
 
-		for (int j = m_Width + 3; j < 2 * m_Width + 3; j++)
-		{
-			if (results[j] == -1)
-			{
-				results[j] = 255.0f;
-				s.push_back(j);
-			}
-		}
-		for (unsigned int j = m_Area + 2 * m_Height + 1;
-				 j < m_Area + m_Width + 2 * m_Height + 1; j++)
-		{
-			if (results[j] == -1)
-			{
-				results[j] = 255.0f;
-				s.push_back(j);
-			}
-		}
-		for (unsigned int j = 2 * m_Width + 5; j <= m_Area + 2 * m_Height + 1;
-				 j += m_Width + 2)
+	for (int j = m_Width + 3; j < 2 * m_Width + 3; j++)
+	{
+		if (results[j] == -1)
 		{
-			if (results[j] == -1)
-			{
-				results[j] = 255.0f;
-				s.push_back(j);
-			}
+			results[j] = 255.0f;
+			s.push_back(j);
 		}
-		for (unsigned int j = 3 * m_Width + 4; j <= m_Area + m_Width + 2 * m_Height;
-				 j += m_Width + 2)
+	}
+	for (unsigned int j = m_Area + 2 * m_Height + 1;
+			 j < m_Area + m_Width + 2 * m_Height + 1; j++)
+	{
+		if (results[j] == -1)
 		{
-			if (results[j] == -1)
-			{
-				results[j] = 255.0f;
-				s.push_back(j);
-			}
+			results[j] = 255.0f;
+			s.push_back(j);
 		}
-
-		HystereticGrowth(results, &s, m_Width + 2, m_Height + 2, false, 255.0f);
-
-		i = m_Width + 3;
-		int i2 = 0;
-		for (int j = 0; j < m_Height; j++)
+	}
+	for (unsigned int j = 2 * m_Width + 5; j <= m_Area + 2 * m_Height + 1;
+			 j += m_Width + 2)
+	{
+		if (results[j] == -1)
 		{
-			for (int k = 0; k < m_Width; k++)
-			{
-				m_WorkBits[i2] = 255.0f - results[i];
-				//				if(results[i]==0) 0;
-				//				work_bits[i2]=results[i];
-				i++;
-				i2++;
-			}
-
-			i += 2;
+			results[j] = 255.0f;
+			s.push_back(j);
 		}
-
-		free(results);
 	}
-	else
+	for (unsigned int j = 3 * m_Width + 4; j <= m_Area + m_Width + 2 * m_Height;
+			 j += m_Width + 2)
 	{
-		std::vector<Point> vp1;
-		std::vector<Point>::iterator it = vp->begin();
-		Point p = *it;
-		it++;
-
-		for (; it != vp->end(); it++)
+		if (results[j] == -1)
 		{
-			addLine(&vp1, p, *it);
-			p = *it;
+			results[j] = 255.0f;
+			s.push_back(j);
 		}
-		addLine(&vp1, p, *(vp->begin()));
-
-		FillContour(&vp1, true);
 	}
 
-	m_Mode1 = dummymode;
-	m_Mode2 = 2;
-}
+	HystereticGrowth(results, &s, m_Width + 2, m_Height + 2, false, 255.0f);
 
-void Bmphandler::AddSkin(unsigned i4, float setto)
-{
-	unsigned i = 0, pos, y, x, j;
+	unsigned short x, y;
+	unsigned pos;
+	unsigned i1;
+	unsigned w = (unsigned)(m_Width + 2);
 
-	//Create a binary std::vector noTissue/Tissue
-	std::vector<int> s;
-	for (int j = 0; j < m_Height; j++)
+	for (y = 1; y < m_Height + 1; y++)
 	{
-		for (int k = 0; k < m_Width; k++)
+		pos = y * w;
+		i1 = 0;
+		while (pos < (y + 1) * w)
 		{
-			if (m_WorkBits[i] == 0)
-				s.push_back(-1);
+			if (results[pos] == 255.0f)
+				i1 = i4;
 			else
-				s.push_back(0);
-			i++;
+			{
+				if (i1 > 0)
+				{
+					results[pos] = 256.0f;
+					i1--;
+				}
+			}
+			pos++;
 		}
 	}
 
-	// i4 itetations through  y, -y, x, -x converting, each time a tissue beginning is find, one tissue pixel into skin
-	//!! It is assumed that ix and iy are the same
-	bool convert_skin = true;
-	for (i = 1; i < i4 + 1; i++)
+	for (y = 1; y < m_Height + 1; y++)
 	{
-		for (y = 0; y < m_Height; y++)
+		pos = (y + 1) * w - 1;
+		i1 = 0;
+		while (pos > y * w)
 		{
-			pos = y * m_Width;
-			while (pos < (y + 1) * m_Width)
+			if (results[pos] == 255.0f)
+				i1 = i4;
+			else
 			{
-				if (s[pos] == 0)
-				{
-					if (convert_skin)
-						s[pos] = 256;
-					convert_skin = false;
-				}
-				else
-					convert_skin = true;
-
-				pos++;
-			}
-
-			pos = (y + 1) * m_Width - 1;
-			while (pos > y * m_Width)
-			{
-				if (s[pos] == 0)
+				if (i1 > 0)
 				{
-					if (convert_skin)
-						s[pos] = 256;
-					convert_skin = false;
+					results[pos] = 256.0f;
+					i1--;
 				}
-				else
-					convert_skin = true;
-
-				pos--;
 			}
+			pos--;
 		}
+	}
 
-		for (x = 0; x < m_Width; x++)
+	for (x = 1; x < m_Width + 1; x++)
+	{
+		pos = x;
+		i1 = 0;
+		while (pos < (m_Height + 1) * w)
 		{
-			pos = x;
-			while (pos < m_Height * m_Width)
+			if (results[pos] == 255.0f)
+				i1 = i4;
+			else
 			{
-				if (s[pos] == 0)
+				if (i1 > 0)
 				{
-					if (convert_skin)
-						s[pos] = 256;
-					convert_skin = false;
+					results[pos] = 256.0f;
+					i1--;
 				}
-				else
-					convert_skin = true;
-
-				pos += m_Width;
 			}
+			pos += w;
+		}
+	}
 
-			pos = m_Width * (m_Height - 1) + x;
-			while (pos > m_Width)
+	for (x = 1; x < m_Width + 1; x++)
+	{
+		pos = w * (m_Height + 1) + x;
+		i1 = 0;
+		while (pos > w)
+		{
+			if (results[pos] == 255.0f)
+				i1 = i4;
+			else
 			{
-				if (s[pos] == 0)
+				if (i1 > 0)
 				{
-					if (convert_skin)
-						s[pos] = 256;
-					convert_skin = false;
+					results[pos] = 256.0f;
+					i1--;
 				}
-				else
-					convert_skin = true;
-
-				pos -= m_Width;
 			}
+			pos -= w;
 		}
 	}
 
-	//go over the std::vector and set the skin pixel at the source pointer
-	i = 0;
-	for (j = 0; j < m_Height; j++)
+	i = m_Width + 3;
+	int i2 = 0;
+	for (int j = 0; j < m_Height; j++)
 	{
 		for (int k = 0; k < m_Width; k++)
 		{
-			if (s[i] == 256)
-				m_WorkBits[i] = setto;
+			if (results[i] == 256.0f &&
+					(!TissueInfos::GetTissueLocked(tissues[i2])))
+				tissues[i2] = setto;
+			//			work_bits[i2]=results[i];
 			i++;
+			i2++;
 		}
+
+		i += 2;
 	}
+
+	free(results);
 }
 
-void Bmphandler::AddSkinOutside(unsigned i4, float setto)
+void Bmphandler::AddSkintissueOutside(tissuelayers_size_t idx, unsigned i4, tissues_size_t setto)
 {
-	unsigned char dummymode1 = m_Mode1;
-	unsigned char dummymode2 = m_Mode2;
 	std::vector<int> s;
 	std::vector<int> s1;
-	float* results =
-			(float*)malloc(sizeof(float) * (m_Area + 2 * m_Width + 2 * m_Height + 4));
+	float* results = (float*)malloc(sizeof(float) * (m_Area + 2 * m_Width + 2 * m_Height + 4));
 
 	int i = m_Width + 3;
 	int i3 = 0;
+	tissues_size_t* tissues = m_Tissuelayers[idx];
 	for (int j = 0; j < m_Height; j++)
 	{
 		for (int k = 0; k < m_Width; k++)
 		{
-			if (m_WorkBits[i3] == 0)
+			if (tissues[i3] == 0)
 				results[i] = -1;
 			else
 			{
@@ -10767,15 +10273,13 @@ void Bmphandler::AddSkinOutside(unsigned i4, float setto)
 		}
 	}
 
-	//hysteretic_growth(results,&s,width+2,height+2,false,255.0f);
-	HystereticGrowth(results, &s, m_Width + 2, m_Height + 2, true, 255.0f);
+	HystereticGrowth(results, &s, m_Width + 2, m_Height + 2, false, 255.0f);
 
 	for (int j = 0; j <= ((int)m_Width + 2) * (m_Height + 2); j++)
 		if (results[j] == 255.0f)
 			results[j] = -1;
 
-	//hysteretic_growth(results,&s1,width+2,height+2,false,255.0f,i4);
-	HystereticGrowth(results, &s1, m_Width + 2, m_Height + 2, true, 255.0f, i4);
+	HystereticGrowth(results, &s1, m_Width + 2, m_Height + 2, false, 255.0f, i4);
 
 	i = m_Width + 3;
 	int i2 = 0;
@@ -10784,8 +10288,7 @@ void Bmphandler::AddSkinOutside(unsigned i4, float setto)
 		for (int k = 0; k < m_Width; k++)
 		{
 			if (results[i] == 255.0f)
-				m_WorkBits[i2] = setto;
-			//			work_bits[i2]=results[i];
+				tissues[i2] = setto;
 			i++;
 			i2++;
 		}
@@ -10793,187 +10296,273 @@ void Bmphandler::AddSkinOutside(unsigned i4, float setto)
 		i += 2;
 	}
 
-	m_Mode1 = dummymode1;
-	m_Mode2 = dummymode2;
-
 	free(results);
 }
 
-void Bmphandler::AddSkintissue(tissuelayers_size_t idx, unsigned i4, tissues_size_t setto)
+bool Bmphandler::ValueAtBoundary(float value)
 {
-	std::vector<int> s;
-	float* results = (float*)malloc(sizeof(float) * (m_Area + 2 * m_Width + 2 * m_Height + 4));
+	// Top
+	float* tmp = &m_WorkBits[0];
+	for (unsigned pos = 0; pos < m_Width; pos++, tmp++)
+	{
+		if (*tmp == value)
+			return true;
+	}
 
-	int i = m_Width + 3;
-	int i3 = 0;
-	tissues_size_t* tissues = m_Tissuelayers[idx];
-	for (int j = 0; j < m_Height; j++)
+	// Left & right
+	for (unsigned pos = 1; pos < (m_Height - 1); pos++)
 	{
-		for (int k = 0; k < m_Width; k++)
-		{
-			if (tissues[i3] == 0)
-				results[i] = -1;
-			else
-				results[i] = 0;
-			i++;
-			i3++;
-		}
+		if (m_WorkBits[pos * m_Width] == value)
+			return true;
+		else if (m_WorkBits[(pos + 1) * m_Width - 1] == value)
+			return true;
+	}
 
-		i += 2;
+	// Bottom
+	tmp = &m_WorkBits[(m_Height - 1) * m_Width];
+	for (unsigned pos = 0; pos < m_Width; pos++, tmp++)
+	{
+		if (*tmp == value)
+			return true;
 	}
+	return false;
+}
 
-	for (int j = 0; j < m_Width + 2; j++)
-		results[j] = results[j + ((unsigned)m_Width + 2) * (m_Height + 1)] = 0;
-	for (int j = 0; j <= ((int)m_Width + 2) * (m_Height + 1); j += m_Width + 2)
-		results[j] = results[j + m_Width + 1] = 0;
+bool Bmphandler::TissuevalueAtBoundary(tissuelayers_size_t idx, tissues_size_t value)
+{
+	// Top
+	tissues_size_t* tissues = m_Tissuelayers[idx];
+	tissues_size_t* tmp = &(tissues[0]);
+	for (unsigned pos = 0; pos < m_Width; pos++, tmp++)
+	{
+		if (*tmp == value)
+			return true;
+	}
 
-	for (int j = m_Width + 3; j < 2 * m_Width + 3; j++)
+	// Left & right
+	for (unsigned pos = 1; pos < (m_Height - 1); pos++)
 	{
-		if (results[j] == -1)
-		{
-			results[j] = 255.0f;
-			s.push_back(j);
-		}
+		if (tissues[pos * m_Width] == value)
+			return true;
+		else if (tissues[(pos + 1) * m_Width - 1] == value)
+			return true;
 	}
-	for (unsigned int j = m_Area + 2 * m_Height + 1;
-			 j < m_Area + m_Width + 2 * m_Height + 1; j++)
+
+	// Bottom
+	tmp = &(tissues[(m_Height - 1) * m_Width]);
+	for (unsigned pos = 0; pos < m_Width; pos++, tmp++)
 	{
-		if (results[j] == -1)
-		{
-			results[j] = 255.0f;
-			s.push_back(j);
-		}
+		if (*tmp == value)
+			return true;
 	}
-	for (unsigned int j = 2 * m_Width + 5; j <= m_Area + 2 * m_Height + 1;
-			 j += m_Width + 2)
+	return false;
+}
+
+float Bmphandler::AddSkin(unsigned i)
+{
+	Pair p;
+	GetRange(&p);
+	float setto;
+	if (p.high <= 254.0f)
+		setto = 255.0f;
+	else if (p.low >= 1.0f)
+		setto = 0.0f;
+	else
 	{
-		if (results[j] == -1)
+		setto = p.low;
+		for (unsigned pos = 0; pos < m_Area; pos++)
 		{
-			results[j] = 255.0f;
-			s.push_back(j);
+			if (m_WorkBits[pos] != p.high)
+				setto = std::max(setto, m_WorkBits[pos]);
 		}
+		setto = (setto + p.high) / 2;
 	}
-	for (unsigned int j = 3 * m_Width + 4; j <= m_Area + m_Width + 2 * m_Height;
-			 j += m_Width + 2)
+
+	AddSkin(i, setto);
+	return setto;
+}
+
+float Bmphandler::AddSkinOutside(unsigned i)
+{
+	Pair p;
+	GetRange(&p);
+	float setto;
+	if (p.high <= 254.0f)
+		setto = 255.0f;
+	else if (p.low >= 1.0f)
+		setto = 0.0f;
+	else
 	{
-		if (results[j] == -1)
+		setto = p.low;
+		for (unsigned pos = 0; pos < m_Area; pos++)
 		{
-			results[j] = 255.0f;
-			s.push_back(j);
+			if (m_WorkBits[pos] != p.high)
+				setto = std::max(setto, m_WorkBits[pos]);
 		}
+		setto = (setto + p.high) / 2;
 	}
 
-	HystereticGrowth(results, &s, m_Width + 2, m_Height + 2, false, 255.0f);
+	AddSkinOutside(i, setto);
+	return setto;
+}
 
-	unsigned short x, y;
-	unsigned pos;
-	unsigned i1;
-	unsigned w = (unsigned)(m_Width + 2);
+void Bmphandler::FillSkin(int thicknessX, int thicknessY, tissues_size_t backgroundID, tissues_size_t skinID)
+{
+	if (m_Tissuelayers.empty() || thicknessX <= 0)
+		return;
 
-	for (y = 1; y < m_Height + 1; y++)
-	{
-		pos = y * w;
-		i1 = 0;
-		while (pos < (y + 1) * w)
+	//BL recommendation
+	int skin_thick = thicknessX;
+	double max_d = skin_thick == 1 ? 1.5 * skin_thick : 1.2 * skin_thick;
+
+	tissues_size_t* tissues = m_Tissuelayers[0];
+
+	// distance to the other tissues, in units of the x-thickness
+	std::vector<unsigned char> other(m_Area);
+	for (unsigned i = 0; i < m_Area; i++)
+		other[i] = (tissues[i] != backgroundID && tissues[i] != skinID);
+
+	std::vector<float> sqdist(m_Area);
+	DistanceTransform edt({m_Width, m_Height, 1}, {1.f, float(skin_thick) / std::max(thicknessY, 1), 1.f});
+	edt.SquaredDistance(other.data(), sqdist.data());
+	float const max_d2 = static_cast<float>(max_d * max_d);
+
+	bool preview_way = true;
+
+	if (preview_way)
+	{
+		float* bmp1 = this->ReturnBmp();
+
+		tissues_size_t* tissue1 = this->ReturnTissues(0);
+		this->PushstackBmp();
+
+		for (unsigned int i = 0; i < m_Area; i++)
 		{
-			if (results[pos] == 255.0f)
-				i1 = i4;
+			bmp1[i] = (float)tissue1[i];
+		}
+		this->DeadReckoning((float)0);
+		bmp1 = this->ReturnWork();
+
+		for (unsigned pos = 0; pos < m_Area; pos++)
+		{
+			if (tissues[pos] == backgroundID && sqdist[pos] < max_d2)
+				m_WorkBits[pos] = 255.0f;
+		}
+		for (unsigned i = 0; i < m_Area; i++)
+		{
+			if (bmp1[i] < 0)
+				bmp1[i] = 0;
 			else
-			{
-				if (i1 > 0)
-				{
-					results[pos] = 256.0f;
-					i1--;
-				}
-			}
-			pos++;
+				bmp1[i] = 255.0f;
 		}
+
+		this->SetMode(2, false);
+		this->PopstackBmp();
 	}
 
-	for (y = 1; y < m_Height + 1; y++)
+	else
 	{
-		pos = (y + 1) * w - 1;
-		i1 = 0;
-		while (pos > y * w)
+		for (unsigned pos = 0; pos < m_Area; pos++)
 		{
-			if (results[pos] == 255.0f)
-				i1 = i4;
-			else
-			{
-				if (i1 > 0)
-				{
-					results[pos] = 256.0f;
-					i1--;
-				}
-			}
-			pos--;
+			if (tissues[pos] == backgroundID && sqdist[pos] < max_d2)
+				tissues[pos] = skinID;
 		}
 	}
+}
 
-	for (x = 1; x < m_Width + 1; x++)
+void Bmphandler::FloodExterior(float setto)
+{
+	unsigned char dummymode1 = m_Mode1;
+	unsigned char dummymode2 = m_Mode2;
+	std::vector<int> s;
+	float* results = (float*)malloc(sizeof(float) * (m_Area + 2 * m_Width + 2 * m_Height + 4));
+
+	int i = m_Width + 3;
+	int i3 = 0;
+	for (int j = 0; j < m_Height; j++)
 	{
-		pos = x;
-		i1 = 0;
-		while (pos < (m_Height + 1) * w)
+		for (int k = 0; k < m_Width; k++)
 		{
-			if (results[pos] == 255.0f)
-				i1 = i4;
+			if (m_WorkBits[i3] == 0)
+				results[i] = -1;
 			else
-			{
-				if (i1 > 0)
-				{
-					results[pos] = 256.0f;
-					i1--;
-				}
-			}
-			pos += w;
+				results[i] = 0;
+			i++;
+			i3++;
 		}
+
+		i += 2;
 	}
 
-	for (x = 1; x < m_Width + 1; x++)
+	for (int j = 0; j < m_Width + 2; j++)
+		results[j] = results[j + ((unsigned)m_Width + 2) * (m_Height + 1)] = 0;
+	for (int j = 0; j <= ((int)m_Width + 2) * (m_Height + 1); j += m_Width + 2)
+		results[j] = results[j + m_Width + 1] = 0;
+
+	for (int j = m_Width + 3; j < 2 * m_Width + 3; j++)
 	{
-		pos = w * (m_Height + 1) + x;
-		i1 = 0;
-		while (pos > w)
+		if (results[j] == -1)
 		{
-			if (results[pos] == 255.0f)
-				i1 = i4;
-			else
-			{
-				if (i1 > 0)
-				{
-					results[pos] = 256.0f;
-					i1--;
-				}
-			}
-			pos -= w;
+			results[j] = 255.0f;
+			s.push_back(j);
+		}
+	}
+	for (unsigned int j = m_Area + 2 * m_Height + 1;
+			 j < m_Area + m_Width + 2 * m_Height + 1; j++)
+	{
+		if (results[j] == -1)
+		{
+			results[j] = 255.0f;
+			s.push_back(j);
+		}
+	}
+	for (unsigned int j = 2 * m_Width + 5; j <= m_Area + 2 * m_Height + 1;
+			 j += m_Width + 2)
+	{
+		if (results[j] == -1)
+		{
+			results[j] = 255.0f;
+			s.push_back(j);
+		}
+	}
+	for (unsigned int j = 3 * m_Width + 4; j <= m_Area + m_Width + 2 * m_Height;
+			 j += m_Width + 2)
+	{
+		if (results[j] == -1)
+		{
+			results[j] = 255.0f;
+			s.push_back(j);
 		}
 	}
 
+	HystereticGrowth(results, &s, m_Width + 2, m_Height + 2, false, 255.0f);
+
 	i = m_Width + 3;
-	int i2 = 0;
+	i3 = 0;
 	for (int j = 0; j < m_Height; j++)
 	{
 		for (int k = 0; k < m_Width; k++)
 		{
-			if (results[i] == 256.0f &&
-					(!TissueInfos::GetTissueLocked(tissues[i2])))
-				tissues[i2] = setto;
-			//			work_bits[i2]=results[i];
+			if (results[i] == 255.0f)
+				m_WorkBits[i3] = setto;
 			i++;
-			i2++;
+			i3++;
 		}
 
 		i += 2;
 	}
 
+	m_Mode1 = dummymode1;
+	m_Mode2 = dummymode2;
+
 	free(results);
 }
 
-void Bmphandler::AddSkintissueOutside(tissuelayers_size_t idx, unsigned i4, tissues_size_t setto)
+void Bmphandler::FloodExteriortissue(tissuelayers_size_t idx, tissues_size_t setto)
 {
+	unsigned char dummymode1 = m_Mode1;
+	unsigned char dummymode2 = m_Mode2;
 	std::vector<int> s;
-	std::vector<int> s1;
 	float* results = (float*)malloc(sizeof(float) * (m_Area + 2 * m_Width + 2 * m_Height + 4));
 
 	int i = m_Width + 3;
@@ -10986,10 +10575,7 @@ void Bmphandler::AddSkintissueOutside(tissuelayers_size_t idx, unsigned i4, tiss
 			if (tissues[i3] == 0)
 				results[i] = -1;
 			else
-			{
 				results[i] = 0;
-				s1.push_back(i);
-			}
 			i++;
 			i3++;
 		}
@@ -11040,90 +10626,28 @@ void Bmphandler::AddSkintissueOutside(tissuelayers_size_t idx, unsigned i4, tiss
 
 	HystereticGrowth(results, &s, m_Width + 2, m_Height + 2, false, 255.0f);
 
-	for (int j = 0; j <= ((int)m_Width + 2) * (m_Height + 2); j++)
-		if (results[j] == 255.0f)
-			results[j] = -1;
-
-	HystereticGrowth(results, &s1, m_Width + 2, m_Height + 2, false, 255.0f, i4);
-
 	i = m_Width + 3;
-	int i2 = 0;
+	i3 = 0;
 	for (int j = 0; j < m_Height; j++)
 	{
 		for (int k = 0; k < m_Width; k++)
 		{
 			if (results[i] == 255.0f)
-				tissues[i2] = setto;
+				tissues[i3] = setto;
 			i++;
-			i2++;
+			i3++;
 		}
 
 		i += 2;
 	}
 
-	free(results);
-}
-
-bool Bmphandler::ValueAtBoundary(float value)
-{
-	// Top
-	float* tmp = &m_WorkBits[0];
-	for (unsigned pos = 0; pos < m_Width; pos++, tmp++)
-	{
-		if (*tmp == value)
-			return true;
-	}
-
-	// Left & right
-	for (unsigned pos = 1; pos < (m_Height - 1); pos++)
-	{
-		if (m_WorkBits[pos * m_Width] == value)
-			return true;
-		else if (m_WorkBits[(pos + 1) * m_Width - 1] == value)
-			return true;
-	}
-
-	// Bottom
-	tmp = &m_WorkBits[(m_Height - 1) * m_Width];
-	for (unsigned pos = 0; pos < m_Width; pos++, tmp++)
-	{
-		if (*tmp == value)
-			return true;
-	}
-	return false;
-}
-
-bool Bmphandler::TissuevalueAtBoundary(tissuelayers_size_t idx, tissues_size_t value)
-{
-	// Top
-	tissues_size_t* tissues = m_Tissuelayers[idx];
-	tissues_size_t* tmp = &(tissues[0]);
-	for (unsigned pos = 0; pos < m_Width; pos++, tmp++)
-	{
-		if (*tmp == value)
-			return true;
-	}
-
-	// Left & right
-	for (unsigned pos = 1; pos < (m_Height - 1); pos++)
-	{
-		if (tissues[pos * m_Width] == value)
-			return true;
-		else if (tissues[(pos + 1) * m_Width - 1] == value)
-			return true;
-	}
+	m_Mode1 = dummymode1;
+	m_Mode2 = dummymode2;
 
-	// Bottom
-	tmp = &(tissues[(m_Height - 1) * m_Width]);
-	for (unsigned pos = 0; pos < m_Width; pos++, tmp++)
-	{
-		if (*tmp == value)
-			return true;
-	}
-	return false;
+	free(results);
 }
 
-float Bmphandler::AddSkin(unsigned i)
+void Bmphandler::FillUnassigned()
 {
 	Pair p;
 	GetRange(&p);
@@ -11143,160 +10667,11 @@ float Bmphandler::AddSkin(unsigned i)
 		setto = (setto + p.high) / 2;
 	}
 
-	AddSkin(i, setto);
-	return setto;
+	FillUnassigned(setto);
 }
 
-float Bmphandler::AddSkinOutside(unsigned i)
+void Bmphandler::FillUnassigned(float setto)
 {
-	Pair p;
-	GetRange(&p);
-	float setto;
-	if (p.high <= 254.0f)
-		setto = 255.0f;
-	else if (p.low >= 1.0f)
-		setto = 0.0f;
-	else
-	{
-		setto = p.low;
-		for (unsigned pos = 0; pos < m_Area; pos++)
-		{
-			if (m_WorkBits[pos] != p.high)
-				setto = std::max(setto, m_WorkBits[pos]);
-		}
-		setto = (setto + p.high) / 2;
-	}
-
-	AddSkinOutside(i, setto);
-	return setto;
-}
-
-void Bmphandler::FillSkin(int thicknessX, int thicknessY, tissues_size_t backgroundID, tissues_size_t skinID)
-{
-	//BL recommendation
-	int skin_thick = thicknessX;
-
-	std::vector<int> dims;
-	dims.push_back(m_Width);
-	dims.push_back(m_Height);
-
-	//int backgroundID = (bmp_bits[0]==bmp_bits[area-1]) ? bmp_bits[0] : 0;
-
-	double max_d = skin_thick == 1 ? 1.5 * skin_thick : 1.2 * skin_thick;
-	std::vector<int> offsets;
-
-	//Create the relative neighborhood
-	for (int j = -skin_thick; j <= skin_thick; j++)
-	{
-		for (int i = -skin_thick; i <= skin_thick; i++)
-		{
-			if (sqrt(i * i + j * j) < max_d)
-			{
-				int shift = i + j * dims[0];
-				if (shift != 0)
-				{
-					offsets.push_back(shift);
-				}
-			}
-		}
-	}
-
-	tissues_size_t* tissues;
-	if (!m_Tissuelayers.empty())
-		tissues = m_Tissuelayers[0];
-
-	bool preview_way = true;
-
-	if (preview_way)
-	{
-		float* bmp1 = this->ReturnBmp();
-
-		tissues_size_t* tissue1 = this->ReturnTissues(0);
-		this->PushstackBmp();
-
-		for (unsigned int i = 0; i < m_Area; i++)
-		{
-			bmp1[i] = (float)tissue1[i];
-		}
-		this->DeadReckoning((float)0);
-		bmp1 = this->ReturnWork();
-
-		for (int j = skin_thick; j + skin_thick < dims[1]; j++)
-		{
-			for (int i = skin_thick; i + skin_thick < dims[0]; i++)
-			{
-				int pos = i + j * dims[0];
-				if (tissues[pos] == backgroundID)
-				{
-					//iterate through neighbors of pixel
-					//if any of these are not
-					for (int l = 0; l < offsets.size(); l++)
-					{
-						int idx = pos + offsets[l];
-						assert(idx >= 0 && idx < m_Area);
-						/*
-						if( tissues[idx] != backgroundID && 
-							tissues[idx] != skinID )
-						{
-							if( tissues[idx] != backgroundID && 
-								tissues[idx] != skinID )
-								work_bits[pos]=255.0f;
-							else
-								work_bits[pos]=0.0f;
-						}
-						*/
-						if (tissues[idx] != backgroundID &&
-								tissues[idx] != skinID)
-							m_WorkBits[pos] = 255.0f;
-					}
-				}
-			}
-		}
-		for (unsigned i = 0; i < m_Area; i++)
-		{
-			if (bmp1[i] < 0)
-				bmp1[i] = 0;
-			else
-				bmp1[i] = 255.0f;
-		}
-
-		this->SetMode(2, false);
-		this->PopstackBmp();
-	}
-
-	else
-	{
-		for (int j = skin_thick; j + skin_thick < dims[1]; j++)
-		{
-			for (int i = skin_thick; i + skin_thick < dims[0]; i++)
-			{
-				int pos = i + j * dims[0];
-				if (tissues[pos] == backgroundID)
-				{
-					//iterate through neighbors of pixel
-					//if any of these are not
-					for (int l = 0; l < offsets.size(); l++)
-					{
-						int idx = pos + offsets[l];
-						assert(idx >= 0 && idx < m_Area);
-
-						if (tissues[idx] != backgroundID &&
-								tissues[idx] != skinID)
-						{
-							tissues[pos] = skinID;
-							break;
-						}
-					}
-				}
-			}
-		}
-	}
-}
-
-void Bmphandler::FloodExterior(float setto)
-{
-	unsigned char dummymode1 = m_Mode1;
-	unsigned char dummymode2 = m_Mode2;
 	std::vector<int> s;
 	float* results = (float*)malloc(sizeof(float) * (m_Area + 2 * m_Width + 2 * m_Height + 4));
 
@@ -11360,33 +10735,29 @@ void Bmphandler::FloodExterior(float setto)
 
 	HystereticGrowth(results, &s, m_Width + 2, m_Height + 2, false, 255.0f);
 
-	i = m_Width + 3;
-	i3 = 0;
-	for (int j = 0; j < m_Height; j++)
+	unsigned pos = m_Width + 3;
+	unsigned long pos1 = 0;
+
+	for (unsigned short py = 0; py < m_Height; py++)
 	{
-		for (int k = 0; k < m_Width; k++)
+		for (unsigned short px = 0; px < m_Width; px++)
 		{
-			if (results[i] == 255.0f)
-				m_WorkBits[i3] = setto;
-			i++;
-			i3++;
+			if (results[pos] != 255.0f && m_WorkBits[pos1] == 0)
+				m_WorkBits[pos1] = setto;
+			pos++;
+			pos1++;
 		}
-
-		i += 2;
+		pos += 2;
 	}
 
-	m_Mode1 = dummymode1;
-	m_Mode2 = dummymode2;
-
 	free(results);
 }
 
-void Bmphandler::FloodExteriortissue(tissuelayers_size_t idx, tissues_size_t setto)
+void Bmphandler::FillUnassignedtissue(tissuelayers_size_t idx, tissues_size_t setto)
 {
-	unsigned char dummymode1 = m_Mode1;
-	unsigned char dummymode2 = m_Mode2;
 	std::vector<int> s;
-	float* results = (float*)malloc(sizeof(float) * (m_Area + 2 * m_Width + 2 * m_Height + 4));
+	float* results =
+			(float*)malloc(sizeof(float) * (m_Area + 2 * m_Width + 2 * m_Height + 4));
 
 	int i = m_Width + 3;
 	int i3 = 0;
@@ -11449,266 +10820,72 @@ void Bmphandler::FloodExteriortissue(tissuelayers_size_t idx, tissues_size_t set
 
 	HystereticGrowth(results, &s, m_Width + 2, m_Height + 2, false, 255.0f);
 
-	i = m_Width + 3;
-	i3 = 0;
-	for (int j = 0; j < m_Height; j++)
+	unsigned pos = m_Width + 3;
+	unsigned long pos1 = 0;
+
+	for (unsigned short py = 0; py < m_Height; py++)
 	{
-		for (int k = 0; k < m_Width; k++)
+		for (unsigned short px = 0; px < m_Width; px++)
 		{
-			if (results[i] == 255.0f)
-				tissues[i3] = setto;
-			i++;
-			i3++;
+			if (results[pos] != 255.0f && tissues[pos1] == 0)
+				tissues[pos1] = setto;
+			pos++;
+			pos1++;
 		}
-
-		i += 2;
+		pos += 2;
 	}
 
-	m_Mode1 = dummymode1;
-	m_Mode2 = dummymode2;
-
 	free(results);
 }
 
-void Bmphandler::FillUnassigned()
+void Bmphandler::AdaptiveFuzzy(Point p, float m1, float s1, float s2, float /* thresh */)
 {
-	Pair p;
-	GetRange(&p);
-	float setto;
-	if (p.high <= 254.0f)
-		setto = 255.0f;
-	else if (p.low >= 1.0f)
-		setto = 0.0f;
-	else
+	ImageForestingTransformAdaptFuzzy af;
+	af.FuzzyInit(m_Width, m_Height, m_BmpBits, p, m1, s1, s2);
+	float* pf = af.ReturnPf();
+	for (unsigned i = 0; i < m_Area; i++)
 	{
-		setto = p.low;
-		for (unsigned pos = 0; pos < m_Area; pos++)
-		{
-			if (m_WorkBits[pos] != p.high)
-				setto = std::max(setto, m_WorkBits[pos]);
-		}
-		setto = (setto + p.high) / 2;
+		/*		if(pf[i]<1-thresh) work_bits[i]=255;
+		else work_bits[i]=0;*/
+		m_WorkBits[i] = pf[i] * 255;
 	}
-
-	FillUnassigned(setto);
+	m_Mode2 = 1;
 }
 
-void Bmphandler::FillUnassigned(float setto)
+void Bmphandler::FastMarching(Point p, float sigma, float thresh)
 {
-	std::vector<int> s;
-	float* results = (float*)malloc(sizeof(float) * (m_Area + 2 * m_Width + 2 * m_Height + 4));
-
-	int i = m_Width + 3;
-	int i3 = 0;
-	for (int j = 0; j < m_Height; j++)
-	{
-		for (int k = 0; k < m_Width; k++)
-		{
-			if (m_WorkBits[i3] == 0)
-				results[i] = -1;
-			else
-				results[i] = 0;
-			i++;
-			i3++;
-		}
-
-		i += 2;
-	}
+	unsigned char dummymode = m_Mode1;
+	ImageForestingTransformFastMarching fm;
 
-	for (int j = 0; j < m_Width + 2; j++)
-		results[j] = results[j + ((unsigned)m_Width + 2) * (m_Height + 1)] = 0;
-	for (int j = 0; j <= ((int)m_Width + 2) * (m_Height + 1); j += m_Width + 2)
-		results[j] = results[j + m_Width + 1] = 0;
+	float* dummy;
+	float* lbl = m_Sliceprovide->GiveMe();
+	Gaussian(sigma);
+	dummy = lbl;
+	lbl = m_BmpBits;
+	m_BmpBits = dummy;
+	SwapBmpwork();
+	Sobel();
+	dummy = lbl;
+	lbl = m_BmpBits;
+	m_BmpBits = dummy;
 
-	for (int j = m_Width + 3; j < 2 * m_Width + 3; j++)
-	{
-		if (results[j] == -1)
-		{
-			results[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = m_Area + 2 * m_Height + 1;
-			 j < m_Area + m_Width + 2 * m_Height + 1; j++)
-	{
-		if (results[j] == -1)
-		{
-			results[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = 2 * m_Width + 5; j <= m_Area + 2 * m_Height + 1;
-			 j += m_Width + 2)
+	for (unsigned i = 0; i < m_Area; i++)
 	{
-		if (results[j] == -1)
-		{
-			results[j] = 255.0f;
-			s.push_back(j);
-		}
+		m_WorkBits[i] = exp(-m_WorkBits[i] / thresh);
+		lbl[i] = 0;
 	}
-	for (unsigned int j = 3 * m_Width + 4; j <= m_Area + m_Width + 2 * m_Height;
-			 j += m_Width + 2)
+	lbl[Pt2coord(p)] = 1;
+
+	fm.FastmarchInit(m_Width, m_Height, m_WorkBits, lbl);
+	float* pf = fm.ReturnPf();
+	for (unsigned i = 0; i < m_Area; i++)
 	{
-		if (results[j] == -1)
-		{
-			results[j] = 255.0f;
-			s.push_back(j);
-		}
+		m_WorkBits[i] = pf[i];
 	}
-
-	HystereticGrowth(results, &s, m_Width + 2, m_Height + 2, false, 255.0f);
-
-	unsigned pos = m_Width + 3;
-	unsigned long pos1 = 0;
-
-	for (unsigned short py = 0; py < m_Height; py++)
-	{
-		for (unsigned short px = 0; px < m_Width; px++)
-		{
-			if (results[pos] != 255.0f && m_WorkBits[pos1] == 0)
-				m_WorkBits[pos1] = setto;
-			pos++;
-			pos1++;
-		}
-		pos += 2;
-	}
-
-	free(results);
-}
-
-void Bmphandler::FillUnassignedtissue(tissuelayers_size_t idx, tissues_size_t setto)
-{
-	std::vector<int> s;
-	float* results =
-			(float*)malloc(sizeof(float) * (m_Area + 2 * m_Width + 2 * m_Height + 4));
-
-	int i = m_Width + 3;
-	int i3 = 0;
-	tissues_size_t* tissues = m_Tissuelayers[idx];
-	for (int j = 0; j < m_Height; j++)
-	{
-		for (int k = 0; k < m_Width; k++)
-		{
-			if (tissues[i3] == 0)
-				results[i] = -1;
-			else
-				results[i] = 0;
-			i++;
-			i3++;
-		}
-
-		i += 2;
-	}
-
-	for (int j = 0; j < m_Width + 2; j++)
-		results[j] = results[j + ((unsigned)m_Width + 2) * (m_Height + 1)] = 0;
-	for (int j = 0; j <= ((int)m_Width + 2) * (m_Height + 1); j += m_Width + 2)
-		results[j] = results[j + m_Width + 1] = 0;
-
-	for (int j = m_Width + 3; j < 2 * m_Width + 3; j++)
-	{
-		if (results[j] == -1)
-		{
-			results[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = m_Area + 2 * m_Height + 1;
-			 j < m_Area + m_Width + 2 * m_Height + 1; j++)
-	{
-		if (results[j] == -1)
-		{
-			results[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = 2 * m_Width + 5; j <= m_Area + 2 * m_Height + 1;
-			 j += m_Width + 2)
-	{
-		if (results[j] == -1)
-		{
-			results[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = 3 * m_Width + 4; j <= m_Area + m_Width + 2 * m_Height;
-			 j += m_Width + 2)
-	{
-		if (results[j] == -1)
-		{
-			results[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-
-	HystereticGrowth(results, &s, m_Width + 2, m_Height + 2, false, 255.0f);
-
-	unsigned pos = m_Width + 3;
-	unsigned long pos1 = 0;
-
-	for (unsigned short py = 0; py < m_Height; py++)
-	{
-		for (unsigned short px = 0; px < m_Width; px++)
-		{
-			if (results[pos] != 255.0f && tissues[pos1] == 0)
-				tissues[pos1] = setto;
-			pos++;
-			pos1++;
-		}
-		pos += 2;
-	}
-
-	free(results);
-}
-
-void Bmphandler::AdaptiveFuzzy(Point p, float m1, float s1, float s2, float /* thresh */)
-{
-	ImageForestingTransformAdaptFuzzy af;
-	af.FuzzyInit(m_Width, m_Height, m_BmpBits, p, m1, s1, s2);
-	float* pf = af.ReturnPf();
-	for (unsigned i = 0; i < m_Area; i++)
-	{
-		/*		if(pf[i]<1-thresh) work_bits[i]=255;
-		else work_bits[i]=0;*/
-		m_WorkBits[i] = pf[i] * 255;
-	}
-	m_Mode2 = 1;
-}
-
-void Bmphandler::FastMarching(Point p, float sigma, float thresh)
-{
-	unsigned char dummymode = m_Mode1;
-	ImageForestingTransformFastMarching fm;
-
-	float* dummy;
-	float* lbl = m_Sliceprovide->GiveMe();
-	Gaussian(sigma);
-	dummy = lbl;
-	lbl = m_BmpBits;
-	m_BmpBits = dummy;
-	SwapBmpwork();
-	Sobel();
-	dummy = lbl;
-	lbl = m_BmpBits;
-	m_BmpBits = dummy;
-
-	for (unsigned i = 0; i < m_Area; i++)
-	{
-		m_WorkBits[i] = exp(-m_WorkBits[i] / thresh);
-		lbl[i] = 0;
-	}
-	lbl[Pt2coord(p)] = 1;
-
-	fm.FastmarchInit(m_Width, m_Height, m_WorkBits, lbl);
-	float* pf = fm.ReturnPf();
-	for (unsigned i = 0; i < m_Area; i++)
-	{
-		m_WorkBits[i] = pf[i];
-	}
-	Pair p1;
-	GetRange(&p1);
-	//	cout << p1.high << " " << p1.low << endl;
-	//	scale_colors(p1);
+	Pair p1;
+	GetRange(&p1);
+	//	cout << p1.high << " " << p1.low << endl;
+	//	scale_colors(p1);
 
 	m_Sliceprovide->TakeBack(lbl);
 
@@ -11930,9 +11107,7 @@ void Bmphandler::KmeansPng(short nrtissues, short dim, std::vector<std::string>
 		}
 		else
 		{
-			QMessageBox msg_box;
-			msg_box.setText("ERROR: reading centers initialization file.");
-			msg_box.exec();
+			ISEG_ERROR("reading centers initialization file " << initCentersFile);
 			return;
 		}
 	}
@@ -13884,1083 +13059,22 @@ void Bmphandler::Brushtissue(tissuelayers_size_t idx, tissues_size_t f, Point p,
 
 void Bmphandler::FillHoles(float f, int minsize)
 {
-	std::vector<std::vector<Point>> inner_line;
-	minsize = 2 * minsize;
-	float bubble_size;
-	float linelength;
-	short directionchange;
-
-	float* tmp_bits =
-			(float*)malloc(sizeof(float) * (m_Width + 2) * (m_Height + 2));
-	bool* visited = (bool*)malloc(sizeof(bool) * (m_Width + 2) * (m_Height + 2));
-	for (unsigned i = 0; i < unsigned(m_Width + 2) * (m_Height + 2); i++)
-		visited[i] = false;
-
-	unsigned pos = m_Width + 3;
-	unsigned pos1 = 0;
-	unsigned pos2;
-	unsigned possecond;
-	bool done;
-	short inner;									 //1 for outer, 7 for inner border
-	short direction, directionold; // 0:rechts, 1:rechts oben, 2:oben, ... 7:rechts unten.
-	Point p;
-
-	std::vector<Point> vec_pt;
-	int offset[8] = {1, m_Width + 3, m_Width + 2, m_Width + 1, -1, -m_Width - 3, -m_Width - 2, -m_Width - 1};
-	float dy[8] = {0, 1, 1, 1, 0, -1, -1, -1};
-	float dx[8] = {1, 1, 0, -1, -1, -1, 0, 1};
-	float bordervolume[8] = {1, 0.75f, 0.5f, 0.25f, 2, 1.75f, 1.5f, 1.25f};
-
-	for (unsigned i = 0; i < m_Height; i++)
-	{
-		for (unsigned j = 0; j < m_Width; j++)
-		{
-			tmp_bits[pos] = m_WorkBits[pos1];
-			pos++;
-			pos1++;
-		}
-		pos += 2;
-	}
-
-	for (unsigned i = 0; i < unsigned(m_Width + 2); i++)
-		tmp_bits[i] = unvisited;
-	for (unsigned i = unsigned(m_Width + 2) * (m_Height + 1);
-			 i < unsigned(m_Width + 2) * (m_Height + 2); i++)
-		tmp_bits[i] = unvisited;
-	for (unsigned i = 0; i < unsigned(m_Width + 2) * (m_Height + 2);
-			 i += (m_Width + 2))
-		tmp_bits[i] = unvisited;
-	for (unsigned i = m_Width + 1; i < unsigned(m_Width + 2) * (m_Height + 2);
-			 i += (m_Width + 2))
-		tmp_bits[i] = unvisited;
-
-	pos = m_Width + 2;
-	while (pos < unsigned(m_Width + 2) * (m_Height + 1))
-	{
-		while ((tmp_bits[pos] != f || tmp_bits[pos - 1] == f || visited[pos]) &&
-					 pos < unsigned(m_Width + 2) * (m_Height + 1))
-			pos++;
-
-		if (pos < unsigned(m_Width + 2) * (m_Height + 1))
-		{
-			pos1 = pos;
-			vec_pt.clear();
-			p.px = short(pos % (m_Width + 2) - 1);
-			p.py = short(pos / (m_Width + 2) - 1);
-			//			vec_pt.push_back(p);
+	FillSmallHoles(m_WorkBits, m_Width, m_Height, f, minsize);
+}
 
-			if (tmp_bits[pos + 1] != f && tmp_bits[pos + m_Width + 3] != f &&
-					tmp_bits[pos + m_Width + 2] != f &&
-					tmp_bits[pos + m_Width + 1] != f &&
-					tmp_bits[pos - m_Width - 1] != f &&
-					tmp_bits[pos - m_Width - 2] != f &&
-					tmp_bits[pos - m_Width - 3] != f)
-			{
-				visited[pos] = true;
-			}
-			else
-			{
-				if (tmp_bits[pos - m_Width - 3] == f)
-				{						 // tricky criteria
-					inner = 7; // inner line
-					directionold = direction = 1;
-				}
-				else
-				{
-					inner = 1; // outer line
-					directionold = direction = 7;
-				}
+void Bmphandler::FillHolestissue(tissuelayers_size_t idx, tissues_size_t f, int minsize)
+{
+	FillSmallHoles(m_Tissuelayers[idx], m_Width, m_Height, f, minsize);
+}
 
-				bubble_size = 0;
-				linelength = 0;
-
-				direction = (direction + 5 * inner) % 8;
-				done = false;
-				directionchange = 5 * inner;
-				while (!done)
-				{
-					directionchange += inner;
-					direction = (direction + inner) % 8;
-					pos2 = pos1 + offset[direction];
-					if (tmp_bits[pos2] == f)
-						done = true;
-				}
-
-				possecond = pos2;
-
-				do
-				{
-					vec_pt.push_back(p);
-					if (tmp_bits[pos1 - 1] == f ||
-							(inner == 7 &&
-									!(((direction + 6) % 8 > 2 && directionold > 3 &&
-												(directionchange + 5) % 8 > 2) ||
-											(direction == 5 && directionold == 3))) ||
-							(inner == 1 && !(((direction + 4) % 8 > 2 &&
-																	 (directionold + 7) % 8 < 4 &&
-																	 (directionchange + 5) % 8 > 2) ||
-																 (direction == 3 && directionold == 5)))
-							//					 (inner==1&&!(||(direction==3&&directionold==5)))
-					)
-						visited[pos1] = true;
-					pos1 = pos2;
-					p.px = short(pos1 % (m_Width + 2) - 1);
-					p.py = short(pos1 / (m_Width + 2) - 1);
-					//					vec_pt.push_back(p);
-					bubble_size += dy[direction] * (2 * p.px - dx[direction]);
-					bubble_size -= bordervolume[directionchange % 8];
-					linelength += 2;
-					//					work_bits[p.px+p.py*width]=255;
-					directionold = direction;
-					direction = (direction + 5 * inner) % 8;
-					done = false;
-					directionchange = 5 * inner;
-					while (!done)
-					{
-						directionchange += inner;
-						direction = (direction + inner) % 8;
-						pos2 = pos1 + offset[direction];
-						if (tmp_bits[pos2] == f)
-							done = true;
-					}
-				} while (pos1 != pos || pos2 != possecond); // end do while
-
-				if (inner == 7)
-				{
-					if (bubble_size < (float)minsize)
-						inner_line.push_back(vec_pt);
-				}
-			}
-			pos++;
-		}
-	}
-
-	free(visited);
-
-	std::vector<int> s;
-
-	int i4 = m_Width + 3;
-	int i1 = 0;
-	for (int j = 0; j < m_Height; j++)
-	{
-		for (int k = 0; k < m_Width; k++)
-		{
-			tmp_bits[i4] = -1;
-			i4++;
-			i1++;
-		}
-
-		i4 += 2;
-	}
-
-	for (auto& it1 : inner_line)
-	{
-		for (const Point& it : it1)
-		{
-			tmp_bits[it.px + 1 + (it.py + 1) * (m_Width + 2)] = 1;
-		}
-	}
-
-	for (int j = 0; j < m_Width + 2; j++)
-		tmp_bits[j] = tmp_bits[j + ((unsigned)m_Width + 2) * (m_Height + 1)] = 0;
-	for (int j = 0; j <= ((int)m_Width + 2) * (m_Height + 1); j += m_Width + 2)
-		tmp_bits[j] = tmp_bits[j + m_Width + 1] = 0;
-
-	for (int j = m_Width + 3; j < 2 * m_Width + 3; j++)
-	{
-		if (tmp_bits[j] == -1)
-		{
-			tmp_bits[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = m_Area + 2 * m_Height + 1;
-			 j < m_Area + m_Width + 2 * m_Height + 1; j++)
-	{
-		if (tmp_bits[j] == -1)
-		{
-			tmp_bits[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = 2 * m_Width + 5; j <= m_Area + 2 * m_Height + 1;
-			 j += m_Width + 2)
-	{
-		if (tmp_bits[j] == -1)
-		{
-			tmp_bits[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = 3 * m_Width + 4; j <= m_Area + m_Width + 2 * m_Height;
-			 j += m_Width + 2)
-	{
-		if (tmp_bits[j] == -1)
-		{
-			tmp_bits[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-
-	HystereticGrowth(tmp_bits, &s, m_Width + 2, m_Height + 2, false, 255.0f);
-
-	i4 = m_Width + 3;
-	int i2 = 0;
-	for (int j = 0; j < m_Height; j++)
-	{
-		for (int k = 0; k < m_Width; k++)
-		{
-			if (tmp_bits[i4] == 0)
-				m_WorkBits[i2] = f;
-			//			work_bits[i2]=tmp_bits[i4];
-			i4++;
-			i2++;
-		}
-
-		i4 += 2;
-	}
-
-	free(tmp_bits);
-}
-
-void Bmphandler::FillHolestissue(tissuelayers_size_t idx, tissues_size_t f, int minsize)
-{
-	std::vector<std::vector<Point>> inner_line;
-	minsize = 2 * minsize;
-	float bubble_size;
-	float linelength;
-	short directionchange;
-
-	tissues_size_t* tmp_bits = (tissues_size_t*)malloc(sizeof(tissues_size_t) * (m_Width + 2) * (m_Height + 2));
-	bool* visited = (bool*)malloc(sizeof(bool) * (m_Width + 2) * (m_Height + 2));
-	for (unsigned i = 0; i < unsigned(m_Width + 2) * (m_Height + 2); i++)
-		visited[i] = false;
-
-	unsigned pos = m_Width + 3;
-	unsigned pos1 = 0;
-	unsigned pos2;
-	unsigned possecond;
-	bool done;
-	short inner;									 //1 for outer, 7 for inner border
-	short direction, directionold; // 0:rechts, 1:rechts oben, 2:oben, ... 7:rechts unten.
-	Point p;
-
-	std::vector<Point> vec_pt;
-	int offset[8] = {1, m_Width + 3, m_Width + 2, m_Width + 1, -1, -m_Width - 3, -m_Width - 2, -m_Width - 1};
-	float dy[8] = {0, 1, 1, 1, 0, -1, -1, -1};
-	float dx[8] = {1, 1, 0, -1, -1, -1, 0, 1};
-	float bordervolume[8] = {1, 0.75f, 0.5f, 0.25f, 2, 1.75f, 1.5f, 1.25f};
-
-	tissues_size_t* tissues = m_Tissuelayers[idx];
-	for (unsigned i = 0; i < m_Height; i++)
-	{
-		for (unsigned j = 0; j < m_Width; j++)
-		{
-			tmp_bits[pos] = tissues[pos1];
-			pos++;
-			pos1++;
-		}
-		pos += 2;
-	}
-
-	tissues_size_t unvis = f + 1;
-	if (f == TISSUES_SIZE_MAX)
-		unvis = 0;
-	for (unsigned i = 0; i < unsigned(m_Width + 2); i++)
-		tmp_bits[i] = unvis;
-	for (unsigned i = unsigned(m_Width + 2) * (m_Height + 1);
-			 i < unsigned(m_Width + 2) * (m_Height + 2); i++)
-		tmp_bits[i] = unvis;
-	for (unsigned i = 0; i < unsigned(m_Width + 2) * (m_Height + 2);
-			 i += (m_Width + 2))
-		tmp_bits[i] = unvis;
-	for (unsigned i = m_Width + 1; i < unsigned(m_Width + 2) * (m_Height + 2);
-			 i += (m_Width + 2))
-		tmp_bits[i] = unvis;
-
-	pos = m_Width + 2;
-	while (pos < unsigned(m_Width + 2) * (m_Height + 1))
-	{
-		while ((tmp_bits[pos] != f || tmp_bits[pos - 1] == f || visited[pos]) &&
-					 pos < unsigned(m_Width + 2) * (m_Height + 1))
-			pos++;
-
-		if (pos < unsigned(m_Width + 2) * (m_Height + 1))
-		{
-			pos1 = pos;
-			vec_pt.clear();
-			p.px = short(pos % (m_Width + 2) - 1);
-			p.py = short(pos / (m_Width + 2) - 1);
-			//			vec_pt.push_back(p);
-
-			if (tmp_bits[pos + 1] != f && tmp_bits[pos + m_Width + 3] != f &&
-					tmp_bits[pos + m_Width + 2] != f &&
-					tmp_bits[pos + m_Width + 1] != f &&
-					tmp_bits[pos - m_Width - 1] != f &&
-					tmp_bits[pos - m_Width - 2] != f &&
-					tmp_bits[pos - m_Width - 3] != f)
-			{
-				visited[pos] = true;
-			}
-			else
-			{
-				if (tmp_bits[pos - m_Width - 3] == f)
-				{						 // tricky criteria
-					inner = 7; // inner line
-					directionold = direction = 1;
-				}
-				else
-				{
-					/*					if(tmp_bits[pos-width-2]==f){
-						inner=7; // inner line
-						direction=2;
-					}
-					else{*/
-					inner = 1; // outer line
-					directionold = direction = 7;
-					//					}
-				}
-
-				bubble_size = 0;
-				linelength = 0;
-
-				direction = (direction + 5 * inner) % 8;
-				done = false;
-				directionchange = 5 * inner;
-				while (!done)
-				{
-					directionchange += inner;
-					direction = (direction + inner) % 8;
-					pos2 = pos1 + offset[direction];
-					if (tmp_bits[pos2] == f)
-						done = true;
-				}
-
-				possecond = pos2;
-
-				do
-				{
-					vec_pt.push_back(p);
-					//					if(inner==1)
-					//						bmp_bits[p.px+(unsigned)width*p.py]=255-bmp_bits[p.px+(unsigned)width*p.py];//xxxxxxxxxxxxxxxxxx
-					//					if(direction<5||inner==1||tmp_bits[pos1-1]==f||directionold<4)
-					if (tmp_bits[pos1 - 1] == f ||
-							(inner == 7 &&
-									!(((direction + 6) % 8 > 2 && directionold > 3 &&
-												(directionchange + 5) % 8 > 2) ||
-											(direction == 5 && directionold == 3))) ||
-							(inner == 1 && !(((direction + 4) % 8 > 2 &&
-																	 (directionold + 7) % 8 < 4 &&
-																	 (directionchange + 5) % 8 > 2) ||
-																 (direction == 3 && directionold == 5)))
-							//					 (inner==1&&!(||(direction==3&&directionold==5)))
-					)
-						visited[pos1] = true;
-					pos1 = pos2;
-					p.px = short(pos1 % (m_Width + 2) - 1);
-					p.py = short(pos1 / (m_Width + 2) - 1);
-					//					vec_pt.push_back(p);
-					bubble_size += dy[direction] * (2 * p.px - dx[direction]);
-					bubble_size -= bordervolume[directionchange % 8];
-					linelength += 2;
-					//					work_bits[p.px+p.py*width]=255;
-					directionold = direction;
-					direction = (direction + 5 * inner) % 8;
-					done = false;
-					directionchange = 5 * inner;
-					while (!done)
-					{
-						directionchange += inner;
-						direction = (direction + inner) % 8;
-						pos2 = pos1 + offset[direction];
-						if (tmp_bits[pos2] == f)
-							done = true;
-					}
-				}
-				//				while(pos1!=pos||(inner==1&&pos2!=possecond));
-				while (pos1 != pos || pos2 != possecond);
-				//				while(pos1!=pos||(inner==1&&!visited[pos2]));
-				//				while(pos1!=pos);
-				//				vec_pt.pop_back();
-
-				if (inner == 7)
-				{
-					if (bubble_size < (float)minsize)
-						inner_line.push_back(vec_pt);
-				}
-			}
-			pos++;
-		}
-	}
-
-	free(visited);
-
-	std::vector<int> s;
-
-	int i4 = m_Width + 3;
-	//int i1=0;
-	for (int j = 0; j < m_Height; j++)
-	{
-		for (int k = 0; k < m_Width; k++)
-		{
-			tmp_bits[i4] = 2;
-			i4++;
-		}
-
-		i4 += 2;
-	}
-
-	for (std::vector<std::vector<Point>>::iterator it1 = inner_line.begin();
-			 it1 != inner_line.end(); it1++)
-	{
-		for (std::vector<Point>::iterator it = it1->begin(); it != it1->end(); it++)
-		{
-			tmp_bits[it->px + 1 + (it->py + 1) * (m_Width + 2)] = 1;
-		}
-	}
-
-	for (int j = 0; j < m_Width + 2; j++)
-		tmp_bits[j] = tmp_bits[j + ((unsigned)m_Width + 2) * (m_Height + 1)] = 0;
-	for (int j = 0; j <= ((int)m_Width + 2) * (m_Height + 1); j += m_Width + 2)
-		tmp_bits[j] = tmp_bits[j + m_Width + 1] = 0;
-
-	for (int j = m_Width + 3; j < 2 * m_Width + 3; j++)
-	{
-		if (tmp_bits[j] == 2)
-		{
-			tmp_bits[j] = TISSUES_SIZE_MAX;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = m_Area + 2 * m_Height + 1;
-			 j < m_Area + m_Width + 2 * m_Height + 1; j++)
-	{
-		if (tmp_bits[j] == 2)
-		{
-			tmp_bits[j] = TISSUES_SIZE_MAX;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = 2 * m_Width + 5; j <= m_Area + 2 * m_Height + 1;
-			 j += m_Width + 2)
-	{
-		if (tmp_bits[j] == 2)
-		{
-			tmp_bits[j] = TISSUES_SIZE_MAX;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = 3 * m_Width + 4; j <= m_Area + m_Width + 2 * m_Height;
-			 j += m_Width + 2)
-	{
-		if (tmp_bits[j] == 2)
-		{
-			tmp_bits[j] = TISSUES_SIZE_MAX;
-			s.push_back(j);
-		}
-	}
-
-	while (!s.empty())
-	{
-		i4 = s.back();
-		s.pop_back();
-		if (tmp_bits[i4 - 1] == 2)
-		{
-			tmp_bits[i4 - 1] = TISSUES_SIZE_MAX;
-			s.push_back(i4 - 1);
-		}
-		if (tmp_bits[i4 + 1] == 2)
-		{
-			tmp_bits[i4 + 1] = TISSUES_SIZE_MAX;
-			s.push_back(i4 + 1);
-		}
-		if (tmp_bits[i4 - m_Width - 2] == 2)
-		{
-			tmp_bits[i4 - m_Width - 2] = TISSUES_SIZE_MAX;
-			s.push_back(i4 - m_Width - 2);
-		}
-		if (tmp_bits[i4 + m_Width + 2] == 2)
-		{
-			tmp_bits[i4 + m_Width + 2] = TISSUES_SIZE_MAX;
-			s.push_back(i4 + m_Width + 2);
-		}
-	}
-
-	i4 = m_Width + 3;
-	int i2 = 0;
-	for (int j = 0; j < m_Height; j++)
-	{
-		for (int k = 0; k < m_Width; k++)
-		{
-			if (tmp_bits[i4] == 2)
-				tissues[i2] = f;
-			i4++;
-			i2++;
-		}
-
-		i4 += 2;
-	}
-
-	free(tmp_bits);
-}
-
-void Bmphandler::RemoveIslands(float f, int minsize)
-{
-	std::vector<std::vector<Point>> outer_line;
-	minsize = 2 * minsize;
-	float bubble_size;
-	float linelength;
-	short directionchange;
-
-	float* tmp_bits =
-			(float*)malloc(sizeof(float) * (m_Width + 2) * (m_Height + 2));
-	bool* visited = (bool*)malloc(sizeof(bool) * (m_Width + 2) * (m_Height + 2));
-	for (unsigned i = 0; i < unsigned(m_Width + 2) * (m_Height + 2); i++)
-		visited[i] = false;
-
-	unsigned pos = m_Width + 3;
-	unsigned pos1 = 0;
-	unsigned pos2;
-	unsigned possecond;
-	bool done;
-	short inner;									 //1 for outer, 7 for inner border
-	short direction, directionold; // 0:rechts, 1:rechts oben, 2:oben, ... 7:rechts unten.
-	Point p;
-
-	std::vector<Point> vec_pt;
-	int offset[8] = {1, m_Width + 3, m_Width + 2, m_Width + 1, -1, -m_Width - 3, -m_Width - 2, -m_Width - 1};
-	float dy[8] = {0, 1, 1, 1, 0, -1, -1, -1};
-	float dx[8] = {1, 1, 0, -1, -1, -1, 0, 1};
-	float bordervolume[8] = {1, 0.75f, 0.5f, 0.25f, 2, 1.75f, 1.5f, 1.25f};
-
-	for (unsigned i = 0; i < m_Height; i++)
-	{
-		for (unsigned j = 0; j < m_Width; j++)
-		{
-			tmp_bits[pos] = m_WorkBits[pos1];
-			pos++;
-			pos1++;
-		}
-		pos += 2;
-	}
-
-	for (unsigned i = 0; i < unsigned(m_Width + 2); i++)
-		tmp_bits[i] = unvisited;
-	for (unsigned i = unsigned(m_Width + 2) * (m_Height + 1);
-			 i < unsigned(m_Width + 2) * (m_Height + 2); i++)
-		tmp_bits[i] = unvisited;
-	for (unsigned i = 0; i < unsigned(m_Width + 2) * (m_Height + 2);
-			 i += (m_Width + 2))
-		tmp_bits[i] = unvisited;
-	for (unsigned i = m_Width + 1; i < unsigned(m_Width + 2) * (m_Height + 2);
-			 i += (m_Width + 2))
-		tmp_bits[i] = unvisited;
-
-	pos = m_Width + 2;
-	while (pos < unsigned(m_Width + 2) * (m_Height + 1))
-	{
-		while ((tmp_bits[pos] != f || tmp_bits[pos - 1] == f || visited[pos]) &&
-					 pos < unsigned(m_Width + 2) * (m_Height + 1))
-			pos++;
-
-		if (pos < unsigned(m_Width + 2) * (m_Height + 1))
-		{
-			pos1 = pos;
-			vec_pt.clear();
-			p.px = short(pos % (m_Width + 2) - 1);
-			p.py = short(pos / (m_Width + 2) - 1);
-			//			vec_pt.push_back(p);
-
-			if (tmp_bits[pos + 1] != f && tmp_bits[pos + m_Width + 3] != f &&
-					tmp_bits[pos + m_Width + 2] != f &&
-					tmp_bits[pos + m_Width + 1] != f &&
-					tmp_bits[pos - m_Width - 1] != f &&
-					tmp_bits[pos - m_Width - 2] != f &&
-					tmp_bits[pos - m_Width - 3] != f)
-			{
-				visited[pos] = true;
-				vec_pt.push_back(p);
-				if (1 < minsize)
-					outer_line.push_back(vec_pt);
-			}
-			else
-			{
-				if (tmp_bits[pos - m_Width - 3] == f)
-				{						 // tricky criteria
-					inner = 7; // inner line
-					directionold = direction = 1;
-				}
-				else
-				{
-					/*					if(tmp_bits[pos-width-2]==f){
-						inner=7; // inner line
-						direction=2;
-					}
-					else{*/
-					inner = 1; // outer line
-					directionold = direction = 7;
-					//					}
-				}
-
-				bubble_size = 0;
-				linelength = 0;
-
-				direction = (direction + 5 * inner) % 8;
-				done = false;
-				directionchange = 5 * inner;
-				while (!done)
-				{
-					directionchange += inner;
-					direction = (direction + inner) % 8;
-					pos2 = pos1 + offset[direction];
-					if (tmp_bits[pos2] == f)
-						done = true;
-				}
-
-				possecond = pos2;
-
-				do
-				{
-					vec_pt.push_back(p);
-					//					if(inner==1)
-					//						bmp_bits[p.px+(unsigned)width*p.py]=255-bmp_bits[p.px+(unsigned)width*p.py];//xxxxxxxxxxxxxxxxxx
-					//					if(direction<5||inner==1||tmp_bits[pos1-1]==f||directionold<4)
-					if (tmp_bits[pos1 - 1] == f ||
-							(inner == 7 &&
-									!(((direction + 6) % 8 > 2 && directionold > 3 &&
-												(directionchange + 5) % 8 > 2) ||
-											(direction == 5 && directionold == 3))) ||
-							(inner == 1 && !(((direction + 4) % 8 > 2 &&
-																	 (directionold + 7) % 8 < 4 &&
-																	 (directionchange + 5) % 8 > 2) ||
-																 (direction == 3 && directionold == 5)))
-							//					 (inner==1&&!(||(direction==3&&directionold==5)))
-					)
-						visited[pos1] = true;
-					pos1 = pos2;
-					p.px = short(pos1 % (m_Width + 2) - 1);
-					p.py = short(pos1 / (m_Width + 2) - 1);
-					//					vec_pt.push_back(p);
-					bubble_size += dy[direction] * (2 * p.px - dx[direction]);
-					bubble_size -= bordervolume[directionchange % 8];
-					linelength += 2;
-					//					work_bits[p.px+p.py*width]=255;
-					directionold = direction;
-					direction = (direction + 5 * inner) % 8;
-					done = false;
-					directionchange = 5 * inner;
-					while (!done)
-					{
-						directionchange += inner;
-						direction = (direction + inner) % 8;
-						pos2 = pos1 + offset[direction];
-						if (tmp_bits[pos2] == f)
-							done = true;
-					}
-				}
-				//				while(pos1!=pos||(inner==1&&pos2!=possecond));
-				while (pos1 != pos || pos2 != possecond);
-				//				while(pos1!=pos||(inner==1&&!visited[pos2]));
-				//				while(pos1!=pos);
-				//				vec_pt.pop_back();
-
-				if (inner == 1)
-				{
-					if (bubble_size + linelength < (float)minsize)
-						outer_line.push_back(vec_pt);
-				}
-			}
-			pos++;
-		}
-	}
-
-	free(visited);
-
-	std::vector<int> s;
-
-	int i4 = m_Width + 3;
-	int i1 = 0;
-	for (int j = 0; j < m_Height; j++)
-	{
-		for (int k = 0; k < m_Width; k++)
-		{
-			tmp_bits[i4] = -1;
-			i4++;
-			i1++;
-		}
-
-		i4 += 2;
-	}
-
-	for (std::vector<std::vector<Point>>::iterator it1 = outer_line.begin();
-			 it1 != outer_line.end(); it1++)
-	{
-		for (std::vector<Point>::iterator it = it1->begin(); it != it1->end(); it++)
-		{
-			tmp_bits[it->px + 1 + (it->py + 1) * (m_Width + 2)] = 1;
-		}
-	}
-
-	for (int j = 0; j < m_Width + 2; j++)
-		tmp_bits[j] = tmp_bits[j + ((unsigned)m_Width + 2) * (m_Height + 1)] = 0;
-	for (int j = 0; j <= ((int)m_Width + 2) * (m_Height + 1); j += m_Width + 2)
-		tmp_bits[j] = tmp_bits[j + m_Width + 1] = 0;
-
-	for (int j = m_Width + 3; j < 2 * m_Width + 3; j++)
-	{
-		if (tmp_bits[j] == -1)
-		{
-			tmp_bits[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = m_Area + 2 * m_Height + 1;
-			 j < m_Area + m_Width + 2 * m_Height + 1; j++)
-	{
-		if (tmp_bits[j] == -1)
-		{
-			tmp_bits[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = 2 * m_Width + 5; j <= m_Area + 2 * m_Height + 1;
-			 j += m_Width + 2)
-	{
-		if (tmp_bits[j] == -1)
-		{
-			tmp_bits[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = 3 * m_Width + 4; j <= m_Area + m_Width + 2 * m_Height;
-			 j += m_Width + 2)
-	{
-		if (tmp_bits[j] == -1)
-		{
-			tmp_bits[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-
-	HystereticGrowth(tmp_bits, &s, m_Width + 2, m_Height + 2, false, 255.0f);
-
-	i4 = m_Width + 3;
-	int i2 = 0;
-	for (int j = 0; j < m_Height; j++)
-	{
-		for (int k = 0; k < m_Width; k++)
-		{
-			if (tmp_bits[i4] == 0)
-				m_WorkBits[i2] = 0;
-			//			work_bits[i2]=tmp_bits[i4];
-			i4++;
-			i2++;
-		}
-
-		i4 += 2;
-	}
-	for (std::vector<std::vector<Point>>::iterator it1 = outer_line.begin();
-			 it1 != outer_line.end(); it1++)
-	{
-		for (std::vector<Point>::iterator it = it1->begin(); it != it1->end(); it++)
-		{
-			m_WorkBits[it->px + it->py * m_Width] = 0;
-		}
-	}
-
-	free(tmp_bits);
-}
+void Bmphandler::RemoveIslands(float f, int minsize)
+{
+	RemoveSmallIslands(m_WorkBits, m_Width, m_Height, f, minsize);
+}
 
 void Bmphandler::RemoveIslandstissue(tissuelayers_size_t idx, tissues_size_t f, int minsize)
 {
-	std::vector<std::vector<Point>> outer_line;
-	minsize = 2 * minsize;
-	float bubble_size;
-	float linelength;
-	short directionchange;
-
-	tissues_size_t* tmp_bits = (tissues_size_t*)malloc(sizeof(tissues_size_t) * (m_Width + 2) * (m_Height + 2));
-	bool* visited = (bool*)malloc(sizeof(bool) * (m_Width + 2) * (m_Height + 2));
-	for (unsigned i = 0; i < unsigned(m_Width + 2) * (m_Height + 2); i++)
-		visited[i] = false;
-
-	unsigned pos = m_Width + 3;
-	unsigned pos1 = 0;
-	unsigned pos2;
-	unsigned possecond;
-	bool done;
-	short inner;									 //1 for outer, 7 for inner border
-	short direction, directionold; // 0:rechts, 1:rechts oben, 2:oben, ... 7:rechts unten.
-	Point p;
-
-	std::vector<Point> vec_pt;
-	int offset[8] = {1, m_Width + 3, m_Width + 2, m_Width + 1, -1, -m_Width - 3, -m_Width - 2, -m_Width - 1};
-	float dy[8] = {0, 1, 1, 1, 0, -1, -1, -1};
-	float dx[8] = {1, 1, 0, -1, -1, -1, 0, 1};
-	float bordervolume[8] = {1, 0.75f, 0.5f, 0.25f, 2, 1.75f, 1.5f, 1.25f};
-
-	tissues_size_t* tissues = m_Tissuelayers[idx];
-	for (unsigned i = 0; i < m_Height; i++)
-	{
-		for (unsigned j = 0; j < m_Width; j++)
-		{
-			tmp_bits[pos] = tissues[pos1];
-			pos++;
-			pos1++;
-		}
-		pos += 2;
-	}
-
-	tissues_size_t unvis = f + 1;
-	if (f == TISSUES_SIZE_MAX)
-		unvis = 0;
-	for (unsigned i = 0; i < unsigned(m_Width + 2); i++)
-		tmp_bits[i] = unvis;
-	for (unsigned i = unsigned(m_Width + 2) * (m_Height + 1);
-			 i < unsigned(m_Width + 2) * (m_Height + 2); i++)
-		tmp_bits[i] = unvis;
-	for (unsigned i = 0; i < unsigned(m_Width + 2) * (m_Height + 2);
-			 i += (m_Width + 2))
-		tmp_bits[i] = unvis;
-	for (unsigned i = m_Width + 1; i < unsigned(m_Width + 2) * (m_Height + 2);
-			 i += (m_Width + 2))
-		tmp_bits[i] = unvis;
-
-	pos = m_Width + 2;
-	while (pos < unsigned(m_Width + 2) * (m_Height + 1))
-	{
-		while ((tmp_bits[pos] != f || tmp_bits[pos - 1] == f || visited[pos]) &&
-					 pos < unsigned(m_Width + 2) * (m_Height + 1))
-			pos++;
-
-		if (pos < unsigned(m_Width + 2) * (m_Height + 1))
-		{
-			pos1 = pos;
-			vec_pt.clear();
-			p.px = short(pos % (m_Width + 2) - 1);
-			p.py = short(pos / (m_Width + 2) - 1);
-			//			vec_pt.push_back(p);
-
-			if (tmp_bits[pos + 1] != f && tmp_bits[pos + m_Width + 3] != f &&
-					tmp_bits[pos + m_Width + 2] != f &&
-					tmp_bits[pos + m_Width + 1] != f &&
-					tmp_bits[pos - m_Width - 1] != f &&
-					tmp_bits[pos - m_Width - 2] != f &&
-					tmp_bits[pos - m_Width - 3] != f)
-			{
-				visited[pos] = true;
-				vec_pt.push_back(p);
-				if (1 < minsize)
-					outer_line.push_back(vec_pt);
-			}
-			else
-			{
-				if (tmp_bits[pos - m_Width - 3] == f)
-				{						 // tricky criteria
-					inner = 7; // inner line
-					directionold = direction = 1;
-				}
-				else
-				{
-					/*					if(tmp_bits[pos-width-2]==f){
-						inner=7; // inner line
-						direction=2;
-					}
-					else{*/
-					inner = 1; // outer line
-					directionold = direction = 7;
-					//					}
-				}
-
-				bubble_size = 0;
-				linelength = 0;
-
-				direction = (direction + 5 * inner) % 8;
-				done = false;
-				directionchange = 5 * inner;
-				while (!done)
-				{
-					directionchange += inner;
-					direction = (direction + inner) % 8;
-					pos2 = pos1 + offset[direction];
-					if (tmp_bits[pos2] == f)
-						done = true;
-				}
-
-				possecond = pos2;
-
-				do
-				{
-					vec_pt.push_back(p);
-					//					if(inner==1)
-					//						bmp_bits[p.px+(unsigned)width*p.py]=255-bmp_bits[p.px+(unsigned)width*p.py];//xxxxxxxxxxxxxxxxxx
-					//					if(direction<5||inner==1||tmp_bits[pos1-1]==f||directionold<4)
-					if (tmp_bits[pos1 - 1] == f ||
-							(inner == 7 &&
-									!(((direction + 6) % 8 > 2 && directionold > 3 &&
-												(directionchange + 5) % 8 > 2) ||
-											(direction == 5 && directionold == 3))) ||
-							(inner == 1 && !(((direction + 4) % 8 > 2 &&
-																	 (directionold + 7) % 8 < 4 &&
-																	 (directionchange + 5) % 8 > 2) ||
-																 (direction == 3 && directionold == 5)))
-							//					 (inner==1&&!(||(direction==3&&directionold==5)))
-					)
-						visited[pos1] = true;
-					pos1 = pos2;
-					p.px = short(pos1 % (m_Width + 2) - 1);
-					p.py = short(pos1 / (m_Width + 2) - 1);
-					//					vec_pt.push_back(p);
-					bubble_size += dy[direction] * (2 * p.px - dx[direction]);
-					bubble_size -= bordervolume[directionchange % 8];
-					linelength += 2;
-					//					work_bits[p.px+p.py*width]=255;
-					directionold = direction;
-					direction = (direction + 5 * inner) % 8;
-					done = false;
-					directionchange = 5 * inner;
-					while (!done)
-					{
-						directionchange += inner;
-						direction = (direction + inner) % 8;
-						pos2 = pos1 + offset[direction];
-						if (tmp_bits[pos2] == f)
-							done = true;
-					}
-				}
-				//				while(pos1!=pos||(inner==1&&pos2!=possecond));
-				while (pos1 != pos || pos2 != possecond);
-				//				while(pos1!=pos||(inner==1&&!visited[pos2]));
-				//				while(pos1!=pos);
-				//				vec_pt.pop_back();
-
-				if (inner == 1)
-				{
-					if (bubble_size + linelength < (float)minsize)
-						outer_line.push_back(vec_pt);
-				}
-			}
-			pos++;
-		}
-	}
-
-	free(visited);
-
-	std::vector<int> s;
-
-	int i4 = m_Width + 3;
-	//int i1=0;
-	for (int j = 0; j < m_Height; j++)
-	{
-		for (int k = 0; k < m_Width; k++)
-		{
-			tmp_bits[i4] = 2;
-			i4++;
-		}
-
-		i4 += 2;
-	}
-
-	for (std::vector<std::vector<Point>>::iterator it1 = outer_line.begin();
-			 it1 != outer_line.end(); it1++)
-	{
-		for (std::vector<Point>::iterator it = it1->begin(); it != it1->end(); it++)
-		{
-			tmp_bits[it->px + 1 + (it->py + 1) * (m_Width + 2)] = 1;
-		}
-	}
-
-	for (int j = 0; j < m_Width + 2; j++)
-		tmp_bits[j] = tmp_bits[j + ((unsigned)m_Width + 2) * (m_Height + 1)] = 0;
-	for (int j = 0; j <= ((int)m_Width + 2) * (m_Height + 1); j += m_Width + 2)
-		tmp_bits[j] = tmp_bits[j + m_Width + 1] = 0;
-
-	for (int j = m_Width + 3; j < 2 * m_Width + 3; j++)
-	{
-		if (tmp_bits[j] == 2)
-		{
-			tmp_bits[j] = TISSUES_SIZE_MAX;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = m_Area + 2 * m_Height + 1;
-			 j < m_Area + m_Width + 2 * m_Height + 1; j++)
-	{
-		if (tmp_bits[j] == 2)
-		{
-			tmp_bits[j] = TISSUES_SIZE_MAX;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = 2 * m_Width + 5; j <= m_Area + 2 * m_Height + 1;
-			 j += m_Width + 2)
-	{
-		if (tmp_bits[j] == 2)
-		{
-			tmp_bits[j] = TISSUES_SIZE_MAX;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = 3 * m_Width + 4; j <= m_Area + m_Width + 2 * m_Height;
-			 j += m_Width + 2)
-	{
-		if (tmp_bits[j] == 2)
-		{
-			tmp_bits[j] = TISSUES_SIZE_MAX;
-			s.push_back(j);
-		}
-	}
-
-	while (!s.empty())
-	{
-		i4 = s.back();
-		s.pop_back();
-		if (tmp_bits[i4 - 1] == 2)
-		{
-			tmp_bits[i4 - 1] = TISSUES_SIZE_MAX;
-			s.push_back(i4 - 1);
-		}
-		if (tmp_bits[i4 + 1] == 2)
-		{
-			tmp_bits[i4 + 1] = TISSUES_SIZE_MAX;
-			s.push_back(i4 + 1);
-		}
-		if (tmp_bits[i4 - m_Width - 2] == 2)
-		{
-			tmp_bits[i4 - m_Width - 2] = TISSUES_SIZE_MAX;
-			s.push_back(i4 - m_Width - 2);
-		}
-		if (tmp_bits[i4 + m_Width + 2] == 2)
-		{
-			tmp_bits[i4 + m_Width + 2] = TISSUES_SIZE_MAX;
-			s.push_back(i4 + m_Width + 2);
-		}
-	}
-
-	i4 = m_Width + 3;
-	int i2 = 0;
-	for (int j = 0; j < m_Height; j++)
-	{
-		for (int k = 0; k < m_Width; k++)
-		{
-			if (tmp_bits[i4] == 2)
-				tissues[i2] = 0;
-			i4++;
-			i2++;
-		}
-
-		i4 += 2;
-	}
-	for (std::vector<std::vector<Point>>::iterator it1 = outer_line.begin();
-			 it1 != outer_line.end(); it1++)
-	{
-		for (std::vector<Point>::iterator it = it1->begin(); it != it1->end(); it++)
-		{
-			tissues[it->px + it->py * m_Width] = 0;
-		}
-	}
-
-	free(tmp_bits);
+	RemoveSmallIslands(m_Tissuelayers[idx], m_Width, m_Height, f, minsize);
 }
 
 /*void Bmphandler::add_skin(unsigned i)
@@ -27,6 +27,7 @@ class ImageForestingTransformLivewire;
 class ImageForestingTransformFastMarching;
 class SliceProvider;
 class SliceProviderInstaller;
+struct SliceAnnotations;
 
 const unsigned int unvisited = 222222;
 const float f_tol = 0.00001f;
@@ -151,6 +152,10 @@ public:
 	FILE* SaveStack(FILE* fp) const;
 	FILE* LoadProj(FILE* fp, int tissuesVersion, bool inclpics = true, bool init = true);
 	FILE* LoadStack(FILE* fp);
+	/// Marks, vvm, limits and modes as stored in the project file
+	void GetAnnotations(SliceAnnotations& slice) const;
+	/// Allocate the slice and take over the annotations, leaves 'slice' empty
+	void SetAnnotations(SliceAnnotations& slice, bool init = true);
 	int SaveDIBitmap(const char* filename);
 	int SaveWorkBitmap(const char* filename);
 	int SaveTissueBitmap(tissuelayers_size_t idx, const char* filename);
@@ -201,6 +206,8 @@ public:
 	void Sobelxy(float** sobelx, float** sobely);
 	void MedianInterquartile(bool median);
 	void MedianInterquartile(float* median, float* iq);
+	/// Percentile (0 to 100) of the bmp in a window of nx x ny pixels (made odd), clipped at the border
+	void PercentileFilter(unsigned short nx, unsigned short ny, float percentile);
 	void Sigmafilter(float sigma, unsigned short nx, unsigned short ny);
 	void Compacthist();
 	void MomentLine();
@@ -222,10 +229,13 @@ public:
 	void ThresholdedGrowing(Point p, float threshfactor_low, float threshfactor_high, bool connectivity, float set_to, Pair* tp);
 	void ThresholdedGrowing(float thresh_low, float thresh_high, bool connectivity, float* mask, float f, float set_to);
 	void DistanceMap(bool connectivity);
-	void DistanceMap(bool connectivity, float f, short unsigned levlset); //0:outside,1:inside,2:both
+	/// Exact distance to the contour of the f-region added to f, levlset 0: outside, 1: inside, 2: both
+	void DistanceMap(float f, short unsigned levlset);
+	/// Exact distance to the edges between different bmp values
 	void DeadReckoning();
-	unsigned* DeadReckoning(float f);
-	unsigned* DeadReckoningSquared(float f);
+	/// Exact distance to the contour of the f-region, positive inside. 'nearest' (m_Area entries, optional) receives the index of the closest contour pixel
+	void DeadReckoning(float f, unsigned* nearest = nullptr);
+	void DeadReckoningSquared(float f, unsigned* nearest = nullptr);
 	void IftDistance1(float f);
 	void Erosion(int n, bool connectivity);
 	void Erosion1(int n, bool connectivity);
@@ -384,7 +394,6 @@ protected:
 	int SaveRaw(const char* filename, float* p_bits) const;
 	void Bucketsort(std::vector<unsigned int>* sorted, float* p_bits) const;
 	void SetMarker(unsigned* wshed);
-	float BaseConnection(float c, std::vector<float>* maps);
 	void HystereticGrowth(float* pict, std::vector<int>* s, unsigned short w, unsigned short h, bool connectivity, float set_to);
 	void HystereticGrowth(float* pict, std::vector<int>* s, unsigned short w, unsigned short h, bool connectivity, float set_to, int nr);
 	template<typename T, typename F>
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2021 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../BatchPipeline.h"
+
+#include <sstream>
+#include <string>
+
+namespace {
+bool Parse(iseg::BatchPipeline& pipeline, const std::string& text, std::string& error)
+{
+	std::istringstream in(text);
+	error.clear();
+	return pipeline.Parse(in, error);
+}
+
+bool Contains(const std::string& s, const std::string& part)
+{
+	return s.find(part) != std::string::npos;
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(BatchPipeline_suite);
+
+BOOST_AUTO_TEST_CASE(ValidPipeline)
+{
+	iseg::BatchPipeline pipeline;
+	std::string error;
+	BOOST_REQUIRE(Parse(pipeline,
+			"# segment the bones\n"
+			"\n"
+			"load file=${input}\n"
+			"  gaussian   sigma=1.5 3d=0\n"
+			"threshold lower=100 upper=400\n"
+			"add_tissue tissue=1\n"
+			"smooth_tissues sigma=0.5 3d=0\n"
+			"save file=${output_dir}/${name}.h5\n",
+			error));
+	BOOST_CHECK(error.empty());
+
+	const auto& steps = pipeline.Steps();
+	BOOST_REQUIRE_EQUAL(steps.size(), 6);
+	BOOST_CHECK_EQUAL(steps[0].m_Operation, "load");
+	BOOST_CHECK_EQUAL(steps[0].m_Line, 3);
+	BOOST_CHECK_EQUAL(steps[0].m_Arguments.at("file"), "${input}");
+	BOOST_CHECK_EQUAL(steps[1].m_Operation, "gaussian");
+	BOOST_CHECK_EQUAL(steps[1].m_Arguments.at("sigma"), "1.5");
+	BOOST_CHECK_EQUAL(steps[1].m_Arguments.at("3d"), "0");
+
+	// defaults are filled in
+	BOOST_CHECK_EQUAL(steps[3].m_Arguments.at("value"), "255");
+	BOOST_CHECK_EQUAL(steps[3].m_Arguments.at("override"), "0");
+	BOOST_CHECK_EQUAL(steps[5].m_Arguments.at("data"), "tissues");
+}
+
+BOOST_AUTO_TEST_CASE(InvalidPipelines)
+{
+	iseg::BatchPipeline pipeline;
+	std::string error;
+
+	BOOST_CHECK(!Parse(pipeline, "", error));
+	BOOST_CHECK(Contains(error, "must start with 'load'"));
+
+	BOOST_CHECK(!Parse(pipeline, "threshold lower=1 upper=2\nload file=a.nii\n", error));
+	BOOST_CHECK(Contains(error, "must start with 'load'"));
+
+	BOOST_CHECK(!Parse(pipeline, "load file=a.nii\nsharpen amount=2\n", error));
+	BOOST_CHECK(Contains(error, "line 2"));
+	BOOST_CHECK(Contains(error, "unknown operation 'sharpen'"));
+
+	BOOST_CHECK(!Parse(pipeline, "load file=a.nii\ngaussian 1.5\n", error));
+	BOOST_CHECK(Contains(error, "expected key=value"));
+
+	BOOST_CHECK(!Parse(pipeline, "load file=a.nii\ngaussian sigma=1 radius=2\n", error));
+	BOOST_CHECK(Contains(error, "unknown argument 'radius' for gaussian"));
+
+	BOOST_CHECK(!Parse(pipeline, "load file=a.nii\nthreshold lower=100\n", error));
+	BOOST_CHECK(Contains(error, "missing argument 'upper' for threshold"));
+
+	BOOST_CHECK(!Parse(pipeline, "load\n", error));
+	BOOST_CHECK(Contains(error, "missing argument 'file' for load"));
+}
+
+BOOST_AUTO_TEST_CASE(ArgumentValues)
+{
+	iseg::BatchPipeline pipeline;
+	std::string error;
+
+	BOOST_CHECK(!Parse(pipeline, "load file=a.nii\nthreshold lower=abc upper=1\n", error));
+	BOOST_CHECK(Contains(error, "invalid value 'abc' for lower"));
+
+	BOOST_CHECK(!Parse(pipeline, "load file=a.nii\nmedian n=3.5\n", error));
+	BOOST_CHECK(Contains(error, "invalid value '3.5' for n"));
+
+	BOOST_CHECK(!Parse(pipeline, "load file=a.nii\ngaussian sigma=1 3d=yes\n", error));
+	BOOST_CHECK(Contains(error, "invalid value 'yes' for 3d"));
+
+	BOOST_CHECK(!Parse(pipeline, "load file=\n", error));
+	BOOST_CHECK(Contains(error, "invalid value '' for file"));
+
+	// variables are only allowed in strings, since their value is not known yet
+	BOOST_CHECK(!Parse(pipeline, "load file=a.nii\ngaussian sigma=${sigma}\n", error));
+	BOOST_CHECK(Contains(error, "invalid value"));
+
+	BOOST_CHECK(Parse(pipeline, "load file=a.nii\ntissue_to_target tissues=1,3,4\n", error));
+	BOOST_CHECK(Parse(pipeline, "load file=a.nii\ntissue_to_target tissues=all\n", error));
+	BOOST_CHECK(!Parse(pipeline, "load file=a.nii\ntissue_to_target tissues=1;2\n", error));
+	BOOST_CHECK(Contains(error, "invalid value '1;2' for tissues"));
+}
+
+BOOST_AUTO_TEST_CASE(Usage)
+{
+	auto const usage = iseg::BatchPipeline::Usage();
+	for (auto op : {"load", "save", "threshold", "smooth_tissues", "surfaces"})
+	{
+		BOOST_CHECK(Contains(usage, op));
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();